@@ -23,15 +23,34 @@
  * ".s3p", etc.  for Touchstone 1, ".ts" for Touchstone 2, and ".npd"
  * or other for NPD format.
  *
- * Example:
+ * Given more than one input/output pair, a list file (-l), or a
+ * directory and output name template (-d, -o), the converter runs in
+ * batch mode: it converts the files on a pool of worker threads, keeps
+ * going past errors, and reports timing, throughput and the failures
+ * at the end.  Each worker holds at most one file in memory, and the
+ * list and directory are read as the workers need them, so memory
+ * doesn't grow with the number of files.
+ *
+ * Examples:
  *     Convert 4x4 network data from a Touchstone 1 file to Z parameters
  *     in magnitude/angle format, saving as Touchstone 2.
  *
  *     npd-convert -f zma data.s4p data.ts
+ *
+ *     Convert every file in directory "in" to NPD using 8 threads.
+ *
+ *     npd-convert -j 8 -d in -o out/%b.npd
  */
+#include <dirent.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <time.h>
 #include <unistd.h>
 #include <vnadata.h>
 
@@ -43,6 +62,9 @@ static char *progname;
  */
 static const char usage[] =
     "%s [-f format] input-file output-file\n"
+    "%s [-f format] [-j jobs] [-v] input-file output-file ...\n"
+    "%s [-f format] [-j jobs] [-v] -l list-file\n"
+    "%s [-f format] [-j jobs] [-v] -d directory -o template\n"
     "where format is a comma-separated list of:\n"
     "  s[ri|ma|dB]  scattering parameters\n"
     "  t[ri|ma|dB]  scattering-transfer parameters\n"
@@ -66,7 +88,26 @@ static const char usage[] =
     "  ma  magnitude, angle\n"
     "  dB  decibels, angle\n"
     "\n"
-    "Specifiers are case-insensitive.\n";
+    "Specifiers are case-insensitive.\n"
+    "\n"
+    "Batch options\n"
+    "  -j jobs       number of worker threads (default: number of CPUs)\n"
+    "  -l list-file  read input and output names from list-file, one pair\n"
+    "                per line, separated by a tab or spaces (- for stdin)\n"
+    "  -d directory  convert every regular file in directory\n"
+    "  -o template   output name for -d, where %%b is the input name\n"
+    "                without its extension, %%f is the input name, and\n"
+    "                %%%% is a percent sign\n"
+    "  -v            report the time taken for each file\n";
+
+/*
+ * print_usage: print the usage text and exit
+ */
+static void print_usage()
+{
+    (void)fprintf(stderr, usage, progname, progname, progname, progname);
+    exit(2);
+}
 
 /*
  * error_fn: error printing function for the library
@@ -80,13 +121,548 @@ static void error_fn(const char *message, void *error_arg,
     (void)fprintf(stderr, "%s: %s\n", progname, message);
 }
 
+/*
+ * failure_t: a file that couldn't be converted
+ */
+typedef struct failure {
+    char	       *f_input;		/* input file name */
+    char	       *f_messages;		/* error messages */
+    struct failure     *f_next;			/* next in list */
+} failure_t;
+
+/*
+ * batch_t: state shared by the worker threads
+ */
+typedef struct batch {
+    pthread_mutex_t	b_mutex;		/* protects all below */
+
+    /* source of input/output pairs: arguments, list file or directory */
+    char	      **b_argv;			/* remaining arguments */
+    int			b_argc;			/* count of b_argv */
+    FILE	       *b_list_fp;		/* list file */
+    const char	       *b_list_name;		/* name of list file */
+    int			b_list_line;		/* line number in list file */
+    char	       *b_line;			/* list file line buffer */
+    size_t		b_line_size;		/* allocation of b_line */
+    DIR		       *b_dir;			/* directory stream */
+    const char	       *b_directory;		/* name of directory */
+    const char	       *b_template;		/* output name template */
+    const char	       *b_format;		/* -f argument or NULL */
+    bool		b_verbose;		/* -v given */
+
+    /* results */
+    int			b_converted;		/* files converted */
+    long long		b_bytes;		/* input bytes converted */
+    double		b_seconds;		/* sum of per-file times */
+    double		b_min_seconds;		/* fastest file */
+    double		b_max_seconds;		/* slowest file */
+    int			b_failed;		/* files that failed */
+    failure_t	       *b_failure_head;		/* failed files */
+    failure_t	      **b_failure_tail;		/* end of b_failure_head */
+} batch_t;
+
+/*
+ * worker_t: per-thread state
+ */
+typedef struct worker {
+    batch_t	       *w_bp;			/* shared state */
+    pthread_t		w_thread;		/* thread id */
+    char	       *w_messages;		/* messages for current file */
+    size_t		w_length;		/* length of w_messages */
+} worker_t;
+
+/*
+ * now: return the monotonic time in seconds
+ */
+static double now()
+{
+    struct timespec ts;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + 1.0e-9 * (double)ts.tv_nsec;
+}
+
+/*
+ * add_message: append a line to a worker's messages
+ *   @wp: worker
+ *   @format: printf-like format
+ */
+static void add_message(worker_t *wp, const char *format, ...)
+{
+    va_list ap;
+    char *new_messages;
+    int length;
+
+    va_start(ap, format);
+    length = vsnprintf(NULL, 0, format, ap);
+    va_end(ap);
+    if (length < 0 || (new_messages = realloc(wp->w_messages,
+		    wp->w_length + length + 2)) == NULL) {
+	return;
+    }
+    wp->w_messages = new_messages;
+    va_start(ap, format);
+    (void)vsnprintf(&wp->w_messages[wp->w_length], length + 1, format, ap);
+    va_end(ap);
+    wp->w_length += length;
+    wp->w_messages[wp->w_length++] = '\n';
+    wp->w_messages[wp->w_length] = '\000';
+}
+
+/*
+ * batch_error_fn: error function that saves messages for the summary
+ *   @message: single line error message without a newline
+ *   @error_arg: worker
+ *   @category: category of error (ignored here)
+ */
+static void batch_error_fn(const char *message, void *error_arg,
+	vnaerr_category_t category)
+{
+    add_message((worker_t *)error_arg, "%s", message);
+}
+
+/*
+ * expand_template: make the output name for an input file
+ *   @template: output name template
+ *   @name: input file name without directory
+ *
+ *   Return an allocated string or NULL on error.
+ */
+static char *expand_template(const char *template, const char *name)
+{
+    const char *dot = strrchr(name, '.');
+    size_t base_length = dot != NULL && dot != name ? dot - name :
+	strlen(name);
+    size_t size = 1;
+    char *result, *cp;
+
+    for (const char *tp = template; *tp != '\000'; ++tp) {
+	size += *tp == '%' ? strlen(name) : 1;
+    }
+    if ((result = malloc(size)) == NULL) {
+	return NULL;
+    }
+    cp = result;
+    for (const char *tp = template; *tp != '\000'; ++tp) {
+	if (*tp != '%') {
+	    *cp++ = *tp;
+	    continue;
+	}
+	switch (*++tp) {
+	case 'b':
+	    (void)memcpy((void *)cp, (void *)name, base_length);
+	    cp += base_length;
+	    continue;
+
+	case 'f':
+	    (void)strcpy(cp, name);
+	    cp += strlen(name);
+	    continue;
+
+	case '%':
+	    *cp++ = '%';
+	    continue;
+
+	default:
+	    free((void *)result);
+	    errno = EINVAL;
+	    return NULL;
+	}
+    }
+    *cp = '\000';
+    return result;
+}
+
+/*
+ * check_template: test that a template is valid
+ *   @template: output name template
+ */
+static bool check_template(const char *template)
+{
+    for (const char *tp = template; *tp != '\000'; ++tp) {
+	if (*tp == '%' && strchr("bf%", *++tp) == NULL) {
+	    return false;
+	}
+	if (*tp == '\000') {
+	    return false;
+	}
+    }
+    return true;
+}
+
+/*
+ * next_from_list: get the next pair from the list file
+ *   @bp: shared state (locked)
+ *   @wp: worker to receive error messages
+ *   @input: address to receive the input file name
+ *   @output: address to receive the output file name
+ *
+ *   Return 1 if a pair was found, 0 at end of list, or -1 if the line
+ *   is malformed.
+ */
+static int next_from_list(batch_t *bp, worker_t *wp, char **input,
+	char **output)
+{
+    for (;;) {
+	char *cp, *separator;
+	const char *space;
+	ssize_t length;
+
+	if ((length = getline(&bp->b_line, &bp->b_line_size,
+			bp->b_list_fp)) == -1) {
+	    return 0;
+	}
+	++bp->b_list_line;
+	cp = bp->b_line;
+	while (length > 0 && (cp[length - 1] == '\n' ||
+		    cp[length - 1] == '\r')) {
+	    cp[--length] = '\000';
+	}
+	cp += strspn(cp, " \t");
+	if (*cp == '\000' || *cp == '#') {
+	    continue;
+	}
+
+	/*
+	 * Split on a tab if there is one so that names may contain
+	 * spaces; otherwise split on spaces.
+	 */
+	space = strchr(cp, '\t') != NULL ? "\t" : " ";
+	separator = cp + strcspn(cp, space);
+	if (*separator != '\000') {
+	    *separator++ = '\000';
+	    separator += strspn(separator, " \t");
+	}
+	if (*separator == '\000') {
+	    *input = strdup(cp);
+	    add_message(wp, "%s (line %d): expected input and output names",
+		    bp->b_list_name, bp->b_list_line);
+	    return -1;
+	}
+	*input = strdup(cp);
+	*output = strdup(separator);
+	return 1;
+    }
+}
+
+/*
+ * next_from_directory: get the next pair from the directory
+ *   @bp: shared state (locked)
+ *   @wp: worker to receive error messages
+ *   @input: address to receive the input file name
+ *   @output: address to receive the output file name
+ *
+ *   Return 1 if a pair was found, 0 at the end of the directory, or -1
+ *   on error.
+ */
+static int next_from_directory(batch_t *bp, worker_t *wp, char **input,
+	char **output)
+{
+    struct dirent *dep;
+
+    while ((dep = readdir(bp->b_dir)) != NULL) {
+	struct stat st;
+	size_t size;
+	char *path;
+
+	if (dep->d_name[0] == '.') {
+	    continue;
+	}
+	size = strlen(bp->b_directory) + strlen(dep->d_name) + 2;
+	if ((path = malloc(size)) == NULL) {
+	    add_message(wp, "malloc: %s", strerror(errno));
+	    return -1;
+	}
+	(void)snprintf(path, size, "%s/%s", bp->b_directory, dep->d_name);
+	if (stat(path, &st) == -1 || !S_ISREG(st.st_mode)) {
+	    free((void *)path);
+	    continue;
+	}
+	*input = path;
+	if ((*output = expand_template(bp->b_template, dep->d_name)) == NULL) {
+	    add_message(wp, "%s: %s", path, strerror(errno));
+	    return -1;
+	}
+	return 1;
+    }
+    return 0;
+}
+
+/*
+ * next_pair: get the next input and output file names
+ *   @bp: shared state (locked)
+ *   @wp: worker to receive error messages
+ *   @input: address to receive the input file name
+ *   @output: address to receive the output file name
+ *
+ *   Return 1 if a pair was found, 0 if there are no more, or -1 if
+ *   the next entry couldn't be read.  On -1, *input is the name to
+ *   report, if known.
+ */
+static int next_pair(batch_t *bp, worker_t *wp, char **input, char **output)
+{
+    *input = NULL;
+    *output = NULL;
+    if (bp->b_list_fp != NULL) {
+	return next_from_list(bp, wp, input, output);
+    }
+    if (bp->b_dir != NULL) {
+	return next_from_directory(bp, wp, input, output);
+    }
+    if (bp->b_argc < 2) {
+	return 0;
+    }
+    *input = strdup(bp->b_argv[0]);
+    *output = strdup(bp->b_argv[1]);
+    bp->b_argv += 2;
+    bp->b_argc -= 2;
+    return 1;
+}
+
+/*
+ * convert: convert one file
+ *   @format: -f argument or NULL
+ *   @error_fn: error reporting function
+ *   @error_arg: argument to error_fn
+ *   @input: input file name
+ *   @output: output file name
+ *
+ *   Return 0 on success, or the exit status for the failing step.
+ */
+static int convert(const char *format, vnaerr_error_fn_t *error_fn,
+	void *error_arg, const char *input, const char *output)
+{
+    vnadata_t *vdp;
+    int rc = 0;
+
+    if ((vdp = vnadata_alloc(error_fn, error_arg)) == NULL) {
+	return 3;
+    }
+    if (vnadata_load(vdp, input) == -1) {
+	rc = 4;
+	goto out;
+    }
+    /*
+     * Set the filetype back to auto so that saving to a .ts file forces
+     * Touchstone 2 format.
+     */
+    if (vnadata_set_filetype(vdp, VNADATA_FILETYPE_AUTO) == -1) {
+	rc = 5;
+	goto out;
+    }
+    if (format != NULL) {
+	if (vnadata_set_format(vdp, format) == -1) {
+	    rc = 6;
+	    goto out;
+	}
+    }
+    if (vnadata_save(vdp, output) == -1) {
+	rc = 7;
+	goto out;
+    }
+
+out:
+    vnadata_free(vdp);
+    return rc;
+}
+
+/*
+ * worker: convert files until there are no more
+ *   @arg: worker
+ */
+static void *worker(void *arg)
+{
+    worker_t *wp = arg;
+    batch_t *bp = wp->w_bp;
+
+    for (;;) {
+	char *input, *output;
+	struct stat st;
+	double start, seconds;
+	int rv;
+
+	wp->w_length = 0;
+	(void)pthread_mutex_lock(&bp->b_mutex);
+	rv = next_pair(bp, wp, &input, &output);
+	(void)pthread_mutex_unlock(&bp->b_mutex);
+	if (rv == 0) {
+	    break;
+	}
+	start = now();
+	if (rv == 1) {
+	    if (input == NULL || output == NULL) {
+		add_message(wp, "strdup: %s", strerror(ENOMEM));
+		rv = -1;
+	    } else if (convert(bp->b_format, batch_error_fn, wp,
+			input, output) != 0) {
+		rv = -1;
+	    }
+	}
+	seconds = now() - start;
+
+	/*
+	 * Record the result.
+	 */
+	(void)pthread_mutex_lock(&bp->b_mutex);
+	if (rv == 1) {
+	    if (stat(input, &st) == 0) {
+		bp->b_bytes += st.st_size;
+	    }
+	    if (bp->b_converted == 0 || seconds < bp->b_min_seconds) {
+		bp->b_min_seconds = seconds;
+	    }
+	    if (bp->b_converted == 0 || seconds > bp->b_max_seconds) {
+		bp->b_max_seconds = seconds;
+	    }
+	    bp->b_seconds += seconds;
+	    ++bp->b_converted;
+	    if (bp->b_verbose) {
+		(void)printf("%s -> %s: %.3f ms\n", input, output,
+			1.0e+3 * seconds);
+	    }
+	} else {
+	    failure_t *fp;
+
+	    if (wp->w_length == 0) {
+		add_message(wp, "unknown error");
+	    }
+	    if ((fp = malloc(sizeof(failure_t))) != NULL) {
+		fp->f_input = input;
+		fp->f_messages = strdup(wp->w_messages);
+		fp->f_next = NULL;
+		*bp->b_failure_tail = fp;
+		bp->b_failure_tail = &fp->f_next;
+		input = NULL;
+	    }
+	    ++bp->b_failed;
+	}
+	(void)pthread_mutex_unlock(&bp->b_mutex);
+	free((void *)output);
+	free((void *)input);
+    }
+    return NULL;
+}
+
+/*
+ * report: print the summary of a batch run
+ *   @bp: shared state
+ *   @elapsed: wall-clock seconds for the whole run
+ *   @jobs: number of worker threads
+ */
+static void report(const batch_t *bp, double elapsed, int jobs)
+{
+    const int total = bp->b_converted + bp->b_failed;
+
+    (void)fprintf(stderr, "%s: converted %d of %d file%s in %.3f s "
+	    "using %d thread%s\n", progname, bp->b_converted, total,
+	    total == 1 ? "" : "s", elapsed, jobs, jobs == 1 ? "" : "s");
+    if (bp->b_converted != 0) {
+	(void)fprintf(stderr, "%s: per file: min %.3f ms, mean %.3f ms, "
+		"max %.3f ms\n", progname, 1.0e+3 * bp->b_min_seconds,
+		1.0e+3 * bp->b_seconds / bp->b_converted,
+		1.0e+3 * bp->b_max_seconds);
+	if (elapsed > 0.0) {
+	    (void)fprintf(stderr, "%s: throughput: %.1f files/s, "
+		    "%.2f MB/s\n", progname,
+		    (double)bp->b_converted / elapsed,
+		    1.0e-6 * (double)bp->b_bytes / elapsed);
+	}
+    }
+    if (bp->b_failed != 0) {
+	(void)fprintf(stderr, "%s: %d file%s failed:\n", progname,
+		bp->b_failed, bp->b_failed == 1 ? "" : "s");
+	for (const failure_t *fp = bp->b_failure_head; fp != NULL;
+		fp = fp->f_next) {
+	    const char *cp = fp->f_messages != NULL ? fp->f_messages :
+		"out of memory\n";
+
+	    /*
+	     * Print each message indented under the file name.
+	     */
+	    (void)fprintf(stderr, "  %s\n", fp->f_input != NULL ?
+		    fp->f_input : "(unknown)");
+	    while (*cp != '\000') {
+		size_t length = strcspn(cp, "\n");
+
+		(void)fprintf(stderr, "    %.*s\n", (int)length, cp);
+		cp += length;
+		if (*cp == '\n') {
+		    ++cp;
+		}
+	    }
+	}
+    }
+}
+
+/*
+ * run_batch: convert files on a pool of worker threads
+ *   @bp: shared state with the source set
+ *   @jobs: number of worker threads
+ *
+ *   Return the exit status: 0 if all files were converted, or 1 if
+ *   any failed.
+ */
+static int run_batch(batch_t *bp, int jobs)
+{
+    worker_t *workers;
+    double start;
+    int started = 0;
+
+    if ((workers = calloc(jobs, sizeof(worker_t))) == NULL) {
+	(void)fprintf(stderr, "%s: calloc: %s\n", progname, strerror(errno));
+	exit(3);
+    }
+    bp->b_failure_tail = &bp->b_failure_head;
+    (void)pthread_mutex_init(&bp->b_mutex, NULL);
+    start = now();
+    for (int i = 0; i < jobs; ++i) {
+	int rv;
+
+	workers[i].w_bp = bp;
+	if ((rv = pthread_create(&workers[i].w_thread, NULL, worker,
+			(void *)&workers[i])) != 0) {
+	    (void)fprintf(stderr, "%s: pthread_create: %s\n", progname,
+		    strerror(rv));
+	    break;
+	}
+	++started;
+    }
+    if (started == 0) {
+	exit(3);
+    }
+    for (int i = 0; i < started; ++i) {
+	(void)pthread_join(workers[i].w_thread, NULL);
+    }
+    report(bp, now() - start, started);
+    (void)pthread_mutex_destroy(&bp->b_mutex);
+    while (bp->b_failure_head != NULL) {
+	failure_t *fp = bp->b_failure_head;
+
+	bp->b_failure_head = fp->f_next;
+	free((void *)fp->f_input);
+	free((void *)fp->f_messages);
+	free((void *)fp);
+    }
+    for (int i = 0; i < jobs; ++i) {
+	free((void *)workers[i].w_messages);
+    }
+    free((void *)workers);
+    return bp->b_failed != 0 ? 1 : 0;
+}
+
 /*
  * main
  */
 int main(int argc, char **argv)
 {
-    vnadata_t *vdp;
+    batch_t batch;
     const char *f_opt = NULL;
+    const char *l_opt = NULL;
+    const char *d_opt = NULL;
+    const char *o_opt = NULL;
+    int jobs = 0;
+    bool v_opt = false;
+    int rc;
 
     if ((char *)NULL == (progname = strrchr(argv[0], '/'))) {
 	progname = argv[0];
@@ -94,47 +670,114 @@ int main(int argc, char **argv)
 	++progname;
     }
     for (;;) {
-	switch (getopt(argc, argv, "f:")) {
+	switch (getopt(argc, argv, "d:f:j:l:o:v")) {
 	case -1:
 	    break;
 
+	case 'd':
+	    d_opt = optarg;
+	    continue;
+
 	case 'f':
 	    f_opt = optarg;
 	    continue;
 
+	case 'j':
+	    {
+		char *end;
+
+		jobs = (int)strtol(optarg, &end, 10);
+		if (end == optarg || *end != '\000' || jobs < 1) {
+		    (void)fprintf(stderr, "%s: -j: expected a positive "
+			    "integer\n", progname);
+		    exit(2);
+		}
+	    }
+	    continue;
+
+	case 'l':
+	    l_opt = optarg;
+	    continue;
+
+	case 'o':
+	    o_opt = optarg;
+	    continue;
+
+	case 'v':
+	    v_opt = true;
+	    continue;
+
 	default:
-	    (void)fprintf(stderr, usage, progname);
-	    exit(2);
+	    print_usage();
 	}
 	break;
     }
     argc -= optind;
     argv += optind;
-    if (argc != 2) {
-	(void)fprintf(stderr, usage, progname);
-	exit(2);
-    }
-    if ((vdp = vnadata_alloc(error_fn, NULL)) == NULL) {
-	exit(3);
-    }
-    if (vnadata_load(vdp, argv[0]) == -1) {
-	exit(4);
+
+    /*
+     * With a single pair and no batch options, convert directly and
+     * stop on the first error.
+     */
+    if (l_opt == NULL && d_opt == NULL && o_opt == NULL && jobs == 0 &&
+	    !v_opt) {
+	if (argc != 2) {
+	    print_usage();
+	}
+	if ((rc = convert(f_opt, error_fn, NULL, argv[0], argv[1])) != 0) {
+	    exit(rc);
+	}
+	exit(0);
     }
+
     /*
-     * Set the filetype back to auto so that saving to a .ts file forces
-     * Touchstone 2 format.
+     * Batch mode.
      */
-    if (vnadata_set_filetype(vdp, VNADATA_FILETYPE_AUTO) == -1) {
-	exit(5);
+    (void)memset((void *)&batch, 0, sizeof(batch));
+    batch.b_format = f_opt;
+    batch.b_verbose = v_opt;
+    if ((l_opt != NULL) + (d_opt != NULL) + (argc != 0) != 1 ||
+	    (d_opt != NULL) != (o_opt != NULL) || argc % 2 != 0) {
+	print_usage();
+    }
+    if (o_opt != NULL && !check_template(o_opt)) {
+	(void)fprintf(stderr, "%s: -o: invalid template: %s\n",
+		progname, o_opt);
+	exit(2);
     }
-    if (f_opt != NULL) {
-	if (vnadata_set_format(vdp, f_opt) == -1) {
-	    exit(6);
+    if (l_opt != NULL) {
+	batch.b_list_name = l_opt;
+	if (strcmp(l_opt, "-") == 0) {
+	    batch.b_list_fp = stdin;
+	} else if ((batch.b_list_fp = fopen(l_opt, "r")) == NULL) {
+	    (void)fprintf(stderr, "%s: fopen: %s: %s\n",
+		    progname, l_opt, strerror(errno));
+	    exit(3);
 	}
+    } else if (d_opt != NULL) {
+	batch.b_directory = d_opt;
+	batch.b_template = o_opt;
+	if ((batch.b_dir = opendir(d_opt)) == NULL) {
+	    (void)fprintf(stderr, "%s: opendir: %s: %s\n",
+		    progname, d_opt, strerror(errno));
+	    exit(3);
+	}
+    } else {
+	batch.b_argv = argv;
+	batch.b_argc = argc;
+    }
+    if (jobs == 0) {
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+	jobs = cpus > 0 ? (int)cpus : 1;
     }
-    if (vnadata_save(vdp, argv[1]) == -1) {
-	exit(7);
+    rc = run_batch(&batch, jobs);
+    if (batch.b_list_fp != NULL && batch.b_list_fp != stdin) {
+	(void)fclose(batch.b_list_fp);
     }
-    vnadata_free(vdp);
-    exit(0);
+    if (batch.b_dir != NULL) {
+	(void)closedir(batch.b_dir);
+    }
+    free((void *)batch.b_line);
+    exit(rc);
 }
@@ -0,0 +1,963 @@
+/*
+ * Vector Network Analyzer Library
+ * Copyright © 2020-2024 D Scott Guthridge <scott_guthridge@rompromity.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "archdep.h"
+
+#include <complex.h>
+#include <errno.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include "libt.h"
+#include "libt_crand.h"
+#include "libt_vnacal.h"
+
+
+/*
+ * Options
+ */
+char *progname;
+static const char options[] = "b:f:o:p:r:s:x:";
+static const char *const usage[] = {
+    "[-b baseline.json] [-f frequencies] [-o output.json] [-p max-ports]",
+    "    [-r repeat] [-s section] [-x threshold]",
+    NULL
+};
+static const char *const help[] = {
+    "-b baseline.json  compare against the output of a previous run",
+    "-f frequencies    number of frequencies in apply and solve (default 20)",
+    "-o output.json    write results to file instead of standard output",
+    "-p max-ports      largest port count for apply (default 16)",
+    "-r repeat         number of times to repeat each measurement (default 5)",
+    "-s section        run only apply, solve, convert, vnadata or vnacal",
+    "-x threshold      report ratios to baseline above 1 + threshold "
+	"(default 0.10)",
+    NULL
+};
+bool opt_a = false;
+int opt_v = 0;
+static const char *opt_b = NULL;
+static int opt_f = 20;
+static const char *opt_o = NULL;
+static int opt_p = 16;
+static int opt_r = 5;
+static const char *opt_s = NULL;
+static double opt_x = 0.10;
+
+/*
+ * Output file and number of records written
+ */
+static FILE *output;
+static int records = 0;
+
+/*
+ * baseline_t: benchmark result from a previous run
+ */
+typedef struct baseline {
+    char *bl_name;
+    double bl_ns;
+} baseline_t;
+static baseline_t *baseline_vector = NULL;
+static int baselines = 0;
+
+/*
+ * Number of regressions found relative to the baseline
+ */
+static int regressions = 0;
+
+/*
+ * bench_fn_t: function that performs one benchmark operation
+ */
+typedef int bench_fn_t(void *arg);
+
+/*
+ * now: return the monotonic time in seconds
+ */
+static double now()
+{
+    struct timespec ts;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + 1.0e-9 * (double)ts.tv_nsec;
+}
+
+/*
+ * fail: report an unexpected library error and exit
+ *   @what: name of the failing function
+ */
+static void fail(const char *what)
+{
+    (void)fprintf(stderr, "%s: %s: %s\n", progname, what, strerror(errno));
+    exit(4);
+}
+
+/*
+ * error_fn: error reporting function
+ *   @message: error message
+ *   @arg: (unused)
+ *   @category: error category (unused)
+ */
+static void error_fn(const char *message, void *arg, vnaerr_category_t category)
+{
+    (void)fprintf(stderr, "%s: %s\n", progname, message);
+}
+
+/*
+ * selected: test if the given section should run
+ *   @section: name of section
+ */
+static bool selected(const char *section)
+{
+    return opt_s == NULL || strcmp(opt_s, section) == 0;
+}
+
+/*
+ * load_baseline: read the results of a previous run
+ *   @filename: JSON file written by this program
+ *
+ *   We recognize only the one-record-per-line form that this program
+ *   writes; other lines are ignored.
+ */
+static void load_baseline(const char *filename)
+{
+    FILE *fp;
+    char line[1024];
+
+    if ((fp = fopen(filename, "r")) == NULL) {
+	fail(filename);
+    }
+    while (fgets(line, sizeof(line), fp) != NULL) {
+	char name[256];
+	double ns;
+	baseline_t *blp;
+
+	if (sscanf(line, " {\"name\": \"%255[^\"]\", \"ns_per_op\": %lf",
+		    name, &ns) != 2) {
+	    continue;
+	}
+	if ((blp = realloc(baseline_vector,
+			(baselines + 1) * sizeof(baseline_t))) == NULL) {
+	    fail("realloc");
+	}
+	baseline_vector = blp;
+	blp = &baseline_vector[baselines];
+	if ((blp->bl_name = strdup(name)) == NULL) {
+	    fail("strdup");
+	}
+	blp->bl_ns = ns;
+	++baselines;
+    }
+    (void)fclose(fp);
+}
+
+/*
+ * find_baseline: return the baseline result for name, or NULL
+ *   @name: benchmark name
+ */
+static const baseline_t *find_baseline(const char *name)
+{
+    for (int i = 0; i < baselines; ++i) {
+	if (strcmp(baseline_vector[i].bl_name, name) == 0) {
+	    return &baseline_vector[i];
+	}
+    }
+    return NULL;
+}
+
+/*
+ * run_bench: time a benchmark and write its record
+ *   @name: benchmark name
+ *   @fn: function performing one operation
+ *   @arg: argument to fn
+ *
+ *   Report the best of opt_r repetitions.
+ */
+static void run_bench(const char *name, bench_fn_t *fn, void *arg)
+{
+    const baseline_t *blp;
+    double best = 1.0e+99;
+    double ns;
+
+    for (int r = 0; r < opt_r; ++r) {
+	double t0;
+
+	t0 = now();
+	if ((*fn)(arg) == -1) {
+	    fail(name);
+	}
+	t0 = now() - t0;
+	if (t0 < best) {
+	    best = t0;
+	}
+    }
+    ns = 1.0e+9 * best;
+    (void)fprintf(output, "%s    {\"name\": \"%s\", \"ns_per_op\": %.1f",
+	    records == 0 ? "" : ",\n", name, ns);
+    if ((blp = find_baseline(name)) != NULL && blp->bl_ns > 0.0) {
+	const double ratio = ns / blp->bl_ns;
+
+	(void)fprintf(output, ", \"baseline_ns_per_op\": %.1f, "
+		"\"ratio\": %.3f", blp->bl_ns, ratio);
+	if (ratio > 1.0 + opt_x) {
+	    (void)fprintf(stderr, "%s: %s: %.3f times slower than baseline\n",
+		    progname, name, ratio);
+	    ++regressions;
+	}
+    }
+    (void)fprintf(output, "}");
+    (void)fflush(output);
+    ++records;
+}
+
+/*
+ * add_calibration: add a calibration made directly from error terms
+ *   @vcp: pointer returned from vnacal_create
+ *   @ttp: generated error terms
+ *
+ *   Building the calibration from the generated terms instead of
+ *   solving for them keeps setup time for large port counts low.
+ *   Return the calibration index.
+ */
+static int add_calibration(vnacal_t *vcp, const libt_vnacal_terms_t *ttp)
+{
+    const vnacal_layout_t *vlp = &ttp->tt_layout;
+    const int error_terms = VL_ERROR_TERMS(vlp);
+    vnacal_calibration_t *calp;
+    int ci;
+
+    if ((calp = _vnacal_calibration_alloc(vcp, VL_TYPE(vlp),
+		    VL_M_ROWS(vlp), VL_M_COLUMNS(vlp), ttp->tt_frequencies,
+		    VNACAL_Z0_SCALAR, error_terms)) == NULL) {
+	fail("_vnacal_calibration_alloc");
+    }
+    (void)memcpy((void *)calp->cal_frequency_vector,
+	    (void *)ttp->tt_frequency_vector,
+	    ttp->tt_frequencies * sizeof(double));
+    calp->cal_z0 = ttp->tt_z0_vector[0];
+    for (int findex = 0; findex < ttp->tt_frequencies; ++findex) {
+	for (int term = 0; term < error_terms; ++term) {
+	    calp->cal_error_term_vector[term][findex] =
+		ttp->tt_error_term_vector[findex][term];
+	}
+    }
+    if ((ci = _vnacal_add_calibration_common(__func__, vcp, calp,
+		    "bench")) == -1) {
+	_vnacal_calibration_free(calp);
+	fail("_vnacal_add_calibration_common");
+    }
+    return ci;
+}
+
+/*
+ * measure_random_dut: simulate measurement of a random device
+ *   @ttp: generated error terms
+ *   @tmp: measurements to fill in
+ *   @ports: number of ports
+ */
+static void measure_random_dut(const libt_vnacal_terms_t *ttp,
+	libt_vnacal_measurements_t *tmp, int ports)
+{
+    vnacal_t *vcp = ttp->tt_vnp->vn_vcp;
+    int s[ports * ports];
+
+    if (libt_vnacal_generate_random_parameters(vcp, s, ports * ports) == -1) {
+	fail("libt_vnacal_generate_random_parameters");
+    }
+    if (libt_vnacal_calculate_measurements(ttp, tmp, s, ports, ports,
+		NULL) == -1) {
+	fail("libt_vnacal_calculate_measurements");
+    }
+    for (int i = 0; i < ports * ports; ++i) {
+	(void)vnacal_delete_parameter(vcp, s[i]);
+    }
+}
+
+/*
+ * apply_arg_t: argument to apply_fn
+ */
+typedef struct apply_arg {
+    vnacal_t *aa_vcp;
+    int aa_ci;
+    const libt_vnacal_terms_t *aa_ttp;
+    const libt_vnacal_measurements_t *aa_tmp;
+    int aa_ports;
+    vnadata_t *aa_vdp;
+} apply_arg_t;
+
+/*
+ * apply_fn: apply the calibration to the measurements
+ *   @arg: pointer to apply_arg_t
+ */
+static int apply_fn(void *arg)
+{
+    apply_arg_t *aap = arg;
+
+    return vnacal_apply_m(aap->aa_vcp, aap->aa_ci,
+	    aap->aa_ttp->tt_frequency_vector, aap->aa_ttp->tt_frequencies,
+	    aap->aa_tmp->tm_b_matrix, aap->aa_ports, aap->aa_ports,
+	    aap->aa_vdp);
+}
+
+/*
+ * bench_apply: benchmark vnacal_apply_m for every type and port count
+ */
+static void bench_apply()
+{
+    static const vnacal_type_t type_vector[] = {
+	VNACAL_T8, VNACAL_U8, VNACAL_TE10, VNACAL_UE10, VNACAL_T16, VNACAL_U16,
+	VNACAL_UE14, VNACAL_E12
+    };
+
+    for (int ti = 0; ti < sizeof(type_vector) / sizeof(type_vector[0]);
+	    ++ti) {
+	const vnacal_type_t type = type_vector[ti];
+
+	for (int ports = 1; ports <= opt_p; ++ports) {
+	    libt_vnacal_terms_t *ttp;
+	    libt_vnacal_measurements_t *tmp;
+	    apply_arg_t aa;
+	    char name[64];
+
+	    (void)memset((void *)&aa, 0, sizeof(aa));
+	    if ((aa.aa_vcp = vnacal_create(error_fn, NULL)) == NULL) {
+		fail("vnacal_create");
+	    }
+	    if ((ttp = libt_vnacal_generate_error_terms(aa.aa_vcp, type,
+			    ports, ports, opt_f, NULL, 0)) == NULL) {
+		fail("libt_vnacal_generate_error_terms");
+	    }
+	    if ((tmp = libt_vnacal_alloc_measurements(type, ports, ports,
+			    opt_f, false)) == NULL) {
+		fail("libt_vnacal_alloc_measurements");
+	    }
+	    measure_random_dut(ttp, tmp, ports);
+	    if ((aa.aa_vdp = vnadata_alloc(error_fn, NULL)) == NULL) {
+		fail("vnadata_alloc");
+	    }
+	    aa.aa_ci = add_calibration(aa.aa_vcp, ttp);
+	    aa.aa_ttp = ttp;
+	    aa.aa_tmp = tmp;
+	    aa.aa_ports = ports;
+	    (void)snprintf(name, sizeof(name), "apply/%s/%dx%d",
+		    vnacal_type_to_name(type), ports, ports);
+	    run_bench(name, apply_fn, &aa);
+	    vnadata_free(aa.aa_vdp);
+	    libt_vnacal_free_measurements(tmp);
+	    libt_vnacal_free_error_terms(ttp);
+	    vnacal_free(aa.aa_vcp);
+	}
+    }
+}
+
+/*
+ * solve_fn: solve for the error terms
+ *   @arg: pointer to vnacal_new_t
+ */
+static int solve_fn(void *arg)
+{
+    return vnacal_new_solve((vnacal_new_t *)arg);
+}
+
+/*
+ * make_vector_parameter: make a parameter that turns in phase with f
+ *   @ttp: generated error terms
+ *   @magnitude: magnitude of the parameter
+ *   @phase0: phase in degrees at the first frequency
+ *   @phase1: phase in degrees at the last frequency
+ */
+static int make_vector_parameter(const libt_vnacal_terms_t *ttp,
+	double magnitude, double phase0, double phase1)
+{
+    const int frequencies = ttp->tt_frequencies;
+    double complex value_vector[frequencies];
+    int parameter;
+
+    for (int findex = 0; findex < frequencies; ++findex) {
+	double phase = phase0;
+
+	if (frequencies > 1) {
+	    phase += (phase1 - phase0) * findex / (frequencies - 1);
+	}
+	value_vector[findex] = magnitude * cexp(I * M_PI / 180.0 * phase);
+    }
+    if ((parameter = vnacal_make_vector_parameter(ttp->tt_vnp->vn_vcp,
+		    ttp->tt_frequency_vector, frequencies,
+		    value_vector)) == -1) {
+	fail("vnacal_make_vector_parameter");
+    }
+    return parameter;
+}
+
+/*
+ * add_solt_standards: add short, open, load and through standards
+ *   @ttp: generated error terms
+ *   @tmp: measurement matrices
+ *   @all_ports: add short, open and load on both ports
+ */
+static void add_solt_standards(const libt_vnacal_terms_t *ttp,
+	libt_vnacal_measurements_t *tmp, bool all_ports)
+{
+    static const int reflect_vector[] = {
+	VNACAL_SHORT, VNACAL_OPEN, VNACAL_MATCH
+    };
+
+    for (int port = 1; port <= (all_ports ? 2 : 1); ++port) {
+	for (int i = 0; i < 3; ++i) {
+	    if (libt_vnacal_add_single_reflect(ttp, tmp, reflect_vector[i],
+			port) == -1) {
+		fail("libt_vnacal_add_single_reflect");
+	    }
+	}
+    }
+}
+
+/*
+ * add_trl_standards: add through, unknown reflect and unknown line
+ *   @ttp: generated error terms
+ *   @tmp: measurement matrices
+ */
+static void add_trl_standards(const libt_vnacal_terms_t *ttp,
+	libt_vnacal_measurements_t *tmp)
+{
+    vnacal_t *vcp = ttp->tt_vnp->vn_vcp;
+    int r_actual, l_actual, l_guess, r_unknown, l_unknown;
+    int s[2][2];
+
+    if (libt_vnacal_add_through(ttp, tmp, 1, 2) == -1) {
+	fail("libt_vnacal_add_through");
+    }
+    if ((r_actual = vnacal_make_scalar_parameter(vcp,
+		    -0.95 + 0.05 * I)) == -1) {
+	fail("vnacal_make_scalar_parameter");
+    }
+    if ((r_unknown = vnacal_make_unknown_parameter(vcp,
+		    VNACAL_SHORT)) == -1) {
+	fail("vnacal_make_unknown_parameter");
+    }
+    s[0][0] = r_actual;
+    s[0][1] = VNACAL_ZERO;
+    s[1][0] = VNACAL_ZERO;
+    s[1][1] = r_actual;
+    if (libt_vnacal_calculate_measurements(ttp, tmp, &s[0][0], 2, 2,
+		NULL) == -1) {
+	fail("libt_vnacal_calculate_measurements");
+    }
+    if (vnacal_new_add_double_reflect_m(ttp->tt_vnp, tmp->tm_b_matrix, 2, 2,
+		r_unknown, r_unknown, 1, 2) == -1) {
+	fail("vnacal_new_add_double_reflect_m");
+    }
+
+    /*
+     * Keep the line between 30 and 150 degrees so that it stays
+     * distinguishable from the through.
+     */
+    l_actual = make_vector_parameter(ttp, 0.9, -30.0, -150.0);
+    l_guess  = make_vector_parameter(ttp, 1.0, -35.0, -145.0);
+    if ((l_unknown = vnacal_make_unknown_parameter(vcp, l_guess)) == -1) {
+	fail("vnacal_make_unknown_parameter");
+    }
+    s[0][0] = VNACAL_MATCH;
+    s[0][1] = l_actual;
+    s[1][0] = l_actual;
+    s[1][1] = VNACAL_MATCH;
+    if (libt_vnacal_calculate_measurements(ttp, tmp, &s[0][0], 2, 2,
+		NULL) == -1) {
+	fail("libt_vnacal_calculate_measurements");
+    }
+    s[0][1] = l_unknown;
+    s[1][0] = l_unknown;
+    if (vnacal_new_add_line_m(ttp->tt_vnp, tmp->tm_b_matrix, 2, 2,
+		&s[0][0], 1, 2) == -1) {
+	fail("vnacal_new_add_line_m");
+    }
+    (void)vnacal_delete_parameter(vcp, l_guess);
+    (void)vnacal_delete_parameter(vcp, l_actual);
+    (void)vnacal_delete_parameter(vcp, r_actual);
+}
+
+/*
+ * add_unknown_through_standards: add SOL on each port and a through
+ *	with unknown transmission
+ *   @ttp: generated error terms
+ *   @tmp: measurement matrices
+ */
+static void add_unknown_through_standards(const libt_vnacal_terms_t *ttp,
+	libt_vnacal_measurements_t *tmp)
+{
+    vnacal_t *vcp = ttp->tt_vnp->vn_vcp;
+    int t_actual, t_guess, t_unknown;
+    int s[2][2];
+
+    add_solt_standards(ttp, tmp, /*all_ports*/true);
+    t_actual = make_vector_parameter(ttp, 0.8, -10.0, -170.0);
+    t_guess  = make_vector_parameter(ttp, 1.0, -15.0, -165.0);
+    if ((t_unknown = vnacal_make_unknown_parameter(vcp, t_guess)) == -1) {
+	fail("vnacal_make_unknown_parameter");
+    }
+    s[0][0] = VNACAL_MATCH;
+    s[0][1] = t_actual;
+    s[1][0] = t_actual;
+    s[1][1] = VNACAL_MATCH;
+    if (libt_vnacal_calculate_measurements(ttp, tmp, &s[0][0], 2, 2,
+		NULL) == -1) {
+	fail("libt_vnacal_calculate_measurements");
+    }
+    s[0][1] = t_unknown;
+    s[1][0] = t_unknown;
+    if (vnacal_new_add_line_m(ttp->tt_vnp, tmp->tm_b_matrix, 2, 2,
+		&s[0][0], 1, 2) == -1) {
+	fail("vnacal_new_add_line_m");
+    }
+    (void)vnacal_delete_parameter(vcp, t_guess);
+    (void)vnacal_delete_parameter(vcp, t_actual);
+}
+
+/*
+ * bench_solve_case: benchmark one vnacal_new_solve case
+ *   @method: calibration method
+ *   @type: error term type
+ *   @ports: number of ports
+ */
+static void bench_solve_case(const char *method, vnacal_type_t type,
+	int ports)
+{
+    vnacal_t *vcp;
+    libt_vnacal_terms_t *ttp = NULL;
+    libt_vnacal_measurements_t *tmp = NULL;
+    char name[64];
+
+    if ((vcp = vnacal_create(error_fn, NULL)) == NULL) {
+	fail("vnacal_create");
+    }
+    if (strcmp(method, "random") == 0) {
+	if ((ttp = libt_vnacal_make_random_calibration(vcp, type,
+			ports, ports, opt_f, false)) == NULL) {
+	    fail("libt_vnacal_make_random_calibration");
+	}
+    } else {
+	if ((ttp = libt_vnacal_generate_error_terms(vcp, type, ports, ports,
+			opt_f, NULL, 0)) == NULL) {
+	    fail("libt_vnacal_generate_error_terms");
+	}
+	if ((tmp = libt_vnacal_alloc_measurements(type, ports, ports,
+			opt_f, false)) == NULL) {
+	    fail("libt_vnacal_alloc_measurements");
+	}
+	if (strcmp(method, "SOLT") == 0) {
+	    add_solt_standards(ttp, tmp, type == VNACAL_E12);
+	    if (libt_vnacal_add_through(ttp, tmp, 1, 2) == -1) {
+		fail("libt_vnacal_add_through");
+	    }
+	} else if (strcmp(method, "TRL") == 0) {
+	    add_trl_standards(ttp, tmp);
+	} else {
+	    add_unknown_through_standards(ttp, tmp);
+	}
+    }
+    (void)snprintf(name, sizeof(name), "solve/%s/%s/%dx%d",
+	    method, vnacal_type_to_name(type), ports, ports);
+    run_bench(name, solve_fn, ttp->tt_vnp);
+
+    /*
+     * A benchmark of wrong answers is worthless: check the result.
+     */
+    if (libt_vnacal_validate_calibration(ttp, NULL) == -1) {
+	(void)fprintf(stderr, "%s: %s: wrong error terms\n", progname, name);
+	exit(4);
+    }
+    libt_vnacal_free_measurements(tmp);
+    libt_vnacal_free_error_terms(ttp);
+    vnacal_free(vcp);
+}
+
+/*
+ * bench_solve: benchmark vnacal_new_solve
+ */
+static void bench_solve()
+{
+    bench_solve_case("SOLT", VNACAL_T8, 2);
+    bench_solve_case("SOLT", VNACAL_E12, 2);
+    bench_solve_case("TRL", VNACAL_T8, 2);
+    bench_solve_case("unknown-through", VNACAL_T8, 2);
+    bench_solve_case("random", VNACAL_T16, 2);
+    bench_solve_case("random", VNACAL_T16, 3);
+}
+
+/*
+ * make_s_parameters: make random passive-looking 2x2 S parameters
+ *   @frequencies: number of frequencies
+ */
+static vnadata_t *make_s_parameters(int frequencies)
+{
+    vnadata_t *vdp;
+
+    if ((vdp = vnadata_alloc_and_init(error_fn, NULL, VPT_S, 2, 2,
+		    frequencies)) == NULL) {
+	fail("vnadata_alloc_and_init");
+    }
+    for (int findex = 0; findex < frequencies; ++findex) {
+	(void)vnadata_set_frequency(vdp, findex,
+		1.0e+6 + 1.0e+9 * findex / frequencies);
+	for (int row = 0; row < 2; ++row) {
+	    for (int column = 0; column < 2; ++column) {
+		(void)vnadata_set_cell(vdp, findex, row, column,
+			0.3 * libt_crandn());
+	    }
+	}
+    }
+    return vdp;
+}
+
+/*
+ * convert_arg_t: argument to convert_fn
+ */
+typedef struct convert_arg {
+    const vnadata_t *ca_in;
+    vnadata_t *ca_out;
+    vnadata_parameter_type_t ca_type;
+} convert_arg_t;
+
+/*
+ * convert_fn: convert between parameter types
+ *   @arg: pointer to convert_arg_t
+ */
+static int convert_fn(void *arg)
+{
+    convert_arg_t *cap = arg;
+
+    return vnadata_convert(cap->ca_in, cap->ca_out, cap->ca_type);
+}
+
+/*
+ * bench_convert: benchmark vnadata_convert for all pairs of types
+ */
+static void bench_convert()
+{
+    const int frequencies = 1000;
+    vnadata_t *s_vdp;
+    vnadata_t *in_vector[VPT_NTYPES];
+    convert_arg_t ca;
+
+    (void)memset((void *)in_vector, 0, sizeof(in_vector));
+    (void)memset((void *)&ca, 0, sizeof(ca));
+    s_vdp = make_s_parameters(frequencies);
+    if ((ca.ca_out = vnadata_alloc(error_fn, NULL)) == NULL) {
+	fail("vnadata_alloc");
+    }
+
+    /*
+     * Make the input for each type by converting from S.  Zin cannot
+     * be converted back to other types, so it's only an output.
+     */
+    for (int in = VPT_S; in < VPT_ZIN; ++in) {
+	if ((in_vector[in] = vnadata_alloc(error_fn, NULL)) == NULL) {
+	    fail("vnadata_alloc");
+	}
+	if (vnadata_convert(s_vdp, in_vector[in], in) == -1) {
+	    fail("vnadata_convert");
+	}
+    }
+    for (int in = VPT_S; in < VPT_ZIN; ++in) {
+	for (int out = VPT_S; out < VPT_NTYPES; ++out) {
+	    char name[64];
+
+	    ca.ca_in = in_vector[in];
+	    ca.ca_type = out;
+	    (void)snprintf(name, sizeof(name), "convert/%s-%s/2x2/%d",
+		    vnadata_get_type_name(in), vnadata_get_type_name(out),
+		    frequencies);
+	    run_bench(name, convert_fn, &ca);
+	}
+    }
+    for (int in = VPT_S; in < VPT_ZIN; ++in) {
+	vnadata_free(in_vector[in]);
+    }
+    vnadata_free(ca.ca_out);
+    vnadata_free(s_vdp);
+}
+
+/*
+ * vnadata_io_arg_t: argument to vnadata_save_fn and vnadata_load_fn
+ */
+typedef struct vnadata_io_arg {
+    vnadata_t *via_vdp;
+    const char *via_filename;
+} vnadata_io_arg_t;
+
+/*
+ * vnadata_save_fn: save network parameter data
+ *   @arg: pointer to vnadata_io_arg_t
+ */
+static int vnadata_save_fn(void *arg)
+{
+    vnadata_io_arg_t *viap = arg;
+
+    return vnadata_save(viap->via_vdp, viap->via_filename);
+}
+
+/*
+ * vnadata_load_fn: load network parameter data
+ *   @arg: pointer to vnadata_io_arg_t
+ */
+static int vnadata_load_fn(void *arg)
+{
+    vnadata_io_arg_t *viap = arg;
+
+    return vnadata_load(viap->via_vdp, viap->via_filename);
+}
+
+/*
+ * bench_vnadata: benchmark Touchstone and NPD load and save
+ */
+static void bench_vnadata()
+{
+    static const char *const filename_vector[] = {
+	"bench-suite.s2p", "bench-suite.ts", "bench-suite.npd"
+    };
+    static const int size_vector[] = { 100, 1000, 10000 };
+
+    for (int si = 0; si < sizeof(size_vector) / sizeof(size_vector[0]);
+	    ++si) {
+	const int frequencies = size_vector[si];
+	vnadata_t *vdp = make_s_parameters(frequencies);
+	vnadata_t *load_vdp;
+
+	if ((load_vdp = vnadata_alloc(error_fn, NULL)) == NULL) {
+	    fail("vnadata_alloc");
+	}
+	for (int fi = 0;
+		fi < sizeof(filename_vector) / sizeof(filename_vector[0]);
+		++fi) {
+	    const char *filename = filename_vector[fi];
+	    const char *suffix = strrchr(filename, '.') + 1;
+	    vnadata_io_arg_t via;
+	    char name[64];
+
+	    via.via_vdp = vdp;
+	    via.via_filename = filename;
+	    (void)snprintf(name, sizeof(name), "vnadata/save/%s/%d",
+		    suffix, frequencies);
+	    run_bench(name, vnadata_save_fn, &via);
+	    via.via_vdp = load_vdp;
+	    (void)snprintf(name, sizeof(name), "vnadata/load/%s/%d",
+		    suffix, frequencies);
+	    run_bench(name, vnadata_load_fn, &via);
+	    (void)unlink(filename);
+	}
+	vnadata_free(load_vdp);
+	vnadata_free(vdp);
+    }
+}
+
+/*
+ * vnacal_io_arg_t: argument to vnacal_save_fn and vnacal_load_fn
+ */
+typedef struct vnacal_io_arg {
+    vnacal_t *via_vcp;
+    const char *via_filename;
+} vnacal_io_arg_t;
+
+/*
+ * vnacal_save_fn: save a calibration file
+ *   @arg: pointer to vnacal_io_arg_t
+ */
+static int vnacal_save_fn(void *arg)
+{
+    vnacal_io_arg_t *viap = arg;
+
+    return vnacal_save(viap->via_vcp, viap->via_filename);
+}
+
+/*
+ * vnacal_load_fn: load a calibration file
+ *   @arg: pointer to vnacal_io_arg_t
+ */
+static int vnacal_load_fn(void *arg)
+{
+    vnacal_io_arg_t *viap = arg;
+    vnacal_t *vcp;
+
+    if ((vcp = vnacal_load(viap->via_filename, error_fn, NULL)) == NULL) {
+	return -1;
+    }
+    vnacal_free(vcp);
+    return 0;
+}
+
+/*
+ * bench_vnacal: benchmark .vnacal and .vnacalb load and save
+ */
+static void bench_vnacal()
+{
+    static const char *const filename_vector[] = {
+	"bench-suite.vnacal", "bench-suite.vnacalb"
+    };
+    static const int size_vector[] = { 100, 1000 };
+
+    for (int si = 0; si < sizeof(size_vector) / sizeof(size_vector[0]);
+	    ++si) {
+	const int frequencies = size_vector[si];
+	libt_vnacal_terms_t *ttp;
+	vnacal_io_arg_t via;
+
+	if ((via.via_vcp = vnacal_create(error_fn, NULL)) == NULL) {
+	    fail("vnacal_create");
+	}
+	if ((ttp = libt_vnacal_generate_error_terms(via.via_vcp, VNACAL_E12,
+			4, 4, frequencies, NULL, 0)) == NULL) {
+	    fail("libt_vnacal_generate_error_terms");
+	}
+	(void)add_calibration(via.via_vcp, ttp);
+	for (int fi = 0;
+		fi < sizeof(filename_vector) / sizeof(filename_vector[0]);
+		++fi) {
+	    const char *filename = filename_vector[fi];
+	    const char *suffix = strrchr(filename, '.') + 1;
+	    char name[64];
+
+	    via.via_filename = filename;
+	    (void)snprintf(name, sizeof(name), "vnacal/save/%s/E12/4x4/%d",
+		    suffix, frequencies);
+	    run_bench(name, vnacal_save_fn, &via);
+	    (void)snprintf(name, sizeof(name), "vnacal/load/%s/E12/4x4/%d",
+		    suffix, frequencies);
+	    run_bench(name, vnacal_load_fn, &via);
+	    (void)unlink(filename);
+	}
+	libt_vnacal_free_error_terms(ttp);
+	vnacal_free(via.via_vcp);
+    }
+}
+
+/*
+ * print_usage: print a usage message and exit
+ */
+static void print_usage()
+{
+    const char *const *cpp;
+
+    for (cpp = usage; *cpp != NULL; ++cpp) {
+	(void)fprintf(stderr, "%s: usage %s\n", progname, *cpp);
+    }
+    for (cpp = help; *cpp != NULL; ++cpp) {
+	(void)fprintf(stderr, "%s\n", *cpp);
+    }
+    exit(2);
+}
+
+/*
+ * main: benchmark program
+ */
+int
+main(int argc, char **argv)
+{
+    if ((char *)NULL == (progname = strrchr(argv[0], '/'))) {
+	progname = argv[0];
+    } else {
+	++progname;
+    }
+    for (;;) {
+	switch (getopt(argc, argv, options)) {
+	case 'b':
+	    opt_b = optarg;
+	    continue;
+
+	case 'f':
+	    opt_f = atoi(optarg);
+	    continue;
+
+	case 'o':
+	    opt_o = optarg;
+	    continue;
+
+	case 'p':
+	    opt_p = atoi(optarg);
+	    continue;
+
+	case 'r':
+	    opt_r = atoi(optarg);
+	    continue;
+
+	case 's':
+	    opt_s = optarg;
+	    continue;
+
+	case 'x':
+	    opt_x = atof(optarg);
+	    continue;
+
+	case -1:
+	    break;
+
+	default:
+	    print_usage();
+	}
+	break;
+    }
+    argc -= optind;
+    argv += optind;
+    if (argc != 0 || opt_f < 2 || opt_p < 1 || opt_r < 1 ||
+	    !(opt_x >= 0.0)) {
+	print_usage();
+    }
+    if (opt_s != NULL && strcmp(opt_s, "apply") != 0 &&
+	    strcmp(opt_s, "solve") != 0 && strcmp(opt_s, "convert") != 0 &&
+	    strcmp(opt_s, "vnadata") != 0 && strcmp(opt_s, "vnacal") != 0) {
+	print_usage();
+    }
+    libt_isequal_init();
+    if (opt_b != NULL) {
+	load_baseline(opt_b);
+    }
+    output = stdout;
+    if (opt_o != NULL && (output = fopen(opt_o, "w")) == NULL) {
+	fail(opt_o);
+    }
+    (void)fprintf(output, "{\n  \"frequencies\": %d,\n  \"repeat\": %d,\n"
+	    "  \"benchmarks\": [\n", opt_f, opt_r);
+    if (selected("apply")) {
+	bench_apply();
+    }
+    if (selected("solve")) {
+	bench_solve();
+    }
+    if (selected("convert")) {
+	bench_convert();
+    }
+    if (selected("vnadata")) {
+	bench_vnadata();
+    }
+    if (selected("vnacal")) {
+	bench_vnacal();
+    }
+    (void)fprintf(output, "\n  ]\n}\n");
+    if (output != stdout && fclose(output) != 0) {
+	fail(opt_o);
+    }
+    for (int i = 0; i < baselines; ++i) {
+	free((void *)baseline_vector[i].bl_name);
+    }
+    free((void *)baseline_vector);
+    exit(regressions == 0 ? 0 : 1);
+}
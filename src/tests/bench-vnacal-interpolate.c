@@ -0,0 +1,311 @@
+/*
+ * Vector Network Analyzer Library
+ * Copyright © 2020-2024 D Scott Guthridge <scott_guthridge@rompromity.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "archdep.h"
+
+#include <complex.h>
+#include <errno.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include "vnacal_internal.h"
+
+/*
+ * Options
+ */
+char *progname;
+static const char options[] = "n:p:r:t:";
+static const char *const usage[] = {
+    "[-n frequencies] [-p points] [-r repeat] [-t tolerance]",
+    NULL
+};
+static const char *const help[] = {
+    "-n frequencies  number of calibration frequencies (default 51)",
+    "-p points       number of interpolated points (default 10000)",
+    "-r repeat       number of times to repeat each measurement (default 20)",
+    "-t tolerance    fit tolerance of the compact model (default 1e-6)",
+    NULL
+};
+static int opt_n = 51;
+static int opt_p = 10000;
+static int opt_r = 20;
+static double opt_t = 1.0e-6;
+
+/*
+ * Frequency range of the synthetic error term
+ */
+#define F_MIN	1.0e+6
+#define F_MAX	1.0e+9
+
+/*
+ * now: return the monotonic time in seconds
+ */
+static double now()
+{
+    struct timespec ts;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + 1.0e-9 * (double)ts.tv_nsec;
+}
+
+/*
+ * fail: report an unexpected library error and exit
+ *   @what: name of the failing function
+ */
+static void fail(const char *what)
+{
+    (void)fprintf(stderr, "%s: %s: %s\n", progname, what, strerror(errno));
+    exit(4);
+}
+
+/*
+ * error_term: smooth function resembling a directivity error term
+ *   @f: frequency
+ *
+ *   A slowly varying magnitude with about three turns of phase
+ *   over the frequency range, like a short length of line.
+ */
+static double complex error_term(double f)
+{
+    const double u = (f - F_MIN) / (F_MAX - F_MIN);
+
+    return (0.05 + 0.02 * cos(3.0 * u)) * cexp(-2.0 * M_PI * I * 3.0 * u);
+}
+
+/*
+ * bench_method: measure speed and accuracy of one method
+ *   @method: interpolation method
+ *   @xp: vector of calibration frequencies
+ *   @yp: error term at each calibration frequency
+ *   @x_vector: vector of opt_p target frequencies
+ *   @result: caller-allocated vector of opt_p results
+ */
+static void bench_method(vnacal_interpolation_t method, const double *xp,
+	double complex *yp, const double *x_vector, double complex *result)
+{
+    vnamem_allocator_t allocator;
+    vnacal_spline_t **spline_vector = NULL;
+    const vnacal_spline_t *sp = NULL;
+    vnacal_interp_plan_t *planp;
+    double best_setup = 1.0e+99, best_apply = 1.0e+99;
+    double max_error = 0.0;
+
+    vnamem_get_allocator(&allocator);
+    if (method == VNACAL_INTERP_SPLINE) {
+	if ((spline_vector = _vnacal_spline_alloc_vector(&allocator,
+			xp, opt_n, &yp, 1)) == NULL) {
+	    fail("_vnacal_spline_alloc_vector");
+	}
+	sp = spline_vector[0];
+    }
+    for (int r = 0; r < opt_r; ++r) {
+	double t0;
+
+	t0 = now();
+	if ((planp = _vnacal_interp_plan_alloc(method, xp, opt_n,
+			x_vector, opt_p)) == NULL) {
+	    fail("_vnacal_interp_plan_alloc");
+	}
+	t0 = now() - t0;
+	if (t0 < best_setup) {
+	    best_setup = t0;
+	}
+	t0 = now();
+	_vnacal_interp_plan_apply(planp, yp, sp, result);
+	t0 = now() - t0;
+	if (t0 < best_apply) {
+	    best_apply = t0;
+	}
+	_vnacal_interp_plan_free(planp);
+    }
+    for (int i = 0; i < opt_p; ++i) {
+	double error = cabs(result[i] - error_term(x_vector[i]));
+
+	if (error > max_error) {
+	    max_error = error;
+	}
+    }
+    (void)printf("%-10s %8d pts %8.1f ns/setup %8.1f ns/eval "
+	    "%10.3e max error\n",
+	    vnacal_interpolation_to_name(method), opt_p,
+	    1.0e+9 * best_setup / (double)opt_p,
+	    1.0e+9 * best_apply / (double)opt_p, max_error);
+    _vnacal_spline_free_vector(&allocator, spline_vector, 1);
+}
+
+/*
+ * bench_model: measure speed and accuracy of the compact model
+ *   @xp: vector of calibration frequencies
+ *   @yp: error term at each calibration frequency
+ *   @x_vector: vector of opt_p target frequencies
+ *   @result: caller-allocated vector of opt_p results
+ */
+static void bench_model(const double *xp, const double complex *yp,
+	const double *x_vector, double complex *result)
+{
+    vnamem_allocator_t allocator;
+    vnacal_model_t model;
+    double best_fit = 1.0e+99, best_eval = 1.0e+99;
+    double max_error = 0.0;
+
+    vnamem_get_allocator(&allocator);
+    for (int r = 0; r < opt_r; ++r) {
+	int segment = 0;
+	double t0;
+
+	t0 = now();
+	if (_vnacal_model_fit(&allocator, xp, yp, opt_n, opt_t,
+		    &model) == -1) {
+	    fail("_vnacal_model_fit");
+	}
+	t0 = now() - t0;
+	if (t0 < best_fit) {
+	    best_fit = t0;
+	}
+	t0 = now();
+	for (int i = 0; i < opt_p; ++i) {
+	    result[i] = _vnacal_model_eval(&model, x_vector[i], &segment);
+	}
+	t0 = now() - t0;
+	if (t0 < best_eval) {
+	    best_eval = t0;
+	}
+	if (r < opt_r - 1) {
+	    _vnamem_afree(&allocator, (void *)model.vm_coefficient_vector);
+	    _vnamem_afree(&allocator, (void *)model.vm_breakpoint_vector);
+	}
+    }
+    for (int i = 0; i < opt_p; ++i) {
+	double error = cabs(result[i] - error_term(x_vector[i]));
+
+	if (error > max_error) {
+	    max_error = error;
+	}
+    }
+    (void)printf("%-10s %8d pts %8.1f ns/setup %8.1f ns/eval "
+	    "%10.3e max error\n", "compact", opt_p, 0.0,
+	    1.0e+9 * best_eval / (double)opt_p, max_error);
+    (void)printf("%-10s %8d segments %8.1f us/fit %10.3e fit error\n",
+	    "", model.vm_segments, 1.0e+6 * best_fit, model.vm_fit_error);
+    _vnamem_afree(&allocator, (void *)model.vm_coefficient_vector);
+    _vnamem_afree(&allocator, (void *)model.vm_breakpoint_vector);
+}
+
+/*
+ * print_usage: print a usage message and exit
+ */
+static void print_usage()
+{
+    const char *const *cpp;
+
+    for (cpp = usage; *cpp != NULL; ++cpp) {
+	(void)fprintf(stderr, "%s: usage %s\n", progname, *cpp);
+    }
+    for (cpp = help; *cpp != NULL; ++cpp) {
+	(void)fprintf(stderr, "%s\n", *cpp);
+    }
+    exit(2);
+}
+
+/*
+ * main: benchmark program
+ */
+int
+main(int argc, char **argv)
+{
+    static const vnacal_interpolation_t method_vector[] = {
+	VNACAL_INTERP_RATIONAL,
+	VNACAL_INTERP_LINEAR,
+	VNACAL_INTERP_POLAR,
+	VNACAL_INTERP_SPLINE
+    };
+    double *xp, *x_vector;
+    double complex *yp, *result;
+
+    if ((char *)NULL == (progname = strrchr(argv[0], '/'))) {
+	progname = argv[0];
+    } else {
+	++progname;
+    }
+    for (;;) {
+	switch (getopt(argc, argv, options)) {
+	case 'n':
+	    opt_n = atoi(optarg);
+	    continue;
+
+	case 'p':
+	    opt_p = atoi(optarg);
+	    continue;
+
+	case 'r':
+	    opt_r = atoi(optarg);
+	    continue;
+
+	case 't':
+	    opt_t = atof(optarg);
+	    continue;
+
+	case -1:
+	    break;
+
+	default:
+	    print_usage();
+	}
+	break;
+    }
+    argc -= optind;
+    argv += optind;
+    if (argc != 0 || opt_n < 3 || opt_p < 1 || opt_r < 1 ||
+	    !(opt_t > 0.0)) {
+	print_usage();
+    }
+
+    /*
+     * Sample the error term on a linear calibration grid and
+     * interpolate onto a finer grid covering the same range.
+     */
+    if ((xp = calloc(opt_n, sizeof(double))) == NULL ||
+	    (yp = calloc(opt_n, sizeof(double complex))) == NULL ||
+	    (x_vector = calloc(opt_p, sizeof(double))) == NULL ||
+	    (result = calloc(opt_p, sizeof(double complex))) == NULL) {
+	fail("calloc");
+    }
+    for (int i = 0; i < opt_n; ++i) {
+	xp[i] = F_MIN + (F_MAX - F_MIN) * i / (opt_n - 1);
+	yp[i] = error_term(xp[i]);
+    }
+    for (int i = 0; i < opt_p; ++i) {
+	x_vector[i] = F_MIN + (F_MAX - F_MIN) * (i + 0.5) / opt_p;
+    }
+    for (int i = 0; i < sizeof(method_vector) / sizeof(method_vector[0]);
+	    ++i) {
+	bench_method(method_vector[i], xp, yp, x_vector, result);
+    }
+    bench_model(xp, yp, x_vector, result);
+    free((void *)result);
+    free((void *)x_vector);
+    free((void *)yp);
+    free((void *)xp);
+    exit(0);
+}
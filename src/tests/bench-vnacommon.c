@@ -0,0 +1,524 @@
+/*
+ * Vector Network Analyzer Library
+ * Copyright © 2020-2024 D Scott Guthridge <scott_guthridge@rompromity.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "archdep.h"
+
+#include <complex.h>
+#include <errno.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include "vnacommon_internal.h"
+
+/*
+ * Options
+ */
+char *progname;
+static const char options[] = "k:n:r:";
+static const char *const usage[] = {
+    "[-k kernel] [-n max-dimension] [-r repeat]",
+    NULL
+};
+static const char *const help[] = {
+    "-k kernel         run only the named kernel",
+    "-n max-dimension  largest number of columns (default 32)",
+    "-r repeat         number of times to repeat each measurement (default 5)",
+    NULL
+};
+static const char *opt_k = NULL;
+static int opt_n = 32;
+static int opt_r = 5;
+
+/*
+ * POOL_BYTES: largest size of the pool of destroyed input matrices
+ * POOL_FLOPS: target amount of work in one timed batch
+ */
+#define POOL_BYTES	(4 * 1024 * 1024)
+#define POOL_FLOPS	1.0e+7
+#define POOL_MAX	4096
+
+/*
+ * kernel_t: kernel under test
+ */
+typedef enum kernel {
+    K_LU,
+    K_MINVERSE,
+    K_MLDIVIDE,
+    K_MRDIVIDE,
+    K_MMULTIPLY,
+    K_QRD,
+    K_QR,
+    K_QRSOLVE,
+    K_QRSOLVE2,
+    K_NKERNELS
+} kernel_t;
+
+/*
+ * kernel_names: names of the kernels, indexed by kernel_t
+ */
+static const char *const kernel_names[] = {
+    "lu",
+    "minverse",
+    "mldivide",
+    "mrdivide",
+    "mmultiply",
+    "qrd",
+    "qr",
+    "qrsolve",
+    "qrsolve2"
+};
+
+/*
+ * bench_t: matrices for one benchmark case
+ *
+ *   Kernels that destroy their inputs work from a pool of copies of
+ *   the pristine input so that each timed call sees the same data.
+ */
+typedef struct bench {
+    kernel_t b_kernel;
+    int b_m;
+    int b_n;
+    int b_o;
+    int b_a_size;		/* elements in A */
+    int b_b_size;		/* elements in B */
+    int b_pool;			/* copies of A and B in the pools */
+    double complex *b_a;	/* pristine A */
+    double complex *b_b;	/* pristine B */
+    double complex *b_a_pool;
+    double complex *b_b_pool;
+    double complex *b_x;
+    double complex *b_q;
+    double complex *b_r;
+    double complex *b_d;
+    int *b_row_index;
+} bench_t;
+
+/*
+ * now: return the monotonic time in seconds
+ */
+static double now()
+{
+    struct timespec ts;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + 1.0e-9 * (double)ts.tv_nsec;
+}
+
+/*
+ * fail: report an unexpected library error and exit
+ *   @what: name of the failing function
+ */
+static void fail(const char *what)
+{
+    (void)fprintf(stderr, "%s: %s: %s\n", progname, what, strerror(errno));
+    exit(4);
+}
+
+/*
+ * crandu: return a complex number uniform in the unit square
+ */
+static double complex crandu()
+{
+    double re = 2.0 * (double)random() / RAND_MAX - 1.0;
+    double im = 2.0 * (double)random() / RAND_MAX - 1.0;
+
+    return re + I * im;
+}
+
+/*
+ * kernel_flops: return the nominal number of real flops in one call
+ *   @kernel: kernel
+ *   @m: rows
+ *   @n: columns
+ *   @o: right-hand side columns
+ *
+ *   These are the textbook operation counts for complex arithmetic,
+ *   counting a complex multiply-add as 8 real operations.  They are
+ *   an estimate for comparing achieved rates, not an exact count of
+ *   the operations in our implementation.
+ */
+static double kernel_flops(kernel_t kernel, double m, double n, double o)
+{
+    switch (kernel) {
+    case K_LU:
+	return 8.0 / 3.0 * n * n * n;
+
+    case K_MINVERSE:
+	return 8.0 * n * n * n;
+
+    case K_MLDIVIDE:
+	return 8.0 / 3.0 * m * m * m + 8.0 * m * m * o;
+
+    case K_MRDIVIDE:
+	return 8.0 / 3.0 * n * n * n + 8.0 * m * n * n;
+
+    case K_MMULTIPLY:
+	return 8.0 * m * n * o;
+
+    case K_QRD:
+	return 8.0 * (m * n * n - n * n * n / 3.0);
+
+    case K_QR:
+	return 8.0 * (m * n * n - n * n * n / 3.0) +
+	    16.0 * (m * m * n - m * n * n + n * n * n / 3.0);
+
+    case K_QRSOLVE:
+	return 8.0 * (m * n * n - n * n * n / 3.0) +
+	    16.0 * m * n * o - 4.0 * n * n * o;
+
+    case K_QRSOLVE2:
+	return 8.0 * m * n * o + 4.0 * n * n * o;
+
+    default:
+	abort();
+    }
+}
+
+/*
+ * bench_alloc: set up a benchmark case
+ *   @bp: caller-allocated structure to fill in
+ *   @kernel: kernel
+ *   @m: rows
+ *   @n: columns
+ *   @o: right-hand side columns
+ */
+static void bench_alloc(bench_t *bp, kernel_t kernel, int m, int n, int o)
+{
+    const int mx = MAX(m, n);
+    double flops;
+
+    (void)memset((void *)bp, 0, sizeof(*bp));
+    bp->b_kernel = kernel;
+    bp->b_m = m;
+    bp->b_n = n;
+    bp->b_o = o;
+    switch (kernel) {
+    case K_LU:
+    case K_MINVERSE:
+	bp->b_a_size = n * n;
+	break;
+
+    case K_MLDIVIDE:
+	bp->b_a_size = m * m;
+	bp->b_b_size = m * o;
+	break;
+
+    case K_MRDIVIDE:
+	bp->b_a_size = n * n;
+	bp->b_b_size = m * n;
+	break;
+
+    case K_MMULTIPLY:
+	bp->b_a_size = m * n;
+	bp->b_b_size = n * o;
+	break;
+
+    case K_QRD:
+    case K_QR:
+	bp->b_a_size = m * n;
+	break;
+
+    case K_QRSOLVE:
+    case K_QRSOLVE2:
+	bp->b_a_size = m * n;
+	bp->b_b_size = m * o;
+	break;
+
+    default:
+	abort();
+    }
+
+    /*
+     * Size the pool so that a batch does about POOL_FLOPS of work
+     * within POOL_BYTES of memory.
+     */
+    flops = kernel_flops(kernel, m, n, o);
+    bp->b_pool = MIN(POOL_MAX, (int)(POOL_FLOPS / flops) + 1);
+    bp->b_pool = MIN(bp->b_pool, POOL_BYTES / (int)sizeof(double complex) /
+	    (bp->b_a_size + bp->b_b_size));
+    bp->b_pool = MAX(bp->b_pool, 1);
+
+    if ((bp->b_a = malloc(bp->b_a_size * sizeof(double complex))) == NULL ||
+	    (bp->b_b = malloc(MAX(bp->b_b_size, 1) *
+		sizeof(double complex))) == NULL ||
+	    (bp->b_a_pool = malloc(bp->b_pool * bp->b_a_size *
+		sizeof(double complex))) == NULL ||
+	    (bp->b_b_pool = malloc(MAX(bp->b_pool * bp->b_b_size, 1) *
+		sizeof(double complex))) == NULL ||
+	    (bp->b_x = malloc(mx * MAX(mx, o) *
+		sizeof(double complex))) == NULL ||
+	    (bp->b_q = malloc(m * m * sizeof(double complex))) == NULL ||
+	    (bp->b_r = malloc(m * n * sizeof(double complex))) == NULL ||
+	    (bp->b_d = malloc(mx * sizeof(double complex))) == NULL ||
+	    (bp->b_row_index = malloc(mx * sizeof(int))) == NULL) {
+	fail("malloc");
+    }
+    for (int i = 0; i < bp->b_a_size; ++i) {
+	bp->b_a[i] = crandu();
+    }
+    for (int i = 0; i < bp->b_b_size; ++i) {
+	bp->b_b[i] = crandu();
+    }
+
+    /*
+     * Qrsolve2 solves from a factorization computed in advance.
+     */
+    if (kernel == K_QRSOLVE2) {
+	double complex a_copy[m * n];
+
+	(void)memcpy((void *)a_copy, (void *)bp->b_a,
+		m * n * sizeof(double complex));
+	(void)_vnacommon_qr(a_copy, bp->b_q, bp->b_r, m, n);
+    }
+}
+
+/*
+ * bench_fill_pool: copy the pristine inputs into the pools
+ *   @bp: benchmark case
+ */
+static void bench_fill_pool(bench_t *bp)
+{
+    for (int i = 0; i < bp->b_pool; ++i) {
+	(void)memcpy((void *)&bp->b_a_pool[i * bp->b_a_size],
+		(void *)bp->b_a, bp->b_a_size * sizeof(double complex));
+	(void)memcpy((void *)&bp->b_b_pool[i * bp->b_b_size],
+		(void *)bp->b_b, bp->b_b_size * sizeof(double complex));
+    }
+}
+
+/*
+ * bench_call: run the kernel on the given pool entry
+ *   @bp: benchmark case
+ *   @i: pool index
+ */
+static void bench_call(bench_t *bp, int i)
+{
+    double complex *a = &bp->b_a_pool[i * bp->b_a_size];
+    double complex *b = &bp->b_b_pool[i * bp->b_b_size];
+    const int m = bp->b_m;
+    const int n = bp->b_n;
+    const int o = bp->b_o;
+
+    switch (bp->b_kernel) {
+    case K_LU:
+	(void)_vnacommon_lu(a, bp->b_row_index, n);
+	break;
+
+    case K_MINVERSE:
+	(void)_vnacommon_minverse(bp->b_x, a, n);
+	break;
+
+    case K_MLDIVIDE:
+	(void)_vnacommon_mldivide(bp->b_x, a, b, m, o);
+	break;
+
+    case K_MRDIVIDE:
+	(void)_vnacommon_mrdivide(bp->b_x, b, a, m, n);
+	break;
+
+    case K_MMULTIPLY:
+	_vnacommon_mmultiply(bp->b_x, a, b, m, n, o);
+	break;
+
+    case K_QRD:
+	_vnacommon_qrd(a, bp->b_d, m, n);
+	break;
+
+    case K_QR:
+	(void)_vnacommon_qr(a, bp->b_q, bp->b_r, m, n);
+	break;
+
+    case K_QRSOLVE:
+	(void)_vnacommon_qrsolve(bp->b_x, a, b, m, n, o);
+	break;
+
+    case K_QRSOLVE2:
+	_vnacommon_qrsolve2(bp->b_x, bp->b_q, bp->b_r, b, m, n, o);
+	break;
+
+    default:
+	abort();
+    }
+}
+
+/*
+ * bench_free: free the memory of a benchmark case
+ *   @bp: benchmark case
+ */
+static void bench_free(bench_t *bp)
+{
+    free((void *)bp->b_row_index);
+    free((void *)bp->b_d);
+    free((void *)bp->b_r);
+    free((void *)bp->b_q);
+    free((void *)bp->b_x);
+    free((void *)bp->b_b_pool);
+    free((void *)bp->b_a_pool);
+    free((void *)bp->b_b);
+    free((void *)bp->b_a);
+}
+
+/*
+ * bench_kernel: measure and report one kernel at one size
+ *   @kernel: kernel
+ *   @m: rows
+ *   @n: columns
+ *   @o: right-hand side columns
+ */
+static void bench_kernel(kernel_t kernel, int m, int n, int o)
+{
+    bench_t b;
+    double best = 1.0e+99;
+    double flops, ns;
+
+    if (opt_k != NULL && strcmp(opt_k, kernel_names[kernel]) != 0) {
+	return;
+    }
+    bench_alloc(&b, kernel, m, n, o);
+    for (int r = 0; r < opt_r; ++r) {
+	double t0;
+
+	bench_fill_pool(&b);
+	t0 = now();
+	for (int i = 0; i < b.b_pool; ++i) {
+	    bench_call(&b, i);
+	}
+	t0 = (now() - t0) / (double)b.b_pool;
+	if (t0 < best) {
+	    best = t0;
+	}
+    }
+    flops = kernel_flops(kernel, m, n, o);
+    ns = 1.0e+9 * best;
+    (void)printf("%-10s %4d %4d %4d %12.1f %12.0f %8.3f\n",
+	    kernel_names[kernel], m, n, o, ns, flops, flops / ns);
+    bench_free(&b);
+}
+
+/*
+ * print_usage: print a usage message and exit
+ */
+static void print_usage()
+{
+    const char *const *cpp;
+
+    for (cpp = usage; *cpp != NULL; ++cpp) {
+	(void)fprintf(stderr, "%s: usage %s\n", progname, *cpp);
+    }
+    for (cpp = help; *cpp != NULL; ++cpp) {
+	(void)fprintf(stderr, "%s\n", *cpp);
+    }
+    exit(2);
+}
+
+/*
+ * main: benchmark program
+ */
+int
+main(int argc, char **argv)
+{
+    static const int ratio_vector[] = { 2, 4, 8 };
+
+    if ((char *)NULL == (progname = strrchr(argv[0], '/'))) {
+	progname = argv[0];
+    } else {
+	++progname;
+    }
+    for (;;) {
+	switch (getopt(argc, argv, options)) {
+	case 'k':
+	    opt_k = optarg;
+	    continue;
+
+	case 'n':
+	    opt_n = atoi(optarg);
+	    continue;
+
+	case 'r':
+	    opt_r = atoi(optarg);
+	    continue;
+
+	case -1:
+	    break;
+
+	default:
+	    print_usage();
+	}
+	break;
+    }
+    argc -= optind;
+    argv += optind;
+    if (argc != 0 || opt_n < 1 || opt_r < 1) {
+	print_usage();
+    }
+    if (opt_k != NULL) {
+	int kernel;
+
+	for (kernel = 0; kernel < K_NKERNELS; ++kernel) {
+	    if (strcmp(opt_k, kernel_names[kernel]) == 0) {
+		break;
+	    }
+	}
+	if (kernel == K_NKERNELS) {
+	    print_usage();
+	}
+    }
+    (void)printf("%-10s %4s %4s %4s %12s %12s %8s\n",
+	    "kernel", "m", "n", "o", "ns/op", "flops", "GFLOPS");
+
+    /*
+     * Square systems.  Mmultiply is included as a reference for the
+     * rate the compiler achieves on plain complex multiply-adds, and
+     * qrsolve2 shows the cost of a solve that reuses a factorization.
+     */
+    for (int kernel = 0; kernel < K_NKERNELS; ++kernel) {
+	for (int n = 1; n <= opt_n; ++n) {
+	    switch (kernel) {
+	    case K_MLDIVIDE:
+	    case K_MRDIVIDE:
+	    case K_MMULTIPLY:
+		bench_kernel(kernel, n, n, n);
+		break;
+
+	    default:
+		bench_kernel(kernel, n, n, 1);
+		break;
+	    }
+	}
+    }
+
+    /*
+     * Tall least-squares systems like those vnacal_new_solve builds
+     * from many standards.
+     */
+    for (int kernel = K_QRD; kernel < K_NKERNELS; ++kernel) {
+	for (int ri = 0; ri < sizeof(ratio_vector) / sizeof(ratio_vector[0]);
+		++ri) {
+	    for (int n = 1; n <= opt_n; n *= 2) {
+		bench_kernel(kernel, ratio_vector[ri] * n, n, 1);
+	    }
+	}
+    }
+    exit(0);
+}
@@ -0,0 +1,336 @@
+/*
+ * Vector Network Analyzer Library
+ * Copyright © 2020-2024 D Scott Guthridge <scott_guthridge@rompromity.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "archdep.h"
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include "vnaproperty.h"
+
+/*
+ * Options
+ */
+char *progname;
+static const char options[] = "n:r:";
+static const char *const usage[] = {
+    "[-n keys] [-r repeat]",
+    NULL
+};
+static const char *const help[] = {
+    "-n keys    number of keys in the map (default 10000)",
+    "-r repeat  number of times to repeat each measurement (default 20)",
+    NULL
+};
+static int opt_n = 10000;
+static int opt_r = 20;
+
+/*
+ * key_vector: keys used in the benchmarks
+ */
+static char **key_vector = NULL;
+
+/*
+ * now: return the monotonic time in seconds
+ */
+static double now()
+{
+    struct timespec ts;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + 1.0e-9 * (double)ts.tv_nsec;
+}
+
+/*
+ * report: print the result of a measurement
+ *   @name: name of the measurement
+ *   @best: best time in seconds over all repetitions
+ *   @ops: number of operations timed
+ */
+static void report(const char *name, double best, int ops)
+{
+    (void)printf("%-24s %8d ops %10.1f ns/op\n",
+	    name, ops, 1.0e+9 * best / (double)ops);
+}
+
+/*
+ * fail: report an unexpected library error and exit
+ *   @what: name of the failing function
+ */
+static void fail(const char *what)
+{
+    (void)fprintf(stderr, "%s: %s: %s\n", progname, what, strerror(errno));
+    exit(4);
+}
+
+/*
+ * build_map: insert all keys into an empty map at *rootptr
+ *   @rootptr: address of the root
+ *   @path: compiled "%s" path
+ */
+static void build_map(vnaproperty_t **rootptr, const vnaproperty_path_t *path)
+{
+    for (int i = 0; i < opt_n; ++i) {
+	if (vnaproperty_path_set(rootptr, path, "value",
+		    key_vector[i]) == -1) {
+	    fail("vnaproperty_path_set");
+	}
+    }
+}
+
+/*
+ * bench_insert: measure insertion into heap and arena maps
+ *   @path: compiled "%s" path
+ */
+static void bench_insert(const vnaproperty_path_t *path)
+{
+    double best_heap = 1.0e+99, best_arena = 1.0e+99;
+
+    for (int r = 0; r < opt_r; ++r) {
+	vnaproperty_t *root = NULL;
+	vnaproperty_arena_t *arena;
+	double t0;
+
+	t0 = now();
+	build_map(&root, path);
+	t0 = now() - t0;
+	if (t0 < best_heap) {
+	    best_heap = t0;
+	}
+	(void)vnaproperty_delete(&root, ".");
+
+	if ((arena = vnaproperty_arena_alloc(0)) == NULL) {
+	    fail("vnaproperty_arena_alloc");
+	}
+	t0 = now();
+	build_map(vnaproperty_arena_get_root(arena), path);
+	t0 = now() - t0;
+	if (t0 < best_arena) {
+	    best_arena = t0;
+	}
+	vnaproperty_arena_free(arena);
+    }
+    report("map-insert", best_heap, opt_n);
+    report("map-insert-arena", best_arena, opt_n);
+}
+
+/*
+ * bench_lookup: measure successful and unsuccessful lookups
+ *   @root: map containing all keys
+ *   @path: compiled "%s" path
+ */
+static void bench_lookup(const vnaproperty_t *root,
+	const vnaproperty_path_t *path)
+{
+    double best_hit = 1.0e+99, best_miss = 1.0e+99;
+    char **missing;
+
+    if ((missing = calloc(opt_n, sizeof(char *))) == NULL) {
+	fail("calloc");
+    }
+    for (int i = 0; i < opt_n; ++i) {
+	if ((missing[i] = malloc(strlen(key_vector[i]) + 2)) == NULL) {
+	    fail("malloc");
+	}
+	(void)sprintf(missing[i], "%s~", key_vector[i]);
+    }
+    for (int r = 0; r < opt_r; ++r) {
+	double t0;
+
+	t0 = now();
+	for (int i = 0; i < opt_n; ++i) {
+	    if (vnaproperty_path_get(root, path, key_vector[i]) == NULL) {
+		fail("vnaproperty_path_get");
+	    }
+	}
+	t0 = now() - t0;
+	if (t0 < best_hit) {
+	    best_hit = t0;
+	}
+	t0 = now();
+	for (int i = 0; i < opt_n; ++i) {
+	    if (vnaproperty_path_get(root, path, missing[i]) != NULL) {
+		fail("vnaproperty_path_get");
+	    }
+	}
+	t0 = now() - t0;
+	if (t0 < best_miss) {
+	    best_miss = t0;
+	}
+    }
+    report("map-lookup-hit", best_hit, opt_n);
+    report("map-lookup-miss", best_miss, opt_n);
+    for (int i = 0; i < opt_n; ++i) {
+	free((void *)missing[i]);
+    }
+    free((void *)missing);
+}
+
+/*
+ * bench_iterate: measure iteration over the keys in insertion order
+ *   @root: map containing all keys
+ */
+static void bench_iterate(const vnaproperty_t *root)
+{
+    double best = 1.0e+99;
+
+    for (int r = 0; r < opt_r; ++r) {
+	const char **keys;
+	double t0;
+
+	t0 = now();
+	if ((keys = vnaproperty_keys(root, "{}")) == NULL) {
+	    fail("vnaproperty_keys");
+	}
+	t0 = now() - t0;
+	if (t0 < best) {
+	    best = t0;
+	}
+	if (strcmp(keys[0], key_vector[0]) != 0) {
+	    (void)fprintf(stderr, "%s: insertion order not preserved\n",
+		    progname);
+	    exit(4);
+	}
+	free((void *)keys);
+    }
+    report("map-iterate", best, opt_n);
+}
+
+/*
+ * bench_delete: measure deletion of all keys
+ *   @path: compiled "%s" path
+ */
+static void bench_delete(const vnaproperty_path_t *path)
+{
+    double best = 1.0e+99;
+
+    for (int r = 0; r < opt_r; ++r) {
+	vnaproperty_t *root = NULL;
+	double t0;
+
+	build_map(&root, path);
+	t0 = now();
+	for (int i = 0; i < opt_n; ++i) {
+	    if (vnaproperty_path_delete(&root, path, key_vector[i]) == -1) {
+		fail("vnaproperty_path_delete");
+	    }
+	}
+	t0 = now() - t0;
+	if (t0 < best) {
+	    best = t0;
+	}
+	(void)vnaproperty_delete(&root, ".");
+    }
+    report("map-delete", best, opt_n);
+}
+
+/*
+ * print_usage: print a usage message and exit
+ */
+static void print_usage()
+{
+    const char *const *cpp;
+
+    for (cpp = usage; *cpp != NULL; ++cpp) {
+	(void)fprintf(stderr, "%s: usage %s\n", progname, *cpp);
+    }
+    for (cpp = help; *cpp != NULL; ++cpp) {
+	(void)fprintf(stderr, "%s\n", *cpp);
+    }
+    exit(2);
+}
+
+/*
+ * main: benchmark program
+ */
+int
+main(int argc, char **argv)
+{
+    vnaproperty_path_t *path;
+    vnaproperty_t *root = NULL;
+
+    if ((char *)NULL == (progname = strrchr(argv[0], '/'))) {
+	progname = argv[0];
+    } else {
+	++progname;
+    }
+    for (;;) {
+	switch (getopt(argc, argv, options)) {
+	case 'n':
+	    opt_n = atoi(optarg);
+	    continue;
+
+	case 'r':
+	    opt_r = atoi(optarg);
+	    continue;
+
+	case -1:
+	    break;
+
+	default:
+	    print_usage();
+	}
+	break;
+    }
+    argc -= optind;
+    argv += optind;
+    if (argc != 0 || opt_n < 1 || opt_r < 1) {
+	print_usage();
+    }
+
+    /*
+     * Make keys of varying length in the style of calibration
+     * properties.
+     */
+    if ((key_vector = calloc(opt_n, sizeof(char *))) == NULL) {
+	fail("calloc");
+    }
+    for (int i = 0; i < opt_n; ++i) {
+	static const char *const stems[] = {
+	    "f", "z0", "port", "standard", "temperature",
+	    "measurement_description"
+	};
+	const char *stem = stems[i % (sizeof(stems) / sizeof(stems[0]))];
+
+	if ((key_vector[i] = malloc(strlen(stem) + 16)) == NULL) {
+	    fail("malloc");
+	}
+	(void)sprintf(key_vector[i], "%s_%d", stem, i);
+    }
+    if ((path = vnaproperty_path_compile("%s")) == NULL) {
+	fail("vnaproperty_path_compile");
+    }
+    bench_insert(path);
+    build_map(&root, path);
+    bench_lookup(root, path);
+    bench_iterate(root);
+    bench_delete(path);
+    (void)vnaproperty_delete(&root, ".");
+    vnaproperty_path_free(path);
+    for (int i = 0; i < opt_n; ++i) {
+	free((void *)key_vector[i]);
+    }
+    free((void *)key_vector);
+    exit(0);
+}
@@ -70,6 +70,11 @@ extern libt_result_t libt_vnadata_validate(const libt_vnadata_t *tdp,
 	const vnadata_t *vdp);
 extern libt_result_t libt_vnadata_fill(const libt_vnadata_t *tdp,
 	vnadata_t *vdp, libt_vnadata_fill_method_t fill_method);
+extern vnadata_t *libt_vnadata_make(vnaerr_error_fn_t *error_fn,
+	vnadata_layout_t layout, vnadata_parameter_type_t type, int ports,
+	int frequencies, libt_vnadata_z0_type_t z0_type);
+extern libt_result_t libt_vnadata_compare(const char *label,
+	const vnadata_t *actual, const vnadata_t *expected, int n);
 extern void libt_vnadata_convert(const double complex *in, double complex *out,
 	const double complex *z0, int rows, int columns,
 	vnadata_parameter_type_t old_type, vnadata_parameter_type_t new_type);
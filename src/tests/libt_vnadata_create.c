@@ -326,9 +326,56 @@ libt_result_t libt_vnadata_validate(const libt_vnadata_t *tdp,
     }
 
     /*
-     * Check data using vnadata_get_matrix.
+     * Check data using vnadata_get_to_matrix.
      */
     for (int findex = 0; findex < frequencies; ++findex) {
+	double complex matrix[MAX(rows * columns, 1)];
+
+	if (vnadata_get_to_matrix(vdp, findex, matrix) == -1) {
+	    libt_fail("vnadata_get_to_matrix: findex %d\n", findex);
+	    return T_FAIL;
+	}
+	for (int cell = 0; cell < rows * columns; ++cell) {
+	    if (!libt_isequal_c_rpt("vnadata_get_to_matrix",
+			matrix[cell], tdp->td_vector[findex][cell])) {
+		libt_fail(": findex %d cell %d\n", findex, cell);
+		return T_FAIL;
+	    }
+	}
+    }
+
+    /*
+     * Check data using vnadata_get_vector (cell-major layout only).
+     */
+    if (vnadata_get_layout(vdp) == VNADATA_LAYOUT_CELL_MAJOR) {
+	for (int row = 0; row < rows; ++row) {
+	    for (int column = 0; column < columns; ++column) {
+		const int cell = row * columns + column;
+		const double complex *vector;
+
+		vector = vnadata_get_vector(vdp, row, column);
+		if (vector == NULL && frequencies != 0) {
+		    libt_fail("vnadata_get_vector: row %d column %d\n",
+			    row, column);
+		    return T_FAIL;
+		}
+		for (int findex = 0; findex < frequencies; ++findex) {
+		    if (!libt_isequal_c_rpt("vnadata_get_vector",
+				vector[findex], tdp->td_vector[findex][cell])) {
+			libt_fail(": row %d column %d findex %d\n",
+				row, column, findex);
+			return T_FAIL;
+		    }
+		}
+	    }
+	}
+    }
+
+    /*
+     * Check data using vnadata_get_matrix (frequency-major layout only).
+     */
+    for (int findex = 0; vnadata_get_layout(vdp) ==
+	    VNADATA_LAYOUT_FREQUENCY_MAJOR && findex < frequencies; ++findex) {
 	const double complex *matrix;
 
 	if ((matrix = vnadata_get_matrix(vdp, findex)) == NULL &&
@@ -616,3 +663,91 @@ libt_result_t libt_vnadata_fill(const libt_vnadata_t *tdp,
     }
     return T_PASS;
 }
+
+/*
+ * libt_vnadata_make: create a vnadata_t structure holding random test data
+ *   @error_fn: error reporting function for the new structure
+ *   @layout: storage layout
+ *   @type: type of parameters to create
+ *   @ports: number of rows and columns in the matrix
+ *   @frequencies: number of frequencies
+ *   @z0_type: type of reference impedances
+ */
+vnadata_t *libt_vnadata_make(vnaerr_error_fn_t *error_fn,
+	vnadata_layout_t layout, vnadata_parameter_type_t type, int ports,
+	int frequencies, libt_vnadata_z0_type_t z0_type)
+{
+    libt_vnadata_t *tdp;
+    vnadata_t *vdp;
+
+    tdp = libt_vnadata_create(type, ports, ports, frequencies, z0_type);
+    if ((vdp = vnadata_alloc(error_fn, NULL)) == NULL) {
+	libt_error("vnadata_alloc: %s\n", strerror(errno));
+    }
+    if (vnadata_set_layout(vdp, layout) == -1) {
+	libt_error("vnadata_set_layout: %s\n", strerror(errno));
+    }
+    if (libt_vnadata_fill(tdp, vdp, FM_CELL) != T_PASS) {
+	libt_error("libt_vnadata_fill: failed\n");
+    }
+    libt_vnadata_free(tdp);
+    return vdp;
+}
+
+/*
+ * libt_vnadata_compare: test that actual holds the first n frequencies
+ *	of expected exactly
+ *   @label: description for error messages
+ *   @actual: structure to check
+ *   @expected: structure holding the expected values
+ *   @n: number of frequencies
+ */
+libt_result_t libt_vnadata_compare(const char *label,
+	const vnadata_t *actual, const vnadata_t *expected, int n)
+{
+    const int rows = vnadata_get_rows(expected);
+    const int columns = vnadata_get_columns(expected);
+    const int ports = MAX(rows, columns);
+
+    if (vnadata_get_type(actual) != vnadata_get_type(expected) ||
+	    vnadata_get_rows(actual) != rows ||
+	    vnadata_get_columns(actual) != columns) {
+	libt_fail("%s: wrong type or dimensions\n", label);
+	return T_FAIL;
+    }
+    if (vnadata_get_frequencies(actual) != n) {
+	libt_fail("%s: expected %d frequencies; found %d\n",
+		label, n, vnadata_get_frequencies(actual));
+	return T_FAIL;
+    }
+    if (vnadata_has_fz0(actual) != vnadata_has_fz0(expected)) {
+	libt_fail("%s: wrong z0 type\n", label);
+	return T_FAIL;
+    }
+    for (int findex = 0; findex < n; ++findex) {
+	if (vnadata_get_frequency(actual, findex) !=
+		vnadata_get_frequency(expected, findex)) {
+	    libt_fail("%s: wrong frequency at %d\n", label, findex);
+	    return T_FAIL;
+	}
+	for (int row = 0; row < rows; ++row) {
+	    for (int column = 0; column < columns; ++column) {
+		if (vnadata_get_cell(actual, findex, row, column) !=
+			vnadata_get_cell(expected, findex, row, column)) {
+		    libt_fail("%s: wrong value at findex %d row %d "
+			    "column %d\n", label, findex, row, column);
+		    return T_FAIL;
+		}
+	    }
+	}
+	for (int port = 0; port < ports; ++port) {
+	    if (vnadata_get_fz0(actual, findex, port) !=
+		    vnadata_get_fz0(expected, findex, port)) {
+		libt_fail("%s: wrong z0 at findex %d port %d\n",
+			label, findex, port);
+		return T_FAIL;
+	    }
+	}
+    }
+    return T_PASS;
+}
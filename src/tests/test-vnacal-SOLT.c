@@ -324,6 +324,125 @@ out:
     return result;
 }
 
+/*
+ * run_vnacal_new_solr_trial: test SOLT with a through of unknown loss
+ *   @trial: test trial
+ *   @type: error term type
+ *   @frequencies: number of test frequencies
+ *
+ *   The single reflect standards leave cells of their S matrices unset,
+ *   and the unknown through sends the solve through the iterative
+ *   path that patches the unknown values into those matrices.
+ */
+static libt_result_t run_vnacal_new_solr_trial(int trial, vnacal_type_t type,
+	int frequencies)
+{
+    vnacal_t *vcp = NULL;
+    libt_vnacal_terms_t *ttp = NULL;
+    libt_vnacal_measurements_t *tmp = NULL;
+    int t_actual = -1, t_guess = -1, t_unknown = -1;
+    int s_matrix[2][2];
+    libt_result_t result = T_FAIL;
+
+    /*
+     * If -v, print the test header.
+     */
+    if (opt_v != 0) {
+	(void)printf("Test vnacal_new: trial %3d size 2 x 2 "
+		"type %-4s M  SOLR\n",
+	    trial, vnacal_type_to_name(type));
+    }
+
+    /*
+     * Create the calibration structure and the reflect parameters.
+     */
+    if ((vcp = vnacal_create(error_fn, NULL)) == NULL) {
+	(void)fprintf(stderr, "%s: vnacal_create: %s\n",
+		progname, strerror(errno));
+	goto out;
+    }
+    if ((short_parameter = vnacal_make_calkit_parameter(vcp,
+		    &short_data)) == -1 ||
+	    (open_parameter = vnacal_make_calkit_parameter(vcp,
+		    &open_data)) == -1 ||
+	    (load_parameter = vnacal_make_calkit_parameter(vcp,
+		    &load_data)) == -1) {
+	(void)fprintf(stderr, "%s: vnacal_make_calkit_parameter: %s\n",
+		progname, strerror(errno));
+	goto out;
+    }
+
+    /*
+     * Generate random error parameters and measure short, open and
+     * load on both ports.
+     */
+    if ((ttp = libt_vnacal_generate_error_terms(vcp, type, 2, 2,
+		    frequencies, NULL, 0)) == NULL) {
+	(void)fprintf(stderr, "%s: libt_vnacal_generate_error_terms: %s\n",
+		progname, strerror(errno));
+	goto out;
+    }
+    if ((tmp = libt_vnacal_alloc_measurements(type, 2, 2,
+		    frequencies, false)) == NULL) {
+	result = T_ERROR;
+	goto out;
+    }
+    for (int port = 1; port <= 2; ++port) {
+	if ((result = run_solt_trial_helper(ttp, tmp, port)) != T_PASS) {
+	    goto out;
+	}
+    }
+    result = T_FAIL;
+
+    /*
+     * Add a through with unknown transmission.
+     */
+    if ((t_actual = vnacal_make_scalar_parameter(vcp,
+		    0.8 * cexp(-I * M_PI / 6.0))) == -1 ||
+	    (t_guess = vnacal_make_scalar_parameter(vcp, 1.0)) == -1 ||
+	    (t_unknown = vnacal_make_unknown_parameter(vcp, t_guess)) == -1) {
+	goto out;
+    }
+    s_matrix[0][0] = VNACAL_MATCH;
+    s_matrix[0][1] = t_actual;
+    s_matrix[1][0] = t_actual;
+    s_matrix[1][1] = VNACAL_MATCH;
+    if (libt_vnacal_calculate_measurements(ttp, tmp, &s_matrix[0][0],
+		2, 2, NULL) == -1) {
+	goto out;
+    }
+    s_matrix[0][1] = t_unknown;
+    s_matrix[1][0] = t_unknown;
+    if (vnacal_new_add_line_m(ttp->tt_vnp, tmp->tm_b_matrix, 2, 2,
+		&s_matrix[0][0], 1, 2) == -1) {
+	goto out;
+    }
+
+    /*
+     * Solve for the error parameters and check.
+     */
+    if (vnacal_new_solve(ttp->tt_vnp) == -1) {
+	(void)fprintf(stderr, "%s: vnacal_solve: %s\n",
+		progname, strerror(errno));
+	goto out;
+    }
+    if (libt_vnacal_validate_calibration(ttp, NULL) == -1) {
+	goto out;
+    }
+    result = T_PASS;
+
+out:
+    libt_vnacal_free_measurements(tmp);
+    libt_vnacal_free_error_terms(ttp);
+    if (vcp != NULL) {
+	vnacal_delete_parameter(vcp, t_guess);
+	vnacal_delete_parameter(vcp, t_actual);
+    }
+    delete_calkit_parameters(vcp);
+    vnacal_free(vcp);
+    return result;
+}
+
 /*
  * test_vnacal_new_solt: run SOLT tests for 8-12 term parameters
  */
@@ -333,6 +452,9 @@ static libt_result_t test_vnacal_new_solt()
     static const vnacal_type_t types[] = {
 	VNACAL_T8, VNACAL_U8, VNACAL_TE10, VNACAL_UE10, VNACAL_UE14, VNACAL_E12
     };
+    static const vnacal_type_t solr_types[] = {
+	VNACAL_T8, VNACAL_U8, VNACAL_TE10, VNACAL_UE10
+    };
     libt_result_t result = T_FAIL;
 
     /*
@@ -367,6 +489,12 @@ static libt_result_t test_vnacal_new_solt()
 		}
 	    }
 	}
+	for (int ti = 0; ti < sizeof(solr_types) / sizeof(solr_types[0]);
+		++ti) {
+	    result = run_vnacal_new_solr_trial(trial, solr_types[ti], 2);
+	    if (result != T_PASS)
+		goto out;
+	}
     }
     result = T_PASS;
 
@@ -0,0 +1,481 @@
+/*
+ * Vector Network Analyzer Library
+ * Copyright © 2020-2023 D Scott Guthridge <scott_guthridge@rompromity.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "archdep.h"
+
+#include <assert.h>
+#include <complex.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdio.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include "vnacal_internal.h"
+#include "libt.h"
+#include "libt_crand.h"
+#include "libt_vnacal.h"
+
+
+/*
+ * Command Line Options
+ */
+char *progname;
+static const char options[] = "av";
+static const char *const usage[] = {
+    "[-av]",
+    NULL
+};
+static const char *const help[] = {
+    "-a	 abort on data miscompare",
+    "-v	 show verbose output",
+    NULL
+};
+bool opt_a = false;
+int  opt_v = 0;
+
+/*
+ * Test file names
+ */
+#define TEXT_FILE	"test-vnacal-binary.vnacal"
+#define BINARY_FILE	"test-vnacal-binary.vnacalb"
+#define COPY_FILE	"test-vnacal-binary-copy.vnacal"
+
+/*
+ * error_fn: error reporting function
+ *   @message: error message
+ *   @arg: (unused)
+ *   @category: error category (unused)
+ */
+static void error_fn(const char *message, void *arg, vnaerr_category_t category)
+{
+    if (opt_v != 0) {
+	(void)printf("%s: %s\n", progname, message);
+    }
+}
+
+/*
+ * read_file: read a file into a malloc'd buffer
+ *   @filename: file to read
+ *   @lengthp: address to receive the length
+ */
+static char *read_file(const char *filename, size_t *lengthp)
+{
+    FILE *fp;
+    char *buffer = NULL;
+    size_t allocation = 0;
+    size_t length = 0;
+    size_t n;
+
+    if ((fp = fopen(filename, "rb")) == NULL) {
+	(void)fprintf(stderr, "%s: fopen: %s: %s\n",
+		progname, filename, strerror(errno));
+	return NULL;
+    }
+    do {
+	if (length == allocation) {
+	    allocation = MAX(2 * allocation, 4096);
+	    if ((buffer = realloc(buffer, allocation)) == NULL) {
+		(void)fprintf(stderr, "%s: realloc: %s\n",
+			progname, strerror(errno));
+		exit(99);
+	    }
+	}
+	n = fread((void *)&buffer[length], 1, allocation - length, fp);
+	length += n;
+    } while (n != 0);
+    (void)fclose(fp);
+    *lengthp = length;
+    return buffer;
+}
+
+/*
+ * compare_files: test if two files have the same contents
+ *   @filename1: first file
+ *   @filename2: second file
+ */
+static bool compare_files(const char *filename1, const char *filename2)
+{
+    char *buffer1, *buffer2;
+    size_t length1, length2;
+    bool result = false;
+
+    if ((buffer1 = read_file(filename1, &length1)) == NULL) {
+	return false;
+    }
+    if ((buffer2 = read_file(filename2, &length2)) == NULL) {
+	free((void *)buffer1);
+	return false;
+    }
+    if (length1 == length2 && memcmp((void *)buffer1, (void *)buffer2,
+		length1) == 0) {
+	result = true;
+    } else {
+	(void)printf("%s and %s differ\n", filename1, filename2);
+    }
+    free((void *)buffer1);
+    free((void *)buffer2);
+    return result;
+}
+
+/*
+ * add_z0_calibration: add a random calibration with per-port z0
+ *   @vcp: vnacal structure
+ *   @name: calibration name
+ *   @z0_type: VNACAL_Z0_VECTOR or VNACAL_Z0_MATRIX
+ */
+static int add_z0_calibration(vnacal_t *vcp, const char *name,
+	vnacal_z0_type_t z0_type)
+{
+    const int ports = 2;
+    const int frequencies = random() % 3 + 1;
+    vnacal_layout_t vl;
+    vnacal_calibration_t *calp;
+
+    _vnacal_layout(&vl, VNACAL_T8, ports, ports);
+    if ((calp = _vnacal_calibration_alloc(vcp, VNACAL_T8, ports, ports,
+		    frequencies, z0_type, VL_ERROR_TERMS(&vl))) == NULL) {
+	return -1;
+    }
+    for (int findex = 0; findex < frequencies; ++findex) {
+	calp->cal_frequency_vector[findex] = 1.0e+6 * (findex + 1);
+    }
+    for (int term = 0; term < calp->cal_error_terms; ++term) {
+	for (int findex = 0; findex < frequencies; ++findex) {
+	    calp->cal_error_term_vector[term][findex] = libt_crandn();
+	}
+    }
+    for (int port = 0; port < ports; ++port) {
+	if (z0_type == VNACAL_Z0_VECTOR) {
+	    calp->cal_z0_vector[port] = 50.0 + 10.0 * libt_crandn();
+	} else {
+	    for (int findex = 0; findex < frequencies; ++findex) {
+		calp->cal_z0_matrix[port][findex] =
+		    50.0 + 10.0 * libt_crandn();
+	    }
+	}
+    }
+    if (_vnacal_add_calibration_common(__func__, vcp, calp, name) == -1) {
+	_vnacal_calibration_free(calp);
+	return -1;
+    }
+    return 0;
+}
+
+/*
+ * validate_calibrations: check error terms against the generated ones
+ *   @vcp: vnacal structure
+ *   @ttp_table: generated error terms by type
+ *   @type_table: calibration types
+ *   @types: number of types
+ */
+static int validate_calibrations(vnacal_t *vcp,
+	libt_vnacal_terms_t *const *ttp_table,
+	const vnacal_type_t *type_table, int types)
+{
+    for (int tindex = 0; tindex < types; ++tindex) {
+	vnacal_calibration_t *calp;
+	int ci;
+
+	if ((ci = vnacal_find_calibration(vcp,
+			vnacal_type_to_name(type_table[tindex]))) == -1) {
+	    (void)fprintf(stderr, "%s: vnacal_find_calibration: %s\n",
+		    progname, strerror(errno));
+	    return -1;
+	}
+	if ((calp = _vnacal_get_calibration(__func__, vcp, ci)) == NULL) {
+	    return -1;
+	}
+	if (libt_vnacal_validate_calibration(ttp_table[tindex], calp) == -1) {
+	    return -1;
+	}
+    }
+    return 0;
+}
+
+/*
+ * run_vnacal_binary_trial
+ */
+static libt_result_t run_vnacal_binary_trial(int trial)
+{
+    static const vnacal_type_t type_table[] = {
+	VNACAL_T8, VNACAL_U8, VNACAL_TE10, VNACAL_UE10,
+	VNACAL_T16, VNACAL_U16, VNACAL_UE14, VNACAL_E12
+    };
+    libt_vnacal_terms_t *ttp_table[8] =
+	{ NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL };
+    const int types = sizeof(type_table) / sizeof(vnacal_type_t);
+    vnacal_t *vcp = NULL;
+    vnacal_t *vcp_other = NULL;
+    libt_result_t result = T_FAIL;
+    const char *cp_temp;
+    FILE *fp;
+
+    /*
+     * If -v, print the test header.
+     */
+    if (opt_v != 0) {
+	(void)printf("Test binary vnacal_save, vnacal_load: trial %d\n",
+		trial);
+    }
+
+    /*
+     * Create calibrations of each type, plus calibrations with
+     * per-port and per-frequency reference impedances.
+     */
+    if ((vcp = vnacal_create(error_fn, NULL)) == NULL) {
+	(void)fprintf(stderr, "%s: vnacal_create: %s\n",
+		progname, strerror(errno));
+	goto out;
+    }
+    for (int tindex = 0; tindex < types; ++tindex) {
+	vnacal_type_t type = type_table[tindex];
+	int frequencies = random() % 3 + 1;
+	int small = random() % 2 + 1;
+	int large = small + random() % 2;
+	bool t_type = type == VNACAL_T8 || type == VNACAL_TE10 ||
+	    type == VNACAL_T16;
+
+	if ((ttp_table[tindex] = libt_vnacal_make_random_calibration(vcp, type,
+			t_type ? small : large, t_type ? large : small,
+			frequencies, /*ab*/false)) == NULL) {
+	    goto out;
+	}
+	if (vnacal_add_calibration(vcp, vnacal_type_to_name(type),
+		    ttp_table[tindex]->tt_vnp) == -1) {
+	    goto out;
+	}
+	vnacal_new_free(ttp_table[tindex]->tt_vnp);
+	ttp_table[tindex]->tt_vnp = NULL;
+    }
+    if (add_z0_calibration(vcp, "z0-vector", VNACAL_Z0_VECTOR) == -1 ||
+	    add_z0_calibration(vcp, "z0-matrix", VNACAL_Z0_MATRIX) == -1) {
+	goto out;
+    }
+    if (vnacal_property_set(vcp, -1, "global_property=47") == -1 ||
+	    vnacal_property_set(vcp, 0, "foo=bar") == -1 ||
+	    vnacal_property_set(vcp, 1, "switches[1][0]=3") == -1) {
+	(void)fprintf(stderr, "%s: vnacal_property_set: %s\n",
+		progname, strerror(errno));
+	goto out;
+    }
+
+    /*
+     * Save in both formats.
+     */
+    if (vnacal_save(vcp, TEXT_FILE) == -1 ||
+	    vnacal_save(vcp, BINARY_FILE) == -1) {
+	(void)fprintf(stderr, "%s: vnacal_save: %s\n",
+		progname, strerror(errno));
+	goto out;
+    }
+    vnacal_free(vcp);
+
+    /*
+     * Load the binary file and check the error terms.
+     */
+    if ((vcp = vnacal_load(BINARY_FILE, error_fn, NULL)) == NULL) {
+	(void)fprintf(stderr, "%s: vnacal_load: %s\n",
+		progname, strerror(errno));
+	goto out;
+    }
+    if (validate_calibrations(vcp, ttp_table, type_table, types) == -1) {
+	goto out;
+    }
+    if ((cp_temp = vnacal_property_get(vcp, -1, "global_property")) == NULL ||
+	    strcmp(cp_temp, "47") != 0) {
+	(void)printf("property \"global_property\" not found or wrong\n");
+	goto out;
+    }
+
+    /*
+     * Saving it as text must give the same file as the original.
+     */
+    if (vnacal_save(vcp, COPY_FILE) == -1) {
+	(void)fprintf(stderr, "%s: vnacal_save: %s\n",
+		progname, strerror(errno));
+	goto out;
+    }
+    if (!compare_files(TEXT_FILE, COPY_FILE)) {
+	goto out;
+    }
+
+    /*
+     * Map the binary file from a second handle, then delete a
+     * calibration, overwrite the binary file we loaded from, and check
+     * that the remaining calibrations survive the round trip.
+     */
+    if ((vcp_other = vnacal_load(BINARY_FILE, error_fn, NULL)) == NULL) {
+	(void)fprintf(stderr, "%s: vnacal_load: %s\n",
+		progname, strerror(errno));
+	goto out;
+    }
+    if (vnacal_delete_calibration(vcp,
+		vnacal_find_calibration(vcp, "z0-vector")) == -1 ||
+	    vnacal_save(vcp, BINARY_FILE) == -1) {
+	(void)fprintf(stderr, "%s: vnacal_save: %s\n",
+		progname, strerror(errno));
+	goto out;
+    }
+    if (validate_calibrations(vcp, ttp_table, type_table, types) == -1) {
+	goto out;
+    }
+
+    /*
+     * The second handle must still see the file it loaded.
+     */
+    if (validate_calibrations(vcp_other, ttp_table, type_table,
+		types) == -1) {
+	goto out;
+    }
+    if (vnacal_find_calibration(vcp_other, "z0-vector") == -1) {
+	(void)printf("other handle lost a calibration after re-save\n");
+	goto out;
+    }
+    vnacal_free(vcp_other);
+    vcp_other = NULL;
+    vnacal_free(vcp);
+    if ((vcp = vnacal_load(BINARY_FILE, error_fn, NULL)) == NULL) {
+	(void)fprintf(stderr, "%s: vnacal_load: %s\n",
+		progname, strerror(errno));
+	goto out;
+    }
+    if (validate_calibrations(vcp, ttp_table, type_table, types) == -1) {
+	goto out;
+    }
+    if (vnacal_find_calibration(vcp, "z0-vector") != -1 ||
+	    vnacal_find_calibration(vcp, "z0-matrix") == -1) {
+	(void)printf("unexpected calibrations after re-save\n");
+	goto out;
+    }
+    vnacal_free(vcp);
+    vcp = NULL;
+
+    /*
+     * A truncated file must be rejected.
+     */
+    if (truncate(BINARY_FILE, 200) == -1) {
+	(void)fprintf(stderr, "%s: truncate: %s\n",
+		progname, strerror(errno));
+	goto out;
+    }
+    if ((vcp = vnacal_load(BINARY_FILE, error_fn, NULL)) != NULL) {
+	(void)printf("truncated binary file was accepted\n");
+	goto out;
+    }
+
+    /*
+     * A file with the wrong magic number must be rejected.
+     */
+    if ((fp = fopen(BINARY_FILE, "wb")) == NULL) {
+	(void)fprintf(stderr, "%s: fopen: %s\n", progname, strerror(errno));
+	goto out;
+    }
+    (void)fprintf(fp, "%c", VNACAL_BINARY_MAGIC[0]);
+    for (int i = 0; i < 256; ++i) {
+	(void)fputc('\000', fp);
+    }
+    (void)fclose(fp);
+    if ((vcp = vnacal_load(BINARY_FILE, error_fn, NULL)) != NULL) {
+	(void)printf("binary file with bad magic number was accepted\n");
+	goto out;
+    }
+    result = T_PASS;
+
+out:
+    for (int tindex = 0; tindex < types; ++tindex) {
+	libt_vnacal_free_error_terms(ttp_table[tindex]);
+    }
+    vnacal_free(vcp_other);
+    vnacal_free(vcp);
+    return result;
+}
+
+/*
+ * test_vnacal_binary
+ */
+static libt_result_t test_vnacal_binary()
+{
+    libt_result_t result = T_FAIL;
+
+    for (int trial = 0; trial < 5; ++trial) {
+	result = run_vnacal_binary_trial(trial);
+	if (result != T_PASS)
+	    goto out;
+    }
+    result = T_PASS;
+
+out:
+    libt_report(result);
+    return result;
+}
+
+/*
+ * print_usage: print a usage message and exit
+ */
+static void print_usage()
+{
+    const char *const *cpp;
+
+    for (cpp = usage; *cpp != NULL; ++cpp) {
+	(void)fprintf(stderr, "%s: usage %s\n", progname, *cpp);
+    }
+    for (cpp = help; *cpp != NULL; ++cpp) {
+	(void)fprintf(stderr, "%s\n", *cpp);
+    }
+    exit(99);
+}
+
+/*
+ * main
+ */
+int
+main(int argc, char **argv)
+{
+    /*
+     * Parse Options
+     */
+    if ((char *)NULL == (progname = strrchr(argv[0], '/'))) {
+	progname = argv[0];
+    } else {
+	++progname;
+    }
+    for (;;) {
+	switch (getopt(argc, argv, options)) {
+	case -1:
+	    break;
+
+	case 'a':
+	    opt_a = true;
+	    continue;
+
+	case 'v':
+	    ++opt_v;
+	    continue;
+
+	default:
+	    print_usage();
+	}
+	break;
+    }
+    libt_isequal_init();
+    exit(test_vnacal_binary());
+}
@@ -0,0 +1,571 @@
+/*
+ * Vector Network Analyzer Library
+ * Copyright © 2020-2024 D Scott Guthridge <scott_guthridge@rompromity.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "archdep.h"
+
+#include <assert.h>
+#include <complex.h>
+#include <errno.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include "vnacal_internal.h"
+#include "libt.h"
+#include "libt_crand.h"
+
+
+#define N_TRIALS	10
+#define FREQUENCIES	401
+#define PORTS		2
+#define F_MIN		1.0e+6
+#define F_MAX		1.0e+9
+#define TEST_FILE	"test-vnacal-compact.vnacal"
+#define TEST_BINARY_FILE "test-vnacal-compact.vnacalb"
+
+/*
+ * Options
+ */
+char *progname;
+static const char options[] = "av";
+static const char *const usage[] = {
+    "[-av]",
+    NULL
+};
+static const char *const help[] = {
+    "-a	 abort on data miscompare",
+    "-v	 show verbose output",
+    NULL
+};
+bool opt_a = false;
+int opt_v = 0;
+
+/*
+ * smooth_term_t: parameters of a smooth synthetic error term
+ */
+typedef struct smooth_term {
+    double complex st_a;	/* value at F_MIN */
+    double complex st_b;	/* slope term */
+    double st_turns;		/* phase rotation over the range */
+} smooth_term_t;
+
+/*
+ * error_fn: error reporting function
+ *   @message: error message
+ *   @arg: (unused)
+ *   @category: error category (unused)
+ */
+static void error_fn(const char *message, void *arg,
+	vnaerr_category_t category)
+{
+    if (opt_v != 0) {
+	(void)printf("%s: %s\n", progname, message);
+    }
+}
+
+/*
+ * make_term: choose random parameters for a smooth error term
+ *   @stp: term to fill in
+ */
+static void make_term(smooth_term_t *stp)
+{
+    stp->st_a = libt_crandn();
+    stp->st_b = 0.2 * libt_crandn();
+    stp->st_turns = libt_randu(0.0, 4.0);
+}
+
+/*
+ * eval_term: evaluate a smooth error term at f
+ *   @stp: term parameters
+ *   @f: frequency
+ */
+static double complex eval_term(const smooth_term_t *stp, double f)
+{
+    const double u = (f - F_MIN) / (F_MAX - F_MIN);
+
+    return (stp->st_a + stp->st_b * u) *
+	cexp(-2.0 * M_PI * I * stp->st_turns * u);
+}
+
+/*
+ * make_grid: make an increasing, oversampled frequency grid
+ *   @xp: caller-allocated vector of FREQUENCIES values
+ */
+static void make_grid(double *xp)
+{
+    for (int i = 0; i < FREQUENCIES; ++i) {
+	xp[i] = F_MIN + (F_MAX - F_MIN) * i / (FREQUENCIES - 1);
+    }
+}
+
+/*
+ * fail: report a failure
+ */
+static libt_result_t fail()
+{
+    if (opt_a) {
+	assert(!"data miscompare");
+    }
+    return T_FAIL;
+}
+
+/*
+ * free_model: free the vectors of a model filled by _vnacal_model_fit
+ *   @vmap: allocator given to _vnacal_model_fit
+ *   @vmp: model
+ */
+static void free_model(const vnamem_allocator_t *vmap, vnacal_model_t *vmp)
+{
+    _vnamem_afree(vmap, (void *)vmp->vm_coefficient_vector);
+    _vnamem_afree(vmap, (void *)vmp->vm_breakpoint_vector);
+    (void)memset((void *)vmp, 0, sizeof(*vmp));
+}
+
+/*
+ * test_model_fit: test _vnacal_model_fit and _vnacal_model_eval
+ */
+static libt_result_t test_model_fit()
+{
+    double xp[FREQUENCIES];
+    double complex yp[FREQUENCIES];
+    vnamem_allocator_t allocator;
+    vnacal_model_t model;
+    libt_result_t result = T_SKIPPED;
+
+    vnamem_get_allocator(&allocator);
+    (void)memset((void *)&model, 0, sizeof(model));
+    make_grid(xp);
+    for (int trial = 1; trial <= N_TRIALS; ++trial) {
+	const double tolerance = pow(10.0, -libt_randu(3.0, 9.0));
+	const bool smooth = trial & 1;
+	smooth_term_t term;
+	double max_error = 0.0;
+	int segment = 0;
+
+	make_term(&term);
+	for (int i = 0; i < FREQUENCIES; ++i) {
+	    yp[i] = smooth ? eval_term(&term, xp[i]) : libt_crandn();
+	}
+	if (_vnacal_model_fit(&allocator, xp, yp, FREQUENCIES, tolerance,
+		    &model) == -1) {
+	    libt_error("_vnacal_model_fit: %s\n", strerror(errno));
+	}
+	if (opt_v) {
+	    (void)printf("Test model fit: trial %2d %-6s tolerance %8.2e "
+		    "segments %3d fit error %8.2e\n", trial,
+		    smooth ? "smooth" : "noise", tolerance,
+		    model.vm_segments, model.vm_fit_error);
+	}
+
+	/*
+	 * The fit must be within tolerance at every point, and the
+	 * reported fit error must be the largest error found.
+	 */
+	for (int i = 0; i < FREQUENCIES; ++i) {
+	    double complex y = _vnacal_model_eval(&model, xp[i], &segment);
+
+	    max_error = MAX(max_error, cabs(y - yp[i]));
+	}
+	if (max_error > tolerance ||
+		fabs(max_error - model.vm_fit_error) > 1.0e-3 * tolerance) {
+	    (void)printf("%s: fit error %e reported %e tolerance %e\n",
+		    progname, max_error, model.vm_fit_error, tolerance);
+	    result = fail();
+	    goto out;
+	}
+
+	/*
+	 * Smooth oversampled terms must compact, and the model must
+	 * follow the function between the points.
+	 */
+	if (smooth) {
+	    if (model.vm_segments > (FREQUENCIES - 1) / 4) {
+		(void)printf("%s: smooth term not compacted: %d segments\n",
+			progname, model.vm_segments);
+		result = fail();
+		goto out;
+	    }
+	    for (int i = 0; i < FREQUENCIES - 1; ++i) {
+		double f = libt_randu(xp[i], xp[i + 1]);
+		double complex y = _vnacal_model_eval(&model, f, &segment);
+
+		if (cabs(y - eval_term(&term, f)) > 10.0 * tolerance) {
+		    (void)printf("%s: f %e: %f%+fj != %f%+fj\n",
+			    progname, f, creal(y), cimag(y),
+			    creal(eval_term(&term, f)),
+			    cimag(eval_term(&term, f)));
+		    result = fail();
+		    goto out;
+		}
+	    }
+	}
+	free_model(&allocator, &model);
+    }
+    result = T_PASS;
+
+out:
+    free_model(&allocator, &model);
+    libt_report(result);
+    return result;
+}
+
+/*
+ * add_calibration: add a T8 calibration with smooth error terms
+ *   @vcp: vnacal structure
+ *   @name: name of the calibration
+ *   @xp: frequency vector
+ *   @term_vector: parameters of each error term
+ */
+static int add_calibration(vnacal_t *vcp, const char *name,
+	const double *xp, const smooth_term_t *term_vector)
+{
+    vnacal_layout_t vl;
+    vnacal_calibration_t *calp;
+
+    _vnacal_layout(&vl, VNACAL_T8, PORTS, PORTS);
+    if ((calp = _vnacal_calibration_alloc(vcp, VNACAL_T8, PORTS, PORTS,
+		    FREQUENCIES, VNACAL_Z0_SCALAR,
+		    VL_ERROR_TERMS(&vl))) == NULL) {
+	return -1;
+    }
+    calp->cal_z0 = 50.0;
+    for (int findex = 0; findex < FREQUENCIES; ++findex) {
+	calp->cal_frequency_vector[findex] = xp[findex];
+    }
+    for (int term = 0; term < calp->cal_error_terms; ++term) {
+	for (int findex = 0; findex < FREQUENCIES; ++findex) {
+	    calp->cal_error_term_vector[term][findex] =
+		eval_term(&term_vector[term], xp[findex]);
+	}
+    }
+    if (_vnacal_add_calibration_common(__func__, vcp, calp, name) == -1) {
+	_vnacal_calibration_free(calp);
+	return -1;
+    }
+    return vnacal_find_calibration(vcp, name);
+}
+
+/*
+ * check_fit_error: check vnacal_get_fit_error against the tolerance
+ *   @vcp: vnacal structure
+ *   @ci: calibration index
+ *   @tolerance: tolerance given to vnacal_compact
+ *   @error_vector: caller-allocated vector to receive the errors
+ *   @terms: number of error terms
+ */
+static bool check_fit_error(vnacal_t *vcp, int ci, double tolerance,
+	double *error_vector, int terms)
+{
+    if (vnacal_get_fit_error(vcp, ci, error_vector, terms) != terms) {
+	(void)printf("%s: vnacal_get_fit_error: %s\n", progname,
+		strerror(errno));
+	return false;
+    }
+    for (int term = 0; term < terms; ++term) {
+	if (error_vector[term] > tolerance) {
+	    (void)printf("%s: term %d: fit error %e exceeds %e\n",
+		    progname, term, error_vector[term], tolerance);
+	    return false;
+	}
+    }
+    return true;
+}
+
+/*
+ * apply_and_compare: apply both calibrations and compare the results
+ *   @vcp: vnacal structure
+ *   @ci_raw: uncompacted calibration
+ *   @ci_compact: compacted calibration
+ *   @xp: calibration frequency vector
+ */
+static bool apply_and_compare(vnacal_t *vcp, int ci_raw, int ci_compact,
+	const double *xp)
+{
+    double complex m[PORTS * PORTS][FREQUENCIES];
+    double complex *m_matrix[PORTS * PORTS];
+    vnadata_t *raw_vdp = NULL, *compact_vdp = NULL;
+    bool ok = false;
+
+    for (int cell = 0; cell < PORTS * PORTS; ++cell) {
+	m_matrix[cell] = m[cell];
+	for (int findex = 0; findex < FREQUENCIES; ++findex) {
+	    m[cell][findex] = libt_crandn();
+	}
+    }
+    if ((raw_vdp = vnadata_alloc(error_fn, NULL)) == NULL ||
+	    (compact_vdp = vnadata_alloc(error_fn, NULL)) == NULL) {
+	libt_error("vnadata_alloc: %s\n", strerror(errno));
+    }
+    if (vnacal_apply_m(vcp, ci_raw, xp, FREQUENCIES, m_matrix,
+		PORTS, PORTS, raw_vdp) == -1 ||
+	    vnacal_apply_m(vcp, ci_compact, xp, FREQUENCIES, m_matrix,
+		PORTS, PORTS, compact_vdp) == -1) {
+	libt_error("vnacal_apply_m: %s\n", strerror(errno));
+    }
+    for (int findex = 0; findex < FREQUENCIES; ++findex) {
+	for (int row = 0; row < PORTS; ++row) {
+	    for (int column = 0; column < PORTS; ++column) {
+		double complex expected, actual;
+
+		expected = vnadata_get_cell(raw_vdp, findex, row, column);
+		actual = vnadata_get_cell(compact_vdp, findex, row, column);
+		if (!libt_isequal(actual, expected)) {
+		    (void)fail();
+		    goto out;
+		}
+	    }
+	}
+    }
+    ok = true;
+
+out:
+    vnadata_free(compact_vdp);
+    vnadata_free(raw_vdp);
+    return ok;
+}
+
+/*
+ * check_compacted: check that a calibration holds only the models
+ *   @vcp: vnacal structure
+ *   @ci: calibration index
+ *   @tolerance: tolerance given to vnacal_compact
+ *   @expected_error: fit errors reported before save and load
+ *   @terms: number of error terms
+ */
+static bool check_compacted(vnacal_t *vcp, int ci, double tolerance,
+	const double *expected_error, int terms)
+{
+    const vnacal_calibration_t *calp = vcp->vc_calibration_vector[ci];
+    double error_vector[terms];
+
+    if (calp->cal_error_term_vector != NULL) {
+	(void)printf("%s: error term vectors not freed\n", progname);
+	return false;
+    }
+    if (calp->cal_compact_tolerance != tolerance) {
+	(void)printf("%s: compact tolerance %e != %e\n", progname,
+		calp->cal_compact_tolerance, tolerance);
+	return false;
+    }
+    if (vnacal_property_type(vcp, ci, "compact_tolerance") != -1) {
+	(void)printf("%s: compact tolerance stored in the calibration "
+		"properties\n", progname);
+	return false;
+    }
+    if (!check_fit_error(vcp, ci, tolerance, error_vector, terms)) {
+	return false;
+    }
+    for (int term = 0; term < terms; ++term) {
+	if (error_vector[term] != expected_error[term]) {
+	    (void)printf("%s: term %d: fit error %e != %e\n", progname,
+		    term, error_vector[term], expected_error[term]);
+	    return false;
+	}
+    }
+    return true;
+}
+
+/*
+ * test_vnacal_compact: test vnacal_compact and vnacal_get_fit_error
+ */
+static libt_result_t test_vnacal_compact()
+{
+    const double tolerance = 1.0e-10;
+    double xp[FREQUENCIES];
+    vnacal_layout_t vl;
+    vnacal_t *vcp = NULL;
+    int ci_raw, ci_compact;
+    libt_result_t result = T_SKIPPED;
+
+    if (opt_v) {
+	(void)printf("Test vnacal_compact\n");
+	(void)fflush(stdout);
+    }
+    _vnacal_layout(&vl, VNACAL_T8, PORTS, PORTS);
+    {
+	const int terms = VL_ERROR_TERMS(&vl);
+	smooth_term_t term_vector[terms];
+	double error_vector[terms];
+	double saved_error_vector[terms];
+
+	if ((vcp = vnacal_create(error_fn, NULL)) == NULL) {
+	    libt_error("vnacal_create: %s\n", strerror(errno));
+	}
+	make_grid(xp);
+	for (int term = 0; term < terms; ++term) {
+	    make_term(&term_vector[term]);
+	}
+	if ((ci_raw = add_calibration(vcp, "raw", xp, term_vector)) == -1 ||
+		(ci_compact = add_calibration(vcp, "compact", xp,
+			term_vector)) == -1) {
+	    libt_error("add_calibration: %s\n", strerror(errno));
+	}
+
+	/*
+	 * Until compacted, there is no fit error to report.
+	 */
+	if (vnacal_get_fit_error(vcp, ci_compact, error_vector,
+		    terms) != -1) {
+	    (void)printf("%s: vnacal_get_fit_error: expected failure\n",
+		    progname);
+	    result = fail();
+	    goto out;
+	}
+	if (vnacal_compact(vcp, ci_compact, -1.0) != -1 ||
+		vnacal_compact(vcp, ci_compact, 0.0) != -1) {
+	    (void)printf("%s: vnacal_compact: non-positive tolerance "
+		    "not rejected\n", progname);
+	    result = fail();
+	    goto out;
+	}
+
+	/*
+	 * Compact and compare with the interpolated calibration.
+	 */
+	if (vnacal_compact(vcp, ci_compact, tolerance) == -1) {
+	    libt_error("vnacal_compact: %s\n", strerror(errno));
+	}
+	if (!check_fit_error(vcp, ci_compact, tolerance, error_vector,
+		    terms) ||
+		!apply_and_compare(vcp, ci_raw, ci_compact, xp)) {
+	    result = T_FAIL;
+	    goto out;
+	}
+	(void)memcpy((void *)saved_error_vector, (void *)error_vector,
+		sizeof(saved_error_vector));
+	if (!check_compacted(vcp, ci_compact, tolerance, saved_error_vector,
+		    terms)) {
+	    result = fail();
+	    goto out;
+	}
+
+	/*
+	 * The error terms are gone, so compacting is final.
+	 */
+	if (vnacal_compact(vcp, ci_compact, 2.0 * tolerance) != -1) {
+	    (void)printf("%s: vnacal_compact: second compaction "
+		    "not rejected\n", progname);
+	    result = fail();
+	    goto out;
+	}
+
+	/*
+	 * The models must survive save and load in both formats.
+	 * Save at full precision so that the coefficients are exact.
+	 */
+	if (vnacal_set_fprecision(vcp, VNACAL_MAX_PRECISION) == -1 ||
+		vnacal_set_dprecision(vcp, VNACAL_MAX_PRECISION) == -1) {
+	    libt_error("vnacal_set_precision: %s\n", strerror(errno));
+	}
+	if (vnacal_save(vcp, TEST_FILE) == -1 ||
+		vnacal_save(vcp, TEST_BINARY_FILE) == -1) {
+	    libt_error("vnacal_save: %s\n", strerror(errno));
+	}
+	for (int i = 0; i < 2; ++i) {
+	    const char *filename = i == 0 ? TEST_FILE : TEST_BINARY_FILE;
+
+	    vnacal_free(vcp);
+	    if ((vcp = vnacal_load(filename, error_fn, NULL)) == NULL) {
+		libt_error("vnacal_load: %s: %s\n", filename,
+			strerror(errno));
+	    }
+	    if ((ci_raw = vnacal_find_calibration(vcp, "raw")) == -1 ||
+		    (ci_compact = vnacal_find_calibration(vcp,
+			    "compact")) == -1) {
+		libt_error("vnacal_find_calibration: %s\n", strerror(errno));
+	    }
+	    if (!check_compacted(vcp, ci_compact, tolerance,
+			saved_error_vector, terms) ||
+		    !apply_and_compare(vcp, ci_raw, ci_compact, xp)) {
+		(void)printf("%s: after loading %s\n", progname, filename);
+		result = fail();
+		goto out;
+	    }
+	}
+    }
+    result = T_PASS;
+
+out:
+    vnacal_free(vcp);
+    libt_report(result);
+    return result;
+}
+
+/*
+ * print_usage: print a usage message and exit
+ */
+static void print_usage()
+{
+    const char *const *cpp;
+
+    for (cpp = usage; *cpp != NULL; ++cpp) {
+	(void)fprintf(stderr, "%s: usage %s\n", progname, *cpp);
+    }
+    for (cpp = help; *cpp != NULL; ++cpp) {
+	(void)fprintf(stderr, "%s\n", *cpp);
+    }
+    exit(2);
+}
+
+/*
+ * main: test program
+ */
+int
+main(int argc, char **argv)
+{
+    libt_result_t result;
+
+    if ((char *)NULL == (progname = strrchr(argv[0], '/'))) {
+	progname = argv[0];
+    } else {
+	++progname;
+    }
+    for (;;) {
+	switch (getopt(argc, argv, options)) {
+	case 'a':
+	    opt_a = true;
+	    continue;
+
+	case 'v':
+	    ++opt_v;
+	    continue;
+
+	case -1:
+	    break;
+
+	default:
+	    print_usage();
+	}
+	break;
+    }
+    argc -= optind;
+    argv += optind;
+    if (argc != 0) {
+	print_usage();
+    }
+
+    libt_isequal_init();
+    if ((result = test_model_fit()) != T_PASS) {
+	exit(result);
+    }
+    exit(test_vnacal_compact());
+}
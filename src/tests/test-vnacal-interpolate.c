@@ -0,0 +1,615 @@
+/*
+ * Vector Network Analyzer Library
+ * Copyright © 2020-2024 D Scott Guthridge <scott_guthridge@rompromity.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "archdep.h"
+
+#include <assert.h>
+#include <complex.h>
+#include <errno.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include "vnacal_internal.h"
+#include "vnacommon_internal.h"
+#include "libt.h"
+#include "libt_crand.h"
+
+
+#define N_TRIALS	20
+#define FREQUENCIES	10
+#define PORTS		2
+#define TEST_FILE	"test-vnacal-interpolate.vnacal"
+#define TEST_BINARY_FILE "test-vnacal-interpolate.vnacalb"
+
+/*
+ * Options
+ */
+char *progname;
+static const char options[] = "av";
+static const char *const usage[] = {
+    "[-av]",
+    NULL
+};
+static const char *const help[] = {
+    "-a	 abort on data miscompare",
+    "-v	 show verbose output",
+    NULL
+};
+bool opt_a = false;
+int opt_v = 0;
+
+/*
+ * method_vector: methods under test
+ */
+static const vnacal_interpolation_t method_vector[] = {
+    VNACAL_INTERP_RATIONAL,
+    VNACAL_INTERP_LINEAR,
+    VNACAL_INTERP_POLAR,
+    VNACAL_INTERP_SPLINE
+};
+#define N_METHODS	(sizeof(method_vector) / sizeof(method_vector[0]))
+
+/*
+ * error_fn: error reporting function
+ *   @message: error message
+ *   @arg: (unused)
+ *   @category: error category (unused)
+ */
+static void error_fn(const char *message, void *arg,
+	vnaerr_category_t category)
+{
+    if (opt_v != 0) {
+	(void)printf("%s: %s\n", progname, message);
+    }
+}
+
+/*
+ * reference_interpolate: interpolate independently of the library plan
+ *   @method: interpolation method
+ *   @xp: vector of x points
+ *   @yp: vector of y points
+ *   @n: length of xp and yp (at least 3)
+ *   @x: dependent variable to interpolate
+ */
+static double complex reference_interpolate(vnacal_interpolation_t method,
+	const double *xp, const double complex *yp, int n, double x)
+{
+    int segment = 0;
+    double t;
+
+    if (method == VNACAL_INTERP_RATIONAL) {
+	return _vnacal_rfi(xp, yp, n, MIN(n, VNACAL_MAX_M), &segment, x);
+    }
+    if (method == VNACAL_INTERP_SPLINE) {
+	double real_vector[n], imag_vector[n];
+	double real_spline[n - 1][3], imag_spline[n - 1][3];
+
+	for (int i = 0; i < n; ++i) {
+	    real_vector[i] = creal(yp[i]);
+	    imag_vector[i] = cimag(yp[i]);
+	}
+	if (_vnacommon_spline_calc(n - 1, xp, real_vector,
+		    real_spline) == -1 ||
+		_vnacommon_spline_calc(n - 1, xp, imag_vector,
+		    imag_spline) == -1) {
+	    libt_error("_vnacommon_spline_calc: %s\n", strerror(errno));
+	}
+	return _vnacommon_spline_eval(n - 1, xp, real_vector,
+		(const double (*)[3])real_spline, x) +
+	    I * _vnacommon_spline_eval(n - 1, xp, imag_vector,
+		(const double (*)[3])imag_spline, x);
+    }
+    while (segment < n - 2 && x > xp[segment + 1]) {
+	++segment;
+    }
+    t = (x - xp[segment]) / (xp[segment + 1] - xp[segment]);
+    if (method == VNACAL_INTERP_POLAR) {
+	double r0 = cabs(yp[segment]), r1 = cabs(yp[segment + 1]);
+	double phi0 = carg(yp[segment]), phi1 = carg(yp[segment + 1]);
+
+	if (phi1 - phi0 > M_PI) {
+	    phi1 -= 2.0 * M_PI;
+	} else if (phi1 - phi0 < -M_PI) {
+	    phi1 += 2.0 * M_PI;
+	}
+	return (r0 + t * (r1 - r0)) * cexp(I * (phi0 + t * (phi1 - phi0)));
+    }
+    return (1.0 - t) * yp[segment] + t * yp[segment + 1];
+}
+
+/*
+ * make_grid: make an increasing frequency grid
+ *   @xp: caller-allocated vector of n frequencies
+ *   @n: number of frequencies
+ */
+static void make_grid(double *xp, int n)
+{
+    xp[0] = libt_randu(1.0e+6, 2.0e+6);
+    for (int i = 1; i < n; ++i) {
+	xp[i] = xp[i - 1] + libt_randu(1.0e+5, 1.0e+6);
+    }
+}
+
+/*
+ * check: compare a result with the expected value
+ *   @label: description of the value
+ *   @actual: actual value
+ *   @expected: expected value
+ */
+static bool check(const char *label, double complex actual,
+	double complex expected)
+{
+    if (opt_v > 1) {
+	(void)printf("  %-24s %9.6f%+9.6fj  %9.6f%+9.6fj\n", label,
+		creal(actual), cimag(actual),
+		creal(expected), cimag(expected));
+    }
+    if (!libt_isequal(actual, expected)) {
+	if (opt_a) {
+	    assert(!"data miscompare");
+	}
+	return false;
+    }
+    return true;
+}
+
+/*
+ * test_interpolate_points: test the point interpolators
+ */
+static libt_result_t test_interpolate_points()
+{
+    double xp[FREQUENCIES];
+    double complex yp[FREQUENCIES];
+    double complex linear_yp[FREQUENCIES];
+    double complex polar_yp[FREQUENCIES];
+    double complex *y_vector[1] = { yp };
+    vnamem_allocator_t allocator;
+    vnacal_spline_t **spline_vector = NULL;
+    libt_result_t result = T_SKIPPED;
+
+    vnamem_get_allocator(&allocator);
+    for (int trial = 1; trial <= N_TRIALS; ++trial) {
+	const double complex a = libt_crandn();
+	const double complex b = libt_crandn();
+	const double phase = libt_randu(-M_PI, M_PI);
+
+	if (opt_v) {
+	    (void)printf("Test interpolate points: trial %d\n", trial);
+	    (void)fflush(stdout);
+	}
+	make_grid(xp, FREQUENCIES);
+	for (int i = 0; i < FREQUENCIES; ++i) {
+	    double u = (xp[i] - xp[0]) / (xp[FREQUENCIES - 1] - xp[0]);
+
+	    yp[i] = libt_crandn();
+	    linear_yp[i] = a + b * u;
+	    polar_yp[i] = (1.0 + u) * cexp(I * phase);
+	}
+	if ((spline_vector = _vnacal_spline_alloc_vector(&allocator,
+			xp, FREQUENCIES, y_vector, 1)) == NULL) {
+	    libt_error("_vnacal_spline_alloc_vector: %s\n", strerror(errno));
+	}
+	for (int mi = 0; mi < N_METHODS; ++mi) {
+	    const vnacal_interpolation_t method = method_vector[mi];
+	    const vnacal_spline_t *sp = method == VNACAL_INTERP_SPLINE ?
+		spline_vector[0] : NULL;
+	    int segment = 0;
+
+	    if (opt_v > 1) {
+		(void)printf(" method %s\n",
+			vnacal_interpolation_to_name(method));
+	    }
+
+	    /*
+	     * All methods must pass through the sample points.
+	     */
+	    for (int i = 0; i < FREQUENCIES; ++i) {
+		vnacal_interp_point_t point;
+
+		_vnacal_interp_setup_point(method, xp, FREQUENCIES,
+			&segment, xp[i], &point);
+		if (!check("sample", _vnacal_interp_eval_point(&point,
+				yp, sp), yp[i])) {
+		    result = T_FAIL;
+		    goto out;
+		}
+	    }
+
+	    /*
+	     * Compare with the reference at random points.
+	     */
+	    segment = 0;
+	    for (int i = 0; i < FREQUENCIES - 1; ++i) {
+		double x = libt_randu(xp[i], xp[i + 1]);
+		vnacal_interp_point_t point;
+
+		_vnacal_interp_setup_point(method, xp, FREQUENCIES,
+			&segment, x, &point);
+		if (!check("between", _vnacal_interp_eval_point(&point,
+				yp, sp), reference_interpolate(method,
+				xp, yp, FREQUENCIES, x))) {
+		    result = T_FAIL;
+		    goto out;
+		}
+
+		/*
+		 * Linear must be exact on linear data, and polar
+		 * on data of constant phase and linear magnitude.
+		 */
+		if (method == VNACAL_INTERP_LINEAR) {
+		    double u = (x - xp[0]) / (xp[FREQUENCIES - 1] - xp[0]);
+
+		    if (!check("linear", _vnacal_interp_eval_point(&point,
+				    linear_yp, NULL), a + b * u)) {
+			result = T_FAIL;
+			goto out;
+		    }
+		}
+		if (method == VNACAL_INTERP_POLAR) {
+		    double u = (x - xp[0]) / (xp[FREQUENCIES - 1] - xp[0]);
+
+		    if (!check("polar", _vnacal_interp_eval_point(&point,
+				    polar_yp, NULL),
+				(1.0 + u) * cexp(I * phase))) {
+			result = T_FAIL;
+			goto out;
+		    }
+		}
+	    }
+	}
+	_vnacal_spline_free_vector(&allocator, spline_vector, 1);
+	spline_vector = NULL;
+    }
+    result = T_PASS;
+
+out:
+    _vnacal_spline_free_vector(&allocator, spline_vector, 1);
+    libt_report(result);
+    return result;
+}
+
+/*
+ * check_z0_vector: check vnacal_get_z0_vector against the reference
+ *   @vcp: vnacal structure
+ *   @ci: calibration index
+ *   @method: expected interpolation method
+ *   @xp: frequency vector of the calibration
+ *   @z0_matrix: reference impedances by port, frequency
+ */
+static bool check_z0_vector(vnacal_t *vcp, int ci,
+	vnacal_interpolation_t method, const double *xp,
+	double complex z0_matrix[PORTS][FREQUENCIES])
+{
+    if (vnacal_get_interpolation(vcp, ci) != method) {
+	(void)printf("%s: vnacal_get_interpolation: expected %s; found %d\n",
+		progname, vnacal_interpolation_to_name(method),
+		(int)vnacal_get_interpolation(vcp, ci));
+	return false;
+    }
+    for (int i = 0; i < FREQUENCIES - 1; ++i) {
+	double f = libt_randu(xp[i], xp[i + 1]);
+	double complex z0_vector[PORTS];
+
+	if (vnacal_get_z0_vector(vcp, ci, f, z0_vector, PORTS) == -1) {
+	    libt_error("vnacal_get_z0_vector: %s\n", strerror(errno));
+	}
+	for (int port = 0; port < PORTS; ++port) {
+	    if (!check("z0", z0_vector[port], reference_interpolate(method,
+			    xp, z0_matrix[port], FREQUENCIES, f))) {
+		return false;
+	    }
+	}
+    }
+    return true;
+}
+
+/*
+ * test_calibration_interpolation: test set, get, save and load
+ */
+static libt_result_t test_calibration_interpolation()
+{
+    double xp[FREQUENCIES];
+    double complex z0_matrix[PORTS][FREQUENCIES];
+    vnacal_t *vcp = NULL;
+    vnacal_layout_t vl;
+    vnacal_calibration_t *calp;
+    int ci;
+    libt_result_t result = T_SKIPPED;
+
+    if (opt_v) {
+	(void)printf("Test calibration interpolation\n");
+	(void)fflush(stdout);
+    }
+    if ((vcp = vnacal_create(error_fn, NULL)) == NULL) {
+	libt_error("vnacal_create: %s\n", strerror(errno));
+    }
+
+    /*
+     * Make a calibration with frequency-dependent reference impedances.
+     */
+    make_grid(xp, FREQUENCIES);
+    _vnacal_layout(&vl, VNACAL_T8, PORTS, PORTS);
+    if ((calp = _vnacal_calibration_alloc(vcp, VNACAL_T8, PORTS, PORTS,
+		    FREQUENCIES, VNACAL_Z0_MATRIX,
+		    VL_ERROR_TERMS(&vl))) == NULL) {
+	libt_error("_vnacal_calibration_alloc: %s\n", strerror(errno));
+    }
+    for (int findex = 0; findex < FREQUENCIES; ++findex) {
+	calp->cal_frequency_vector[findex] = xp[findex];
+    }
+    for (int term = 0; term < calp->cal_error_terms; ++term) {
+	for (int findex = 0; findex < FREQUENCIES; ++findex) {
+	    calp->cal_error_term_vector[term][findex] = libt_crandn();
+	}
+    }
+    for (int port = 0; port < PORTS; ++port) {
+	for (int findex = 0; findex < FREQUENCIES; ++findex) {
+	    z0_matrix[port][findex] = 50.0 + 10.0 * libt_crandn();
+	    calp->cal_z0_matrix[port][findex] = z0_matrix[port][findex];
+	}
+    }
+    if (_vnacal_add_calibration_common(__func__, vcp, calp, "cal") == -1) {
+	_vnacal_calibration_free(calp);
+	libt_error("_vnacal_add_calibration_common: %s\n", strerror(errno));
+    }
+    if ((ci = vnacal_find_calibration(vcp, "cal")) == -1) {
+	libt_error("vnacal_find_calibration: %s\n", strerror(errno));
+    }
+
+    /*
+     * The default is rational.  Try each method in turn.
+     */
+    if (!check_z0_vector(vcp, ci, VNACAL_INTERP_RATIONAL, xp, z0_matrix)) {
+	result = T_FAIL;
+	goto out;
+    }
+    for (int mi = 0; mi < N_METHODS; ++mi) {
+	if (vnacal_set_interpolation(vcp, ci, method_vector[mi]) == -1) {
+	    libt_error("vnacal_set_interpolation: %s\n", strerror(errno));
+	}
+	if (!check_z0_vector(vcp, ci, method_vector[mi], xp, z0_matrix)) {
+	    result = T_FAIL;
+	    goto out;
+	}
+    }
+
+    /*
+     * Invalid methods must be rejected without changing the method.
+     */
+    if (vnacal_set_interpolation(vcp, ci,
+		(vnacal_interpolation_t)17) != -1 ||
+	    vnacal_get_interpolation(vcp, ci) != VNACAL_INTERP_SPLINE) {
+	(void)printf("%s: vnacal_set_interpolation: invalid method "
+		"not rejected\n", progname);
+	result = T_FAIL;
+	goto out;
+    }
+    if (vnacal_name_to_interpolation("Polar") != VNACAL_INTERP_POLAR ||
+	    vnacal_name_to_interpolation("cubic") != VNACAL_INTERP_INVALID ||
+	    vnacal_interpolation_to_name(VNACAL_INTERP_INVALID) != NULL) {
+	(void)printf("%s: interpolation name conversion failed\n",
+		progname);
+	result = T_FAIL;
+	goto out;
+    }
+
+    /*
+     * The method is not a user property.
+     */
+    if (vnacal_property_type(vcp, ci, "interpolation") != -1) {
+	(void)printf("%s: vnacal_set_interpolation: method stored in "
+		"the calibration properties\n", progname);
+	result = T_FAIL;
+	goto out;
+    }
+
+    /*
+     * The method must survive save and load in both formats.  Save
+     * at full precision so that the loaded values interpolate
+     * identically.
+     */
+    if (vnacal_set_fprecision(vcp, 17) == -1 ||
+	    vnacal_set_dprecision(vcp, 17) == -1) {
+	libt_error("vnacal_set_precision: %s\n", strerror(errno));
+    }
+    if (vnacal_save(vcp, TEST_FILE) == -1) {
+	libt_error("vnacal_save: %s\n", strerror(errno));
+    }
+    if (vnacal_save(vcp, TEST_BINARY_FILE) == -1) {
+	libt_error("vnacal_save: %s\n", strerror(errno));
+    }
+    for (int i = 0; i < 2; ++i) {
+	const char *filename = i == 0 ? TEST_FILE : TEST_BINARY_FILE;
+
+	vnacal_free(vcp);
+	if ((vcp = vnacal_load(filename, error_fn, NULL)) == NULL) {
+	    libt_error("vnacal_load: %s: %s\n", filename, strerror(errno));
+	}
+	if ((ci = vnacal_find_calibration(vcp, "cal")) == -1) {
+	    libt_error("vnacal_find_calibration: %s\n", strerror(errno));
+	}
+	if (!check_z0_vector(vcp, ci, VNACAL_INTERP_SPLINE, xp, z0_matrix)) {
+	    result = T_FAIL;
+	    goto out;
+	}
+	if (vnacal_property_type(vcp, ci, "interpolation") != -1) {
+	    (void)printf("%s: vnacal_load: %s: method stored in the "
+		    "calibration properties\n", progname, filename);
+	    result = T_FAIL;
+	    goto out;
+	}
+    }
+    result = T_PASS;
+
+out:
+    vnacal_free(vcp);
+    libt_report(result);
+    return result;
+}
+
+/*
+ * test_parameter_interpolation: test interpolation of data and vector
+ *	parameters
+ */
+static libt_result_t test_parameter_interpolation()
+{
+    double xp[FREQUENCIES];
+    double complex yp[FREQUENCIES];
+    vnacal_t *vcp = NULL;
+    vnadata_t *vdp = NULL;
+    int parameter, vector, scalar;
+    libt_result_t result = T_SKIPPED;
+
+    if (opt_v) {
+	(void)printf("Test parameter interpolation\n");
+	(void)fflush(stdout);
+    }
+    if ((vcp = vnacal_create(error_fn, NULL)) == NULL) {
+	libt_error("vnacal_create: %s\n", strerror(errno));
+    }
+    if ((vdp = vnadata_alloc_and_init(error_fn, NULL, VPT_S, 1, 1,
+		    FREQUENCIES)) == NULL) {
+	libt_error("vnadata_alloc_and_init: %s\n", strerror(errno));
+    }
+    make_grid(xp, FREQUENCIES);
+    (void)vnadata_set_frequency_vector(vdp, xp);
+    for (int findex = 0; findex < FREQUENCIES; ++findex) {
+	yp[findex] = 0.5 * libt_crandn();
+	(void)vnadata_set_cell(vdp, findex, 0, 0, yp[findex]);
+    }
+    if ((parameter = vnacal_make_data_parameter(vcp, vdp)) == -1) {
+	libt_error("vnacal_make_data_parameter: %s\n", strerror(errno));
+    }
+    if ((vector = vnacal_make_vector_parameter(vcp, xp, FREQUENCIES,
+		    yp)) == -1) {
+	libt_error("vnacal_make_vector_parameter: %s\n", strerror(errno));
+    }
+    for (int mi = 0; mi < N_METHODS; ++mi) {
+	const vnacal_interpolation_t method = method_vector[mi];
+
+	if (vnacal_set_parameter_interpolation(vcp, parameter,
+		    method) == -1 ||
+		vnacal_set_parameter_interpolation(vcp, vector,
+		    method) == -1) {
+	    libt_error("vnacal_set_parameter_interpolation: %s\n",
+		    strerror(errno));
+	}
+	for (int i = 0; i < FREQUENCIES - 1; ++i) {
+	    double f = libt_randu(xp[i], xp[i + 1]);
+	    double complex expected = reference_interpolate(method, xp, yp,
+		    FREQUENCIES, f);
+
+	    if (!check("parameter", vnacal_eval_parameter(vcp, parameter,
+			    f, 50.0), expected) ||
+		    !check("vector", vnacal_eval_parameter(vcp, vector,
+			    f, 50.0), expected)) {
+		result = T_FAIL;
+		goto out;
+	    }
+	}
+    }
+
+    /*
+     * Scalar parameters have no frequency points to interpolate.
+     */
+    if ((scalar = vnacal_make_scalar_parameter(vcp, 0.5)) == -1) {
+	libt_error("vnacal_make_scalar_parameter: %s\n", strerror(errno));
+    }
+    if (vnacal_set_parameter_interpolation(vcp, scalar,
+		VNACAL_INTERP_LINEAR) != -1) {
+	(void)printf("%s: vnacal_set_parameter_interpolation: scalar "
+		"parameter not rejected\n", progname);
+	result = T_FAIL;
+	goto out;
+    }
+    result = T_PASS;
+
+out:
+    vnadata_free(vdp);
+    vnacal_free(vcp);
+    libt_report(result);
+    return result;
+}
+
+/*
+ * print_usage: print a usage message and exit
+ */
+static void print_usage()
+{
+    const char *const *cpp;
+
+    for (cpp = usage; *cpp != NULL; ++cpp) {
+	(void)fprintf(stderr, "%s: usage %s\n", progname, *cpp);
+    }
+    for (cpp = help; *cpp != NULL; ++cpp) {
+	(void)fprintf(stderr, "%s\n", *cpp);
+    }
+    exit(2);
+}
+
+/*
+ * main: test program
+ */
+int
+main(int argc, char **argv)
+{
+    libt_result_t result;
+
+    if ((char *)NULL == (progname = strrchr(argv[0], '/'))) {
+	progname = argv[0];
+    } else {
+	++progname;
+    }
+    for (;;) {
+	switch (getopt(argc, argv, options)) {
+	case 'a':
+	    opt_a = true;
+	    continue;
+
+	case 'v':
+	    ++opt_v;
+	    continue;
+
+	case -1:
+	    break;
+
+	default:
+	    print_usage();
+	}
+	break;
+    }
+    argc -= optind;
+    argv += optind;
+    if (argc != 0) {
+	print_usage();
+    }
+
+    libt_isequal_init();
+    if ((result = test_interpolate_points()) != T_PASS) {
+	exit(result);
+    }
+    if ((result = test_calibration_interpolation()) != T_PASS) {
+	exit(result);
+    }
+    exit(test_parameter_interpolation());
+}
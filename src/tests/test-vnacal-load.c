@@ -0,0 +1,878 @@
+/*
+ * Vector Network Analyzer Library
+ * Copyright © 2020-2023 D Scott Guthridge <scott_guthridge@rompromity.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "archdep.h"
+
+#include <assert.h>
+#include <complex.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdio.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include "vnacal_internal.h"
+#include "libt.h"
+
+
+/*
+ * Command Line Options
+ */
+char *progname;
+static const char options[] = "av";
+static const char *const usage[] = {
+    "[-av]",
+    NULL
+};
+static const char *const help[] = {
+    "-a	 abort on data miscompare",
+    "-v	 show verbose output",
+    NULL
+};
+bool opt_a = false;
+int  opt_v = 0;
+
+/*
+ * pathname: test file name
+ */
+static const char pathname[] = "test-vnacal-load.vnacal";
+static const char save_pathname[] = "test-vnacal-load-save.vnacal";
+
+/*
+ * last_error: most recent error message
+ */
+static char last_error[1024];
+
+/*
+ * error_fn: error reporting function
+ *   @message: error message
+ *   @arg: (unused)
+ *   @category: error category (unused)
+ */
+static void error_fn(const char *message, void *arg, vnaerr_category_t category)
+{
+    (void)strncpy(last_error, message, sizeof(last_error) - 1);
+    if (opt_v >= 1) {
+	(void)printf("%s: %s\n", progname, message);
+    }
+}
+
+/*
+ * T8_DATA: T8 1x1 error terms at two frequencies
+ */
+#define T8_DATA \
+    "  data:\n" \
+    T8_ENTRIES
+
+/*
+ * T8_ENTRIES: the frequency entries without the data key
+ */
+#define T8_ENTRIES \
+    "  - f: 1.0e+6\n" \
+    "    ts: [ 1+2j ]\n" \
+    "    ti: [ 3 ]\n" \
+    "    tx: [ -1j ]\n" \
+    "    tm: [ 2-1j ]\n" \
+    "  - f: 2.0e+6\n" \
+    "    ts: [ 4 ]\n" \
+    "    ti: [ 5+5j ]\n" \
+    "    tx: [ 6 ]\n" \
+    "    tm: [ 7 ]\n"
+
+/*
+ * T8_Z0_DATA: as above but with per-frequency reference impedances
+ */
+#define T8_Z0_DATA \
+    "  data:\n" \
+    "  - f: 1.0e+6\n" \
+    "    z0: [ 50+1j ]\n" \
+    "    ts: [ 1+2j ]\n" \
+    "    ti: [ 3 ]\n" \
+    "    tx: [ -1j ]\n" \
+    "    tm: [ 2-1j ]\n" \
+    "  - f: 2.0e+6\n" \
+    "    z0: [ 50+2j ]\n" \
+    "    ts: [ 4 ]\n" \
+    "    ti: [ 5+5j ]\n" \
+    "    tx: [ 6 ]\n" \
+    "    tm: [ 7 ]\n"
+
+/*
+ * T8_HEADER: calibration keys needed before the data
+ */
+#define T8_HEADER \
+    "  type: T8\n" \
+    "  rows: 1\n" \
+    "  columns: 1\n" \
+    "  frequencies: 2\n"
+
+/*
+ * expected_terms: expected error terms from T8_DATA [term][findex]
+ */
+static const double complex expected_terms[4][2] = {
+    { 1.0 + 2.0 * I, 4.0 },
+    { 3.0,	     5.0 + 5.0 * I },
+    { -1.0 * I,	     6.0 },
+    { 2.0 - 1.0 * I, 7.0 },
+};
+
+/*
+ * good_file_t: file that should load
+ */
+typedef struct good_file {
+    const char *gf_description;
+    const char *gf_text;
+    vnacal_z0_type_t gf_z0_type;
+} good_file_t;
+
+/*
+ * good_files: files that should load successfully
+ */
+static const good_file_t good_files[] = {
+    {
+	"header before data",
+	"#VNACal 1.0\n"
+	"calibrations:\n"
+	"- name: cal1\n"
+	T8_HEADER
+	"  z0: 75\n"
+	"  properties: { a: 1 }\n"
+	T8_DATA,
+	VNACAL_Z0_SCALAR
+    },
+    {
+	"data before header",
+	"#VNACal 1.1\n"
+	"properties:\n"
+	"  base: &b { x: 1 }\n"
+	"  copy: *b\n"
+	"calibrations:\n"
+	"- data:\n"
+	T8_ENTRIES
+	"  name: cal1\n"
+	T8_HEADER
+	"  z0: [ 75 ]\n",
+	VNACAL_Z0_VECTOR
+    },
+    {
+	"name and properties after data",
+	"#VNACal 1.1\n"
+	"calibrations:\n"
+	"- type: T8\n"
+	"  rows: 1\n"
+	"  columns: 1\n"
+	"  frequencies: 2\n"
+	T8_Z0_DATA
+	"  properties: ~\n"
+	"  name: cal1\n",
+	VNACAL_Z0_MATRIX
+    },
+    {
+	"vector z0 in version 1.2",
+	"#VNACal 1.2\n"
+	"calibrations:\n"
+	"- name: cal1\n"
+	T8_HEADER
+	"  z0: [ 75 ]\n"
+	T8_DATA,
+	VNACAL_Z0_VECTOR
+    },
+};
+#define N_GOOD_FILES	(sizeof(good_files) / sizeof(good_file_t))
+
+/*
+ * bad_file_t: file that should fail to load
+ */
+typedef struct bad_file {
+    const char *bf_text;
+    const char *bf_message;
+} bad_file_t;
+
+/*
+ * bad_files: files that should fail, and the expected error message
+ */
+static const bad_file_t bad_files[] = {
+    {
+	"#VNACal 1.0\n"
+	"calibrations:\n"
+	"- name: cal1\n"
+	"  type: T8\n"
+	"  rows: 1\n"
+	"  columns: 1\n"
+	"  frequencies: 3\n"
+	"  z0: 50\n"
+	T8_DATA,
+	"(line 10) error: expected 3 frequency entries, but found 2"
+    },
+    {
+	"#VNACal 1.0\n"
+	"calibrations:\n"
+	"- name: cal1\n"
+	T8_HEADER
+	"  z0: 50\n"
+	"  data:\n"
+	"  - f: 1.0e+6\n"
+	"    ts: [ 1 ]\n"
+	"    ti: [ 1 ]\n"
+	"    tx: [ 1 ]\n"
+	"    tm: [ 1 ]\n"
+	"    er: [ 1 ]\n",
+	"(line 15) error: key \"er\" is not expected here"
+    },
+    {
+	"#VNACal 1.0\n"
+	"calibrations:\n"
+	"- name: cal1\n"
+	T8_HEADER
+	"  z0: 50\n"
+	"  data:\n"
+	"  - f: 1.0e+6\n"
+	"    ts: [ 1 ]\n"
+	"    ti: [ 1x ]\n",
+	"(line 12) error: invalid complex number in ti vector"
+    },
+    {
+	"#VNACal 1.0\n"
+	"calibrations:\n"
+	"- name: cal1\n"
+	T8_HEADER
+	"  z0: 50\n"
+	"  data:\n"
+	"  - f: 1.0e+6\n"
+	"    ts: [ 1 ]\n"
+	"    ti: [ 1 ]\n"
+	"    tx: [ 1 ]\n",
+	"(line 10): missing required key tm"
+    },
+    {
+	"#VNACal 1.1\n"
+	"calibrations:\n"
+	"- name: cal1\n"
+	T8_HEADER
+	T8_Z0_DATA
+	"  z0: 50\n",
+	"(line 21) error: \"z0\" must come before \"data\""
+    },
+    {
+	"#VNACal 1.0\n"
+	"calibrations:\n"
+	"- name: cal1\n"
+	T8_HEADER
+	"  z0: 50\n"
+	"  data:\n"
+	"  - f: 1.0e+6\n"
+	"    ts: &ts [ 1 ]\n"
+	"    ti: *ts\n",
+	"(line 12) error: YAML alias not allowed here"
+    },
+    {
+	"#VNACal 1.0\n"
+	"calibrations:\n"
+	"- name: cal1\n"
+	T8_HEADER
+	"  z0: 50\n"
+	"  data:\n"
+	"  - f: 1.0e+6\n"
+	"    ts: [ 1 ]\n"
+	"    ti: [ 1 ]\n"
+	"    tx: [ 1 ]\n"
+	"    tm: [ 1 ]\n"
+	"  - f: 1.0e+6\n"
+	"    ts: [ 1 ]\n"
+	"    ti: [ 1 ]\n"
+	"    tx: [ 1 ]\n"
+	"    tm: [ 1 ]\n",
+	"(line 3) error: frequencies must be ascending"
+    },
+    {
+	"#VNACal 1.1\n"
+	"calibrations:\n"
+	"- name: cal1\n"
+	T8_HEADER
+	"  data:\n"
+	"  - f: 1.0e+6\n"
+	"    z0: [ 50, 50 ]\n",
+	"(line 10) error: expected z0 to have 1 elements but found 2"
+    },
+    {
+	"#VNACal 1.0\n"
+	"calibrations:\n"
+	"- name: cal1\n"
+	T8_HEADER
+	"  z0: [ 50 ]\n"
+	T8_DATA,
+	"(line 8): \"z0\" must be a scalar"
+    },
+};
+#define N_BAD_FILES	(sizeof(bad_files) / sizeof(bad_file_t))
+
+/*
+ * write_file: write text to the test file
+ *   @text: file contents
+ */
+static void write_file(const char *text)
+{
+    FILE *fp;
+
+    if ((fp = fopen(pathname, "w")) == NULL) {
+	libt_error("fopen: %s: %s\n", pathname, strerror(errno));
+    }
+    if (fputs(text, fp) == EOF || fclose(fp) == EOF) {
+	libt_error("write: %s: %s\n", pathname, strerror(errno));
+    }
+}
+
+/*
+ * check_calibration: check a loaded calibration against the test case
+ *   @gfp: test case
+ *   @vcp: loaded calibration
+ */
+static libt_result_t check_calibration(const good_file_t *gfp, vnacal_t *vcp)
+{
+    vnacal_calibration_t *calp;
+    vnacal_layout_t vl;
+    vnacal_error_term_matrix_t *matrix_list = NULL;
+    libt_result_t result = T_FAIL;
+    int term;
+
+    if (vnacal_find_calibration(vcp, "cal1") != 0) {
+	libt_fail("%s: calibration cal1 not found\n", gfp->gf_description);
+	goto out;
+    }
+    if ((calp = _vnacal_get_calibration(__func__, vcp, 0)) == NULL) {
+	libt_fail("%s: calibration cal1 failed to load\n",
+		gfp->gf_description);
+	goto out;
+    }
+    if (calp->cal_type != VNACAL_T8 || calp->cal_rows != 1 ||
+	    calp->cal_columns != 1 || calp->cal_frequencies != 2) {
+	libt_fail("%s: wrong calibration dimensions\n", gfp->gf_description);
+	goto out;
+    }
+    if (calp->cal_z0_type != gfp->gf_z0_type) {
+	libt_fail("%s: z0 type %d; expected %d\n", gfp->gf_description,
+		(int)calp->cal_z0_type, (int)gfp->gf_z0_type);
+	goto out;
+    }
+    switch (calp->cal_z0_type) {
+    case VNACAL_Z0_SCALAR:
+	if (!libt_isequal(calp->cal_z0, 75.0)) {
+	    libt_fail("%s: wrong z0\n", gfp->gf_description);
+	    goto out;
+	}
+	break;
+
+    case VNACAL_Z0_VECTOR:
+	if (!libt_isequal(calp->cal_z0_vector[0], 75.0)) {
+	    libt_fail("%s: wrong z0 vector\n", gfp->gf_description);
+	    goto out;
+	}
+	break;
+
+    case VNACAL_Z0_MATRIX:
+	for (int findex = 0; findex < 2; ++findex) {
+	    if (!libt_isequal(calp->cal_z0_matrix[0][findex],
+			50.0 + (findex + 1) * I)) {
+		libt_fail("%s: wrong z0 at findex %d\n",
+			gfp->gf_description, findex);
+		goto out;
+	    }
+	}
+	break;
+    }
+    if (calp->cal_frequency_vector[0] != 1.0e+6 ||
+	    calp->cal_frequency_vector[1] != 2.0e+6) {
+	libt_fail("%s: wrong frequencies\n", gfp->gf_description);
+	goto out;
+    }
+    _vnacal_layout(&vl, calp->cal_type, calp->cal_rows, calp->cal_columns);
+    if (_vnacal_build_error_term_list(calp, &vl, &matrix_list) == -1) {
+	libt_error("_vnacal_build_error_term_list: %s\n", strerror(errno));
+    }
+    term = 0;
+    for (vnacal_error_term_matrix_t *vetmp = matrix_list; vetmp != NULL;
+	    vetmp = vetmp->vetm_next) {
+	assert(term < 4);
+	for (int findex = 0; findex < 2; ++findex) {
+	    if (!libt_isequal(vetmp->vetm_matrix[0][findex],
+			expected_terms[term][findex])) {
+		libt_fail("%s: %s[%d] is wrong\n", gfp->gf_description,
+			vetmp->vetm_name, findex);
+		goto out;
+	    }
+	}
+	++term;
+    }
+    if (vcp->vc_properties != NULL &&
+	    strcmp(vnaproperty_get(vcp->vc_properties, "copy.x"), "1") != 0) {
+	libt_fail("%s: aliased property not copied\n", gfp->gf_description);
+	goto out;
+    }
+    result = T_PASS;
+
+out:
+    _vnacal_free_error_term_matrices(vcp, &matrix_list);
+    return result;
+}
+
+/*
+ * check_good_file: load a file, check it, save it and check it again
+ *   @gfp: test case
+ */
+static libt_result_t check_good_file(const good_file_t *gfp)
+{
+    vnacal_t *vcp = NULL;
+    libt_result_t result = T_FAIL;
+
+    if (opt_v >= 1) {
+	(void)printf("good file: %s\n", gfp->gf_description);
+    }
+    write_file(gfp->gf_text);
+    if ((vcp = vnacal_load(pathname, error_fn, NULL)) == NULL) {
+	libt_fail("vnacal_load: %s: unexpected failure\n",
+		gfp->gf_description);
+	goto out;
+    }
+    if ((result = check_calibration(gfp, vcp)) != T_PASS) {
+	goto out;
+    }
+    result = T_FAIL;
+    if (vnacal_save(vcp, pathname) == -1) {
+	libt_fail("vnacal_save: %s: unexpected failure\n",
+		gfp->gf_description);
+	goto out;
+    }
+    vnacal_free(vcp);
+    if ((vcp = vnacal_load(pathname, error_fn, NULL)) == NULL) {
+	libt_fail("vnacal_load: %s: saved file failed to load\n",
+		gfp->gf_description);
+	goto out;
+    }
+    if ((result = check_calibration(gfp, vcp)) != T_PASS) {
+	goto out;
+    }
+    vnacal_free(vcp);
+
+    /*
+     * Load it lazily and check again.
+     */
+    if ((vcp = vnacal_load_lazy(pathname, error_fn, NULL)) == NULL) {
+	libt_fail("vnacal_load_lazy: %s: unexpected failure\n",
+		gfp->gf_description);
+	result = T_FAIL;
+	goto out;
+    }
+    result = check_calibration(gfp, vcp);
+
+out:
+    vnacal_free(vcp);
+    return result;
+}
+
+/*
+ * check_bad_file: load a file that should fail and check the message
+ *   @bfp: test case
+ */
+static libt_result_t check_bad_file(const bad_file_t *bfp)
+{
+    vnacal_t *vcp;
+
+    if (opt_v >= 1) {
+	(void)printf("bad file: %s\n", bfp->bf_message);
+    }
+    write_file(bfp->bf_text);
+    last_error[0] = '\000';
+    if ((vcp = vnacal_load(pathname, error_fn, NULL)) != NULL) {
+	libt_fail("vnacal_load: unexpected success; expected \"%s\"\n",
+		bfp->bf_message);
+	vnacal_free(vcp);
+	return T_FAIL;
+    }
+    if (strstr(last_error, bfp->bf_message) == NULL) {
+	libt_fail("vnacal_load: got \"%s\"; expected \"%s\"\n",
+		last_error, bfp->bf_message);
+	return T_FAIL;
+    }
+
+    /*
+     * When loaded lazily, the error must be the same, but reported
+     * when the calibration is first used.
+     */
+    last_error[0] = '\000';
+    if ((vcp = vnacal_load_lazy(pathname, error_fn, NULL)) == NULL) {
+	libt_fail("vnacal_load_lazy: unexpected failure: %s\n", last_error);
+	return T_FAIL;
+    }
+    if (vnacal_get_frequencies(vcp, 0) != -1) {
+	libt_fail("vnacal_load_lazy: unexpected success; expected \"%s\"\n",
+		bfp->bf_message);
+	vnacal_free(vcp);
+	return T_FAIL;
+    }
+    vnacal_free(vcp);
+    if (strstr(last_error, bfp->bf_message) == NULL) {
+	libt_fail("vnacal_load_lazy: got \"%s\"; expected \"%s\"\n",
+		last_error, bfp->bf_message);
+	return T_FAIL;
+    }
+    return T_PASS;
+}
+
+/*
+ * lazy_file: several calibrations with multibyte characters between
+ */
+#define LAZY_FILE_HEAD \
+    "#VNACal 1.0\n" \
+    "calibrations:\n" \
+    "- name: \"καλ0\"\n" \
+    T8_HEADER \
+    "  z0: 75\n" \
+    "  properties: { note: \"αβγδεζηθ\" }\n" \
+    T8_DATA \
+    "- name: cal1\n" \
+    T8_HEADER \
+    "  z0: 75\n" \
+    T8_DATA
+
+static const char *const lazy_files[] = {
+    LAZY_FILE_HEAD
+    "- { name: cal2, type: T8, rows: 1, columns: 1, frequencies: 1,\n"
+    "    z0: 50, data: [ { f: 1e+6, ts: [ 1 ], ti: [ 2 ], tx: [ 3 ],\n"
+    "    tm: [ 4 ] } ] }\n",
+
+    /* a data key alone on a line in a flow mapping defeats the filter */
+    LAZY_FILE_HEAD
+    "- { name: cal2, type: T8, rows: 1, columns: 1, frequencies: 1,\n"
+    "    z0: 50,\n"
+    "    data:\n"
+    "      [ { f: 1e+6, ts: [ 1 ], ti: [ 2 ], tx: [ 3 ], tm: [ 4 ] } ] }\n",
+};
+#define N_LAZY_FILES	(sizeof(lazy_files) / sizeof(const char *))
+
+/*
+ * check_lazy_file: check that vnacal_load_lazy loads only what's used
+ *   @text: file contents
+ */
+static libt_result_t check_lazy_file(const char *text)
+{
+    const good_file_t good_file = {
+	"lazy load of the second of several calibrations",
+	text,
+	VNACAL_Z0_SCALAR
+    };
+    vnacal_t *vcp = NULL;
+    vnacal_calibration_t *calp;
+    libt_result_t result = T_FAIL;
+    int ci;
+
+    if (opt_v >= 1) {
+	(void)printf("lazy file\n");
+    }
+    write_file(text);
+    if ((vcp = vnacal_load_lazy(pathname, error_fn, NULL)) == NULL) {
+	libt_fail("vnacal_load_lazy: unexpected failure\n");
+	goto out;
+    }
+    if (vnacal_get_calibration_end(vcp) != 3) {
+	libt_fail("vnacal_load_lazy: expected 3 calibrations\n");
+	goto out;
+    }
+    for (ci = 0; ci < 3; ++ci) {
+	if (vcp->vc_calibration_vector[ci]->cal_deferred == NULL) {
+	    libt_fail("vnacal_load_lazy: calibration %d not deferred\n", ci);
+	    goto out;
+	}
+    }
+
+    /*
+     * Load the second.  The first should still be deferred.
+     */
+    if ((ci = vnacal_find_calibration(vcp, "cal1")) != 1) {
+	libt_fail("vnacal_find_calibration: cal1 not found\n");
+	goto out;
+    }
+    if (vnacal_get_frequencies(vcp, ci) != 2) {
+	libt_fail("vnacal_get_frequencies: wrong result\n");
+	goto out;
+    }
+    if (vcp->vc_calibration_vector[0]->cal_deferred == NULL ||
+	    vcp->vc_calibration_vector[1]->cal_deferred != NULL) {
+	libt_fail("vnacal_load_lazy: wrong calibrations loaded\n");
+	goto out;
+    }
+
+    /*
+     * Check the values.  Swap cal1 into index 0 for check_calibration.
+     */
+    calp = vcp->vc_calibration_vector[0];
+    vcp->vc_calibration_vector[0] = vcp->vc_calibration_vector[1];
+    vcp->vc_calibration_vector[1] = calp;
+    if (check_calibration(&good_file, vcp) != T_PASS) {
+	goto out;
+    }
+
+    /*
+     * The others must load too.
+     */
+    if (strcmp(vnacal_property_get(vcp, 1, "note"), "αβγδεζηθ") != 0) {
+	libt_fail("vnacal_property_get: wrong value for note\n");
+	goto out;
+    }
+    if (vnacal_get_frequencies(vcp, 2) != 1) {
+	libt_fail("vnacal_get_frequencies: wrong result for cal2\n");
+	goto out;
+    }
+    result = T_PASS;
+
+out:
+    vnacal_free(vcp);
+    return result;
+}
+
+/*
+ * check_lazy_file_change: replace and rewrite a lazily loaded file
+ *
+ *   A file replaced under its name must not affect the deferred
+ *   calibrations, which come from the file that was indexed.  A file
+ *   rewritten in place must be detected.
+ */
+static libt_result_t check_lazy_file_change()
+{
+    vnacal_t *vcp = NULL;
+    libt_result_t result = T_FAIL;
+
+    if (opt_v >= 1) {
+	(void)printf("lazy file change\n");
+    }
+    write_file(lazy_files[0]);
+    if ((vcp = vnacal_load_lazy(pathname, error_fn, NULL)) == NULL) {
+	libt_fail("vnacal_load_lazy: unexpected failure\n");
+	goto out;
+    }
+    if (remove(pathname) == -1) {
+	libt_error("remove: %s: %s\n", pathname, strerror(errno));
+    }
+    write_file(LAZY_FILE_HEAD);
+    if (vnacal_get_frequencies(vcp, 2) != 1) {
+	libt_fail("vnacal_get_frequencies: replaced file affected "
+		"the deferred calibration\n");
+	goto out;
+    }
+    vnacal_free(vcp);
+
+    write_file(lazy_files[0]);
+    if ((vcp = vnacal_load_lazy(pathname, error_fn, NULL)) == NULL) {
+	libt_fail("vnacal_load_lazy: unexpected failure\n");
+	goto out;
+    }
+    write_file(LAZY_FILE_HEAD);
+    last_error[0] = '\000';
+    if (vnacal_get_frequencies(vcp, 2) != -1 || errno != ESTALE) {
+	libt_fail("vnacal_get_frequencies: file rewritten in place "
+		"not detected\n");
+	goto out;
+    }
+    if (strstr(last_error, "changed since it was loaded") == NULL) {
+	libt_fail("vnacal_get_frequencies: unexpected message: %s\n",
+		last_error);
+	goto out;
+    }
+    result = T_PASS;
+
+out:
+    vnacal_free(vcp);
+    return result;
+}
+
+/*
+ * data_property_file: user properties named data in block style
+ */
+static const char data_property_file[] =
+    "#VNACal 1.0\n"
+    "properties:\n"
+    "  data:\n"
+    "    a: 1\n"
+    "    b: 2\n"
+    "calibrations:\n"
+    "- name: cal0\n"
+    T8_HEADER
+    "  z0: 75\n"
+    "  properties:\n"
+    "    data:\n"
+    "    - x\n"
+    "    - y\n"
+    T8_DATA;
+
+/*
+ * check_data_properties: check the properties in data_property_file
+ *   @vcp: loaded calibration
+ */
+static libt_result_t check_data_properties(vnacal_t *vcp)
+{
+    const char *value;
+
+    if ((value = vnacal_property_get(vcp, -1, "data.a")) == NULL ||
+	    strcmp(value, "1") != 0 ||
+	    (value = vnacal_property_get(vcp, -1, "data.b")) == NULL ||
+	    strcmp(value, "2") != 0) {
+	libt_fail("vnacal_property_get: global data property lost\n");
+	return T_FAIL;
+    }
+    if ((value = vnacal_property_get(vcp, 0, "data[1]")) == NULL ||
+	    strcmp(value, "y") != 0) {
+	libt_fail("vnacal_property_get: calibration data property lost\n");
+	return T_FAIL;
+    }
+    if (vnacal_get_frequencies(vcp, 0) != 2) {
+	libt_fail("vnacal_get_frequencies: wrong result\n");
+	return T_FAIL;
+    }
+    return T_PASS;
+}
+
+/*
+ * check_lazy_data_property: round-trip properties named data lazily
+ *
+ *   The lazy loader drops each calibration's data block before libyaml
+ *   sees it; properties that happen to be named data must survive
+ *   the load and a save.
+ */
+static libt_result_t check_lazy_data_property()
+{
+    vnacal_t *vcp = NULL;
+    libt_result_t result = T_FAIL;
+
+    if (opt_v >= 1) {
+	(void)printf("lazy data property\n");
+    }
+    write_file(data_property_file);
+    if ((vcp = vnacal_load_lazy(pathname, error_fn, NULL)) == NULL) {
+	libt_fail("vnacal_load_lazy: unexpected failure\n");
+	goto out;
+    }
+    if (check_data_properties(vcp) != T_PASS) {
+	goto out;
+    }
+    if (vnacal_save(vcp, save_pathname) == -1) {
+	libt_fail("vnacal_save: unexpected failure\n");
+	goto out;
+    }
+    vnacal_free(vcp);
+    if ((vcp = vnacal_load(save_pathname, error_fn, NULL)) == NULL) {
+	libt_fail("vnacal_load: unexpected failure\n");
+	goto out;
+    }
+    if (check_data_properties(vcp) != T_PASS) {
+	goto out;
+    }
+    result = T_PASS;
+
+out:
+    vnacal_free(vcp);
+    return result;
+}
+
+/*
+ * test_vnacal_load: test the load paths and the save round trip
+ */
+static libt_result_t test_vnacal_load()
+{
+    libt_result_t result = T_FAIL;
+
+    for (int i = 0; i < N_GOOD_FILES; ++i) {
+	if ((result = check_good_file(&good_files[i])) != T_PASS) {
+	    goto out;
+	}
+    }
+    for (int i = 0; i < N_BAD_FILES; ++i) {
+	if ((result = check_bad_file(&bad_files[i])) != T_PASS) {
+	    goto out;
+	}
+    }
+    for (int i = 0; i < N_LAZY_FILES; ++i) {
+	if ((result = check_lazy_file(lazy_files[i])) != T_PASS) {
+	    goto out;
+	}
+    }
+    if ((result = check_lazy_data_property()) != T_PASS) {
+	goto out;
+    }
+    if ((result = check_lazy_file_change()) != T_PASS) {
+	goto out;
+    }
+    result = T_PASS;
+
+out:
+    libt_report(result);
+    return result;
+}
+
+/*
+ * print_usage: print a usage message and exit
+ */
+static void print_usage()
+{
+    const char *const *cpp;
+
+    for (cpp = usage; *cpp != NULL; ++cpp) {
+	(void)fprintf(stderr, "%s: usage %s\n", progname, *cpp);
+    }
+    for (cpp = help; *cpp != NULL; ++cpp) {
+	(void)fprintf(stderr, "%s\n", *cpp);
+    }
+    exit(99);
+}
+
+/*
+ * main
+ */
+int
+main(int argc, char **argv)
+{
+    /*
+     * Parse Options
+     */
+    if ((char *)NULL == (progname = strrchr(argv[0], '/'))) {
+	progname = argv[0];
+    } else {
+	++progname;
+    }
+    for (;;) {
+	switch (getopt(argc, argv, options)) {
+	case -1:
+	    break;
+
+	case 'a':
+	    opt_a = true;
+	    continue;
+
+	case 'v':
+	    ++opt_v;
+	    continue;
+
+	default:
+	    print_usage();
+	}
+	break;
+    }
+    libt_isequal_init();
+    exit(test_vnacal_load());
+}
@@ -0,0 +1,278 @@
+/*
+ * Vector Network Analyzer Library
+ * Copyright © 2020-2024 D Scott Guthridge <scott_guthridge@rompromity.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "archdep.h"
+
+#include <assert.h>
+#include <complex.h>
+#include <errno.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include "vnacal_internal.h"
+#include "libt.h"
+#include "libt_crand.h"
+
+
+#define N_TRIALS	100
+#define MAX_N		12
+#define N_TARGETS	40
+
+/*
+ * Options
+ */
+char *progname;
+static const char options[] = "av";
+static const char *const usage[] = {
+    "[-av]",
+    NULL
+};
+static const char *const help[] = {
+    "-a	 abort on data miscompare",
+    "-v	 show verbose output",
+    NULL
+};
+bool opt_a = false;
+int opt_v = 0;
+
+/*
+ * reference_rfi: straightforward rational function interpolation
+ *   @xp: vector of x points
+ *   @yp: vector of y points
+ *   @n:  length of xp and yp
+ *   @m:  order (number of points that determine the interpolation)
+ *   @x:  dependent variable to interpolate
+ *
+ *   Search the whole grid for the window and run the Bulirsch-Stoer
+ *   tableau directly, independent of the library's precomputation.
+ */
+static double complex reference_rfi(const double *xp,
+	const double complex *yp, int n, int m, double x)
+{
+    int segment, nearest, base, cur;
+    double complex c[m], d[m];
+    double complex y;
+
+    if (n < 2) {
+	return yp[0];
+    }
+    for (segment = 0; segment < n - 2 && x > xp[segment + 1]; ++segment)
+	;
+    if (fabs(x - xp[segment]) <= 1.0e-25) {
+	return yp[segment];
+    }
+    if (fabs(x - xp[segment + 1]) <= 1.0e-25) {
+	return yp[segment + 1];
+    }
+    if (fabs(x - xp[segment]) <= fabs(x - xp[segment + 1]) || m < 2) {
+	nearest = segment;
+    } else {
+	nearest = segment + 1;
+    }
+    if (m & 1) {
+	base = nearest - (m - 1) / 2;
+    } else {
+	base = segment - (m / 2 - 1);
+    }
+    base = MAX(0, MIN(base, n - m));
+    cur = nearest - base;
+    for (int i = 0; i < m; ++i) {
+	c[i] = yp[base + i];
+	d[i] = yp[base + i] + 1.0e-25;
+    }
+    y = yp[base + cur--];
+    for (int i = 0; i < m - 1; ++i) {
+	for (int j = 0; j < m - i - 1; ++j) {
+	    double complex c_d = c[j + 1] - d[j];
+	    double complex dx1 = x - xp[base + j];
+	    double complex dx2 = x - xp[base + i + j + 1];
+	    double complex den = dx1 * d[j] - dx2 * c[j + 1];
+
+	    if (cabs(den) < 1.0e-24) {
+		return y;
+	    }
+	    c[j] = c_d * dx1 * d[j]     / den;
+	    d[j] = c_d * dx2 * c[j + 1] / den;
+	}
+	if (2 * (cur + 1) < m - i) {
+	    y += c[cur + 1];
+	} else {
+	    y += d[cur--];
+	}
+    }
+    return y;
+}
+
+/*
+ * compare_qsort_helper: compare doubles for qsort
+ */
+static int compare_qsort_helper(const void *vp1, const void *vp2)
+{
+    double d1 = *(const double *)vp1;
+    double d2 = *(const double *)vp2;
+
+    return d1 < d2 ? -1 : d1 > d2 ? 1 : 0;
+}
+
+/*
+ * test_vnacal_rfi: test interpolation plans against the reference
+ */
+static libt_result_t test_vnacal_rfi()
+{
+    double xp[MAX_N];
+    double complex yp[MAX_N];
+    double x_vector[N_TARGETS];
+    double complex result[N_TARGETS];
+    vnacal_interp_plan_t *planp = NULL;
+    libt_result_t result_code = T_SKIPPED;
+
+    for (int trial = 1; trial <= N_TRIALS; ++trial) {
+	for (int n = 1; n <= MAX_N; ++n) {
+	    const int m = MIN(n, VNACAL_MAX_M);
+	    int segment = 0;
+
+	    if (opt_v) {
+		(void)printf("Test vnacal_rfi: trial %3d n %2d\n", trial, n);
+		(void)fflush(stdout);
+	    }
+
+	    /*
+	     * Make an increasing source grid and random y values.
+	     */
+	    xp[0] = libt_randu(1.0e+6, 2.0e+6);
+	    for (int i = 1; i < n; ++i) {
+		xp[i] = xp[i - 1] + libt_randu(1.0e+5, 1.0e+6);
+	    }
+	    for (int i = 0; i < n; ++i) {
+		yp[i] = libt_crandn();
+	    }
+
+	    /*
+	     * Make a sorted target grid that includes every source
+	     * point exactly and extends slightly past both ends.
+	     */
+	    for (int i = 0; i < N_TARGETS; ++i) {
+		if (i < n) {
+		    x_vector[i] = xp[i];
+		} else {
+		    x_vector[i] = libt_randu(0.99 * xp[0], 1.01 * xp[n - 1]);
+		}
+	    }
+	    qsort((void *)x_vector, N_TARGETS, sizeof(double),
+		    compare_qsort_helper);
+
+	    /*
+	     * Interpolate through the plan and compare with the
+	     * reference and with _vnacal_rfi.
+	     */
+	    if ((planp = _vnacal_interp_plan_alloc(VNACAL_INTERP_RATIONAL,
+			    xp, n, x_vector, N_TARGETS)) == NULL) {
+		libt_error("_vnacal_interp_plan_alloc: %s\n", strerror(errno));
+	    }
+	    _vnacal_interp_plan_apply(planp, yp, NULL, result);
+	    for (int i = 0; i < N_TARGETS; ++i) {
+		double complex expected;
+		double complex single;
+
+		expected = reference_rfi(xp, yp, n, m, x_vector[i]);
+		single = _vnacal_rfi(xp, yp, n, m, &segment, x_vector[i]);
+		if (opt_v) {
+		    (void)printf("  x %13.6e  %9.6f%+9.6fj  %9.6f%+9.6fj\n",
+			    x_vector[i], creal(result[i]), cimag(result[i]),
+			    creal(expected), cimag(expected));
+		}
+		if (!libt_isequal(result[i], expected) ||
+			!libt_isequal(single, expected)) {
+		    if (opt_a) {
+			assert(!"data miscompare");
+		    }
+		    result_code = T_FAIL;
+		    goto out;
+		}
+	    }
+	    _vnacal_interp_plan_free(planp);
+	    planp = NULL;
+	}
+    }
+    result_code = T_PASS;
+
+out:
+    _vnacal_interp_plan_free(planp);
+    libt_report(result_code);
+    return result_code;
+}
+
+/*
+ * print_usage: print a usage message and exit
+ */
+static void print_usage()
+{
+    const char *const *cpp;
+
+    for (cpp = usage; *cpp != NULL; ++cpp) {
+	(void)fprintf(stderr, "%s: usage %s\n", progname, *cpp);
+    }
+    for (cpp = help; *cpp != NULL; ++cpp) {
+	(void)fprintf(stderr, "%s\n", *cpp);
+    }
+    exit(2);
+}
+
+/*
+ * main: test program
+ */
+int
+main(int argc, char **argv)
+{
+    if ((char *)NULL == (progname = strrchr(argv[0], '/'))) {
+	progname = argv[0];
+    } else {
+	++progname;
+    }
+    for (;;) {
+	switch (getopt(argc, argv, options)) {
+	case 'a':
+	    opt_a = true;
+	    continue;
+
+	case 'v':
+	    ++opt_v;
+	    continue;
+
+	case -1:
+	    break;
+
+	default:
+	    print_usage();
+	}
+	break;
+    }
+    argc -= optind;
+    argv += optind;
+    if (argc != 0) {
+	print_usage();
+    }
+
+    libt_isequal_init();
+    exit(test_vnacal_rfi());
+}
@@ -0,0 +1,483 @@
+/*
+ * Vector Network Analyzer Library
+ * Copyright © 2020-2024 D Scott Guthridge <scott_guthridge@rompromity.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "archdep.h"
+
+#include <complex.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include "libt.h"
+#include "libt_vnacal.h"
+
+
+#define FREQUENCIES	20
+#define THREADS		4
+#define TEST_FILE	"test-vnacal-stats.vnacal"
+
+/*
+ * Options
+ */
+char *progname;
+static const char options[] = "av";
+static const char *const usage[] = {
+    "[-av]",
+    NULL
+};
+static const char *const help[] = {
+    "-a	 abort on data miscompare",
+    "-v	 show verbose output",
+    NULL
+};
+bool opt_a = false;
+int opt_v = 0;
+
+/*
+ * error_fn: error reporting function
+ *   @message: error message
+ *   @arg: (unused)
+ *   @category: error category (unused)
+ */
+static void error_fn(const char *message, void *arg, vnaerr_category_t category)
+{
+    (void)printf("error: %s: %s\n", progname, message);
+}
+
+/*
+ * file_size: return the size of a file in bytes
+ *   @filename: file to examine
+ */
+static long file_size(const char *filename)
+{
+    FILE *fp;
+    long size;
+
+    if ((fp = fopen(filename, "rb")) == NULL) {
+	libt_error("fopen: %s: %s\n", filename, strerror(errno));
+    }
+    if (fseek(fp, 0L, SEEK_END) == -1 || (size = ftell(fp)) == -1) {
+	libt_error("fseek: %s: %s\n", filename, strerror(errno));
+    }
+    (void)fclose(fp);
+    return size;
+}
+
+/*
+ * make_calibration: solve a 2-port T8 calibration with an unknown reflect
+ *   @vcp: pointer returned from vnacal_create
+ *
+ *   The unknown reflect makes vnacal_new_solve iterate.
+ */
+static libt_vnacal_terms_t *make_calibration(vnacal_t *vcp)
+{
+    libt_vnacal_terms_t *ttp;
+    libt_vnacal_measurements_t *tmp;
+    int r_actual, r_unknown;
+    int s[2][2];
+
+    if ((ttp = libt_vnacal_generate_error_terms(vcp, VNACAL_T8, 2, 2,
+		    FREQUENCIES, NULL, 0)) == NULL) {
+	libt_error("libt_vnacal_generate_error_terms: %s\n", strerror(errno));
+    }
+    if ((tmp = libt_vnacal_alloc_measurements(VNACAL_T8, 2, 2,
+		    FREQUENCIES, false)) == NULL) {
+	libt_error("libt_vnacal_alloc_measurements: %s\n", strerror(errno));
+    }
+    if (libt_vnacal_add_through(ttp, tmp, 1, 2) == -1 ||
+	    libt_vnacal_add_single_reflect(ttp, tmp, VNACAL_OPEN, 1) == -1 ||
+	    libt_vnacal_add_single_reflect(ttp, tmp, VNACAL_MATCH, 1) == -1 ||
+	    libt_vnacal_add_single_reflect(ttp, tmp, VNACAL_MATCH, 2) == -1) {
+	libt_error("libt_vnacal_add_*: %s\n", strerror(errno));
+    }
+    if ((r_actual = vnacal_make_scalar_parameter(vcp,
+		    -0.95 + 0.05 * I)) == -1 ||
+	    (r_unknown = vnacal_make_unknown_parameter(vcp,
+		    VNACAL_SHORT)) == -1) {
+	libt_error("vnacal_make_*_parameter: %s\n", strerror(errno));
+    }
+    s[0][0] = r_actual;
+    s[0][1] = VNACAL_ZERO;
+    s[1][0] = VNACAL_ZERO;
+    s[1][1] = r_actual;
+    if (libt_vnacal_calculate_measurements(ttp, tmp, &s[0][0], 2, 2,
+		NULL) == -1) {
+	libt_error("libt_vnacal_calculate_measurements: %s\n",
+		strerror(errno));
+    }
+    if (vnacal_new_add_double_reflect_m(ttp->tt_vnp, tmp->tm_b_matrix, 2, 2,
+		r_unknown, r_unknown, 1, 2) == -1) {
+	libt_error("vnacal_new_add_double_reflect_m: %s\n", strerror(errno));
+    }
+    (void)vnacal_delete_parameter(vcp, r_actual);
+    libt_vnacal_free_measurements(tmp);
+    if (vnacal_new_solve(ttp->tt_vnp) == -1) {
+	libt_error("vnacal_new_solve: %s\n", strerror(errno));
+    }
+    return ttp;
+}
+
+/*
+ * test_vnacal: check the vnacal counters
+ *   @vcp: pointer returned from vnacal_create
+ */
+static libt_result_t test_vnacal(vnacal_t *vcp)
+{
+    libt_vnacal_terms_t *ttp = NULL;
+    double frequency_vector[FREQUENCIES - 1];
+    double complex m[2][2][FREQUENCIES - 1];
+    double complex *m_vector[4];
+    vnadata_t *vdp = NULL;
+    vnacal_stats_t stats;
+    unsigned long lu_calls = 0;
+    int ci;
+    libt_result_t result = T_FAIL;
+
+    /*
+     * Solve.
+     */
+    vnacal_reset_stats();
+    ttp = make_calibration(vcp);
+    vnacal_get_stats(&stats);
+    if (opt_v) {
+	(void)printf("solve: %lu calls %lu iterations %lu evaluations "
+		"%.0f us\n", stats.vcs_solve_calls,
+		stats.vcs_solve_iterations, stats.vcs_eval_parameter_calls,
+		1.0e-3 * (double)stats.vcs_solve_ns);
+    }
+    if (stats.vcs_solve_calls != 1) {
+	libt_fail("vcs_solve_calls: %lu != 1\n", stats.vcs_solve_calls);
+	goto out;
+    }
+    if (stats.vcs_solve_iterations == 0) {
+	libt_fail("vcs_solve_iterations is zero\n");
+	goto out;
+    }
+    if (stats.vcs_eval_parameter_calls == 0) {
+	libt_fail("vcs_eval_parameter_calls is zero\n");
+	goto out;
+    }
+    if (stats.vcs_apply_calls != 0 || stats.vcs_load_calls != 0) {
+	libt_fail("unexpected apply or load counts\n");
+	goto out;
+    }
+
+    /*
+     * Apply between the calibration frequencies so that the error
+     * terms are interpolated.
+     */
+    if ((ci = vnacal_add_calibration(vcp, "cal", ttp->tt_vnp)) == -1) {
+	libt_error("vnacal_add_calibration: %s\n", strerror(errno));
+    }
+    for (int findex = 0; findex < FREQUENCIES - 1; ++findex) {
+	frequency_vector[findex] = (ttp->tt_frequency_vector[findex] +
+		ttp->tt_frequency_vector[findex + 1]) / 2.0;
+	for (int cell = 0; cell < 4; ++cell) {
+	    m[cell / 2][cell % 2][findex] = (cell / 2 == cell % 2 ? 1.0 : 0.1)
+		+ 0.01 * I * findex;
+	}
+    }
+    for (int cell = 0; cell < 4; ++cell) {
+	m_vector[cell] = m[cell / 2][cell % 2];
+    }
+    if ((vdp = vnadata_alloc(error_fn, NULL)) == NULL) {
+	libt_error("vnadata_alloc: %s\n", strerror(errno));
+    }
+    vnacal_reset_stats();
+    vnacal_get_stats(&stats);
+    if (stats.vcs_solve_calls != 0 || stats.vcs_solve_iterations != 0 ||
+	    stats.vcs_solve_ns != 0) {
+	libt_fail("vnacal_reset_stats didn't clear statistics\n");
+	goto out;
+    }
+    if (vnacal_apply_m(vcp, ci, frequency_vector, FREQUENCIES - 1,
+		m_vector, 2, 2, vdp) == -1) {
+	libt_error("vnacal_apply_m: %s\n", strerror(errno));
+    }
+    vnacal_get_stats(&stats);
+    for (int i = 0; i < VNACAL_STATS_LU_DIMENSIONS; ++i) {
+	lu_calls += stats.vcs_lu_calls[i];
+    }
+    if (opt_v) {
+	(void)printf("apply: %lu calls %lu interpolations %lu LU "
+		"%.0f us\n", stats.vcs_apply_calls, stats.vcs_rfi_calls,
+		lu_calls, 1.0e-3 * (double)stats.vcs_apply_ns);
+    }
+    if (stats.vcs_apply_calls != 1) {
+	libt_fail("vcs_apply_calls: %lu != 1\n", stats.vcs_apply_calls);
+	goto out;
+    }
+    if (stats.vcs_rfi_calls == 0) {
+	libt_fail("vcs_rfi_calls is zero\n");
+	goto out;
+    }
+    if (lu_calls == 0) {
+	libt_fail("vcs_lu_calls is zero\n");
+	goto out;
+    }
+
+    /*
+     * Save and load.
+     */
+    if (vnacal_save(vcp, TEST_FILE) == -1) {
+	libt_error("vnacal_save: %s\n", strerror(errno));
+    }
+    libt_vnacal_free_error_terms(ttp);
+    ttp = NULL;
+    vnacal_free(vcp);
+    if ((vcp = vnacal_load(TEST_FILE, error_fn, NULL)) == NULL) {
+	libt_error("vnacal_load: %s\n", strerror(errno));
+    }
+    vnacal_get_stats(&stats);
+    if (stats.vcs_save_calls != 1 || stats.vcs_load_calls != 1) {
+	libt_fail("save and load counts: %lu %lu != 1 1\n",
+		stats.vcs_save_calls, stats.vcs_load_calls);
+	goto out;
+    }
+    result = T_PASS;
+
+out:
+    vnadata_free(vdp);
+    libt_vnacal_free_error_terms(ttp);
+    vnacal_free(vcp);
+    return result;
+}
+
+/*
+ * convert_thread: convert the data into a new structure
+ *   @arg: data to convert (shared read-only among the threads)
+ */
+static void *convert_thread(void *arg)
+{
+    const vnadata_t *vdp = arg;
+    vnadata_t *result;
+
+    if ((result = vnadata_alloc(error_fn, NULL)) == NULL) {
+	libt_error("vnadata_alloc: %s\n", strerror(errno));
+    }
+    if (vnadata_convert(vdp, result, VPT_Y) == -1) {
+	libt_error("vnadata_convert: %s\n", strerror(errno));
+    }
+    vnadata_free(result);
+    return NULL;
+}
+
+/*
+ * test_vnadata: check the vnadata counters
+ */
+static libt_result_t test_vnadata()
+{
+    static const char *const filename_vector[] = {
+	"test-vnacal-stats.s2p",
+	"test-vnacal-stats.npd",
+	"test-vnacal-stats.npdb"
+    };
+    vnadata_t *vdp = NULL;
+    vnadata_stats_t stats;
+    libt_result_t result = T_FAIL;
+
+    if ((vdp = vnadata_alloc_and_init(error_fn, NULL, VPT_S, 2, 2,
+		    FREQUENCIES)) == NULL) {
+	libt_error("vnadata_alloc_and_init: %s\n", strerror(errno));
+    }
+    for (int findex = 0; findex < FREQUENCIES; ++findex) {
+	(void)vnadata_set_frequency(vdp, findex, 1.0e+6 * (findex + 1));
+	for (int cell = 0; cell < 4; ++cell) {
+	    (void)vnadata_set_cell(vdp, findex, cell / 2, cell % 2,
+		    0.1 * (cell + 1) + 0.01 * I * findex);
+	}
+    }
+    vnadata_reset_stats();
+    if (vnadata_convert(vdp, vdp, VPT_Z) == -1 ||
+	    vnadata_convert(vdp, vdp, VPT_S) == -1) {
+	libt_error("vnadata_convert: %s\n", strerror(errno));
+    }
+    vnadata_get_stats(&stats);
+    if (stats.vds_convert_calls != 2) {
+	libt_fail("vds_convert_calls: %lu != 2\n", stats.vds_convert_calls);
+	goto out;
+    }
+
+    /*
+     * Check that each loader counts every byte of the file.
+     */
+    for (int i = 0; i < sizeof(filename_vector) / sizeof(char *); ++i) {
+	const char *filename = filename_vector[i];
+	long size;
+
+	if (vnadata_save(vdp, filename) == -1) {
+	    libt_error("vnadata_save: %s\n", strerror(errno));
+	}
+	size = file_size(filename);
+	vnadata_reset_stats();
+	if (vnadata_load(vdp, filename) == -1) {
+	    libt_error("vnadata_load: %s\n", strerror(errno));
+	}
+	vnadata_get_stats(&stats);
+	if (opt_v) {
+	    (void)printf("%s: %lu loads %lu bytes %.0f us\n", filename,
+		    stats.vds_load_calls, (unsigned long)stats.vds_load_bytes,
+		    1.0e-3 * (double)stats.vds_load_ns);
+	}
+	if (stats.vds_load_calls != 1 || stats.vds_save_calls != 0) {
+	    libt_fail("%s: load and save counts: %lu %lu != 1 0\n",
+		    filename, stats.vds_load_calls, stats.vds_save_calls);
+	    goto out;
+	}
+	if (stats.vds_load_bytes != (uint64_t)size) {
+	    libt_fail("%s: vds_load_bytes: %lu != %ld\n", filename,
+		    (unsigned long)stats.vds_load_bytes, size);
+	    goto out;
+	}
+    }
+
+    /*
+     * In per-thread mode, the shared counters stay untouched, and
+     * vnadata_get_stats sums the counters of all threads, including
+     * threads that have exited.
+     */
+    vnadata_reset_stats();
+    vnadata_set_stats_per_thread(true);
+    vnadata_reset_stats();
+    {
+	pthread_t thread_vector[THREADS];
+
+	for (int i = 0; i < THREADS; ++i) {
+	    int rv;
+
+	    if ((rv = pthread_create(&thread_vector[i], NULL,
+			    convert_thread, (void *)vdp)) != 0) {
+		libt_error("pthread_create: %s\n", strerror(rv));
+	    }
+	}
+	for (int i = 0; i < THREADS; ++i) {
+	    (void)pthread_join(thread_vector[i], NULL);
+	}
+    }
+    if (vnadata_convert(vdp, vdp, VPT_Y) == -1) {
+	libt_error("vnadata_convert: %s\n", strerror(errno));
+    }
+    vnadata_get_stats(&stats);
+    vnadata_set_stats_per_thread(false);
+    if (stats.vds_convert_calls != THREADS + 1) {
+	libt_fail("per-thread vds_convert_calls: %lu != %d\n",
+		stats.vds_convert_calls, THREADS + 1);
+	goto out;
+    }
+    vnadata_get_stats(&stats);
+    if (stats.vds_convert_calls != 0) {
+	libt_fail("shared vds_convert_calls: %lu != 0\n",
+		stats.vds_convert_calls);
+	goto out;
+    }
+    result = T_PASS;
+
+out:
+    vnadata_free(vdp);
+    return result;
+}
+
+/*
+ * test_vnacal_stats: run the tests
+ */
+static libt_result_t test_vnacal_stats()
+{
+    vnacal_t *vcp;
+    libt_result_t result;
+
+    /*
+     * The counters are compiled in only with configure --enable-stats.
+     */
+#ifndef ENABLE_STATS
+    result = T_SKIPPED;
+    goto out;
+#endif
+    if ((vcp = vnacal_create(error_fn, NULL)) == NULL) {
+	libt_error("vnacal_create: %s\n", strerror(errno));
+    }
+    if ((result = test_vnacal(vcp)) != T_PASS) {
+	goto out;
+    }
+    if ((result = test_vnadata()) != T_PASS) {
+	goto out;
+    }
+
+out:
+    libt_report(result);
+    return result;
+}
+
+/*
+ * print_usage: print a usage message and exit
+ */
+static void print_usage()
+{
+    const char *const *cpp;
+
+    for (cpp = usage; *cpp != NULL; ++cpp) {
+	(void)fprintf(stderr, "%s: usage %s\n", progname, *cpp);
+    }
+    for (cpp = help; *cpp != NULL; ++cpp) {
+	(void)fprintf(stderr, "%s\n", *cpp);
+    }
+    exit(2);
+}
+
+/*
+ * main: test program
+ */
+int
+main(int argc, char **argv)
+{
+    if ((char *)NULL == (progname = strrchr(argv[0], '/'))) {
+	progname = argv[0];
+    } else {
+	++progname;
+    }
+    for (;;) {
+	switch (getopt(argc, argv, options)) {
+	case 'a':
+	    opt_a = true;
+	    continue;
+
+	case 'v':
+	    ++opt_v;
+	    continue;
+
+	case -1:
+	    break;
+
+	default:
+	    print_usage();
+	}
+	break;
+    }
+    argc -= optind;
+    argv += optind;
+    if (argc != 0) {
+	print_usage();
+    }
+    libt_isequal_init();
+    exit(test_vnacal_stats());
+}
@@ -97,6 +97,22 @@ static int run_trial(int trial, vnadata_t *vdp, vnadata_parameter_type_t type,
     if ((result = libt_vnadata_validate(tdp, vdp)) != T_PASS) {
 	goto out;
     }
+
+    /*
+     * Switch to the other storage layout and validate again.  The new
+     * layout is retained into the next trial to test init and resize
+     * in both layouts.
+     */
+    if (vnadata_set_layout(vdp, vnadata_get_layout(vdp) ==
+		VNADATA_LAYOUT_CELL_MAJOR ? VNADATA_LAYOUT_FREQUENCY_MAJOR :
+		VNADATA_LAYOUT_CELL_MAJOR) == -1) {
+	libt_fail("vnadata_set_layout: returned -1\n");
+	result = T_FAIL;
+	goto out;
+    }
+    if ((result = libt_vnadata_validate(tdp, vdp)) != T_PASS) {
+	goto out;
+    }
     result = T_PASS;
 
 out:
@@ -0,0 +1,590 @@
+/*
+ * Vector Network Analyzer Library
+ * Copyright © 2020-2023 D Scott Guthridge <scott_guthridge@rompromity.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "archdep.h"
+
+#include <complex.h>
+#include <errno.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include "vnadata.h"
+#include "libt.h"
+
+
+#define FREQUENCIES	3
+#define MAX_PORTS	5
+
+/*
+ * Options
+ */
+char *progname;
+static const char options[] = "agv";
+static const char *const usage[] = {
+    "[-agv]",
+    NULL
+};
+static const char *const help[] = {
+    "-a	 abort on data miscompare",
+    "-g	 write the expected output to standard output",
+    "-v	 show verbose output",
+    NULL
+};
+bool opt_a = false;
+bool opt_g = false;
+int opt_v = 0;
+
+/*
+ * file: expected output generated from the original formatter
+ */
+static const char file[] = "test-vnadata-golden.txt";
+static const char *pathname = file;
+
+/*
+ * golden_frequency_vector: test frequencies
+ */
+static const double golden_frequency_vector[FREQUENCIES] = {
+    1.5e+6, 2.123456789e+9, 9.99999999e+9
+};
+
+/*
+ * golden_value_vector: cell values, chosen to hit rounding carries,
+ *   signed zeros, very small and very large magnitudes
+ */
+static const double complex golden_value_vector[] = {
+     0.5       + 0.25      * I,
+    -0.123456789012345 - 0.987654321098765 * I,
+     1.0e-9    + 0.0       * I,
+     0.999995  - 5.0e-7    * I,
+    -0.0       + 0.0       * I,
+     0.1234567 + 0.7654321 * I,
+     0.7071067811865476 + 0.7071067811865476 * I,
+    -0.05      + 0.95      * I,
+     0.3333333333333333 - 0.6666666666666666 * I,
+     9.5e-5    - 9.95e-3   * I,
+    -0.45      - 0.0       * I,
+};
+#define N_VALUES	(sizeof(golden_value_vector) / \
+	sizeof(golden_value_vector[0]))
+
+/*
+ * golden_z0_vector: per-port reference impedances
+ */
+static const double complex golden_z0_vector[MAX_PORTS] = {
+    50.0, 75.0, 25.0, 100.0, 60.0
+};
+
+/*
+ * golden_z0_mode_t: how reference impedances are set
+ */
+typedef enum golden_z0_mode {
+    Z0_UNIFORM,		/* all ports 50 ohms */
+    Z0_VECTOR,		/* per-port z0 */
+    Z0_FVECTOR		/* per-frequency, per-port z0 */
+} golden_z0_mode_t;
+
+/*
+ * golden_z0_names: names of golden_z0_mode_t values
+ */
+static const char *const golden_z0_names[] = {
+    "uniform", "vector", "fvector"
+};
+
+/*
+ * golden_case_t: filetype and format combination to save
+ */
+typedef struct golden_case {
+    vnadata_filetype_t	gc_filetype;
+    const char	       *gc_format;
+    int			gc_min_ports;
+    int			gc_max_ports;
+} golden_case_t;
+
+/*
+ * golden_cases: all filetype and format combinations tested
+ */
+static const golden_case_t golden_cases[] = {
+    { VNADATA_FILETYPE_TOUCHSTONE1, "Sri",  1, 4 },
+    { VNADATA_FILETYPE_TOUCHSTONE1, "Sma",  2, 2 },
+    { VNADATA_FILETYPE_TOUCHSTONE1, "SdB",  2, 2 },
+    { VNADATA_FILETYPE_TOUCHSTONE1, "Zri",  2, 2 },
+    { VNADATA_FILETYPE_TOUCHSTONE1, "Zma",  2, 2 },
+    { VNADATA_FILETYPE_TOUCHSTONE1, "Yri",  2, 2 },
+    { VNADATA_FILETYPE_TOUCHSTONE1, "Yma",  2, 2 },
+    { VNADATA_FILETYPE_TOUCHSTONE1, "Hri",  2, 2 },
+    { VNADATA_FILETYPE_TOUCHSTONE1, "Gma",  2, 2 },
+    { VNADATA_FILETYPE_TOUCHSTONE2, "Sri",  1, 5 },
+    { VNADATA_FILETYPE_TOUCHSTONE2, "SdB",  2, 2 },
+    { VNADATA_FILETYPE_TOUCHSTONE2, "Zma",  2, 2 },
+    { VNADATA_FILETYPE_TOUCHSTONE2, "Hri",  2, 2 },
+    { VNADATA_FILETYPE_NPD, "Sri,Sma,SdB",                       2, 2 },
+    { VNADATA_FILETYPE_NPD, "Zri,Yma,Tri,Uma",                   2, 2 },
+    { VNADATA_FILETYPE_NPD, "Hri,Gma,Ari,Bma",                   2, 2 },
+    { VNADATA_FILETYPE_NPD, "Zinri,Zinma,PRC,PRL,SRC,SRL",       2, 2 },
+    { VNADATA_FILETYPE_NPD, "IL,RL,VSWR",                        2, 2 },
+    { VNADATA_FILETYPE_NPD, "Zri,SdB,Zinma,VSWR",                1, 5 },
+};
+#define N_CASES	(sizeof(golden_cases) / sizeof(golden_cases[0]))
+
+/*
+ * golden_filetype_names: filetype names used in case headers
+ */
+static const char *const golden_filetype_names[] = {
+    "auto", "touchstone1", "touchstone2", "npd", "npdb"
+};
+
+/*
+ * golden_ports: port counts tested
+ */
+static const int golden_ports[] = { 1, 2, 3, 4, 5 };
+#define N_PORTS	(sizeof(golden_ports) / sizeof(golden_ports[0]))
+
+/*
+ * golden_short_precisions: precisions used for all but the main dataset
+ */
+static const int golden_short_precisions[] = {
+    6
+};
+#define N_SHORT_PRECISIONS	(sizeof(golden_short_precisions) / \
+	sizeof(golden_short_precisions[0]))
+
+/*
+ * buffer_t: growable output buffer
+ */
+typedef struct buffer {
+    char   *b_data;
+    size_t  b_length;
+    size_t  b_allocation;
+} buffer_t;
+
+/*
+ * buffer_append: append bytes to the buffer
+ *   @bp: buffer
+ *   @data: bytes to append
+ *   @length: number of bytes
+ */
+static void buffer_append(buffer_t *bp, const char *data, size_t length)
+{
+    if (bp->b_length + length > bp->b_allocation) {
+	size_t new_allocation = bp->b_allocation == 0 ?
+	    65536 : bp->b_allocation;
+	char *cp;
+
+	while (bp->b_length + length > new_allocation) {
+	    new_allocation *= 2;
+	}
+	if ((cp = realloc(bp->b_data, new_allocation)) == NULL) {
+	    (void)fprintf(stderr, "%s: realloc: %s\n",
+		    progname, strerror(errno));
+	    exit(99);
+	}
+	bp->b_data = cp;
+	bp->b_allocation = new_allocation;
+    }
+    (void)memcpy(&bp->b_data[bp->b_length], data, length);
+    bp->b_length += length;
+}
+
+/*
+ * error_fn: error reporting function
+ *   @message: error message
+ *   @arg: (unused)
+ *   @category: error category (unused)
+ */
+static void error_fn(const char *message, void *arg, vnaerr_category_t category)
+{
+    (void)fprintf(stderr, "%s: %s\n", progname, message);
+}
+
+/*
+ * make_dataset: build the deterministic test dataset
+ *   @ports: number of ports
+ *   @z0_mode: how to set reference impedances
+ */
+static vnadata_t *make_dataset(int ports, golden_z0_mode_t z0_mode)
+{
+    vnadata_t *vdp;
+
+    if ((vdp = vnadata_alloc_and_init(error_fn, NULL, VPT_S,
+		    ports, ports, FREQUENCIES)) == NULL) {
+	return NULL;
+    }
+    if (vnadata_set_frequency_vector(vdp, golden_frequency_vector) == -1) {
+	goto error;
+    }
+    for (int findex = 0; findex < FREQUENCIES; ++findex) {
+	for (int row = 0; row < ports; ++row) {
+	    for (int column = 0; column < ports; ++column) {
+		int cell = row * ports + column;
+		double complex value;
+
+		value = golden_value_vector[(findex * 7 + cell * 3) %
+		    N_VALUES];
+		if (row == column) {	/* keep the matrix well conditioned */
+		    value *= 0.4;
+		} else {
+		    value *= 0.8 / ports;
+		}
+		if (vnadata_set_cell(vdp, findex, row, column, value) == -1) {
+		    goto error;
+		}
+	    }
+	}
+    }
+    switch (z0_mode) {
+    case Z0_UNIFORM:
+	break;
+
+    case Z0_VECTOR:
+	if (vnadata_set_z0_vector(vdp, golden_z0_vector) == -1) {
+	    goto error;
+	}
+	break;
+
+    case Z0_FVECTOR:
+	for (int findex = 0; findex < FREQUENCIES; ++findex) {
+	    double complex z0_vector[MAX_PORTS];
+
+	    for (int port = 0; port < ports; ++port) {
+		z0_vector[port] = golden_z0_vector[port] +
+		    (double)findex * (1.0 - 0.25 * I);
+	    }
+	    if (vnadata_set_fz0_vector(vdp, findex, z0_vector) == -1) {
+		goto error;
+	    }
+	}
+	break;
+    }
+    return vdp;
+
+error:
+    vnadata_free(vdp);
+    return NULL;
+}
+
+/*
+ * save_case: save a dataset in one filetype, format and precision
+ *   @bp: output buffer
+ *   @vdp: dataset
+ *   @gcp: filetype and format
+ *   @ports: number of ports (for the header)
+ *   @z0_mode: reference impedance mode (for the header)
+ *   @precision: fprecision and dprecision
+ */
+static int save_case(buffer_t *bp, vnadata_t *vdp, const golden_case_t *gcp,
+	int ports, golden_z0_mode_t z0_mode, int precision)
+{
+    FILE *fp;
+    char header[200];
+    char data[4096];
+    size_t n;
+
+    (void)snprintf(header, sizeof(header),
+	    "#### %s %s ports=%d z0=%s precision=%d\n",
+	    golden_filetype_names[gcp->gc_filetype], gcp->gc_format,
+	    ports, golden_z0_names[z0_mode], precision);
+    buffer_append(bp, header, strlen(header));
+    if (vnadata_set_filetype(vdp, gcp->gc_filetype) == -1) {
+	return -1;
+    }
+    if (vnadata_set_format(vdp, gcp->gc_format) == -1) {
+	return -1;
+    }
+    if (vnadata_set_fprecision(vdp, precision) == -1) {
+	return -1;
+    }
+    if (vnadata_set_dprecision(vdp, precision) == -1) {
+	return -1;
+    }
+    if ((fp = tmpfile()) == NULL) {
+	(void)fprintf(stderr, "%s: tmpfile: %s\n",
+		progname, strerror(errno));
+	exit(99);
+    }
+    if (vnadata_fsave(vdp, fp, "test-vnadata-golden") == -1) {
+	(void)fclose(fp);
+	return -1;
+    }
+    rewind(fp);
+    while ((n = fread(data, 1, sizeof(data), fp)) > 0) {
+	buffer_append(bp, data, n);
+    }
+    (void)fclose(fp);
+    return 0;
+}
+
+/*
+ * generate_output: save every case into the output buffer
+ *   @bp: output buffer
+ */
+static int generate_output(buffer_t *bp)
+{
+    for (int pindex = 0; pindex < N_PORTS; ++pindex) {
+	int ports = golden_ports[pindex];
+
+	for (golden_z0_mode_t z0_mode = Z0_UNIFORM; z0_mode <= Z0_FVECTOR;
+		++z0_mode) {
+	    vnadata_t *vdp;
+
+	    if ((vdp = make_dataset(ports, z0_mode)) == NULL) {
+		return -1;
+	    }
+	    for (int cindex = 0; cindex < N_CASES; ++cindex) {
+		const golden_case_t *gcp = &golden_cases[cindex];
+
+		if (ports < gcp->gc_min_ports || ports > gcp->gc_max_ports) {
+		    continue;
+		}
+		if (z0_mode == Z0_VECTOR &&
+			gcp->gc_filetype == VNADATA_FILETYPE_TOUCHSTONE1) {
+		    continue;
+		}
+		if (z0_mode == Z0_FVECTOR &&
+			gcp->gc_filetype != VNADATA_FILETYPE_NPD) {
+		    continue;
+		}
+
+		/*
+		 * Run every precision on the uniform 2-port dataset
+		 * and a representative few on the others.
+		 */
+		if (ports == 2 && z0_mode == Z0_UNIFORM) {
+		    for (int precision = 1; precision <= 17; ++precision) {
+			if (save_case(bp, vdp, gcp, ports, z0_mode,
+				    precision) == -1) {
+			    vnadata_free(vdp);
+			    return -1;
+			}
+		    }
+		    if (save_case(bp, vdp, gcp, ports, z0_mode,
+				VNADATA_MAX_PRECISION) == -1) {
+			vnadata_free(vdp);
+			return -1;
+		    }
+		} else {
+		    for (int i = 0; i < N_SHORT_PRECISIONS; ++i) {
+			if (save_case(bp, vdp, gcp, ports, z0_mode,
+				    golden_short_precisions[i]) == -1) {
+			    vnadata_free(vdp);
+			    return -1;
+			}
+		    }
+		}
+	    }
+	    vnadata_free(vdp);
+	}
+    }
+    return 0;
+}
+
+/*
+ * read_expected: read the expected output file
+ *   @bp: output buffer
+ */
+static int read_expected(buffer_t *bp)
+{
+    FILE *fp;
+    char data[4096];
+    size_t n;
+
+    if ((fp = fopen(pathname, "r")) == NULL) {
+	(void)fprintf(stderr, "%s: fopen: %s: %s\n",
+		progname, pathname, strerror(errno));
+	return -1;
+    }
+    while ((n = fread(data, 1, sizeof(data), fp)) > 0) {
+	buffer_append(bp, data, n);
+    }
+    (void)fclose(fp);
+    return 0;
+}
+
+/*
+ * report_difference: show the case and line where the outputs diverge
+ *   @actual: generated output
+ *   @expected: expected output
+ */
+static void report_difference(const buffer_t *actual, const buffer_t *expected)
+{
+    size_t offset = 0;
+    size_t line_start = 0;
+    size_t case_start = 0;
+    size_t end;
+
+    while (offset < actual->b_length && offset < expected->b_length &&
+	    actual->b_data[offset] == expected->b_data[offset]) {
+	if (actual->b_data[offset] == '\n') {
+	    line_start = offset + 1;
+	    if (strncmp(&actual->b_data[line_start], "####", 4) == 0) {
+		case_start = line_start;
+	    }
+	}
+	++offset;
+    }
+    for (end = case_start; end < actual->b_length &&
+	    actual->b_data[end] != '\n'; ++end) {
+    }
+    libt_fail("output differs at byte %zu in case: %.*s\n",
+	    offset, (int)(end - case_start), &actual->b_data[case_start]);
+    for (end = line_start; end < expected->b_length &&
+	    expected->b_data[end] != '\n'; ++end) {
+    }
+    libt_fail("  expected: %.*s\n", (int)(end - line_start),
+	    &expected->b_data[line_start]);
+    for (end = line_start; end < actual->b_length &&
+	    actual->b_data[end] != '\n'; ++end) {
+    }
+    libt_fail("  actual:   %.*s\n", (int)(end - line_start),
+	    &actual->b_data[line_start]);
+}
+
+/*
+ * test_vnadata_golden: compare saved files with the expected output
+ */
+static libt_result_t test_vnadata_golden()
+{
+    buffer_t actual = { NULL, 0, 0 };
+    buffer_t expected = { NULL, 0, 0 };
+    libt_result_t result = T_SKIPPED;
+
+    if (generate_output(&actual) == -1) {
+	result = T_FAIL;
+	goto out;
+    }
+    if (read_expected(&expected) == -1) {
+	result = T_FAIL;
+	goto out;
+    }
+    if (actual.b_length != expected.b_length ||
+	    memcmp(actual.b_data, expected.b_data, actual.b_length) != 0) {
+	report_difference(&actual, &expected);
+	result = T_FAIL;
+	goto out;
+    }
+    if (opt_v >= 1) {
+	(void)printf("%zu bytes match\n", actual.b_length);
+    }
+    result = T_PASS;
+
+out:
+    free((void *)actual.b_data);
+    free((void *)expected.b_data);
+    libt_report(result);
+    return result;
+}
+
+/*
+ * print_usage: print a usage message and exit
+ */
+static void print_usage()
+{
+    const char *const *cpp;
+
+    for (cpp = usage; *cpp != NULL; ++cpp) {
+	(void)fprintf(stderr, "%s: usage %s\n", progname, *cpp);
+    }
+    for (cpp = help; *cpp != NULL; ++cpp) {
+	(void)fprintf(stderr, "%s\n", *cpp);
+    }
+    exit(99);
+}
+
+/*
+ * main
+ */
+int
+main(int argc, char **argv)
+{
+    char *srcdir = NULL;
+
+    /*
+     * Parse Options
+     */
+    if ((char *)NULL == (progname = strrchr(argv[0], '/'))) {
+	progname = argv[0];
+    } else {
+	++progname;
+    }
+    for (;;) {
+	switch (getopt(argc, argv, options)) {
+	case -1:
+	    break;
+
+	case 'a':
+	    opt_a = true;
+	    continue;
+
+	case 'g':
+	    opt_g = true;
+	    continue;
+
+	case 'v':
+	    ++opt_v;
+	    continue;
+
+	default:
+	    print_usage();
+	}
+	break;
+    }
+
+    /*
+     * With -g, write the output that the expected file should contain.
+     */
+    if (opt_g) {
+	buffer_t output = { NULL, 0, 0 };
+
+	if (generate_output(&output) == -1) {
+	    exit(99);
+	}
+	if (fwrite(output.b_data, 1, output.b_length, stdout) !=
+		output.b_length) {
+	    (void)fprintf(stderr, "%s: fwrite: %s\n",
+		    progname, strerror(errno));
+	    exit(99);
+	}
+	free((void *)output.b_data);
+	exit(0);
+    }
+
+    /*
+     * If srcdir is defined in the environment, incorporate it into
+     * pathname.
+     */
+    if ((srcdir = getenv("srcdir")) != NULL) {
+	char *cp;
+
+	if ((cp = malloc(strlen(srcdir) + 1 +
+			sizeof(file))) == NULL) {
+	    (void)fprintf(stderr, "%s: malloc: %s\n",
+		    progname, strerror(errno));
+	    exit(99);
+	}
+	pathname = cp;
+	(void)strcpy(cp, srcdir);
+	cp += strlen(cp);
+	*cp++ = '/';
+	(void)strcpy(cp, file);
+    }
+    exit(test_vnadata_golden());
+}
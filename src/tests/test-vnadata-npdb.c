@@ -0,0 +1,422 @@
+/*
+ * Vector Network Analyzer Library
+ * Copyright © 2020-2023 D Scott Guthridge <scott_guthridge@rompromity.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "archdep.h"
+
+#include <complex.h>
+#include <errno.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include "vnadata.h"
+#include "libt.h"
+#include "libt_vnadata.h"
+
+
+#define PORTS		3
+#define FREQUENCIES	25
+#define SAVE_FILE	"test-vnadata-npdb.npdb"
+
+/*
+ * Options
+ */
+char *progname;
+static const char options[] = "av";
+static const char *const usage[] = {
+    "[-av]",
+    NULL
+};
+static const char *const help[] = {
+    "-a	 abort on data miscompare",
+    "-v	 show verbose output",
+    NULL
+};
+bool opt_a = false;
+int opt_v = 0;
+
+/*
+ * expect_errors: if true, don't report errors
+ */
+static bool expect_errors = false;
+
+/*
+ * error_fn: error reporting function
+ *   @message: error message
+ *   @arg: (unused)
+ *   @category: error category (unused)
+ */
+static void error_fn(const char *message, void *arg, vnaerr_category_t category)
+{
+    if (!expect_errors || opt_v >= 1) {
+	(void)printf("error: %s: %s\n", progname, message);
+    }
+}
+
+/*
+ * make_data: create randomly filled network parameter data
+ *   @layout: storage layout
+ *   @fz0: use frequency-dependent reference impedances
+ */
+static vnadata_t *make_data(vnadata_layout_t layout, bool fz0)
+{
+    vnadata_t *vdp;
+
+    vdp = libt_vnadata_make(error_fn, layout, VPT_S, PORTS, FREQUENCIES,
+	    fz0 ? Z0_PER_F : Z0_COMPLEX_VECTOR);
+    if (vnadata_set_name(vdp, "dut") == -1 ||
+	    vnadata_set_format(vdp, "Sri,Zma") == -1 ||
+	    vnadata_set_dprecision(vdp, 9) == -1) {
+	libt_error("vnadata_set_*: %s\n", strerror(errno));
+    }
+    return vdp;
+}
+
+/*
+ * check_equal: verify that two structures hold exactly the same values
+ *   @what: description for error messages
+ *   @actual: structure to check
+ *   @expected: expected values
+ */
+static libt_result_t check_equal(const char *what, const vnadata_t *actual,
+	const vnadata_t *expected)
+{
+    if (libt_vnadata_compare(what, actual, expected,
+		FREQUENCIES) != T_PASS) {
+	return T_FAIL;
+    }
+    if (strcmp(vnadata_get_name(actual), vnadata_get_name(expected)) != 0 ||
+	    strcmp(vnadata_get_format(actual),
+		vnadata_get_format(expected)) != 0 ||
+	    vnadata_get_dprecision(actual) !=
+		vnadata_get_dprecision(expected)) {
+	libt_fail("%s: wrong name, format or precision\n", what);
+	return T_FAIL;
+    }
+    return T_PASS;
+}
+
+/*
+ * run_trial: save, load and map one combination
+ *   @layout: layout of the saved data
+ *   @load_layout: layout of the structure loaded into
+ *   @fz0: use frequency-dependent reference impedances
+ */
+static libt_result_t run_trial(vnadata_layout_t layout,
+	vnadata_layout_t load_layout, bool fz0)
+{
+    vnadata_t *original = NULL;
+    vnadata_t *loaded = NULL;
+    vnadata_t *mapped = NULL;
+    libt_result_t result = T_FAIL;
+
+    if (opt_v >= 1) {
+	(void)printf("Test npdb: save %s load %s %s\n",
+		layout == VNADATA_LAYOUT_CELL_MAJOR ? "cell" : "freq",
+		load_layout == VNADATA_LAYOUT_CELL_MAJOR ? "cell" : "freq",
+		fz0 ? "fz0" : "z0");
+	(void)fflush(stdout);
+    }
+
+    /*
+     * Save and load back into the requested layout.
+     */
+    original = make_data(layout, fz0);
+    if (vnadata_save(original, SAVE_FILE) == -1) {
+	libt_fail("vnadata_save: returned -1\n");
+	goto out;
+    }
+    if ((loaded = vnadata_alloc(error_fn, NULL)) == NULL ||
+	    (mapped = vnadata_alloc(error_fn, NULL)) == NULL) {
+	libt_error("vnadata_alloc: %s\n", strerror(errno));
+    }
+    if (vnadata_set_layout(loaded, load_layout) == -1) {
+	libt_fail("vnadata_set_layout: returned -1\n");
+	goto out;
+    }
+    if (vnadata_load(loaded, SAVE_FILE) == -1) {
+	libt_fail("vnadata_load: returned -1\n");
+	goto out;
+    }
+    if (vnadata_get_layout(loaded) != load_layout ||
+	    vnadata_get_filetype(loaded) != VNADATA_FILETYPE_NPDB) {
+	libt_fail("vnadata_load: wrong layout or filetype\n");
+	goto out;
+    }
+    if ((result = check_equal("load", loaded, original)) != T_PASS) {
+	goto out;
+    }
+    result = T_FAIL;
+
+    /*
+     * Map the file.  The result has the saved layout.
+     */
+    if (vnadata_map(mapped, SAVE_FILE) == -1) {
+	libt_fail("vnadata_map: returned -1\n");
+	goto out;
+    }
+    if (vnadata_get_layout(mapped) != layout) {
+	libt_fail("vnadata_map: wrong layout\n");
+	goto out;
+    }
+    if ((result = check_equal("map", mapped, original)) != T_PASS) {
+	goto out;
+    }
+    result = T_FAIL;
+
+    /*
+     * Write to the mapped data.  Check that it was given its own copy
+     * and that the file didn't change.
+     */
+    if (vnadata_set_cell(mapped, 0, 0, 0, 1.0 + 2.0 * I) == -1) {
+	libt_fail("vnadata_set_cell: returned -1\n");
+	goto out;
+    }
+    if (vnadata_is_view(mapped)) {
+	libt_fail("vnadata_set_cell: mapping not materialized\n");
+	goto out;
+    }
+    if (vnadata_get_cell(mapped, 0, 0, 0) != 1.0 + 2.0 * I ||
+	    vnadata_get_cell(mapped, 0, 1, 0) !=
+		vnadata_get_cell(original, 0, 1, 0)) {
+	libt_fail("vnadata_set_cell: wrong values after write\n");
+	goto out;
+    }
+    if (vnadata_map(mapped, SAVE_FILE) == -1) {
+	libt_fail("vnadata_map: returned -1\n");
+	goto out;
+    }
+    if ((result = check_equal("remap", mapped, original)) != T_PASS) {
+	goto out;
+    }
+    result = T_FAIL;
+
+    /*
+     * Save the mapped data over the file it's mapped from.  The mapping
+     * must keep its contents, and the new file must match.
+     */
+    if (vnadata_save(mapped, SAVE_FILE) == -1) {
+	libt_fail("vnadata_save: returned -1 saving over mapping\n");
+	goto out;
+    }
+    if ((result = check_equal("save over map", mapped,
+		    original)) != T_PASS) {
+	goto out;
+    }
+    result = T_FAIL;
+    if (vnadata_load(loaded, SAVE_FILE) == -1) {
+	libt_fail("vnadata_load: returned -1\n");
+	goto out;
+    }
+    if ((result = check_equal("reload", loaded, original)) != T_PASS) {
+	goto out;
+    }
+    result = T_FAIL;
+
+    /*
+     * Re-initializing a mapped structure must release the mapping.
+     */
+    if (vnadata_init(mapped, VPT_Z, 2, 2, 4) == -1 ||
+	    vnadata_is_view(mapped)) {
+	libt_fail("vnadata_init: failed to replace mapping\n");
+	goto out;
+    }
+    result = T_PASS;
+
+out:
+    vnadata_free(mapped);
+    vnadata_free(loaded);
+    vnadata_free(original);
+    return result;
+}
+
+/*
+ * test_errors: test that damaged files are rejected
+ */
+static libt_result_t test_errors()
+{
+    vnadata_t *original = NULL;
+    vnadata_t *vdp = NULL;
+    FILE *fp;
+    long size;
+    char *contents = NULL;
+    libt_result_t result = T_FAIL;
+
+    /*
+     * Save a good file and read it into memory.
+     */
+    original = make_data(VNADATA_LAYOUT_FREQUENCY_MAJOR, false);
+    if (vnadata_save(original, SAVE_FILE) == -1) {
+	libt_fail("vnadata_save: returned -1\n");
+	goto out;
+    }
+    if ((fp = fopen(SAVE_FILE, "rb")) == NULL) {
+	libt_error("fopen: %s: %s\n", SAVE_FILE, strerror(errno));
+    }
+    (void)fseek(fp, 0L, SEEK_END);
+    size = ftell(fp);
+    rewind(fp);
+    if ((contents = malloc(size)) == NULL) {
+	libt_error("malloc: %s\n", strerror(errno));
+    }
+    if (fread((void *)contents, 1, size, fp) != size) {
+	libt_error("fread: %s: %s\n", SAVE_FILE, strerror(errno));
+    }
+    (void)fclose(fp);
+    if ((vdp = vnadata_alloc(error_fn, NULL)) == NULL) {
+	libt_error("vnadata_alloc: %s\n", strerror(errno));
+    }
+
+    /*
+     * Try a truncated file, a bad magic number and a bad version.
+     */
+    for (int i = 0; i < 3; ++i) {
+	char *damaged = contents;
+	long length = size;
+	char copy[256];
+
+	switch (i) {
+	case 0:
+	    length = size - 1;
+	    break;
+
+	case 1:
+	    (void)memcpy((void *)copy, (void *)contents, sizeof(copy));
+	    copy[1] = 'X';
+	    break;
+
+	case 2:
+	    (void)memcpy((void *)copy, (void *)contents, sizeof(copy));
+	    copy[8] = 99;
+	    break;
+	}
+	if (i != 0) {
+	    if ((fp = fopen(SAVE_FILE, "r+b")) == NULL) {
+		libt_error("fopen: %s: %s\n", SAVE_FILE, strerror(errno));
+	    }
+	    (void)fwrite((void *)copy, 1, sizeof(copy), fp);
+	} else {
+	    if ((fp = fopen(SAVE_FILE, "wb")) == NULL) {
+		libt_error("fopen: %s: %s\n", SAVE_FILE, strerror(errno));
+	    }
+	    (void)fwrite((void *)damaged, 1, length, fp);
+	}
+	if (fclose(fp) == EOF) {
+	    libt_error("fclose: %s: %s\n", SAVE_FILE, strerror(errno));
+	}
+	expect_errors = true;
+	if (vnadata_load(vdp, SAVE_FILE) != -1 ||
+		vnadata_map(vdp, SAVE_FILE) != -1) {
+	    expect_errors = false;
+	    libt_fail("case %d: expected failure\n", i);
+	    goto out;
+	}
+	expect_errors = false;
+    }
+    result = T_PASS;
+
+out:
+    free((void *)contents);
+    vnadata_free(vdp);
+    vnadata_free(original);
+    return result;
+}
+
+/*
+ * test_vnadata_npdb: test binary network parameter data save, load and map
+ */
+static libt_result_t test_vnadata_npdb()
+{
+    libt_result_t result = T_FAIL;
+
+    for (int i = 0; i < 8; ++i) {
+	const vnadata_layout_t layout = (i & 1) ?
+	    VNADATA_LAYOUT_CELL_MAJOR : VNADATA_LAYOUT_FREQUENCY_MAJOR;
+	const vnadata_layout_t load_layout = (i & 2) ?
+	    VNADATA_LAYOUT_CELL_MAJOR : VNADATA_LAYOUT_FREQUENCY_MAJOR;
+
+	if ((result = run_trial(layout, load_layout, (i & 4) != 0)) !=
+		T_PASS) {
+	    goto out;
+	}
+    }
+    if ((result = test_errors()) != T_PASS) {
+	goto out;
+    }
+
+out:
+    libt_report(result);
+    return result;
+}
+
+/*
+ * print_usage: print a usage message and exit
+ */
+static void print_usage()
+{
+    const char *const *cpp;
+
+    for (cpp = usage; *cpp != NULL; ++cpp) {
+	(void)fprintf(stderr, "%s: usage %s\n", progname, *cpp);
+    }
+    for (cpp = help; *cpp != NULL; ++cpp) {
+	(void)fprintf(stderr, "%s\n", *cpp);
+    }
+    exit(2);
+}
+
+/*
+ * main: test program
+ */
+int
+main(int argc, char **argv)
+{
+    if ((char *)NULL == (progname = strrchr(argv[0], '/'))) {
+	progname = argv[0];
+    } else {
+	++progname;
+    }
+    for (;;) {
+	switch (getopt(argc, argv, options)) {
+	case 'a':
+	    opt_a = true;
+	    continue;
+
+	case 'v':
+	    ++opt_v;
+	    continue;
+
+	case -1:
+	    break;
+
+	default:
+	    print_usage();
+	}
+	break;
+    }
+    argc -= optind;
+    argv += optind;
+    if (argc != 0) {
+	print_usage();
+    }
+    exit(test_vnadata_npdb());
+}
@@ -0,0 +1,377 @@
+/*
+ * Vector Network Analyzer Library
+ * Copyright © 2020-2023 D Scott Guthridge <scott_guthridge@rompromity.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "archdep.h"
+
+#include <complex.h>
+#include <errno.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include "vnadata.h"
+#include "libt.h"
+#include "libt_vnadata.h"
+
+
+#define BASENAME	"test-vnadata-probe"
+
+/*
+ * Options
+ */
+char *progname;
+static const char options[] = "av";
+static const char *const usage[] = {
+    "[-av]",
+    NULL
+};
+static const char *const help[] = {
+    "-a	 abort on data miscompare",
+    "-v	 show verbose output",
+    NULL
+};
+bool opt_a = false;
+int opt_v = 0;
+
+/*
+ * error_fn: error reporting function
+ *   @message: error message
+ *   @arg: (unused)
+ *   @category: error category (unused)
+ */
+static void error_fn(const char *message, void *arg, vnaerr_category_t category)
+{
+    (void)printf("error: %s: %s\n", progname, message);
+}
+
+/*
+ * trial_t: file to save, then probe
+ */
+typedef struct trial {
+    const char *t_suffix;
+    int t_ports;
+    vnadata_parameter_type_t t_type;
+    const char *t_format;
+    int t_frequencies;
+    bool t_fz0;
+    const char *t_trailer;	/* text appended to the file, or NULL */
+} trial_t;
+
+static const trial_t trials[] = {
+    { "s1p",  1, VPT_S, "ri",	     50, false, NULL },
+    { "s2p",  2, VPT_S, "ma",	     50, false, "! trailing comment\n" },
+    { "s3p",  3, VPT_Z, "Zma",	      1, false, NULL },
+    { "s4p",  4, VPT_S, "ri",	     30, false, NULL },
+    { "ts",   2, VPT_Y, "Yri",	      2, false, NULL },
+    { "ts",   3, VPT_S, "Sma",	    500, false, "! trailing comment\n" },
+    { "ts",   4, VPT_Z, "Zri",	      3, false, NULL },
+    { "npd",  2, VPT_S, "Sri,Zma",  500, false, "# comment\n\n" },
+    { "npd",  2, VPT_Z, "Zri",	     40, true,  NULL },
+    { "npd",  1, VPT_S, "Sri",	      1, false, NULL },
+    { "npd",  3, VPT_S, "Sri",	      2, false, NULL },
+    { "npdb", 3, VPT_S, "Sri",	     20, true,  NULL },
+    { "npdb", 2, VPT_Z, NULL,	     20, false, NULL },
+};
+#define N_TRIALS	(sizeof(trials) / sizeof(trials[0]))
+
+/*
+ * text_file_t: hand-written file to probe
+ */
+typedef struct text_file {
+    const char *tf_suffix;
+    const char *tf_text;
+} text_file_t;
+
+static const text_file_t text_files[] = {
+    {	/* Touchstone 1 with noise data */
+	"s2p",
+	"# GHz S MA R 50\n"
+	"1.0 0.9 -10 0.1 80 0.1 80 0.9 -10\n"
+	"2.0 0.8 -20 0.1 70 0.1 70 0.8 -20\n"
+	"3.0 0.7 -30 0.1 60 0.1 60 0.7 -30\n"
+	"! noise parameters\n"
+	"1.0 1.5 0.5 30 0.3\n"
+	"2.0 1.6 0.5 30 0.3\n"
+    },
+    {	/* Touchstone 2 with noise data and wrapped records */
+	"ts",
+	"[Version] 2.0\n"
+	"# MHz Y RI R 50\n"
+	"[Number of Ports] 2\n"
+	"[Two-Port Order] 12_21\n"
+	"[Number of Frequencies] 3\n"
+	"[Number of Noise Frequencies] 1\n"
+	"[Network Data]\n"
+	"10 1 2 3 4 5 6 7 8\n"
+	"20 1 2 3 4 5 6 7 8 ! comment\n"
+	"30 1 2\n"
+	"3 4 5 6\n"
+	"7 8\n"
+	"[Noise Data]\n"
+	"10 1.5 0.5 30 0.3\n"
+	"[End]\n"
+    },
+    {	/* Touchstone 2 lower-triangular with awkward comments */
+	"ts",
+	"[Version] 2.0\n"
+	"# kHz Z MA R 75\n"
+	"[Number of Ports] 3\n"
+	"[Number of Frequencies] 4\n"
+	"[Reference] 50 75 100\n"
+	"[Matrix Format] Lower\n"
+	"[Network Data]\n"
+	"1.5 1 0\n"
+	"1 0 1 0\n"
+	"1 0 1 0 1 0\n"
+	"2.5!comment\n"
+	"1 0 1 0 1 0 1 0 1 0 1 0\n"
+	"3.5 1 0 1 0 1 0 1 0 1 0 1 0\n"
+	"4.5 1 0 1 0 1 0\n"
+	"1 0 1 0 1 0 ! last\n"
+	"[End]\n"
+	"! trailing comment\n"
+    },
+};
+#define N_TEXT_FILES	(sizeof(text_files) / sizeof(text_files[0]))
+
+/*
+ * check_probe: probe a file and compare with the loaded file
+ *   @filename: file to test
+ */
+static bool check_probe(const char *filename)
+{
+    vnadata_t *vdp_load = NULL;
+    vnadata_t *vdp_probe = NULL;
+    vnadata_probe_t probe;
+    int frequencies;
+    bool result = false;
+
+    if ((vdp_load = vnadata_alloc(error_fn, NULL)) == NULL ||
+	    (vdp_probe = vnadata_alloc(error_fn, NULL)) == NULL) {
+	libt_error("vnadata_alloc: %s\n", strerror(errno));
+    }
+    if (vnadata_load(vdp_load, filename) == -1) {
+	libt_fail("%s: vnadata_load failed\n", filename);
+	goto out;
+    }
+    if (vnadata_probe(vdp_probe, filename, &probe) == -1) {
+	libt_fail("%s: vnadata_probe failed\n", filename);
+	goto out;
+    }
+    frequencies = vnadata_get_frequencies(vdp_load);
+    if (opt_v >= 1) {
+	(void)printf("%s: %d x %d %s, %d frequencies %.17g .. %.17g\n",
+		filename, probe.vp_rows, probe.vp_columns,
+		vnadata_get_type_name(probe.vp_type),
+		probe.vp_frequencies, probe.vp_fmin, probe.vp_fmax);
+    }
+    if (probe.vp_filetype != vnadata_get_filetype(vdp_load) ||
+	    vnadata_get_filetype(vdp_probe) != probe.vp_filetype) {
+	libt_fail("%s: wrong file type\n", filename);
+	goto out;
+    }
+    if (probe.vp_type != vnadata_get_type(vdp_load) ||
+	    probe.vp_rows != vnadata_get_rows(vdp_load) ||
+	    probe.vp_columns != vnadata_get_columns(vdp_load) ||
+	    vnadata_get_type(vdp_probe) != probe.vp_type ||
+	    vnadata_get_rows(vdp_probe) != probe.vp_rows ||
+	    vnadata_get_columns(vdp_probe) != probe.vp_columns) {
+	libt_fail("%s: wrong type or dimensions\n", filename);
+	goto out;
+    }
+    if (vnadata_get_frequencies(vdp_probe) != 0) {
+	libt_fail("%s: probe left %d frequencies in vdp\n",
+		filename, vnadata_get_frequencies(vdp_probe));
+	goto out;
+    }
+    if (probe.vp_frequencies != frequencies) {
+	libt_fail("%s: expected %d frequencies; found %d\n",
+		filename, frequencies, probe.vp_frequencies);
+	goto out;
+    }
+    if (probe.vp_fmin != (frequencies == 0 ? 0.0 :
+		vnadata_get_fmin(vdp_load)) ||
+	    probe.vp_fmax != (frequencies == 0 ? 0.0 :
+		vnadata_get_fmax(vdp_load))) {
+	libt_fail("%s: expected range %.17g .. %.17g; found %.17g .. %.17g\n",
+		filename,
+		frequencies == 0 ? 0.0 : vnadata_get_fmin(vdp_load),
+		frequencies == 0 ? 0.0 : vnadata_get_fmax(vdp_load),
+		probe.vp_fmin, probe.vp_fmax);
+	goto out;
+    }
+    if (probe.vp_fz0 != vnadata_has_fz0(vdp_load)) {
+	libt_fail("%s: wrong z0 type\n", filename);
+	goto out;
+    }
+    if (!probe.vp_fz0) {
+	const double complex *z0_expected = vnadata_get_z0_vector(vdp_load);
+	const double complex *z0_actual = vnadata_get_z0_vector(vdp_probe);
+	const int ports = probe.vp_rows > probe.vp_columns ?
+	    probe.vp_rows : probe.vp_columns;
+
+	for (int port = 0; port < ports; ++port) {
+	    if (z0_actual[port] != z0_expected[port]) {
+		libt_fail("%s: port %d: expected z0 %f%+fj; found %f%+fj\n",
+			filename, port,
+			creal(z0_expected[port]), cimag(z0_expected[port]),
+			creal(z0_actual[port]), cimag(z0_actual[port]));
+		goto out;
+	    }
+	}
+    }
+    {
+	const char *format_expected = vnadata_get_format(vdp_load);
+	const char *format_actual = vnadata_get_format(vdp_probe);
+
+	if (format_expected == NULL) {
+	    format_expected = "(none)";
+	}
+	if (format_actual == NULL) {
+	    format_actual = "(none)";
+	}
+	if (strcmp(format_actual, format_expected) != 0) {
+	    libt_fail("%s: expected format %s; found %s\n", filename,
+		    format_expected, format_actual);
+	    goto out;
+	}
+    }
+    result = true;
+
+out:
+    vnadata_free(vdp_probe);
+    vnadata_free(vdp_load);
+    return result;
+}
+
+/*
+ * test_vnadata_probe: test vnadata_probe
+ */
+static libt_result_t test_vnadata_probe()
+{
+    libt_result_t result = T_FAIL;
+
+    for (int trial = 0; trial < N_TRIALS; ++trial) {
+	const trial_t *tp = &trials[trial];
+	char filename[64];
+	vnadata_t *vdp;
+
+	(void)sprintf(filename, "%s-%d.%s", BASENAME, trial, tp->t_suffix);
+	vdp = libt_vnadata_make(error_fn, VNADATA_LAYOUT_FREQUENCY_MAJOR,
+		tp->t_type, tp->t_ports, tp->t_frequencies,
+		tp->t_fz0 ? Z0_PER_F : Z0_SINGLE);
+	if (vnadata_set_format(vdp, tp->t_format) == -1) {
+	    libt_error("vnadata_set_format: %s\n", strerror(errno));
+	}
+	if (vnadata_save(vdp, filename) == -1) {
+	    libt_fail("%s: vnadata_save failed\n", filename);
+	    vnadata_free(vdp);
+	    goto out;
+	}
+	vnadata_free(vdp);
+	if (tp->t_trailer != NULL) {
+	    FILE *fp;
+
+	    if ((fp = fopen(filename, "a")) == NULL) {
+		libt_error("fopen: %s: %s\n", filename, strerror(errno));
+	    }
+	    (void)fputs(tp->t_trailer, fp);
+	    (void)fclose(fp);
+	}
+	if (!check_probe(filename)) {
+	    goto out;
+	}
+    }
+    for (int i = 0; i < N_TEXT_FILES; ++i) {
+	const text_file_t *tfp = &text_files[i];
+	char filename[64];
+	FILE *fp;
+
+	(void)sprintf(filename, "%s-text%d.%s", BASENAME, i, tfp->tf_suffix);
+	if ((fp = fopen(filename, "w")) == NULL) {
+	    libt_error("fopen: %s: %s\n", filename, strerror(errno));
+	}
+	(void)fputs(tfp->tf_text, fp);
+	(void)fclose(fp);
+	if (!check_probe(filename)) {
+	    goto out;
+	}
+    }
+    result = T_PASS;
+
+out:
+    libt_report(result);
+    return result;
+}
+
+/*
+ * print_usage: print a usage message and exit
+ */
+static void print_usage()
+{
+    const char *const *cpp;
+
+    for (cpp = usage; *cpp != NULL; ++cpp) {
+	(void)fprintf(stderr, "%s: usage %s\n", progname, *cpp);
+    }
+    for (cpp = help; *cpp != NULL; ++cpp) {
+	(void)fprintf(stderr, "%s\n", *cpp);
+    }
+    exit(2);
+}
+
+/*
+ * main: test program
+ */
+int
+main(int argc, char **argv)
+{
+    if ((char *)NULL == (progname = strrchr(argv[0], '/'))) {
+	progname = argv[0];
+    } else {
+	++progname;
+    }
+    for (;;) {
+	switch (getopt(argc, argv, options)) {
+	case 'a':
+	    opt_a = true;
+	    continue;
+
+	case 'v':
+	    ++opt_v;
+	    continue;
+
+	case -1:
+	    break;
+
+	default:
+	    print_usage();
+	}
+	break;
+    }
+    argc -= optind;
+    argv += optind;
+    if (argc != 0) {
+	print_usage();
+    }
+    exit(test_vnadata_probe());
+}
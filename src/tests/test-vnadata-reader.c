@@ -0,0 +1,408 @@
+/*
+ * Vector Network Analyzer Library
+ * Copyright © 2020-2023 D Scott Guthridge <scott_guthridge@rompromity.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "archdep.h"
+
+#include <complex.h>
+#include <errno.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include "vnadata.h"
+#include "libt.h"
+#include "libt_vnadata.h"
+
+
+#define FREQUENCIES	17
+#define TEXT_FILE	"test-vnadata-reader.ts"
+
+/*
+ * Options
+ */
+char *progname;
+static const char options[] = "av";
+static const char *const usage[] = {
+    "[-av]",
+    NULL
+};
+static const char *const help[] = {
+    "-a	 abort on data miscompare",
+    "-v	 show verbose output",
+    NULL
+};
+bool opt_a = false;
+int opt_v = 0;
+
+/*
+ * expect_errors: if true, don't report errors
+ */
+static bool expect_errors = false;
+
+/*
+ * error_fn: error reporting function
+ *   @message: error message
+ *   @arg: (unused)
+ *   @category: error category (unused)
+ */
+static void error_fn(const char *message, void *arg, vnaerr_category_t category)
+{
+    if (!expect_errors || opt_v >= 1) {
+	(void)printf("error: %s: %s\n", progname, message);
+    }
+}
+
+/*
+ * trial_t: file to write and stream back
+ */
+typedef struct trial {
+    const char *t_filename;
+    int t_ports;
+    const char *t_format;
+    bool t_fz0;
+    int t_frequencies;		/* expected from the header */
+} trial_t;
+
+static const trial_t trials[] = {
+    { "test-vnadata-reader.s1p", 1, "Sri",	false, -1 },
+    { "test-vnadata-reader.s2p", 2, "Sma",	false, -1 },
+    { "test-vnadata-reader.s3p", 3, "Zri",	false, -1 },
+    { "test-vnadata-reader.s4p", 4, "SdB",	false, -1 },
+    { "test-vnadata-reader.ts",  2, "Yri",	false, FREQUENCIES },
+    { "test-vnadata-reader.ts",  3, "Sma",	false, FREQUENCIES },
+    { "test-vnadata-reader.npd", 3, "Sri,Zma",	false, FREQUENCIES },
+    { "test-vnadata-reader.npd", 2, "Zinri,Sri", true, FREQUENCIES },
+};
+#define N_TRIALS	(sizeof(trials) / sizeof(trials[0]))
+
+/*
+ * run_trial: save a file, then check that streaming it gives the
+ *	same values as loading it
+ *   @tp: trial to run
+ */
+static libt_result_t run_trial(const trial_t *tp)
+{
+    vnadata_t *original = NULL;
+    vnadata_t *loaded = NULL;
+    vnadata_t *record = NULL;
+    vnadata_reader_t *vrp = NULL;
+    int rows, columns;
+    int findex = 0;
+    libt_result_t result = T_FAIL;
+
+    if (opt_v >= 1) {
+	(void)printf("Test reader: %s %d ports %s%s\n",
+		tp->t_filename, tp->t_ports, tp->t_format,
+		tp->t_fz0 ? " fz0" : "");
+	(void)fflush(stdout);
+    }
+    original = libt_vnadata_make(error_fn, VNADATA_LAYOUT_FREQUENCY_MAJOR,
+	    VPT_S, tp->t_ports, FREQUENCIES, tp->t_fz0 ? Z0_PER_F : Z0_SINGLE);
+    if (vnadata_set_format(original, tp->t_format) == -1 ||
+	    vnadata_save(original, tp->t_filename) == -1) {
+	libt_fail("vnadata_save: returned -1\n");
+	goto out;
+    }
+    if ((loaded = vnadata_alloc(error_fn, NULL)) == NULL ||
+	    (record = vnadata_alloc(error_fn, NULL)) == NULL) {
+	libt_error("vnadata_alloc: %s\n", strerror(errno));
+    }
+    if (vnadata_load(loaded, tp->t_filename) == -1) {
+	libt_fail("vnadata_load: returned -1\n");
+	goto out;
+    }
+    rows = vnadata_get_rows(loaded);
+    columns = vnadata_get_columns(loaded);
+
+    /*
+     * Check the header information.
+     */
+    if ((vrp = vnadata_reader_open(record, tp->t_filename)) == NULL) {
+	libt_fail("vnadata_reader_open: returned NULL\n");
+	goto out;
+    }
+    if (vnadata_reader_get_frequencies(vrp) != tp->t_frequencies) {
+	libt_fail("vnadata_reader_get_frequencies: expected %d; found %d\n",
+		tp->t_frequencies, vnadata_reader_get_frequencies(vrp));
+	goto out;
+    }
+    if (vnadata_get_type(record) != vnadata_get_type(loaded) ||
+	    vnadata_get_rows(record) != rows ||
+	    vnadata_get_columns(record) != columns ||
+	    vnadata_get_frequencies(record) != 0 ||
+	    vnadata_get_filetype(record) != vnadata_get_filetype(loaded)) {
+	libt_fail("vnadata_reader_open: wrong type, dimensions or "
+		"filetype\n");
+	goto out;
+    }
+    if (strcmp(vnadata_get_format(record), vnadata_get_format(loaded)) != 0) {
+	libt_fail("vnadata_reader_open: expected format %s; found %s\n",
+		vnadata_get_format(loaded), vnadata_get_format(record));
+	goto out;
+    }
+    if (!tp->t_fz0) {
+	for (int port = 0; port < columns; ++port) {
+	    if (vnadata_get_z0(record, port) != vnadata_get_z0(loaded, port)) {
+		libt_fail("vnadata_reader_open: wrong z0 for port %d\n",
+			port);
+		goto out;
+	    }
+	}
+    }
+
+    /*
+     * Each record must match the corresponding frequency of the
+     * loaded data exactly.
+     */
+    for (;;) {
+	int rv;
+
+	if ((rv = vnadata_reader_next(vrp)) == -1) {
+	    libt_fail("vnadata_reader_next: returned -1\n");
+	    goto out;
+	}
+	if (rv == 0) {
+	    break;
+	}
+	if (findex >= FREQUENCIES) {
+	    libt_fail("vnadata_reader_next: too many records\n");
+	    goto out;
+	}
+	if (vnadata_get_frequencies(record) != 1 ||
+		vnadata_get_frequency(record, 0) !=
+		vnadata_get_frequency(loaded, findex)) {
+	    libt_fail("vnadata_reader_next: wrong frequency at %d\n", findex);
+	    goto out;
+	}
+	for (int row = 0; row < rows; ++row) {
+	    for (int column = 0; column < columns; ++column) {
+		if (vnadata_get_cell(record, 0, row, column) !=
+			vnadata_get_cell(loaded, findex, row, column)) {
+		    libt_fail("vnadata_reader_next: wrong value at findex %d "
+			    "row %d column %d\n", findex, row, column);
+		    goto out;
+		}
+	    }
+	}
+	if (vnadata_has_fz0(record) != tp->t_fz0) {
+	    libt_fail("vnadata_reader_next: wrong z0 type\n");
+	    goto out;
+	}
+	for (int port = 0; port < columns; ++port) {
+	    if (vnadata_get_fz0(record, 0, port) !=
+		    vnadata_get_fz0(loaded, findex, port)) {
+		libt_fail("vnadata_reader_next: wrong z0 at findex %d "
+			"port %d\n", findex, port);
+		goto out;
+	    }
+	}
+	++findex;
+    }
+    if (findex != FREQUENCIES) {
+	libt_fail("vnadata_reader_next: expected %d records; found %d\n",
+		FREQUENCIES, findex);
+	goto out;
+    }
+    if (vnadata_reader_next(vrp) != 0) {
+	libt_fail("vnadata_reader_next: expected 0 after end of file\n");
+	goto out;
+    }
+    result = T_PASS;
+
+out:
+    vnadata_reader_close(vrp);
+    vnadata_free(record);
+    vnadata_free(loaded);
+    vnadata_free(original);
+    return result;
+}
+
+/*
+ * write_file: write text to TEXT_FILE
+ *   @text: contents of the file
+ */
+static void write_file(const char *text)
+{
+    FILE *fp;
+
+    if ((fp = fopen(TEXT_FILE, "w")) == NULL) {
+	libt_error("fopen: %s: %s\n", TEXT_FILE, strerror(errno));
+    }
+    (void)fputs(text, fp);
+    if (fclose(fp) == -1) {
+	libt_error("fclose: %s: %s\n", TEXT_FILE, strerror(errno));
+    }
+}
+
+/*
+ * test_errors: test GHz frequencies and a damaged file
+ */
+static libt_result_t test_errors()
+{
+    vnadata_t *vdp = NULL;
+    vnadata_reader_t *vrp = NULL;
+    libt_result_t result = T_FAIL;
+
+    if ((vdp = vnadata_alloc(error_fn, NULL)) == NULL) {
+	libt_error("vnadata_alloc: %s\n", strerror(errno));
+    }
+
+    /*
+     * Frequencies must be compared after applying the multiplier.
+     */
+    write_file("[Version] 2.0\n"
+	    "# GHz S RI R 50\n"
+	    "[Number of Ports] 1\n"
+	    "[Number of Frequencies] 2\n"
+	    "[Network Data]\n"
+	    "1.0 0.5 0.1\n"
+	    "2.0 0.25 0.2\n"
+	    "[End]\n");
+    if ((vrp = vnadata_reader_open(vdp, TEXT_FILE)) == NULL) {
+	libt_fail("vnadata_reader_open: returned NULL\n");
+	goto out;
+    }
+    for (int findex = 0; findex < 2; ++findex) {
+	if (vnadata_reader_next(vrp) != 1) {
+	    libt_fail("vnadata_reader_next: expected a record\n");
+	    goto out;
+	}
+	if (vnadata_get_frequency(vdp, 0) != 1.0e+9 * (findex + 1)) {
+	    libt_fail("vnadata_reader_next: wrong frequency\n");
+	    goto out;
+	}
+    }
+    if (vnadata_reader_next(vrp) != 0) {
+	libt_fail("vnadata_reader_next: expected end of file\n");
+	goto out;
+    }
+    vnadata_reader_close(vrp);
+    vrp = NULL;
+
+    /*
+     * Records before a syntax error are returned; the error is
+     * reported when reached and is sticky.
+     */
+    write_file("[Version] 2.0\n"
+	    "# Hz S RI R 50\n"
+	    "[Number of Ports] 1\n"
+	    "[Number of Frequencies] 3\n"
+	    "[Network Data]\n"
+	    "1 0.5 0.1\n"
+	    "2 0.5 0.1\n"
+	    "3 0.5\n");
+    if ((vrp = vnadata_reader_open(vdp, TEXT_FILE)) == NULL) {
+	libt_fail("vnadata_reader_open: returned NULL\n");
+	goto out;
+    }
+    if (vnadata_reader_next(vrp) != 1 || vnadata_reader_next(vrp) != 1) {
+	libt_fail("vnadata_reader_next: expected a record\n");
+	goto out;
+    }
+    expect_errors = true;
+    if (vnadata_reader_next(vrp) != -1 || vnadata_reader_next(vrp) != -1) {
+	expect_errors = false;
+	libt_fail("vnadata_reader_next: expected failure\n");
+	goto out;
+    }
+    expect_errors = false;
+    result = T_PASS;
+
+out:
+    vnadata_reader_close(vrp);
+    vnadata_free(vdp);
+    return result;
+}
+
+/*
+ * test_vnadata_reader: test reading a file one frequency at a time
+ */
+static libt_result_t test_vnadata_reader()
+{
+    libt_result_t result = T_FAIL;
+
+    for (int i = 0; i < N_TRIALS; ++i) {
+	if ((result = run_trial(&trials[i])) != T_PASS) {
+	    goto out;
+	}
+    }
+    if ((result = test_errors()) != T_PASS) {
+	goto out;
+    }
+
+out:
+    libt_report(result);
+    return result;
+}
+
+/*
+ * print_usage: print a usage message and exit
+ */
+static void print_usage()
+{
+    const char *const *cpp;
+
+    for (cpp = usage; *cpp != NULL; ++cpp) {
+	(void)fprintf(stderr, "%s: usage %s\n", progname, *cpp);
+    }
+    for (cpp = help; *cpp != NULL; ++cpp) {
+	(void)fprintf(stderr, "%s\n", *cpp);
+    }
+    exit(2);
+}
+
+/*
+ * main: test program
+ */
+int
+main(int argc, char **argv)
+{
+    if ((char *)NULL == (progname = strrchr(argv[0], '/'))) {
+	progname = argv[0];
+    } else {
+	++progname;
+    }
+    for (;;) {
+	switch (getopt(argc, argv, options)) {
+	case 'a':
+	    opt_a = true;
+	    continue;
+
+	case 'v':
+	    ++opt_v;
+	    continue;
+
+	case -1:
+	    break;
+
+	default:
+	    print_usage();
+	}
+	break;
+    }
+    argc -= optind;
+    argv += optind;
+    if (argc != 0) {
+	print_usage();
+    }
+    exit(test_vnadata_reader());
+}
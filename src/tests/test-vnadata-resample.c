@@ -0,0 +1,547 @@
+/*
+ * Vector Network Analyzer Library
+ * Copyright © 2020-2023 D Scott Guthridge <scott_guthridge@rompromity.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "archdep.h"
+
+#include <assert.h>
+#include <complex.h>
+#include <errno.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include "vnadata.h"
+#include "libt.h"
+#include "libt_crand.h"
+
+
+#define N_TRIALS	20
+#define FMIN		1.0
+#define FMAX		100.0
+
+/*
+ * Options
+ */
+char *progname;
+static const char options[] = "av";
+static const char *const usage[] = {
+    "[-av]",
+    NULL
+};
+static const char *const help[] = {
+    "-a	 abort on data miscompare",
+    "-v	 show verbose output",
+    NULL
+};
+bool opt_a = false;
+int opt_v = 0;
+
+/*
+ * error_fn: error reporting function
+ *   @message: error message
+ *   @arg: (unused)
+ *   @category: error category (unused)
+ */
+static void error_fn(const char *message, void *arg, vnaerr_category_t category)
+{
+    (void)printf("error: %s: %s\n", progname, message);
+}
+
+/*
+ * rational_t: coefficients of (a + b f) / (1 + c f)
+ *
+ *   Rational function interpolation reproduces these exactly, so we
+ *   can compare resampled values against the functions directly.
+ */
+typedef struct rational {
+    double complex a, b, c;
+} rational_t;
+
+/*
+ * make_rational: fill in random coefficients
+ *   @rp: function to fill
+ */
+static void make_rational(rational_t *rp)
+{
+    rp->a = libt_crandn();
+    rp->b = libt_crandn();
+    rp->c = libt_crandn() / FMAX;
+}
+
+/*
+ * eval_rational: evaluate the function at f
+ *   @rp: function to evaluate
+ *   @f: frequency
+ */
+static double complex eval_rational(const rational_t *rp, double f)
+{
+    return (rp->a + rp->b * f) / (1.0 + rp->c * f);
+}
+
+/*
+ * make_frequencies: make a random increasing frequency vector
+ *   @vector: vector to fill
+ *   @frequencies: length of vector
+ *   @fmin: lowest frequency
+ *   @fmax: highest frequency
+ */
+static void make_frequencies(double *vector, int frequencies,
+	double fmin, double fmax)
+{
+    if (frequencies == 1) {
+	vector[0] = fmin;
+	return;
+    }
+    for (int i = 0; i < frequencies; ++i) {
+	vector[i] = fmin + (fmax - fmin) * i / (frequencies - 1);
+	if (i != 0 && i != frequencies - 1) {
+	    vector[i] += libt_randu(-0.25, 0.25) * (fmax - fmin) /
+		(frequencies - 1);
+	}
+    }
+}
+
+/*
+ * test_find_frequency: test vnadata_find_frequency
+ *   @vdp: vnadata structure with increasing frequencies
+ */
+static libt_result_t test_find_frequency(const vnadata_t *vdp)
+{
+    const int frequencies = vnadata_get_frequencies(vdp);
+    const double *frequency_vector = vnadata_get_frequency_vector(vdp);
+    int cursor = 0;
+
+    for (int i = 0; i < 4 * frequencies; ++i) {
+	double f;
+	int expected = 0;
+	int actual;
+
+	/*
+	 * Alternate between random lookups and an increasing sweep.
+	 * Include the stored frequencies themselves.
+	 */
+	if (i < frequencies) {
+	    f = frequency_vector[i];
+	} else if (i < 2 * frequencies) {
+	    f = libt_randu(frequency_vector[0],
+		    frequency_vector[frequencies - 1]);
+	} else {
+	    f = frequency_vector[0] + (frequency_vector[frequencies - 1] -
+		    frequency_vector[0]) * (i - 2 * frequencies) /
+		(2 * frequencies);
+	}
+	while (expected + 1 < frequencies &&
+		frequency_vector[expected + 1] <= f) {
+	    ++expected;
+	}
+	actual = vnadata_find_frequency(vdp, f, (i & 1) ? &cursor : NULL);
+	if (actual != expected) {
+	    libt_fail("vnadata_find_frequency: f %f: expected %d; found %d\n",
+		    f, expected, actual);
+	    return T_FAIL;
+	}
+	if ((i & 1) && cursor != expected) {
+	    libt_fail("vnadata_find_frequency: cursor not updated\n");
+	    return T_FAIL;
+	}
+    }
+    return T_PASS;
+}
+
+/*
+ * run_trial: run a single resample trial
+ *   @trial: trial number
+ *   @rows: number of rows
+ *   @columns: number of columns
+ *   @fz0: use frequency-dependent reference impedances
+ *   @in_layout: layout of the input structure
+ *   @out_layout: layout of the output structure
+ *   @in_place: resample vdp_in into itself
+ */
+static libt_result_t run_trial(int trial, int rows, int columns, bool fz0,
+	vnadata_layout_t in_layout, vnadata_layout_t out_layout,
+	bool in_place)
+{
+    const int ports = MAX(rows, columns);
+    const int cells = rows * columns;
+    const int old_frequencies = 5 + trial;
+    const int new_frequencies = 1 + 2 * trial;
+    double old_frequency_vector[old_frequencies];
+    double new_frequency_vector[new_frequencies];
+    rational_t data_function[cells];
+    rational_t z0_function[ports];
+    vnadata_t *vdp_in = NULL;
+    vnadata_t *vdp_out = NULL;
+    libt_result_t result = T_FAIL;
+
+    if (opt_v >= 1) {
+	(void)printf("Test resample: trial %2d size %d x %d %s %s -> %s%s\n",
+		trial, rows, columns, fz0 ? "fz0" : "z0",
+		in_layout == VNADATA_LAYOUT_CELL_MAJOR ? "cell" : "freq",
+		out_layout == VNADATA_LAYOUT_CELL_MAJOR ? "cell" : "freq",
+		in_place ? " in-place" : "");
+	(void)fflush(stdout);
+    }
+
+    /*
+     * Make the input data.
+     */
+    make_frequencies(old_frequency_vector, old_frequencies, FMIN, FMAX);
+    make_frequencies(new_frequency_vector, new_frequencies,
+	    FMIN * 0.999, FMAX * 1.001);
+    for (int cell = 0; cell < cells; ++cell) {
+	make_rational(&data_function[cell]);
+    }
+    for (int port = 0; port < ports; ++port) {
+	make_rational(&z0_function[port]);
+	z0_function[port].a += 50.0;
+    }
+    if ((vdp_in = vnadata_alloc(error_fn, NULL)) == NULL) {
+	libt_fail("vnadata_alloc: returned NULL\n");
+	goto out;
+    }
+    if (vnadata_set_layout(vdp_in, in_layout) == -1) {
+	libt_fail("vnadata_set_layout: returned -1\n");
+	goto out;
+    }
+    if (vnadata_init(vdp_in, VPT_S, rows, columns, old_frequencies) == -1) {
+	libt_fail("vnadata_init: returned -1\n");
+	goto out;
+    }
+    (void)vnadata_set_frequency_vector(vdp_in, old_frequency_vector);
+    for (int findex = 0; findex < old_frequencies; ++findex) {
+	const double f = old_frequency_vector[findex];
+
+	for (int cell = 0; cell < cells; ++cell) {
+	    (void)vnadata_set_cell(vdp_in, findex, cell / columns,
+		    cell % columns, eval_rational(&data_function[cell], f));
+	}
+	for (int port = 0; port < ports; ++port) {
+	    double complex z0;
+
+	    z0 = fz0 ? eval_rational(&z0_function[port], f) :
+		z0_function[port].a;
+	    (void)vnadata_set_fz0(vdp_in, findex, port, z0);
+	}
+    }
+    if (!fz0) {
+	double complex z0_vector[ports];
+
+	for (int port = 0; port < ports; ++port) {
+	    z0_vector[port] = z0_function[port].a;
+	}
+	(void)vnadata_set_z0_vector(vdp_in, z0_vector);
+    }
+    if ((result = test_find_frequency(vdp_in)) != T_PASS) {
+	goto out;
+    }
+
+    /*
+     * Resample.
+     */
+    if (in_place) {
+	vdp_out = vdp_in;
+	vdp_in = NULL;
+	if (vnadata_set_layout(vdp_out, out_layout) == -1) {
+	    libt_fail("vnadata_set_layout: returned -1\n");
+	    result = T_FAIL;
+	    goto out;
+	}
+	if (vnadata_resample(vdp_out, vdp_out, new_frequency_vector,
+		    new_frequencies) == -1) {
+	    libt_fail("vnadata_resample: returned -1\n");
+	    result = T_FAIL;
+	    goto out;
+	}
+    } else {
+	if ((vdp_out = vnadata_alloc(error_fn, NULL)) == NULL) {
+	    libt_fail("vnadata_alloc: returned NULL\n");
+	    result = T_FAIL;
+	    goto out;
+	}
+	if (vnadata_set_layout(vdp_out, out_layout) == -1) {
+	    libt_fail("vnadata_set_layout: returned -1\n");
+	    result = T_FAIL;
+	    goto out;
+	}
+	if (vnadata_resample(vdp_in, vdp_out, new_frequency_vector,
+		    new_frequencies) == -1) {
+	    libt_fail("vnadata_resample: returned -1\n");
+	    result = T_FAIL;
+	    goto out;
+	}
+    }
+
+    /*
+     * Check the result.
+     */
+    if (vnadata_get_frequencies(vdp_out) != new_frequencies ||
+	    vnadata_get_rows(vdp_out) != rows ||
+	    vnadata_get_columns(vdp_out) != columns ||
+	    vnadata_get_layout(vdp_out) != out_layout ||
+	    vnadata_has_fz0(vdp_out) != fz0) {
+	libt_fail("vnadata_resample: wrong output dimensions\n");
+	result = T_FAIL;
+	goto out;
+    }
+    for (int findex = 0; findex < new_frequencies; ++findex) {
+	const double f = new_frequency_vector[findex];
+
+	if (vnadata_get_frequency(vdp_out, findex) != f) {
+	    libt_fail("vnadata_resample: wrong frequency at %d\n", findex);
+	    result = T_FAIL;
+	    goto out;
+	}
+	for (int cell = 0; cell < cells; ++cell) {
+	    double complex value;
+
+	    value = vnadata_get_cell(vdp_out, findex, cell / columns,
+		    cell % columns);
+	    if (!libt_isequal_c_rpt("data", value,
+			eval_rational(&data_function[cell], f))) {
+		libt_fail(": findex %d cell %d\n", findex, cell);
+		result = T_FAIL;
+		goto out;
+	    }
+	}
+	for (int port = 0; port < ports; ++port) {
+	    double complex expected;
+
+	    expected = fz0 ? eval_rational(&z0_function[port], f) :
+		z0_function[port].a;
+	    if (!libt_isequal_c_rpt("z0", vnadata_get_fz0(vdp_out, findex,
+			    port), expected)) {
+		libt_fail(": findex %d port %d\n", findex, port);
+		result = T_FAIL;
+		goto out;
+	    }
+	}
+    }
+    result = T_PASS;
+
+out:
+    vnadata_free(vdp_out);
+    vnadata_free(vdp_in);
+    return result;
+}
+
+/*
+ * check_aliased: check a resample whose target grid aliased vdp_out
+ *   @vdp: result of the resample
+ *   @frequency_vector: expected frequencies
+ *   @frequencies: length of frequency_vector
+ *   @data_function: function giving each cell's value
+ */
+static libt_result_t check_aliased(const vnadata_t *vdp,
+	const double *frequency_vector, int frequencies,
+	const rational_t *data_function)
+{
+    if (vnadata_get_frequencies(vdp) != frequencies) {
+	libt_fail("vnadata_resample: wrong number of frequencies\n");
+	return T_FAIL;
+    }
+    for (int findex = 0; findex < frequencies; ++findex) {
+	const double f = frequency_vector[findex];
+
+	if (vnadata_get_frequency(vdp, findex) != f) {
+	    libt_fail("vnadata_resample: frequency %d: %f != %f\n",
+		    findex, vnadata_get_frequency(vdp, findex), f);
+	    return T_FAIL;
+	}
+	for (int cell = 0; cell < 4; ++cell) {
+	    if (!libt_isequal_c_rpt("data", vnadata_get_cell(vdp, findex,
+			    cell / 2, cell % 2),
+			eval_rational(&data_function[cell], f))) {
+		libt_fail(": findex %d cell %d\n", findex, cell);
+		return T_FAIL;
+	    }
+	}
+    }
+    return T_PASS;
+}
+
+/*
+ * test_aliased_frequencies: pass the frequency vector of vdp_out
+ *
+ *   Resample a structure onto its own frequency grid in place, then
+ *   resample into a second structure using that structure's own
+ *   frequency vector as the target grid.
+ */
+static libt_result_t test_aliased_frequencies()
+{
+    const int old_frequencies = 11;
+    const int new_frequencies = 7;
+    double old_frequency_vector[old_frequencies];
+    double new_frequency_vector[new_frequencies];
+    rational_t data_function[4];
+    vnadata_t *vdp_in = NULL;
+    vnadata_t *vdp_out = NULL;
+    libt_result_t result = T_FAIL;
+
+    if (opt_v >= 1) {
+	(void)printf("Test resample: aliased frequency vectors\n");
+	(void)fflush(stdout);
+    }
+    make_frequencies(old_frequency_vector, old_frequencies, FMIN, FMAX);
+    make_frequencies(new_frequency_vector, new_frequencies, FMIN, FMAX);
+    for (int cell = 0; cell < 4; ++cell) {
+	make_rational(&data_function[cell]);
+    }
+    if ((vdp_in = vnadata_alloc_and_init(error_fn, NULL, VPT_S, 2, 2,
+		    old_frequencies)) == NULL ||
+	    (vdp_out = vnadata_alloc_and_init(error_fn, NULL, VPT_S, 2, 2,
+		    new_frequencies)) == NULL) {
+	libt_fail("vnadata_alloc_and_init: returned NULL\n");
+	goto out;
+    }
+    (void)vnadata_set_frequency_vector(vdp_in, old_frequency_vector);
+    for (int findex = 0; findex < old_frequencies; ++findex) {
+	for (int cell = 0; cell < 4; ++cell) {
+	    (void)vnadata_set_cell(vdp_in, findex, cell / 2, cell % 2,
+		    eval_rational(&data_function[cell],
+			old_frequency_vector[findex]));
+	}
+    }
+
+    /*
+     * In place onto the structure's own frequency vector.
+     */
+    if (vnadata_resample(vdp_in, vdp_in,
+		vnadata_get_frequency_vector(vdp_in),
+		old_frequencies) == -1) {
+	libt_fail("vnadata_resample: returned -1\n");
+	goto out;
+    }
+    if ((result = check_aliased(vdp_in, old_frequency_vector,
+		    old_frequencies, data_function)) != T_PASS) {
+	goto out;
+    }
+
+    /*
+     * Into a different structure, onto the output's frequency vector.
+     */
+    (void)vnadata_set_frequency_vector(vdp_out, new_frequency_vector);
+    if (vnadata_resample(vdp_in, vdp_out,
+		vnadata_get_frequency_vector(vdp_out),
+		new_frequencies) == -1) {
+	libt_fail("vnadata_resample: returned -1\n");
+	result = T_FAIL;
+	goto out;
+    }
+    if ((result = check_aliased(vdp_out, new_frequency_vector,
+		    new_frequencies, data_function)) != T_PASS) {
+	goto out;
+    }
+
+out:
+    vnadata_free(vdp_out);
+    vnadata_free(vdp_in);
+    return result;
+}
+
+/*
+ * test_vnadata_resample: test vnadata_find_frequency and vnadata_resample
+ */
+static libt_result_t test_vnadata_resample()
+{
+    libt_result_t result = T_SKIPPED;
+
+    for (int trial = 0; trial < N_TRIALS; ++trial) {
+	for (int ports = 1; ports <= 3; ++ports) {
+	    for (int i = 0; i < 16; ++i) {
+		const bool fz0 = i & 1;
+		const vnadata_layout_t in_layout = (i & 2) ?
+		    VNADATA_LAYOUT_CELL_MAJOR : VNADATA_LAYOUT_FREQUENCY_MAJOR;
+		const vnadata_layout_t out_layout = (i & 4) ?
+		    VNADATA_LAYOUT_CELL_MAJOR : VNADATA_LAYOUT_FREQUENCY_MAJOR;
+		const bool in_place = i & 8;
+
+		result = run_trial(trial, ports, ports, fz0,
+			in_layout, out_layout, in_place);
+		if (result != T_PASS) {
+		    goto out;
+		}
+	    }
+	}
+    }
+    if ((result = test_aliased_frequencies()) != T_PASS) {
+	goto out;
+    }
+
+out:
+    libt_report(result);
+    return result;
+}
+
+/*
+ * print_usage: print a usage message and exit
+ */
+static void print_usage()
+{
+    const char *const *cpp;
+
+    for (cpp = usage; *cpp != NULL; ++cpp) {
+	(void)fprintf(stderr, "%s: usage %s\n", progname, *cpp);
+    }
+    for (cpp = help; *cpp != NULL; ++cpp) {
+	(void)fprintf(stderr, "%s\n", *cpp);
+    }
+    exit(2);
+}
+
+/*
+ * main: test program
+ */
+int
+main(int argc, char **argv)
+{
+    if ((char *)NULL == (progname = strrchr(argv[0], '/'))) {
+	progname = argv[0];
+    } else {
+	++progname;
+    }
+    for (;;) {
+	switch (getopt(argc, argv, options)) {
+	case 'a':
+	    opt_a = true;
+	    continue;
+
+	case 'v':
+	    ++opt_v;
+	    continue;
+
+	case -1:
+	    break;
+
+	default:
+	    print_usage();
+	}
+	break;
+    }
+    argc -= optind;
+    argv += optind;
+    if (argc != 0) {
+	print_usage();
+    }
+    libt_isequal_init();
+    exit(test_vnadata_resample());
+}
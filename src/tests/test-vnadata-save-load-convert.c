@@ -177,13 +177,21 @@ static int run_trial(int trial, vnadata_filetype_t filetype,
 
     /*
      * Allocate the vnadata_t structure, fill it from the test values
-     * and verify that they match.
+     * and verify that they match.  If bit 1 of trial is set, use
+     * cell-major layout.
      */
     if ((vdp = vnadata_alloc(error_fn, NULL)) == NULL) {
 	libt_fail("vnadata_alloc: returned NULL\n");
 	result = T_FAIL;
 	goto out;
     }
+    if ((trial & 2) != 0) {
+	if (vnadata_set_layout(vdp, VNADATA_LAYOUT_CELL_MAJOR) == -1) {
+	    libt_fail("vnadata_set_layout: returned -1\n");
+	    result = T_FAIL;
+	    goto out;
+	}
+    }
     if ((result = libt_vnadata_fill(tdp, vdp, FM_MATRIX)) != T_PASS) {
 	goto out;
     }
@@ -277,13 +285,21 @@ static int run_trial(int trial, vnadata_filetype_t filetype,
 
     /*
      * Create a new vnadata_t structure and load from the file.  If trial
-     * is doubly even, use load; otherwise use use fload.
+     * is doubly even, use load; otherwise use use fload.  If trial
+     * is odd, load into cell-major layout.
      */
     if ((vdp = vnadata_alloc(error_fn, NULL)) == NULL) {
 	libt_fail("vnadata_alloc: returned NULL\n");
 	result = T_FAIL;
 	goto out;
     }
+    if ((trial & 1) != 0) {
+	if (vnadata_set_layout(vdp, VNADATA_LAYOUT_CELL_MAJOR) == -1) {
+	    libt_fail("vnadata_set_layout: returned -1\n");
+	    result = T_FAIL;
+	    goto out;
+	}
+    }
     if ((trial & 2) == 0) {
 	if (vnadata_load(vdp, filename) == -1) {
 	    libt_fail("vnadata_load: returned -1\n");
@@ -419,10 +435,11 @@ static int run_trial(int trial, vnadata_filetype_t filetype,
      * Check the loaded data.
      */
     for (int findex = 0; findex < FREQUENCIES; ++findex) {
-	const double complex *actual = vnadata_get_matrix(vdp, findex);
+	double complex actual[load_rows * load_columns];
 	const double complex *z0_vector = vnadata_get_fz0_vector(vdp, findex);
 	double complex expected[load_rows][load_columns];
 
+	(void)vnadata_get_to_matrix(vdp, findex, actual);
 	(void)memset((void *)expected, 0, sizeof(expected));
 	libt_vnadata_convert(tdp->td_vector[findex], &expected[0][0],
 	    z0_vector, tdp->td_rows, tdp->td_columns, tdp->td_type, load_type);
@@ -0,0 +1,372 @@
+/*
+ * Vector Network Analyzer Library
+ * Copyright © 2020-2023 D Scott Guthridge <scott_guthridge@rompromity.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "archdep.h"
+
+#include <complex.h>
+#include <errno.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include "vnadata.h"
+#include "libt.h"
+
+
+#define FILENAME	"test-vnadata-touchstone.s1p"
+
+/*
+ * N_VALUES: number of data values to write
+ *   Enough that the file spans several of the loader's input blocks.
+ */
+#define N_VALUES	40000
+
+/*
+ * Options
+ */
+char *progname;
+static const char options[] = "av";
+static const char *const usage[] = {
+    "[-av]",
+    NULL
+};
+static const char *const help[] = {
+    "-a	 abort on data miscompare",
+    "-v	 show verbose output",
+    NULL
+};
+bool opt_a = false;
+int opt_v = 0;
+
+/*
+ * first_error: text of the first error message since last cleared
+ */
+static char first_error[1024];
+
+/*
+ * error_fn: error reporting function
+ *   @message: error message
+ *   @arg: (unused)
+ *   @category: error category (unused)
+ */
+static void error_fn(const char *message, void *arg, vnaerr_category_t category)
+{
+    if (first_error[0] == '\000') {
+	(void)strncpy(first_error, message, sizeof(first_error) - 1);
+	first_error[sizeof(first_error) - 1] = '\000';
+    }
+    if (opt_v >= 1) {
+	(void)printf("error: %s: %s\n", progname, message);
+    }
+}
+
+/*
+ * write_file: write text to FILENAME
+ *   @text: contents of the file
+ */
+static void write_file(const char *text)
+{
+    FILE *fp;
+
+    if ((fp = fopen(FILENAME, "w")) == NULL) {
+	libt_error("fopen: %s: %s\n", FILENAME, strerror(errno));
+    }
+    (void)fputs(text, fp);
+    if (fclose(fp) == -1) {
+	libt_error("fclose: %s: %s\n", FILENAME, strerror(errno));
+    }
+}
+
+/*
+ * format_value: format a random value in one of several styles
+ *   @buffer: buffer of at least 64 bytes to receive the text
+ *   @i: index selecting the style
+ */
+static void format_value(char *buffer, int i)
+{
+    double value = libt_randn() * pow(10.0, (int)libt_randu(-40.0, 40.0));
+
+    switch (i % 10) {
+    case 0:
+	(void)sprintf(buffer, "%.17g", value);
+	break;
+    case 1:
+	(void)sprintf(buffer, "%+.6e", value);
+	break;
+    case 2:
+	(void)sprintf(buffer, "%.3f", libt_randn() * 100.0);
+	break;
+    case 3:
+	(void)sprintf(buffer, "%.25e", value);	/* too many digits */
+	break;
+    case 4:
+	(void)sprintf(buffer, "%d", (int)libt_randu(-1.0e+6, 1.0e+6));
+	break;
+    case 5:
+	(void)sprintf(buffer, "%.9E", value);
+	break;
+    case 6:
+	(void)sprintf(buffer, "%.15g", libt_randn());
+	break;
+    case 7:
+	(void)sprintf(buffer, "%.17e", value * 1.0e+250);
+	break;
+    case 8:
+	(void)sprintf(buffer, ".%05de-%d", (int)libt_randu(0.0, 99999.0),
+		(int)libt_randu(0.0, 30.0));
+	break;
+    default:
+	(void)sprintf(buffer, "-0.%020d", 0);
+	break;
+    }
+}
+
+/*
+ * test_values: test that every number converts exactly as strtod does
+ */
+static libt_result_t test_values()
+{
+    static char value_text[N_VALUES][64];
+    size_t allocation = 128 * N_VALUES;
+    char *text, *cp;
+    vnadata_t *vdp = NULL;
+    libt_result_t result = T_FAIL;
+
+    if ((text = malloc(allocation)) == NULL) {
+	libt_error("malloc: %s\n", strerror(errno));
+    }
+    cp = text;
+    cp += sprintf(cp, "! comment\n# hz s ri r 50\n");
+    for (int i = 0; i < N_VALUES; ++i) {
+	format_value(value_text[i], i);
+    }
+    for (int i = 0; i < N_VALUES / 2; ++i) {
+	cp += sprintf(cp, "%d\t%s %s", i + 1,
+		value_text[2 * i], value_text[2 * i + 1]);
+	if (i % 97 == 0) {	/* comments cross block boundaries */
+	    cp += sprintf(cp, " ! %0*d", 40 + i % 200, i);
+	}
+	*cp++ = (i % 5 == 0) ? '\r' : ' ';
+	*cp++ = '\n';
+    }
+    *cp = '\000';
+    write_file(text);
+    free((void *)text);
+
+    if ((vdp = vnadata_alloc(error_fn, NULL)) == NULL) {
+	libt_fail("vnadata_alloc: returned NULL\n");
+	goto out;
+    }
+    first_error[0] = '\000';
+    if (vnadata_load(vdp, FILENAME) == -1) {
+	libt_fail("vnadata_load: %s\n", first_error);
+	goto out;
+    }
+    if (vnadata_get_frequencies(vdp) != N_VALUES / 2) {
+	libt_fail("vnadata_load: expected %d frequencies; found %d\n",
+		N_VALUES / 2, vnadata_get_frequencies(vdp));
+	goto out;
+    }
+    for (int i = 0; i < N_VALUES / 2; ++i) {
+	double complex value = vnadata_get_cell(vdp, i, 0, 0);
+	double expected[2];
+	double actual[2];
+
+	expected[0] = strtod(value_text[2 * i], NULL);
+	expected[1] = strtod(value_text[2 * i + 1], NULL);
+	actual[0] = creal(value);
+	actual[1] = cimag(value);
+	for (int j = 0; j < 2; ++j) {
+	    if (memcmp((void *)&actual[j], (void *)&expected[j],
+			sizeof(double)) != 0) {
+		libt_fail("value %s: expected %.17g; found %.17g\n",
+			value_text[2 * i + j], expected[j], actual[j]);
+		goto out;
+	    }
+	}
+	if (vnadata_get_frequency(vdp, i) != (double)(i + 1)) {
+	    libt_fail("frequency %d: found %.17g\n", i + 1,
+		    vnadata_get_frequency(vdp, i));
+	    goto out;
+	}
+    }
+    result = T_PASS;
+
+out:
+    vnadata_free(vdp);
+    return result;
+}
+
+/*
+ * error_case_t: a malformed file and the error it must produce
+ */
+typedef struct error_case {
+    const char *ec_text;
+    const char *ec_message;
+} error_case_t;
+
+static const error_case_t error_cases[] = {
+    {
+	"# GHz S MA R 50\n"
+	"1.0 0.5 30\n"
+	"2.0 0.5 3O\n",
+	FILENAME " (line 3) error: unexpected token 3O"
+    },
+    {
+	"! comment\n"
+	"! comment\n"
+	"# GHz S MA R 50\n"
+	"1.0 0.5 30 $\n",
+	FILENAME " (line 4) error: unexpected character '$'"
+    },
+    {
+	"[Version] 2.0\n"
+	"# GHz S MA R 50\n"
+	"[Number of Ports] 1\n"
+	"[Number of Frequencies] 1\n"
+	"[Network Dat\n",
+	FILENAME " (line 5) error: missing closing brace of keyword"
+    },
+    {
+	"[Version] 2.0\n"
+	"# GHz S MA R 50\n"
+	"[Bogus]\n",
+	FILENAME " (line 3) error: unknown keyword [BOGUS]"
+    },
+    {
+	"[Version] 2.0\n"
+	"# Hz S MA R 50\n"
+	"[Number of Ports] 1\n"
+	"[Number of Frequencies] 2\n"
+	"[Network Data]\n"
+	"2 0.5 30 ! comment\n"
+	"1 0.5 30\n",
+	FILENAME " (line 7) error: frequencies must be in increasing order"
+    },
+};
+#define N_ERROR_CASES	(sizeof(error_cases) / sizeof(error_cases[0]))
+
+/*
+ * test_errors: test that syntax errors report the right line
+ */
+static libt_result_t test_errors()
+{
+    vnadata_t *vdp = NULL;
+    libt_result_t result = T_FAIL;
+
+    if ((vdp = vnadata_alloc(error_fn, NULL)) == NULL) {
+	libt_fail("vnadata_alloc: returned NULL\n");
+	goto out;
+    }
+    for (int i = 0; i < N_ERROR_CASES; ++i) {
+	const error_case_t *ecp = &error_cases[i];
+
+	write_file(ecp->ec_text);
+	first_error[0] = '\000';
+	if (vnadata_load(vdp, FILENAME) != -1) {
+	    libt_fail("case %d: vnadata_load: expected failure\n", i);
+	    goto out;
+	}
+	if (strcmp(first_error, ecp->ec_message) != 0) {
+	    libt_fail("case %d: expected \"%s\"; found \"%s\"\n",
+		    i, ecp->ec_message, first_error);
+	    goto out;
+	}
+    }
+    result = T_PASS;
+
+out:
+    vnadata_free(vdp);
+    return result;
+}
+
+/*
+ * test_vnadata_touchstone: test the Touchstone scanner
+ */
+static libt_result_t test_vnadata_touchstone()
+{
+    libt_result_t result;
+
+    if ((result = test_values()) != T_PASS) {
+	goto out;
+    }
+    if ((result = test_errors()) != T_PASS) {
+	goto out;
+    }
+
+out:
+    libt_report(result);
+    return result;
+}
+
+/*
+ * print_usage: print a usage message and exit
+ */
+static void print_usage()
+{
+    const char *const *cpp;
+
+    for (cpp = usage; *cpp != NULL; ++cpp) {
+	(void)fprintf(stderr, "%s: usage %s\n", progname, *cpp);
+    }
+    for (cpp = help; *cpp != NULL; ++cpp) {
+	(void)fprintf(stderr, "%s\n", *cpp);
+    }
+    exit(2);
+}
+
+/*
+ * main: test program
+ */
+int
+main(int argc, char **argv)
+{
+    if ((char *)NULL == (progname = strrchr(argv[0], '/'))) {
+	progname = argv[0];
+    } else {
+	++progname;
+    }
+    for (;;) {
+	switch (getopt(argc, argv, options)) {
+	case 'a':
+	    opt_a = true;
+	    continue;
+
+	case 'v':
+	    ++opt_v;
+	    continue;
+
+	case -1:
+	    break;
+
+	default:
+	    print_usage();
+	}
+	break;
+    }
+    argc -= optind;
+    argv += optind;
+    if (argc != 0) {
+	print_usage();
+    }
+    exit(test_vnadata_touchstone());
+}
@@ -0,0 +1,517 @@
+/*
+ * Vector Network Analyzer Library
+ * Copyright © 2020-2023 D Scott Guthridge <scott_guthridge@rompromity.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "archdep.h"
+
+#include <assert.h>
+#include <complex.h>
+#include <errno.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include "vnadata.h"
+#include "libt.h"
+#include "libt_vnadata.h"
+
+
+#define N_TRIALS	10
+#define PORTS		4
+#define FREQUENCIES	20
+#define SAVE_FILE	"test-vnadata-view.npd"
+
+/*
+ * Options
+ */
+char *progname;
+static const char options[] = "av";
+static const char *const usage[] = {
+    "[-av]",
+    NULL
+};
+static const char *const help[] = {
+    "-a	 abort on data miscompare",
+    "-v	 show verbose output",
+    NULL
+};
+bool opt_a = false;
+int opt_v = 0;
+
+/*
+ * error_fn: error reporting function
+ *   @message: error message
+ *   @arg: (unused)
+ *   @category: error category (unused)
+ */
+static void error_fn(const char *message, void *arg, vnaerr_category_t category)
+{
+    (void)printf("error: %s: %s\n", progname, message);
+}
+
+/*
+ * check_view: verify that view matches the selected part of parent
+ *   @view: view to check
+ *   @parent: parent structure
+ *   @findex: first frequency of the view
+ *   @frequencies: number of frequencies in the view
+ *   @port_vector: selected ports
+ *   @ports: number of selected ports
+ */
+static libt_result_t check_view(const vnadata_t *view,
+	const vnadata_t *parent, int findex, int frequencies,
+	const int *port_vector, int ports)
+{
+    if (vnadata_get_frequencies(view) != frequencies ||
+	    vnadata_get_rows(view) != ports ||
+	    vnadata_get_columns(view) != ports ||
+	    vnadata_get_type(view) != vnadata_get_type(parent)) {
+	libt_fail("check_view: wrong dimensions\n");
+	return T_FAIL;
+    }
+    for (int i = 0; i < frequencies; ++i) {
+	if (vnadata_get_frequency(view, i) !=
+		vnadata_get_frequency(parent, findex + i)) {
+	    libt_fail("check_view: wrong frequency at %d\n", i);
+	    return T_FAIL;
+	}
+	for (int row = 0; row < ports; ++row) {
+	    for (int column = 0; column < ports; ++column) {
+		if (!libt_isequal_c_rpt("cell",
+			    vnadata_get_cell(view, i, row, column),
+			    vnadata_get_cell(parent, findex + i,
+				port_vector[row], port_vector[column]))) {
+		    libt_fail(": findex %d row %d column %d\n",
+			    i, row, column);
+		    return T_FAIL;
+		}
+	    }
+	}
+	for (int port = 0; port < ports; ++port) {
+	    if (!libt_isequal_c_rpt("z0", vnadata_get_fz0(view, i, port),
+			vnadata_get_fz0(parent, findex + i,
+			    port_vector[port]))) {
+		libt_fail(": findex %d port %d\n", i, port);
+		return T_FAIL;
+	    }
+	}
+    }
+    return T_PASS;
+}
+
+/*
+ * run_trial: run a single view trial
+ *   @trial: trial number
+ *   @layout: parent layout
+ *   @fz0: use frequency-dependent reference impedances
+ */
+static libt_result_t run_trial(int trial, vnadata_layout_t layout, bool fz0)
+{
+    vnadata_t *parent = NULL;
+    vnadata_t *copy = NULL;
+    vnadata_t *view = NULL;
+    vnadata_t *vdp1 = NULL;
+    vnadata_t *vdp2 = NULL;
+    int findex, frequencies, ports;
+    int port_vector[PORTS];
+    bool all_ports;
+    double complex saved;
+    libt_result_t result = T_FAIL;
+
+    /*
+     * Choose a random frequency range and port subset.
+     */
+    findex = random() % FREQUENCIES;
+    frequencies = 1 + random() % (FREQUENCIES - findex);
+    all_ports = (trial & 1) == 0;
+    if (all_ports) {
+	ports = PORTS;
+	for (int i = 0; i < PORTS; ++i) {
+	    port_vector[i] = i;
+	}
+    } else {
+	int permutation[PORTS];
+
+	for (int i = 0; i < PORTS; ++i) {
+	    permutation[i] = i;
+	}
+	for (int i = PORTS - 1; i > 0; --i) {
+	    int j = random() % (i + 1);
+	    int temp = permutation[i];
+
+	    permutation[i] = permutation[j];
+	    permutation[j] = temp;
+	}
+	ports = 1 + random() % PORTS;
+	(void)memcpy((void *)port_vector, (void *)permutation,
+		ports * sizeof(int));
+    }
+    if (opt_v >= 1) {
+	(void)printf("Test view: trial %2d %s %s findex %d frequencies %d "
+		"ports %d\n", trial,
+		layout == VNADATA_LAYOUT_CELL_MAJOR ? "cell" : "freq",
+		fz0 ? "fz0" : "z0", findex, frequencies, ports);
+	(void)fflush(stdout);
+    }
+
+    /*
+     * Make the parent and the view, and check that the view has
+     * the expected values.  A port subset of frequency-major data
+     * can't be shared and must be copied instead.
+     */
+    parent = libt_vnadata_make(error_fn, layout, VPT_S, PORTS, FREQUENCIES,
+	    fz0 ? Z0_PER_F : Z0_SINGLE);
+    if ((view = vnadata_alloc(error_fn, NULL)) == NULL) {
+	libt_error("vnadata_alloc: %s\n", strerror(errno));
+    }
+    if (vnadata_view(view, parent, findex, frequencies,
+		all_ports && (trial & 2) ? NULL : port_vector,
+		ports) == -1) {
+	libt_fail("vnadata_view: returned -1\n");
+	goto out;
+    }
+    if (vnadata_is_view(view) !=
+	    (all_ports || layout == VNADATA_LAYOUT_CELL_MAJOR)) {
+	libt_fail("vnadata_is_view: unexpected result\n");
+	goto out;
+    }
+    if ((result = check_view(view, parent, findex, frequencies,
+		    port_vector, ports)) != T_PASS) {
+	goto out;
+    }
+    result = T_FAIL;
+
+    /*
+     * Make an ordinary copy of the same data for comparison.
+     */
+    if ((copy = vnadata_alloc(error_fn, NULL)) == NULL) {
+	libt_error("vnadata_alloc: %s\n", strerror(errno));
+    }
+    if (vnadata_init(copy, VPT_S, ports, ports, frequencies) == -1) {
+	libt_fail("vnadata_init: returned -1\n");
+	goto out;
+    }
+    for (int i = 0; i < frequencies; ++i) {
+	(void)vnadata_set_frequency(copy, i,
+		vnadata_get_frequency(parent, findex + i));
+	for (int row = 0; row < ports; ++row) {
+	    for (int column = 0; column < ports; ++column) {
+		(void)vnadata_set_cell(copy, i, row, column,
+			vnadata_get_cell(parent, findex + i,
+			    port_vector[row], port_vector[column]));
+	    }
+	}
+	for (int port = 0; port < ports; ++port) {
+	    (void)vnadata_set_fz0(copy, i, port,
+		    vnadata_get_fz0(parent, findex + i, port_vector[port]));
+	}
+    }
+
+    /*
+     * Convert from the view and from the copy and compare.
+     */
+    if ((vdp1 = vnadata_alloc(error_fn, NULL)) == NULL ||
+	    (vdp2 = vnadata_alloc(error_fn, NULL)) == NULL) {
+	libt_error("vnadata_alloc: %s\n", strerror(errno));
+    }
+    if (vnadata_convert(view, vdp1, VPT_Z) == -1 ||
+	    vnadata_convert(copy, vdp2, VPT_Z) == -1) {
+	libt_fail("vnadata_convert: returned -1\n");
+	goto out;
+    }
+    for (int i = 0; i < frequencies; ++i) {
+	for (int cell = 0; cell < ports * ports; ++cell) {
+	    if (!libt_isequal_c_rpt("convert",
+			vnadata_get_cell(vdp1, i, cell / ports, cell % ports),
+			vnadata_get_cell(vdp2, i, cell / ports,
+			    cell % ports))) {
+		libt_fail(": findex %d cell %d\n", i, cell);
+		goto out;
+	    }
+	}
+    }
+
+    /*
+     * Save the view, load it back and compare.
+     */
+    if (vnadata_set_fprecision(view, VNADATA_MAX_PRECISION) == -1 ||
+	    vnadata_set_dprecision(view, VNADATA_MAX_PRECISION) == -1) {
+	libt_fail("vnadata_set_[fd]precision: returned -1\n");
+	goto out;
+    }
+    if (vnadata_save(view, SAVE_FILE) == -1) {
+	libt_fail("vnadata_save: returned -1\n");
+	goto out;
+    }
+    if (vnadata_load(vdp1, SAVE_FILE) == -1) {
+	libt_fail("vnadata_load: returned -1\n");
+	goto out;
+    }
+    if (vnadata_is_view(vdp1)) {
+	libt_fail("vnadata_load: result is a view\n");
+	goto out;
+    }
+    if ((result = check_view(vdp1, parent, findex, frequencies,
+		    port_vector, ports)) != T_PASS) {
+	goto out;
+    }
+    result = T_FAIL;
+
+    /*
+     * Write to the view.  Check that the view was given its own copy,
+     * that the parent didn't change and that the other values in the
+     * view were preserved.
+     */
+    saved = vnadata_get_cell(parent, findex, port_vector[0], port_vector[0]);
+    if (vnadata_set_cell(view, 0, 0, 0, 1.0 + 2.0 * I) == -1) {
+	libt_fail("vnadata_set_cell: returned -1\n");
+	goto out;
+    }
+    if (vnadata_is_view(view)) {
+	libt_fail("vnadata_set_cell: view not materialized\n");
+	goto out;
+    }
+    if (vnadata_get_cell(parent, findex, port_vector[0],
+		port_vector[0]) != saved) {
+	libt_fail("vnadata_set_cell: parent modified through view\n");
+	goto out;
+    }
+    if (vnadata_get_cell(view, 0, 0, 0) != 1.0 + 2.0 * I) {
+	libt_fail("vnadata_set_cell: value not stored\n");
+	goto out;
+    }
+    (void)vnadata_set_cell(view, 0, 0, 0, saved);
+    if ((result = check_view(view, parent, findex, frequencies,
+		    port_vector, ports)) != T_PASS) {
+	goto out;
+    }
+    result = T_FAIL;
+
+    /*
+     * Convert a fresh view in place and make sure the parent is
+     * unchanged.
+     */
+    if (vnadata_view(view, parent, findex, frequencies, port_vector,
+		ports) == -1) {
+	libt_fail("vnadata_view: returned -1\n");
+	goto out;
+    }
+    if (vnadata_convert(view, view, VPT_Z) == -1) {
+	libt_fail("vnadata_convert: returned -1\n");
+	goto out;
+    }
+    if (vnadata_get_type(parent) != VPT_S ||
+	    vnadata_get_cell(parent, findex, port_vector[0],
+		port_vector[0]) != saved) {
+	libt_fail("vnadata_convert: parent modified through view\n");
+	goto out;
+    }
+    result = T_PASS;
+
+out:
+    vnadata_free(vdp2);
+    vnadata_free(vdp1);
+    vnadata_free(copy);
+    vnadata_free(view);
+    vnadata_free(parent);
+    return result;
+}
+
+/*
+ * test_empty_range: check z0 of a port subset with no frequencies
+ */
+static libt_result_t test_empty_range()
+{
+    vnadata_t *parent = NULL;
+    vnadata_t *view = NULL;
+    const int port_vector[] = { 2, 0 };
+    libt_result_t result = T_FAIL;
+
+    if ((parent = vnadata_alloc(error_fn, NULL)) == NULL ||
+	    (view = vnadata_alloc(error_fn, NULL)) == NULL) {
+	libt_error("vnadata_alloc: %s\n", strerror(errno));
+    }
+    if (vnadata_set_layout(parent, VNADATA_LAYOUT_CELL_MAJOR) == -1 ||
+	    vnadata_init(parent, VPT_S, PORTS, PORTS, 0) == -1) {
+	libt_error("vnadata_init: %s\n", strerror(errno));
+    }
+    for (int port = 0; port < PORTS; ++port) {
+	(void)vnadata_set_z0(parent, port, 10.0 * (port + 1));
+    }
+    if (vnadata_view(view, parent, 0, 0, port_vector, 2) == -1) {
+	libt_fail("vnadata_view: returned -1\n");
+	goto out;
+    }
+    for (int port = 0; port < 2; ++port) {
+	if (vnadata_get_z0(view, port) !=
+		vnadata_get_z0(parent, port_vector[port])) {
+	    libt_fail("vnadata_view: z0 of port %d lost\n", port);
+	    goto out;
+	}
+    }
+    result = T_PASS;
+
+out:
+    vnadata_free(view);
+    vnadata_free(parent);
+    return result;
+}
+
+/*
+ * test_pointer_access: check that vnadata_get_matrix and
+ *	vnadata_get_vector give a view its own copy
+ *   @layout: storage layout
+ */
+static libt_result_t test_pointer_access(vnadata_layout_t layout)
+{
+    const char *function = layout == VNADATA_LAYOUT_FREQUENCY_MAJOR ?
+	"vnadata_get_matrix" : "vnadata_get_vector";
+    vnadata_t *parent = NULL;
+    vnadata_t *view = NULL;
+    double complex *data;
+    double complex saved;
+    libt_result_t result = T_FAIL;
+
+    parent = libt_vnadata_make(error_fn, layout, VPT_S, PORTS, FREQUENCIES,
+	    Z0_SINGLE);
+    if ((view = vnadata_alloc(error_fn, NULL)) == NULL) {
+	libt_error("vnadata_alloc: %s\n", strerror(errno));
+    }
+    if (vnadata_view(view, parent, 1, FREQUENCIES - 1, NULL, 0) == -1) {
+	libt_fail("vnadata_view: returned -1\n");
+	goto out;
+    }
+    saved = vnadata_get_cell(parent, 1, 0, 0);
+    if (layout == VNADATA_LAYOUT_FREQUENCY_MAJOR) {
+	data = vnadata_get_matrix(view, 0);
+    } else {
+	data = vnadata_get_vector(view, 0, 0);
+    }
+    if (data == NULL) {
+	libt_fail("%s: returned NULL\n", function);
+	goto out;
+    }
+    if (vnadata_is_view(view)) {
+	libt_fail("%s: view not materialized\n", function);
+	goto out;
+    }
+    if (data[0] != saved) {
+	libt_fail("%s: wrong value\n", function);
+	goto out;
+    }
+    data[0] = 1.0 + 2.0 * I;
+    if (vnadata_get_cell(parent, 1, 0, 0) != saved ||
+	    vnadata_get_cell(view, 0, 0, 0) != 1.0 + 2.0 * I) {
+	libt_fail("%s: parent modified through view\n", function);
+	goto out;
+    }
+    result = T_PASS;
+
+out:
+    vnadata_free(view);
+    vnadata_free(parent);
+    return result;
+}
+
+/*
+ * test_vnadata_view: test vnadata_view
+ */
+static libt_result_t test_vnadata_view()
+{
+    libt_result_t result = T_SKIPPED;
+
+    for (int trial = 0; trial < N_TRIALS; ++trial) {
+	for (int i = 0; i < 4; ++i) {
+	    const vnadata_layout_t layout = (i & 1) ?
+		VNADATA_LAYOUT_CELL_MAJOR : VNADATA_LAYOUT_FREQUENCY_MAJOR;
+	    const bool fz0 = (i & 2) != 0;
+
+	    if ((result = run_trial(trial, layout, fz0)) != T_PASS) {
+		goto out;
+	    }
+	}
+    }
+    if ((result = test_pointer_access(VNADATA_LAYOUT_FREQUENCY_MAJOR)) !=
+	    T_PASS ||
+	    (result = test_pointer_access(VNADATA_LAYOUT_CELL_MAJOR)) !=
+	    T_PASS) {
+	goto out;
+    }
+    result = test_empty_range();
+
+out:
+    libt_report(result);
+    return result;
+}
+
+/*
+ * print_usage: print a usage message and exit
+ */
+static void print_usage()
+{
+    const char *const *cpp;
+
+    for (cpp = usage; *cpp != NULL; ++cpp) {
+	(void)fprintf(stderr, "%s: usage %s\n", progname, *cpp);
+    }
+    for (cpp = help; *cpp != NULL; ++cpp) {
+	(void)fprintf(stderr, "%s\n", *cpp);
+    }
+    exit(2);
+}
+
+/*
+ * main: test program
+ */
+int
+main(int argc, char **argv)
+{
+    if ((char *)NULL == (progname = strrchr(argv[0], '/'))) {
+	progname = argv[0];
+    } else {
+	++progname;
+    }
+    for (;;) {
+	switch (getopt(argc, argv, options)) {
+	case 'a':
+	    opt_a = true;
+	    continue;
+
+	case 'v':
+	    ++opt_v;
+	    continue;
+
+	case -1:
+	    break;
+
+	default:
+	    print_usage();
+	}
+	break;
+    }
+    argc -= optind;
+    argv += optind;
+    if (argc != 0) {
+	print_usage();
+    }
+    libt_isequal_init();
+    exit(test_vnadata_view());
+}
@@ -0,0 +1,428 @@
+/*
+ * Vector Network Analyzer Library
+ * Copyright © 2020-2023 D Scott Guthridge <scott_guthridge@rompromity.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "archdep.h"
+
+#include <complex.h>
+#include <errno.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include "vnadata.h"
+#include "libt.h"
+#include "libt_vnadata.h"
+
+
+#define FREQUENCIES	17
+#define BASENAME	"test-vnadata-writer"
+
+/*
+ * Options
+ */
+char *progname;
+static const char options[] = "av";
+static const char *const usage[] = {
+    "[-av]",
+    NULL
+};
+static const char *const help[] = {
+    "-a	 abort on data miscompare",
+    "-v	 show verbose output",
+    NULL
+};
+bool opt_a = false;
+int opt_v = 0;
+
+/*
+ * first_error: text of the first error message since last cleared
+ */
+static char first_error[1024];
+
+/*
+ * expect_errors: if true, don't report errors
+ */
+static bool expect_errors = false;
+
+/*
+ * error_fn: error reporting function
+ *   @message: error message
+ *   @arg: (unused)
+ *   @category: error category (unused)
+ */
+static void error_fn(const char *message, void *arg, vnaerr_category_t category)
+{
+    if (first_error[0] == '\000') {
+	(void)strncpy(first_error, message, sizeof(first_error) - 1);
+	first_error[sizeof(first_error) - 1] = '\000';
+    }
+    if (!expect_errors || opt_v >= 1) {
+	(void)printf("error: %s: %s\n", progname, message);
+    }
+}
+
+/*
+ * trial_t: file to write one frequency at a time
+ */
+typedef struct trial {
+    const char *t_suffix;
+    int t_ports;
+    vnadata_parameter_type_t t_type;
+    const char *t_format;
+    libt_vnadata_z0_type_t t_z0_type;
+    int t_append;		/* number of frequencies to append */
+    bool t_partial;		/* file is complete after each flush */
+} trial_t;
+
+static const trial_t trials[] = {
+    { "s1p", 1, VPT_S, "ri", Z0_SINGLE, FREQUENCIES, true },
+    { "s2p", 2, VPT_Z, "Zma", Z0_SINGLE, FREQUENCIES, true },
+    { "s2p", 2, VPT_Y, "Sdb", Z0_SINGLE, FREQUENCIES, true },
+    { "s3p", 3, VPT_S, "db", Z0_SINGLE, FREQUENCIES, true },
+    { "ts", 2, VPT_Y, "Yri", Z0_REAL_VECTOR, FREQUENCIES, false },
+    { "ts", 3, VPT_S, "Sma", Z0_SINGLE, FREQUENCIES, false },
+    { "npd", 2, VPT_S, "Sri,Zma,il", Z0_COMPLEX_VECTOR, FREQUENCIES, true },
+    { "npd", 2, VPT_Z, "Zri,Sri,Zinri", Z0_PER_F, FREQUENCIES, true },
+    { "npdb", 3, VPT_S, "Sri", Z0_PER_F, FREQUENCIES - 5, true },
+    { "npdb", 2, VPT_Z, NULL, Z0_COMPLEX_VECTOR, FREQUENCIES, true },
+};
+#define N_TRIALS	(sizeof(trials) / sizeof(trials[0]))
+
+/*
+ * make_data: create randomly filled parameter data
+ *   @tp: trial giving the type, dimensions and reference impedances
+ */
+static vnadata_t *make_data(const trial_t *tp)
+{
+    vnadata_t *vdp;
+
+    vdp = libt_vnadata_make(error_fn, VNADATA_LAYOUT_FREQUENCY_MAJOR,
+	    tp->t_type, tp->t_ports, FREQUENCIES, tp->t_z0_type);
+    if (vnadata_set_format(vdp, tp->t_format) == -1) {
+	libt_error("vnadata_set_format: %s\n", strerror(errno));
+    }
+    return vdp;
+}
+
+/*
+ * run_trial: write a file one frequency at a time, then check that
+ *	it loads the same as the file written by vnadata_save
+ *   @tp: trial to run
+ */
+static libt_result_t run_trial(const trial_t *tp)
+{
+    char filename[64];
+    char reference[64];
+    vnadata_t *original = NULL;
+    vnadata_t *expected = NULL;
+    vnadata_t *actual = NULL;
+    vnadata_writer_t *vwp = NULL;
+    const bool binary = strcmp(tp->t_suffix, "npdb") == 0;
+    libt_result_t result = T_FAIL;
+
+    (void)sprintf(filename, "%s.%s", BASENAME, tp->t_suffix);
+    (void)sprintf(reference, "%s-ref.%s", BASENAME, tp->t_suffix);
+    if (opt_v >= 1) {
+	(void)printf("Test writer: %s %d ports %s %s z0 %s\n",
+		filename, tp->t_ports, vnadata_get_type_name(tp->t_type),
+		tp->t_format != NULL ? tp->t_format : "-",
+		libt_vnadata_z0_names[tp->t_z0_type]);
+	(void)fflush(stdout);
+    }
+    original = make_data(tp);
+    if ((expected = vnadata_alloc(error_fn, NULL)) == NULL ||
+	    (actual = vnadata_alloc(error_fn, NULL)) == NULL) {
+	libt_error("vnadata_alloc: %s\n", strerror(errno));
+    }
+
+    /*
+     * The binary format stores the data as they are.  For text
+     * formats, expect what vnadata_save writes.
+     */
+    if (binary) {
+	if (vnadata_convert(original, expected,
+		    vnadata_get_type(original)) == -1) {
+	    libt_fail("vnadata_convert: returned -1\n");
+	    goto out;
+	}
+    } else {
+	if (vnadata_save(original, reference) == -1) {
+	    libt_fail("vnadata_save: returned -1\n");
+	    goto out;
+	}
+	if (vnadata_load(expected, reference) == -1) {
+	    libt_fail("vnadata_load: %s: returned -1\n", reference);
+	    goto out;
+	}
+    }
+
+    /*
+     * Write the file from the template, flushing halfway through.
+     */
+    if ((vwp = vnadata_writer_open(original, filename)) == NULL) {
+	libt_fail("vnadata_writer_open: returned NULL\n");
+	goto out;
+    }
+    for (int findex = 0; findex < tp->t_append; ++findex) {
+	const double complex *z0_vector = NULL;
+
+	if (tp->t_z0_type == Z0_PER_F) {
+	    z0_vector = vnadata_get_fz0_vector(original, findex);
+	}
+	if (vnadata_writer_append(vwp, vnadata_get_frequency(original, findex),
+		    vnadata_get_matrix(original, findex), z0_vector) == -1) {
+	    libt_fail("vnadata_writer_append: returned -1\n");
+	    goto out;
+	}
+	if (findex == tp->t_append / 2) {
+	    if (vnadata_writer_flush(vwp) == -1) {
+		libt_fail("vnadata_writer_flush: returned -1\n");
+		goto out;
+	    }
+	    if (tp->t_partial) {
+		if (vnadata_load(actual, filename) == -1) {
+		    libt_fail("vnadata_load: %s: returned -1 after "
+			    "flush\n", filename);
+		    goto out;
+		}
+		if (libt_vnadata_compare("after flush", actual, expected,
+			    findex + 1) != T_PASS) {
+		    goto out;
+		}
+	    }
+	}
+    }
+    if (vnadata_writer_close(vwp) == -1) {
+	vwp = NULL;
+	libt_fail("vnadata_writer_close: returned -1\n");
+	goto out;
+    }
+    vwp = NULL;
+    if (vnadata_load(actual, filename) == -1) {
+	libt_fail("vnadata_load: %s: returned -1\n", filename);
+	goto out;
+    }
+    if (libt_vnadata_compare("after close", actual, expected,
+		tp->t_append) != T_PASS) {
+	goto out;
+    }
+    if (!binary && strcmp(vnadata_get_format(actual),
+		vnadata_get_format(expected)) != 0) {
+	libt_fail("expected format %s; found %s\n",
+		vnadata_get_format(expected), vnadata_get_format(actual));
+	goto out;
+    }
+    result = T_PASS;
+
+out:
+    if (vwp != NULL) {
+	(void)vnadata_writer_close(vwp);
+    }
+    vnadata_free(actual);
+    vnadata_free(expected);
+    vnadata_free(original);
+    return result;
+}
+
+/*
+ * expect_error: check that the last call failed with the given message
+ *   @function: function that was called
+ *   @rv: value returned
+ *   @message: expected error message
+ */
+static bool expect_error(const char *function, int rv, const char *message)
+{
+    if (rv != -1) {
+	libt_fail("%s: expected failure\n", function);
+	return false;
+    }
+    if (strcmp(first_error, message) != 0) {
+	libt_fail("%s: expected \"%s\"; found \"%s\"\n",
+		function, message, first_error);
+	return false;
+    }
+    first_error[0] = '\000';
+    return true;
+}
+
+/*
+ * test_errors: test misuse of the writer
+ */
+static libt_result_t test_errors()
+{
+    const trial_t trial = { "npdb", 2, VPT_S, NULL, Z0_SINGLE, 2, false };
+    vnadata_t *vdp = NULL;
+    vnadata_writer_t *vwp = NULL;
+    double complex z0_vector[2] = { 50.0, 50.0 };
+    libt_result_t result = T_FAIL;
+
+    vdp = make_data(&trial);
+    if (vnadata_resize(vdp, VPT_S, 2, 2, 2) == -1) {
+	libt_error("vnadata_resize: %s\n", strerror(errno));
+    }
+    expect_errors = true;
+    first_error[0] = '\000';
+
+    /*
+     * Frequencies must increase, z0_vector must match the template,
+     * and a binary file holds no more than the template's frequencies.
+     */
+    if ((vwp = vnadata_writer_open(vdp, BASENAME ".npdb")) == NULL) {
+	libt_fail("vnadata_writer_open: returned NULL\n");
+	goto out;
+    }
+    if (vnadata_writer_append(vwp, 2.0e+6,
+		vnadata_get_matrix(vdp, 0), NULL) == -1) {
+	libt_fail("vnadata_writer_append: returned -1\n");
+	goto out;
+    }
+    if (!expect_error("vnadata_writer_append",
+		vnadata_writer_append(vwp, 1.0e+6,
+		    vnadata_get_matrix(vdp, 0), NULL),
+		"vnadata_writer_append: " BASENAME ".npdb: error: "
+		"frequencies must be in increasing order")) {
+	goto out;
+    }
+    if (!expect_error("vnadata_writer_append",
+		vnadata_writer_append(vwp, 3.0e+6,
+		    vnadata_get_matrix(vdp, 0), z0_vector),
+		"vnadata_writer_append: error: z0_vector must be given if "
+		"and only if the template has per-frequency reference "
+		"impedances")) {
+	goto out;
+    }
+    if (vnadata_writer_append(vwp, 3.0e+6,
+		vnadata_get_matrix(vdp, 1), NULL) == -1) {
+	libt_fail("vnadata_writer_append: returned -1\n");
+	goto out;
+    }
+    if (!expect_error("vnadata_writer_append",
+		vnadata_writer_append(vwp, 4.0e+6,
+		    vnadata_get_matrix(vdp, 1), NULL),
+		"vnadata_writer_append: " BASENAME ".npdb: error: "
+		"more than the 2 reserved "
+		"frequencies")) {
+	goto out;
+    }
+    if (vnadata_writer_close(vwp) == -1) {
+	vwp = NULL;
+	libt_fail("vnadata_writer_close: returned -1\n");
+	goto out;
+    }
+    vwp = NULL;
+
+    /*
+     * The binary format needs the template to give the capacity.
+     */
+    if (vnadata_resize(vdp, VPT_S, 2, 2, 0) == -1) {
+	libt_error("vnadata_resize: %s\n", strerror(errno));
+    }
+    vwp = vnadata_writer_open(vdp, BASENAME ".npdb");
+    if (!expect_error("vnadata_writer_open", vwp == NULL ? -1 : 0,
+		"vnadata_writer_open: " BASENAME ".npdb: the template "
+		"must have as many frequencies as the file will hold")) {
+	goto out;
+    }
+    result = T_PASS;
+
+out:
+    expect_errors = false;
+    if (vwp != NULL) {
+	(void)vnadata_writer_close(vwp);
+    }
+    vnadata_free(vdp);
+    return result;
+}
+
+/*
+ * test_vnadata_writer: test writing a file one frequency at a time
+ */
+static libt_result_t test_vnadata_writer()
+{
+    libt_result_t result = T_FAIL;
+
+    for (int i = 0; i < N_TRIALS; ++i) {
+	if ((result = run_trial(&trials[i])) != T_PASS) {
+	    goto out;
+	}
+    }
+    if ((result = test_errors()) != T_PASS) {
+	goto out;
+    }
+
+out:
+    libt_report(result);
+    return result;
+}
+
+/*
+ * print_usage: print a usage message and exit
+ */
+static void print_usage()
+{
+    const char *const *cpp;
+
+    for (cpp = usage; *cpp != NULL; ++cpp) {
+	(void)fprintf(stderr, "%s: usage %s\n", progname, *cpp);
+    }
+    for (cpp = help; *cpp != NULL; ++cpp) {
+	(void)fprintf(stderr, "%s\n", *cpp);
+    }
+    exit(2);
+}
+
+/*
+ * main: test program
+ */
+int
+main(int argc, char **argv)
+{
+    if ((char *)NULL == (progname = strrchr(argv[0], '/'))) {
+	progname = argv[0];
+    } else {
+	++progname;
+    }
+    for (;;) {
+	switch (getopt(argc, argv, options)) {
+	case 'a':
+	    opt_a = true;
+	    continue;
+
+	case 'v':
+	    ++opt_v;
+	    continue;
+
+	case -1:
+	    break;
+
+	default:
+	    print_usage();
+	}
+	break;
+    }
+    argc -= optind;
+    argv += optind;
+    if (argc != 0) {
+	print_usage();
+    }
+    exit(test_vnadata_writer());
+}
@@ -0,0 +1,680 @@
+/*
+ * Vector Network Analyzer Library
+ * Copyright © 2020-2023 D Scott Guthridge <scott_guthridge@rompromity.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "archdep.h"
+
+#include <assert.h>
+#include <complex.h>
+#include <errno.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include "vnacal.h"
+#include "vnadata.h"
+#include "vnamem.h"
+#include "vnaproperty.h"
+#include "libt.h"
+#include "libt_crand.h"
+
+
+#define N_TRIALS	20
+#define N_ALLOCS	200
+
+/*
+ * Options
+ */
+char *progname;
+static const char options[] = "av";
+static const char *const usage[] = {
+    "[-av]",
+    NULL
+};
+static const char *const help[] = {
+    "-a	 abort on data miscompare",
+    "-v	 show verbose output",
+    NULL
+};
+bool opt_a = false;
+int opt_v = 0;
+
+/*
+ * error_fn: error reporting function
+ *   @message: error message
+ *   @arg: (unused)
+ *   @category: error category (unused)
+ */
+static void error_fn(const char *message, void *arg, vnaerr_category_t category)
+{
+    (void)printf("error: %s: %s\n", progname, message);
+}
+
+/*
+ * tracker_t: context for the tracking allocator
+ */
+typedef struct tracker {
+    long tr_outstanding;	/* allocations not yet freed */
+    long tr_calls;		/* total calls */
+} tracker_t;
+
+/*
+ * tracking_alloc, tracking_realloc, tracking_free: allocator that
+ *	counts outstanding allocations
+ */
+static void *tracking_alloc(void *context, size_t size)
+{
+    tracker_t *trp = context;
+    void *ptr;
+
+    ++trp->tr_calls;
+    if ((ptr = malloc(size)) != NULL) {
+	++trp->tr_outstanding;
+    }
+    return ptr;
+}
+
+static void *tracking_realloc(void *context, void *ptr, size_t size)
+{
+    tracker_t *trp = context;
+    void *new_ptr;
+
+    ++trp->tr_calls;
+    if ((new_ptr = realloc(ptr, size)) != NULL && ptr == NULL) {
+	++trp->tr_outstanding;
+    }
+    return new_ptr;
+}
+
+static void tracking_free(void *context, void *ptr)
+{
+    tracker_t *trp = context;
+
+    ++trp->tr_calls;
+    if (ptr != NULL) {
+	--trp->tr_outstanding;
+    }
+    free(ptr);
+}
+
+/*
+ * fill_data: create a 2x2 data set with known values
+ *   @vdp: data set
+ *   @frequencies: number of frequencies
+ */
+static int fill_data(vnadata_t *vdp, int frequencies)
+{
+    if (vnadata_init(vdp, VPT_S, 2, 2, frequencies) == -1) {
+	return -1;
+    }
+    for (int findex = 0; findex < frequencies; ++findex) {
+	if (vnadata_set_frequency(vdp, findex, 1.0e+6 * (findex + 1)) == -1) {
+	    return -1;
+	}
+	for (int cell = 0; cell < 4; ++cell) {
+	    if (vnadata_set_cell(vdp, findex, cell / 2, cell % 2,
+			findex + I * cell) == -1) {
+		return -1;
+	    }
+	}
+    }
+    if (vnadata_set_fz0(vdp, 0, 1, 75.0) == -1) {
+	return -1;
+    }
+    if (vnadata_set_format(vdp, "ri") == -1) {
+	return -1;
+    }
+    return 0;
+}
+
+/*
+ * check_data: check the values written by fill_data
+ *   @vdp: data set
+ *   @frequencies: number of frequencies
+ */
+static libt_result_t check_data(const vnadata_t *vdp, int frequencies)
+{
+    if (vnadata_get_frequencies(vdp) != frequencies) {
+	libt_fail("vnadata_get_frequencies: %d != %d\n",
+		vnadata_get_frequencies(vdp), frequencies);
+	return T_FAIL;
+    }
+    for (int findex = 0; findex < frequencies; ++findex) {
+	if (vnadata_get_frequency(vdp, findex) != 1.0e+6 * (findex + 1)) {
+	    libt_fail("frequency %d miscompare\n", findex);
+	    return T_FAIL;
+	}
+	for (int cell = 0; cell < 4; ++cell) {
+	    if (vnadata_get_cell(vdp, findex, cell / 2, cell % 2) !=
+		    findex + I * cell) {
+		libt_fail("cell %d at findex %d miscompare\n", cell, findex);
+		return T_FAIL;
+	    }
+	}
+    }
+    if (vnadata_get_fz0(vdp, 0, 1) != 75.0) {
+	libt_fail("fz0 miscompare\n");
+	return T_FAIL;
+    }
+    return T_PASS;
+}
+
+/*
+ * test_arena: exercise the arena allocator directly
+ */
+static libt_result_t test_arena()
+{
+    vnamem_arena_t *arena = NULL;
+    vnamem_allocator_t allocator;
+    unsigned char *vector[N_ALLOCS];
+    size_t size_vector[N_ALLOCS];
+    libt_result_t result = T_FAIL;
+
+    if ((arena = vnamem_arena_alloc(1024)) == NULL) {
+	libt_error("vnamem_arena_alloc: %s\n", strerror(errno));
+    }
+    vnamem_arena_get_allocator(arena, &allocator);
+    for (int trial = 0; trial < N_TRIALS; ++trial) {
+	/*
+	 * Make allocations of random sizes, some larger than the block
+	 * size, and grow every third one.  Check alignment and that
+	 * the contents survive.
+	 */
+	for (int i = 0; i < N_ALLOCS; ++i) {
+	    size_t size = (size_t)(libt_randu(0.0, 1.0) *
+		    (i % 17 == 0 ? 4096 : 100));
+
+	    vector[i] = (*allocator.vma_alloc)(allocator.vma_context, size);
+	    if (vector[i] == NULL) {
+		libt_error("arena alloc: %s\n", strerror(errno));
+	    }
+	    if ((uintptr_t)vector[i] % 16 != 0) {
+		libt_fail("trial %d: allocation %d misaligned\n", trial, i);
+		goto out;
+	    }
+	    (void)memset((void *)vector[i], i & 0xFF, size);
+	    if (i % 3 == 0) {
+		size_t new_size = 2 * size + 10;
+		unsigned char *cp;
+
+		cp = (*allocator.vma_realloc)(allocator.vma_context,
+			vector[i], new_size);
+		if (cp == NULL) {
+		    libt_error("arena realloc: %s\n", strerror(errno));
+		}
+		(void)memset((void *)&cp[size], i & 0xFF, new_size - size);
+		vector[i] = cp;
+		size = new_size;
+	    }
+	    size_vector[i] = size;
+	}
+	for (int i = 0; i < N_ALLOCS; ++i) {
+	    for (size_t j = 0; j < size_vector[i]; ++j) {
+		if (vector[i][j] != (i & 0xFF)) {
+		    libt_fail("trial %d: allocation %d byte %zu corrupted\n",
+			    trial, i, j);
+		    goto out;
+		}
+	    }
+	}
+
+	/*
+	 * Freeing the most recent allocation reclaims it.
+	 */
+	{
+	    size_t used = vnamem_arena_get_used(arena);
+	    void *ptr;
+
+	    ptr = (*allocator.vma_alloc)(allocator.vma_context, 40);
+	    if (vnamem_arena_get_used(arena) <= used) {
+		libt_fail("trial %d: arena usage didn't grow\n", trial);
+		goto out;
+	    }
+	    (*allocator.vma_free)(allocator.vma_context, ptr);
+	    if (vnamem_arena_get_used(arena) != used) {
+		libt_fail("trial %d: free of last allocation not reclaimed\n",
+			trial);
+		goto out;
+	    }
+	}
+	vnamem_arena_reset(arena);
+	if (vnamem_arena_get_used(arena) != 0) {
+	    libt_fail("trial %d: arena not empty after reset\n", trial);
+	    goto out;
+	}
+    }
+    result = T_PASS;
+
+out:
+    vnamem_arena_free(arena);
+    return result;
+}
+
+/*
+ * test_global: route library allocations through a global allocator
+ */
+static libt_result_t test_global()
+{
+    vnamem_allocator_t allocator;
+    tracker_t tracker;
+    vnamem_stats_t stats;
+    vnadata_t *vdp = NULL;
+    vnaproperty_t *root = NULL;
+    libt_result_t result = T_FAIL;
+
+    (void)memset((void *)&tracker, 0, sizeof(tracker));
+    allocator.vma_alloc   = tracking_alloc;
+    allocator.vma_realloc = tracking_realloc;
+    allocator.vma_free    = tracking_free;
+    allocator.vma_context = &tracker;
+    if (vnamem_set_allocator(&allocator) == -1) {
+	libt_error("vnamem_set_allocator: %s\n", strerror(errno));
+    }
+    vnamem_reset_stats();
+
+    /*
+     * Build and free a data set and a property tree.
+     */
+    if ((vdp = vnadata_alloc(error_fn, NULL)) == NULL) {
+	libt_error("vnadata_alloc: %s\n", strerror(errno));
+    }
+    if (fill_data(vdp, 50) == -1) {
+	libt_error("fill_data: %s\n", strerror(errno));
+    }
+    if ((result = check_data(vdp, 50)) != T_PASS) {
+	goto out;
+    }
+    result = T_FAIL;
+    if (vnaproperty_set(&root, "a.b[+]=%d", 1) == -1 ||
+	    vnaproperty_set(&root, "a.c=%s", "value") == -1) {
+	libt_error("vnaproperty_set: %s\n", strerror(errno));
+    }
+    vnadata_free(vdp);
+    vdp = NULL;
+    if (vnaproperty_delete(&root, ".") == -1) {
+	libt_error("vnaproperty_delete: %s\n", strerror(errno));
+    }
+    if (tracker.tr_calls == 0) {
+	libt_fail("allocator was not called\n");
+	goto out;
+    }
+    if (tracker.tr_outstanding != 0) {
+	libt_fail("%ld allocations leaked\n", tracker.tr_outstanding);
+	goto out;
+    }
+    vnamem_get_stats(&stats);
+    if (opt_v) {
+	(void)printf("allocs %lu reallocs %lu frees %lu bytes %zu\n",
+		stats.vms_allocs, stats.vms_reallocs, stats.vms_frees,
+		stats.vms_bytes);
+    }
+    if (stats.vms_allocs + stats.vms_reallocs + stats.vms_frees !=
+	    (unsigned long)tracker.tr_calls) {
+	libt_fail("statistics don't match allocator calls\n");
+	goto out;
+    }
+    if (stats.vms_failures != 0 || stats.vms_bytes == 0) {
+	libt_fail("unexpected statistics\n");
+	goto out;
+    }
+    vnamem_reset_stats();
+    vnamem_get_stats(&stats);
+    if (stats.vms_allocs != 0 || stats.vms_bytes != 0) {
+	libt_fail("vnamem_reset_stats didn't clear statistics\n");
+	goto out;
+    }
+    result = T_PASS;
+
+out:
+    vnadata_free(vdp);
+    (void)vnamem_set_allocator(NULL);
+    return result;
+}
+
+/*
+ * test_per_object: give a vnadata_t structure its own arena
+ */
+static libt_result_t test_per_object()
+{
+    vnamem_arena_t *arena = NULL;
+    vnamem_allocator_t allocator;
+    vnadata_t *vdp = NULL;
+    libt_result_t result = T_FAIL;
+
+    if ((arena = vnamem_arena_alloc(0)) == NULL) {
+	libt_error("vnamem_arena_alloc: %s\n", strerror(errno));
+    }
+    vnamem_arena_get_allocator(arena, &allocator);
+    for (int trial = 0; trial < N_TRIALS; ++trial) {
+	const int frequencies = 1 + trial * 10;
+
+	if ((vdp = vnadata_alloc(error_fn, NULL)) == NULL) {
+	    libt_error("vnadata_alloc: %s\n", strerror(errno));
+	}
+	if (trial & 1) {
+	    if (vnadata_set_layout(vdp, VNADATA_LAYOUT_CELL_MAJOR) == -1) {
+		libt_error("vnadata_set_layout: %s\n", strerror(errno));
+	    }
+	}
+	if (vnadata_set_allocator(vdp, &allocator) == -1) {
+	    libt_error("vnadata_set_allocator: %s\n", strerror(errno));
+	}
+	if (fill_data(vdp, frequencies) == -1) {
+	    libt_error("fill_data: %s\n", strerror(errno));
+	}
+	if (vnamem_arena_get_used(arena) == 0) {
+	    libt_fail("trial %d: storage didn't come from the arena\n", trial);
+	    goto out;
+	}
+	if ((result = check_data(vdp, frequencies)) != T_PASS) {
+	    goto out;
+	}
+	result = T_FAIL;
+
+	/*
+	 * Changing the allocator once storage exists must fail.
+	 */
+	if (vnadata_set_allocator(vdp, NULL) != -1) {
+	    libt_fail("trial %d: vnadata_set_allocator didn't fail\n", trial);
+	    goto out;
+	}
+	vnadata_free(vdp);
+	vdp = NULL;
+	vnamem_arena_reset(arena);
+    }
+
+    /*
+     * Install the arena globally, build a data set, and release it
+     * by resetting the arena instead of calling vnadata_free.
+     */
+    if (vnamem_set_allocator(&allocator) == -1) {
+	libt_error("vnamem_set_allocator: %s\n", strerror(errno));
+    }
+    if ((vdp = vnadata_alloc(error_fn, NULL)) == NULL) {
+	libt_error("vnadata_alloc: %s\n", strerror(errno));
+    }
+    if (fill_data(vdp, 100) == -1) {
+	libt_error("fill_data: %s\n", strerror(errno));
+    }
+    if ((result = check_data(vdp, 100)) != T_PASS) {
+	goto out;
+    }
+    result = T_FAIL;
+    (void)vnamem_set_allocator(NULL);
+    vdp = NULL;
+    vnamem_arena_reset(arena);
+    result = T_PASS;
+
+out:
+    vnadata_free(vdp);
+    (void)vnamem_set_allocator(NULL);
+    vnamem_arena_free(arena);
+    return result;
+}
+
+/*
+ * test_stored: free objects after the global allocator has changed
+ */
+static libt_result_t test_stored()
+{
+    vnamem_allocator_t allocator;
+    tracker_t tracker;
+    vnadata_t *vdp = NULL;
+    vnacal_t *vcp = NULL;
+    vnaproperty_t *root = NULL;
+    vnaproperty_path_t *path = NULL;
+    libt_result_t result = T_FAIL;
+
+    (void)memset((void *)&tracker, 0, sizeof(tracker));
+    allocator.vma_alloc   = tracking_alloc;
+    allocator.vma_realloc = tracking_realloc;
+    allocator.vma_free    = tracking_free;
+    allocator.vma_context = &tracker;
+    if (vnamem_set_allocator(&allocator) == -1) {
+	libt_error("vnamem_set_allocator: %s\n", strerror(errno));
+    }
+
+    /*
+     * Create a data set, a calibration structure with properties,
+     * a property tree and a compiled path under the tracking allocator.
+     */
+    if ((vdp = vnadata_alloc(error_fn, NULL)) == NULL) {
+	libt_error("vnadata_alloc: %s\n", strerror(errno));
+    }
+    if (fill_data(vdp, 20) == -1) {
+	libt_error("fill_data: %s\n", strerror(errno));
+    }
+    if ((vcp = vnacal_create(error_fn, NULL)) == NULL) {
+	libt_error("vnacal_create: %s\n", strerror(errno));
+    }
+    if (vnacal_property_set(vcp, -1, "a.b[+]=%d", 1) == -1) {
+	libt_error("vnacal_property_set: %s\n", strerror(errno));
+    }
+    if (vnaproperty_set(&root, "a.b[+]=%d", 1) == -1 ||
+	    vnaproperty_set(&root, "a.c=%s", "value") == -1) {
+	libt_error("vnaproperty_set: %s\n", strerror(errno));
+    }
+    if ((path = vnaproperty_path_compile("a.%s")) == NULL) {
+	libt_error("vnaproperty_path_compile: %s\n", strerror(errno));
+    }
+
+    /*
+     * Restore the default allocator, grow the objects, and free them.
+     * Everything must go back to the tracking allocator.
+     */
+    (void)vnamem_set_allocator(NULL);
+    if (vnaproperty_set(&root, "a.d[+]=%d", 2) == -1) {
+	libt_error("vnaproperty_set: %s\n", strerror(errno));
+    }
+    if (vnacal_property_set(vcp, -1, "a.b[+]=%d", 2) == -1) {
+	libt_error("vnacal_property_set: %s\n", strerror(errno));
+    }
+    vnaproperty_path_free(path);
+    path = NULL;
+    if (vnaproperty_delete(&root, ".") == -1) {
+	libt_error("vnaproperty_delete: %s\n", strerror(errno));
+    }
+    vnacal_free(vcp);
+    vcp = NULL;
+    vnadata_free(vdp);
+    vdp = NULL;
+    if (tracker.tr_calls == 0) {
+	libt_fail("allocator was not called\n");
+	goto out;
+    }
+    if (tracker.tr_outstanding != 0) {
+	libt_fail("%ld allocations not returned\n", tracker.tr_outstanding);
+	goto out;
+    }
+    result = T_PASS;
+
+out:
+    (void)vnamem_set_allocator(NULL);
+    vnaproperty_path_free(path);
+    (void)vnaproperty_delete(&root, ".");
+    vnacal_free(vcp);
+    vnadata_free(vdp);
+    return result;
+}
+
+/*
+ * test_per_calibration: give a vnacal_t structure its own allocator
+ */
+static libt_result_t test_per_calibration()
+{
+    static const char filename[] = "test-vnamem.vnacal";
+    vnamem_allocator_t allocator;
+    tracker_t tracker;
+    vnacal_t *vcp = NULL;
+    const char *value;
+    libt_result_t result = T_FAIL;
+
+    (void)memset((void *)&tracker, 0, sizeof(tracker));
+    allocator.vma_alloc   = tracking_alloc;
+    allocator.vma_realloc = tracking_realloc;
+    allocator.vma_free    = tracking_free;
+    allocator.vma_context = &tracker;
+
+    /*
+     * Create a calibration structure with properties and save it.
+     * The structure and its property tree must come from the tracking
+     * allocator while the global allocator stays the default.
+     */
+    if ((vcp = vnacal_create_with_allocator(error_fn, NULL,
+		    &allocator)) == NULL) {
+	libt_error("vnacal_create_with_allocator: %s\n", strerror(errno));
+    }
+    if (tracker.tr_outstanding == 0) {
+	libt_fail("vnacal_t didn't come from the allocator\n");
+	goto out;
+    }
+    tracker.tr_calls = 0;
+    if (vnacal_property_set(vcp, -1, "a.b=%d", 1) == -1) {
+	libt_error("vnacal_property_set: %s\n", strerror(errno));
+    }
+    if (tracker.tr_calls == 0) {
+	libt_fail("properties didn't come from the allocator\n");
+	goto out;
+    }
+    if (vnacal_save(vcp, filename) == -1) {
+	libt_error("vnacal_save: %s\n", strerror(errno));
+    }
+    vnacal_free(vcp);
+    vcp = NULL;
+    if (tracker.tr_outstanding != 0) {
+	libt_fail("%ld allocations not returned\n", tracker.tr_outstanding);
+	goto out;
+    }
+
+    /*
+     * Load it back both ways.
+     */
+    for (int lazy = 0; lazy < 2; ++lazy) {
+	vcp = lazy ?
+	    vnacal_load_lazy_with_allocator(filename, error_fn, NULL,
+		    &allocator) :
+	    vnacal_load_with_allocator(filename, error_fn, NULL, &allocator);
+	if (vcp == NULL) {
+	    libt_error("vnacal_load%s_with_allocator: %s\n",
+		    lazy ? "_lazy" : "", strerror(errno));
+	}
+	if ((value = vnacal_property_get(vcp, -1, "a.b")) == NULL ||
+		strcmp(value, "1") != 0) {
+	    libt_fail("property a.b lost\n");
+	    goto out;
+	}
+	vnacal_free(vcp);
+	vcp = NULL;
+	if (tracker.tr_outstanding != 0) {
+	    libt_fail("%ld allocations not returned\n",
+		    tracker.tr_outstanding);
+	    goto out;
+	}
+    }
+    result = T_PASS;
+
+out:
+    vnacal_free(vcp);
+    (void)remove(filename);
+    return result;
+}
+
+/*
+ * test_vnamem: run the tests
+ */
+static libt_result_t test_vnamem()
+{
+    libt_result_t result;
+
+    if ((result = test_arena()) != T_PASS) {
+	goto out;
+    }
+    if ((result = test_global()) != T_PASS) {
+	goto out;
+    }
+    if ((result = test_per_object()) != T_PASS) {
+	goto out;
+    }
+    if ((result = test_stored()) != T_PASS) {
+	goto out;
+    }
+    if ((result = test_per_calibration()) != T_PASS) {
+	goto out;
+    }
+
+out:
+    libt_report(result);
+    return result;
+}
+
+/*
+ * print_usage: print a usage message and exit
+ */
+static void print_usage()
+{
+    const char *const *cpp;
+
+    for (cpp = usage; *cpp != NULL; ++cpp) {
+	(void)fprintf(stderr, "%s: usage %s\n", progname, *cpp);
+    }
+    for (cpp = help; *cpp != NULL; ++cpp) {
+	(void)fprintf(stderr, "%s\n", *cpp);
+    }
+    exit(2);
+}
+
+/*
+ * main: test program
+ */
+int
+main(int argc, char **argv)
+{
+    if ((char *)NULL == (progname = strrchr(argv[0], '/'))) {
+	progname = argv[0];
+    } else {
+	++progname;
+    }
+    for (;;) {
+	switch (getopt(argc, argv, options)) {
+	case 'a':
+	    opt_a = true;
+	    continue;
+
+	case 'v':
+	    ++opt_v;
+	    continue;
+
+	case -1:
+	    break;
+
+	default:
+	    print_usage();
+	}
+	break;
+    }
+    argc -= optind;
+    argv += optind;
+    if (argc != 0) {
+	print_usage();
+    }
+    exit(test_vnamem());
+}
@@ -0,0 +1,358 @@
+/*
+ * Vector Network Analyzer Library
+ * Copyright © 2020-2023 D Scott Guthridge <scott_guthridge@rompromity.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "archdep.h"
+
+#include <assert.h>
+#include <complex.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include "vnaproperty.h"
+#include "libt.h"
+
+
+/*
+ * Options
+ */
+char *progname;
+static const char options[] = "v";
+static const char *const usage[] = {
+    "[-v]",
+    NULL
+};
+static const char *const help[] = {
+    "-v	 show verbose output",
+    NULL
+};
+bool opt_a = false;
+int opt_v = 0;
+
+/*
+ * yaml_text: document imported into both heap and arena trees
+ */
+static const char yaml_text[] =
+    "name: test\n"
+    "data:\n"
+    "  - { f: 1.0e+6, e: [ 1, 2, 3 ], z0: 50 }\n"
+    "  - { f: 2.0e+6, e: [ 4, 5, 6 ], z0: 50 }\n"
+    "  - { f: 3.0e+6, e: [ 7, ~, 9 ], z0: 75 }\n"
+    "properties: { my.key: value, empty: ~ }\n";
+
+/*
+ * export_to_string: export a tree as YAML into a buffer
+ *   @root: tree to export
+ *   @buffer: buffer to fill
+ *   @size: size of buffer
+ */
+static bool export_to_string(const vnaproperty_t *root, char *buffer,
+	size_t size)
+{
+    FILE *fp;
+    size_t length;
+
+    if ((fp = tmpfile()) == NULL) {
+	(void)printf("%s: tmpfile: %s\n", progname, strerror(errno));
+	return false;
+    }
+    if (vnaproperty_export_yaml_to_file(root, fp, "-", NULL, NULL) == -1) {
+	(void)printf("%s: vnaproperty_export_yaml_to_file: %s\n",
+		progname, strerror(errno));
+	(void)fclose(fp);
+	return false;
+    }
+    rewind(fp);
+    length = fread((void *)buffer, 1, size - 1, fp);
+    buffer[length] = '\000';
+    (void)fclose(fp);
+    return true;
+}
+
+/*
+ * test_vnaproperty_arena
+ */
+static libt_result_t test_vnaproperty_arena()
+{
+    vnaproperty_arena_t *arena = NULL;
+    vnaproperty_t *heap_root = NULL;
+    vnaproperty_t *heap_copy = NULL;
+    vnaproperty_t **rootptr;
+    vnaproperty_t **subtree;
+    const char **keys0 = NULL;
+    const char **keys1 = NULL;
+    const char *value;
+    static char expected[4096], actual[4096];
+    size_t used;
+    libt_result_t result = T_SKIPPED;
+
+    if ((arena = vnaproperty_arena_alloc(0)) == NULL) {
+	(void)printf("%s: vnaproperty_arena_alloc: %s\n",
+		progname, strerror(errno));
+	result = T_FAIL;
+	goto out;
+    }
+    rootptr = vnaproperty_arena_get_root(arena);
+
+    /*
+     * An empty arena tree reads as null.
+     */
+    errno = 0;
+    if (vnaproperty_type(*rootptr, ".") != -1 ||
+	    vnaproperty_get_subtree(*rootptr, ".") != NULL) {
+	(void)printf("%s: expected empty arena root\n", progname);
+	result = T_FAIL;
+	goto out;
+    }
+
+    /*
+     * Import the same document into heap and arena trees and check
+     * that they export identically.
+     */
+    if (vnaproperty_import_yaml_from_string(&heap_root, yaml_text,
+		NULL, NULL) == -1 ||
+	    vnaproperty_import_yaml_from_string(rootptr, yaml_text,
+		NULL, NULL) == -1) {
+	(void)printf("%s: vnaproperty_import_yaml_from_string: %s\n",
+		progname, strerror(errno));
+	result = T_FAIL;
+	goto out;
+    }
+    if (!export_to_string(heap_root, expected, sizeof(expected)) ||
+	    !export_to_string(*rootptr, actual, sizeof(actual))) {
+	result = T_FAIL;
+	goto out;
+    }
+    if (strcmp(expected, actual) != 0) {
+	(void)printf("%s: arena import differs:\n%s\n---\n%s\n",
+		progname, expected, actual);
+	result = T_FAIL;
+	goto out;
+    }
+    if ((used = vnaproperty_arena_get_used(arena)) == 0) {
+	(void)printf("%s: vnaproperty_arena_get_used: returned 0\n",
+		progname);
+	result = T_FAIL;
+	goto out;
+    }
+    if (opt_v) {
+	(void)printf("arena bytes used: %zu\n", used);
+    }
+
+    /*
+     * Keys repeated across maps must be stored once.
+     */
+    if ((keys0 = vnaproperty_keys(*rootptr, "data[0]{}")) == NULL ||
+	    (keys1 = vnaproperty_keys(*rootptr, "data[2]{}")) == NULL) {
+	(void)printf("%s: vnaproperty_keys: %s\n", progname, strerror(errno));
+	result = T_FAIL;
+	goto out;
+    }
+    for (int i = 0; i < 3; ++i) {
+	if (keys0[i] == NULL || keys0[i] != keys1[i]) {
+	    (void)printf("%s: key %d was not interned\n", progname, i);
+	    result = T_FAIL;
+	    goto out;
+	}
+    }
+
+    /*
+     * Modify the arena tree: set, replace, delete, and fill a null
+     * subtree returned from vnaproperty_set_subtree.
+     */
+    if (vnaproperty_set(rootptr, "data[1].f=2.5e+6") == -1 ||
+	    vnaproperty_set(rootptr, "data[0]=replaced") == -1 ||
+	    vnaproperty_delete(rootptr, "data[2].e[1]") == -1 ||
+	    vnaproperty_delete(rootptr, "properties.empty") == -1) {
+	(void)printf("%s: vnaproperty_set: %s\n", progname, strerror(errno));
+	result = T_FAIL;
+	goto out;
+    }
+    if ((subtree = vnaproperty_set_subtree(rootptr, "extra")) == NULL) {
+	(void)printf("%s: vnaproperty_set_subtree: %s\n",
+		progname, strerror(errno));
+	result = T_FAIL;
+	goto out;
+    }
+    if (vnaproperty_type(*subtree, ".") != -1) {
+	(void)printf("%s: expected null subtree\n", progname);
+	result = T_FAIL;
+	goto out;
+    }
+    if (vnaproperty_set(subtree, "a.b=c") == -1 ||
+	    vnaproperty_copy(&heap_copy, *rootptr) == -1) {
+	(void)printf("%s: vnaproperty_set: %s\n", progname, strerror(errno));
+	result = T_FAIL;
+	goto out;
+    }
+    if ((value = vnaproperty_get(heap_copy, "extra.a.b")) == NULL ||
+	    strcmp(value, "c") != 0 ||
+	    (value = vnaproperty_get(heap_copy, "data[0]")) == NULL ||
+	    strcmp(value, "replaced") != 0 ||
+	    (value = vnaproperty_get(heap_copy, "data[1].f")) == NULL ||
+	    strcmp(value, "2.5e+6") != 0 ||
+	    vnaproperty_count(heap_copy, "data[2].e[]") != 2 ||
+	    vnaproperty_count(heap_copy, "properties{}") != 1) {
+	(void)printf("%s: unexpected tree after modification\n", progname);
+	result = T_FAIL;
+	goto out;
+    }
+
+    /*
+     * Copy the heap tree back into the arena and compare.
+     */
+    if (vnaproperty_copy(rootptr, heap_root) == -1) {
+	(void)printf("%s: vnaproperty_copy: %s\n", progname, strerror(errno));
+	result = T_FAIL;
+	goto out;
+    }
+    if (!export_to_string(*rootptr, actual, sizeof(actual))) {
+	result = T_FAIL;
+	goto out;
+    }
+    if (strcmp(expected, actual) != 0) {
+	(void)printf("%s: arena copy differs:\n%s\n---\n%s\n",
+		progname, expected, actual);
+	result = T_FAIL;
+	goto out;
+    }
+
+    /*
+     * Replace the root with a scalar, then delete it; it stays in the
+     * arena.
+     */
+    if (vnaproperty_set(rootptr, ".=scalar") == -1 ||
+	    (value = vnaproperty_get(*rootptr, ".")) == NULL ||
+	    strcmp(value, "scalar") != 0 ||
+	    vnaproperty_delete(rootptr, ".") == -1 ||
+	    vnaproperty_type(*rootptr, ".") != -1 ||
+	    vnaproperty_set(rootptr, "x=y") == -1) {
+	(void)printf("%s: root replacement failed\n", progname);
+	result = T_FAIL;
+	goto out;
+    }
+    used = vnaproperty_arena_get_used(arena);
+    if (vnaproperty_copy(&heap_copy, *rootptr) == -1 ||
+	    vnaproperty_arena_get_used(arena) != used ||
+	    (value = vnaproperty_get(heap_copy, "x")) == NULL ||
+	    strcmp(value, "y") != 0) {
+	(void)printf("%s: copy of arena tree to heap failed\n", progname);
+	result = T_FAIL;
+	goto out;
+    }
+
+    /*
+     * Reading scalars, typed or not, must not change the tree, so
+     * that threads can read it concurrently.
+     */
+    {
+	double dvalue;
+	double complex cvalue;
+
+	if (vnaproperty_set_double(rootptr, 0.1, "d") == -1 ||
+		vnaproperty_set_complex(rootptr, 1.0 - 2.0 * I, "c") == -1 ||
+		vnaproperty_set(rootptr, "t=2.5") == -1) {
+	    (void)printf("%s: vnaproperty_set: %s\n",
+		    progname, strerror(errno));
+	    result = T_FAIL;
+	    goto out;
+	}
+	used = vnaproperty_arena_get_used(arena);
+	if ((value = vnaproperty_get(*rootptr, "d")) == NULL ||
+		strcmp(value, "0.1") != 0 ||
+		(value = vnaproperty_get(*rootptr, "c")) == NULL ||
+		strcmp(value, "1-2j") != 0 ||
+		vnaproperty_get_double(*rootptr, &dvalue, "t") == -1 ||
+		dvalue != 2.5 ||
+		vnaproperty_get_complex(*rootptr, &cvalue, "t") == -1 ||
+		cvalue != 2.5) {
+	    (void)printf("%s: unexpected scalar value\n", progname);
+	    result = T_FAIL;
+	    goto out;
+	}
+	if (vnaproperty_arena_get_used(arena) != used) {
+	    (void)printf("%s: reading scalars changed the arena\n",
+		    progname);
+	    result = T_FAIL;
+	    goto out;
+	}
+    }
+    result = T_PASS;
+
+out:
+    free((void *)keys0);
+    free((void *)keys1);
+    vnaproperty_delete(&heap_root, ".");
+    vnaproperty_delete(&heap_copy, ".");
+    vnaproperty_arena_free(arena);
+    libt_report(result);
+    return result;
+}
+
+/*
+ * print_usage: print a usage message and exit
+ */
+static void print_usage()
+{
+    const char *const *cpp;
+
+    for (cpp = usage; *cpp != NULL; ++cpp) {
+	(void)fprintf(stderr, "%s: usage %s\n", progname, *cpp);
+    }
+    for (cpp = help; *cpp != NULL; ++cpp) {
+	(void)fprintf(stderr, "%s\n", *cpp);
+    }
+    exit(2);
+}
+
+/*
+ * main: test program
+ */
+int
+main(int argc, char **argv)
+{
+    if ((char *)NULL == (progname = strrchr(argv[0], '/'))) {
+	progname = argv[0];
+    } else {
+	++progname;
+    }
+    for (;;) {
+	switch (getopt(argc, argv, options)) {
+	case 'v':
+	    ++opt_v;
+	    continue;
+
+	case -1:
+	    break;
+
+	default:
+	    print_usage();
+	}
+	break;
+    }
+    argc -= optind;
+    argv += optind;
+    if (argc != 0) {
+	print_usage();
+    }
+    exit(test_vnaproperty_arena());
+}
@@ -87,12 +87,18 @@ static const char *words[] = {
 };
 #define N_WORDS		(sizeof(words) / sizeof(char *))
 
+/*
+ * N_LARGE: number of keys in the large map test
+ */
+#define N_LARGE		5000
+
 /*
  * test_vnaproperty_map
  */
 static libt_result_t test_vnaproperty_map()
 {
     vnaproperty_t *root = NULL;
+    vnaproperty_t *large = NULL;
     int type = -1;
     int count, rv;
     const char **keys = NULL;
@@ -336,8 +342,87 @@ static libt_result_t test_vnaproperty_map()
 	goto out;
     }
     free((void *)keys);
+    keys = NULL;
+
+    /*
+     * Test a large map: growth of the hash table, deletion from the
+     * middle of probe sequences, and preservation of insertion order.
+     */
+    for (int i = 0; i < N_LARGE; ++i) {
+	if (vnaproperty_set(&large, "key%d=%d", i, i) == -1) {
+	    (void)printf("80[%d]: vnaproperty_set: %s\n", i, strerror(errno));
+	    result = T_FAIL;
+	    goto out;
+	}
+    }
+    for (int i = 0; i < N_LARGE; i += 3) {
+	if (vnaproperty_delete(&large, "key%d", i) == -1) {
+	    (void)printf("81[%d]: vnaproperty_delete: %s\n",
+		    i, strerror(errno));
+	    result = T_FAIL;
+	    goto out;
+	}
+    }
+    for (int i = 0; i < N_LARGE; ++i) {
+	const char *value;
+
+	errno = 0;
+	value = vnaproperty_get(large, "key%d", i);
+	if (i % 3 == 0) {
+	    if (value != NULL || errno != ENOENT) {
+		(void)printf("82[%d]: deleted key found\n", i);
+		result = T_FAIL;
+		goto out;
+	    }
+	    continue;
+	}
+	if (value == NULL || atoi(value) != i) {
+	    (void)printf("83[%d]: vnaproperty_get: %s\n", i,
+		    value != NULL ? value : strerror(errno));
+	    result = T_FAIL;
+	    goto out;
+	}
+    }
+    for (int i = 0; i < N_LARGE; i += 3) {
+	if (vnaproperty_set(&large, "key%d=%d", i, -i) == -1) {
+	    (void)printf("84[%d]: vnaproperty_set: %s\n", i, strerror(errno));
+	    result = T_FAIL;
+	    goto out;
+	}
+    }
+    if ((keys = vnaproperty_keys(large, "{}")) == NULL) {
+	(void)printf("85: vnaproperty_keys: %s\n", strerror(errno));
+	result = T_FAIL;
+	goto out;
+    }
+    count = 0;
+    for (int pass = 0; pass < 2; ++pass) {
+	for (int i = 0; i < N_LARGE; ++i) {
+	    char expected[20];
+
+	    if ((i % 3 == 0) != (pass == 1)) {
+		continue;
+	    }
+	    (void)sprintf(expected, "key%d", i);
+	    if (keys[count] == NULL || strcmp(keys[count], expected) != 0) {
+		(void)printf("86[%d]: key \"%s\" != \"%s\"\n", count,
+			keys[count] != NULL ? keys[count] : "(null)",
+			expected);
+		result = T_FAIL;
+		goto out;
+	    }
+	    ++count;
+	}
+    }
+    if (keys[count] != NULL) {
+	(void)printf("87: vnaproperty_keys returned extra keys\n");
+	result = T_FAIL;
+	goto out;
+    }
 
 out:
+    free((void *)keys);
+    (void)vnaproperty_delete(&large, ".");
     libt_report(result);;
     return result;
 }
@@ -0,0 +1,354 @@
+/*
+ * Vector Network Analyzer Library
+ * Copyright © 2020-2023 D Scott Guthridge <scott_guthridge@rompromity.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "archdep.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include "vnaproperty.h"
+#include "libt.h"
+
+
+/*
+ * Options
+ */
+char *progname;
+static const char options[] = "v";
+static const char *const usage[] = {
+    "[-v]",
+    NULL
+};
+static const char *const help[] = {
+    "-v	 show verbose output",
+    NULL
+};
+bool opt_a = false;
+int opt_v = 0;
+
+/*
+ * check_value: check a value using the uncompiled interface
+ *   @root: property tree
+ *   @expected: expected value
+ *   @format: format string forming the property expression
+ */
+static bool check_value(const vnaproperty_t *root, const char *expected,
+	const char *format, ...)
+{
+    va_list ap;
+    const char *value;
+
+    va_start(ap, format);
+    value = vnaproperty_vget(root, format, ap);
+    va_end(ap);
+    if (value == NULL) {
+	(void)printf("%s: vnaproperty_vget: %s\n", progname, strerror(errno));
+	return false;
+    }
+    if (strcmp(value, expected) != 0) {
+	(void)printf("%s: expected value \"%s\", found \"%s\"\n",
+		progname, expected, value);
+	return false;
+    }
+    return true;
+}
+
+/*
+ * test_vnaproperty_path
+ */
+static libt_result_t test_vnaproperty_path()
+{
+    static const char *const invalid_patterns[] = {
+	"%x", "a=b", "a#", "[%d", "{%s}", "%", NULL
+    };
+    static const char *const keys[] = { "f", "my.key[0]", "{x}" };
+    vnaproperty_t *root = NULL;
+    vnaproperty_path_t *element = NULL;
+    vnaproperty_path_t *list = NULL;
+    vnaproperty_path_t *map = NULL;
+    vnaproperty_path_t *key = NULL;
+    vnaproperty_t *subtree;
+    vnaproperty_t **subtreeptr;
+    const char **key_vector;
+    const char *value;
+    char buf[32];
+    int count;
+    libt_result_t result = T_SKIPPED;
+
+    /*
+     * Invalid patterns must be rejected with EINVAL.
+     */
+    for (const char *const *cpp = invalid_patterns; *cpp != NULL; ++cpp) {
+	vnaproperty_path_t *path;
+
+	errno = 0;
+	if ((path = vnaproperty_path_compile(*cpp)) != NULL) {
+	    (void)printf("%s: vnaproperty_path_compile: \"%s\" accepted\n",
+		    progname, *cpp);
+	    vnaproperty_path_free(path);
+	    result = T_FAIL;
+	    goto out;
+	}
+	if (errno != EINVAL) {
+	    (void)printf("%s: vnaproperty_path_compile: \"%s\": expected "
+		    "EINVAL, found %s\n", progname, *cpp, strerror(errno));
+	    result = T_FAIL;
+	    goto out;
+	}
+    }
+
+    /*
+     * Compile the expressions.
+     */
+    if ((element = vnaproperty_path_compile("data[%d].%s")) == NULL ||
+	    (list = vnaproperty_path_compile("data[]")) == NULL ||
+	    (map = vnaproperty_path_compile("data[%d]{}")) == NULL ||
+	    (key = vnaproperty_path_compile("%s")) == NULL) {
+	(void)printf("%s: vnaproperty_path_compile: %s\n",
+		progname, strerror(errno));
+	result = T_FAIL;
+	goto out;
+    }
+
+    /*
+     * Build a list of maps, including keys with reserved characters,
+     * and check the result through the uncompiled interface.
+     */
+    for (int i = 0; i < 4; ++i) {
+	for (int k = 0; k < 3; ++k) {
+	    (void)sprintf(buf, "%d.%d", i, k);
+	    if (vnaproperty_path_set(&root, element, buf, i, keys[k]) == -1) {
+		(void)printf("%s: vnaproperty_path_set: %s\n",
+			progname, strerror(errno));
+		result = T_FAIL;
+		goto out;
+	    }
+	}
+    }
+    if (!check_value(root, "2.0", "data[2].f") ||
+	    !check_value(root, "3.1", "data[3].my\\.key\\[0\\]") ||
+	    !check_value(root, "1.2", "data[1].\\{x\\}")) {
+	result = T_FAIL;
+	goto out;
+    }
+
+    /*
+     * Read it back through the compiled interface.
+     */
+    if ((count = vnaproperty_path_count(root, list)) != 4) {
+	(void)printf("%s: vnaproperty_path_count: expected 4, found %d\n",
+		progname, count);
+	result = T_FAIL;
+	goto out;
+    }
+    if (vnaproperty_path_type(root, map, 0) != 'm' ||
+	    vnaproperty_path_type(root, element, 0, "f") != 's') {
+	(void)printf("%s: vnaproperty_path_type: wrong type\n", progname);
+	result = T_FAIL;
+	goto out;
+    }
+    if ((count = vnaproperty_path_count(root, map, 1)) != 3) {
+	(void)printf("%s: vnaproperty_path_count: expected 3, found %d\n",
+		progname, count);
+	result = T_FAIL;
+	goto out;
+    }
+    if ((key_vector = vnaproperty_path_keys(root, map, 1)) == NULL) {
+	(void)printf("%s: vnaproperty_path_keys: %s\n",
+		progname, strerror(errno));
+	result = T_FAIL;
+	goto out;
+    }
+    for (int k = 0; k < 3; ++k) {
+	if (key_vector[k] == NULL || strcmp(key_vector[k], keys[k]) != 0) {
+	    (void)printf("%s: vnaproperty_path_keys: expected \"%s\" "
+		    "at index %d\n", progname, keys[k], k);
+	    free((void *)key_vector);
+	    result = T_FAIL;
+	    goto out;
+	}
+    }
+    free((void *)key_vector);
+    for (int i = 0; i < 4; ++i) {
+	for (int k = 0; k < 3; ++k) {
+	    (void)sprintf(buf, "%d.%d", i, k);
+	    if ((value = vnaproperty_path_get(root, element,
+			    i, keys[k])) == NULL) {
+		(void)printf("%s: vnaproperty_path_get: %s\n",
+			progname, strerror(errno));
+		result = T_FAIL;
+		goto out;
+	    }
+	    if (strcmp(value, buf) != 0) {
+		(void)printf("%s: expected value \"%s\", found \"%s\"\n",
+			progname, buf, value);
+		result = T_FAIL;
+		goto out;
+	    }
+	}
+    }
+
+    /*
+     * Missing keys and subscripts give ENOENT; a NULL key gives EINVAL.
+     */
+    errno = 0;
+    if (vnaproperty_path_get(root, element, 4, "f") != NULL ||
+	    errno != ENOENT) {
+	(void)printf("%s: vnaproperty_path_get: expected ENOENT\n", progname);
+	result = T_FAIL;
+	goto out;
+    }
+    errno = 0;
+    if (vnaproperty_path_get(root, element, 0, NULL) != NULL ||
+	    errno != EINVAL) {
+	(void)printf("%s: vnaproperty_path_get: expected EINVAL\n", progname);
+	result = T_FAIL;
+	goto out;
+    }
+
+    /*
+     * Set a null value, then replace a map with a scalar.
+     */
+    if (vnaproperty_path_set(&root, element, NULL, 0, "f") == -1) {
+	(void)printf("%s: vnaproperty_path_set: %s\n",
+		progname, strerror(errno));
+	result = T_FAIL;
+	goto out;
+    }
+    if (vnaproperty_path_get_subtree(root, element, 0, "f") != NULL ||
+	    vnaproperty_count(root, "data[0]{}") != 3) {
+	(void)printf("%s: vnaproperty_path_set: expected null\n", progname);
+	result = T_FAIL;
+	goto out;
+    }
+    if (vnaproperty_path_set(&root, key, "scalar", "data") == -1 ||
+	    !check_value(root, "scalar", "data")) {
+	(void)printf("%s: vnaproperty_path_set: %s\n",
+		progname, strerror(errno));
+	result = T_FAIL;
+	goto out;
+    }
+
+    /*
+     * Create a subtree and delete an element of it.
+     */
+    if ((subtreeptr = vnaproperty_path_set_subtree(&root, map, 1)) == NULL) {
+	(void)printf("%s: vnaproperty_path_set_subtree: %s\n",
+		progname, strerror(errno));
+	result = T_FAIL;
+	goto out;
+    }
+    if (vnaproperty_set(subtreeptr, "a=b") == -1 ||
+	    vnaproperty_path_set(&root, element, "c", 1, "d") == -1) {
+	(void)printf("%s: vnaproperty_set: %s\n", progname, strerror(errno));
+	result = T_FAIL;
+	goto out;
+    }
+    if (vnaproperty_path_type(root, list) != 'l' ||
+	    vnaproperty_path_count(root, list) != 2 ||
+	    vnaproperty_path_get_subtree(root, element, 0, "a") != NULL) {
+	(void)printf("%s: vnaproperty_path_set_subtree: wrong tree\n",
+		progname);
+	result = T_FAIL;
+	goto out;
+    }
+    if ((subtree = vnaproperty_path_get_subtree(root, map, 1)) == NULL ||
+	    !check_value(subtree, "b", "a") ||
+	    !check_value(subtree, "c", "d")) {
+	result = T_FAIL;
+	goto out;
+    }
+    if (vnaproperty_path_delete(&root, element, 1, "a") == -1) {
+	(void)printf("%s: vnaproperty_path_delete: %s\n",
+		progname, strerror(errno));
+	result = T_FAIL;
+	goto out;
+    }
+    if (vnaproperty_path_count(root, map, 1) != 1 ||
+	    !check_value(root, "c", "data[1].d")) {
+	(void)printf("%s: vnaproperty_path_delete: wrong tree\n", progname);
+	result = T_FAIL;
+	goto out;
+    }
+    result = T_PASS;
+
+out:
+    vnaproperty_path_free(element);
+    vnaproperty_path_free(list);
+    vnaproperty_path_free(map);
+    vnaproperty_path_free(key);
+    vnaproperty_delete(&root, ".");
+    libt_report(result);
+    return result;
+}
+
+/*
+ * print_usage: print a usage message and exit
+ */
+static void print_usage()
+{
+    const char *const *cpp;
+
+    for (cpp = usage; *cpp != NULL; ++cpp) {
+	(void)fprintf(stderr, "%s: usage %s\n", progname, *cpp);
+    }
+    for (cpp = help; *cpp != NULL; ++cpp) {
+	(void)fprintf(stderr, "%s\n", *cpp);
+    }
+    exit(2);
+}
+
+/*
+ * main: test program
+ */
+int
+main(int argc, char **argv)
+{
+    if ((char *)NULL == (progname = strrchr(argv[0], '/'))) {
+	progname = argv[0];
+    } else {
+	++progname;
+    }
+    for (;;) {
+	switch (getopt(argc, argv, options)) {
+	case 'v':
+	    ++opt_v;
+	    continue;
+
+	case -1:
+	    break;
+
+	default:
+	    print_usage();
+	}
+	break;
+    }
+    argc -= optind;
+    argv += optind;
+    if (argc != 0) {
+	print_usage();
+    }
+    exit(test_vnaproperty_path());
+}
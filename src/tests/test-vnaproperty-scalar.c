@@ -19,8 +19,10 @@
 #include "archdep.h"
 
 #include <assert.h>
+#include <complex.h>
 #include <errno.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -53,8 +55,14 @@ int opt_v = 0;
 static libt_result_t test_vnaproperty_scalar()
 {
     vnaproperty_t *root = NULL;
+    vnaproperty_t *copy = NULL;
+    vnaproperty_path_t *path = NULL;
+    FILE *fp = NULL;
     int type = -1;
     const char *value;
+    int64_t ivalue;
+    double dvalue;
+    double complex cvalue;
     static const char text1[] = "abcdefghijklmnopqrstuvwxyz";
     static const char text2[] = "~";
     libt_result_t result = T_SKIPPED;
@@ -125,9 +133,234 @@ static libt_result_t test_vnaproperty_scalar()
 	result = T_FAIL;
 	goto out;
     }
+
+    /*
+     * Test scalars set from numbers: the values read back exactly and
+     * the text is made on demand.
+     */
+    if (vnaproperty_set_double(&root, 0.1, "a") == -1 ||
+	    vnaproperty_set_int64(&root, -9007199254740993LL, "b") == -1 ||
+	    vnaproperty_set_complex(&root, 1.5 - 2.0 * I, "c") == -1) {
+	(void)printf("20: vnaproperty_set_<type>: %s\n", strerror(errno));
+	result = T_FAIL;
+	goto out;
+    }
+    if (vnaproperty_get_double(root, &dvalue, "a") == -1 || dvalue != 0.1) {
+	(void)printf("21: vnaproperty_get_double: %s\n", strerror(errno));
+	result = T_FAIL;
+	goto out;
+    }
+    if (vnaproperty_get_int64(root, &ivalue, "b") == -1 ||
+	    ivalue != -9007199254740993LL) {
+	(void)printf("22: vnaproperty_get_int64: %s\n", strerror(errno));
+	result = T_FAIL;
+	goto out;
+    }
+    if (vnaproperty_get_complex(root, &cvalue, "c") == -1 ||
+	    cvalue != 1.5 - 2.0 * I) {
+	(void)printf("23: vnaproperty_get_complex: %s\n", strerror(errno));
+	result = T_FAIL;
+	goto out;
+    }
+    if ((value = vnaproperty_get(root, "a")) == NULL ||
+	    strcmp(value, "0.1") != 0) {
+	(void)printf("24: vnaproperty_get: \"%s\" != \"0.1\"\n",
+		value != NULL ? value : strerror(errno));
+	result = T_FAIL;
+	goto out;
+    }
+    if ((value = vnaproperty_get(root, "b")) == NULL ||
+	    strcmp(value, "-9007199254740993") != 0) {
+	(void)printf("25: vnaproperty_get: \"%s\" != \"-9007199254740993\"\n",
+		value != NULL ? value : strerror(errno));
+	result = T_FAIL;
+	goto out;
+    }
+    if ((value = vnaproperty_get(root, "c")) == NULL ||
+	    strcmp(value, "1.5-2j") != 0) {
+	(void)printf("26: vnaproperty_get: \"%s\" != \"1.5-2j\"\n",
+		value != NULL ? value : strerror(errno));
+	result = T_FAIL;
+	goto out;
+    }
+
+    /*
+     * Test conversions between types.
+     */
+    if (vnaproperty_get_double(root, &dvalue, "b") == -1 ||
+	    dvalue != -9007199254740992.0) {
+	(void)printf("27: vnaproperty_get_double of int64 failed\n");
+	result = T_FAIL;
+	goto out;
+    }
+    errno = 0;
+    if (vnaproperty_get_double(root, &dvalue, "c") != -1 ||
+	    errno != EINVAL) {
+	(void)printf("28: vnaproperty_get_double of complex should fail\n");
+	result = T_FAIL;
+	goto out;
+    }
+    errno = 0;
+    if (vnaproperty_get_int64(root, &ivalue, "a") != -1 || errno != EINVAL) {
+	(void)printf("29: vnaproperty_get_int64 of 0.1 should fail\n");
+	result = T_FAIL;
+	goto out;
+    }
+    if (vnaproperty_set_double(&root, 3.0, "a") == -1 ||
+	    vnaproperty_get_int64(root, &ivalue, "a") == -1 || ivalue != 3) {
+	(void)printf("30: vnaproperty_get_int64 of 3.0 failed\n");
+	result = T_FAIL;
+	goto out;
+    }
+
+    /*
+     * Test numeric reads of scalars set from text.
+     */
+    if (vnaproperty_set(&root, "d=2.5e3") == -1 ||
+	    vnaproperty_set(&root, "e=0x10") == -1 ||
+	    vnaproperty_set(&root, "f=1 +2j") == -1 ||
+	    vnaproperty_set(&root, "g=text") == -1 ||
+	    vnaproperty_set(&root, "h#") == -1) {
+	(void)printf("31: vnaproperty_set: %s\n", strerror(errno));
+	result = T_FAIL;
+	goto out;
+    }
+    for (int i = 0; i < 2; ++i) {
+	if (vnaproperty_get_double(root, &dvalue, "d") == -1 ||
+		dvalue != 2500.0) {
+	    (void)printf("32[%d]: vnaproperty_get_double: %s\n",
+		    i, strerror(errno));
+	    result = T_FAIL;
+	    goto out;
+	}
+    }
+    errno = 0;
+    if (vnaproperty_get_int64(root, &ivalue, "d") != -1 || errno != EINVAL) {
+	(void)printf("33: vnaproperty_get_int64 of \"2.5e3\" should fail\n");
+	result = T_FAIL;
+	goto out;
+    }
+    if (vnaproperty_get_complex(root, &cvalue, "d") == -1 ||
+	    cvalue != 2500.0) {
+	(void)printf("34: vnaproperty_get_complex: %s\n", strerror(errno));
+	result = T_FAIL;
+	goto out;
+    }
+    if (vnaproperty_get_int64(root, &ivalue, "e") == -1 || ivalue != 16) {
+	(void)printf("35: vnaproperty_get_int64: %s\n", strerror(errno));
+	result = T_FAIL;
+	goto out;
+    }
+    if (vnaproperty_get_complex(root, &cvalue, "f") == -1 ||
+	    cvalue != 1.0 + 2.0 * I) {
+	(void)printf("36: vnaproperty_get_complex: %s\n", strerror(errno));
+	result = T_FAIL;
+	goto out;
+    }
+    if ((value = vnaproperty_get(root, "d")) == NULL ||
+	    strcmp(value, "2.5e3") != 0) {
+	(void)printf("37: text of \"d\" changed\n");
+	result = T_FAIL;
+	goto out;
+    }
+    errno = 0;
+    if (vnaproperty_get_double(root, &dvalue, "g") != -1 || errno != EINVAL) {
+	(void)printf("38: vnaproperty_get_double of text should fail\n");
+	result = T_FAIL;
+	goto out;
+    }
+    errno = 0;
+    if (vnaproperty_get_double(root, &dvalue, "h") != -1 || errno != EINVAL) {
+	(void)printf("39: vnaproperty_get_double of null should fail\n");
+	result = T_FAIL;
+	goto out;
+    }
+    errno = 0;
+    if (vnaproperty_get_double(root, &dvalue, "z") != -1 || errno != ENOENT) {
+	(void)printf("40: vnaproperty_get_double of missing should fail\n");
+	result = T_FAIL;
+	goto out;
+    }
+
+    /*
+     * Test the compiled-expression forms.
+     */
+    if ((path = vnaproperty_path_compile("list[%d]")) == NULL) {
+	(void)printf("41: vnaproperty_path_compile: %s\n", strerror(errno));
+	result = T_FAIL;
+	goto out;
+    }
+    for (int i = 0; i < 10; ++i) {
+	if (vnaproperty_path_set_double(&root, path, i / 3.0, i) == -1) {
+	    (void)printf("42[%d]: vnaproperty_path_set_double: %s\n",
+		    i, strerror(errno));
+	    result = T_FAIL;
+	    goto out;
+	}
+    }
+    for (int i = 0; i < 10; ++i) {
+	if (vnaproperty_path_get_double(root, path, &dvalue, i) == -1 ||
+		dvalue != i / 3.0) {
+	    (void)printf("43[%d]: vnaproperty_path_get_double: %s\n",
+		    i, strerror(errno));
+	    result = T_FAIL;
+	    goto out;
+	}
+    }
+
+    /*
+     * Test that copy keeps the numbers and that the generated text
+     * survives a YAML round trip exactly.
+     */
+    if (vnaproperty_copy(&copy, root) == -1) {
+	(void)printf("44: vnaproperty_copy: %s\n", strerror(errno));
+	result = T_FAIL;
+	goto out;
+    }
+    if ((fp = tmpfile()) == NULL) {
+	(void)printf("45: tmpfile: %s\n", strerror(errno));
+	result = T_FAIL;
+	goto out;
+    }
+    if (vnaproperty_export_yaml_to_file(copy, fp, "tmpfile",
+		NULL, NULL) == -1) {
+	(void)printf("46: vnaproperty_export_yaml_to_file: %s\n",
+		strerror(errno));
+	result = T_FAIL;
+	goto out;
+    }
+    (void)vnaproperty_delete(&copy, ".");
+    rewind(fp);
+    if (vnaproperty_import_yaml_from_file(&copy, fp, "tmpfile",
+		NULL, NULL) == -1) {
+	(void)printf("47: vnaproperty_import_yaml_from_file: %s\n",
+		strerror(errno));
+	result = T_FAIL;
+	goto out;
+    }
+    for (int i = 0; i < 10; ++i) {
+	if (vnaproperty_path_get_double(copy, path, &dvalue, i) == -1 ||
+		dvalue != i / 3.0) {
+	    (void)printf("48[%d]: value changed in YAML round trip\n", i);
+	    result = T_FAIL;
+	    goto out;
+	}
+    }
+    if (vnaproperty_get_complex(copy, &cvalue, "c") == -1 ||
+	    cvalue != 1.5 - 2.0 * I) {
+	(void)printf("49: complex value changed in YAML round trip\n");
+	result = T_FAIL;
+	goto out;
+    }
     result = T_PASS;
 
 out:
+    if (fp != NULL) {
+	(void)fclose(fp);
+    }
+    vnaproperty_path_free(path);
+    (void)vnaproperty_delete(&copy, ".");
+    (void)vnaproperty_delete(&root, ".");
     libt_report(result);
     return result;
 }
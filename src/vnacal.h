@@ -61,6 +61,17 @@ typedef enum vnacal_type {
     VNACAL_E12,		/* 12-term generalized classic SOLT */
 } vnacal_type_t;
 
+/*
+ * vnacal_interpolation_t: method of interpolating between frequencies
+ */
+typedef enum vnacal_interpolation {
+    VNACAL_INTERP_INVALID = -1, /* an invalid method */
+    VNACAL_INTERP_RATIONAL,	/* rational function (default) */
+    VNACAL_INTERP_LINEAR,	/* linear in real and imaginary parts */
+    VNACAL_INTERP_POLAR,	/* linear in magnitude and phase */
+    VNACAL_INTERP_SPLINE	/* natural cubic spline */
+} vnacal_interpolation_t;
+
 
 /*
  * VNACAL_CK_MAGIC: magic number for validating vnacal_calkit_data_t
@@ -130,6 +141,32 @@ typedef struct vnacal vnacal_t;
  */
 typedef struct vnacal_new vnacal_new_t;
 
+/*
+ * VNACAL_STATS_LU_DIMENSIONS: number of entries in vcs_lu_calls
+ */
+#define VNACAL_STATS_LU_DIMENSIONS	32
+
+/*
+ * vnacal_stats_t: hot-path counters and times (see vnacal_get_stats)
+ *
+ *   vcs_lu_calls[n - 1] counts LU decompositions of dimension n;
+ *   the last entry also counts all larger ones.
+ */
+typedef struct vnacal_stats {
+    unsigned long vcs_rfi_calls;	/* rational function interpolations */
+    unsigned long vcs_eval_parameter_calls; /* parameter matrix evaluations */
+    unsigned long vcs_lu_calls[VNACAL_STATS_LU_DIMENSIONS];
+    unsigned long vcs_solve_iterations;	/* iterations of iterative solver */
+    unsigned long vcs_apply_calls;	/* vnacal_apply and vnacal_apply_m */
+    uint64_t vcs_apply_ns;		/* time in apply (ns) */
+    unsigned long vcs_solve_calls;	/* vnacal_new_solve */
+    uint64_t vcs_solve_ns;		/* time in vnacal_new_solve (ns) */
+    unsigned long vcs_load_calls;	/* vnacal_load and vnacal_load_lazy */
+    uint64_t vcs_load_ns;		/* time in load (ns) */
+    unsigned long vcs_save_calls;	/* vnacal_save */
+    uint64_t vcs_save_ns;		/* time in vnacal_save (ns) */
+} vnacal_stats_t;
+
 
 /*
  * vnacal_name_to_type: convert error-term type name to enum
@@ -143,6 +180,19 @@ extern vnacal_type_t vnacal_name_to_type(const char *name);
  */
 extern const char *vnacal_type_to_name(vnacal_type_t type);
 
+/*
+ * vnacal_name_to_interpolation: convert interpolation method name to enum
+ *   @name: name of interpolation method (case insensitive)
+ */
+extern vnacal_interpolation_t vnacal_name_to_interpolation(const char *name);
+
+/*
+ * vnacal_interpolation_to_name: convert interpolation method to name
+ *   @method: interpolation method
+ */
+extern const char *vnacal_interpolation_to_name(
+	vnacal_interpolation_t method);
+
 /*
  * vnacal_new_alloc: allocate a vnacal_new_t structure
  *   @vcp: pointer returned from vnacal_create or vnacal_load
@@ -510,6 +560,19 @@ extern int vnacal_make_data_parameter_matrix(vnacal_t *vcp,
 	const vnadata_t *vdp, int *parameter_matrix,
 	size_t parameter_matrix_size);
 
+/*
+ * vnacal_set_parameter_interpolation: set interpolation for a parameter
+ *   @vcp: pointer returned from vnacal_create or vnacal_load
+ *   @parameter: data, vector, unknown or correlated parameter
+ *   @method: interpolation method
+ *
+ * For data parameters, the method applies to all parameters made from
+ * the same call to vnacal_make_data_parameter or
+ * vnacal_make_data_parameter_matrix.
+ */
+extern int vnacal_set_parameter_interpolation(vnacal_t *vcp, int parameter,
+	vnacal_interpolation_t method);
+
 /*
  * vnacal_get_parameter_value: evaluate a parameter at a given frequency
  *   @vcp: pointer returned from vnacal_create or vnacal_load
@@ -588,6 +651,19 @@ extern int vnacal_delete_parameter_matrix(vnacal_t *vcp,
  */
 extern vnacal_t *vnacal_create(vnaerr_error_fn_t *error_fn, void *error_arg);
 
+/*
+ * vnacal_create_with_allocator: create a calibration with its own allocator
+ *   @error_fn: optional error reporting function (NULL if not used)
+ *   @error_arg: user data passed through to the error function (or NULL)
+ *   @allocator: allocator to use, or NULL for the global allocator
+ *
+ *   The structure and everything it holds, including its property
+ *   trees, come from the allocator, which must remain valid until
+ *   vnacal_free.
+ */
+extern vnacal_t *vnacal_create_with_allocator(vnaerr_error_fn_t *error_fn,
+	void *error_arg, const vnamem_allocator_t *allocator);
+
 /*
  * vnacal_load: load an existing calibration from a file
  *   @pathname: calibration file name
@@ -600,6 +676,43 @@ extern vnacal_t *vnacal_create(vnaerr_error_fn_t *error_fn, void *error_arg);
 extern vnacal_t *vnacal_load(const char *pathname,
 	vnaerr_error_fn_t *error_fn, void *error_arg);
 
+/*
+ * vnacal_load_with_allocator: vnacal_load using the given allocator
+ *   @pathname: calibration file name
+ *   @error_fn: error reporting callback or NULL
+ *   @error_arg: arbitrary argument passed through to error_fn or NULL
+ *   @allocator: allocator to use, or NULL for the global allocator
+ */
+extern vnacal_t *vnacal_load_with_allocator(const char *pathname,
+	vnaerr_error_fn_t *error_fn, void *error_arg,
+	const vnamem_allocator_t *allocator);
+
+/*
+ * vnacal_load_lazy: load a calibration file, deferring the error terms
+ *   @pathname: calibration file name
+ *   @error_fn: error reporting callback or NULL
+ *   @error_arg: arbitrary argument passed through to error_fn or NULL
+ *
+ *   Like vnacal_load, but only index the calibrations by name; load
+ *   each from the file the first time it's used.  The file stays open
+ *   until vnacal_free or vnacal_save.  Because even the const getters
+ *   may load a calibration, the returned structure must not be used
+ *   from more than one thread at a time.
+ */
+extern vnacal_t *vnacal_load_lazy(const char *pathname,
+	vnaerr_error_fn_t *error_fn, void *error_arg);
+
+/*
+ * vnacal_load_lazy_with_allocator: vnacal_load_lazy using the given allocator
+ *   @pathname: calibration file name
+ *   @error_fn: error reporting callback or NULL
+ *   @error_arg: arbitrary argument passed through to error_fn or NULL
+ *   @allocator: allocator to use, or NULL for the global allocator
+ */
+extern vnacal_t *vnacal_load_lazy_with_allocator(const char *pathname,
+	vnaerr_error_fn_t *error_fn, void *error_arg,
+	const vnamem_allocator_t *allocator);
+
 /*
  * vnacal_save: create or overwrite a calibration file with new data
  *   @vcp: pointer returned from vnacal_create or vnacal_load
@@ -762,6 +875,50 @@ extern double complex vnacal_get_z0(const vnacal_t *vcp, int ci);
 extern int vnacal_get_z0_vector(const vnacal_t *vcp, int ci, double f,
 	double complex *vector, int max_entries);
 
+/*
+ * vnacal_get_interpolation: return the interpolation method
+ *   @vcp: pointer returned from vnacal_create or vnacal_load
+ *   @ci: calibration index
+ */
+extern vnacal_interpolation_t vnacal_get_interpolation(const vnacal_t *vcp,
+	int ci);
+
+/*
+ * vnacal_set_interpolation: set the interpolation method
+ *   @vcp: pointer returned from vnacal_create or vnacal_load
+ *   @ci: calibration index
+ *   @method: interpolation method
+ *
+ * The method is saved with the calibration by vnacal_save.
+ */
+extern int vnacal_set_interpolation(vnacal_t *vcp, int ci,
+	vnacal_interpolation_t method);
+
+/*
+ * vnacal_compact: replace interpolation with piecewise polynomial models
+ *   @vcp: pointer returned from vnacal_create or vnacal_load
+ *   @ci: calibration index
+ *   @tolerance: largest magnitude of fit error allowed
+ *
+ * Fit each error term with piecewise cubic polynomials that match the
+ * calibration values to within tolerance, and evaluate the fits in
+ * vnacal_apply and vnacal_apply_m.  The fits replace the error term
+ * values, which are discarded, and vnacal_save saves the fits.
+ */
+extern int vnacal_compact(vnacal_t *vcp, int ci, double tolerance);
+
+/*
+ * vnacal_get_fit_error: return the fit error of each error term model
+ *   @vcp: pointer returned from vnacal_create or vnacal_load
+ *   @ci: calibration index
+ *   @vector: caller-provided buffer to receive the result
+ *   @max_entries: number of double entries in vector
+ *
+ * Return the number of error terms.
+ */
+extern int vnacal_get_fit_error(const vnacal_t *vcp, int ci, double *vector,
+	int max_entries);
+
 /*
  * vnacal_set_fprecision: set the frequency value precision for vnacal_save
  *   @vcp: pointer returned from vnacal_create or vnacal_load
@@ -932,6 +1089,23 @@ extern int vnacal_apply_m(vnacal_t *vcp, int ci,
 	double complex *const *m, int m_rows, int m_columns,
 	vnadata_t *s_parameters);
 
+/*
+ * vnacal_get_stats: return hot-path counters and times
+ *   @stats: caller-allocated structure to receive the result
+ */
+extern void vnacal_get_stats(vnacal_stats_t *stats);
+
+/*
+ * vnacal_reset_stats: clear hot-path counters and times
+ */
+extern void vnacal_reset_stats(void);
+
+/*
+ * vnacal_set_stats_per_thread: count separately in each thread
+ *   @per_thread: true for per-thread counters; false for shared
+ */
+extern void vnacal_set_stats_per_thread(bool per_thread);
+
 
 #ifdef __cplusplus
 } /* extern "C" */
@@ -27,6 +27,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include "vnacal_internal.h"
+#include "vnastats_internal.h"
 
 
 /*
@@ -560,7 +561,9 @@ int _vnacal_apply_common(vnacal_apply_args_t vaa)
     vnacal_layout_t vl;
     int c_rows, c_columns, c_ports;
     double fmin, fmax;
-    int segment = 0;
+    vnacal_interp_plan_t *planp = NULL;
+    int *model_segment = NULL;
+    int rv = -1;
 
     /*
      * Get the calibration and validate parameters.
@@ -717,11 +720,36 @@ int _vnacal_apply_common(vnacal_apply_args_t vaa)
 	abort();
     }
 
+    /*
+     * Find the interpolation window in the calibration frequencies
+     * for each frequency once, and share it across all error terms
+     * and reference impedances.
+     */
+    if ((planp = _vnacal_interp_plan_alloc(calp->cal_interpolation,
+		    calp->cal_frequency_vector, calp->cal_frequencies,
+		    vaa.vaa_frequency_vector, vaa.vaa_frequencies)) == NULL) {
+	_vnacal_error(vcp, VNAERR_SYSTEM, "malloc: %s", strerror(errno));
+	return -1;
+    }
+
+    /*
+     * If the calibration has been compacted, keep the current model
+     * segment of each error term as the starting point of the search
+     * at the next frequency.
+     */
+    if (calp->cal_error_term_model != NULL &&
+	    (model_segment = _vnacal_calloc(vcp, calp->cal_error_terms,
+		    sizeof(int))) == NULL) {
+	_vnacal_error(vcp, VNAERR_SYSTEM, "calloc: %s", strerror(errno));
+	goto out;
+    }
+
     /*
      * For each frequency index...
      */
     for (int findex = 0; findex < vaa.vaa_frequencies; ++findex) {
-	double f = vaa.vaa_frequency_vector[findex];
+	const vnacal_interp_point_t *pointp =
+	    &planp->vipl_point_vector[findex];
 	double complex determinant;
 	double complex t[calp->cal_error_terms];
 	double complex m[c_ports * c_ports];
@@ -732,12 +760,23 @@ int _vnacal_apply_common(vnacal_apply_args_t vaa)
 #define S(i, j)	(s[(i) * c_ports + (j)])
 
 	/*
-	 * Interpolate to find the error terms for this frequency.
+	 * Evaluate the models or interpolate to find the error terms
+	 * for this frequency.
 	 */
-	for (int term = 0; term < calp->cal_error_terms; ++term) {
-	    t[term] = _vnacal_rfi(calp->cal_frequency_vector,
-		    calp->cal_error_term_vector[term], calp->cal_frequencies,
-		    MIN(calp->cal_frequencies, VNACAL_MAX_M), &segment, f);
+	if (calp->cal_error_term_model != NULL) {
+	    const double f = vaa.vaa_frequency_vector[findex];
+
+	    for (int term = 0; term < calp->cal_error_terms; ++term) {
+		t[term] = _vnacal_model_eval(&calp->cal_error_term_model[term],
+			f, &model_segment[term]);
+	    }
+	} else {
+	    for (int term = 0; term < calp->cal_error_terms; ++term) {
+		t[term] = _vnacal_interp_eval_point(pointp,
+			calp->cal_error_term_vector[term],
+			calp->cal_error_term_spline != NULL ?
+			calp->cal_error_term_spline[term] : NULL);
+	    }
 	}
 
 	/*
@@ -749,13 +788,14 @@ int _vnacal_apply_common(vnacal_apply_args_t vaa)
 	    double complex z0_vector[c_ports];
 
 	    for (int port = 0; port < c_ports; ++port) {
-		z0_vector[port] = _vnacal_rfi(calp->cal_frequency_vector,
-			calp->cal_z0_matrix[port], calp->cal_frequencies,
-			MIN(calp->cal_frequencies, VNACAL_MAX_M), &segment, f);
-		if (vnadata_set_fz0_vector(vaa.vaa_s_parameters,
+		z0_vector[port] = _vnacal_interp_eval_point(pointp,
+			calp->cal_z0_matrix[port],
+			calp->cal_z0_spline != NULL ?
+			calp->cal_z0_spline[port] : NULL);
+	    }
+	    if (vnadata_set_fz0_vector(vaa.vaa_s_parameters,
 			findex, z0_vector) == -1) {
-		    return -1;
-		}
+		goto out;
 	    }
 	}
 
@@ -794,7 +834,7 @@ int _vnacal_apply_common(vnacal_apply_args_t vaa)
 		_vnacal_error(vcp, VNAERR_MATH,
 			"%s: 'a' matrix is singular at frequency index %d",
 			vaa.vaa_function, findex);
-		return -1;
+		goto out;
 	    }
 	}
 
@@ -865,7 +905,7 @@ int _vnacal_apply_common(vnacal_apply_args_t vaa)
 	    _vnacal_error(vcp, VNAERR_MATH,
 		    "%s: solution is singular at frequency index %d",
 		    vaa.vaa_function, findex);
-	    return -1;
+	    goto out;
 	}
 
 	/*
@@ -880,7 +920,12 @@ int _vnacal_apply_common(vnacal_apply_args_t vaa)
 #undef S
 #undef M
     }
-    return 0;
+    rv = 0;
+
+out:
+    _vnacal_free(vcp, (void *)model_segment);
+    _vnacal_interp_plan_free(planp);
+    return rv;
 }
 
 /*
@@ -903,7 +948,9 @@ int vnacal_apply(vnacal_t *vcp, int ci,
 	double complex *const *b, int b_rows, int b_columns,
 	vnadata_t *s_parameters)
 {
+    uint64_t start = _VNASTATS_NOW();
     vnacal_apply_args_t vaa;
+    int rv;
 
     (void)memset((void *)&vaa, 0, sizeof(vaa));
     vaa.vaa_function		= __func__;
@@ -920,7 +967,9 @@ int vnacal_apply(vnacal_t *vcp, int ci,
     vaa.vaa_m_type		= 'a';
     vaa.vaa_s_parameters	= s_parameters;
 
-    return _vnacal_apply_common(vaa);
+    rv = _vnacal_apply_common(vaa);
+    _VNASTATS_TIME(_vnacal_stats, vcs_apply_calls, vcs_apply_ns, start);
+    return rv;
 }
 
 /*
@@ -939,7 +988,9 @@ int vnacal_apply_m(vnacal_t *vcp, int ci,
 	double complex *const *m, int m_rows, int m_columns,
 	vnadata_t *s_parameters)
 {
+    uint64_t start = _VNASTATS_NOW();
     vnacal_apply_args_t vaa;
+    int rv;
 
     (void)memset((void *)&vaa, 0, sizeof(vaa));
     vaa.vaa_function		= __func__;
@@ -956,5 +1007,7 @@ int vnacal_apply_m(vnacal_t *vcp, int ci,
     vaa.vaa_m_type		= 'm';
     vaa.vaa_s_parameters	= s_parameters;
 
-    return _vnacal_apply_common(vaa);
+    rv = _vnacal_apply_common(vaa);
+    _VNASTATS_TIME(_vnacal_stats, vcs_apply_calls, vcs_apply_ns, start);
+    return rv;
 }
@@ -0,0 +1,1196 @@
+/*
+ * Vector Network Analyzer Library
+ * Copyright © 2020-2023 D Scott Guthridge <scott_guthridge@rompromity.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "archdep.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <limits.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(HAVE_MMAP) && defined(HAVE_SYS_MMAN_H)
+#define VCB_CAN_MAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "vnacal_internal.h"
+#include "vnaproperty_internal.h"
+
+/*
+ * Binary calibration (.vnacalb) file layout
+ *
+ *   All values are little-endian.  Floating point values are IEEE 754
+ *   doubles; complex values are stored as the real part followed by
+ *   the imaginary part.  The file begins with a fixed-size header:
+ *
+ *	offset	size	field
+ *	     0	   8	magic number: VNACAL_BINARY_MAGIC
+ *	     8	   4	format version (see below)
+ *	    12	   4	size of the header, i.e. offset of the directory
+ *	    16	   4	number of calibrations
+ *	    20	   4	size of each directory entry
+ *	    24	   4	frequency precision (signed)
+ *	    28	   4	data precision (signed)
+ *	    32	   8	offset of the global properties, or zero
+ *	    40	   8	length of the global properties
+ *	    48	   8	total size of the file
+ *	    56	  72	reserved, zero
+ *
+ *   The header is followed by a directory with one entry per
+ *   calibration:
+ *
+ *	offset	size	field
+ *	     0	   4	calibration type (vnacal_type_t)
+ *	     4	   4	rows
+ *	     8	   4	columns
+ *	    12	   4	frequencies
+ *	    16	   4	reference impedance type (vnacal_z0_type_t)
+ *	    20	   4	number of error terms
+ *	    24	   4	length of the name, not including the NUL
+ *	    28	   4	interpolation method (vnacal_interpolation_t)
+ *	    32	   8	offset of the name
+ *	    40	   8	offset of the properties, or zero
+ *	    48	   8	length of the properties
+ *	    56	   8	offset of the frequency vector
+ *	    64	   8	offset of the reference impedances
+ *	    72	   8	offset of the error terms, or zero if compacted
+ *	    80	   8	compact tolerance (double), or zero
+ *	    88	   8	offset of the error term models, or zero
+ *	    96	  32	reserved, zero
+ *
+ *   Names are NUL-terminated.  Properties are NUL-terminated YAML
+ *   documents as written by vnaproperty_export_yaml_to_file; the
+ *   lengths don't include the NUL.  The frequency vector, reference
+ *   impedances and error terms of each calibration each start at an
+ *   offset that's a multiple of VCB_ALIGNMENT.  The reference
+ *   impedances are a single value, a vector of ports values, or ports
+ *   vectors of frequencies values, by z0 type.  The error terms are
+ *   stored as the vectors of cal_error_term_vector, one after the
+ *   other, so that a mapping of the file can be referenced directly.
+ *
+ *   Compacted calibrations store the error term models in place of
+ *   the error terms.  The models block, which starts at an offset
+ *   that's a multiple of VCB_ALIGNMENT, gives for each error term
+ *   in turn:
+ *
+ *	size	field
+ *	   4	number of segments
+ *	   4	reserved, zero
+ *	   8	fit error
+ *	   8	breakpoints: segments + 1 doubles
+ *	  64	coefficients: segments x (VNACAL_MODEL_ORDER + 1) complex
+ *
+ *   where the sizes of the last two are per element.
+ *
+ *   The format version is 1 if every calibration uses rational
+ *   function interpolation, where the interpolation method field is
+ *   zero, and none is compacted, and otherwise 2.
+ */
+#define VCB_VERSION		2
+#define VCB_HEADER_SIZE		128
+#define VCB_ENTRY_SIZE		128
+#define VCB_ALIGNMENT		64
+#define VCB_MODEL_HEADER_SIZE	16
+#define VCB_COEFFICIENTS	(VNACAL_MODEL_ORDER + 1)
+
+/*
+ * VCB_ALIGN: round offset up to a multiple of VCB_ALIGNMENT
+ */
+#define VCB_ALIGN(offset) \
+	(((offset) + VCB_ALIGNMENT - 1) & ~(uint64_t)(VCB_ALIGNMENT - 1))
+
+/*
+ * vcb_header_t: decoded file header
+ */
+typedef struct vcb_header {
+    uint32_t vh_version;
+    uint32_t vh_header_size;
+    uint32_t vh_calibrations;
+    uint32_t vh_entry_size;
+    int32_t  vh_fprecision;
+    int32_t  vh_dprecision;
+    uint64_t vh_properties_offset;
+    uint64_t vh_properties_length;
+    uint64_t vh_file_size;
+} vcb_header_t;
+
+/*
+ * vcb_entry_t: decoded directory entry
+ */
+typedef struct vcb_entry {
+    uint32_t ve_type;
+    uint32_t ve_rows;
+    uint32_t ve_columns;
+    uint32_t ve_frequencies;
+    uint32_t ve_z0_type;
+    uint32_t ve_error_terms;
+    uint32_t ve_name_length;
+    uint32_t ve_interpolation;
+    uint64_t ve_name_offset;
+    uint64_t ve_properties_offset;
+    uint64_t ve_properties_length;
+    uint64_t ve_frequency_offset;
+    uint64_t ve_z0_offset;
+    uint64_t ve_error_term_offset;
+    double   ve_compact_tolerance;
+    uint64_t ve_model_offset;
+} vcb_entry_t;
+
+/*
+ * put_double: encode a little-endian double
+ *   @cp: 8 byte buffer
+ *   @value: value to encode
+ */
+static void put_double(uint8_t *cp, double value)
+{
+    uint64_t bits;
+
+    (void)memcpy((void *)&bits, (void *)&value, sizeof(bits));
+    _vnacommon_put_u64(cp, bits);
+}
+
+/*
+ * get_double: decode a little-endian double
+ *   @cp: 8 byte buffer
+ */
+static double get_double(const uint8_t *cp)
+{
+    uint64_t bits = _vnacommon_get_u64(cp);
+    double value;
+
+    (void)memcpy((void *)&value, (void *)&bits, sizeof(value));
+    return value;
+}
+
+/*
+ * encode_header: serialize a header
+ *   @vhp: header to encode
+ *   @buffer: VCB_HEADER_SIZE byte buffer to receive the result
+ */
+static void encode_header(const vcb_header_t *vhp, uint8_t *buffer)
+{
+    (void)memset((void *)buffer, 0, VCB_HEADER_SIZE);
+    (void)memcpy((void *)buffer, VNACAL_BINARY_MAGIC,
+	    VNACAL_BINARY_MAGIC_LENGTH);
+    _vnacommon_put_u32(&buffer[ 8], vhp->vh_version);
+    _vnacommon_put_u32(&buffer[12], vhp->vh_header_size);
+    _vnacommon_put_u32(&buffer[16], vhp->vh_calibrations);
+    _vnacommon_put_u32(&buffer[20], vhp->vh_entry_size);
+    _vnacommon_put_u32(&buffer[24], (uint32_t)vhp->vh_fprecision);
+    _vnacommon_put_u32(&buffer[28], (uint32_t)vhp->vh_dprecision);
+    _vnacommon_put_u64(&buffer[32], vhp->vh_properties_offset);
+    _vnacommon_put_u64(&buffer[40], vhp->vh_properties_length);
+    _vnacommon_put_u64(&buffer[48], vhp->vh_file_size);
+}
+
+/*
+ * encode_entry: serialize a directory entry
+ *   @vep: entry to encode
+ *   @buffer: VCB_ENTRY_SIZE byte buffer to receive the result
+ */
+static void encode_entry(const vcb_entry_t *vep, uint8_t *buffer)
+{
+    (void)memset((void *)buffer, 0, VCB_ENTRY_SIZE);
+    _vnacommon_put_u32(&buffer[ 0], vep->ve_type);
+    _vnacommon_put_u32(&buffer[ 4], vep->ve_rows);
+    _vnacommon_put_u32(&buffer[ 8], vep->ve_columns);
+    _vnacommon_put_u32(&buffer[12], vep->ve_frequencies);
+    _vnacommon_put_u32(&buffer[16], vep->ve_z0_type);
+    _vnacommon_put_u32(&buffer[20], vep->ve_error_terms);
+    _vnacommon_put_u32(&buffer[24], vep->ve_name_length);
+    _vnacommon_put_u32(&buffer[28], vep->ve_interpolation);
+    _vnacommon_put_u64(&buffer[32], vep->ve_name_offset);
+    _vnacommon_put_u64(&buffer[40], vep->ve_properties_offset);
+    _vnacommon_put_u64(&buffer[48], vep->ve_properties_length);
+    _vnacommon_put_u64(&buffer[56], vep->ve_frequency_offset);
+    _vnacommon_put_u64(&buffer[64], vep->ve_z0_offset);
+    _vnacommon_put_u64(&buffer[72], vep->ve_error_term_offset);
+    put_double(&buffer[80], vep->ve_compact_tolerance);
+    _vnacommon_put_u64(&buffer[88], vep->ve_model_offset);
+}
+
+/*
+ * decode_entry: parse a directory entry
+ *   @buffer: VCB_ENTRY_SIZE bytes
+ *   @vep: entry to fill in
+ */
+static void decode_entry(const uint8_t *buffer, vcb_entry_t *vep)
+{
+    vep->ve_type	      = _vnacommon_get_u32(&buffer[ 0]);
+    vep->ve_rows	      = _vnacommon_get_u32(&buffer[ 4]);
+    vep->ve_columns	      = _vnacommon_get_u32(&buffer[ 8]);
+    vep->ve_frequencies	      = _vnacommon_get_u32(&buffer[12]);
+    vep->ve_z0_type	      = _vnacommon_get_u32(&buffer[16]);
+    vep->ve_error_terms	      = _vnacommon_get_u32(&buffer[20]);
+    vep->ve_name_length	      = _vnacommon_get_u32(&buffer[24]);
+    vep->ve_interpolation     = _vnacommon_get_u32(&buffer[28]);
+    vep->ve_name_offset	      = _vnacommon_get_u64(&buffer[32]);
+    vep->ve_properties_offset = _vnacommon_get_u64(&buffer[40]);
+    vep->ve_properties_length = _vnacommon_get_u64(&buffer[48]);
+    vep->ve_frequency_offset  = _vnacommon_get_u64(&buffer[56]);
+    vep->ve_z0_offset	      = _vnacommon_get_u64(&buffer[64]);
+    vep->ve_error_term_offset = _vnacommon_get_u64(&buffer[72]);
+    vep->ve_compact_tolerance = get_double(&buffer[80]);
+    vep->ve_model_offset      = _vnacommon_get_u64(&buffer[88]);
+}
+
+/*
+ * z0_values: return the number of reference impedance values stored
+ *   @z0_type: reference impedance type
+ *   @ports: number of ports
+ *   @frequencies: number of frequencies
+ */
+static uint64_t z0_values(vnacal_z0_type_t z0_type, uint64_t ports,
+	uint64_t frequencies)
+{
+    switch (z0_type) {
+    case VNACAL_Z0_SCALAR:
+	return 1;
+    case VNACAL_Z0_VECTOR:
+	return ports;
+    case VNACAL_Z0_MATRIX:
+	return ports * frequencies;
+    default:
+	break;
+    }
+    abort();
+}
+
+/*
+ * models_size: return the size of the models block of a calibration
+ *   @calp: compacted calibration
+ */
+static uint64_t models_size(const vnacal_calibration_t *calp)
+{
+    uint64_t size = 0;
+
+    for (int term = 0; term < calp->cal_error_terms; ++term) {
+	const uint64_t segments = calp->cal_error_term_model[term].vm_segments;
+
+	size += VCB_MODEL_HEADER_SIZE + (segments + 1) * sizeof(double) +
+	    segments * VCB_COEFFICIENTS * sizeof(double complex);
+    }
+    return size;
+}
+
+/*
+ * _vnacal_map_release: drop a reference to a binary file image
+ *   @vmp: shared image
+ */
+void _vnacal_map_release(vnacal_map_t *vmp)
+{
+    if (vmp == NULL || --vmp->vm_references > 0) {
+	return;
+    }
+#ifdef VCB_CAN_MAP
+    if (vmp->vm_mapped) {
+	(void)munmap(vmp->vm_address, vmp->vm_length);
+    } else {
+	_vnamem_afree(&vmp->vm_allocator, vmp->vm_address);
+    }
+#else
+    _vnamem_afree(&vmp->vm_allocator, vmp->vm_address);
+#endif
+    _vnamem_afree(&vmp->vm_allocator, (void *)vmp);
+}
+
+/*
+ * read_image: read a binary calibration file into memory
+ *   @vcp: vnacal structure
+ *   @vmp: image to fill in
+ *
+ *   Used where the file can't be mapped.
+ */
+static int read_image(vnacal_t *vcp, vnacal_map_t *vmp)
+{
+    const char *filename = vcp->vc_filename;
+    FILE *fp;
+    long length;
+    int rc = -1;
+
+    if ((fp = fopen(filename, "rb")) == NULL) {
+	_vnacal_error(vcp, VNAERR_SYSTEM, "fopen: %s: %s",
+		filename, strerror(errno));
+	return -1;
+    }
+    if (fseek(fp, 0L, SEEK_END) == -1 || (length = ftell(fp)) == -1 ||
+	    fseek(fp, 0L, SEEK_SET) == -1) {
+	_vnacal_error(vcp, VNAERR_SYSTEM, "fseek: %s: %s",
+		filename, strerror(errno));
+	goto out;
+    }
+    if ((vmp->vm_address = _vnamem_amalloc(&vmp->vm_allocator,
+		    MAX(length, 1))) == NULL) {
+	_vnacal_error(vcp, VNAERR_SYSTEM, "malloc: %s", strerror(errno));
+	goto out;
+    }
+    vmp->vm_length = (size_t)length;
+    if (fread(vmp->vm_address, 1, vmp->vm_length, fp) != vmp->vm_length) {
+	_vnacal_error(vcp, VNAERR_SYSTEM, "fread: %s: %s",
+		filename, ferror(fp) ? strerror(errno) : "short read");
+	goto out;
+    }
+    rc = 0;
+
+out:
+    (void)fclose(fp);
+    return rc;
+}
+
+/*
+ * open_image: map or read a binary calibration file
+ *   @vcp: vnacal structure
+ *
+ *   Return the image with one reference held by the caller.  The
+ *   mapping is private and writable so that stores into the error
+ *   terms never reach the file.  The data can be referenced in place
+ *   only if the host has the file's byte order; otherwise, read a
+ *   copy that the caller converts.
+ */
+static vnacal_map_t *open_image(vnacal_t *vcp)
+{
+    vnacal_map_t *vmp;
+
+    if ((vmp = _vnacal_calloc(vcp, 1, sizeof(vnacal_map_t))) == NULL) {
+	_vnacal_error(vcp, VNAERR_SYSTEM, "calloc: %s", strerror(errno));
+	return NULL;
+    }
+    vmp->vm_allocator = vcp->vc_allocator;
+    vmp->vm_references = 1;
+#ifdef VCB_CAN_MAP
+    if (_vnacommon_is_little_endian()) {
+	const char *filename = vcp->vc_filename;
+	struct stat st;
+	int fd;
+
+	if ((fd = open(filename, O_RDONLY)) == -1) {
+	    _vnacal_error(vcp, VNAERR_SYSTEM, "open: %s: %s",
+		    filename, strerror(errno));
+	    goto error;
+	}
+	if (fstat(fd, &st) == -1) {
+	    _vnacal_error(vcp, VNAERR_SYSTEM, "fstat: %s: %s",
+		    filename, strerror(errno));
+	    (void)close(fd);
+	    goto error;
+	}
+	if (st.st_size < VCB_HEADER_SIZE ||
+		(uint64_t)st.st_size > SIZE_MAX) {
+	    _vnacal_error(vcp, VNAERR_SYNTAX, "%s: error: "
+		    "not a binary calibration file", filename);
+	    (void)close(fd);
+	    goto error;
+	}
+	vmp->vm_length = (size_t)st.st_size;
+	vmp->vm_address = mmap(NULL, vmp->vm_length, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE, fd, 0);
+	(void)close(fd);
+	if (vmp->vm_address == MAP_FAILED) {
+	    vmp->vm_address = NULL;
+	    _vnacal_error(vcp, VNAERR_SYSTEM, "mmap: %s: %s",
+		    filename, strerror(errno));
+	    goto error;
+	}
+	vmp->vm_mapped = true;
+	return vmp;
+    }
+#endif
+    if (read_image(vcp, vmp) == -1) {
+	goto error;
+    }
+    return vmp;
+
+error:
+    _vnacal_map_release(vmp);
+    return NULL;
+}
+
+/*
+ * block_fits: test if a block lies within the file
+ *   @offset: offset of the block
+ *   @count: number of elements
+ *   @size: size of each element
+ *   @file_size: size of the file
+ */
+static bool block_fits(uint64_t offset, uint64_t count, size_t size,
+	uint64_t file_size)
+{
+    return offset <= file_size && count <= (file_size - offset) / size;
+}
+
+/*
+ * import_properties: parse an embedded YAML properties document
+ *   @vcp: vnacal structure
+ *   @rootptr: address of the properties root
+ *   @base: start of the image
+ *   @file_size: size of the image
+ *   @offset: offset of the document, or zero if none
+ *   @length: length of the document
+ */
+static int import_properties(vnacal_t *vcp, vnaproperty_t **rootptr,
+	const uint8_t *base, uint64_t file_size, uint64_t offset,
+	uint64_t length)
+{
+    if (offset == 0) {
+	return 0;
+    }
+    if (length == UINT64_MAX || !block_fits(offset, length + 1, 1,
+		file_size) || base[offset + length] != '\000') {
+	_vnacal_error(vcp, VNAERR_SYNTAX, "%s: error: "
+		"invalid properties block", vcp->vc_filename);
+	return -1;
+    }
+    if (_vnaproperty_import_yaml_from_string(&vcp->vc_allocator, rootptr,
+		(const char *)&base[offset], vcp->vc_error_fn,
+		vcp->vc_error_arg) == -1) {
+	return -1;
+    }
+    return 0;
+}
+
+/*
+ * load_models: copy the error term models of a compacted calibration
+ *   @vcp: vnacal structure
+ *   @calp: calibration to fill in
+ *   @base: start of the image
+ *   @file_size: size of the image
+ *   @offset: offset of the models block
+ *   @name: name of the calibration
+ */
+static int load_models(vnacal_t *vcp, vnacal_calibration_t *calp,
+	const uint8_t *base, uint64_t file_size, uint64_t offset,
+	const char *name)
+{
+    if ((calp->cal_error_term_model = _vnacal_calloc(vcp,
+		    calp->cal_error_terms, sizeof(vnacal_model_t))) == NULL) {
+	_vnacal_error(vcp, VNAERR_SYSTEM, "calloc: %s", strerror(errno));
+	return -1;
+    }
+    for (int term = 0; term < calp->cal_error_terms; ++term) {
+	vnacal_model_t *vmp = &calp->cal_error_term_model[term];
+	uint64_t segments, values;
+	double *dp;
+
+	if (!block_fits(offset, VCB_MODEL_HEADER_SIZE, 1, file_size)) {
+	    goto invalid;
+	}
+	segments = _vnacommon_get_u32(&base[offset]);
+	vmp->vm_fit_error = get_double(&base[offset + 8]);
+	offset += VCB_MODEL_HEADER_SIZE;
+	values = (segments + 1) + 2 * segments * VCB_COEFFICIENTS;
+	if (segments < 1 || segments > INT_MAX ||
+		!block_fits(offset, values, sizeof(double), file_size)) {
+	    goto invalid;
+	}
+	vmp->vm_segments = segments;
+	if ((vmp->vm_breakpoint_vector = _vnacal_malloc(vcp, (segments + 1) *
+			sizeof(double))) == NULL ||
+		(vmp->vm_coefficient_vector = _vnacal_malloc(vcp, segments *
+			sizeof(double complex [VCB_COEFFICIENTS]))) == NULL) {
+	    _vnacal_error(vcp, VNAERR_SYSTEM, "malloc: %s", strerror(errno));
+	    return -1;
+	}
+	for (uint64_t k = 0; k <= segments; ++k) {
+	    vmp->vm_breakpoint_vector[k] = get_double(&base[offset]);
+	    offset += sizeof(double);
+	    if (k > 0 && vmp->vm_breakpoint_vector[k] <
+		    vmp->vm_breakpoint_vector[k - 1]) {
+		goto invalid;
+	    }
+	}
+	dp = (double *)vmp->vm_coefficient_vector;
+	for (uint64_t i = 0; i < 2 * segments * VCB_COEFFICIENTS; ++i) {
+	    dp[i] = get_double(&base[offset]);
+	    offset += sizeof(double);
+	}
+    }
+    return 0;
+
+invalid:
+    _vnacal_error(vcp, VNAERR_SYNTAX, "%s: error: "
+	    "invalid error term models in calibration \"%s\"",
+	    vcp->vc_filename, name);
+    return -1;
+}
+
+/*
+ * load_calibration: add one calibration that refers into the image
+ *   @vcp: vnacal structure
+ *   @vmp: shared image
+ *   @vep: directory entry
+ *   @file_size: size of the file from the header
+ */
+static int load_calibration(vnacal_t *vcp, vnacal_map_t *vmp,
+	const vcb_entry_t *vep, uint64_t file_size)
+{
+    const char *filename = vcp->vc_filename;
+    uint8_t *base = vmp->vm_address;
+    const bool swap = !_vnacommon_is_little_endian();
+    const bool compacted = vep->ve_model_offset != 0;
+    vnacal_calibration_t *calp = NULL;
+    vnacal_layout_t vl;
+    vnacal_type_t type;
+    vnacal_z0_type_t z0_type;
+    uint64_t ports, frequencies, values;
+    const char *name;
+
+    /*
+     * Check the type and dimensions.
+     */
+    if (vep->ve_type > INT_MAX || vep->ve_rows < 1 || vep->ve_columns < 1 ||
+	    vep->ve_rows > INT_MAX || vep->ve_columns > INT_MAX ||
+	    vep->ve_frequencies > INT_MAX ||
+	    (uint64_t)vep->ve_rows * vep->ve_columns > INT_MAX ||
+	    vnacal_type_to_name((vnacal_type_t)vep->ve_type) == NULL) {
+	_vnacal_error(vcp, VNAERR_SYNTAX, "%s: error: "
+		"invalid calibration type or dimensions", filename);
+	return -1;
+    }
+    type = (vnacal_type_t)vep->ve_type;
+    _vnacal_layout(&vl, type, vep->ve_rows, vep->ve_columns);
+    if (vep->ve_error_terms != VL_ERROR_TERMS(&vl)) {
+	_vnacal_error(vcp, VNAERR_SYNTAX, "%s: error: "
+		"expected %d error terms but found %u", filename,
+		VL_ERROR_TERMS(&vl), (unsigned int)vep->ve_error_terms);
+	return -1;
+    }
+    switch (vep->ve_z0_type) {
+    case VNACAL_Z0_SCALAR:
+    case VNACAL_Z0_VECTOR:
+    case VNACAL_Z0_MATRIX:
+	z0_type = (vnacal_z0_type_t)vep->ve_z0_type;
+	break;
+
+    default:
+	_vnacal_error(vcp, VNAERR_SYNTAX, "%s: error: "
+		"invalid reference impedance type %u", filename,
+		(unsigned int)vep->ve_z0_type);
+	return -1;
+    }
+    if (vep->ve_interpolation > INT_MAX || vnacal_interpolation_to_name(
+		(vnacal_interpolation_t)vep->ve_interpolation) == NULL) {
+	_vnacal_error(vcp, VNAERR_SYNTAX, "%s: error: "
+		"invalid interpolation method %u", filename,
+		(unsigned int)vep->ve_interpolation);
+	return -1;
+    }
+    if (compacted && (!(vep->ve_compact_tolerance > 0.0) ||
+		isinf(vep->ve_compact_tolerance))) {
+	_vnacal_error(vcp, VNAERR_SYNTAX, "%s: error: "
+		"invalid compact tolerance %g", filename,
+		vep->ve_compact_tolerance);
+	return -1;
+    }
+
+    /*
+     * Check that the name and blocks are aligned and fit in the file.
+     */
+    ports = MAX(vep->ve_rows, vep->ve_columns);
+    frequencies = vep->ve_frequencies;
+    values = z0_values(z0_type, ports, frequencies);
+    if (!block_fits(vep->ve_name_offset, (uint64_t)vep->ve_name_length + 1,
+		1, file_size) ||
+	    base[vep->ve_name_offset + vep->ve_name_length] != '\000') {
+	_vnacal_error(vcp, VNAERR_SYNTAX, "%s: error: "
+		"invalid calibration name", filename);
+	return -1;
+    }
+    name = (const char *)&base[vep->ve_name_offset];
+    if (vep->ve_frequency_offset % sizeof(double complex) != 0 ||
+	    vep->ve_z0_offset % sizeof(double complex) != 0 ||
+	    vep->ve_error_term_offset % sizeof(double complex) != 0 ||
+	    vep->ve_model_offset % sizeof(double complex) != 0 ||
+	    !block_fits(vep->ve_frequency_offset, frequencies,
+		sizeof(double), file_size) ||
+	    !block_fits(vep->ve_z0_offset, values,
+		sizeof(double complex), file_size) ||
+	    (!compacted && frequencies != 0 &&
+	     !block_fits(vep->ve_error_term_offset, vep->ve_error_terms,
+		 frequencies * sizeof(double complex), file_size))) {
+	_vnacal_error(vcp, VNAERR_SYNTAX, "%s: error: "
+		"inconsistent block offsets in calibration \"%s\"",
+		filename, name);
+	return -1;
+    }
+
+    /*
+     * If the host byte order differs, convert the copy in place.
+     */
+    if (swap) {
+	_vnacommon_swap_doubles((double *)&base[vep->ve_frequency_offset],
+		frequencies);
+	_vnacommon_swap_doubles((double *)&base[vep->ve_z0_offset],
+		2 * values);
+	if (!compacted) {
+	    _vnacommon_swap_doubles((double *)
+		    &base[vep->ve_error_term_offset],
+		    2 * vep->ve_error_terms * frequencies);
+	}
+    }
+
+    /*
+     * Build the calibration structure, pointing into the image.
+     */
+    if ((calp = _vnacal_calloc(vcp, 1,
+		    sizeof(vnacal_calibration_t))) == NULL) {
+	_vnacal_error(vcp, VNAERR_SYSTEM, "calloc: %s", strerror(errno));
+	return -1;
+    }
+    calp->cal_vcp	  = vcp;
+    calp->cal_type	  = type;
+    calp->cal_rows	  = vep->ve_rows;
+    calp->cal_columns	  = vep->ve_columns;
+    calp->cal_frequencies = frequencies;
+    calp->cal_frequency_vector = (double *)&base[vep->ve_frequency_offset];
+    calp->cal_z0_type	  = z0_type;
+    calp->cal_interpolation = (vnacal_interpolation_t)vep->ve_interpolation;
+    calp->cal_map	  = vmp;
+    ++vmp->vm_references;
+    switch (z0_type) {
+    case VNACAL_Z0_SCALAR:
+	(void)memcpy((void *)&calp->cal_z0, (void *)&base[vep->ve_z0_offset],
+		sizeof(double complex));
+	break;
+
+    case VNACAL_Z0_VECTOR:
+	if ((calp->cal_z0_vector = _vnacal_malloc(vcp, ports *
+			sizeof(double complex))) == NULL) {
+	    _vnacal_error(vcp, VNAERR_SYSTEM, "malloc: %s", strerror(errno));
+	    goto error;
+	}
+	(void)memcpy((void *)calp->cal_z0_vector,
+		(void *)&base[vep->ve_z0_offset],
+		ports * sizeof(double complex));
+	break;
+
+    case VNACAL_Z0_MATRIX:
+	if ((calp->cal_z0_matrix = _vnacal_calloc(vcp, ports,
+			sizeof(double complex *))) == NULL) {
+	    _vnacal_error(vcp, VNAERR_SYSTEM, "calloc: %s", strerror(errno));
+	    goto error;
+	}
+	for (int port = 0; port < ports; ++port) {
+	    calp->cal_z0_matrix[port] = (double complex *)
+		&base[vep->ve_z0_offset +
+		port * frequencies * sizeof(double complex)];
+	}
+	break;
+
+    default:
+	abort();
+    }
+    calp->cal_error_terms = vep->ve_error_terms;
+    if (compacted) {
+	calp->cal_compact_tolerance = vep->ve_compact_tolerance;
+	if (load_models(vcp, calp, base, file_size, vep->ve_model_offset,
+		    name) == -1) {
+	    goto error;
+	}
+    } else {
+	if ((calp->cal_error_term_vector = _vnacal_calloc(vcp, 
+			calp->cal_error_terms,
+			sizeof(double complex *))) == NULL) {
+	    _vnacal_error(vcp, VNAERR_SYSTEM, "calloc: %s", strerror(errno));
+	    goto error;
+	}
+	for (int term = 0; term < calp->cal_error_terms; ++term) {
+	    calp->cal_error_term_vector[term] = (double complex *)
+		&base[vep->ve_error_term_offset +
+		term * frequencies * sizeof(double complex)];
+	}
+    }
+    if (import_properties(vcp, &calp->cal_properties, base, file_size,
+		vep->ve_properties_offset, vep->ve_properties_length) == -1) {
+	goto error;
+    }
+    for (int findex = 1; findex < calp->cal_frequencies; ++findex) {
+	if (calp->cal_frequency_vector[findex - 1] >=
+		calp->cal_frequency_vector[findex]) {
+	    _vnacal_error(vcp, VNAERR_SYNTAX, "%s: error: "
+		    "frequencies must be ascending in calibration \"%s\"",
+		    filename, name);
+	    goto error;
+	}
+    }
+    if (_vnacal_add_calibration_common("vnacal_load", vcp, calp,
+		name) == -1) {
+	goto error;
+    }
+    return 0;
+
+error:
+    _vnacal_calibration_free(calp);
+    return -1;
+}
+
+/*
+ * _vnacal_load_binary: load a binary calibration file
+ *   @vcp: vnacal structure with vc_filename set
+ *
+ *   The error terms, frequency vectors and per-frequency reference
+ *   impedances are not copied: the calibrations refer directly into
+ *   a mapping of the file, so that load time doesn't depend on the
+ *   size of the calibrations.
+ */
+int _vnacal_load_binary(vnacal_t *vcp)
+{
+    const char *filename = vcp->vc_filename;
+    vnacal_map_t *vmp;
+    const uint8_t *base;
+    vcb_header_t header;
+    int rc = -1;
+
+    if ((vmp = open_image(vcp)) == NULL) {
+	return -1;
+    }
+    base = vmp->vm_address;
+
+    /*
+     * Decode and check the header.
+     */
+    if (vmp->vm_length < VCB_HEADER_SIZE || memcmp((void *)base,
+		VNACAL_BINARY_MAGIC, VNACAL_BINARY_MAGIC_LENGTH) != 0) {
+	_vnacal_error(vcp, VNAERR_SYNTAX, "%s: error: "
+		"not a binary calibration file", filename);
+	goto out;
+    }
+    header.vh_version		= _vnacommon_get_u32(&base[ 8]);
+    header.vh_header_size	= _vnacommon_get_u32(&base[12]);
+    header.vh_calibrations	= _vnacommon_get_u32(&base[16]);
+    header.vh_entry_size	= _vnacommon_get_u32(&base[20]);
+    header.vh_fprecision	= (int32_t)_vnacommon_get_u32(&base[24]);
+    header.vh_dprecision	= (int32_t)_vnacommon_get_u32(&base[28]);
+    header.vh_properties_offset = _vnacommon_get_u64(&base[32]);
+    header.vh_properties_length = _vnacommon_get_u64(&base[40]);
+    header.vh_file_size		= _vnacommon_get_u64(&base[48]);
+    if (header.vh_version < 1 || header.vh_version > VCB_VERSION) {
+	_vnacal_error(vcp, VNAERR_VERSION, "%s: error: "
+		"unsupported binary calibration version %u",
+		filename, (unsigned int)header.vh_version);
+	goto out;
+    }
+    if (header.vh_file_size > vmp->vm_length) {
+	_vnacal_error(vcp, VNAERR_SYNTAX,
+		"%s: error: unexpected end of file", filename);
+	goto out;
+    }
+    if (header.vh_header_size < VCB_HEADER_SIZE ||
+	    header.vh_entry_size < VCB_ENTRY_SIZE ||
+	    !block_fits(header.vh_header_size, header.vh_calibrations,
+		header.vh_entry_size, header.vh_file_size)) {
+	_vnacal_error(vcp, VNAERR_SYNTAX, "%s: error: "
+		"invalid calibration directory", filename);
+	goto out;
+    }
+    if (header.vh_fprecision < 1 || header.vh_dprecision < 1) {
+	_vnacal_error(vcp, VNAERR_SYNTAX, "%s: error: "
+		"invalid precision", filename);
+	goto out;
+    }
+    vcp->vc_fprecision = header.vh_fprecision;
+    vcp->vc_dprecision = header.vh_dprecision;
+
+    /*
+     * Load the global properties and the calibrations.
+     */
+    if (import_properties(vcp, &vcp->vc_properties, base,
+		header.vh_file_size, header.vh_properties_offset,
+		header.vh_properties_length) == -1) {
+	goto out;
+    }
+    for (uint32_t i = 0; i < header.vh_calibrations; ++i) {
+	vcb_entry_t entry;
+
+	decode_entry(&base[header.vh_header_size +
+		(uint64_t)i * header.vh_entry_size], &entry);
+	if (load_calibration(vcp, vmp, &entry, header.vh_file_size) == -1) {
+	    goto out;
+	}
+    }
+    rc = 0;
+
+out:
+    _vnacal_map_release(vmp);
+    return rc;
+}
+
+/*
+ * vcb_writer_t: position tracking for sequential writes
+ */
+typedef struct vcb_writer {
+    FILE *vw_fp;
+    uint64_t vw_position;
+} vcb_writer_t;
+
+/*
+ * write_bytes: write bytes, tracking the position
+ *   @vwp: output state
+ *   @buffer: data to write
+ *   @length: number of bytes
+ */
+static int write_bytes(vcb_writer_t *vwp, const void *buffer, size_t length)
+{
+    if (length != 0 && fwrite(buffer, 1, length, vwp->vw_fp) != length) {
+	return -1;
+    }
+    vwp->vw_position += length;
+    return 0;
+}
+
+/*
+ * write_padding: write zero bytes up to the given offset
+ *   @vwp: output state
+ *   @offset: file offset of the next block
+ */
+static int write_padding(vcb_writer_t *vwp, uint64_t offset)
+{
+    static const uint8_t zeros[VCB_ALIGNMENT];
+
+    while (vwp->vw_position < offset) {
+	size_t length = MIN(offset - vwp->vw_position, sizeof(zeros));
+
+	if (write_bytes(vwp, (const void *)zeros, length) == -1) {
+	    return -1;
+	}
+    }
+    return 0;
+}
+
+/*
+ * write_doubles: write a vector of doubles little-endian
+ *   @vwp: output state
+ *   @vector: values to write
+ *   @count: number of doubles
+ */
+static int write_doubles(vcb_writer_t *vwp, const double *vector,
+	size_t count)
+{
+    double chunk[256];
+
+    if (_vnacommon_is_little_endian()) {
+	return write_bytes(vwp, (const void *)vector,
+		count * sizeof(double));
+    }
+    while (count != 0) {
+	size_t n = MIN(count, sizeof(chunk) / sizeof(double));
+
+	(void)memcpy((void *)chunk, (void *)vector, n * sizeof(double));
+	_vnacommon_swap_doubles(chunk, n);
+	if (write_bytes(vwp, (const void *)chunk,
+		    n * sizeof(double)) == -1) {
+	    return -1;
+	}
+	vector += n;
+	count -= n;
+    }
+    return 0;
+}
+
+/*
+ * write_models: write the models block of a compacted calibration
+ *   @vwp: output state
+ *   @calp: compacted calibration
+ */
+static int write_models(vcb_writer_t *vwp, const vnacal_calibration_t *calp)
+{
+    for (int term = 0; term < calp->cal_error_terms; ++term) {
+	const vnacal_model_t *vmp = &calp->cal_error_term_model[term];
+	uint8_t buffer[VCB_MODEL_HEADER_SIZE];
+
+	(void)memset((void *)buffer, 0, sizeof(buffer));
+	_vnacommon_put_u32(&buffer[0], vmp->vm_segments);
+	put_double(&buffer[8], vmp->vm_fit_error);
+	if (write_bytes(vwp, (const void *)buffer, sizeof(buffer)) == -1 ||
+		write_doubles(vwp, vmp->vm_breakpoint_vector,
+		    vmp->vm_segments + 1) == -1 ||
+		write_doubles(vwp, (const double *)vmp->vm_coefficient_vector,
+		    2 * vmp->vm_segments * VCB_COEFFICIENTS) == -1) {
+	    return -1;
+	}
+    }
+    return 0;
+}
+
+/*
+ * write_properties: append a NUL-terminated YAML properties document
+ *   @vcp: vnacal structure
+ *   @vwp: output state
+ *   @properties: properties to write
+ *   @offsetp: address to receive the offset, or zero if none
+ *   @lengthp: address to receive the length
+ */
+static int write_properties(vnacal_t *vcp, vcb_writer_t *vwp,
+	const vnaproperty_t *properties, uint64_t *offsetp,
+	uint64_t *lengthp)
+{
+    long end;
+
+    *offsetp = 0;
+    *lengthp = 0;
+    if (properties == NULL) {
+	return 0;
+    }
+    if (vnaproperty_export_yaml_to_file(properties, vwp->vw_fp,
+		vcp->vc_filename, vcp->vc_error_fn, vcp->vc_error_arg) == -1) {
+	return -1;
+    }
+    if ((end = ftell(vwp->vw_fp)) == -1) {
+	_vnacal_error(vcp, VNAERR_SYSTEM, "ftell: %s: %s",
+		vcp->vc_filename, strerror(errno));
+	return -1;
+    }
+    *offsetp = vwp->vw_position;
+    *lengthp = (uint64_t)end - vwp->vw_position;
+    vwp->vw_position = (uint64_t)end;
+    if (write_bytes(vwp, "", 1) == -1) {
+	_vnacal_error(vcp, VNAERR_SYSTEM, "fwrite: %s: %s",
+		vcp->vc_filename, strerror(errno));
+	return -1;
+    }
+    return 0;
+}
+
+/*
+ * _vnacal_save_binary: save in binary calibration format
+ *   @vcp: vnacal structure with vc_filename set
+ *   @fp: seekable file pointer positioned at the start of the file
+ *
+ *   Lay out the names and data blocks, write them, append the YAML
+ *   properties, whose lengths aren't known in advance, and finally
+ *   go back and write the header and directory.
+ */
+int _vnacal_save_binary(vnacal_t *vcp, FILE *fp)
+{
+    const char *filename = vcp->vc_filename;
+    vcb_header_t header;
+    vcb_entry_t *entries = NULL;
+    vnacal_calibration_t **calibrations = NULL;
+    vcb_writer_t vw;
+    uint8_t buffer[MAX(VCB_HEADER_SIZE, VCB_ENTRY_SIZE)];
+    uint64_t offset;
+    int count = 0;
+    int rc = -1;
+
+    /*
+     * Collect the calibrations.
+     */
+    for (int ci = 0; ci < vcp->vc_calibration_allocation; ++ci) {
+	if (vcp->vc_calibration_vector[ci] != NULL) {
+	    ++count;
+	}
+    }
+    if ((entries = _vnacal_calloc(vcp, MAX(count, 1),
+		    sizeof(vcb_entry_t))) == NULL ||
+	    (calibrations = _vnacal_calloc(vcp, MAX(count, 1),
+		    sizeof(vnacal_calibration_t *))) == NULL) {
+	_vnacal_error(vcp, VNAERR_SYSTEM, "calloc: %s", strerror(errno));
+	goto out;
+    }
+    count = 0;
+    for (int ci = 0; ci < vcp->vc_calibration_allocation; ++ci) {
+	if (vcp->vc_calibration_vector[ci] != NULL) {
+	    calibrations[count++] = vcp->vc_calibration_vector[ci];
+	}
+    }
+
+    /*
+     * Lay out the file up to the properties.
+     */
+    (void)memset((void *)&header, 0, sizeof(header));
+    header.vh_version	  = 1;
+    header.vh_header_size = VCB_HEADER_SIZE;
+    header.vh_calibrations = count;
+    header.vh_entry_size  = VCB_ENTRY_SIZE;
+    header.vh_fprecision  = vcp->vc_fprecision;
+    header.vh_dprecision  = vcp->vc_dprecision;
+    offset = VCB_HEADER_SIZE + (uint64_t)count * VCB_ENTRY_SIZE;
+    for (int i = 0; i < count; ++i) {
+	const vnacal_calibration_t *calp = calibrations[i];
+	vcb_entry_t *vep = &entries[i];
+
+	vep->ve_name_offset = offset;
+	vep->ve_name_length = strlen(calp->cal_name);
+	offset += vep->ve_name_length + 1;
+    }
+    for (int i = 0; i < count; ++i) {
+	const vnacal_calibration_t *calp = calibrations[i];
+	vcb_entry_t *vep = &entries[i];
+	uint64_t ports = MAX(calp->cal_rows, calp->cal_columns);
+	uint64_t frequencies = calp->cal_frequencies;
+
+	vep->ve_type		  = calp->cal_type;
+	vep->ve_rows		  = calp->cal_rows;
+	vep->ve_columns		  = calp->cal_columns;
+	vep->ve_frequencies	  = calp->cal_frequencies;
+	vep->ve_z0_type		  = calp->cal_z0_type;
+	vep->ve_error_terms	  = calp->cal_error_terms;
+	vep->ve_interpolation	  = calp->cal_interpolation;
+	if (calp->cal_interpolation != VNACAL_INTERP_RATIONAL ||
+		calp->cal_error_term_model != NULL) {
+	    header.vh_version = VCB_VERSION;
+	}
+	vep->ve_frequency_offset  = VCB_ALIGN(offset);
+	vep->ve_z0_offset	  = VCB_ALIGN(vep->ve_frequency_offset +
+		frequencies * sizeof(double));
+	offset = VCB_ALIGN(vep->ve_z0_offset +
+		z0_values(calp->cal_z0_type, ports, frequencies) *
+		sizeof(double complex));
+	if (calp->cal_error_term_model != NULL) {
+	    vep->ve_compact_tolerance = calp->cal_compact_tolerance;
+	    vep->ve_model_offset      = offset;
+	    offset += models_size(calp);
+	} else {
+	    vep->ve_error_term_offset = offset;
+	    offset += (uint64_t)calp->cal_error_terms * frequencies *
+		sizeof(double complex);
+	}
+    }
+
+    /*
+     * Write a placeholder header and directory, the names and the
+     * data blocks.
+     */
+    (void)memset((void *)&vw, 0, sizeof(vw));
+    vw.vw_fp = fp;
+    if (write_padding(&vw, VCB_HEADER_SIZE +
+		(uint64_t)count * VCB_ENTRY_SIZE) == -1) {
+	goto write_error;
+    }
+    for (int i = 0; i < count; ++i) {
+	if (write_bytes(&vw, (const void *)calibrations[i]->cal_name,
+		    entries[i].ve_name_length + 1) == -1) {
+	    goto write_error;
+	}
+    }
+    for (int i = 0; i < count; ++i) {
+	const vnacal_calibration_t *calp = calibrations[i];
+	const vcb_entry_t *vep = &entries[i];
+	const int ports = MAX(calp->cal_rows, calp->cal_columns);
+	const int frequencies = calp->cal_frequencies;
+
+	if (write_padding(&vw, vep->ve_frequency_offset) == -1 ||
+		write_doubles(&vw, calp->cal_frequency_vector,
+		    frequencies) == -1 ||
+		write_padding(&vw, vep->ve_z0_offset) == -1) {
+	    goto write_error;
+	}
+	switch (calp->cal_z0_type) {
+	case VNACAL_Z0_SCALAR:
+	    if (write_doubles(&vw, (const double *)&calp->cal_z0, 2) == -1) {
+		goto write_error;
+	    }
+	    break;
+
+	case VNACAL_Z0_VECTOR:
+	    if (write_doubles(&vw, (const double *)calp->cal_z0_vector,
+			2 * ports) == -1) {
+		goto write_error;
+	    }
+	    break;
+
+	case VNACAL_Z0_MATRIX:
+	    for (int port = 0; port < ports; ++port) {
+		if (write_doubles(&vw, (const double *)
+			    calp->cal_z0_matrix[port],
+			    2 * frequencies) == -1) {
+		    goto write_error;
+		}
+	    }
+	    break;
+
+	default:
+	    abort();
+	}
+	if (calp->cal_error_term_model != NULL) {
+	    if (write_padding(&vw, vep->ve_model_offset) == -1 ||
+		    write_models(&vw, calp) == -1) {
+		goto write_error;
+	    }
+	    continue;
+	}
+	if (write_padding(&vw, vep->ve_error_term_offset) == -1) {
+	    goto write_error;
+	}
+	for (int term = 0; term < calp->cal_error_terms; ++term) {
+	    if (write_doubles(&vw, (const double *)
+			calp->cal_error_term_vector[term],
+			2 * frequencies) == -1) {
+		goto write_error;
+	    }
+	}
+    }
+    assert(vw.vw_position == offset);
+
+    /*
+     * Append the properties.
+     */
+    if (fflush(fp) == EOF) {
+	goto write_error;
+    }
+    if (write_properties(vcp, &vw, vcp->vc_properties,
+		&header.vh_properties_offset,
+		&header.vh_properties_length) == -1) {
+	goto out;
+    }
+    for (int i = 0; i < count; ++i) {
+	if (write_properties(vcp, &vw, calibrations[i]->cal_properties,
+		    &entries[i].ve_properties_offset,
+		    &entries[i].ve_properties_length) == -1) {
+	    goto out;
+	}
+    }
+    header.vh_file_size = vw.vw_position;
+
+    /*
+     * Go back and write the header and directory.
+     */
+    if (fseek(fp, 0L, SEEK_SET) == -1) {
+	_vnacal_error(vcp, VNAERR_SYSTEM, "fseek: %s: %s",
+		filename, strerror(errno));
+	goto out;
+    }
+    encode_header(&header, buffer);
+    if (fwrite((void *)buffer, 1, VCB_HEADER_SIZE, fp) != VCB_HEADER_SIZE) {
+	goto write_error;
+    }
+    for (int i = 0; i < count; ++i) {
+	encode_entry(&entries[i], buffer);
+	if (fwrite((void *)buffer, 1, VCB_ENTRY_SIZE,
+		    fp) != VCB_ENTRY_SIZE) {
+	    goto write_error;
+	}
+    }
+    if (fflush(fp) == EOF) {
+	goto write_error;
+    }
+    rc = 0;
+    goto out;
+
+write_error:
+    _vnacal_error(vcp, VNAERR_SYSTEM, "fwrite: %s: %s",
+	    filename, strerror(errno));
+out:
+    _vnacal_free(vcp, (void *)calibrations);
+    _vnacal_free(vcp, (void *)entries);
+    return rc;
+}
@@ -52,7 +52,8 @@ static int make_error_term_matrix(vnacal_calibration_t *calp,
     vnacal_error_term_matrix_t *vetmp = NULL;
 
     assert(type != VETM_VECTOR || rows == 1);
-    if ((vetmp = malloc(sizeof(vnacal_error_term_matrix_t))) == NULL) {
+    if ((vetmp = _vnacal_malloc(vcp,
+		    sizeof(vnacal_error_term_matrix_t))) == NULL) {
 	_vnacal_error(vcp, VNAERR_SYSTEM, "malloc: %s", strerror(errno));
 	goto error;
     }
@@ -60,7 +61,7 @@ static int make_error_term_matrix(vnacal_calibration_t *calp,
     vetmp->vetm_calp = calp;
     vetmp->vetm_type = type;
     vetmp->vetm_name = name;
-    if ((vetmp->vetm_matrix = calloc(cells,
+    if ((vetmp->vetm_matrix = _vnacal_calloc(vcp, cells,
 		    sizeof(double complex *))) == NULL) {
 	_vnacal_error(vcp, VNAERR_SYSTEM, "calloc: %s", strerror(errno));
 	goto error;
@@ -75,7 +76,7 @@ static int make_error_term_matrix(vnacal_calibration_t *calp,
     return 0;
 
 error:
-    _vnacal_free_error_term_matrices(&vetmp);
+    _vnacal_free_error_term_matrices(vcp, &vetmp);
     return -1;
 }
 
@@ -375,22 +376,24 @@ int _vnacal_build_error_term_list(vnacal_calibration_t *calp,
 
 out:
     if (rc == -1) {
-	_vnacal_free_error_term_matrices(head);
+	_vnacal_free_error_term_matrices(calp->cal_vcp, head);
     }
     return rc;
 }
 
 /*
  * _vnacal_free_error_term_matrices: free the memory for an error term matrix
+ *   @vcp: vnacal structure
  *   @vetmp: error term matrix structure
  */
-void _vnacal_free_error_term_matrices(vnacal_error_term_matrix_t **vetmpp)
+void _vnacal_free_error_term_matrices(const vnacal_t *vcp,
+	vnacal_error_term_matrix_t **vetmpp)
 {
     vnacal_error_term_matrix_t *vetmp;
 
     while ((vetmp = *vetmpp) != NULL) {
 	*vetmpp = vetmp->vetm_next;
-	free((void *)vetmp->vetm_matrix);
-	free((void *)vetmp);
+	_vnacal_free(vcp, (void *)vetmp->vetm_matrix);
+	_vnacal_free(vcp, (void *)vetmp);
     }
 }
@@ -47,7 +47,7 @@ vnacal_calibration_t *_vnacal_calibration_alloc(vnacal_t *vcp,
     const int ports = MAX(rows, columns);
     vnacal_calibration_t *calp;
 
-    calp = (vnacal_calibration_t *)malloc(sizeof(vnacal_calibration_t));
+    calp = _vnacal_malloc(vcp, sizeof(vnacal_calibration_t));
     if (calp == NULL) {
 	_vnacal_error(vcp, VNAERR_SYSTEM,
 		"malloc: %s", strerror(errno));
@@ -59,7 +59,8 @@ vnacal_calibration_t *_vnacal_calibration_alloc(vnacal_t *vcp,
     calp->cal_rows = rows;
     calp->cal_columns = columns;
     calp->cal_frequencies = frequencies;
-    calp->cal_frequency_vector = calloc(frequencies, sizeof(double));
+    calp->cal_frequency_vector = _vnacal_calloc(vcp, frequencies,
+	    sizeof(double));
     if (calp->cal_frequency_vector == NULL) {
 	_vnacal_error(vcp, VNAERR_SYSTEM, "calloc: %s", strerror(errno));
 	goto error;
@@ -70,7 +71,7 @@ vnacal_calibration_t *_vnacal_calibration_alloc(vnacal_t *vcp,
 	break;
 
     case VNACAL_Z0_VECTOR:
-	if ((calp->cal_z0_vector = calloc(ports,
+	if ((calp->cal_z0_vector = _vnacal_calloc(vcp, ports,
 			sizeof(double complex))) == NULL) {
 	    _vnacal_error(vcp, VNAERR_SYSTEM, "calloc: %s", strerror(errno));
 	    goto error;
@@ -78,13 +79,13 @@ vnacal_calibration_t *_vnacal_calibration_alloc(vnacal_t *vcp,
 	break;
 
     case VNACAL_Z0_MATRIX:
-	if ((calp->cal_z0_matrix = calloc(ports,
+	if ((calp->cal_z0_matrix = _vnacal_calloc(vcp, ports,
 			sizeof(double complex *))) == NULL) {
 	    _vnacal_error(vcp, VNAERR_SYSTEM, "calloc: %s", strerror(errno));
 	    goto error;
 	}
 	for (int port = 0; port < ports; ++port) {
-	    if ((calp->cal_z0_matrix[port] = calloc(frequencies,
+	    if ((calp->cal_z0_matrix[port] = _vnacal_calloc(vcp, frequencies,
 			    sizeof(double complex))) == NULL) {
 		_vnacal_error(vcp, VNAERR_SYSTEM,
 			"calloc: %s", strerror(errno));
@@ -96,15 +97,16 @@ vnacal_calibration_t *_vnacal_calibration_alloc(vnacal_t *vcp,
     default:
 	abort();
     }
-    calp->cal_error_term_vector = calloc(error_terms, sizeof(double complex *));
+    calp->cal_error_term_vector = _vnacal_calloc(vcp, error_terms,
+	    sizeof(double complex *));
     if (calp->cal_error_term_vector == NULL) {
 	_vnacal_error(vcp, VNAERR_SYSTEM, "calloc: %s", strerror(errno));
 	goto error;
     }
     calp->cal_error_terms = error_terms;
     for (int term = 0; term < error_terms; ++term) {
-	if ((calp->cal_error_term_vector[term] = calloc(frequencies,
-			sizeof(double complex))) == NULL) {
+	if ((calp->cal_error_term_vector[term] = _vnacal_calloc(vcp,
+			frequencies, sizeof(double complex))) == NULL) {
 	    _vnacal_error(vcp, VNAERR_SYSTEM, "calloc: %s", strerror(errno));
 	    goto error;
 	}
@@ -135,6 +137,28 @@ double _vnacal_calibration_get_fmax_bound(const vnacal_calibration_t *calp)
 	calp->cal_frequency_vector[calp->cal_frequencies - 1];
 }
 
+/*
+ * _vnacal_calibration_free_error_terms: discard the error term vectors
+ *   @calp: pointer to calibration structure
+ *
+ *   Used once the error terms are represented by models.
+ */
+void _vnacal_calibration_free_error_terms(vnacal_calibration_t *calp)
+{
+    const vnacal_t *vcp = calp->cal_vcp;
+
+    _vnacal_spline_free_vector(&vcp->vc_allocator,
+	    calp->cal_error_term_spline, calp->cal_error_terms);
+    calp->cal_error_term_spline = NULL;
+    if (calp->cal_error_term_vector != NULL && calp->cal_map == NULL) {
+	for (int term = 0; term < calp->cal_error_terms; ++term) {
+	    _vnacal_free(vcp, (void *)calp->cal_error_term_vector[term]);
+	}
+    }
+    _vnacal_free(vcp, (void *)calp->cal_error_term_vector);
+    calp->cal_error_term_vector = NULL;
+}
+
 /*
  * _vnacal_calibration_free: free the memory for a vnacal_calibration_t
  *   @calp: pointer to calibration structure
@@ -142,33 +166,49 @@ double _vnacal_calibration_get_fmax_bound(const vnacal_calibration_t *calp)
 void _vnacal_calibration_free(vnacal_calibration_t *calp)
 {
     if (calp != NULL) {
+	const vnacal_t *vcp = calp->cal_vcp;
+	const bool mapped = calp->cal_map != NULL;
+
 	(void)vnaproperty_delete(&calp->cal_properties, ".");
-	for (int term = 0; term < calp->cal_error_terms; ++term) {
-	    free((void *)calp->cal_error_term_vector[term]);
+	_vnacal_spline_free_vector(&vcp->vc_allocator,
+		calp->cal_error_term_spline, calp->cal_error_terms);
+	_vnacal_spline_free_vector(&vcp->vc_allocator, calp->cal_z0_spline,
+		MAX(calp->cal_rows, calp->cal_columns));
+	_vnacal_model_free_vector(&vcp->vc_allocator,
+		calp->cal_error_term_model, calp->cal_error_terms);
+	if (calp->cal_error_term_vector != NULL && !mapped) {
+	    for (int term = 0; term < calp->cal_error_terms; ++term) {
+		_vnacal_free(vcp, (void *)calp->cal_error_term_vector[term]);
+	    }
 	}
 	switch (calp->cal_z0_type) {
 	case VNACAL_Z0_SCALAR:
 	    break;
 	case VNACAL_Z0_VECTOR:
-	    free((void *)calp->cal_z0_vector);
+	    _vnacal_free(vcp, (void *)calp->cal_z0_vector);
 	    break;
 	case VNACAL_Z0_MATRIX:
 	    if (calp->cal_z0_matrix != NULL) {
 		const int ports = MAX(calp->cal_rows, calp->cal_columns);
 
-		for (int port = 0; port < ports; ++port) {
-		    free((void *)calp->cal_z0_matrix[port]);
+		for (int port = 0; port < ports && !mapped; ++port) {
+		    _vnacal_free(vcp, (void *)calp->cal_z0_matrix[port]);
 		}
-		free((void *)calp->cal_z0_matrix);
+		_vnacal_free(vcp, (void *)calp->cal_z0_matrix);
 	    }
 	    break;
 	default:
 	    abort();
 	}
-	free((void *)calp->cal_error_term_vector);
-	free((void *)calp->cal_frequency_vector);
-	free((void *)calp->cal_name);
-	free((void *)calp);
+	_vnacal_free(vcp, (void *)calp->cal_error_term_vector);
+	if (!mapped) {
+	    _vnacal_free(vcp, (void *)calp->cal_frequency_vector);
+	} else {
+	    _vnacal_map_release(calp->cal_map);
+	}
+	_vnacal_free(vcp, (void *)calp->cal_deferred);
+	_vnacal_free(vcp, (void *)calp->cal_name);
+	_vnacal_free(vcp, (void *)calp);
     }
 }
 
@@ -230,7 +270,7 @@ int _vnacal_add_calibration_common(const char *function, vnacal_t *vcp,
 		new_allocation = 2 * vcp->vc_calibration_allocation;
 		break;
 	    }
-	    calpp = realloc(vcp->vc_calibration_vector,
+	    calpp = _vnacal_realloc(vcp, vcp->vc_calibration_vector,
 		    new_allocation * sizeof(vnacal_calibration_t *));
 	    if (calpp == NULL) {
 		_vnacal_error(vcp, VNAERR_SYSTEM, "realloc: %s",
@@ -245,11 +285,21 @@ int _vnacal_add_calibration_common(const char *function, vnacal_t *vcp,
 	}
     }
 
+    /*
+     * If a loader set the spline method, build the spline cache.
+     */
+    if (calp->cal_deferred == NULL &&
+	    calp->cal_interpolation == VNACAL_INTERP_SPLINE &&
+	    _vnacal_calibration_set_interpolation(function, calp,
+		calp->cal_interpolation) == -1) {
+	return -1;
+    }
+
     /*
      * Fill in the calibration name.
      */
     assert(calp->cal_name == NULL);
-    if ((calp->cal_name = strdup(name)) == NULL) {
+    if ((calp->cal_name = _vnacal_strdup(vcp, name)) == NULL) {
 	_vnacal_error(vcp, VNAERR_SYSTEM,
 		"strdup: %s", strerror(errno));
 	return -1;
@@ -0,0 +1,133 @@
+/*
+ * Vector Network Analyzer Library
+ * Copyright © 2020-2024 D Scott Guthridge <scott_guthridge@rompromity.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "archdep.h"
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "vnacal_internal.h"
+
+
+/*
+ * _vnacal_calibration_compact: replace the error terms with models
+ *   @function: name of user-called function
+ *   @calp: pointer to calibration structure
+ *   @tolerance: largest magnitude of fit error allowed
+ *
+ *   On success, the error term vectors are freed: the models become
+ *   the only representation of the error terms.
+ */
+int _vnacal_calibration_compact(const char *function,
+	vnacal_calibration_t *calp, double tolerance)
+{
+    vnacal_t *vcp = calp->cal_vcp;
+    vnacal_model_t *model_vector = NULL;
+
+    if (!(tolerance > 0.0) || isinf(tolerance)) {
+	_vnacal_error(vcp, VNAERR_USAGE, "%s: invalid tolerance %g",
+		function, tolerance);
+	return -1;
+    }
+    if (calp->cal_error_term_model != NULL) {
+	_vnacal_error(vcp, VNAERR_USAGE, "%s: "
+		"calibration has already been compacted", function);
+	return -1;
+    }
+    if (calp->cal_frequencies < 1) {
+	_vnacal_error(vcp, VNAERR_USAGE, "%s: "
+		"calibration has no frequencies", function);
+	return -1;
+    }
+    if ((model_vector = _vnacal_calloc(vcp, calp->cal_error_terms,
+		    sizeof(vnacal_model_t))) == NULL) {
+	_vnacal_error(vcp, VNAERR_SYSTEM, "calloc: %s", strerror(errno));
+	return -1;
+    }
+    for (int term = 0; term < calp->cal_error_terms; ++term) {
+	if (_vnacal_model_fit(&vcp->vc_allocator,
+		    calp->cal_frequency_vector,
+		    calp->cal_error_term_vector[term],
+		    calp->cal_frequencies, tolerance,
+		    &model_vector[term]) == -1) {
+	    _vnacal_error(vcp, VNAERR_SYSTEM, "malloc: %s",
+		    strerror(errno));
+	    _vnacal_model_free_vector(&vcp->vc_allocator, model_vector,
+		    calp->cal_error_terms);
+	    return -1;
+	}
+    }
+    calp->cal_error_term_model = model_vector;
+    calp->cal_compact_tolerance = tolerance;
+    _vnacal_calibration_free_error_terms(calp);
+    return 0;
+}
+
+/*
+ * vnacal_compact: replace interpolation with piecewise polynomial models
+ *   @vcp: pointer returned from vnacal_create or vnacal_load
+ *   @ci: calibration index
+ *   @tolerance: largest magnitude of fit error allowed
+ */
+int vnacal_compact(vnacal_t *vcp, int ci, double tolerance)
+{
+    vnacal_calibration_t *calp;
+
+    if ((calp = _vnacal_get_calibration(__func__, vcp, ci)) == NULL) {
+	return -1;
+    }
+    return _vnacal_calibration_compact(__func__, calp, tolerance);
+}
+
+/*
+ * vnacal_get_fit_error: return the fit error of each error term model
+ *   @vcp: pointer returned from vnacal_create or vnacal_load
+ *   @ci: calibration index
+ *   @vector: caller-provided buffer to receive the result
+ *   @max_entries: number of double entries in vector
+ *
+ * Return:
+ *   number of error terms (number of entries placed into vector), or
+ *   -1 on error
+ */
+int vnacal_get_fit_error(const vnacal_t *vcp, int ci, double *vector,
+	int max_entries)
+{
+    const vnacal_calibration_t *calp;
+
+    if ((calp = _vnacal_get_calibration(__func__, vcp, ci)) == NULL) {
+	return -1;
+    }
+    if (calp->cal_error_term_model == NULL) {
+	_vnacal_error(vcp, VNAERR_USAGE, "%s: "
+		"calibration has not been compacted", __func__);
+	return -1;
+    }
+    if (calp->cal_error_terms > max_entries) {
+	_vnacal_error(vcp, VNAERR_USAGE, "%s: "
+		"result vector must have space for at least %d entries",
+		__func__, calp->cal_error_terms);
+	return -1;
+    }
+    for (int term = 0; term < calp->cal_error_terms; ++term) {
+	vector[term] = calp->cal_error_term_model[term].vm_fit_error;
+    }
+    return calp->cal_error_terms;
+}
@@ -32,16 +32,39 @@
  *   @function: name of user-called function
  *   @error_fn: optional error reporting function (NULL if not used)
  *   @error_arg: user data passed through to the error function (or NULL)
+ *   @allocator: allocator to use, or NULL for the global allocator
  */
 vnacal_t *_vnacal_alloc(const char *function,
-	vnaerr_error_fn_t *error_fn, void *error_arg)
+	vnaerr_error_fn_t *error_fn, void *error_arg,
+	const vnamem_allocator_t *allocator)
 {
+    vnamem_allocator_t copy;
     vnacal_t *vcp;
 
     /*
-     * Allocate the vnacal_t.
+     * Allocate the vnacal_t from the given or current global allocator
+     * and remember the allocator so that everything the structure owns
+     * is freed through it, even if the global allocator changes.
      */
-    if ((vcp = (vnacal_t *)malloc(sizeof(vnacal_t))) == NULL) {
+    if (allocator == NULL) {
+	vnamem_get_allocator(&copy);
+    } else if (allocator->vma_alloc == NULL ||
+	    allocator->vma_realloc == NULL || allocator->vma_free == NULL) {
+	if (error_fn != NULL) {
+	    char message[80];
+
+	    (void)snprintf(message, sizeof(message),
+		    "%s: invalid allocator", function);
+	    message[sizeof(message)-1] = '\000';
+	    (*error_fn)(message, error_arg, VNAERR_USAGE);
+	}
+	errno = EINVAL;
+	return NULL;
+    } else {
+	copy = *allocator;
+    }
+    if ((vcp = (vnacal_t *)_vnamem_amalloc(&copy,
+		    sizeof(vnacal_t))) == NULL) {
 	if (error_fn != NULL) {
 	    int saved_errno = errno;
 	    char message[80];
@@ -57,6 +80,7 @@ vnacal_t *_vnacal_alloc(const char *function,
     }
     (void)memset((void *)vcp, 0, sizeof(vnacal_t));
     vcp->vc_magic = VC_MAGIC;
+    vcp->vc_allocator = copy;
     vcp->vc_error_fn = error_fn;
     vcp->vc_error_arg = error_arg;
     if (_vnacal_setup_parameter_collection(function, vcp) == -1) {
@@ -79,5 +103,18 @@ vnacal_t *_vnacal_alloc(const char *function,
  */
 vnacal_t *vnacal_create(vnaerr_error_fn_t *error_fn, void *error_arg)
 {
-    return _vnacal_alloc("vnacal_create", error_fn, error_arg);
+    return _vnacal_alloc("vnacal_create", error_fn, error_arg, NULL);
+}
+
+/*
+ * vnacal_create_with_allocator: create a calibration with its own allocator
+ *   @error_fn: optional error reporting function (NULL if not used)
+ *   @error_arg: user data passed through to the error function (or NULL)
+ *   @allocator: allocator to use, or NULL for the global allocator
+ */
+vnacal_t *vnacal_create_with_allocator(vnaerr_error_fn_t *error_fn,
+	void *error_arg, const vnamem_allocator_t *allocator)
+{
+    return _vnacal_alloc("vnacal_create_with_allocator", error_fn,
+	    error_arg, allocator);
 }
@@ -46,7 +46,7 @@ int vnacal_eval_parameter_matrix(vnacal_t *vcp,
     vnacal_parameter_matrix_map_t *vpmmp = NULL;
     int rc = -1;
 
-    matrix = calloc(rows * columns, sizeof(vnacal_parameter_t *));
+    matrix = _vnacal_calloc(vcp, rows * columns, sizeof(vnacal_parameter_t *));
     if (matrix == NULL) {
 	_vnacal_error(vcp, VNAERR_SYSTEM, "calloc: %s", strerror(errno));
 	goto out;
@@ -69,6 +69,6 @@ int vnacal_eval_parameter_matrix(vnacal_t *vcp,
 
 out:
     _vnacal_free_parameter_matrix_map(vpmmp);
-    free((void *)matrix);
+    _vnacal_free(vcp, (void *)matrix);
     return rc;
 }
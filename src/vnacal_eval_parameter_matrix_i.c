@@ -28,6 +28,7 @@
 #include <string.h>
 #include "vnacal_internal.h"
 #include "vnaconv.h"
+#include "vnastats_internal.h"
 
 /*
  * calc_tline_coefficients0: calc Zc, gl (classic version)
@@ -300,6 +301,7 @@ static int eval_data_standard(const char *function,
     double complex *zd_vector;
     double complex zd_temp[ports];
     int segment = vdsp->vds_segment;
+    vnacal_interp_point_t point;
 
     /*
      * Test if frequency is in bounds.
@@ -314,12 +316,15 @@ static int eval_data_standard(const char *function,
     }
 
     /*
-     * Copy the data matrix, interpolating as necessary.
+     * Copy the data matrix, interpolating as necessary.  All cells
+     * share the same interpolation window.
      */
+    _vnacal_interp_setup_point(vdsp->vds_interpolation, frequency_vector,
+	    frequencies, &segment, frequency, &point);
     for (int cell = 0; cell < ports * ports; ++cell) {
-	result_matrix[cell] = _vnacal_rfi(frequency_vector,
-		vdsp->vds_data[cell], frequencies,
-		MIN(frequencies, VNACAL_MAX_M), &segment, frequency);
+	result_matrix[cell] = _vnacal_interp_eval_point(&point,
+		vdsp->vds_data[cell], vdsp->vds_data_spline != NULL ?
+		vdsp->vds_data_spline[cell] : NULL);
     }
 
     /*
@@ -330,9 +335,10 @@ static int eval_data_standard(const char *function,
 	zd_vector = vdsp->u.vds_z0_vector;
     } else {
 	for (int port = 0; port < ports; ++port) {
-	    zd_temp[port] = _vnacal_rfi(frequency_vector,
-		    vdsp->u.vds_z0_vector_vector[port], frequencies,
-		    MIN(frequencies, VNACAL_MAX_M), &segment, frequency);
+	    zd_temp[port] = _vnacal_interp_eval_point(&point,
+		    vdsp->u.vds_z0_vector_vector[port],
+		    vdsp->vds_z0_spline != NULL ?
+		    vdsp->vds_z0_spline[port] : NULL);
 	}
 	zd_vector = zd_temp;
     }
@@ -362,6 +368,8 @@ int _vnacal_eval_parameter_matrix_i(const char *function,
     int rows = vpmmp->vpmm_rows;
     int columns = vpmmp->vpmm_columns;
 
+    _VNASTATS_ADD(_vnacal_stats, vcs_eval_parameter_calls, 1);
+
     /*
      * Init result matrix to all zeros.
      */
@@ -487,6 +495,7 @@ int _vnacal_eval_parameter_matrix_i(const char *function,
 	    {
 		double fmin, fmax;
 		double lower, upper;
+		vnacal_interp_point_t point;
 
 		assert(vpmrp->vpmr_frequency_vector != NULL);
 		fmin = vpmrp->vpmr_frequency_vector[0];
@@ -499,12 +508,14 @@ int _vnacal_eval_parameter_matrix_i(const char *function,
 			    function, frequency, fmin, fmax);
 		    return -1;
 		}
-		value = _vnacal_rfi(vpmrp->vpmr_frequency_vector,
+		_vnacal_interp_setup_point(vpmrp->vpmr_interpolation,
+			vpmrp->vpmr_frequency_vector,
+			vpmrp->vpmr_frequencies, &vpmrp->vpmr_segment,
+			frequency, &point);
+		value = _vnacal_interp_eval_point(&point,
 			vpmrp->vpmr_coefficient_vector,
-			vpmrp->vpmr_frequencies,
-			MIN(vpmrp->vpmr_frequencies, VNACAL_MAX_M),
-			&vpmrp->vpmr_segment,
-			frequency);
+			vpmrp->vpmr_spline != NULL ?
+			vpmrp->vpmr_spline[0] : NULL);
 	    }
 	    break;
 
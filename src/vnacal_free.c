@@ -37,17 +37,24 @@
 void vnacal_free(vnacal_t *vcp)
 {
     if (vcp != NULL && vcp->vc_magic == VC_MAGIC) {
+	vnamem_allocator_t allocator = vcp->vc_allocator;
+
 	while (vcp->vc_new_head.l_forw != &vcp->vc_new_head) {
 	    vnacal_new_t *vnp = (vnacal_new_t *)((char *)(vcp->vc_new_head.
 			l_forw) - offsetof(vnacal_new_t, vn_next));
 
 	    vnacal_new_free(vnp);
 	}
+	for (int ci = 0; ci < vcp->vc_calibration_allocation; ++ci) {
+	    _vnacal_calibration_free(vcp->vc_calibration_vector[ci]);
+	}
+	_vnacal_free(vcp, (void *)vcp->vc_calibration_vector);
 	(void)vnaproperty_delete(&vcp->vc_properties, ".");
 	assert(vcp->vc_properties == NULL);
 	_vnacal_teardown_parameter_collection(vcp);
 	vcp->vc_magic = -1;
-	free((void *)vcp->vc_filename);
-	free((void *)vcp);
+	_vnacal_close_lazy(vcp);
+	_vnacal_free(vcp, (void *)vcp->vc_filename);
+	_vnamem_afree(&allocator, (void *)vcp);
     }
 }
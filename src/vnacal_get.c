@@ -50,6 +50,19 @@ vnacal_calibration_t *_vnacal_get_calibration(const char *function,
 	}
 	return NULL;
     }
+
+    /*
+     * If the calibration was deferred by vnacal_load_lazy, load it
+     * now.  The loaded calibration replaces the placeholder in the
+     * vector, which acts as a cache; thus the cast.  This is why a
+     * lazily loaded vnacal_t can't be shared between threads.
+     */
+    if (calp->cal_deferred != NULL) {
+	if (_vnacal_load_deferred((vnacal_t *)vcp, ci) == -1) {
+	    return NULL;
+	}
+	calp = vcp->vc_calibration_vector[ci];
+    }
     return calp;
 }
 
@@ -269,3 +282,18 @@ double complex vnacal_get_z0(const vnacal_t *vcp, int ci)
     }
     return calp->cal_z0;
 }
+
+/*
+ * vnacal_get_interpolation: return the interpolation method
+ *   @vcp: pointer returned from vnacal_create or vnacal_load
+ *   @ci: calibration index
+ */
+vnacal_interpolation_t vnacal_get_interpolation(const vnacal_t *vcp, int ci)
+{
+    const vnacal_calibration_t *calp;
+
+    if ((calp = _vnacal_get_calibration(__func__, vcp, ci)) == NULL) {
+	return VNACAL_INTERP_INVALID;
+    }
+    return calp->cal_interpolation;
+}
@@ -58,6 +58,7 @@ int vnacal_get_z0_vector(const vnacal_t *vcp, int ci, double f,
     const vnacal_calibration_t *calp;
     int ports;
     int segment = 0;
+    vnacal_interp_point_t point;
 
     if ((calp = _vnacal_get_calibration(__func__, vcp, ci)) == NULL) {
 	return -1;
@@ -94,10 +95,14 @@ int vnacal_get_z0_vector(const vnacal_t *vcp, int ci, double f,
 		    f, calp->cal_frequency_vector[calp->cal_frequencies - 1]);
 	    return -1;
 	}
+	_vnacal_interp_setup_point(calp->cal_interpolation,
+		calp->cal_frequency_vector, calp->cal_frequencies,
+		&segment, f, &point);
 	for (int port = 0; port < ports; ++port) {
-	    vector[port] = _vnacal_rfi(calp->cal_frequency_vector,
-		    calp->cal_z0_matrix[port], calp->cal_frequencies,
-		    MIN(calp->cal_frequencies, VNACAL_MAX_M), &segment, f);
+	    vector[port] = _vnacal_interp_eval_point(&point,
+		    calp->cal_z0_matrix[port],
+		    calp->cal_z0_spline != NULL ?
+		    calp->cal_z0_spline[port] : NULL);
 	}
 	break;
 
@@ -20,10 +20,13 @@
 #define _VNACAL_INTERNAL_H
 
 #include <assert.h>
+#include <stdio.h>
+#include <sys/types.h>
 
 #include "vnacal.h"
 #include "vnacommon_internal.h"
 #include "vnaerr_internal.h"
+#include "vnamem_internal.h"
 #include "vnaproperty.h"
 #include "vnacal_layout.h"
 
@@ -65,6 +68,84 @@ typedef enum vnacal_parameter_type {
     VNACAL_DATA
 } vnacal_parameter_type_t;
 
+/*
+ * vnacal_rfi_point_t: interpolation window for one target x value
+ */
+typedef struct vnacal_rfi_point {
+    /* index of first point in the window, or of the exact match */
+    int rfp_base;
+
+    /* index of the point nearest x relative to base; -1 if exact */
+    int rfp_cur;
+
+    /* x minus each x point in the window */
+    double rfp_dx[VNACAL_MAX_M];
+
+} vnacal_rfi_point_t;
+
+/*
+ * vnacal_spline_t: natural cubic spline coefficients b, c, d of a segment
+ */
+typedef double complex vnacal_spline_t[3];
+
+/*
+ * vnacal_interp_point_t: how to interpolate at one target x value
+ */
+typedef struct vnacal_interp_point {
+    /* method used at this point (may differ from the one requested) */
+    vnacal_interpolation_t vip_method;
+
+    /* rational: number of points in the window, and the window */
+    int vip_m;
+    vnacal_rfi_point_t vip_rfi;
+
+    /* others: segment containing x, x minus its left end and fraction */
+    int vip_segment;
+    double vip_dx;
+    double vip_t;
+
+} vnacal_interp_point_t;
+
+/*
+ * vnacal_interp_plan_t: interpolation points for a vector of target x values
+ */
+typedef struct vnacal_interp_plan {
+    /* number of target x values */
+    int vipl_points;
+
+    /* vector of points, one per target x value */
+    vnacal_interp_point_t *vipl_point_vector;
+
+} vnacal_interp_plan_t;
+
+/*
+ * VNACAL_MODEL_ORDER: degree of the polynomial segments of a compact model
+ */
+#define VNACAL_MODEL_ORDER	3
+
+/*
+ * vnacal_model_t: piecewise polynomial model of one error term
+ *
+ *   Within segment k, the value is the polynomial with coefficients
+ *   vm_coefficient_vector[k] (constant term first) evaluated at u,
+ *   where u runs from -1 at vm_breakpoint_vector[k] to +1 at
+ *   vm_breakpoint_vector[k + 1].
+ */
+typedef struct vnacal_model {
+    /* number of segments */
+    int vm_segments;
+
+    /* segments + 1 increasing frequencies bounding the segments */
+    double *vm_breakpoint_vector;
+
+    /* per-segment polynomial coefficients */
+    double complex (*vm_coefficient_vector)[VNACAL_MODEL_ORDER + 1];
+
+    /* largest magnitude of error at the calibration frequencies */
+    double vm_fit_error;
+
+} vnacal_model_t;
+
 /*
  * vnacal_data_standard_t: a standard based on network parameter data
  */
@@ -78,9 +159,16 @@ typedef struct vnacal_data_standard {
     /* indicates per-frequency reference impedances */
     bool vds_has_fz0;
 
-    /* most recent segment used in _vnacal_rfi */
+    /* most recent segment used in interpolation */
     int vds_segment;
 
+    /* interpolation method */
+    vnacal_interpolation_t vds_interpolation;
+
+    /* if spline, coefficients by cell and, if vds_has_fz0, by port */
+    vnacal_spline_t **vds_data_spline;
+    vnacal_spline_t **vds_z0_spline;
+
     /* reference impedances */
     union {
 	/* vector of reference impedances by port */
@@ -160,9 +248,15 @@ typedef struct vnacal_parameter {
 	    double *frequency_vector;
 	    double complex *coefficient_vector;
 
-	    /* start position for _vnacal_rfi */
+	    /* most recent segment used in interpolation */
 	    int segment;
 
+	    /* interpolation method */
+	    vnacal_interpolation_t interpolation;
+
+	    /* if spline, coefficients of coefficient_vector (one entry) */
+	    vnacal_spline_t **spline;
+
 	    struct {
 		/* pointer to related parameter */
 		struct vnacal_parameter *other;
@@ -203,6 +297,8 @@ typedef struct vnacal_parameter {
 #define vpmr_frequency_vector		u.vector.frequency_vector
 #define vpmr_coefficient_vector		u.vector.coefficient_vector
 #define vpmr_segment			u.vector.segment
+#define vpmr_interpolation		u.vector.interpolation
+#define vpmr_spline			u.vector.spline
 #define vpmr_other			u.vector.unknown.other
 #define vmpr_correlated			u.vector.unknown.u.correlated
 #define vpmr_sigma_frequencies		vmpr_correlated.sigma_frequencies
@@ -372,6 +468,45 @@ typedef struct vnacal_parameter_collection {
 
 } vnacal_parameter_collection_t;
 
+/*
+ * VNACAL_BINARY_MAGIC: first bytes of a binary calibration file
+ */
+#define VNACAL_BINARY_MAGIC		"\x89VCAL\r\n\x1a"
+#define VNACAL_BINARY_MAGIC_LENGTH	8
+
+/*
+ * vnacal_map_t: binary calibration file image shared by its calibrations
+ *
+ *   The image is either a mapping of the file or, where the file can't
+ *   be mapped, a malloc'd copy.  Each calibration loaded from it holds
+ *   a reference; the image is released with the last one.  Because
+ *   vnacal_save replaces files by renaming a new file over them, a
+ *   mapping keeps the contents it was made from.  The allocator is the
+ *   one of the vnacal_t that opened the image.
+ */
+typedef struct vnacal_map {
+    vnamem_allocator_t vm_allocator;
+    void *vm_address;
+    size_t vm_length;
+    bool vm_mapped;
+    int vm_references;
+} vnacal_map_t;
+
+/*
+ * vnacal_deferred_t: location of a calibration not yet loaded
+ *
+ *   Used by vnacal_load_lazy.  The offset and length give the bytes
+ *   of the calibration's YAML mapping in the file; the line and
+ *   column give its zero-based position in the YAML text.
+ */
+typedef struct vnacal_deferred {
+    long vdf_offset;
+    size_t vdf_length;
+    int vdf_line;
+    int vdf_column;
+    int vdf_version;
+} vnacal_deferred_t;
+
 /*
  * vnacal_calibration_t: error terms
  */
@@ -401,13 +536,39 @@ typedef struct vnacal_calibration {
 	double complex **cal_z0_matrix;	/* matrix[port][findex] */
     } u;
 
-    /* vector, one per error term, of vectors of values, one per frequency */
+    /*
+     * vector, one per error term, of vectors of values, one per
+     * frequency; NULL if the calibration has been compacted
+     */
     int cal_error_terms;
     double complex **cal_error_term_vector;
 
+    /* interpolation method */
+    vnacal_interpolation_t cal_interpolation;
+
+    /* if spline, coefficients by error term and, if z0 matrix, by port */
+    vnacal_spline_t **cal_error_term_spline;
+    vnacal_spline_t **cal_z0_spline;
+
+    /* if compacted, fit tolerance and model by error term, else NULL */
+    double cal_compact_tolerance;
+    vnacal_model_t *cal_error_term_model;
+
     /* per-calibration properties */
     vnaproperty_t *cal_properties;
 
+    /*
+     * If not NULL, the frequency vector, error term vectors and z0
+     * matrix rows point into this binary file image.
+     */
+    vnacal_map_t *cal_map;
+
+    /*
+     * If not NULL, only cal_name is valid; the calibration is loaded
+     * from the file on first use by _vnacal_get_calibration.
+     */
+    vnacal_deferred_t *cal_deferred;
+
 } vnacal_calibration_t;
 
 /*
@@ -451,6 +612,9 @@ struct vnacal {
     /* magic number */
     uint32_t vc_magic;
 
+    /* allocator in effect when the structure was created */
+    vnamem_allocator_t vc_allocator;
+
     /* user-supplied error callback or NULL */
     vnaerr_error_fn_t *vc_error_fn;
 
@@ -469,6 +633,13 @@ struct vnacal {
     /* calibration filename */
     char *vc_filename;
 
+    /* file held open by vnacal_load_lazy for deferred calibrations */
+    FILE *vc_lazy_fp;
+
+    /* size and modification time of vc_lazy_fp when it was indexed */
+    off_t vc_lazy_size;
+    time_t vc_lazy_mtime;
+
     /* precision for frequency values */
     int vc_fprecision;
 
@@ -490,13 +661,46 @@ __attribute__ ((__format__ (__printf__, 3, 4)))
 #endif /* __GNUC__ */
 ;
 
+/*
+ * _vnacal_malloc, _vnacal_calloc, _vnacal_realloc, _vnacal_free,
+ * _vnacal_strdup:
+ *	manage storage owned by the vnacal_t structure using its allocator
+ */
+static inline void *_vnacal_malloc(const vnacal_t *vcp, size_t size)
+{
+    return _vnamem_amalloc(&vcp->vc_allocator, size);
+}
+
+static inline void *_vnacal_calloc(const vnacal_t *vcp,
+	size_t count, size_t size)
+{
+    return _vnamem_acalloc(&vcp->vc_allocator, count, size);
+}
+
+static inline void *_vnacal_realloc(const vnacal_t *vcp,
+	void *ptr, size_t size)
+{
+    return _vnamem_arealloc(&vcp->vc_allocator, ptr, size);
+}
+
+static inline void _vnacal_free(const vnacal_t *vcp, void *ptr)
+{
+    _vnamem_afree(&vcp->vc_allocator, ptr);
+}
+
+static inline char *_vnacal_strdup(const vnacal_t *vcp, const char *s)
+{
+    return _vnamem_astrdup(&vcp->vc_allocator, s);
+}
+
 /* _vnacal_layout: init the error term layout structure */
 extern void _vnacal_layout(vnacal_layout_t *vlp, vnacal_type_t type,
 	int m_rows, int m_columns);
 
 /* _vnacal_alloc: allocate a vnacal_t structure */
 extern vnacal_t *_vnacal_alloc(const char *function,
-	vnaerr_error_fn_t *error_fn, void *error_arg);
+	vnaerr_error_fn_t *error_fn, void *error_arg,
+	const vnamem_allocator_t *allocator);
 
 /* _vnacal_calibration_alloc: alloc vnacal_calibration */
 extern vnacal_calibration_t *_vnacal_calibration_alloc(vnacal_t *vcp,
@@ -511,9 +715,27 @@ extern double _vnacal_calibration_get_fmin_bound(
 extern double _vnacal_calibration_get_fmax_bound(
 	const vnacal_calibration_t *calp);
 
+/* _vnacal_calibration_free_error_terms: discard the error term vectors */
+extern void _vnacal_calibration_free_error_terms(vnacal_calibration_t *calp);
+
 /* _vnacal_calibration_free: free the memory for a vnacal_calibration_t */
 extern void _vnacal_calibration_free(vnacal_calibration_t *calp);
 
+/* _vnacal_map_release: drop a reference to a binary file image */
+extern void _vnacal_map_release(vnacal_map_t *vmp);
+
+/* _vnacal_load_binary: load a binary calibration file */
+extern int _vnacal_load_binary(vnacal_t *vcp);
+
+/* _vnacal_save_binary: save in binary calibration format */
+extern int _vnacal_save_binary(vnacal_t *vcp, FILE *fp);
+
+/* _vnacal_load_deferred: load a calibration deferred by vnacal_load_lazy */
+extern int _vnacal_load_deferred(vnacal_t *vcp, int ci);
+
+/* _vnacal_close_lazy: close the file held open by vnacal_load_lazy */
+extern void _vnacal_close_lazy(vnacal_t *vcp);
+
 /* _vnacal_get_calibration: return the calibration at the given index */
 extern vnacal_calibration_t *_vnacal_get_calibration(const char *function,
 	const vnacal_t *vcp, int ci);
@@ -527,7 +749,8 @@ extern int _vnacal_build_error_term_list(vnacal_calibration_t *calp,
 	const vnacal_layout_t *vlp, vnacal_error_term_matrix_t **head);
 
 /* _vnacal_free_error_term_matrix: free an error term matrix structure */
-extern void _vnacal_free_error_term_matrices(vnacal_error_term_matrix_t **head);
+extern void _vnacal_free_error_term_matrices(const vnacal_t *vcp,
+	vnacal_error_term_matrix_t **head);
 
 /* _vnacal_get_parameter: return a pointer to the parameter */
 extern vnacal_parameter_t *_vnacal_get_parameter(const vnacal_t *vcp,
@@ -583,6 +806,75 @@ extern void _vnacal_teardown_parameter_collection(vnacal_t *vcp);
 extern double complex _vnacal_rfi(const double *xp, const double complex *yp,
 	int n, int m, int *segment, double x);
 
+/* _vnacal_rfi_setup_point: find the interpolation window for one x */
+extern void _vnacal_rfi_setup_point(const double *xp, int n, int m,
+	int *segment, double x, vnacal_rfi_point_t *point);
+
+/* _vnacal_rfi_eval_point: interpolate y at a point set up above */
+extern double complex _vnacal_rfi_eval_point(const vnacal_rfi_point_t *point,
+	int m, const double complex *yp);
+
+/* _vnacal_interp_setup_point: find how to interpolate at one x */
+extern void _vnacal_interp_setup_point(vnacal_interpolation_t method,
+	const double *xp, int n, int *segment, double x,
+	vnacal_interp_point_t *pointp);
+
+/* _vnacal_interp_eval_point: interpolate y at a point set up above */
+extern double complex _vnacal_interp_eval_point(
+	const vnacal_interp_point_t *pointp, const double complex *yp,
+	const vnacal_spline_t *sp);
+
+/* _vnacal_interp_plan_alloc: set up interpolation onto a fixed x grid */
+extern vnacal_interp_plan_t *_vnacal_interp_plan_alloc(
+	vnacal_interpolation_t method, const double *xp, int n,
+	const double *x_vector, int points);
+
+/* _vnacal_interp_plan_apply: interpolate a y vector onto the target grid */
+extern void _vnacal_interp_plan_apply(const vnacal_interp_plan_t *planp,
+	const double complex *yp, const vnacal_spline_t *sp,
+	double complex *result);
+
+/* _vnacal_interp_plan_free: free a plan from _vnacal_interp_plan_alloc */
+extern void _vnacal_interp_plan_free(vnacal_interp_plan_t *planp);
+
+/* _vnacal_spline_alloc_vector: find spline coefficients for y vectors */
+extern vnacal_spline_t **_vnacal_spline_alloc_vector(
+	const vnamem_allocator_t *vmap, const double *xp, int n,
+	double complex *const *y_vector, int count);
+
+/* _vnacal_spline_free_vector: free a result of _vnacal_spline_alloc_vector */
+extern void _vnacal_spline_free_vector(const vnamem_allocator_t *vmap,
+	vnacal_spline_t **spline_vector, int count);
+
+/* _vnacal_calibration_set_interpolation: set method and spline cache */
+extern int _vnacal_calibration_set_interpolation(const char *function,
+	vnacal_calibration_t *calp, vnacal_interpolation_t method);
+
+/* _vnacal_data_standard_set_interpolation: set method and spline cache */
+extern int _vnacal_data_standard_set_interpolation(const char *function,
+	vnacal_standard_t *stdp, vnacal_interpolation_t method);
+
+/* _vnacal_parameter_set_interpolation: set method and spline cache */
+extern int _vnacal_parameter_set_interpolation(const char *function,
+	vnacal_parameter_t *vpmrp, vnacal_interpolation_t method);
+
+/* _vnacal_model_fit: fit a piecewise polynomial model to y */
+extern int _vnacal_model_fit(const vnamem_allocator_t *vmap,
+	const double *xp, const double complex *yp, int n, double tolerance,
+	vnacal_model_t *vmp);
+
+/* _vnacal_model_eval: evaluate a model at x */
+extern double complex _vnacal_model_eval(const vnacal_model_t *vmp,
+	double x, int *segment);
+
+/* _vnacal_model_free_vector: free a vector of models */
+extern void _vnacal_model_free_vector(const vnamem_allocator_t *vmap,
+	vnacal_model_t *model_vector, int count);
+
+/* _vnacal_calibration_compact: fit models to the error terms */
+extern int _vnacal_calibration_compact(const char *function,
+	vnacal_calibration_t *calp, double tolerance);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
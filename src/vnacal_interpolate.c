@@ -0,0 +1,277 @@
+/*
+ * Vector Network Analyzer Library
+ * Copyright © 2020-2024 D Scott Guthridge <scott_guthridge@rompromity.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "archdep.h"
+
+#include <assert.h>
+#include <complex.h>
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "vnacal_internal.h"
+#include "vnacommon_internal.h"
+#include "vnadata_internal.h"
+
+
+/*
+ * _vnacal_interp_setup_point: find how to interpolate at one x
+ *   @method:     interpolation method
+ *   @xp:         vector of x points
+ *   @n:          length of xp
+ *   @ip_segment: addr of left x index that bounds x (used as hint on entry)
+ *   @x:          dependent variable to interpolate
+ *   @pointp:     caller-allocated structure to receive the result
+ *
+ *   With fewer than two points, all methods return the single y value;
+ *   with fewer than three, spline interpolation is linear.
+ */
+void _vnacal_interp_setup_point(vnacal_interpolation_t method,
+	const double *xp, int n, int *ip_segment, double x,
+	vnacal_interp_point_t *pointp)
+{
+    int segment;
+
+    assert(n >= 1);
+    if (n < 2) {
+	method = VNACAL_INTERP_RATIONAL;
+    } else if (method == VNACAL_INTERP_SPLINE && n < 3) {
+	method = VNACAL_INTERP_LINEAR;
+    }
+    pointp->vip_method = method;
+    if (method == VNACAL_INTERP_RATIONAL) {
+	pointp->vip_m = MIN(n, VNACAL_MAX_M);
+	_vnacal_rfi_setup_point(xp, n, pointp->vip_m, ip_segment, x,
+		&pointp->vip_rfi);
+	return;
+    }
+    segment = _vnadata_find_segment(xp, n, x, *ip_segment);
+    if (segment > n - 2) {
+	segment = n - 2;
+    }
+    *ip_segment = segment;
+    pointp->vip_segment = segment;
+    pointp->vip_dx = x - xp[segment];
+    pointp->vip_t = pointp->vip_dx / (xp[segment + 1] - xp[segment]);
+}
+
+/*
+ * _vnacal_interp_eval_point: interpolate y at a point set up above
+ *   @pointp: result of _vnacal_interp_setup_point
+ *   @yp:     vector of y points
+ *   @sp:     spline coefficients for yp if the method is spline
+ */
+double complex _vnacal_interp_eval_point(const vnacal_interp_point_t *pointp,
+	const double complex *yp, const vnacal_spline_t *sp)
+{
+    const int k = pointp->vip_segment;
+    const double t = pointp->vip_t;
+
+    switch (pointp->vip_method) {
+    case VNACAL_INTERP_RATIONAL:
+	return _vnacal_rfi_eval_point(&pointp->vip_rfi, pointp->vip_m, yp);
+
+    case VNACAL_INTERP_LINEAR:
+	break;
+
+    case VNACAL_INTERP_POLAR:
+	{
+	    const double r0 = cabs(yp[k]);
+	    const double r1 = cabs(yp[k + 1]);
+	    double dphi;
+
+	    /*
+	     * Interpolate magnitude and phase separately, taking the
+	     * shorter way around.  If either end is zero, the phase
+	     * is undefined; fall back to linear.
+	     */
+	    if (r0 == 0.0 || r1 == 0.0) {
+		break;
+	    }
+	    dphi = carg(yp[k + 1] * conj(yp[k]));
+	    return (r0 + t * (r1 - r0)) * cexp(I * t * dphi) * (yp[k] / r0);
+	}
+
+    case VNACAL_INTERP_SPLINE:
+	{
+	    const double dx = pointp->vip_dx;
+
+	    assert(sp != NULL);
+	    return yp[k] + dx * (sp[k][0] + dx * (sp[k][1] + dx * sp[k][2]));
+	}
+
+    default:
+	abort();
+    }
+    return yp[k] + t * (yp[k + 1] - yp[k]);
+}
+
+/*
+ * _vnacal_interp_plan_alloc: set up interpolation onto a fixed x grid
+ *   @method:   interpolation method
+ *   @xp:       vector of source x points
+ *   @n:        length of xp
+ *   @x_vector: vector of increasing target x points
+ *   @points:   length of x_vector
+ *
+ *   Return NULL with errno set on allocation failure.
+ */
+vnacal_interp_plan_t *_vnacal_interp_plan_alloc(vnacal_interpolation_t method,
+	const double *xp, int n, const double *x_vector, int points)
+{
+    vnacal_interp_plan_t *planp;
+    int segment = 0;
+
+    if ((planp = _vnamem_malloc(sizeof(vnacal_interp_plan_t))) == NULL) {
+	return NULL;
+    }
+    planp->vipl_points = points;
+    if ((planp->vipl_point_vector = _vnamem_calloc(MAX(points, 1),
+		    sizeof(vnacal_interp_point_t))) == NULL) {
+	_vnamem_free((void *)planp);
+	return NULL;
+    }
+    for (int i = 0; i < points; ++i) {
+	_vnacal_interp_setup_point(method, xp, n, &segment, x_vector[i],
+		&planp->vipl_point_vector[i]);
+    }
+    return planp;
+}
+
+/*
+ * _vnacal_interp_plan_apply: interpolate a y vector onto the target grid
+ *   @planp:  plan from _vnacal_interp_plan_alloc
+ *   @yp:     vector of y points that go with the source x points
+ *   @sp:     spline coefficients for yp if the method is spline
+ *   @result: caller-allocated vector of vipl_points values
+ */
+void _vnacal_interp_plan_apply(const vnacal_interp_plan_t *planp,
+	const double complex *yp, const vnacal_spline_t *sp,
+	double complex *result)
+{
+    for (int i = 0; i < planp->vipl_points; ++i) {
+	result[i] = _vnacal_interp_eval_point(&planp->vipl_point_vector[i],
+		yp, sp);
+    }
+}
+
+/*
+ * _vnacal_interp_plan_free: free a plan from _vnacal_interp_plan_alloc
+ *   @planp: plan to free (may be NULL)
+ */
+void _vnacal_interp_plan_free(vnacal_interp_plan_t *planp)
+{
+    if (planp != NULL) {
+	_vnamem_free((void *)planp->vipl_point_vector);
+	_vnamem_free((void *)planp);
+    }
+}
+
+/*
+ * _vnacal_spline_free_vector: free a result of _vnacal_spline_alloc_vector
+ *   @vmap: allocator passed to _vnacal_spline_alloc_vector
+ *   @spline_vector: vector to free (may be NULL)
+ *   @count: number of entries in spline_vector
+ */
+void _vnacal_spline_free_vector(const vnamem_allocator_t *vmap,
+	vnacal_spline_t **spline_vector, int count)
+{
+    if (spline_vector != NULL) {
+	for (int i = 0; i < count; ++i) {
+	    _vnamem_afree(vmap, (void *)spline_vector[i]);
+	}
+	_vnamem_afree(vmap, (void *)spline_vector);
+    }
+}
+
+/*
+ * _vnacal_spline_alloc_vector: find spline coefficients for y vectors
+ *   @vmap: allocator for the result
+ *   @xp: vector of x points
+ *   @n: length of xp and of each y vector (at least 3)
+ *   @y_vector: vector of count y vectors
+ *   @count: number of y vectors
+ *
+ *   The real and imaginary parts are fit separately using
+ *   _vnacommon_spline_calc.  Return NULL with errno set on error.
+ */
+vnacal_spline_t **_vnacal_spline_alloc_vector(const vnamem_allocator_t *vmap,
+	const double *xp, int n, double complex *const *y_vector, int count)
+{
+    const int segments = n - 1;
+    vnacal_spline_t **spline_vector = NULL;
+    double *real_vector = NULL;
+    double *imag_vector = NULL;
+    double (*real_spline)[3] = NULL;
+    double (*imag_spline)[3] = NULL;
+    bool ok = false;
+
+    assert(n >= 3);
+    if ((spline_vector = _vnamem_acalloc(vmap, MAX(count, 1),
+		    sizeof(vnacal_spline_t *))) == NULL ||
+	    (real_vector = _vnamem_amalloc(vmap,
+		    n * sizeof(double))) == NULL ||
+	    (imag_vector = _vnamem_amalloc(vmap,
+		    n * sizeof(double))) == NULL ||
+	    (real_spline = _vnamem_amalloc(vmap, segments *
+		    sizeof(double [3]))) == NULL ||
+	    (imag_spline = _vnamem_amalloc(vmap, segments *
+		    sizeof(double [3]))) == NULL) {
+	goto out;
+    }
+    for (int i = 0; i < count; ++i) {
+	vnacal_spline_t *sp;
+
+	if ((sp = _vnamem_amalloc(vmap, segments *
+			sizeof(vnacal_spline_t))) == NULL) {
+	    goto out;
+	}
+	spline_vector[i] = sp;
+	for (int j = 0; j < n; ++j) {
+	    real_vector[j] = creal(y_vector[i][j]);
+	    imag_vector[j] = cimag(y_vector[i][j]);
+	}
+	if (_vnacommon_spline_calc(segments, xp, real_vector,
+		    real_spline) == -1 ||
+		_vnacommon_spline_calc(segments, xp, imag_vector,
+		    imag_spline) == -1) {
+	    goto out;
+	}
+	for (int j = 0; j < segments; ++j) {
+	    for (int k = 0; k < 3; ++k) {
+		sp[j][k] = real_spline[j][k] + I * imag_spline[j][k];
+	    }
+	}
+    }
+    ok = true;
+
+out:
+    _vnamem_afree(vmap, (void *)imag_spline);
+    _vnamem_afree(vmap, (void *)real_spline);
+    _vnamem_afree(vmap, (void *)imag_vector);
+    _vnamem_afree(vmap, (void *)real_vector);
+    if (!ok) {
+	int saved_errno = errno;
+
+	_vnacal_spline_free_vector(vmap, spline_vector, count);
+	errno = saved_errno;
+	return NULL;
+    }
+    return spline_vector;
+}
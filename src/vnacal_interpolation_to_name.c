@@ -0,0 +1,68 @@
+/*
+ * Vector Network Analyzer Library
+ * Copyright © 2020-2024 D Scott Guthridge <scott_guthridge@rompromity.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "archdep.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include "vnacal_internal.h"
+
+
+/*
+ * vnacal_interpolation_to_name: convert interpolation method to name
+ *   @method: interpolation method
+ */
+const char *vnacal_interpolation_to_name(vnacal_interpolation_t method)
+{
+    switch (method) {
+    case VNACAL_INTERP_RATIONAL:
+	return "rational";
+
+    case VNACAL_INTERP_LINEAR:
+	return "linear";
+
+    case VNACAL_INTERP_POLAR:
+	return "polar";
+
+    case VNACAL_INTERP_SPLINE:
+	return "spline";
+
+    default:
+	break;
+    }
+    return NULL;
+}
+
+/*
+ * vnacal_name_to_interpolation: convert interpolation method name to enum
+ *   @name: name of interpolation method (case insensitive)
+ */
+vnacal_interpolation_t vnacal_name_to_interpolation(const char *name)
+{
+    if (name == NULL) {
+	return VNACAL_INTERP_INVALID;
+    }
+    for (int i = VNACAL_INTERP_RATIONAL; i <= VNACAL_INTERP_SPLINE; ++i) {
+	vnacal_interpolation_t method = (vnacal_interpolation_t)i;
+
+	if (strcasecmp(name, vnacal_interpolation_to_name(method)) == 0) {
+	    return method;
+	}
+    }
+    return VNACAL_INTERP_INVALID;
+}
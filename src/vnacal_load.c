@@ -22,21 +22,33 @@
 #include <complex.h>
 #include <ctype.h>
 #include <errno.h>
+#include <inttypes.h>
+#include <limits.h>
 #include <math.h>
 #include <stdarg.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <yaml.h>
 #include "vnacal_internal.h"
 #include "vnaproperty_internal.h"
+#include "vnastats_internal.h"
 
+#ifndef ESTALE
+#define ESTALE	EIO
+#endif
 
 /*
  * Version Codes: index into version_table (highest version first)
+ *
+ *   Because newer versions have smaller codes, don't compare codes
+ *   with < or > directly; use version_older_than.
  */
 typedef enum vncal_version {
     V_UNSUPPORTED = -1,
+    V1_2,
     V1_1,
     V1_0,
     V0_2,
@@ -56,11 +68,22 @@ typedef struct version_entry {
  * Version Table
  */
 const version_entry_t version_table[] = {
+    {  1,  2, V1_2 },
     {  1,  1, V1_1 },
     {  1,  0, V1_0 },
     {  0,  2, V0_2 },
 };
 
+/*
+ * version_older_than: test if version a is an older format than b
+ *   @a: version code to test
+ *   @b: version code to compare against
+ */
+static inline bool version_older_than(vnacal_version_t a, vnacal_version_t b)
+{
+    return a > b;
+}
+
 /*
  * parse_version: parse the version line and return the verson code
  *   @vcp: vnacal structure
@@ -115,33 +138,90 @@ static vnacal_version_t parse_version(vnacal_t *vcp, const char *version_line)
 }
 
 /*
- * get_line: get the line number associated with node (+1 for version line)
+ * get_line: get the line number associated with node
  *   @node: a node in the property tree
+ *
+ *   The property tree has zero-based line numbers relative to the
+ *   start of the YAML text, which begins after the version line.
  */
 static int get_line(const vnaproperty_t *node)
 {
-    return _vnaproperty_get_line(node) + 1;
+    return _vnaproperty_get_line(node) + 2;
+}
+
+/*
+ * tree_paths_t: property expressions used to parse calibration trees
+ *
+ *   Compiled once per load and evaluated for every error term.
+ */
+typedef struct tree_paths {
+    vnaproperty_path_t *tp_key;		/* %s     */
+    vnaproperty_path_t *tp_self;	/* .      */
+    vnaproperty_path_t *tp_map;		/* {}     */
+    vnaproperty_path_t *tp_list;	/* []     */
+    vnaproperty_path_t *tp_element;	/* [%d]   */
+    vnaproperty_path_t *tp_row;		/* [%d][] */
+    vnaproperty_path_t *tp_entry;	/* [%d]{} */
+} tree_paths_t;
+
+/*
+ * compile_paths: compile the property expressions
+ *   @vcp: vnacal structure
+ *   @tpp: structure to fill
+ */
+static int compile_paths(vnacal_t *vcp, tree_paths_t *tpp)
+{
+    if ((tpp->tp_key     = vnaproperty_path_compile("%s"))     == NULL ||
+	(tpp->tp_self    = vnaproperty_path_compile("."))      == NULL ||
+	(tpp->tp_map     = vnaproperty_path_compile("{}"))     == NULL ||
+	(tpp->tp_list    = vnaproperty_path_compile("[]"))     == NULL ||
+	(tpp->tp_element = vnaproperty_path_compile("[%d]"))   == NULL ||
+	(tpp->tp_row     = vnaproperty_path_compile("[%d][]")) == NULL ||
+	(tpp->tp_entry   = vnaproperty_path_compile("[%d]{}")) == NULL) {
+	_vnacal_error(vcp, VNAERR_SYSTEM, "vnaproperty_path_compile: %s",
+		strerror(errno));
+	return -1;
+    }
+    return 0;
+}
+
+/*
+ * free_paths: free the property expressions
+ *   @tpp: structure filled by compile_paths
+ */
+static void free_paths(tree_paths_t *tpp)
+{
+    vnaproperty_path_free(tpp->tp_key);
+    vnaproperty_path_free(tpp->tp_self);
+    vnaproperty_path_free(tpp->tp_map);
+    vnaproperty_path_free(tpp->tp_list);
+    vnaproperty_path_free(tpp->tp_element);
+    vnaproperty_path_free(tpp->tp_row);
+    vnaproperty_path_free(tpp->tp_entry);
+    (void)memset((void *)tpp, 0, sizeof(*tpp));
 }
 
 /*
  * get_key: get a required key and check the type
  *   @vcp: vnacal structure
+ *   @tpp: compiled property expressions
  *   @mapping: a mapping node
  *   @key: requested key
  *   @required_type: 'm' (mapping), 'l' (sequence), 's' (scalar), or -1 (null)
  */
-static const vnaproperty_t *get_key(vnacal_t *vcp,
+static const vnaproperty_t *get_key(vnacal_t *vcp, const tree_paths_t *tpp,
 	const vnaproperty_t *mapping, const char *key, int required_type)
 {
     const vnaproperty_t *vprp;
 
-    if ((vprp = vnaproperty_get_subtree(mapping, "%s", key)) == NULL) {
+    if ((vprp = vnaproperty_path_get_subtree(mapping, tpp->tp_key,
+		    key)) == NULL) {
 	_vnacal_error(vcp, VNAERR_SYNTAX, "vnacal_load: %s (line %d): "
 		"missing required key %s",
 		vcp->vc_filename, get_line(mapping), key);
 	return NULL;
     }
-    if (vnaproperty_type(vprp, ".") != required_type) {
+    if (vnaproperty_path_type(vprp, tpp->tp_self) != required_type) {
 	_vnacal_error(vcp, VNAERR_SYNTAX, "vnacal_load: %s (line %d): "
 		"\"%s\" must be a %s",
 		vcp->vc_filename, get_line(vprp), key,
@@ -153,22 +233,16 @@ static const vnaproperty_t *get_key(vnacal_t *vcp,
     return vprp;
 }
 
-/*
- * top_level_keys: valid keys in top-level mapping
- */
-static const char *top_level_keys[] = {
-    "calibrations",
-    "properties",
-    NULL
-};
-
 /*
  * calibration_keys: valid keys in each calibration
  */
 static const char *calibration_keys[] = {
     "columns",
+    "compact_tolerance",
     "data",
     "frequencies",
+    "interpolation",
+    "models",
     "name",
     "properties",
     "rows",
@@ -184,14 +258,17 @@ static const char *frequency_keys[] = {
     "el", "em", "er", "f",
     "ti", "tm", "ts", "tx",
     "ui", "um", "us", "ux",
+    "z0",
     NULL
 };
 
 /*
- * v0_2_top_level_keys: valid top-level keys in version 0.2
+ * model_keys: valid keys in each error term model
  */
-static const char *v0_2_top_level_keys[] = {
-    "sets",
+static const char *model_keys[] = {
+    "breakpoints",
+    "coefficients",
+    "fit_error",
     NULL
 };
 
@@ -229,22 +306,23 @@ static int cmp(const void *arg1, const void *arg2)
 /*
  * check_mapping: check that all keys in a mapping are expected
  *   @vcp: vnacal structure
+ *   @tpp: compiled property expressions
  *   @mapping: element expected to be a mapping
  *   @allowed_keys: sorted NULL-terminated vector of valid keys
  */
-static int check_mapping(vnacal_t *vcp, const vnaproperty_t *mapping,
-	const char *const *allowed_keys)
+static int check_mapping(vnacal_t *vcp, const tree_paths_t *tpp,
+	const vnaproperty_t *mapping, const char *const *allowed_keys)
 {
     const char **keys;
     const char *const *ptr1;
     const char *const *ptr2;
     int count;
 
-    assert(vnaproperty_type(mapping, ".") == 'm');
-    if ((count = vnaproperty_count(mapping, "{}")) == -1) {
+    assert(vnaproperty_path_type(mapping, tpp->tp_self) == 'm');
+    if ((count = vnaproperty_path_count(mapping, tpp->tp_map)) == -1) {
 	abort();
     }
-    if ((keys = vnaproperty_keys(mapping, "{}")) == NULL) {
+    if ((keys = vnaproperty_path_keys(mapping, tpp->tp_map)) == NULL) {
 	if (errno == ENOMEM) {
 	    _vnacal_error(vcp, VNAERR_SYSTEM,
 		    "malloc: %s", strerror(errno));
@@ -308,10 +386,11 @@ const char *matrix_names[] = {
 /*
  * check_for_stray_matrices: check for extraneous error term matrices
  *   @calp: calibration structure
+ *   @tpp: compiled property expressions
  *   @vprp_frequency: per-frequency entry of a calibration
  */
 static int check_for_stray_matrices(const vnacal_calibration_t *calp,
-	const vnaproperty_t *vprp_frequency)
+	const tree_paths_t *tpp, const vnaproperty_t *vprp_frequency)
 {
     vnacal_t *vcp = calp->cal_vcp;
     uint32_t mask = 0;	/* mask of wanted keys */
@@ -341,11 +420,14 @@ static int check_for_stray_matrices(const vnacal_calibration_t *calp,
     default:
 	abort();
     }
+    if (calp->cal_error_term_vector == NULL) {	/* compacted */
+	mask = 0;
+    }
     for (int i = 0; i < N_MATRIX_NAMES; ++i) {
 	if (mask & (1U << i)) {
 	    continue;
 	}
-	if (vnaproperty_get_subtree(vprp_frequency, "%s",
+	if (vnaproperty_path_get_subtree(vprp_frequency, tpp->tp_key,
 		    matrix_names[i]) != NULL) {
 	    _vnacal_error(vcp, VNAERR_SYNTAX, "%s (line %d) error: "
 		    "key \"%s\" is not expected here",
@@ -358,107 +440,41 @@ static int check_for_stray_matrices(const vnacal_calibration_t *calp,
 }
 
 /*
- * parse_complex: parse a complex from a vnaproperty node and descriptor
- *   @root: vnaproperty node
- *   @format: property descriptor format (printf-like)
- *   @...: optional arguments depending on format
+ * parse_complex: parse a complex from an element of a sequence
+ *   @tpp: compiled property expressions
+ *   @root: vnaproperty sequence node
+ *   @index: index of the element
  */
-static double complex parse_complex(const vnaproperty_t *root,
-	const char *format, ...)
+static double complex parse_complex(const tree_paths_t *tpp,
+	const vnaproperty_t *root, int index)
 {
-    va_list ap;
-    const char *cur;
-    char *end;
-    double value1 = 0.0, value2 = 0.0;
-    int code = 0;
-
-    va_start(ap, format);
-    cur = vnaproperty_vget(root, format, ap);
-    va_end(ap);
-    if (cur == NULL) {
-	return HUGE_VAL;
-    }
-    value1 = strtod(cur, &end);
-    if (end != cur) {
-	++code;
-	cur = end;
-	value2 = strtod(cur, &end);
-	if (end != cur) {
-	    ++code;
-	    cur = end;
-	}
-    }
-    while (*cur == ' ' || *cur == '\t' || *cur == '\n') {
-	++cur;
-    }
-    if (*cur == '+') {
-	code |= 8;
-	++cur;
-    } else if (*cur == '-') {
-	code |= 16;
-	++cur;
-    }
-    while (*cur == ' ' || *cur == '\t' || *cur == '\n') {
-	++cur;
-    }
-    switch (*cur) {
-    case 'I':
-    case 'J':
-    case 'i':
-    case 'j':
-	code |= 4;
-	++cur;
-	break;
+    double complex value;
 
-    default:
-	break;
-    }
-    while (*cur == ' ' || *cur == '\t' || *cur == '\n') {
-	++cur;
-    }
-    if (*cur != '\000') {
+    if (vnaproperty_path_get_complex(root, tpp->tp_element, &value,
+		index) == -1) {
 	return HUGE_VAL;
     }
-    switch (code) {
-    case 1:	/* number */
-	return value1;
-    case 4:	/* j */
-	return I;
-    case 5:	/* number j */
-	return value1 * I;
-    case 6:	/* number number j */
-	return value1 + value2 * I;
-    case 12:	/* +j */
-	return I;
-    case 13:	/* number + j */
-	return value1 + I;
-    case 20:	/* -j */
-	return -I;
-    case 21:	/* number - j */
-	return value1 - I;
-    default:
-	break;
-    }
-    return HUGE_VAL;
+    return value;
 }
 
 /*
  * parse_type_from_map: parse a required vnacal type from a mapping
  *   @vcp: vnacal structure
+ *   @tpp: compiled property expressions
  *   @mapping: mapping to parse
  *   @key: required key
  */
 static vnacal_type_t parse_type_from_map(vnacal_t *vcp,
-	const vnaproperty_t *mapping, const char *key)
+	const tree_paths_t *tpp, const vnaproperty_t *mapping, const char *key)
 {
     const vnaproperty_t *scalar;
     const char *s;
     vnacal_type_t type;
 
-    if ((scalar = get_key(vcp, mapping, key, 's')) == NULL) {
+    if ((scalar = get_key(vcp, tpp, mapping, key, 's')) == NULL) {
 	return VNACAL_NOTYPE;
     }
-    s = vnaproperty_get(scalar, ".");
+    s = vnaproperty_path_get(scalar, tpp->tp_self);
     assert(s != NULL);
     if ((type = vnacal_name_to_type(s)) == -1) {
 	_vnacal_error(vcp, VNAERR_SYNTAX, "%s (line %d) error: "
@@ -472,89 +488,85 @@ static vnacal_type_t parse_type_from_map(vnacal_t *vcp,
 /*
  * parse_int_from_map: parse a required integer from a mapping
  *   @vcp: vnacal structure
+ *   @tpp: compiled property expressions
  *   @mapping: mapping to parse
  *   @key: required key
  *   @min: minimum valid value for the int
  */
-static int parse_int_from_map(vnacal_t *vcp, const vnaproperty_t *mapping,
-	const char *key, int min)
+static int parse_int_from_map(vnacal_t *vcp, const tree_paths_t *tpp,
+	const vnaproperty_t *mapping, const char *key, int min)
 {
     const vnaproperty_t *scalar;
-    const char *s;
-    char *e;
-    int value;
+    int64_t value;
 
-    if ((scalar = get_key(vcp, mapping, key, 's')) == NULL) {
+    if ((scalar = get_key(vcp, tpp, mapping, key, 's')) == NULL) {
 	return -1;
     }
-    s = vnaproperty_get(scalar, ".");
-    assert(s != NULL);
-    value = strtol(s, &e, 0);
-    if (*s == '\000' || *e != '\000') {
+    if (vnaproperty_path_get_int64(scalar, tpp->tp_self, &value) == -1 ||
+	    value > INT_MAX) {
 	_vnacal_error(vcp, VNAERR_SYNTAX, "%s (line %d) error: "
 		"%s: invalid integer: \"%s\"",
-		vcp->vc_filename, get_line(scalar), key, s);
+		vcp->vc_filename, get_line(scalar), key,
+		vnaproperty_path_get(scalar, tpp->tp_self));
 	return -1;
     }
     if (value < min) {
 	_vnacal_error(vcp, VNAERR_SYNTAX, "%s (line %d) error: "
-		"%s must be at least %d (found %d)",
+		"%s must be at least %d (found %" PRId64 ")",
 		vcp->vc_filename, get_line(scalar),
 		key, min, value);
 	return -1;
     }
-    return value;
+    return (int)value;
 }
 
 /*
  * parse_double_from_map: parse a required double from a mapping
  *   @vcp: vnacal structure
+ *   @tpp: compiled property expressions
  *   @mapping: mapping to parse
  *   @key: required key
  */
-static double parse_double_from_map(vnacal_t *vcp,
+static double parse_double_from_map(vnacal_t *vcp, const tree_paths_t *tpp,
 	const vnaproperty_t *mapping, const char *key)
 {
     const vnaproperty_t *scalar;
-    const char *s;
-    char *e;
     double value;
 
-    if ((scalar = get_key(vcp, mapping, key, 's')) == NULL) {
+    if ((scalar = get_key(vcp, tpp, mapping, key, 's')) == NULL) {
 	return HUGE_VAL;
     }
-    s = vnaproperty_get(scalar, ".");
-    assert(s != NULL);
-    value = strtod(s, &e);
-    if (*s == '\000' || *e != '\000') {
+    if (vnaproperty_path_get_double(scalar, tpp->tp_self, &value) == -1) {
 	_vnacal_error(vcp, VNAERR_SYNTAX, "%s (line %d) error: "
 		"%s: invalid floating point number: \"%s\"",
-		vcp->vc_filename, get_line(scalar), key, s);
+		vcp->vc_filename, get_line(scalar), key,
+		vnaproperty_path_get(scalar, tpp->tp_self));
 	return HUGE_VAL;
     }
     return value;
 }
 
 /*
- * parse_double_from_map: parse a required complex from a mapping
+ * parse_complex_from_map: parse a required complex from a mapping
  *   @vcp: vnacal structure
+ *   @tpp: compiled property expressions
  *   @mapping: mapping to parse
  *   @key: required key
  */
 static double complex parse_complex_from_map(vnacal_t *vcp,
-	const vnaproperty_t *mapping, const char *key)
+	const tree_paths_t *tpp, const vnaproperty_t *mapping, const char *key)
 {
     const vnaproperty_t *scalar;
     double complex value;
 
-    if ((scalar = get_key(vcp, mapping, key, 's')) == NULL) {
+    if ((scalar = get_key(vcp, tpp, mapping, key, 's')) == NULL) {
 	return HUGE_VAL;
     }
-    if ((value = parse_complex(scalar, ".")) == HUGE_VAL) {
+    if (vnaproperty_path_get_complex(scalar, tpp->tp_self, &value) == -1) {
 	_vnacal_error(vcp, VNAERR_SYNTAX, "%s (line %d) error: "
 		"%s: invalid complex number: \"%s\"",
 		vcp->vc_filename, get_line(scalar), key,
-		vnaproperty_get(scalar, "."));
+		vnaproperty_path_get(scalar, tpp->tp_self));
 	return HUGE_VAL;
     }
     return value;
@@ -563,12 +575,13 @@ static double complex parse_complex_from_map(vnacal_t *vcp,
 /*
  * parse_frequency_entry_v0_2: parse a single frequency entry in v0.2
  *   @calp: pointer to calibration structure
+ *   @tpp: compiled property expressions
  *   @vprp_frequency: per-frequency mapping to parse
  *   @error_terms: array of El, Er, Em matrices, each with [cell][findex]
  *   @findex: frequency index
  */
 static int parse_frequency_entry_v0_2(vnacal_calibration_t *calp,
-	const vnaproperty_t *vprp_frequency,
+	const tree_paths_t *tpp, const vnaproperty_t *vprp_frequency,
 	double complex ***error_terms, int findex)
 {
     vnacal_t *vcp = calp->cal_vcp;
@@ -578,18 +591,20 @@ static int parse_frequency_entry_v0_2(vnacal_calibration_t *calp,
     double f;
     int count;
 
-    assert(vnaproperty_type(vprp_frequency, ".") == 'm');
-    if (check_mapping(vcp, vprp_frequency, v0_2_frequency_keys) == -1) {
+    assert(vnaproperty_path_type(vprp_frequency, tpp->tp_self) == 'm');
+    if (check_mapping(vcp, tpp, vprp_frequency, v0_2_frequency_keys) == -1) {
 	return -1;
     }
-    if ((f = parse_double_from_map(vcp, vprp_frequency, "f")) == HUGE_VAL) {
+    if ((f = parse_double_from_map(vcp, tpp, vprp_frequency,
+		    "f")) == HUGE_VAL) {
 	return -1;
     }
     calp->cal_frequency_vector[findex] = f;
-    if ((vprp_error_terms = get_key(vcp, vprp_frequency, "e", 'l')) == NULL) {
+    if ((vprp_error_terms = get_key(vcp, tpp, vprp_frequency, "e",
+		    'l')) == NULL) {
 	return -1;
     }
-    count = vnaproperty_count(vprp_frequency, "e[]");
+    count = vnaproperty_path_count(vprp_error_terms, tpp->tp_list);
     if (count != rows) {
 	_vnacal_error(vcp, VNAERR_SYNTAX, "%s (line %d) error: "
 		"expected %d rows but found %d",
@@ -600,7 +615,8 @@ static int parse_frequency_entry_v0_2(vnacal_calibration_t *calp,
     for (int row = 0; row < rows; ++row) {
 	vnaproperty_t *vprp_row;
 
-	vprp_row = vnaproperty_get_subtree(vprp_error_terms, "[%d][]", row);
+	vprp_row = vnaproperty_path_get_subtree(vprp_error_terms, tpp->tp_row,
+		row);
 	if (vprp_row == NULL) {
 	    _vnacal_error(vcp, VNAERR_SYNTAX, "%s (line %d) error: "
 		    "row %d of matrix must be a sequence",
@@ -608,7 +624,7 @@ static int parse_frequency_entry_v0_2(vnacal_calibration_t *calp,
 		    row);
 	    return -1;
 	}
-	count = vnaproperty_count(vprp_row, "[]");
+	count = vnaproperty_path_count(vprp_row, tpp->tp_list);
 	if (count != columns) {
 	    _vnacal_error(vcp, VNAERR_SYNTAX, "%s (line %d) error: "
 		    "expected row %d of matrix to have %d columns "
@@ -621,9 +637,11 @@ static int parse_frequency_entry_v0_2(vnacal_calibration_t *calp,
 	    const vnaproperty_t *vprp_terms;
 	    const int cell = row * columns + column;
 
-	    vprp_terms = vnaproperty_get_subtree(vprp_row, "[%d][]", column);
+	    vprp_terms = vnaproperty_path_get_subtree(vprp_row, tpp->tp_row,
+		    column);
 	    if (vprp_terms == NULL ||
-		    (count = vnaproperty_count(vprp_terms, "[]")) != 3) {
+		    (count = vnaproperty_path_count(vprp_terms,
+			tpp->tp_list)) != 3) {
 		_vnacal_error(vcp, VNAERR_SYNTAX, "%s (line %d) error: "
 			"matrix[%d][%d] must be a sequence of 3 error terms",
 			vcp->vc_filename, get_line(vprp_terms),
@@ -633,7 +651,7 @@ static int parse_frequency_entry_v0_2(vnacal_calibration_t *calp,
 	    for (int term = 0; term < 3; ++term) {
 		double complex clf;
 
-		clf = parse_complex(vprp_terms, "[%d]", term);
+		clf = parse_complex(tpp, vprp_terms, term);
 		if (clf == HUGE_VAL) {
 		    _vnacal_error(vcp, VNAERR_SYNTAX, "%s (line %d) error: "
 			    "invalid complex number at matrix[%d][%d][%d]",
@@ -650,13 +668,14 @@ static int parse_frequency_entry_v0_2(vnacal_calibration_t *calp,
 
 /*
  * parse_error_term_matrix: parse a single error term vector or matrix
- *   @vcp: vnacal structure
+ *   @tpp: compiled property expressions
  *   @vprp_matrix: matrix to parse
  *   @vetmp: description of matrix to parse
  *   @findex: frequency index
  */
-static int parse_error_term_matrix(const vnaproperty_t *vprp_matrix,
-	vnacal_error_term_matrix_t *vetmp, int findex)
+static int parse_error_term_matrix(const tree_paths_t *tpp,
+	const vnaproperty_t *vprp_matrix, vnacal_error_term_matrix_t *vetmp,
+	int findex)
 {
     vnacal_calibration_t *calp = vetmp->vetm_calp;
     vnacal_t *vcp = calp->cal_vcp;
@@ -665,8 +684,8 @@ static int parse_error_term_matrix(const vnaproperty_t *vprp_matrix,
     const int rows = vetmp->vetm_rows;
     const int columns = vetmp->vetm_columns;
 
-    assert(vnaproperty_type(vprp_matrix, ".") == 'l');
-    count = vnaproperty_count(vprp_matrix, "[]");
+    assert(vnaproperty_path_type(vprp_matrix, tpp->tp_self) == 'l');
+    count = vnaproperty_path_count(vprp_matrix, tpp->tp_list);
     switch (vetmp->vetm_type) {
     case VETM_VECTOR:
 	assert(rows == 1);
@@ -678,8 +697,8 @@ static int parse_error_term_matrix(const vnaproperty_t *vprp_matrix,
 	    return -1;
 	}
 	for (int i = 0; i < vetmp->vetm_columns; ++i) {
-	    if ((matrix[i][findex] = parse_complex(vprp_matrix,
-			    "[%d]", i)) == HUGE_VAL) {
+	    if ((matrix[i][findex] = parse_complex(tpp, vprp_matrix,
+			    i)) == HUGE_VAL) {
 		_vnacal_error(vcp, VNAERR_SYNTAX, "%s (line %d) error: "
 			"invalid complex number in %s vector",
 			vcp->vc_filename, get_line(vprp_matrix),
@@ -701,7 +720,8 @@ static int parse_error_term_matrix(const vnaproperty_t *vprp_matrix,
 	for (int row = 0; row < rows; ++row) {
 	    const vnaproperty_t *vprp_row;
 
-	    vprp_row = vnaproperty_get_subtree(vprp_matrix, "[%d][]", row);
+	    vprp_row = vnaproperty_path_get_subtree(vprp_matrix, tpp->tp_row,
+		    row);
 	    if (vprp_row == NULL) {
 		_vnacal_error(vcp, VNAERR_SYNTAX, "%s (line %d) error: "
 			"row %d of %s matrix must be a sequence",
@@ -709,7 +729,7 @@ static int parse_error_term_matrix(const vnaproperty_t *vprp_matrix,
 			row, vetmp->vetm_name);
 		return -1;
 	    }
-	    count = vnaproperty_count(vprp_row, "[]");
+	    count = vnaproperty_path_count(vprp_row, tpp->tp_list);
 	    if (count != columns) {
 		_vnacal_error(vcp, VNAERR_SYNTAX, "%s (line %d) error: "
 			"expected row %d of %s matrix to have %d columns "
@@ -722,7 +742,7 @@ static int parse_error_term_matrix(const vnaproperty_t *vprp_matrix,
 		if (row != column || vetmp->vetm_type != VETM_MATRIX_ND) {
 		    double complex clf;
 
-		    clf = parse_complex(vprp_row, "[%d]", column);
+		    clf = parse_complex(tpp, vprp_row, column);
 		    if (clf == HUGE_VAL) {
 			_vnacal_error(vcp, VNAERR_SYNTAX, "%s (line %d) error: "
 				"invalid complex number at matrix element "
@@ -733,8 +753,8 @@ static int parse_error_term_matrix(const vnaproperty_t *vprp_matrix,
 		    }
 		    (*matrix++)[findex] = clf;
 		} else {
-		    if (vnaproperty_get_subtree(vprp_row, "[%d]",
-				column) != NULL) {
+		    if (vnaproperty_path_get_subtree(vprp_row,
+				tpp->tp_element, column) != NULL) {
 			_vnacal_error(vcp, VNAERR_SYNTAX, "%s (line %d) error: "
 				"expected diagonal matrix element %s[%d][%d] "
 				"to be null",
@@ -756,54 +776,71 @@ static int parse_error_term_matrix(const vnaproperty_t *vprp_matrix,
 /*
  * parse_frequency_entry: parse a frequency entry of a calibration
  *   @calp: calibration structure we're filling
+ *   @tpp: compiled property expressions
  *   @vprp_frequency: frequency mapping to parse
  *   @matrix_list: list of error term matrix descriptors
  *   @findex: frequency index
  */
 static int parse_frequency_entry(vnacal_calibration_t *calp,
-	const vnaproperty_t *vprp_frequency,
+	const tree_paths_t *tpp, const vnaproperty_t *vprp_frequency,
 	vnacal_error_term_matrix_t *matrix_list, int findex)
 {
     vnacal_t *vcp = calp->cal_vcp;
     double f;
 
-    assert(vnaproperty_type(vprp_frequency, ".") == 'm');
-    if (check_mapping(vcp, vprp_frequency, frequency_keys) == -1) {
+    assert(vnaproperty_path_type(vprp_frequency, tpp->tp_self) == 'm');
+    if (check_mapping(vcp, tpp, vprp_frequency, frequency_keys) == -1) {
 	return -1;
     }
-    if (check_for_stray_matrices(calp, vprp_frequency) == -1) {
+    if (check_for_stray_matrices(calp, tpp, vprp_frequency) == -1) {
 	return -1;
     }
-    if ((f = parse_double_from_map(vcp, vprp_frequency, "f")) == HUGE_VAL) {
+    if ((f = parse_double_from_map(vcp, tpp, vprp_frequency,
+		    "f")) == HUGE_VAL) {
 	return -1;
     }
     calp->cal_frequency_vector[findex] = f;
     if (calp->cal_z0_type == VNACAL_Z0_MATRIX) {
 	const vnaproperty_t *vprp_z0;
 	const int ports = MAX(calp->cal_rows, calp->cal_columns);
+	int count;
 
-	if ((vprp_z0 = get_key(vcp, vprp_frequency, "z0", 'l')) == NULL) {
+	if ((vprp_z0 = get_key(vcp, tpp, vprp_frequency, "z0",
+			'l')) == NULL) {
+	    return -1;
+	}
+	if ((count = vnaproperty_path_count(vprp_z0,
+			tpp->tp_list)) != ports) {
+	    _vnacal_error(vcp, VNAERR_SYNTAX, "%s (line %d) error: "
+		    "expected z0 to have %d elements but found %d",
+		    vcp->vc_filename, get_line(vprp_z0), ports, count);
 	    return -1;
 	}
 	for (int port = 0; port < ports; ++port) {
 	    if ((calp->cal_z0_matrix[port][findex] =
-			parse_complex(vprp_z0, ".")) == HUGE_VAL) {
+			parse_complex(tpp, vprp_z0, port)) == HUGE_VAL) {
 		_vnacal_error(vcp, VNAERR_SYNTAX, "%s (line %d) error: "
 			"invalid complex number at z0[%d]",
 			vcp->vc_filename, get_line(vprp_z0), port);
 		return -1;
 	    }
 	}
+    } else if (vnaproperty_path_get_subtree(vprp_frequency, tpp->tp_key,
+		"z0") != NULL) {
+	_vnacal_error(vcp, VNAERR_SYNTAX, "%s (line %d) error: "
+		"key \"z0\" is not expected here",
+		vcp->vc_filename, get_line(vprp_frequency));
+	return -1;
     }
     for (vnacal_error_term_matrix_t *vetmp = matrix_list; vetmp != NULL;
 	    vetmp = vetmp->vetm_next) {
 	const vnaproperty_t *vprp_matrix;
 
-	if ((vprp_matrix = get_key(vcp, vprp_frequency,
+	if ((vprp_matrix = get_key(vcp, tpp, vprp_frequency,
 			vetmp->vetm_name, 'l')) == NULL) {
 	    return -1;
 	}
-	if (parse_error_term_matrix(vprp_matrix, vetmp, findex) == -1) {
+	if (parse_error_term_matrix(tpp, vprp_matrix, vetmp, findex) == -1) {
 	    return -1;
 	}
     }
@@ -811,63 +848,219 @@ static int parse_frequency_entry(vnacal_calibration_t *calp,
 }
 
 /*
- * parse_calibration: parse a single calibration entry
+ * parse_model: parse the model of one error term
  *   @vcp: vnacal structure
- *   @vprp_calibration: calibration entry to parse
+ *   @tpp: compiled property expressions
+ *   @vprp_model: model mapping
+ *   @vmp: model to fill in
+ */
+static int parse_model(vnacal_t *vcp, const tree_paths_t *tpp,
+	const vnaproperty_t *vprp_model, vnacal_model_t *vmp)
+{
+    const vnaproperty_t *vprp_breakpoints;
+    const vnaproperty_t *vprp_coefficients;
+    int count;
+
+    if (check_mapping(vcp, tpp, vprp_model, model_keys) == -1) {
+	return -1;
+    }
+    if ((vmp->vm_fit_error = parse_double_from_map(vcp, tpp, vprp_model,
+		    "fit_error")) == HUGE_VAL) {
+	return -1;
+    }
+    if ((vprp_breakpoints = get_key(vcp, tpp, vprp_model, "breakpoints",
+		    'l')) == NULL ||
+	    (vprp_coefficients = get_key(vcp, tpp, vprp_model,
+		    "coefficients", 'l')) == NULL) {
+	return -1;
+    }
+    if ((count = vnaproperty_path_count(vprp_breakpoints,
+		    tpp->tp_list)) < 2) {
+	_vnacal_error(vcp, VNAERR_SYNTAX, "%s (line %d) error: "
+		"expected breakpoints to have at least 2 elements "
+		"but found %d",
+		vcp->vc_filename, get_line(vprp_breakpoints), count);
+	return -1;
+    }
+    vmp->vm_segments = count - 1;
+    if ((count = vnaproperty_path_count(vprp_coefficients,
+		    tpp->tp_list)) != vmp->vm_segments) {
+	_vnacal_error(vcp, VNAERR_SYNTAX, "%s (line %d) error: "
+		"expected coefficients to have %d rows but found %d",
+		vcp->vc_filename, get_line(vprp_coefficients),
+		vmp->vm_segments, count);
+	return -1;
+    }
+    if ((vmp->vm_breakpoint_vector = _vnacal_malloc(vcp, (count + 1) *
+		    sizeof(double))) == NULL ||
+	    (vmp->vm_coefficient_vector = _vnacal_malloc(vcp, count *
+		    sizeof(double complex [VNACAL_MODEL_ORDER + 1]))) == NULL) {
+	_vnacal_error(vcp, VNAERR_SYSTEM, "malloc: %s", strerror(errno));
+	return -1;
+    }
+    for (int k = 0; k <= vmp->vm_segments; ++k) {
+	double *bp = vmp->vm_breakpoint_vector;
+
+	if (vnaproperty_path_get_double(vprp_breakpoints, tpp->tp_element,
+		    &bp[k], k) == -1) {
+	    _vnacal_error(vcp, VNAERR_SYNTAX, "%s (line %d) error: "
+		    "invalid floating point number at breakpoints[%d]",
+		    vcp->vc_filename, get_line(vprp_breakpoints), k);
+	    return -1;
+	}
+	if (k > 0 && bp[k] < bp[k - 1]) {
+	    _vnacal_error(vcp, VNAERR_SYNTAX, "%s (line %d) error: "
+		    "breakpoints must be ascending",
+		    vcp->vc_filename, get_line(vprp_breakpoints));
+	    return -1;
+	}
+    }
+    for (int k = 0; k < vmp->vm_segments; ++k) {
+	const vnaproperty_t *vprp_row;
+
+	vprp_row = vnaproperty_path_get_subtree(vprp_coefficients,
+		tpp->tp_row, k);
+	if (vprp_row == NULL) {
+	    _vnacal_error(vcp, VNAERR_SYNTAX, "%s (line %d) error: "
+		    "row %d of coefficients must be a sequence",
+		    vcp->vc_filename, get_line(vprp_coefficients), k);
+	    return -1;
+	}
+	if ((count = vnaproperty_path_count(vprp_row,
+			tpp->tp_list)) != VNACAL_MODEL_ORDER + 1) {
+	    _vnacal_error(vcp, VNAERR_SYNTAX, "%s (line %d) error: "
+		    "expected row %d of coefficients to have %d columns "
+		    "but found %d",
+		    vcp->vc_filename, get_line(vprp_row), k,
+		    VNACAL_MODEL_ORDER + 1, count);
+	    return -1;
+	}
+	for (int j = 0; j <= VNACAL_MODEL_ORDER; ++j) {
+	    if ((vmp->vm_coefficient_vector[k][j] = parse_complex(tpp,
+			    vprp_row, j)) == HUGE_VAL) {
+		_vnacal_error(vcp, VNAERR_SYNTAX, "%s (line %d) error: "
+			"invalid complex number at coefficients[%d][%d]",
+			vcp->vc_filename, get_line(vprp_row), k, j);
+		return -1;
+	    }
+	}
+    }
+    return 0;
+}
+
+/*
+ * parse_models: load the models of a compacted calibration
+ *   @vcp: vnacal structure
+ *   @tpp: compiled property expressions
+ *   @calp: calibration structure we're filling
+ *   @vprp_calibration: calibration mapping
+ *
+ *   The models replace the error term vectors, which are freed.
+ */
+static int parse_models(vnacal_t *vcp, const tree_paths_t *tpp,
+	vnacal_calibration_t *calp, const vnaproperty_t *vprp_calibration)
+{
+    const vnaproperty_t *vprp_models;
+    double tolerance;
+    int count;
+
+    if ((tolerance = parse_double_from_map(vcp, tpp, vprp_calibration,
+		    "compact_tolerance")) == HUGE_VAL) {
+	return -1;
+    }
+    if (!(tolerance > 0.0)) {
+	_vnacal_error(vcp, VNAERR_SYNTAX, "%s (line %d) error: "
+		"compact_tolerance must be positive",
+		vcp->vc_filename, get_line(vprp_calibration));
+	return -1;
+    }
+    if ((vprp_models = get_key(vcp, tpp, vprp_calibration, "models",
+		    'l')) == NULL) {
+	return -1;
+    }
+    if ((count = vnaproperty_path_count(vprp_models,
+		    tpp->tp_list)) != calp->cal_error_terms) {
+	_vnacal_error(vcp, VNAERR_SYNTAX, "%s (line %d) error: "
+		"expected models to have %d elements but found %d",
+		vcp->vc_filename, get_line(vprp_models),
+		calp->cal_error_terms, count);
+	return -1;
+    }
+    _vnacal_calibration_free_error_terms(calp);
+    calp->cal_compact_tolerance = tolerance;
+    if ((calp->cal_error_term_model = _vnacal_calloc(vcp, count,
+		    sizeof(vnacal_model_t))) == NULL) {
+	_vnacal_error(vcp, VNAERR_SYSTEM, "calloc: %s", strerror(errno));
+	return -1;
+    }
+    for (int term = 0; term < count; ++term) {
+	const vnaproperty_t *vprp_model;
+
+	vprp_model = vnaproperty_path_get_subtree(vprp_models,
+		tpp->tp_entry, term);
+	if (vprp_model == NULL) {
+	    _vnacal_error(vcp, VNAERR_SYNTAX, "%s (line %d) error: "
+		    "models[%d] must be a mapping",
+		    vcp->vc_filename, get_line(vprp_models), term);
+	    return -1;
+	}
+	if (parse_model(vcp, tpp, vprp_model,
+		    &calp->cal_error_term_model[term]) == -1) {
+	    return -1;
+	}
+    }
+    return 0;
+}
+
+/*
+ * alloc_calibration: allocate a calibration from the header keys
+ *   @vcp: vnacal structure
+ *   @tpp: compiled property expressions
+ *   @vprp_calibration: calibration mapping
  *   @version: version code
+ *   @vlp: layout structure to fill in
+ *
+ *   Parse type, rows, columns, frequencies, z0 and, for compacted
+ *   calibrations, the error term models, and allocate the calibration
+ *   structure.  The frequency entries are filled in later.
  */
-static int parse_calibration(vnacal_t *vcp,
-	const vnaproperty_t *vprp_calibration,
-	vnacal_version_t version)
+static vnacal_calibration_t *alloc_calibration(vnacal_t *vcp,
+	const tree_paths_t *tpp, const vnaproperty_t *vprp_calibration,
+	vnacal_version_t version, vnacal_layout_t *vlp)
 {
-    const char *name;
     vnacal_type_t type = VNACAL_NOTYPE;
     int rows, columns, frequencies;
-    vnacal_layout_t vl;
     vnacal_calibration_t *calp = NULL;
     const vnaproperty_t *vprp_z0;
     vnacal_z0_type_t z0_type;
-    const vnaproperty_t *vprp_data;
-    int count;
-    vnacal_error_term_matrix_t *matrix_list = NULL;
-    int rc = -1;
 
-    assert(vnaproperty_type(vprp_calibration, ".") == 'm');
-    if (check_mapping(vcp, vprp_calibration, version == V0_2 ?
-		v0_2_calibration_keys : calibration_keys) == -1) {
-	goto out;
-    }
-    if ((name = vnaproperty_get(vprp_calibration, "name")) == NULL) {
-	_vnacal_error(vcp, VNAERR_SYNTAX, "%s (line %d) error: "
-		"expected scalar \"name\"",
-		vcp->vc_filename, get_line(vprp_calibration));
-	goto out;
-    }
     if (version != V0_2) {
-	if ((type = parse_type_from_map(vcp, vprp_calibration, "type")) == -1) {
-	    goto out;
+	if ((type = parse_type_from_map(vcp, tpp, vprp_calibration,
+			"type")) == -1) {
+	    return NULL;
 	}
     } else {
 	type = VNACAL_E12;
     }
     errno = 0;
-    if ((rows = parse_int_from_map(vcp,
+    if ((rows = parse_int_from_map(vcp, tpp,
 		    vprp_calibration, "rows", 1)) == -1) {
-	goto out;
+	return NULL;
     }
-    if ((columns = parse_int_from_map(vcp,
+    if ((columns = parse_int_from_map(vcp, tpp,
 		    vprp_calibration, "columns", 1)) == -1) {
-	goto out;
+	return NULL;
     }
-    if ((frequencies = parse_int_from_map(vcp,
+    if ((frequencies = parse_int_from_map(vcp, tpp,
 		    vprp_calibration, "frequencies", 0)) == -1) {
-	goto out;
+	return NULL;
     }
-    vprp_z0 = vnaproperty_get_subtree(vprp_calibration, "z0");
-    if (version < V1_1) {
+    vprp_z0 = vnaproperty_path_get_subtree(vprp_calibration, tpp->tp_key,
+	    "z0");
+    if (version_older_than(version, V1_1)) {
 	z0_type = VNACAL_Z0_SCALAR;
     } else if (vprp_z0 != NULL) {
-	switch (vnaproperty_type(vprp_z0, ".")) {
+	switch (vnaproperty_path_type(vprp_z0, tpp->tp_self)) {
 	case 's':
 	    z0_type = VNACAL_Z0_SCALAR;
 	    break;
@@ -878,44 +1071,43 @@ static int parse_calibration(vnacal_t *vcp,
 	    _vnacal_error(vcp, VNAERR_SYNTAX, "%s (line %d) error: "
 		    "\"z0\" must be a scalar or a sequence",
 		    vcp->vc_filename, get_line(vprp_z0));
-	    goto out;
+	    return NULL;
 	}
     } else {
 	z0_type = VNACAL_Z0_MATRIX;
     }
-    _vnacal_layout(&vl, type, rows, columns);
+    _vnacal_layout(vlp, type, rows, columns);
     if ((calp = _vnacal_calibration_alloc(vcp, type, rows, columns,
-		    frequencies, z0_type, VL_ERROR_TERMS(&vl))) == NULL) {
-	goto out;
-    }
-    if (version != V0_2) {
-	if (vnaproperty_copy(&calp->cal_properties,
-		vnaproperty_get_subtree(vprp_calibration,
-		    "properties")) == -1) {
-	    _vnacal_error(vcp, VNAERR_SYSTEM, "vnaproperty_copy: %s",
-		    strerror(errno));
-	    goto out;
-	}
+		    frequencies, z0_type, VL_ERROR_TERMS(vlp))) == NULL) {
+	return NULL;
     }
     switch (z0_type) {
     case VNACAL_Z0_SCALAR:
-	if ((calp->cal_z0 = parse_complex_from_map(vcp,
+	if ((calp->cal_z0 = parse_complex_from_map(vcp, tpp,
 			vprp_calibration, "z0")) == HUGE_VAL) {
-	    goto out;
+	    goto error;
 	}
 	break;
 
     case VNACAL_Z0_VECTOR:
 	{
 	    const int ports = MAX(rows, columns);
+	    int count;
 
+	    if ((count = vnaproperty_path_count(vprp_z0,
+			    tpp->tp_list)) != ports) {
+		_vnacal_error(vcp, VNAERR_SYNTAX, "%s (line %d) error: "
+			"expected z0 to have %d elements but found %d",
+			vcp->vc_filename, get_line(vprp_z0), ports, count);
+		goto error;
+	    }
 	    for (int port = 0; port < ports; ++port) {
-		if ((calp->cal_z0_vector[port] = parse_complex(vprp_z0,
-				".")) == HUGE_VAL) {
+		if ((calp->cal_z0_vector[port] = parse_complex(tpp, vprp_z0,
+				port)) == HUGE_VAL) {
 		    _vnacal_error(vcp, VNAERR_SYNTAX, "%s (line %d) error: "
 			    "invalid complex number at z0[%d]",
 			    vcp->vc_filename, get_line(vprp_z0), port);
-		    goto out;
+		    goto error;
 		}
 	    }
 	}
@@ -928,10 +1120,123 @@ static int parse_calibration(vnacal_t *vcp,
     default:
 	abort();
     }
-    if ((vprp_data = get_key(vcp, vprp_calibration, "data", 'l')) == NULL) {
+    if (vnaproperty_path_get_subtree(vprp_calibration, tpp->tp_key,
+		"models") != NULL) {
+	if (parse_models(vcp, tpp, calp, vprp_calibration) == -1) {
+	    goto error;
+	}
+    } else if (vnaproperty_path_get_subtree(vprp_calibration, tpp->tp_key,
+		"compact_tolerance") != NULL) {
+	_vnacal_error(vcp, VNAERR_SYNTAX, "vnacal_load: %s (line %d): "
+		"missing required key models",
+		vcp->vc_filename, get_line(vprp_calibration));
+	goto error;
+    }
+    return calp;
+
+error:
+    _vnacal_calibration_free(calp);
+    return NULL;
+}
+
+/*
+ * finish_calibration: check a filled-in calibration and add it to vcp
+ *   @vcp: vnacal structure
+ *   @tpp: compiled property expressions
+ *   @calp: calibration structure
+ *   @vprp_calibration: calibration mapping
+ *   @version: version code
+ *
+ *   On success, vcp takes ownership of calp.
+ */
+static int finish_calibration(vnacal_t *vcp, const tree_paths_t *tpp,
+	vnacal_calibration_t *calp, const vnaproperty_t *vprp_calibration,
+	vnacal_version_t version)
+{
+    const vnaproperty_t *vprp_interpolation;
+    const char *name;
+
+    if ((name = vnaproperty_path_get(vprp_calibration, tpp->tp_key,
+		    "name")) == NULL) {
+	_vnacal_error(vcp, VNAERR_SYNTAX, "%s (line %d) error: "
+		"expected scalar \"name\"",
+		vcp->vc_filename, get_line(vprp_calibration));
+	return -1;
+    }
+    if (version != V0_2) {
+	if (_vnaproperty_copy(&vcp->vc_allocator, &calp->cal_properties,
+		vnaproperty_path_get_subtree(vprp_calibration,
+		    tpp->tp_key, "properties")) == -1) {
+	    _vnacal_error(vcp, VNAERR_SYSTEM, "vnaproperty_copy: %s",
+		    strerror(errno));
+	    return -1;
+	}
+    }
+    if ((vprp_interpolation = vnaproperty_path_get_subtree(vprp_calibration,
+		    tpp->tp_key, "interpolation")) != NULL) {
+	const char *method_name;
+
+	method_name = vnaproperty_path_get(vprp_interpolation, tpp->tp_self);
+	if (method_name == NULL || (calp->cal_interpolation =
+		    vnacal_name_to_interpolation(method_name)) ==
+		VNACAL_INTERP_INVALID) {
+	    _vnacal_error(vcp, VNAERR_SYNTAX, "%s (line %d) error: "
+		    "invalid interpolation method",
+		    vcp->vc_filename, get_line(vprp_interpolation));
+	    return -1;
+	}
+    }
+    for (int findex = 1; findex < calp->cal_frequencies; ++findex) {
+	if (calp->cal_frequency_vector[findex - 1] >=
+	    calp->cal_frequency_vector[findex]) {
+	    _vnacal_error(vcp, VNAERR_SYNTAX, "%s (line %d) error: "
+		    "frequencies must be ascending",
+		    vcp->vc_filename, get_line(vprp_calibration));
+	    return -1;
+	}
+    }
+    if (_vnacal_add_calibration_common("vnacal_load", vcp, calp, name) == -1) {
+	return -1;
+    }
+    return 0;
+}
+
+/*
+ * parse_calibration: parse a single calibration entry
+ *   @vcp: vnacal structure
+ *   @tpp: compiled property expressions
+ *   @vprp_calibration: calibration entry to parse
+ *   @version: version code
+ */
+static int parse_calibration(vnacal_t *vcp, const tree_paths_t *tpp,
+	const vnaproperty_t *vprp_calibration,
+	vnacal_version_t version)
+{
+    vnacal_layout_t vl;
+    vnacal_calibration_t *calp = NULL;
+    const vnaproperty_t *vprp_data;
+    int rows, columns, frequencies;
+    int count;
+    vnacal_error_term_matrix_t *matrix_list = NULL;
+    int rc = -1;
+
+    assert(vnaproperty_path_type(vprp_calibration, tpp->tp_self) == 'm');
+    if (check_mapping(vcp, tpp, vprp_calibration, version == V0_2 ?
+		v0_2_calibration_keys : calibration_keys) == -1) {
+	goto out;
+    }
+    if ((calp = alloc_calibration(vcp, tpp, vprp_calibration, version,
+		    &vl)) == NULL) {
 	goto out;
     }
-    count = vnaproperty_count(vprp_data, "[]");
+    rows = calp->cal_rows;
+    columns = calp->cal_columns;
+    frequencies = calp->cal_frequencies;
+    if ((vprp_data = get_key(vcp, tpp, vprp_calibration, "data",
+		    'l')) == NULL) {
+	goto out;
+    }
+    count = vnaproperty_path_count(vprp_data, tpp->tp_list);
     if (count != frequencies) {
 	_vnacal_error(vcp, VNAERR_SYNTAX, "%s (line %d) error: "
 		"expected %d frequency entries, but found %d",
@@ -939,7 +1244,8 @@ static int parse_calibration(vnacal_t *vcp,
 		frequencies, count);
 	goto out;
     }
-    if (_vnacal_build_error_term_list(calp, &vl, &matrix_list) == -1) {
+    if (calp->cal_error_term_vector != NULL &&
+	    _vnacal_build_error_term_list(calp, &vl, &matrix_list) == -1) {
 	goto out;
     }
     if (version == V0_2) {
@@ -958,9 +1264,15 @@ static int parse_calibration(vnacal_t *vcp,
 	for (int findex = 0; findex < frequencies; ++findex) {
 	    const vnaproperty_t *vprp_frequency;
 
-	    vprp_frequency = vnaproperty_get_subtree(vprp_data, "[%d]", findex);
-	    assert(vprp_frequency != NULL);
-	    if (parse_frequency_entry_v0_2(calp, vprp_frequency,
+	    vprp_frequency = vnaproperty_path_get_subtree(vprp_data,
+		    tpp->tp_entry, findex);
+	    if (vprp_frequency == NULL) {
+		_vnacal_error(vcp, VNAERR_SYNTAX, "%s (line %d) error: "
+			"data[%d] must be a mapping",
+			vcp->vc_filename, get_line(vprp_data), findex);
+		goto out;
+	    }
+	    if (parse_frequency_entry_v0_2(calp, tpp, vprp_frequency,
 			error_terms, findex) == -1) {
 		goto out;
 	    }
@@ -970,81 +1282,1428 @@ static int parse_calibration(vnacal_t *vcp,
 	for (int findex = 0; findex < frequencies; ++findex) {
 	    const vnaproperty_t *vprp_frequency;
 
-	    vprp_frequency = vnaproperty_get_subtree(vprp_data, "[%d]", findex);
-	    assert(vprp_frequency != NULL);
-	    if (parse_frequency_entry(calp, vprp_frequency,
+	    vprp_frequency = vnaproperty_path_get_subtree(vprp_data,
+		    tpp->tp_entry, findex);
+	    if (vprp_frequency == NULL) {
+		_vnacal_error(vcp, VNAERR_SYNTAX, "%s (line %d) error: "
+			"data[%d] must be a mapping",
+			vcp->vc_filename, get_line(vprp_data), findex);
+		goto out;
+	    }
+	    if (parse_frequency_entry(calp, tpp, vprp_frequency,
 			matrix_list, findex) == -1) {
 		goto out;
 	    }
 	}
     }
-    for (int findex = 1; findex < frequencies; ++findex) {
-	if (calp->cal_frequency_vector[findex - 1] >=
-	    calp->cal_frequency_vector[findex]) {
+    if (finish_calibration(vcp, tpp, calp, vprp_calibration,
+		version) == -1) {
+	goto out;
+    }
+    calp = NULL;
+    rc = 0;
+
+out:
+    _vnacal_free_error_term_matrices(vcp, &matrix_list);
+    _vnacal_calibration_free(calp);
+    return rc;
+}
+
+
+/***********************************************************************
+ * Event-Driven Loading
+ *
+ * Rather than loading the whole YAML document into memory, converting
+ * it to a property tree and then parsing the tree, we walk the parser
+ * events directly and store the error terms straight into the
+ * calibration vectors.  Only the small pieces of the file that are
+ * naturally trees -- the calibration header keys and the user
+ * properties -- are built as property trees.  If a calibration's data
+ * comes before the header keys needed to allocate it, or if the file
+ * is in the old 0.2 format, we fall back to building the calibration
+ * as a property tree and parsing it with the functions above.
+ **********************************************************************/
+
+/*
+ * char_offset_t: correction from a character index to a byte offset
+ *
+ *   The libyaml marks count characters of the text given to libyaml,
+ *   but to find a calibration in the file again, vnacal_load_lazy needs
+ *   bytes and lines of the file.  Characters at or after co_index start
+ *   co_extra bytes and co_lines lines beyond their position in the text.
+ */
+typedef struct char_offset {
+    size_t co_index;
+    size_t co_extra;
+    size_t co_lines;
+} char_offset_t;
+
+/*
+ * load_mode_t: how load_file handles the calibrations
+ */
+typedef enum load_mode {
+    LOAD_ALL,			/* load everything */
+    LOAD_INDEX,			/* index the calibrations */
+    LOAD_INDEX_FILTERED		/* index, dropping data blocks as text */
+} load_mode_t;
+
+/*
+ * load_state_t: state of the event-driven loader
+ */
+typedef struct load_state {
+    vnacal_t		       *ls_vcp;		/* vnacal structure */
+    vnacal_version_t		ls_version;	/* file version */
+    yaml_parser_t		ls_parser;	/* libyaml parser */
+    yaml_event_t		ls_event;	/* current event */
+    bool			ls_have_event;	/* ls_event is valid */
+    vnaproperty_yaml_t		ls_vyml;	/* for property subtrees */
+    tree_paths_t		ls_paths;	/* for property subtrees */
+
+    /* used only by vnacal_load_lazy */
+    bool			ls_lazy;	/* index calibrations only */
+    bool			ls_filter;	/* drop data blocks */
+    FILE		       *ls_fp;		/* input file */
+    long			ls_base;	/* file offset of YAML text */
+    char		       *ls_line;	/* current line */
+    size_t			ls_line_allocation;
+    size_t			ls_line_length;
+    size_t			ls_line_position; /* bytes given to libyaml */
+    bool			ls_in_calibrations; /* in calibrations[] */
+    int				ls_entry_column; /* "- " column or -1 */
+    int				ls_key_column;	/* calibration key column */
+    int				ls_data_column;	/* data key column or -1 */
+    size_t			ls_characters;	/* characters read */
+    size_t			ls_extra;	/* bytes beyond characters */
+    size_t			ls_lines_dropped; /* lines dropped */
+    char_offset_t	       *ls_offsets;	/* multibyte corrections */
+    int				ls_offset_count;
+    int				ls_offset_allocation;
+} load_state_t;
+
+/*
+ * EVENT_LINE: line number of the current event (+1 for version line)
+ */
+#define EVENT_LINE(lsp)	((int)(lsp)->ls_event.start_mark.line + 2)
+
+/*
+ * EVENT_TEXT: text of the current scalar event
+ */
+#define EVENT_TEXT(lsp)	((const char *)(lsp)->ls_event.data.scalar.value)
+
+/*
+ * fetch_event: replace the current event with the next from the parser
+ *   @lsp: load state
+ */
+static int fetch_event(load_state_t *lsp)
+{
+    vnacal_t *vcp = lsp->ls_vcp;
+
+    if (lsp->ls_have_event) {
+	yaml_event_delete(&lsp->ls_event);
+	lsp->ls_have_event = false;
+    }
+    if (!yaml_parser_parse(&lsp->ls_parser, &lsp->ls_event)) {
+	_vnacal_error(vcp, VNAERR_SYNTAX, "%s (line %ld) error: %s",
+		vcp->vc_filename, (long)lsp->ls_parser.problem_mark.line + 2,
+		lsp->ls_parser.problem);
+	return -1;
+    }
+    lsp->ls_have_event = true;
+    return 0;
+}
+
+/*
+ * next_event: advance to the next event, rejecting aliases
+ *   @lsp: load state
+ *
+ *   Aliases are supported only within nodes built as property trees.
+ */
+static int next_event(load_state_t *lsp)
+{
+    vnacal_t *vcp = lsp->ls_vcp;
+
+    if (fetch_event(lsp) == -1) {
+	return -1;
+    }
+    if (lsp->ls_event.type == YAML_ALIAS_EVENT) {
+	_vnacal_error(vcp, VNAERR_SYNTAX, "%s (line %d) error: "
+		"YAML alias not allowed here",
+		vcp->vc_filename, EVENT_LINE(lsp));
+	return -1;
+    }
+    return 0;
+}
+
+/*
+ * build_node: build a property subtree from the node at the current event
+ *   @lsp: load state
+ *   @rootptr: address of property tree root
+ */
+static int build_node(load_state_t *lsp, vnaproperty_t **rootptr)
+{
+    return _vnaproperty_yaml_parse(&lsp->ls_vyml, rootptr,
+	    (void *)&lsp->ls_parser, (void *)&lsp->ls_event);
+}
+
+/*
+ * skip_node: advance to the last event of the node at the current event
+ *   @lsp: load state
+ */
+static int skip_node(load_state_t *lsp)
+{
+    int depth = 0;
+
+    for (;;) {
+	switch (lsp->ls_event.type) {
+	case YAML_SEQUENCE_START_EVENT:
+	case YAML_MAPPING_START_EVENT:
+	    ++depth;
+	    break;
+
+	case YAML_SEQUENCE_END_EVENT:
+	case YAML_MAPPING_END_EVENT:
+	    --depth;
+	    break;
+
+	default:
+	    break;
+	}
+	if (depth == 0) {
+	    return 0;
+	}
+	if (fetch_event(lsp) == -1) {
+	    return -1;
+	}
+    }
+}
+
+/*
+ * check_key: check that the current event is a scalar mapping key
+ *   @lsp: load state
+ *
+ *   As in the property tree import, non-scalar keys are ignored with
+ *   a warning.  Return 1 if the key is a scalar, 0 if the key and its
+ *   value were skipped, or -1 on error.
+ */
+static int check_key(load_state_t *lsp)
+{
+    vnacal_t *vcp = lsp->ls_vcp;
+
+    if (lsp->ls_event.type == YAML_SCALAR_EVENT) {
+	return 1;
+    }
+    _vnacal_error(vcp, VNAERR_WARNING, "%s (line %d) warning: "
+	    "non-scalar property key ignored\n",
+	    vcp->vc_filename, EVENT_LINE(lsp));
+    if (skip_node(lsp) == -1 || fetch_event(lsp) == -1 ||
+	    skip_node(lsp) == -1) {
+	return -1;
+    }
+    return 0;
+}
+
+/*
+ * unexpected_key: report an unexpected key at the current event
+ *   @lsp: load state
+ */
+static void unexpected_key(load_state_t *lsp)
+{
+    vnacal_t *vcp = lsp->ls_vcp;
+
+    _vnacal_error(vcp, VNAERR_SYNTAX, "vnacal_load: %s (line %d): "
+	    "error: unexpected key: %s", vcp->vc_filename,
+	    EVENT_LINE(lsp), EVENT_TEXT(lsp));
+}
+
+/*
+ * not_a_sequence: report that the value of key must be a sequence
+ *   @lsp: load state
+ *   @key: name of the key
+ */
+static void not_a_sequence(load_state_t *lsp, const char *key)
+{
+    vnacal_t *vcp = lsp->ls_vcp;
+
+    _vnacal_error(vcp, VNAERR_SYNTAX, "vnacal_load: %s (line %d): "
+	    "\"%s\" must be a sequence",
+	    vcp->vc_filename, EVENT_LINE(lsp), key);
+}
+
+/*
+ * event_is_null: test if the current event is a null scalar
+ *   @lsp: load state
+ */
+static bool event_is_null(const load_state_t *lsp)
+{
+    const char *s;
+
+    if (lsp->ls_event.type != YAML_SCALAR_EVENT ||
+	    lsp->ls_event.data.scalar.style != YAML_PLAIN_SCALAR_STYLE) {
+	return false;
+    }
+    s = EVENT_TEXT(lsp);
+    return (s[0] == '~' && s[1] == '\000') ||
+	strcmp(s, "null") == 0 ||
+	strcmp(s, "Null") == 0 ||
+	strcmp(s, "NULL") == 0;
+}
+
+/*
+ * event_complex: parse a complex number from the current event
+ *   @lsp: load state
+ *
+ *   Return HUGE_VAL if the event isn't a scalar or isn't a valid
+ *   complex number.
+ */
+static double complex event_complex(const load_state_t *lsp)
+{
+    if (lsp->ls_event.type != YAML_SCALAR_EVENT || event_is_null(lsp)) {
+	return HUGE_VAL;
+    }
+    return _vnaproperty_parse_complex(EVENT_TEXT(lsp));
+}
+
+/*
+ * load_error_term_matrix: load a single error term vector or matrix
+ *   @lsp: load state
+ *   @vetmp: description of matrix to load
+ *   @findex: frequency index
+ */
+static int load_error_term_matrix(load_state_t *lsp,
+	vnacal_error_term_matrix_t *vetmp, int findex)
+{
+    vnacal_t *vcp = lsp->ls_vcp;
+    double complex **matrix = vetmp->vetm_matrix;
+    const int rows = vetmp->vetm_rows;
+    const int columns = vetmp->vetm_columns;
+    const int line = EVENT_LINE(lsp);
+    int count;
+
+    if (lsp->ls_event.type != YAML_SEQUENCE_START_EVENT) {
+	not_a_sequence(lsp, vetmp->vetm_name);
+	return -1;
+    }
+    switch (vetmp->vetm_type) {
+    case VETM_VECTOR:
+	assert(rows == 1);
+	for (count = 0; ; ++count) {
+	    if (next_event(lsp) == -1) {
+		return -1;
+	    }
+	    if (lsp->ls_event.type == YAML_SEQUENCE_END_EVENT) {
+		break;
+	    }
+	    if (count >= columns) {
+		if (skip_node(lsp) == -1) {
+		    return -1;
+		}
+		continue;
+	    }
+	    if ((matrix[count][findex] = event_complex(lsp)) == HUGE_VAL) {
+		_vnacal_error(vcp, VNAERR_SYNTAX, "%s (line %d) error: "
+			"invalid complex number in %s vector",
+			vcp->vc_filename, EVENT_LINE(lsp),
+			vetmp->vetm_name);
+		return -1;
+	    }
+	}
+	if (count != columns) {
+	    _vnacal_error(vcp, VNAERR_SYNTAX, "%s (line %d) error: "
+		    "expected %s vector to have %d elements but found %d",
+		    vcp->vc_filename, line, vetmp->vetm_name, columns, count);
+	    return -1;
+	}
+	break;
+
+    case VETM_MATRIX_ND:
+    case VETM_MATRIX:
+	for (count = 0; ; ++count) {
+	    const int row = count;
+	    int column;
+
+	    if (next_event(lsp) == -1) {
+		return -1;
+	    }
+	    if (lsp->ls_event.type == YAML_SEQUENCE_END_EVENT) {
+		break;
+	    }
+	    if (row >= rows) {
+		if (skip_node(lsp) == -1) {
+		    return -1;
+		}
+		continue;
+	    }
+	    if (lsp->ls_event.type != YAML_SEQUENCE_START_EVENT) {
+		_vnacal_error(vcp, VNAERR_SYNTAX, "%s (line %d) error: "
+			"row %d of %s matrix must be a sequence",
+			vcp->vc_filename, EVENT_LINE(lsp),
+			row, vetmp->vetm_name);
+		return -1;
+	    }
+	    for (column = 0; ; ++column) {
+		if (next_event(lsp) == -1) {
+		    return -1;
+		}
+		if (lsp->ls_event.type == YAML_SEQUENCE_END_EVENT) {
+		    break;
+		}
+		if (column >= columns) {
+		    if (skip_node(lsp) == -1) {
+			return -1;
+		    }
+		    continue;
+		}
+		if (row != column || vetmp->vetm_type != VETM_MATRIX_ND) {
+		    double complex clf;
+
+		    if ((clf = event_complex(lsp)) == HUGE_VAL) {
+			_vnacal_error(vcp, VNAERR_SYNTAX,
+				"%s (line %d) error: "
+				"invalid complex number at matrix element "
+				"%s[%d][%d]",
+				vcp->vc_filename, EVENT_LINE(lsp),
+				vetmp->vetm_name, row, column);
+			return -1;
+		    }
+		    (*matrix++)[findex] = clf;
+		} else if (!event_is_null(lsp)) {
+		    _vnacal_error(vcp, VNAERR_SYNTAX, "%s (line %d) error: "
+			    "expected diagonal matrix element %s[%d][%d] "
+			    "to be null",
+			    vcp->vc_filename, EVENT_LINE(lsp),
+			    vetmp->vetm_name, row, column);
+		    return -1;
+		}
+	    }
+	    if (column != columns) {
+		_vnacal_error(vcp, VNAERR_SYNTAX, "%s (line %d) error: "
+			"expected row %d of %s matrix to have %d columns "
+			"but found %d",
+			vcp->vc_filename, line,
+			row, vetmp->vetm_name, columns, column);
+		return -1;
+	    }
+	}
+	if (count != rows) {
+	    _vnacal_error(vcp, VNAERR_SYNTAX, "%s (line %d) error: "
+		    "expected %s matrix to have %d rows but found %d",
+		    vcp->vc_filename, line, vetmp->vetm_name, rows, count);
+	    return -1;
+	}
+	break;
+
+    default:
+	abort();
+    }
+    return 0;
+}
+
+/*
+ * load_z0_entry: load the per-frequency reference impedances
+ *   @lsp: load state
+ *   @calp: calibration structure we're filling
+ *   @findex: frequency index
+ */
+static int load_z0_entry(load_state_t *lsp, vnacal_calibration_t *calp,
+	int findex)
+{
+    vnacal_t *vcp = lsp->ls_vcp;
+    const int ports = MAX(calp->cal_rows, calp->cal_columns);
+    const int line = EVENT_LINE(lsp);
+    int port;
+
+    if (lsp->ls_event.type != YAML_SEQUENCE_START_EVENT) {
+	not_a_sequence(lsp, "z0");
+	return -1;
+    }
+    for (port = 0; ; ++port) {
+	if (next_event(lsp) == -1) {
+	    return -1;
+	}
+	if (lsp->ls_event.type == YAML_SEQUENCE_END_EVENT) {
+	    break;
+	}
+	if (port >= ports) {
+	    if (skip_node(lsp) == -1) {
+		return -1;
+	    }
+	    continue;
+	}
+	if ((calp->cal_z0_matrix[port][findex] =
+		    event_complex(lsp)) == HUGE_VAL) {
+	    _vnacal_error(vcp, VNAERR_SYNTAX, "%s (line %d) error: "
+		    "invalid complex number at z0[%d]",
+		    vcp->vc_filename, EVENT_LINE(lsp), port);
+	    return -1;
+	}
+    }
+    if (port != ports) {
+	_vnacal_error(vcp, VNAERR_SYNTAX, "%s (line %d) error: "
+		"expected z0 to have %d elements but found %d",
+		vcp->vc_filename, line, ports, port);
+	return -1;
+    }
+    return 0;
+}
+
+/*
+ * load_frequency_entry: load a frequency entry of a calibration
+ *   @lsp: load state
+ *   @calp: calibration structure we're filling
+ *   @matrix_list: list of error term matrix descriptors
+ *   @findex: frequency index
+ */
+static int load_frequency_entry(load_state_t *lsp,
+	vnacal_calibration_t *calp,
+	vnacal_error_term_matrix_t *matrix_list, int findex)
+{
+    vnacal_t *vcp = lsp->ls_vcp;
+    const int line = EVENT_LINE(lsp);
+    bool have_f = false;
+    bool have_z0 = false;
+    uint32_t seen = 0;	/* mask of matrices seen by list position */
+    int position;
+
+    assert(lsp->ls_event.type == YAML_MAPPING_START_EVENT);
+    for (;;) {
+	vnacal_error_term_matrix_t *vetmp;
+	const char *key;
+	int rv;
+
+	if (next_event(lsp) == -1) {
+	    return -1;
+	}
+	if (lsp->ls_event.type == YAML_MAPPING_END_EVENT) {
+	    break;
+	}
+	if ((rv = check_key(lsp)) == -1) {
+	    return -1;
+	}
+	if (rv == 0) {
+	    continue;
+	}
+	key = EVENT_TEXT(lsp);
+
+	/*
+	 * Handle the frequency.
+	 */
+	if (strcmp(key, "f") == 0) {
+	    const char *s;
+	    char *e;
+
+	    if (next_event(lsp) == -1) {
+		return -1;
+	    }
+	    if (lsp->ls_event.type != YAML_SCALAR_EVENT) {
+		_vnacal_error(vcp, VNAERR_SYNTAX, "vnacal_load: %s (line %d): "
+			"\"f\" must be a scalar",
+			vcp->vc_filename, EVENT_LINE(lsp));
+		return -1;
+	    }
+	    s = EVENT_TEXT(lsp);
+	    calp->cal_frequency_vector[findex] = strtod(s, &e);
+	    if (*s == '\000' || *e != '\000') {
+		_vnacal_error(vcp, VNAERR_SYNTAX, "%s (line %d) error: "
+			"f: invalid floating point number: \"%s\"",
+			vcp->vc_filename, EVENT_LINE(lsp), s);
+		return -1;
+	    }
+	    have_f = true;
+	    continue;
+	}
+
+	/*
+	 * Handle per-frequency reference impedances.
+	 */
+	if (strcmp(key, "z0") == 0 && calp->cal_z0_type == VNACAL_Z0_MATRIX) {
+	    if (next_event(lsp) == -1) {
+		return -1;
+	    }
+	    if (load_z0_entry(lsp, calp, findex) == -1) {
+		return -1;
+	    }
+	    have_z0 = true;
+	    continue;
+	}
+
+	/*
+	 * Handle error term matrices.  Matrices not in the list are
+	 * from a different calibration type.
+	 */
+	position = 0;
+	for (vetmp = matrix_list; vetmp != NULL; vetmp = vetmp->vetm_next) {
+	    if (strcmp(key, vetmp->vetm_name) == 0) {
+		break;
+	    }
+	    ++position;
+	}
+	if (vetmp == NULL) {
+	    int i;
+
+	    for (i = 0; i < N_MATRIX_NAMES; ++i) {
+		if (strcmp(key, matrix_names[i]) == 0) {
+		    break;
+		}
+	    }
+	    if (i < N_MATRIX_NAMES || strcmp(key, "z0") == 0) {
+		_vnacal_error(vcp, VNAERR_SYNTAX, "%s (line %d) error: "
+			"key \"%s\" is not expected here",
+			vcp->vc_filename, EVENT_LINE(lsp), key);
+	    } else {
+		unexpected_key(lsp);
+	    }
+	    return -1;
+	}
+	if (next_event(lsp) == -1) {
+	    return -1;
+	}
+	if (load_error_term_matrix(lsp, vetmp, findex) == -1) {
+	    return -1;
+	}
+	seen |= 1U << position;
+    }
+
+    /*
+     * Check for missing keys.
+     */
+    if (!have_f) {
+	_vnacal_error(vcp, VNAERR_SYNTAX, "vnacal_load: %s (line %d): "
+		"missing required key f", vcp->vc_filename, line);
+	return -1;
+    }
+    if (calp->cal_z0_type == VNACAL_Z0_MATRIX && !have_z0) {
+	_vnacal_error(vcp, VNAERR_SYNTAX, "vnacal_load: %s (line %d): "
+		"missing required key z0", vcp->vc_filename, line);
+	return -1;
+    }
+    position = 0;
+    for (vnacal_error_term_matrix_t *vetmp = matrix_list; vetmp != NULL;
+	    vetmp = vetmp->vetm_next) {
+	if (!(seen & (1U << position))) {
+	    _vnacal_error(vcp, VNAERR_SYNTAX, "vnacal_load: %s (line %d): "
+		    "missing required key %s",
+		    vcp->vc_filename, line, vetmp->vetm_name);
+	    return -1;
+	}
+	++position;
+    }
+    return 0;
+}
+
+/*
+ * load_data: load the per-frequency entries of a calibration
+ *   @lsp: load state
+ *   @calp: calibration structure we're filling
+ *   @matrix_list: list of error term matrix descriptors
+ */
+static int load_data(load_state_t *lsp, vnacal_calibration_t *calp,
+	vnacal_error_term_matrix_t *matrix_list)
+{
+    vnacal_t *vcp = lsp->ls_vcp;
+    const int frequencies = calp->cal_frequencies;
+    const int line = EVENT_LINE(lsp);
+    int findex;
+
+    if (lsp->ls_event.type != YAML_SEQUENCE_START_EVENT) {
+	not_a_sequence(lsp, "data");
+	return -1;
+    }
+    for (findex = 0; ; ++findex) {
+	if (next_event(lsp) == -1) {
+	    return -1;
+	}
+	if (lsp->ls_event.type == YAML_SEQUENCE_END_EVENT) {
+	    break;
+	}
+	if (findex >= frequencies) {
+	    if (skip_node(lsp) == -1) {
+		return -1;
+	    }
+	    continue;
+	}
+	if (lsp->ls_event.type != YAML_MAPPING_START_EVENT) {
 	    _vnacal_error(vcp, VNAERR_SYNTAX, "%s (line %d) error: "
-		    "frequencies must be ascending",
-		    vcp->vc_filename, get_line(vprp_calibration));
+		    "data[%d] must be a mapping",
+		    vcp->vc_filename, EVENT_LINE(lsp), findex);
+	    return -1;
+	}
+	if (load_frequency_entry(lsp, calp, matrix_list, findex) == -1) {
+	    return -1;
+	}
+    }
+    if (findex != frequencies) {
+	_vnacal_error(vcp, VNAERR_SYNTAX, "%s (line %d) error: "
+		"expected %d frequency entries, but found %d",
+		vcp->vc_filename, line, frequencies, findex);
+	return -1;
+    }
+    return 0;
+}
+
+/*
+ * can_load_data: test if enough of the header has been seen to load data
+ *   @vprp_calibration: calibration header keys seen so far
+ *   @version: version code
+ *
+ *   In version 1.1, a missing z0 means that the reference impedances
+ *   are given per frequency.  Because vnacal_save writes z0 before
+ *   the data, we assume that case if z0 hasn't been seen yet.
+ */
+static bool can_load_data(const tree_paths_t *tpp,
+	const vnaproperty_t *vprp_calibration, vnacal_version_t version)
+{
+    static const char *required_keys[] = {
+	"type", "rows", "columns", "frequencies", NULL
+    };
+
+    for (const char **key = required_keys; *key != NULL; ++key) {
+	if (vnaproperty_path_get_subtree(vprp_calibration, tpp->tp_key,
+		    *key) == NULL) {
+	    return false;
+	}
+    }
+    if (version > V1_1 &&	/* older than 1.1 */
+	    vnaproperty_path_get_subtree(vprp_calibration, tpp->tp_key,
+		"z0") == NULL) {
+	return false;
+    }
+    return true;
+}
+
+/*
+ * load_calibration: load a single calibration entry
+ *   @lsp: load state
+ */
+static int load_calibration(load_state_t *lsp)
+{
+    vnacal_t *vcp = lsp->ls_vcp;
+    const vnacal_version_t version = lsp->ls_version;
+    vnaproperty_t *vprp_calibration = NULL;
+    vnacal_calibration_t *calp = NULL;
+    vnacal_error_term_matrix_t *matrix_list = NULL;
+    int rc = -1;
+
+    assert(lsp->ls_event.type == YAML_MAPPING_START_EVENT);
+    if (vnaproperty_set_subtree(&vprp_calibration, "{}") == NULL) {
+	_vnacal_error(vcp, VNAERR_SYSTEM, "vnaproperty_set_subtree: %s",
+		strerror(errno));
+	goto out;
+    }
+    vprp_calibration->vpr_line = lsp->ls_event.start_mark.line;
+    for (;;) {
+	const char *key;
+	const char **cpp;
+	vnaproperty_t **subtree;
+	int rv;
+
+	if (next_event(lsp) == -1) {
+	    goto out;
+	}
+	if (lsp->ls_event.type == YAML_MAPPING_END_EVENT) {
+	    break;
+	}
+	if ((rv = check_key(lsp)) == -1) {
+	    goto out;
+	}
+	if (rv == 0) {
+	    continue;
+	}
+	key = EVENT_TEXT(lsp);
+	for (cpp = calibration_keys; *cpp != NULL; ++cpp) {
+	    if (strcmp(key, *cpp) == 0) {
+		break;
+	    }
+	}
+	if (*cpp == NULL) {
+	    unexpected_key(lsp);
+	    goto out;
+	}
+
+	/*
+	 * Once the data have been loaded, only the name and properties
+	 * may follow.
+	 */
+	if (calp != NULL && strcmp(key, "name") != 0 &&
+		strcmp(key, "properties") != 0) {
+	    _vnacal_error(vcp, VNAERR_SYNTAX, "%s (line %d) error: "
+		    "\"%s\" must come before \"data\"",
+		    vcp->vc_filename, EVENT_LINE(lsp), key);
+	    goto out;
+	}
+
+	/*
+	 * If we have the header, load the data directly into the
+	 * calibration structure.
+	 */
+	if (strcmp(key, "data") == 0 &&
+		can_load_data(&lsp->ls_paths, vprp_calibration, version)) {
+	    vnacal_layout_t vl;
+
+	    if ((calp = alloc_calibration(vcp, &lsp->ls_paths,
+			    vprp_calibration, version, &vl)) == NULL) {
+		goto out;
+	    }
+	    if (calp->cal_error_term_vector != NULL &&
+		    _vnacal_build_error_term_list(calp, &vl,
+			&matrix_list) == -1) {
+		goto out;
+	    }
+	    if (next_event(lsp) == -1) {
+		goto out;
+	    }
+	    if (load_data(lsp, calp, matrix_list) == -1) {
+		goto out;
+	    }
+	    continue;
+	}
+
+	/*
+	 * Otherwise, add the key to the property tree.
+	 */
+	if ((subtree = vnaproperty_set_subtree(&vprp_calibration,
+			"%s", key)) == NULL) {
+	    _vnacal_error(vcp, VNAERR_SYSTEM, "vnaproperty_set_subtree: %s",
+		    strerror(errno));
+	    goto out;
+	}
+	if (fetch_event(lsp) == -1 || build_node(lsp, subtree) == -1) {
+	    goto out;
+	}
+    }
+
+    /*
+     * If the data came before the header, parse the tree.
+     */
+    if (calp == NULL) {
+	rc = parse_calibration(vcp, &lsp->ls_paths, vprp_calibration,
+		version);
+	goto out;
+    }
+    if (finish_calibration(vcp, &lsp->ls_paths, calp, vprp_calibration,
+		version) == -1) {
+	goto out;
+    }
+    calp = NULL;
+    rc = 0;
+
+out:
+    _vnacal_free_error_term_matrices(vcp, &matrix_list);
+    _vnacal_calibration_free(calp);
+    (void)vnaproperty_delete(&vprp_calibration, ".");
+    return rc;
+}
+
+/*
+ * add_correction: record the extra bytes before the next character
+ *   @lsp: load state
+ */
+static int add_correction(load_state_t *lsp)
+{
+    char_offset_t *cop;
+
+    if (lsp->ls_offset_count != 0) {
+	cop = &lsp->ls_offsets[lsp->ls_offset_count - 1];
+	if (cop->co_index == lsp->ls_characters) {
+	    cop->co_extra = lsp->ls_extra;
+	    cop->co_lines = lsp->ls_lines_dropped;
+	    return 0;
+	}
+    }
+    if (lsp->ls_offset_count == lsp->ls_offset_allocation) {
+	int new_allocation = MAX(2 * lsp->ls_offset_allocation, 8);
+
+	if ((cop = _vnacal_realloc(lsp->ls_vcp, lsp->ls_offsets,
+			new_allocation * sizeof(char_offset_t))) == NULL) {
+	    return -1;
+	}
+	lsp->ls_offsets = cop;
+	lsp->ls_offset_allocation = new_allocation;
+    }
+    cop = &lsp->ls_offsets[lsp->ls_offset_count++];
+    cop->co_index = lsp->ls_characters;
+    cop->co_extra = lsp->ls_extra;
+    cop->co_lines = lsp->ls_lines_dropped;
+    return 0;
+}
+
+/*
+ * read_line: read the next line of the file into ls_line
+ *   @lsp: load state
+ *
+ *   Return 1 if a line was read, 0 on end of file, or -1 on error.
+ */
+static int read_line(load_state_t *lsp)
+{
+    size_t length = 0;
+
+    for (;;) {
+	if (lsp->ls_line_allocation - length < 2) {
+	    size_t new_allocation = MAX(2 * lsp->ls_line_allocation, 256);
+	    char *new_line;
+
+	    if ((new_line = _vnacal_realloc(lsp->ls_vcp, lsp->ls_line,
+			    new_allocation)) == NULL) {
+		return -1;
+	    }
+	    lsp->ls_line = new_line;
+	    lsp->ls_line_allocation = new_allocation;
+	}
+	if (fgets(&lsp->ls_line[length], lsp->ls_line_allocation - length,
+		    lsp->ls_fp) == NULL) {
+	    break;
+	}
+	length += strlen(&lsp->ls_line[length]);
+	if (length != 0 && lsp->ls_line[length - 1] == '\n') {
+	    break;
+	}
+    }
+    if (ferror(lsp->ls_fp)) {
+	return -1;
+    }
+    lsp->ls_line_length = length;
+    lsp->ls_line_position = 0;
+    return length != 0;
+}
+
+/*
+ * is_data_key: test if a line is a "data:" key with a block value
+ *   @line: line of text
+ *   @column: address to receive the column of the key
+ */
+static bool is_data_key(const char *line, int *column)
+{
+    int i = 0;
+
+    while (line[i] == ' ') {
+	++i;
+    }
+    if (line[i] == '-' && line[i + 1] == ' ') {
+	i += 2;
+	while (line[i] == ' ') {
+	    ++i;
+	}
+    }
+    if (strncmp(&line[i], "data:", 5) != 0) {
+	return false;
+    }
+    *column = i;
+    for (const char *cp = &line[i + 5]; *cp != '\000'; ++cp) {
+	if (*cp != ' ' && *cp != '\t' && *cp != '\r' && *cp != '\n') {
+	    return false;
+	}
+    }
+    return true;
+}
+
+/*
+ * track_calibrations: follow the calibrations sequence from line to line
+ *   @lsp: load state
+ *
+ *   Only a "data:" key of a calibration mapping holds error terms;
+ *   "data" keys elsewhere, such as user properties, must reach libyaml.
+ *   Note when the line starts or ends the top-level calibrations
+ *   sequence, and the column of the keys of its calibration mappings.
+ */
+static void track_calibrations(load_state_t *lsp)
+{
+    const char *line = lsp->ls_line;
+    const char *calibrations_name = lsp->ls_version == V0_2 ?
+	"sets" : "calibrations";
+    const size_t length = strlen(calibrations_name);
+    int i = 0;
+
+    while (line[i] == ' ') {
+	++i;
+    }
+    if (line[i] == '\n' || line[i] == '\r' || line[i] == '\000' ||
+	    line[i] == '#') {
+	return;
+    }
+    if (i == 0 && !(line[0] == '-' && line[1] == ' ')) {
+	lsp->ls_in_calibrations = strncmp(line, calibrations_name,
+		length) == 0 && line[length] == ':';
+	lsp->ls_entry_column = -1;
+	lsp->ls_key_column = -1;
+	return;
+    }
+    if (!lsp->ls_in_calibrations || line[i] != '-' || line[i + 1] != ' ') {
+	return;
+    }
+    if (lsp->ls_entry_column == -1) {
+	lsp->ls_entry_column = i;
+    }
+    if (i == lsp->ls_entry_column) {
+	i += 2;
+	while (line[i] == ' ') {
+	    ++i;
+	}
+	lsp->ls_key_column = i;
+    }
+}
+
+/*
+ * in_data_block: test if a line continues the block value of a data key
+ *   @line: line of text
+ *   @column: column of the data key
+ *
+ *   The value of a block mapping key continues through blank lines,
+ *   lines indented more than the key, and "- " sequence entries at the
+ *   same indentation as the key.
+ */
+static bool in_data_block(const char *line, int column)
+{
+    int i = 0;
+
+    while (line[i] == ' ') {
+	++i;
+    }
+    if (line[i] == '\n' || line[i] == '\r' || line[i] == '\000') {
+	return true;
+    }
+    if (i > column) {
+	return true;
+    }
+    return i == column && line[i] == '-' && (line[i + 1] == ' ' ||
+	    line[i + 1] == '\n' || line[i + 1] == '\r');
+}
+
+/*
+ * next_line: read the next line to give to libyaml
+ *   @lsp: load state
+ *
+ *   Count characters and record where multibyte characters and dropped
+ *   lines make byte offsets differ from libyaml's character indices.
+ *   When ls_filter is set, drop the lines of each calibration's data
+ *   block: the index doesn't need them, and scanning them with libyaml
+ *   would take most of the time.  Return 1 if a line was read, 0 on end
+ *   of file, or -1 on error.
+ */
+static int next_line(load_state_t *lsp)
+{
+    int rv;
+
+    for (;;) {
+	if ((rv = read_line(lsp)) != 1) {
+	    return rv;
+	}
+	if (lsp->ls_data_column == -1 ||
+		!in_data_block(lsp->ls_line, lsp->ls_data_column)) {
+	    lsp->ls_data_column = -1;
+	    break;
+	}
+	lsp->ls_extra += lsp->ls_line_length;
+	++lsp->ls_lines_dropped;
+	if (add_correction(lsp) == -1) {
+	    return -1;
+	}
+    }
+    for (size_t i = 0; i < lsp->ls_line_length; ++i) {
+	if ((lsp->ls_line[i] & 0xC0) != 0x80) {
+	    ++lsp->ls_characters;
+	    continue;
+	}
+
+	/*
+	 * UTF-8 continuation byte: the characters that follow start
+	 * one byte later.
+	 */
+	++lsp->ls_extra;
+	if (add_correction(lsp) == -1) {
+	    return -1;
+	}
+    }
+    if (lsp->ls_filter) {
+	int column;
+
+	track_calibrations(lsp);
+	if (lsp->ls_in_calibrations && lsp->ls_key_column != -1 &&
+		is_data_key(lsp->ls_line, &column) &&
+		column == lsp->ls_key_column) {
+	    lsp->ls_data_column = column;
+	}
+    }
+    return 1;
+}
+
+/*
+ * read_handler: libyaml input handler used by vnacal_load_lazy
+ *   @data: load state
+ *   @buffer: buffer to fill
+ *   @size: size of buffer
+ *   @size_read: address to receive the number of bytes read
+ */
+static int read_handler(void *data, unsigned char *buffer, size_t size,
+	size_t *size_read)
+{
+    load_state_t *lsp = data;
+    size_t n = 0;
+
+    while (n < size) {
+	size_t length;
+
+	if (lsp->ls_line_position == lsp->ls_line_length) {
+	    int rv;
+
+	    if ((rv = next_line(lsp)) == -1) {
+		return 0;
+	    }
+	    if (rv == 0) {
+		break;
+	    }
+	}
+	length = MIN(size - n, lsp->ls_line_length - lsp->ls_line_position);
+	(void)memcpy((void *)&buffer[n],
+		(void *)&lsp->ls_line[lsp->ls_line_position], length);
+	lsp->ls_line_position += length;
+	n += length;
+    }
+    *size_read = n;
+    return 1;
+}
+
+/*
+ * find_correction: find the last correction at or before a character index
+ *   @lsp: load state
+ *   @index: character index from a yaml_mark_t
+ */
+static const char_offset_t *find_correction(const load_state_t *lsp,
+	size_t index)
+{
+    const char_offset_t *cop = NULL;
+    int low = 0, high = lsp->ls_offset_count;
+
+    while (low < high) {
+	int mid = (low + high) / 2;
+
+	if (lsp->ls_offsets[mid].co_index <= index) {
+	    cop = &lsp->ls_offsets[mid];
+	    low = mid + 1;
+	} else {
+	    high = mid;
+	}
+    }
+    return cop;
+}
+
+/*
+ * byte_offset: convert a libyaml character index to a file offset
+ *   @lsp: load state
+ *   @index: character index from a yaml_mark_t
+ */
+static long byte_offset(const load_state_t *lsp, size_t index)
+{
+    const char_offset_t *cop = find_correction(lsp, index);
+
+    return lsp->ls_base + (long)(index + (cop != NULL ? cop->co_extra : 0));
+}
+
+/*
+ * file_line: convert a libyaml mark to a zero-based line of the YAML text
+ *   @lsp: load state
+ *   @mark: mark from an event
+ */
+static int file_line(const load_state_t *lsp, const yaml_mark_t *mark)
+{
+    const char_offset_t *cop = find_correction(lsp, mark->index);
+
+    return (int)(mark->line + (cop != NULL ? cop->co_lines : 0));
+}
+
+/*
+ * index_calibration: record a calibration's name and location
+ *   @lsp: load state
+ *
+ *   Used by vnacal_load_lazy in place of load_calibration.  Add a
+ *   placeholder calibration that _vnacal_load_deferred replaces on
+ *   first use.
+ */
+static int index_calibration(load_state_t *lsp)
+{
+    vnacal_t *vcp = lsp->ls_vcp;
+    const yaml_mark_t start = lsp->ls_event.start_mark;
+    vnacal_calibration_t *calp = NULL;
+    vnacal_deferred_t *vdfp;
+    char *name = NULL;
+    long offset;
+    int rc = -1;
+
+    assert(lsp->ls_event.type == YAML_MAPPING_START_EVENT);
+    for (;;) {
+	int rv;
+
+	if (next_event(lsp) == -1) {
+	    goto out;
+	}
+	if (lsp->ls_event.type == YAML_MAPPING_END_EVENT) {
+	    break;
+	}
+	if ((rv = check_key(lsp)) == -1) {
+	    goto out;
+	}
+	if (rv == 0) {
+	    continue;
+	}
+	if (strcmp(EVENT_TEXT(lsp), "name") == 0) {
+	    if (fetch_event(lsp) == -1) {
+		goto out;
+	    }
+	    if (lsp->ls_event.type != YAML_SCALAR_EVENT) {
+		_vnacal_error(vcp, VNAERR_SYNTAX, "%s (line %d) error: "
+			"expected scalar \"name\"",
+			vcp->vc_filename, EVENT_LINE(lsp));
+		goto out;
+	    }
+	    _vnacal_free(vcp, (void *)name);
+	    if ((name = _vnacal_strdup(vcp, EVENT_TEXT(lsp))) == NULL) {
+		_vnacal_error(vcp, VNAERR_SYSTEM, "strdup: %s",
+			strerror(errno));
+		goto out;
+	    }
+	    continue;
+	}
+	if (fetch_event(lsp) == -1 || skip_node(lsp) == -1) {
 	    goto out;
 	}
     }
-    if (_vnacal_add_calibration_common("vnacal_load", vcp, calp, name) == -1) {
+    if (name == NULL) {
+	_vnacal_error(vcp, VNAERR_SYNTAX, "%s (line %d) error: "
+		"expected scalar \"name\"",
+		vcp->vc_filename, (int)start.line + 2);
+	goto out;
+    }
+
+    /*
+     * Make the placeholder.
+     */
+    if ((calp = _vnacal_calloc(vcp, 1,
+		    sizeof(vnacal_calibration_t))) == NULL ||
+	    (calp->cal_deferred = _vnacal_calloc(vcp, 1,
+		    sizeof(vnacal_deferred_t))) == NULL) {
+	_vnacal_error(vcp, VNAERR_SYSTEM, "calloc: %s", strerror(errno));
 	goto out;
     }
+    calp->cal_vcp = vcp;
+    calp->cal_type = VNACAL_NOTYPE;
+    calp->cal_z0_type = VNACAL_Z0_SCALAR;
+    vdfp = calp->cal_deferred;
+    offset = byte_offset(lsp, start.index);
+    vdfp->vdf_offset  = offset;
+    vdfp->vdf_length  = byte_offset(lsp, lsp->ls_event.end_mark.index) -
+	offset;
+    vdfp->vdf_line    = file_line(lsp, &start);
+    vdfp->vdf_column  = start.column;
+    vdfp->vdf_version = lsp->ls_version;
+    if (_vnacal_add_calibration_common("vnacal_load", vcp, calp,
+		name) == -1) {
+	goto out;
+    }
+    calp = NULL;
     rc = 0;
 
 out:
-    _vnacal_free_error_term_matrices(&matrix_list);
-    if (rc != 0) {
-	_vnacal_calibration_free(calp);
-    }
+    _vnacal_calibration_free(calp);
+    _vnacal_free(vcp, (void *)name);
     return rc;
 }
 
 /*
- * vnacal_load: load the calibration from a file
+ * load_calibrations: load the sequence of calibrations
+ *   @lsp: load state
+ *   @key: name of the sequence
+ */
+static int load_calibrations(load_state_t *lsp, const char *key)
+{
+    vnacal_t *vcp = lsp->ls_vcp;
+
+    if (lsp->ls_event.type != YAML_SEQUENCE_START_EVENT) {
+	not_a_sequence(lsp, key);
+	return -1;
+    }
+    for (int calibration = 0; ; ++calibration) {
+	if (next_event(lsp) == -1) {
+	    return -1;
+	}
+	if (lsp->ls_event.type == YAML_SEQUENCE_END_EVENT) {
+	    break;
+	}
+	if (lsp->ls_event.type != YAML_MAPPING_START_EVENT) {
+	    _vnacal_error(vcp, VNAERR_SYNTAX, "%s (line %d) error: "
+		    "calibration[%d] must be a mapping",
+		    vcp->vc_filename, EVENT_LINE(lsp), calibration);
+	    return -1;
+	}
+	if (lsp->ls_version == V0_2) {
+	    vnaproperty_t *vprp_calibration = NULL;
+	    int rv;
+
+	    if ((rv = build_node(lsp, &vprp_calibration)) == 0) {
+		rv = parse_calibration(vcp, &lsp->ls_paths,
+			vprp_calibration, V0_2);
+	    }
+	    (void)vnaproperty_delete(&vprp_calibration, ".");
+	    if (rv == -1) {
+		return -1;
+	    }
+	    continue;
+	}
+	if (lsp->ls_lazy) {
+	    if (index_calibration(lsp) == -1) {
+		return -1;
+	    }
+	    continue;
+	}
+	if (load_calibration(lsp) == -1) {
+	    return -1;
+	}
+    }
+    return 0;
+}
+
+/*
+ * load_document: load the YAML part of the calibration file
+ *   @lsp: load state
+ */
+static int load_document(load_state_t *lsp)
+{
+    vnacal_t *vcp = lsp->ls_vcp;
+    const char *calibrations_name;
+    bool have_calibrations = false;
+    int line;
+
+    calibrations_name = lsp->ls_version == V0_2 ? "sets" : "calibrations";
+    if (next_event(lsp) == -1) {
+	return -1;
+    }
+    assert(lsp->ls_event.type == YAML_STREAM_START_EVENT);
+    if (next_event(lsp) == -1) {
+	return -1;
+    }
+    if (lsp->ls_event.type != YAML_DOCUMENT_START_EVENT) {
+	_vnacal_error(vcp, VNAERR_SYNTAX,
+		"%s error: empty YAML document", vcp->vc_filename);
+	return -1;
+    }
+    if (next_event(lsp) == -1) {
+	return -1;
+    }
+    if (lsp->ls_event.type != YAML_MAPPING_START_EVENT) {
+	_vnacal_error(vcp, VNAERR_SYNTAX, "%s (line %d) error: "
+		"top-level object must be a mapping",
+		vcp->vc_filename, EVENT_LINE(lsp));
+	return -1;
+    }
+    line = EVENT_LINE(lsp);
+    for (;;) {
+	const char *key;
+	int rv;
+
+	if (next_event(lsp) == -1) {
+	    return -1;
+	}
+	if (lsp->ls_event.type == YAML_MAPPING_END_EVENT) {
+	    break;
+	}
+	if ((rv = check_key(lsp)) == -1) {
+	    return -1;
+	}
+	if (rv == 0) {
+	    continue;
+	}
+	key = EVENT_TEXT(lsp);
+	if (strcmp(key, calibrations_name) == 0) {
+	    if (next_event(lsp) == -1) {
+		return -1;
+	    }
+	    if (load_calibrations(lsp, calibrations_name) == -1) {
+		return -1;
+	    }
+	    have_calibrations = true;
+	    continue;
+	}
+
+	/*
+	 * Load global properties.  Lack of a properties line is the
+	 * same as properties set to null.
+	 */
+	if (lsp->ls_version != V0_2 && strcmp(key, "properties") == 0) {
+	    (void)vnaproperty_delete(&vcp->vc_properties, ".");
+	    if (fetch_event(lsp) == -1 ||
+		    build_node(lsp, &vcp->vc_properties) == -1) {
+		return -1;
+	    }
+	    continue;
+	}
+	unexpected_key(lsp);
+	return -1;
+    }
+    if (!have_calibrations) {
+	_vnacal_error(vcp, VNAERR_SYNTAX, "vnacal_load: %s (line %d): "
+		"missing required key %s",
+		vcp->vc_filename, line, calibrations_name);
+	return -1;
+    }
+    return 0;
+}
+
+/*
+ * load_file: load a calibration file
+ *   @function: name of the user-called function
  *   @pathname: calibration file name
  *   @error_fn: error reporting callback or NULL
  *   @error_arg: arbitrary argument passed through to error_fn or NULL
- *
- *   If error_fn is non-NULL, then vnacal_load and subsequent functions report
- *   error messages using error_fn before returning failure to the caller.
+ *   @allocator: allocator to use, or NULL for the global allocator
+ *   @mode: load, index, or index dropping the data blocks
  */
-vnacal_t *vnacal_load(const char *pathname,
-	vnaerr_error_fn_t *error_fn, void *error_arg)
+static vnacal_t *load_file(const char *function, const char *pathname,
+	vnaerr_error_fn_t *error_fn, void *error_arg,
+	const vnamem_allocator_t *allocator, load_mode_t mode)
 {
     vnacal_t *vcp = NULL;
     FILE *fp = NULL;
     vnacal_version_t version;
-    vnaproperty_t *vprp_root = NULL;
-    const vnaproperty_t *vprp_calibrations;
-    const char *calibrations_name;
-    int calibrations;
+    load_state_t ls;
     char line_buf[81];
+    int rv;
 
     /*
      * Allocate the vnacal_t structure.
      */
-    if ((vcp = _vnacal_alloc("vnacal_load", error_fn, error_arg)) == NULL) {
+    if ((vcp = _vnacal_alloc(function, error_fn, error_arg,
+		    allocator)) == NULL) {
 	return NULL;
     }
 
     /*
      * Save the filename.
      */
-    if ((vcp->vc_filename = strdup(pathname)) == NULL) {
+    if ((vcp->vc_filename = _vnacal_strdup(vcp, pathname)) == NULL) {
 	_vnacal_error(vcp, VNAERR_SYSTEM,
 		"strdup: %s", strerror(errno));
 	goto error;
     }
 
     /*
-     * Open the file and parse the version line.
+     * Open the file.  If it begins with the binary magic number, hand
+     * it to the binary loader, which maps the error terms rather than
+     * reading them, and so is already lazy.  Otherwise, parse the
+     * version line.
      */
     if ((fp = fopen(pathname, "r")) == NULL) {
 	_vnacal_error(vcp, VNAERR_SYSTEM, "fopen: %s: %s",
 		vcp->vc_filename, strerror(errno));
 	goto error;
     }
+    if ((rv = getc(fp)) == (unsigned char)VNACAL_BINARY_MAGIC[0]) {
+	(void)fclose(fp);
+	fp = NULL;
+	if (_vnacal_load_binary(vcp) == -1) {
+	    goto error;
+	}
+	return vcp;
+    }
+    if (rv != EOF) {
+	(void)ungetc(rv, fp);
+    }
     if (fgets(line_buf, sizeof(line_buf), fp) == NULL) {
 	_vnacal_error(vcp, VNAERR_SYNTAX, "%s (line 1) error: "
 		"expected #VNACal <major>.<minor>",
@@ -1055,73 +2714,320 @@ vnacal_t *vnacal_load(const char *pathname,
     if ((version = parse_version(vcp, line_buf)) == -1) {
 	goto error;
     }
-    if (vnaproperty_import_yaml_from_file(&vprp_root, fp, pathname,
-		error_fn, error_arg) == -1) {
+
+    /*
+     * Load the YAML document.
+     */
+    (void)memset((void *)&ls, 0, sizeof(ls));
+    ls.ls_vcp = vcp;
+    ls.ls_version = version;
+    ls.ls_vyml.vyml_filename = vcp->vc_filename;
+    ls.ls_vyml.vyml_error_fn = error_fn;
+    ls.ls_vyml.vyml_error_arg = error_arg;
+    ls.ls_vyml.vyml_line_offset = 1;
+    ls.ls_vyml.vyml_allocator = &vcp->vc_allocator;
+    if (compile_paths(vcp, &ls.ls_paths) == -1) {
+	free_paths(&ls.ls_paths);
 	goto error;
     }
-    fclose(fp);
-    fp = NULL;
-    if (vnaproperty_type(vprp_root, ".") != 'm') {
-	_vnacal_error(vcp, VNAERR_SYNTAX, "%s (line 2) error: "
-		"top-level object must be a mapping",
-		vcp->vc_filename);
+    if (!yaml_parser_initialize(&ls.ls_parser)) {
+	_vnacal_error(vcp, VNAERR_SYSTEM, "yaml_parser_initialize: %s",
+		strerror(ENOMEM));
+	free_paths(&ls.ls_paths);
 	goto error;
     }
-    if (version == V0_2) {
-	calibrations_name = "sets";
-	if (check_mapping(vcp, vprp_root, v0_2_top_level_keys) == -1) {
+    if (mode != LOAD_ALL) {
+	ls.ls_lazy = true;
+	ls.ls_filter = mode == LOAD_INDEX_FILTERED;
+	ls.ls_fp = fp;
+	ls.ls_entry_column = -1;
+	ls.ls_key_column = -1;
+	ls.ls_data_column = -1;
+	if ((ls.ls_base = ftell(fp)) == -1) {
+	    _vnacal_error(vcp, VNAERR_SYSTEM, "ftell: %s: %s",
+		    vcp->vc_filename, strerror(errno));
+	    yaml_parser_delete(&ls.ls_parser);
+	    free_paths(&ls.ls_paths);
 	    goto error;
 	}
+	yaml_parser_set_input(&ls.ls_parser, read_handler, (void *)&ls);
     } else {
-	calibrations_name = "calibrations";
-	if (check_mapping(vcp, vprp_root, top_level_keys) == -1) {
-	    goto error;
-	}
-	/*
-	 * Copy global properties.  Treat lack of a properties line as
-	 * the same as properties set to null.
-	 */
-	if (vnaproperty_copy(&vcp->vc_properties,
-		vnaproperty_get_subtree(vprp_root, "properties")) == -1) {
-	    _vnacal_error(vcp, VNAERR_SYSTEM, "vnaproperty_copy: %s",
-		    strerror(errno));
-	    goto error;
-	}
+	yaml_parser_set_input_file(&ls.ls_parser, fp);
+    }
+    rv = load_document(&ls);
+    if (ls.ls_have_event) {
+	yaml_event_delete(&ls.ls_event);
+    }
+    yaml_parser_delete(&ls.ls_parser);
+    _vnaproperty_yaml_free_anchors(&ls.ls_vyml);
+    free_paths(&ls.ls_paths);
+    _vnacal_free(vcp, (void *)ls.ls_offsets);
+    _vnacal_free(vcp, (void *)ls.ls_line);
+    if (rv == -1) {
+	goto error;
     }
 
     /*
-     * Get and iterate through the calibrations sequence.
+     * If lazy, keep the file open so that deferred calibrations are
+     * read from the file we indexed even if pathname is later replaced
+     * or was relative to a directory we're no longer in.  Remember its
+     * size and modification time so that we can tell if it's rewritten
+     * in place.
      */
-    if ((vprp_calibrations = get_key(vcp, vprp_root,
-		    calibrations_name, 'l')) == NULL) {
-	goto error;
-    }
-    calibrations = vnaproperty_count(vprp_calibrations, "[]");
-    for (int calibration = 0; calibration < calibrations; ++calibration) {
-	vnaproperty_t *vprp_calibration;
+    if (mode != LOAD_ALL) {
+	struct stat st;
 
-	vprp_calibration = vnaproperty_get_subtree(vprp_calibrations,
-		"[%d]{}", calibration);
-	if (vprp_calibration == NULL) {
-	    _vnacal_error(vcp, VNAERR_SYNTAX, "%s (line %d) error: "
-		    "calibration[%d] must be a mapping",
-		    vcp->vc_filename, get_line(vprp_calibrations),
-		    calibration);
-	    goto error;
-	}
-	if (parse_calibration(vcp, vprp_calibration, version) == -1) {
+	if (fstat(fileno(fp), &st) == -1) {
+	    _vnacal_error(vcp, VNAERR_SYSTEM, "fstat: %s: %s",
+		    vcp->vc_filename, strerror(errno));
 	    goto error;
 	}
+	vcp->vc_lazy_fp    = fp;
+	vcp->vc_lazy_size  = st.st_size;
+	vcp->vc_lazy_mtime = st.st_mtime;
+	return vcp;
     }
-    assert(fp == NULL);
-    (void)vnaproperty_delete(&vprp_root, ".");
+    (void)fclose(fp);
     return vcp;
 
 error:
     if (fp != NULL) {
 	(void)fclose(fp);
     }
-    (void)vnaproperty_delete(&vprp_root, ".");
     vnacal_free(vcp);
     return NULL;
 }
+
+/*
+ * _vnacal_load_deferred: load a calibration deferred by vnacal_load_lazy
+ *   @vcp: pointer returned from vnacal_load_lazy
+ *   @ci: calibration index of the placeholder
+ *
+ *   Read the calibration's mapping back from the file held open by
+ *   vnacal_load_lazy and load it with the event-driven loader.  The
+ *   text is preceded by the same number of lines and columns that
+ *   preceded it in the file so that line numbers in error messages
+ *   match the file.  If the file's size or modification time changed
+ *   since it was indexed, fail with ESTALE.  On success, the loaded
+ *   calibration replaces the placeholder at the same index.
+ */
+int _vnacal_load_deferred(vnacal_t *vcp, int ci)
+{
+    vnacal_calibration_t *calp = vcp->vc_calibration_vector[ci];
+    const vnacal_deferred_t vdf = *calp->cal_deferred;
+    const size_t prefix = vdf.vdf_line + vdf.vdf_column;
+    FILE *fp = vcp->vc_lazy_fp;
+    struct stat st;
+    char *buffer = NULL;
+    load_state_t ls;
+    bool delete_parser = false;
+    int rc = -1;
+
+    (void)memset((void *)&ls, 0, sizeof(ls));
+
+    /*
+     * Read the text of the calibration.
+     */
+    if ((buffer = _vnacal_malloc(vcp, prefix + vdf.vdf_length + 1)) == NULL) {
+	_vnacal_error(vcp, VNAERR_SYSTEM, "malloc: %s", strerror(errno));
+	goto out;
+    }
+    (void)memset((void *)buffer, '\n', vdf.vdf_line);
+    (void)memset((void *)&buffer[vdf.vdf_line], ' ', vdf.vdf_column);
+    assert(fp != NULL);
+    if (fstat(fileno(fp), &st) == -1) {
+	_vnacal_error(vcp, VNAERR_SYSTEM, "fstat: %s: %s",
+		vcp->vc_filename, strerror(errno));
+	goto out;
+    }
+    if (st.st_size != vcp->vc_lazy_size ||
+	    st.st_mtime != vcp->vc_lazy_mtime) {
+	errno = ESTALE;
+	_vnacal_error(vcp, VNAERR_SYSTEM, "%s: file changed since it "
+		"was loaded", vcp->vc_filename);
+	goto out;
+    }
+    if (fseek(fp, vdf.vdf_offset, SEEK_SET) == -1 ||
+	    fread((void *)&buffer[prefix], 1, vdf.vdf_length,
+		fp) != vdf.vdf_length) {
+	_vnacal_error(vcp, VNAERR_SYNTAX, "%s error: calibration \"%s\" "
+		"changed since the file was loaded",
+		vcp->vc_filename, calp->cal_name);
+	goto out;
+    }
+    buffer[prefix + vdf.vdf_length] = '\000';
+
+    /*
+     * Parse it.
+     */
+    ls.ls_vcp = vcp;
+    ls.ls_version = (vnacal_version_t)vdf.vdf_version;
+    ls.ls_vyml.vyml_filename = vcp->vc_filename;
+    ls.ls_vyml.vyml_error_fn = vcp->vc_error_fn;
+    ls.ls_vyml.vyml_error_arg = vcp->vc_error_arg;
+    ls.ls_vyml.vyml_line_offset = 1;
+    ls.ls_vyml.vyml_allocator = &vcp->vc_allocator;
+    if (compile_paths(vcp, &ls.ls_paths) == -1) {
+	goto out;
+    }
+    if (!yaml_parser_initialize(&ls.ls_parser)) {
+	_vnacal_error(vcp, VNAERR_SYSTEM, "yaml_parser_initialize: %s",
+		strerror(ENOMEM));
+	goto out;
+    }
+    delete_parser = true;
+    yaml_parser_set_input_string(&ls.ls_parser, (const unsigned char *)buffer,
+	    prefix + vdf.vdf_length);
+    for (int i = 0; i < 3; ++i) {
+	if (next_event(&ls) == -1) {
+	    goto out;
+	}
+    }
+    if (ls.ls_event.type != YAML_MAPPING_START_EVENT ||
+	    load_calibration(&ls) == -1) {
+	goto out;
+    }
+
+    /*
+     * If the name didn't match, the placeholder is still there.
+     */
+    if (vcp->vc_calibration_vector[ci]->cal_deferred != NULL) {
+	_vnacal_error(vcp, VNAERR_SYNTAX, "%s error: calibration \"%s\" "
+		"changed since the file was loaded",
+		vcp->vc_filename, calp->cal_name);
+	goto out;
+    }
+    rc = 0;
+
+out:
+    if (delete_parser) {
+	if (ls.ls_have_event) {
+	    yaml_event_delete(&ls.ls_event);
+	}
+	yaml_parser_delete(&ls.ls_parser);
+	_vnaproperty_yaml_free_anchors(&ls.ls_vyml);
+    }
+    free_paths(&ls.ls_paths);
+    _vnacal_free(vcp, (void *)buffer);
+    return rc;
+}
+
+/*
+ * _vnacal_close_lazy: close the file held open by vnacal_load_lazy
+ *   @vcp: pointer to vnacal_t structure
+ */
+void _vnacal_close_lazy(vnacal_t *vcp)
+{
+    if (vcp->vc_lazy_fp != NULL) {
+	(void)fclose(vcp->vc_lazy_fp);
+	vcp->vc_lazy_fp = NULL;
+    }
+}
+
+/*
+ * vnacal_load: load the calibration from a file
+ *   @pathname: calibration file name
+ *   @error_fn: error reporting callback or NULL
+ *   @error_arg: arbitrary argument passed through to error_fn or NULL
+ *
+ *   If error_fn is non-NULL, then vnacal_load and subsequent functions report
+ *   error messages using error_fn before returning failure to the caller.
+ */
+vnacal_t *vnacal_load(const char *pathname,
+	vnaerr_error_fn_t *error_fn, void *error_arg)
+{
+    uint64_t start = _VNASTATS_NOW();
+    vnacal_t *vcp;
+
+    vcp = load_file("vnacal_load", pathname, error_fn, error_arg, NULL,
+	    LOAD_ALL);
+    _VNASTATS_TIME(_vnacal_stats, vcs_load_calls, vcs_load_ns, start);
+    return vcp;
+}
+
+/*
+ * vnacal_load_with_allocator: vnacal_load using the given allocator
+ *   @pathname: calibration file name
+ *   @error_fn: error reporting callback or NULL
+ *   @error_arg: arbitrary argument passed through to error_fn or NULL
+ *   @allocator: allocator to use, or NULL for the global allocator
+ */
+vnacal_t *vnacal_load_with_allocator(const char *pathname,
+	vnaerr_error_fn_t *error_fn, void *error_arg,
+	const vnamem_allocator_t *allocator)
+{
+    uint64_t start = _VNASTATS_NOW();
+    vnacal_t *vcp;
+
+    vcp = load_file("vnacal_load_with_allocator", pathname, error_fn,
+	    error_arg, allocator, LOAD_ALL);
+    _VNASTATS_TIME(_vnacal_stats, vcs_load_calls, vcs_load_ns, start);
+    return vcp;
+}
+
+/*
+ * load_lazy: common code for vnacal_load_lazy and its allocator variant
+ *   @function: name of the user-called function
+ *   @pathname: calibration file name
+ *   @error_fn: error reporting callback or NULL
+ *   @error_arg: arbitrary argument passed through to error_fn or NULL
+ *   @allocator: allocator to use, or NULL for the global allocator
+ *
+ *   Parse only enough of each calibration to find its name and where
+ *   it lies in the file.  _vnacal_get_calibration loads a calibration
+ *   the first time it's used, so that a process that uses only one of
+ *   many calibrations doesn't pay the time and memory for the rest.
+ */
+static vnacal_t *load_lazy(const char *function, const char *pathname,
+	vnaerr_error_fn_t *error_fn, void *error_arg,
+	const vnamem_allocator_t *allocator)
+{
+    uint64_t start = _VNASTATS_NOW();
+    vnacal_t *vcp;
+
+    /*
+     * First try dropping the data blocks before they reach libyaml,
+     * without reporting errors.  The line-based filter doesn't
+     * understand every YAML construct; if it fails, index again with
+     * libyaml seeing the whole file so that real errors are reported
+     * accurately.
+     */
+    if ((vcp = load_file(function, pathname, NULL, NULL, allocator,
+		    LOAD_INDEX_FILTERED)) != NULL) {
+	vcp->vc_error_fn  = error_fn;
+	vcp->vc_error_arg = error_arg;
+    } else {
+	vcp = load_file(function, pathname, error_fn, error_arg, allocator,
+		LOAD_INDEX);
+    }
+    _VNASTATS_TIME(_vnacal_stats, vcs_load_calls, vcs_load_ns, start);
+    return vcp;
+}
+
+/*
+ * vnacal_load_lazy: load a calibration file, deferring the error terms
+ *   @pathname: calibration file name
+ *   @error_fn: error reporting callback or NULL
+ *   @error_arg: arbitrary argument passed through to error_fn or NULL
+ */
+vnacal_t *vnacal_load_lazy(const char *pathname,
+	vnaerr_error_fn_t *error_fn, void *error_arg)
+{
+    return load_lazy("vnacal_load_lazy", pathname, error_fn, error_arg,
+	    NULL);
+}
+
+/*
+ * vnacal_load_lazy_with_allocator: vnacal_load_lazy using the given allocator
+ *   @pathname: calibration file name
+ *   @error_fn: error reporting callback or NULL
+ *   @error_arg: arbitrary argument passed through to error_fn or NULL
+ *   @allocator: allocator to use, or NULL for the global allocator
+ */
+vnacal_t *vnacal_load_lazy_with_allocator(const char *pathname,
+	vnaerr_error_fn_t *error_fn, void *error_arg,
+	const vnamem_allocator_t *allocator)
+{
+    return load_lazy("vnacal_load_lazy_with_allocator", pathname, error_fn,
+	    error_arg, allocator);
+}
@@ -79,18 +79,18 @@ static int _vnacal_make_calkit_parameter_matrix(const char *function,
     /*
      * Allocate and init the standard.
      */
-    if ((stdp = malloc(sizeof(vnacal_standard_t))) == NULL) {
+    if ((stdp = _vnacal_malloc(vcp, sizeof(vnacal_standard_t))) == NULL) {
 	_vnacal_error(vcp, VNAERR_SYSTEM, "malloc: %s", strerror(errno));
 	goto error;
     }
     (void)memset((void *)stdp, 0, sizeof(*stdp));
     stdp->std_type = VNACAL_CALKIT;
-    if ((stdp->std_name = strdup(name)) == NULL) {
+    stdp->std_vcp = vcp;
+    if ((stdp->std_name = _vnacal_strdup(vcp, name)) == NULL) {
 	goto error;
     }
     stdp->std_ports = ports;
     stdp->std_refcount = 0;
-    stdp->std_vcp = vcp;
     stdp->std_calkit_data = *vcdp;
 
     /*
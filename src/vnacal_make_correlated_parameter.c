@@ -152,7 +152,8 @@ int vnacal_make_correlated_parameter(vnacal_t *vcp, int other,
 	    /*
 	     * Make a copy of sigma_frequency_vector.
 	     */
-	    frequency_vector_copy = calloc(sigma_frequencies, sizeof(double));
+	    frequency_vector_copy = _vnacal_calloc(vcp, sigma_frequencies,
+		    sizeof(double));
 	    if (frequency_vector_copy == NULL) {
 		_vnacal_error(vcp, VNAERR_SYSTEM,
 			"calloc: %s", strerror(errno));
@@ -175,7 +176,7 @@ int vnacal_make_correlated_parameter(vnacal_t *vcp, int other,
 	    goto error;
 	}
     }
-    if ((sigma_vector_copy = calloc(sigma_frequencies,
+    if ((sigma_vector_copy = _vnacal_calloc(vcp, sigma_frequencies,
 		    sizeof(double))) == NULL) {
 	_vnacal_error(vcp, VNAERR_SYSTEM,
 		"calloc: %s", strerror(errno));
@@ -189,7 +190,8 @@ int vnacal_make_correlated_parameter(vnacal_t *vcp, int other,
      * coefficients over sigma_frequency_vector and sigma_vector.
      */
     if (sigma_frequencies > 1) {
-	spline_vector = calloc(sigma_frequencies - 1, sizeof(double [3]));
+	spline_vector = _vnacal_calloc(vcp, sigma_frequencies - 1,
+		sizeof(double [3]));
 	if (spline_vector == NULL) {
 	    _vnacal_error(vcp, VNAERR_SYSTEM,
 		    "calloc: %s", strerror(errno));
@@ -229,9 +231,9 @@ int vnacal_make_correlated_parameter(vnacal_t *vcp, int other,
     return vpmrp->vpmr_index;
 
 error:
-    free((void *)spline_vector);
-    free((void *)sigma_vector_copy);
-    free((void *)frequency_vector_copy);
+    _vnacal_free(vcp, (void *)spline_vector);
+    _vnacal_free(vcp, (void *)sigma_vector_copy);
+    _vnacal_free(vcp, (void *)frequency_vector_copy);
     return -1;
 }
 
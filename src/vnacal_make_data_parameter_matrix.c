@@ -115,22 +115,24 @@ static int _vnacal_make_data_parameter_matrix(const char *function,
     /*
      * Allocate and init the vnacal_standard_t structure.
      */
-    if ((stdp = malloc(sizeof(vnacal_standard_t))) == NULL) {
+    if ((stdp = _vnacal_malloc(vcp, sizeof(vnacal_standard_t))) == NULL) {
 	_vnacal_error(vcp, VNAERR_SYSTEM, "malloc: %s", strerror(errno));
 	goto error;
     }
     (void)memset((void *)stdp, 0, sizeof(*stdp));
     stdp->std_type = VNACAL_DATA;
-    if ((stdp->std_name = strdup(vnadata_get_name(vdp))) == NULL) {
+    stdp->std_vcp = vcp;
+    if ((stdp->std_name = _vnacal_strdup(vcp,
+		    vnadata_get_name(vdp))) == NULL) {
 	_vnacal_error(vcp, VNAERR_SYSTEM, "strdup: %s", strerror(errno));
 	goto error;
     }
     stdp->std_ports = ports;
     stdp->std_refcount = 0;
-    stdp->std_vcp = vcp;
     vdsp = &stdp->std_data_standard;
     vdsp->vds_frequencies = frequencies;
-    if ((frequency_vector = calloc(frequencies, sizeof(double))) == NULL) {
+    if ((frequency_vector = _vnacal_calloc(vcp, frequencies,
+		    sizeof(double))) == NULL) {
 	_vnacal_error(vcp, VNAERR_SYSTEM, "calloc: %s", strerror(errno));
 	goto error;
     }
@@ -140,10 +142,12 @@ static int _vnacal_make_data_parameter_matrix(const char *function,
     vdsp->vds_frequency_vector = frequency_vector;
     vdsp->vds_has_fz0 = has_fz0 = vnadata_has_fz0(vdp);
     vdsp->vds_segment = 0;
+    vdsp->vds_interpolation = VNACAL_INTERP_RATIONAL;
     if (has_fz0) {
 	double complex **z0_vector_vector;
 
-	z0_vector_vector = calloc(ports, sizeof(double complex *));
+	z0_vector_vector = _vnacal_calloc(vcp, ports,
+		sizeof(double complex *));
 	if (z0_vector_vector == NULL) {
 	    _vnacal_error(vcp, VNAERR_SYSTEM, "calloc: %s", strerror(errno));
 	    goto error;
@@ -152,7 +156,7 @@ static int _vnacal_make_data_parameter_matrix(const char *function,
 	for (int port = 0; port < ports; ++port) {
 	    double complex *vector;
 
-	    vector = calloc(frequencies, sizeof(double complex));
+	    vector = _vnacal_calloc(vcp, frequencies, sizeof(double complex));
 	    if (vector == NULL) {
 		_vnacal_error(vcp, VNAERR_SYSTEM, "calloc: %s",
 			strerror(errno));
@@ -166,7 +170,8 @@ static int _vnacal_make_data_parameter_matrix(const char *function,
     } else {
 	double complex *z0_vector;
 
-	if ((z0_vector = calloc(ports, sizeof(double complex))) == NULL) {
+	if ((z0_vector = _vnacal_calloc(vcp, ports,
+			sizeof(double complex))) == NULL) {
 	    _vnacal_error(vcp, VNAERR_SYSTEM, "calloc: %s", strerror(errno));
 	    goto error;
 	}
@@ -174,7 +179,8 @@ static int _vnacal_make_data_parameter_matrix(const char *function,
 	(void)memcpy((void *)z0_vector, (void *)vnadata_get_z0_vector(vdp),
 		ports * sizeof(double complex));
     }
-    data_matrix = calloc(rows * columns, sizeof(double complex *));
+    data_matrix = _vnacal_calloc(vcp, rows * columns,
+	    sizeof(double complex *));
     if (data_matrix == NULL) {
 	_vnacal_error(vcp, VNAERR_SYSTEM, "calloc: %s", strerror(errno));
 	goto error;
@@ -185,7 +191,7 @@ static int _vnacal_make_data_parameter_matrix(const char *function,
 	    const int cell = row * columns + column;
 	    double complex *vector;
 
-	    vector = calloc(frequencies, sizeof(double complex));
+	    vector = _vnacal_calloc(vcp, frequencies, sizeof(double complex));
 	    if (vector == NULL) {
 		_vnacal_error(vcp, VNAERR_SYSTEM, "calloc: %s",
 			strerror(errno));
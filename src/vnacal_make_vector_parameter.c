@@ -74,7 +74,8 @@ int vnacal_make_vector_parameter(vnacal_t *vcp,
     }
     vpmrp->vpmr_type = VNACAL_VECTOR;
     vpmrp->vpmr_frequencies = frequencies;
-    vpmrp->vpmr_frequency_vector = calloc(frequencies, sizeof(double));
+    vpmrp->vpmr_frequency_vector = _vnacal_calloc(vcp, frequencies,
+	    sizeof(double));
     if (vpmrp->vpmr_frequency_vector == NULL) {
 	_vnacal_error(vcp, VNAERR_SYSTEM,
 		"calloc: %s", strerror(errno));
@@ -84,7 +85,8 @@ int vnacal_make_vector_parameter(vnacal_t *vcp,
     }
     (void)memcpy((void *)vpmrp->vpmr_frequency_vector,
 	    (void *)frequency_vector, frequencies * sizeof(double));
-    vpmrp->vpmr_coefficient_vector = calloc(frequencies, sizeof(double complex));
+    vpmrp->vpmr_coefficient_vector = _vnacal_calloc(vcp, frequencies,
+	    sizeof(double complex));
     if (vpmrp->vpmr_coefficient_vector == NULL) {
 	_vnacal_error(vcp, VNAERR_SYSTEM,
 		"calloc: %s", strerror(errno));
@@ -0,0 +1,273 @@
+/*
+ * Vector Network Analyzer Library
+ * Copyright © 2020-2024 D Scott Guthridge <scott_guthridge@rompromity.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "archdep.h"
+
+#include <assert.h>
+#include <complex.h>
+#include <errno.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "vnacal_internal.h"
+#include "vnacommon_internal.h"
+#include "vnadata_internal.h"
+
+
+/*
+ * COEFFICIENTS: number of coefficients in each segment
+ */
+#define COEFFICIENTS	(VNACAL_MODEL_ORDER + 1)
+
+/*
+ * model_u: map x into the segment's normalized variable
+ *   @x0: left end of the segment
+ *   @x1: right end of the segment
+ *   @x:  value to map
+ */
+static inline double model_u(double x0, double x1, double x)
+{
+    return x1 > x0 ? (2.0 * x - x0 - x1) / (x1 - x0) : 0.0;
+}
+
+/*
+ * model_horner: evaluate segment polynomial at u
+ *   @c: coefficients, constant term first
+ *   @u: normalized variable
+ */
+static inline double complex model_horner(const double complex *c, double u)
+{
+    double complex y = c[COEFFICIENTS - 1];
+
+    for (int j = COEFFICIENTS - 2; j >= 0; --j) {
+	y = y * u + c[j];
+    }
+    return y;
+}
+
+/*
+ * fit_segment: least-squares fit a polynomial to a range of points
+ *   @xp: vector of x points
+ *   @yp: vector of y points
+ *   @first: index of first point in the segment
+ *   @last: index of last point in the segment
+ *   @a_work: work space for at least (last - first + 1) * COEFFICIENTS
+ *   @b_work: work space for at least (last - first + 1)
+ *   @coefficients: vector of COEFFICIENTS results
+ *
+ *   Use the highest degree up to VNACAL_MODEL_ORDER the points support,
+ *   and return the largest magnitude of error at the points.
+ */
+static double fit_segment(const double *xp, const double complex *yp,
+	int first, int last, double complex *a_work, double complex *b_work,
+	double complex *coefficients)
+{
+    const int points = last - first + 1;
+    const int columns = MIN(COEFFICIENTS, points);
+    const double x0 = xp[first];
+    const double x1 = xp[last];
+    double error = 0.0;
+
+    for (int i = 0; i < points; ++i) {
+	const double u = model_u(x0, x1, xp[first + i]);
+	double power = 1.0;
+
+	for (int j = 0; j < columns; ++j) {
+	    a_work[i * columns + j] = power;
+	    power *= u;
+	}
+	b_work[i] = yp[first + i];
+    }
+    (void)_vnacommon_qrsolve(coefficients, a_work, b_work,
+	    points, columns, 1);
+    for (int j = columns; j < COEFFICIENTS; ++j) {
+	coefficients[j] = 0.0;
+    }
+    for (int i = first; i <= last; ++i) {
+	const double complex y = model_horner(coefficients,
+		model_u(x0, x1, xp[i]));
+
+	error = MAX(error, cabs(y - yp[i]));
+    }
+    return error;
+}
+
+/*
+ * _vnacal_model_fit: fit a piecewise polynomial model to y
+ *   @vmap: allocator for the model
+ *   @xp: vector of increasing x points
+ *   @yp: vector of y points
+ *   @n: length of xp and yp
+ *   @tolerance: largest magnitude of error allowed at any point
+ *   @vmp: caller-allocated model to fill in
+ *
+ *   Starting at the left, grow each segment as far as a single
+ *   polynomial fits within tolerance, first by doubling the number
+ *   of points, then by bisection.  Segments of two points always fit.
+ *   On success, the caller must release the model with
+ *   _vnacal_model_free_vector.  Return -1 with errno set on error.
+ */
+int _vnacal_model_fit(const vnamem_allocator_t *vmap,
+	const double *xp, const double complex *yp, int n, double tolerance,
+	vnacal_model_t *vmp)
+{
+    double complex *a_work = NULL;
+    double complex *b_work = NULL;
+    int *first_vector = NULL;
+    double complex (*c_vector)[COEFFICIENTS] = NULL;
+    double fit_error = 0.0;
+    int segments = 0;
+    int rv = -1;
+
+    assert(n >= 1);
+    (void)memset((void *)vmp, 0, sizeof(*vmp));
+    if ((a_work = _vnamem_amalloc(vmap, n * COEFFICIENTS *
+		    sizeof(double complex))) == NULL ||
+	    (b_work = _vnamem_amalloc(vmap,
+		    n * sizeof(double complex))) == NULL ||
+	    (first_vector = _vnamem_amalloc(vmap,
+		    (n + 1) * sizeof(int))) == NULL ||
+	    (c_vector = _vnamem_amalloc(vmap, MAX(n - 1, 1) *
+		    sizeof(double complex [COEFFICIENTS]))) == NULL) {
+	goto out;
+    }
+
+    /*
+     * A single point makes a constant segment of zero width.
+     */
+    if (n == 1) {
+	first_vector[0] = 0;
+	first_vector[1] = 0;
+	c_vector[0][0] = yp[0];
+	for (int j = 1; j < COEFFICIENTS; ++j) {
+	    c_vector[0][j] = 0.0;
+	}
+	segments = 1;
+    }
+    for (int start = 0; start < n - 1; ++segments) {
+	double complex best[COEFFICIENTS];
+	double best_error;
+	int good = start + 1;
+	int bad = n;
+
+	best_error = fit_segment(xp, yp, start, good, a_work, b_work, best);
+	for (int span = 2; good < n - 1; span *= 2) {
+	    const int end = MIN(start + span, n - 1);
+	    double complex trial[COEFFICIENTS];
+	    double error;
+
+	    error = fit_segment(xp, yp, start, end, a_work, b_work, trial);
+	    if (error > tolerance) {
+		bad = end;
+		break;
+	    }
+	    good = end;
+	    best_error = error;
+	    (void)memcpy((void *)best, (void *)trial, sizeof(best));
+	}
+	while (bad - good > 1) {
+	    const int mid = (good + bad) / 2;
+	    double complex trial[COEFFICIENTS];
+	    double error;
+
+	    error = fit_segment(xp, yp, start, mid, a_work, b_work, trial);
+	    if (error > tolerance) {
+		bad = mid;
+	    } else {
+		good = mid;
+		best_error = error;
+		(void)memcpy((void *)best, (void *)trial, sizeof(best));
+	    }
+	}
+	first_vector[segments] = start;
+	(void)memcpy((void *)c_vector[segments], (void *)best, sizeof(best));
+	fit_error = MAX(fit_error, best_error);
+	start = good;
+	first_vector[segments + 1] = start;
+    }
+
+    /*
+     * Copy the result into exactly-sized vectors.
+     */
+    if ((vmp->vm_breakpoint_vector = _vnamem_amalloc(vmap, (segments + 1) *
+		    sizeof(double))) == NULL ||
+	    (vmp->vm_coefficient_vector = _vnamem_amalloc(vmap, segments *
+		    sizeof(double complex [COEFFICIENTS]))) == NULL) {
+	_vnamem_afree(vmap, (void *)vmp->vm_breakpoint_vector);
+	vmp->vm_breakpoint_vector = NULL;
+	goto out;
+    }
+    for (int k = 0; k <= segments; ++k) {
+	vmp->vm_breakpoint_vector[k] = xp[first_vector[k]];
+    }
+    (void)memcpy((void *)vmp->vm_coefficient_vector, (void *)c_vector,
+	    segments * sizeof(double complex [COEFFICIENTS]));
+    vmp->vm_segments = segments;
+    vmp->vm_fit_error = fit_error;
+    rv = 0;
+
+out:
+    _vnamem_afree(vmap, (void *)c_vector);
+    _vnamem_afree(vmap, (void *)first_vector);
+    _vnamem_afree(vmap, (void *)b_work);
+    _vnamem_afree(vmap, (void *)a_work);
+    return rv;
+}
+
+/*
+ * _vnacal_model_eval: evaluate a model at x
+ *   @vmp: model from _vnacal_model_fit
+ *   @x: dependent variable
+ *   @segment: addr of segment index (used as hint on entry)
+ *
+ *   Values of x outside of the model extrapolate the end segments.
+ */
+double complex _vnacal_model_eval(const vnacal_model_t *vmp, double x,
+	int *segment)
+{
+    const double *bp = vmp->vm_breakpoint_vector;
+    int k;
+
+    k = _vnadata_find_segment(bp, vmp->vm_segments + 1, x, *segment);
+    if (k > vmp->vm_segments - 1) {
+	k = vmp->vm_segments - 1;
+    }
+    *segment = k;
+    return model_horner(vmp->vm_coefficient_vector[k],
+	    model_u(bp[k], bp[k + 1], x));
+}
+
+/*
+ * _vnacal_model_free_vector: free a vector of models
+ *   @vmap: allocator that allocated the models
+ *   @model_vector: vector of models (may be NULL)
+ *   @count: number of entries in model_vector
+ */
+void _vnacal_model_free_vector(const vnamem_allocator_t *vmap,
+	vnacal_model_t *model_vector, int count)
+{
+    if (model_vector != NULL) {
+	for (int i = 0; i < count; ++i) {
+	    _vnamem_afree(vmap, (void *)model_vector[i].vm_coefficient_vector);
+	    _vnamem_afree(vmap, (void *)model_vector[i].vm_breakpoint_vector);
+	}
+	_vnamem_afree(vmap, (void *)model_vector);
+    }
+}
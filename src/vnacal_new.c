@@ -106,7 +106,7 @@ vnacal_new_t *vnacal_new_alloc(vnacal_t *vcp, vnacal_type_t type,
     /*
      * Allocate and init the vnacal_new_t structure.
      */
-    if ((vnp = malloc(sizeof(vnacal_new_t))) == NULL) {
+    if ((vnp = _vnacal_malloc(vcp, sizeof(vnacal_new_t))) == NULL) {
 	_vnacal_error(vcp, VNAERR_SYSTEM,
 		"malloc: %s", strerror(errno));
 	return NULL;
@@ -116,14 +116,14 @@ vnacal_new_t *vnacal_new_alloc(vnacal_t *vcp, vnacal_type_t type,
     vnp->vn_vcp = vcp;
     _vnacal_layout(&vnp->vn_layout, type, m_rows, m_columns);
     vnp->vn_frequencies = frequencies;
-    if ((vnp->vn_frequency_vector = calloc(frequencies,
+    if ((vnp->vn_frequency_vector = _vnacal_calloc(vcp, frequencies,
 		    sizeof(double))) == NULL) {
 	_vnacal_error(vcp, VNAERR_SYSTEM,
 		"calloc: %s", strerror(errno));
 	goto error;
     }
     vnp->vn_frequencies_valid = false;
-    if (_vnacal_new_init_parameter_hash(__func__,
+    if (_vnacal_new_init_parameter_hash(__func__, vcp,
 		&vnp->vn_parameter_hash) == -1) {
 	goto error;
     }
@@ -144,7 +144,7 @@ vnacal_new_t *vnacal_new_alloc(vnacal_t *vcp, vnacal_type_t type,
     vnp->vn_iteration_limit = VNACAL_NEW_DEFAULT_ITERATION_LIMIT;
     vnp->vn_pvalue_limit = VNACAL_NEW_DEFAULT_PVALUE_LIMIT;
     vnp->vn_systems = systems;
-    if ((vnp->vn_system_vector = calloc(systems,
+    if ((vnp->vn_system_vector = _vnacal_calloc(vcp, systems,
 		    sizeof(vnacal_new_system_t))) == NULL) {
 	_vnacal_error(vcp, VNAERR_SYSTEM,
 		"calloc: %s", strerror(errno));
@@ -260,7 +260,8 @@ int _vnacal_new_set_z0_vector(const char *function, vnacal_new_t *vnp,
      * In the single z0 case, allocate a ports long vector and duplicate
      * the z0 value into every cell so that we always have a vector.
      */
-    if ((clfp = malloc(MAX(length, ports) * sizeof(double complex))) == NULL) {
+    if ((clfp = _vnacal_malloc(vcp, MAX(length, ports) *
+		    sizeof(double complex))) == NULL) {
 	_vnacal_error(vcp, VNAERR_SYSTEM,
 		"malloc: %s", strerror(errno));
 	return -1;
@@ -273,7 +274,7 @@ int _vnacal_new_set_z0_vector(const char *function, vnacal_new_t *vnp,
 	(void)memcpy((void *)clfp, (void *)z0_vector,
 		length * sizeof(double complex));
     }
-    free((void *)vnp->vn_z0_vector);
+    _vnacal_free(vcp, (void *)vnp->vn_z0_vector);
     vnp->vn_z0_type = z0_type;
     vnp->vn_z0_vector = clfp;
     return 0;
@@ -312,20 +313,21 @@ void _vnacal_new_free_measurement(vnacal_new_measurement_t *vnmp)
 {
     if (vnmp != NULL) {
 	vnacal_new_t *vnp = vnmp->vnm_vnp;
+	vnacal_t *vcp = vnp->vn_vcp;
 	const int m_rows    = vnp->vn_layout.vl_m_rows;
 	const int m_columns = vnp->vn_layout.vl_m_columns;
 
-	free((void *)vnmp->vnm_connectivity_matrix);
+	_vnacal_free(vcp, (void *)vnmp->vnm_connectivity_matrix);
 	if (vnmp->vnm_m_matrix != NULL) {
 	    for (int m_cell = 0; m_cell < m_rows * m_columns; ++m_cell) {
-		free((void *)vnmp->vnm_m_matrix[m_cell]);
+		_vnacal_free(vcp, (void *)vnmp->vnm_m_matrix[m_cell]);
 	    }
-	    free((void *)vnmp->vnm_m_matrix);
+	    _vnacal_free(vcp, (void *)vnmp->vnm_m_matrix);
 	}
 	_vnacal_free_parameter_matrix_map(vnmp->vnm_parameter_map);
-	free((void *)vnmp->vnm_parameter_matrix);
-	free((void *)vnmp->vnm_s_matrix);
-	free((void *)vnmp);
+	_vnacal_free(vcp, (void *)vnmp->vnm_parameter_matrix);
+	_vnacal_free(vcp, (void *)vnmp->vnm_s_matrix);
+	_vnacal_free(vcp, (void *)vnmp);
     }
 }
 
@@ -336,6 +338,7 @@ void _vnacal_new_free_measurement(vnacal_new_measurement_t *vnmp)
 void vnacal_new_free(vnacal_new_t *vnp)
 {
     if (vnp != NULL && vnp->vn_magic == VN_MAGIC) {
+	vnacal_t *vcp = vnp->vn_vcp;
 	vnacal_new_measurement_t *vnmp;
 
 	remque((void *)&vnp->vn_next);
@@ -352,20 +355,20 @@ void vnacal_new_free(vnacal_new_t *vnp)
 		    vnacal_new_term_t *vntp = vnep->vne_term_list;
 
 		    vnep->vne_term_list = vntp->vnt_next;
-		    free((void *)vntp);
+		    _vnacal_free(vcp, (void *)vntp);
 		}
-		free((void *)vnep);
+		_vnacal_free(vcp, (void *)vnep);
 	    }
 	}
-	free((void *)vnp->vn_system_vector);
+	_vnacal_free(vcp, (void *)vnp->vn_system_vector);
 	while ((vnmp = vnp->vn_measurement_list) != NULL) {
 	    vnp->vn_measurement_list = vnmp->vnm_next;
 	    _vnacal_new_free_measurement(vnmp);
 	}
-	free((void *)vnp->vn_m_error_vector);
+	_vnacal_free(vcp, (void *)vnp->vn_m_error_vector);
 	_vnacal_new_free_parameter_hash(&vnp->vn_parameter_hash);
-	free((void *)vnp->vn_frequency_vector);
+	_vnacal_free(vcp, (void *)vnp->vn_frequency_vector);
 	vnp->vn_magic = -1;
-	free((void *)vnp);
+	_vnacal_free(vcp, (void *)vnp);
     }
 }
@@ -56,7 +56,7 @@ static int add_equation(const char *function, vnacal_new_measurement_t *vnmp,
     /*
      * Allocate and init the new vnacal_new_equation_t structure.
      */
-    vnep = malloc(sizeof(vnacal_new_equation_t));
+    vnep = _vnacal_malloc(vcp, sizeof(vnacal_new_equation_t));
     if (vnep == NULL) {
 	_vnacal_error(vcp, VNAERR_SYSTEM,
 		"malloc: %s", strerror(errno));
@@ -185,7 +185,7 @@ static int build_connectivity_matrix(vnacal_new_measurement_t *vnmp)
      * port pair.  This result is always a symmetrical matrix with true's
      * down the major diagonal.
      */
-    if ((vnmp->vnm_connectivity_matrix = calloc(s_ports * s_ports,
+    if ((vnmp->vnm_connectivity_matrix = _vnacal_calloc(vcp, s_ports * s_ports,
 		    sizeof(int))) == NULL) {
 	_vnacal_error(vcp, VNAERR_SYSTEM, "calloc: %s", strerror(errno));
 	return -1;
@@ -660,14 +660,15 @@ int _vnacal_new_add_common(vnacal_new_add_arguments_t vnaa)
      * Allocate and init the vnacal_new_measurement_t structure and its
      * vectors of per-frequency M values.
      */
-    if ((vnmp = malloc(sizeof(vnacal_new_measurement_t))) == NULL) {
+    if ((vnmp = _vnacal_malloc(vcp,
+		    sizeof(vnacal_new_measurement_t))) == NULL) {
 	_vnacal_error(vcp, VNAERR_SYSTEM,
 		"malloc: %s", strerror(errno));
 	goto out;
     }
     (void)memset((void *)vnmp, 0, sizeof(vnacal_new_measurement_t));
     if ((vnmp->vnm_m_matrix = full_m_matrix =
-		calloc(full_m_rows * full_m_columns,
+		_vnacal_calloc(vcp, full_m_rows * full_m_columns,
 		    sizeof(double complex *))) == NULL) {
 	_vnacal_error(vcp, VNAERR_SYSTEM,
 		"calloc: %s", strerror(errno));
@@ -676,7 +677,7 @@ int _vnacal_new_add_common(vnacal_new_add_arguments_t vnaa)
     for (int b_cell = 0; b_cell < b_cells; ++b_cell) {
 	int full_m_cell = m_cell_map[b_cell];
 
-	if ((full_m_matrix[full_m_cell] = calloc(frequencies,
+	if ((full_m_matrix[full_m_cell] = _vnacal_calloc(vcp, frequencies,
 			sizeof(double complex))) == NULL) {
 	    _vnacal_error(vcp, VNAERR_SYSTEM,
 		    "calloc: %s", strerror(errno));
@@ -772,7 +773,7 @@ int _vnacal_new_add_common(vnacal_new_add_arguments_t vnaa)
      * Construct the vnacal_new_measurement_t S matrix.
      */
     if ((vnmp->vnm_s_matrix = full_s_matrix =
-		calloc(full_s_rows * full_s_columns,
+		_vnacal_calloc(vcp, full_s_rows * full_s_columns,
 		    sizeof(vnacal_new_parameter_t *))) == NULL) {
 	_vnacal_error(vcp, VNAERR_SYSTEM,
 		"calloc: %s", strerror(errno));
@@ -781,7 +782,7 @@ int _vnacal_new_add_common(vnacal_new_add_arguments_t vnaa)
     {
 	vnacal_parameter_t **matrix = NULL;
 
-	vnmp->vnm_parameter_matrix = matrix = (vnacal_parameter_t **)calloc(
+	vnmp->vnm_parameter_matrix = matrix = _vnacal_calloc(vcp, 
 		full_s_rows * full_s_columns, sizeof(vnacal_parameter_t *));
 	if (matrix == NULL) {
 	    goto out;
@@ -798,7 +799,7 @@ int _vnacal_new_add_common(vnacal_new_add_arguments_t vnaa)
 	if ((vnmp->vnm_parameter_map = _vnacal_analyze_parameter_matrix(
 			function, vcp, matrix, full_s_rows,
 			full_s_columns, /*initial=*/true)) == NULL) {
-		free((void *)matrix);
+		_vnacal_free(vcp, (void *)matrix);
 	    goto out;
 	}
     }
@@ -1005,9 +1006,9 @@ out:
 	    vnacal_new_term_t *vntp = vnep->vne_term_list;
 
 	    vnep->vne_term_list = vntp->vnt_next;
-	    free((void *)vntp);
+	    _vnacal_free(vcp, (void *)vntp);
 	}
-	free((void *)vnep);
+	_vnacal_free(vcp, (void *)vnep);
     }
     _vnacal_new_free_measurement(vnmp);
 
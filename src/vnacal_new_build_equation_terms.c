@@ -230,7 +230,7 @@ static int add_term(vnacal_new_measurement_t *vnmp,
     vnacal_t *vcp = vnp->vn_vcp;
     vnacal_new_term_t *vntp;
 
-    if ((vntp = malloc(sizeof(vnacal_new_term_t))) == NULL) {
+    if ((vntp = _vnacal_malloc(vcp, sizeof(vnacal_new_term_t))) == NULL) {
 	_vnacal_error(vcp, VNAERR_SYSTEM,
 		"malloc: %s", strerror(errno));
 	return -1;
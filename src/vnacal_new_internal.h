@@ -87,6 +87,9 @@ typedef struct vnacal_new_parameter {
  * vnacal_new_parameter_hash_t: collection of new calibration parameters
  */
 typedef struct vnacal_new_parameter_hash {
+    /* associated vnacal_t structure (supplies the allocator) */
+    const vnacal_t *vnph_vcp;
+
     /* hash table keyed on vnpr_parameter->vpmr_index */
     vnacal_new_parameter_t **vnph_table;
 
@@ -609,7 +612,7 @@ extern vnacal_new_parameter_t *_vnacal_new_get_parameter(
 
 /* _vnacal_new_init_parameter_hash: set up the parameter hash */
 extern int _vnacal_new_init_parameter_hash(const char *function,
-	vnacal_new_parameter_hash_t *vnphp);
+	const vnacal_t *vcp, vnacal_new_parameter_hash_t *vnphp);
 
 /* _vnacal_new_free_parameter_hash: free the parameter hash */
 extern void _vnacal_new_free_parameter_hash(
@@ -47,7 +47,8 @@ static int hash_expand(vnacal_new_parameter_hash_t *vnphp)
     /*
      * Resize the table, initializing new buckets to NULL.
      */
-    if ((new_table = realloc(vnphp->vnph_table, new_allocation *
+    if ((new_table = _vnacal_realloc(vnphp->vnph_vcp, vnphp->vnph_table,
+		    new_allocation *
 		    sizeof(vnacal_new_parameter_t *))) == NULL) {
 	return -1;
     }
@@ -132,14 +133,16 @@ static void hash_insert(vnacal_new_parameter_hash_t *vnphp,
 /*
  * _vnacal_new_init_parameter_hash: set up the parameter hash
  *   @function: name of user-called function
+ *   @vcp: associated vnacal_t structure
  *   @vnphp: hash table
  *
  * Caller must log errors.
  */
 int _vnacal_new_init_parameter_hash(const char *function,
-	vnacal_new_parameter_hash_t *vnphp)
+	const vnacal_t *vcp, vnacal_new_parameter_hash_t *vnphp)
 {
     (void)memset((void *)vnphp, 0, sizeof(*vnphp));
+    vnphp->vnph_vcp = vcp;
     return hash_expand(vnphp);
 }
 
@@ -157,10 +160,10 @@ void _vnacal_new_free_parameter_hash(vnacal_new_parameter_hash_t *vnphp)
 		vnphp->vnph_table[bucket] = vnprp->vnpr_hash_next;
 
 		_vnacal_release_parameter(vnprp->vnpr_parameter);
-		free((void *)vnprp);
+		_vnacal_free(vnphp->vnph_vcp, (void *)vnprp);
 	    }
 	}
-	free((void *)vnphp->vnph_table);
+	_vnacal_free(vnphp->vnph_vcp, (void *)vnphp->vnph_table);
 	(void)memset((void *)vnphp, 0, sizeof(*vnphp));
     }
 }
@@ -273,7 +276,7 @@ vnacal_new_parameter_t *_vnacal_new_get_parameter(const char *function,
 
 	if ((vnprp_correlate = _vnacal_new_get_parameter(function, vnp,
 			VNACAL_GET_PARAMETER_INDEX(vpmrp_correlate))) == NULL) {
-	    free((void *)vnprp);
+	    _vnacal_free(vcp, (void *)vnprp);
 	    return NULL;
 	}
     }
@@ -281,7 +284,8 @@ vnacal_new_parameter_t *_vnacal_new_get_parameter(const char *function,
     /*
      * Create a new vnacal_new_parameter_t structure and add to hash table.
      */
-    if ((vnprp = malloc(sizeof(vnacal_new_parameter_t))) == NULL) {
+    if ((vnprp = _vnacal_malloc(vcp,
+		    sizeof(vnacal_new_parameter_t))) == NULL) {
 	_vnacal_error(vcp, VNAERR_SYSTEM,
 		"malloc: %s", strerror(errno));
 	return NULL;
@@ -66,7 +66,7 @@ int vnacal_new_set_m_error(vnacal_new_t *vnp,
      * error setting and return.
      */
     if (sigma_nf_vector == NULL && sigma_tr_vector == NULL) {
-	free((void *)vnp->vn_m_error_vector);
+	_vnacal_free(vcp, (void *)vnp->vn_m_error_vector);
 	vnp->vn_m_error_vector = NULL;
 	return 0;
     }
@@ -161,7 +161,7 @@ int vnacal_new_set_m_error(vnacal_new_t *vnp,
      * Allocate the vector if needed.
      */
     if (m_error_vector == NULL) {
-	if ((m_error_vector = malloc(vnp->vn_frequencies *
+	if ((m_error_vector = _vnacal_malloc(vcp, vnp->vn_frequencies *
 			sizeof(vnacal_new_m_error_t))) == NULL) {
 	    _vnacal_error(vcp, VNAERR_SYSTEM, "malloc: %s", strerror(errno));
 	    return -1;
@@ -26,6 +26,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include "vnacal_new_internal.h"
+#include "vnastats_internal.h"
 
 /*
  * _vnacal_new_solve_init: initialize the solve state structure
@@ -54,7 +55,8 @@ int _vnacal_new_solve_init(vnacal_new_solve_state_t *vnssp, vnacal_new_t *vnp)
      * Allocate a vector of vnacal_new_msv_matrices_t structures,
      * each corresponding to the measured standard with same index.
      */
-    if ((vnssp->vnss_msv_matrices = calloc(vnp->vn_measurement_count,
+    if ((vnssp->vnss_msv_matrices = _vnacal_calloc(vcp,
+		    vnp->vn_measurement_count,
 		    sizeof(vnacal_new_msv_matrices_t))) == NULL) {
 	_vnacal_error(vcp, VNAERR_SYSTEM, "calloc: %s", strerror(errno));
 	return -1;
@@ -72,13 +74,13 @@ int _vnacal_new_solve_init(vnacal_new_solve_state_t *vnssp, vnacal_new_t *vnp)
 	/*
 	 * Allocate the temporary M and S matrices.
 	 */
-	if ((vnmmp->vnmm_m_matrix = calloc(m_rows * m_columns,
+	if ((vnmmp->vnmm_m_matrix = _vnacal_calloc(vcp, m_rows * m_columns,
 			sizeof(double complex))) == NULL) {
 	    _vnacal_error(vcp, VNAERR_SYSTEM, "calloc: %s", strerror(errno));
 	    vs_free(vnssp);
 	    return -1;
 	}
-	if ((vnmmp->vnmm_s_matrix = calloc(s_rows * s_columns,
+	if ((vnmmp->vnmm_s_matrix = _vnacal_calloc(vcp, s_rows * s_columns,
 			sizeof(double complex))) == NULL) {
 	    _vnacal_error(vcp, VNAERR_SYSTEM, "calloc: %s", strerror(errno));
 	    vs_free(vnssp);
@@ -95,7 +97,7 @@ int _vnacal_new_solve_init(vnacal_new_solve_state_t *vnssp, vnacal_new_t *vnp)
 	     * Allocate a vector of pointers to v matrices, one for
 	     * each system.
 	     */
-	    if ((vnmmp->vnsm_v_matrices = calloc(vnp->vn_systems,
+	    if ((vnmmp->vnsm_v_matrices = _vnacal_calloc(vcp, vnp->vn_systems,
 			    sizeof(double complex *))) == NULL) {
 		_vnacal_error(vcp, VNAERR_SYSTEM,
 			"calloc: %s", strerror(errno));
@@ -112,7 +114,7 @@ int _vnacal_new_solve_init(vnacal_new_solve_state_t *vnssp, vnacal_new_t *vnp)
 		if (vnsp->vns_equation_count > vlp->vl_t_terms - 1) {
 		    double complex *v_matrix;
 
-		    if ((v_matrix = calloc(v_rows * v_columns,
+		    if ((v_matrix = _vnacal_calloc(vcp, v_rows * v_columns,
 				    sizeof(double complex))) == NULL) {
 			_vnacal_error(vcp, VNAERR_SYSTEM,
 				"calloc: %s", strerror(errno));
@@ -131,7 +133,8 @@ int _vnacal_new_solve_init(vnacal_new_solve_state_t *vnssp, vnacal_new_t *vnp)
      * structures and populate the off-diagonal elements.
      */
     if (VNACAL_HAS_OUTSIDE_LEAKAGE_TERMS(vlp->vl_type)) {
-	if ((vnssp->vnss_leakage_matrix = calloc(m_rows * m_columns,
+	if ((vnssp->vnss_leakage_matrix = _vnacal_calloc(vcp,
+			m_rows * m_columns,
 			sizeof(vnacal_new_leakage_term_t *))) == NULL) {
 	    _vnacal_error(vcp, VNAERR_SYSTEM,
 		    "calloc: %s", strerror(errno));
@@ -144,7 +147,8 @@ int _vnacal_new_solve_init(vnacal_new_solve_state_t *vnssp, vnacal_new_t *vnp)
 		    const int cell = r * m_columns + c;
 		    vnacal_new_leakage_term_t *vnltp;
 
-		    vnltp = malloc(sizeof(vnacal_new_leakage_term_t));
+		    vnltp = _vnacal_malloc(vcp,
+			    sizeof(vnacal_new_leakage_term_t));
 		    if (vnltp == NULL) {
 			_vnacal_error(vcp, VNAERR_SYSTEM,
 				"malloc: %s", strerror(errno));
@@ -163,14 +167,16 @@ int _vnacal_new_solve_init(vnacal_new_solve_state_t *vnssp, vnacal_new_t *vnp)
      * frequency, of vectors of unknown parameter values.
      */
     if (vnp->vn_unknown_parameters != 0) {
-	if ((vnssp->vnss_p_vector = calloc(vnp->vn_unknown_parameters,
+	if ((vnssp->vnss_p_vector = _vnacal_calloc(vcp,
+			vnp->vn_unknown_parameters,
 			sizeof(double complex *))) == NULL) {
 	    _vnacal_error(vcp, VNAERR_SYSTEM, "calloc: %s", strerror(errno));
 	    vs_free(vnssp);
 	    return -1;
 	}
 	for (int i = 0; i < vnp->vn_unknown_parameters; ++i) {
-	    if ((vnssp->vnss_p_vector[i] = calloc(vnp->vn_frequencies,
+	    if ((vnssp->vnss_p_vector[i] = _vnacal_calloc(vcp,
+			    vnp->vn_frequencies,
 			    sizeof(double complex))) == NULL) {
 		_vnacal_error(vcp, VNAERR_SYSTEM, "calloc: %s",
 			strerror(errno));
@@ -186,14 +192,14 @@ int _vnacal_new_solve_init(vnacal_new_solve_state_t *vnssp, vnacal_new_t *vnp)
      * of the known parameter values.
      */
     if (vnp->vn_known_correlates != 0) {
-	if ((vnssp->vnss_known_correlate_vector = calloc(
+	if ((vnssp->vnss_known_correlate_vector = _vnacal_calloc(vcp, 
 		vnp->vn_known_correlates, sizeof(double complex *))) == NULL) {
 	    _vnacal_error(vcp, VNAERR_SYSTEM, "calloc: %s", strerror(errno));
 	    vs_free(vnssp);
 	    return -1;
 	}
 	for (int i = 0; i < vnp->vn_known_correlates; ++i) {
-	    if ((vnssp->vnss_known_correlate_vector[i] = calloc(
+	    if ((vnssp->vnss_known_correlate_vector[i] = _vnacal_calloc(vcp, 
 		    vnp->vn_frequencies, sizeof(double complex))) == NULL) {
 		_vnacal_error(vcp, VNAERR_SYSTEM, "calloc: %s",
 			strerror(errno));
@@ -548,9 +554,10 @@ void _vnacal_new_solve_update_s_matrices(vnacal_new_solve_state_t *vnssp)
 	    for (int s_column = 0; s_column < s_columns; ++s_column) {
 		const int s_cell = s_row * s_columns + s_column;
 		vnacal_new_parameter_t *vnprp = vnmp->vnm_s_matrix[s_cell];
-		int uindex = vnprp->vnpr_unknown_index;
 
 		if (vnprp != NULL && vnprp->vnpr_unknown) {
+		    int uindex = vnprp->vnpr_unknown_index;
+
 		    s_matrix[s_cell] = vnssp->vnss_p_vector[uindex][findex];
 		}
 	    }
@@ -580,7 +587,8 @@ double *_vnacal_new_solve_calc_weights(vnacal_new_solve_state_t *vnssp)
     double *w_vector = NULL;
 
     assert(vnp->vn_m_error_vector != NULL);
-    if ((w_vector = calloc(vnp->vn_equations, sizeof(double))) == NULL) {
+    if ((w_vector = _vnacal_calloc(vcp, vnp->vn_equations,
+		    sizeof(double))) == NULL) {
 	_vnacal_error(vcp, VNAERR_SYSTEM, "calloc: %s", strerror(errno));
 	return NULL;
     }
@@ -617,29 +625,30 @@ double *_vnacal_new_solve_calc_weights(vnacal_new_solve_state_t *vnssp)
 void _vnacal_new_solve_free(vnacal_new_solve_state_t *vnssp)
 {
     vnacal_new_t *vnp = vnssp->vnss_vnp;
+    vnacal_t *vcp = vnp->vn_vcp;
     const vnacal_layout_t *vlp = &vnp->vn_layout;
     const int m_rows    = VL_M_ROWS(vlp);
     const int m_columns = VL_M_COLUMNS(vlp);
 
     if (vnssp->vnss_known_correlate_vector != NULL) {
 	for (int i = vnp->vn_known_correlates - 1; i >= 0; --i) {
-	    free((void *)vnssp->vnss_known_correlate_vector[i]);
+	    _vnacal_free(vcp, (void *)vnssp->vnss_known_correlate_vector[i]);
 	}
-	free((void *)vnssp->vnss_known_correlate_vector);
+	_vnacal_free(vcp, (void *)vnssp->vnss_known_correlate_vector);
 	vnssp->vnss_known_correlate_vector = NULL;
     }
     if (vnssp->vnss_p_vector != NULL) {
 	for (int i = vnp->vn_unknown_parameters - 1; i >= 0; --i) {
-	    free((void *)vnssp->vnss_p_vector[i]);
+	    _vnacal_free(vcp, (void *)vnssp->vnss_p_vector[i]);
 	}
-	free((void *)vnssp->vnss_p_vector);
+	_vnacal_free(vcp, (void *)vnssp->vnss_p_vector);
 	vnssp->vnss_p_vector = NULL;
     }
     if (vnssp->vnss_leakage_matrix != NULL) {
 	for (int cell = m_rows * m_columns - 1; cell >= 0; --cell) {
-	    free((void *)vnssp->vnss_leakage_matrix[cell]);
+	    _vnacal_free(vcp, (void *)vnssp->vnss_leakage_matrix[cell]);
 	}
-	free((void *)vnssp->vnss_leakage_matrix);
+	_vnacal_free(vcp, (void *)vnssp->vnss_leakage_matrix);
 	vnssp->vnss_leakage_matrix = NULL;
     }
     if (vnssp->vnss_msv_matrices != NULL) {
@@ -648,14 +657,14 @@ void _vnacal_new_solve_free(vnacal_new_solve_state_t *vnssp)
 
 	    if (vnmmp->vnsm_v_matrices != NULL) {
 		for (int si = vnp->vn_systems - 1; si >= 0; --si) {
-		    free((void *)vnmmp->vnsm_v_matrices[si]);
+		    _vnacal_free(vcp, (void *)vnmmp->vnsm_v_matrices[si]);
 		}
-		free((void *)vnmmp->vnsm_v_matrices);
+		_vnacal_free(vcp, (void *)vnmmp->vnsm_v_matrices);
 	    }
-	    free((void *)vnmmp->vnmm_s_matrix);
-	    free((void *)vnmmp->vnmm_m_matrix);
+	    _vnacal_free(vcp, (void *)vnmmp->vnmm_s_matrix);
+	    _vnacal_free(vcp, (void *)vnmmp->vnmm_m_matrix);
 	}
-	free((void *)vnssp->vnss_msv_matrices);
+	_vnacal_free(vcp, (void *)vnssp->vnss_msv_matrices);
 	vnssp->vnss_msv_matrices = NULL;
     }
 }
@@ -871,7 +880,8 @@ int _vnacal_new_solve_internal(vnacal_new_t *vnp)
 	vnacal_new_trl_indices_t vnti;
 
 	if (_vnacal_new_solve_is_trl(vnp, &vnti)) {
-	    if ((vntip = malloc(sizeof(vnacal_new_trl_indices_t))) == NULL) {
+	    vntip = _vnacal_malloc(vcp, sizeof(vnacal_new_trl_indices_t));
+	    if (vntip == NULL) {
 		_vnacal_error(vcp, VNAERR_SYSTEM,
 			"malloc: %s", strerror(errno));
 		goto out;
@@ -886,7 +896,7 @@ int _vnacal_new_solve_internal(vnacal_new_t *vnp)
     for (int findex = 0; findex < frequencies; ++findex) {
 	const int x_length = vnp->vn_systems * (vlp_in->vl_t_terms - 1);
 	double complex x_vector[x_length];
-	double complex e_vector[error_terms_out];
+	double complex e_vector[MAX(error_terms_in, error_terms_out)];
 	int eterm_index = 0;
 
 	/*
@@ -1006,14 +1016,16 @@ int _vnacal_new_solve_internal(vnacal_new_t *vnp)
 
 	assert(vpmrp->vpmr_type == VNACAL_UNKNOWN ||
 	       vpmrp->vpmr_type == VNACAL_CORRELATED);
-	free((void *)vpmrp->vpmr_coefficient_vector);
+	_vnacal_free(vcp, (void *)vpmrp->vpmr_coefficient_vector);
 	vpmrp->vpmr_coefficient_vector = NULL;
+	_vnacal_spline_free_vector(&vcp->vc_allocator, vpmrp->vpmr_spline, 1);
+	vpmrp->vpmr_spline = NULL;
 	if (vpmrp->vpmr_frequencies != frequencies) {
-	    free((void *)vpmrp->vpmr_frequency_vector);
+	    _vnacal_free(vcp, (void *)vpmrp->vpmr_frequency_vector);
 	    vpmrp->vpmr_frequency_vector = NULL;
 	    vpmrp->vpmr_frequencies = 0;
-	    if ((vpmrp->vpmr_frequency_vector = calloc(frequencies,
-			    sizeof(double))) == NULL) {
+	    if ((vpmrp->vpmr_frequency_vector = _vnacal_calloc(vcp,
+			    frequencies, sizeof(double))) == NULL) {
 		_vnacal_error(vcp, VNAERR_SYSTEM,
 			"calloc: %s", strerror(errno));
 		goto out;
@@ -1026,6 +1038,11 @@ int _vnacal_new_solve_internal(vnacal_new_t *vnp)
 	assert(vnss.vnss_p_vector[index] != NULL);
 	vpmrp->vpmr_coefficient_vector = vnss.vnss_p_vector[index];
 	vnss.vnss_p_vector[index] = NULL;
+	if (_vnacal_parameter_set_interpolation("vnacal_new_solve", vpmrp,
+		    vpmrp->vpmr_interpolation) == -1) {
+	    vpmrp->vpmr_interpolation = VNACAL_INTERP_RATIONAL;
+	    goto out;
+	}
     }
 
     /*
@@ -1037,7 +1054,7 @@ int _vnacal_new_solve_internal(vnacal_new_t *vnp)
     rc = 0;
 
 out:
-    free((void *)vntip);
+    _vnacal_free(vcp, (void *)vntip);
     _vnacal_calibration_free(calp);
     vs_free(&vnss);
     return rc;
@@ -1049,9 +1066,14 @@ out:
  */
 int vnacal_new_solve(vnacal_new_t *vnp)
 {
+    uint64_t start = _VNASTATS_NOW();
+    int rv;
+
     if (vnp == NULL) {
 	errno = EINVAL;
 	return -1;
     }
-    return _vnacal_new_solve_internal(vnp);
+    rv = _vnacal_new_solve_internal(vnp);
+    _VNASTATS_TIME(_vnacal_stats, vcs_solve_calls, vcs_solve_ns, start);
+    return rv;
 }
@@ -26,6 +26,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include "vnacal_new_internal.h"
+#include "vnastats_internal.h"
 
 /* #define DEBUG 1 */
 
@@ -227,6 +228,7 @@ int _vnacal_new_solve_auto(vnacal_new_solve_state_t *vnssp,
 #if DEBUG
 	(void)printf("# iteration %d\n", iteration);
 #endif /* DEBUG */
+	_VNASTATS_ADD(_vnacal_stats, vcs_solve_iterations, 1);
 
 	/*
 	 * If this is not the first iteration, update the V matrices
@@ -937,6 +939,6 @@ success:
     /*FALLTHROUGH*/
 
 out:
-    free((void *)w_vector);
+    _vnacal_free(vcp, (void *)w_vector);
     return rv;
 }
@@ -79,7 +79,8 @@ int _vnacal_new_solve_simple(vnacal_new_solve_state_t *vnssp,
 	if ((w_vector = vs_calc_weights(vnssp)) == NULL) {
 	    goto out;
 	}
-	prev_x_segment = malloc(unknowns * sizeof(double complex));
+	prev_x_segment = _vnacal_malloc(vcp,
+		unknowns * sizeof(double complex));
 	if (prev_x_segment == NULL) {
 	    _vnacal_error(vcp, VNAERR_SYSTEM, "malloc: %s", strerror(errno));
 	    goto out;
@@ -268,7 +269,7 @@ int _vnacal_new_solve_simple(vnacal_new_solve_state_t *vnssp,
     rv = 0;
 
 out:
-    free((void *)prev_x_segment);
-    free((void *)w_vector);
+    _vnacal_free(vcp, (void *)prev_x_segment);
+    _vnacal_free(vcp, (void *)w_vector);
     return rv;
 }
@@ -152,7 +152,8 @@ vnacal_parameter_t *_vnacal_alloc_parameter(const char *function, vnacal_t *vcp)
 	} else {
 	    new_allocation = 2 * old_allocation;
 	}
-	if ((vpmrpp = realloc(vprmcp->vprmc_vector, new_allocation *
+	if ((vpmrpp = _vnacal_realloc(vcp, vprmcp->vprmc_vector,
+			new_allocation *
 			sizeof(vnacal_parameter_t *))) == NULL) {
 	    _vnacal_error(vcp, VNAERR_SYSTEM,
 		    "realloc: %s", strerror(errno));
@@ -169,7 +170,7 @@ vnacal_parameter_t *_vnacal_alloc_parameter(const char *function, vnacal_t *vcp)
     /*
      * Allocate and init the new parameter.  Add it to the table.
      */
-    if ((vpmrp = malloc(sizeof(vnacal_parameter_t))) == NULL) {
+    if ((vpmrp = _vnacal_malloc(vcp, sizeof(vnacal_parameter_t))) == NULL) {
 	_vnacal_error(vcp, VNAERR_SYSTEM,
 		"malloc: %s", strerror(errno));
 	return NULL;
@@ -180,6 +181,7 @@ vnacal_parameter_t *_vnacal_alloc_parameter(const char *function, vnacal_t *vcp)
     vpmrp->vpmr_hold_count = 1;
     vpmrp->vpmr_index = parameter;
     vpmrp->vpmr_segment = 0;
+    vpmrp->vpmr_interpolation = VNACAL_INTERP_RATIONAL;
     vpmrp->vpmr_vcp = vcp;
     vprmcp->vprmc_vector[parameter] = vpmrp;
     ++vprmcp->vprmc_count;
@@ -191,10 +193,13 @@ vnacal_parameter_t *_vnacal_alloc_parameter(const char *function, vnacal_t *vcp)
  */
 void _vnacal_free_standard(vnacal_standard_t *stdp)
 {
+    const vnacal_t *vcp;
+
     if (stdp == NULL) {
 	return;
     }
-    (void)free((void *)stdp->std_name);
+    vcp = stdp->std_vcp;
+    (void)_vnacal_free(vcp, (void *)stdp->std_name);
     switch (stdp->std_type) {
     case VNACAL_CALKIT:
 	break;
@@ -204,24 +209,28 @@ void _vnacal_free_standard(vnacal_standard_t *stdp)
 	    const int ports = stdp->std_ports;
 	    vnacal_data_standard_t *vdsp = &stdp->std_data_standard;
 
-	    (void)free((void *)vdsp->vds_frequency_vector);
+	    (void)_vnacal_free(vcp, (void *)vdsp->vds_frequency_vector);
+	    _vnacal_spline_free_vector(&vcp->vc_allocator,
+		    vdsp->vds_data_spline, ports * ports);
+	    _vnacal_spline_free_vector(&vcp->vc_allocator,
+		    vdsp->vds_z0_spline, ports);
 	    if (vdsp->vds_has_fz0) {
 		double complex **vector_vector;
 
 		if ((vector_vector = vdsp->u.vds_z0_vector_vector) != NULL) {
 		    for (int port = 0; port < ports; ++port) {
-			free((void *)vector_vector[port]);
+			_vnacal_free(vcp, (void *)vector_vector[port]);
 		    }
-		    free((void *)vector_vector);
+		    _vnacal_free(vcp, (void *)vector_vector);
 		}
 	    } else {
-		free((void *)vdsp->u.vds_z0_vector);
+		_vnacal_free(vcp, (void *)vdsp->u.vds_z0_vector);
 	    }
 	    if (vdsp->vds_data != NULL) {
 		for (int cell = 0; cell < ports * ports; ++cell) {
-		    free((void *)vdsp->vds_data[cell]);
+		    _vnacal_free(vcp, (void *)vdsp->vds_data[cell]);
 		}
-		free((void *)vdsp->vds_data);
+		_vnacal_free(vcp, (void *)vdsp->vds_data);
 	    }
 	}
 	break;
@@ -229,7 +238,7 @@ void _vnacal_free_standard(vnacal_standard_t *stdp)
     default:
 	assert(!"unhandled case");
     }
-    free((void *)stdp);
+    _vnacal_free(vcp, (void *)stdp);
 }
 
 /*
@@ -253,10 +262,10 @@ static void _vnacal_free_parameter(vnacal_parameter_t *vpmrp)
     case VNACAL_CORRELATED:
 	if (vpmrp->vpmr_sigma_frequency_vector !=
 		vpmrp->vpmr_other->vpmr_frequency_vector) {
-	    free((void *)vpmrp->vpmr_sigma_frequency_vector);
+	    _vnacal_free(vcp, (void *)vpmrp->vpmr_sigma_frequency_vector);
 	}
-	free((void *)vpmrp->vpmr_sigma_vector);
-	free((void *)vpmrp->vpmr_sigma_spline);
+	_vnacal_free(vcp, (void *)vpmrp->vpmr_sigma_vector);
+	_vnacal_free(vcp, (void *)vpmrp->vpmr_sigma_spline);
 	/*FALLTHROUGH*/
 
     case VNACAL_UNKNOWN:
@@ -266,8 +275,9 @@ static void _vnacal_free_parameter(vnacal_parameter_t *vpmrp)
 	/*FALLTHROUGH*/
 
     case VNACAL_VECTOR:
-	free((void *)vpmrp->vpmr_frequency_vector);
-	free((void *)vpmrp->vpmr_coefficient_vector);
+	_vnacal_free(vcp, (void *)vpmrp->vpmr_frequency_vector);
+	_vnacal_free(vcp, (void *)vpmrp->vpmr_coefficient_vector);
+	_vnacal_spline_free_vector(&vcp->vc_allocator, vpmrp->vpmr_spline, 1);
 	break;
 
     case VNACAL_CALKIT:
@@ -282,7 +292,7 @@ static void _vnacal_free_parameter(vnacal_parameter_t *vpmrp)
     default:
 	break;
     }
-    free((void *)vpmrp);
+    _vnacal_free(vcp, (void *)vpmrp);
 }
 
 /*
@@ -384,7 +394,7 @@ void _vnacal_teardown_parameter_collection(vnacal_t *vcp)
 	    assert(vprmcp->vprmc_vector[i] == NULL);
 	}
     }
-    free((void *)vprmcp->vprmc_vector);
+    _vnacal_free(vcp, (void *)vprmcp->vprmc_vector);
     (void)memset((void *)&vcp->vc_parameter_collection, 0,
 	    sizeof(vcp->vc_parameter_collection));
 }
@@ -94,7 +94,8 @@ int vnacal_parameter_matrix_to_data(vnacal_t *vcp,
     /*
      * Form the parameter pointer matrix from the integer parameter matrix.
      */
-    vpmrp_matrix = calloc(rows * columns, sizeof(vnacal_parameter_t *));
+    vpmrp_matrix = _vnacal_calloc(vcp, rows * columns,
+	    sizeof(vnacal_parameter_t *));
     if (vpmrp_matrix == NULL) {
 	_vnacal_error(vcp, VNAERR_SYSTEM, "calloc: %s", strerror(errno));
 	goto out;
@@ -119,21 +120,28 @@ int vnacal_parameter_matrix_to_data(vnacal_t *vcp,
 
     /*
      * Evaluate the parameter matrix at each frequency and store
-     * the result into vdp.
+     * the result into vdp.  In cell-major layout, evaluate into a
+     * scratch matrix and scatter it into the cell vectors.
      */
     for (int findex = 0; findex < frequencies; ++findex) {
 	const double complex *z0_vector;
-	double complex *data_matrix;
+	double complex data_buffer[rows * columns];
+	double complex *data_matrix = data_buffer;
 	double f;
 
 	z0_vector = vnadata_get_fz0_vector(vdp, findex);
-	data_matrix = vnadata_get_matrix(vdp, findex);
+	if (vnadata_get_layout(vdp) == VNADATA_LAYOUT_FREQUENCY_MAJOR) {
+	    data_matrix = vnadata_get_matrix(vdp, findex);
+	}
 	f = vnadata_get_frequency(vdp, findex);
 	rc = _vnacal_eval_parameter_matrix_i(__func__,
 		vpmmp, f, z0_vector, data_matrix);
 	if (rc == -1) {
 	    goto out;
 	}
+	if (data_matrix == data_buffer) {
+	    (void)vnadata_set_matrix(vdp, findex, data_buffer);
+	}
     }
 
     /*
@@ -148,6 +156,6 @@ int vnacal_parameter_matrix_to_data(vnacal_t *vcp,
 
 out:
     _vnacal_free_parameter_matrix_map(vpmmp);
-    free((void *)vpmrp_matrix);
+    _vnacal_free(vcp, (void *)vpmrp_matrix);
     return rc;
 }
@@ -25,6 +25,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include "vnacal_internal.h"
+#include "vnaproperty_internal.h"
 
 
 /*
@@ -163,7 +164,7 @@ int vnacal_property_set(vnacal_t *vcp, int ci,
 	return -1;
     }
     va_start(ap, format);
-    rv = vnaproperty_vset(anchor, format, ap);
+    rv = _vnaproperty_vset(&vcp->vc_allocator, anchor, format, ap);
     va_end(ap);
 
     return rv;
@@ -234,7 +235,8 @@ vnaproperty_t **vnacal_property_set_subtree(vnacal_t *vcp, int ci,
 	return NULL;
     }
     va_start(ap, format);
-    subtree = vnaproperty_vset_subtree(anchor, format, ap);
+    subtree = _vnaproperty_vset_subtree(&vcp->vc_allocator, anchor,
+	    format, ap);
     va_end(ap);
 
     return subtree;
@@ -24,6 +24,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "vnacal_internal.h"
+#include "vnastats_internal.h"
 
 
 #define EPS	1.0e-25
@@ -43,32 +44,35 @@
  */
 
 /*
- * _vnacal_rfi: apply rational function interpolation
+ * _vnacal_rfi_setup_point: find the interpolation window for one x
  *   @xp:         vector of x points
- *   @yp:         vector of y points
- *   @n:          length of xp and yp
+ *   @n:          length of xp
  *   @m:          order (number of points that determine the interpolation)
  *   @ip_segment: addr of left x index that bounds x (used as hint on entry)
  *   @x:          dependent variable to interpolate
+ *   @point:      caller-allocated structure to receive the result
+ *
+ *   The result depends only on the x values and can be used with
+ *   _vnacal_rfi_eval_point to interpolate any y vector that goes
+ *   with xp.
  */
-double complex _vnacal_rfi(const double *xp, const double complex *yp,
-	int n, int m, int *ip_segment, double x)
+void _vnacal_rfi_setup_point(const double *xp, int n, int m,
+	int *ip_segment, double x, vnacal_rfi_point_t *point)
 {
     int base;
     int nearest;
-    int cur;
     int segment = *ip_segment;
-    double complex y;
-    double complex c[m], d[m];
 
     assert(n >= 1);
-    assert(m <= n);
+    assert(m <= n && m <= VNACAL_MAX_M);
 
     /*
      * Special-case one point.
      */
     if (n < 2) {
-	return yp[0];
+	point->rfp_base = 0;
+	point->rfp_cur = -1;
+	return;
     }
 
     /*
@@ -94,21 +98,26 @@ double complex _vnacal_rfi(const double *xp, const double complex *yp,
 	    ++segment;
 	}
     }
+    *ip_segment = segment;
 
     /*
-     * If x is equal to one of the bounds, return the associated y.
-     * Otherise, find the xp index nearest x.
+     * If x is equal to one of the bounds, record the index of the
+     * associated y.  Otherise, find the xp index nearest x.
      */
     {
 	double dx1, dx2;
 
 	dx1 = fabs(x - xp[segment]);
 	if (dx1 <= EPS) {
-	    return yp[segment];
+	    point->rfp_base = segment;
+	    point->rfp_cur = -1;
+	    return;
 	}
 	dx2 = fabs(x - xp[segment + 1]);
 	if (dx2 <= EPS) {
-	    return yp[segment + 1];
+	    point->rfp_base = segment + 1;
+	    point->rfp_cur = -1;
+	    return;
 	}
 	if (dx1 <= dx2 || m < 2) {
 	    nearest = segment;
@@ -130,14 +139,39 @@ double complex _vnacal_rfi(const double *xp, const double complex *yp,
     } else if (base + m > n) {
 	base = n - m;
     }
+    assert(base >= 0 && base <= n - m);
+    assert(nearest - base >= 0 && nearest - base < m);
+    point->rfp_base = base;
+    point->rfp_cur = nearest - base;
+    for (int i = 0; i < m; ++i) {
+	point->rfp_dx[i] = x - xp[base + i];
+    }
+}
+
+/*
+ * _vnacal_rfi_eval_point: interpolate y at a point set up above
+ *   @point: result of _vnacal_rfi_setup_point
+ *   @m:     order given to _vnacal_rfi_setup_point
+ *   @yp:    vector of y points
+ */
+double complex _vnacal_rfi_eval_point(const vnacal_rfi_point_t *point,
+	int m, const double complex *yp)
+{
+    const int base = point->rfp_base;
+    const double *dx = point->rfp_dx;
+    int cur = point->rfp_cur;
+    double complex y;
+    double complex c[VNACAL_MAX_M], d[VNACAL_MAX_M];
+
+    _VNASTATS_ADD(_vnacal_stats, vcs_rfi_calls, 1);
+    if (cur < 0) {
+	return yp[base];
+    }
 
     /*
      * Compute the rational function interpolation of x using the
      * Burlirch-Stoer algorithm.
      */
-    cur = nearest - base;
-    assert(base >= 0 && base <= n - m);
-    assert(cur >= 0 && cur < m);
     for (int i = 0; i < m; ++i) {
 	c[i] = yp[base + i];
 	d[i] = yp[base + i] + EPS;
@@ -148,15 +182,22 @@ double complex _vnacal_rfi(const double *xp, const double complex *yp,
 
 	for (j = 0; j < m - i - 1; ++j) {
 	    double complex c_d = c[j + 1] - d[j];
-	    double complex dx1 = x - xp[base + j];
-	    double complex dx2 = x - xp[base + i + j + 1];
+	    double dx1 = dx[j];
+	    double dx2 = dx[i + j + 1];
 	    double complex den = dx1 * d[j] - dx2 * c[j + 1];
-
-	    if (cabs(den) < 10.0 * EPS) {
-		goto done;
+	    double complex q;
+
+	    /*
+	     * Compare the squared magnitude to avoid the hypot call
+	     * in cabs, and divide once for both updates.
+	     */
+	    if (creal(den) * creal(den) + cimag(den) * cimag(den) <
+		    100.0 * EPS * EPS) {
+		return y;
 	    }
-	    c[j] = c_d * dx1 * d[j]     / den;
-	    d[j] = c_d * dx2 * c[j + 1] / den;
+	    q = c_d / den;
+	    c[j] = q * dx1 * d[j];
+	    d[j] = q * dx2 * c[j + 1];
 	}
 	if (2 * (cur + 1) < m - i) {
 	    assert(cur + 1 >= 0 && cur + 1 < m - i);
@@ -166,7 +207,23 @@ double complex _vnacal_rfi(const double *xp, const double complex *yp,
 	    y += d[cur--];
 	}
     }
-done:
-    *ip_segment = segment;
     return y;
 }
+
+/*
+ * _vnacal_rfi: apply rational function interpolation
+ *   @xp:         vector of x points
+ *   @yp:         vector of y points
+ *   @n:          length of xp and yp
+ *   @m:          order (number of points that determine the interpolation)
+ *   @ip_segment: addr of left x index that bounds x (used as hint on entry)
+ *   @x:          dependent variable to interpolate
+ */
+double complex _vnacal_rfi(const double *xp, const double complex *yp,
+	int n, int m, int *ip_segment, double x)
+{
+    vnacal_rfi_point_t point;
+
+    _vnacal_rfi_setup_point(xp, n, m, ip_segment, x, &point);
+    return _vnacal_rfi_eval_point(&point, m, yp);
+}
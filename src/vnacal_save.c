@@ -30,259 +30,625 @@
 #include <string.h>
 #include <yaml.h>
 #include "vnacal_internal.h"
+#include "vnacommon_internal.h"
 #include "vnaproperty_internal.h"
+#include "vnastats_internal.h"
 
 /*
- * format_complex: format a complex number into the given buffer
+ * save_state_t: state carried through vnacal_save
+ */
+typedef struct save_state {
+    vnacal_t		       *ss_vcp;		/* calibration structure */
+    vnaproperty_yaml_t		ss_vyml;	/* emitter and error info */
+    char		       *ss_buffer;	/* number formatting buffer */
+    size_t			ss_size;	/* bytes in ss_buffer */
+} save_state_t;
+
+/*
+ * format_real: format a double exactly as "%.*e" would
+ *   @cp: buffer with room for precision + 8 bytes
+ *   @value: value to format
+ *   @precision: significant digits (1..n)
+ *   @plus: if true, always include the sign as in "%+.*e"
+ *
+ *   Return a pointer to the terminating nul.
+ */
+static char *format_real(char *cp, double value, int precision, bool plus)
+{
+    char digits[VNACOMMON_FAST_DIGITS_MAX_PRECISION];
+    int exponent;
+
+    if (!isfinite(value) || precision > VNACOMMON_FAST_DIGITS_MAX_PRECISION ||
+	    !_vnacommon_fast_digits(value, precision, digits, &exponent)) {
+	return cp + sprintf(cp, plus ? "%+.*e" : "%.*e", precision - 1, value);
+    }
+    if (signbit(value)) {
+	*cp++ = '-';
+    } else if (plus) {
+	*cp++ = '+';
+    }
+    *cp++ = digits[0];
+    if (precision > 1) {
+	*cp++ = '.';
+	(void)memcpy((void *)cp, (void *)&digits[1], precision - 1);
+	cp += precision - 1;
+    }
+    *cp++ = 'e';
+    if (exponent < 0) {
+	*cp++ = '-';
+	exponent = -exponent;
+    } else {
+	*cp++ = '+';
+    }
+    if (exponent >= 100) {
+	*cp++ = '0' + exponent / 100;
+	exponent %= 100;
+    }
+    *cp++ = '0' + exponent / 10;
+    *cp++ = '0' + exponent % 10;
+    *cp = '\000';
+    return cp;
+}
+
+/*
+ * format_complex: format a complex number into the state buffer
+ *   @ssp: save state
  *   @value: complex value to format
- *   @precision: digits of precision
- *   @buf: buffer
- *   @size: number of bytes in buffer
  */
-static void format_complex(double complex value, int precision,
-	char *buf, size_t size)
+static const char *format_complex(save_state_t *ssp, double complex value)
 {
-    double real = creal(value);
-    double imag = cimag(value);
-    size_t s;
+    const int precision = ssp->ss_vcp->vc_dprecision;
+    char *cp = ssp->ss_buffer;
 
     assert(precision >= 1);
     if (precision == VNACAL_MAX_PRECISION) {
-	s = snprintf(buf, size, "%+a %+aj", real, imag);
-    } else {
-	s = snprintf(buf, size, "%+.*e %+.*ej",
-		precision - 1, real,
-		precision - 1, imag) == -1;
+	(void)snprintf(cp, ssp->ss_size, "%+a %+aj",
+		creal(value), cimag(value));
+	return ssp->ss_buffer;
     }
-    assert(s < size); /* otherwise result was truncated */
+    cp = format_real(cp, creal(value), precision, true);
+    *cp++ = ' ';
+    cp = format_real(cp, cimag(value), precision, true);
+    *cp++ = 'j';
+    *cp = '\000';
+    assert((size_t)(cp - ssp->ss_buffer) < ssp->ss_size);
+    return ssp->ss_buffer;
 }
 
 /*
- * add_properties: add user-properties
- *   @root: where to place the properties entry
- *   @properties: properties to place
+ * emit_collection: emit a mapping or sequence start or end event
+ *   @ssp: save state
+ *   @type: one of the four collection event types
  */
-static int add_properties(vnaproperty_t **root, const vnaproperty_t *properties)
+static int emit_collection(save_state_t *ssp, yaml_event_type_t type)
 {
-    vnaproperty_t **anchor;
+    yaml_event_t event;
 
-    if ((anchor = vnaproperty_set_subtree(root, "properties")) == NULL) {
-	return -1;
+    switch (type) {
+    case YAML_MAPPING_START_EVENT:
+	(void)yaml_mapping_start_event_initialize(&event, NULL, NULL, 1,
+		YAML_ANY_MAPPING_STYLE);
+	break;
+
+    case YAML_MAPPING_END_EVENT:
+	(void)yaml_mapping_end_event_initialize(&event);
+	break;
+
+    case YAML_SEQUENCE_START_EVENT:
+	(void)yaml_sequence_start_event_initialize(&event, NULL, NULL, 1,
+		YAML_ANY_SEQUENCE_STYLE);
+	break;
+
+    case YAML_SEQUENCE_END_EVENT:
+	(void)yaml_sequence_end_event_initialize(&event);
+	break;
+
+    default:
+	abort();
     }
-    if (vnaproperty_copy(anchor, properties) == -1) {
+    return _vnaproperty_yaml_emit_event(&ssp->ss_vyml, &event);
+}
+
+/*
+ * emit_entry: emit a map key followed by a scalar value
+ *   @ssp: save state
+ *   @key: map key
+ *   @value: scalar value
+ */
+static int emit_entry(save_state_t *ssp, const char *key, const char *value)
+{
+    if (_vnaproperty_yaml_emit_key(&ssp->ss_vyml, key) == -1 ||
+	    _vnaproperty_yaml_emit_scalar(&ssp->ss_vyml, value) == -1) {
 	return -1;
     }
     return 0;
 }
 
 /*
- * vnacal_save: create or overwrite a calibration file with new data
- *   @vcp: pointer returned from vnacal_create or vnacal_load
- *   @pathname: calibration file name
+ * emit_int_entry: emit a map key followed by an integer value
+ *   @ssp: save state
+ *   @key: map key
+ *   @value: integer value
+ */
+static int emit_int_entry(save_state_t *ssp, const char *key, int value)
+{
+    char buf[3 * sizeof(int) + 2];
+
+    (void)sprintf(buf, "%d", value);
+    return emit_entry(ssp, key, buf);
+}
+
+/*
+ * emit_double_entry: emit a map key followed by a real value
+ *   @ssp: save state
+ *   @key: map key
+ *   @value: value to emit
  *
- *   The pathname and basename parameters work as in vnacal_load except
- *   that the $HOME/{pathname} directory is created if necessary.
+ *   Use the data precision, but never more digits than needed to
+ *   reproduce the value exactly.
  */
-int vnacal_save(vnacal_t *vcp, const char *pathname)
+static int emit_double_entry(save_state_t *ssp, const char *key,
+	double value)
 {
-    FILE *fp = NULL;
-    vnaproperty_t *vprpp_root = NULL;
-    vnaproperty_t **vprpp_calibrations;
-    vnacal_error_term_matrix_t *matrix_list = NULL;
-    const int dprecision = vcp->vc_dprecision;
-    char buf[81];
-    int minor_version = 0;
-    int rc = -1;
+    (void)format_real(ssp->ss_buffer, value,
+	    MIN(ssp->ss_vcp->vc_dprecision, 17), false);
+    return emit_entry(ssp, key, ssp->ss_buffer);
+}
 
-    if ((fp = fopen(pathname, "w")) == NULL) {
-	_vnacal_error(vcp, VNAERR_SYSTEM, "fopen: %s: %s",
-		vcp->vc_filename, strerror(errno));
+/*
+ * emit_complex: emit a complex scalar value
+ *   @ssp: save state
+ *   @value: value to emit
+ */
+static int emit_complex(save_state_t *ssp, double complex value)
+{
+    return _vnaproperty_yaml_emit_scalar(&ssp->ss_vyml,
+	    format_complex(ssp, value));
+}
+
+/*
+ * emit_properties: emit the properties entry
+ *   @ssp: save state
+ *   @properties: properties to emit
+ */
+static int emit_properties(save_state_t *ssp, const vnaproperty_t *properties)
+{
+    if (_vnaproperty_yaml_emit_key(&ssp->ss_vyml, "properties") == -1 ||
+	    _vnaproperty_yaml_emit(&ssp->ss_vyml, properties) == -1) {
 	return -1;
     }
-    free((void *)vcp->vc_filename);
-    if ((vcp->vc_filename = strdup(pathname)) == NULL) {
-	_vnacal_error(vcp, VNAERR_SYSTEM, "strdup: %s", strerror(errno));
-	goto out;
-    }
-    if (add_properties(&vprpp_root, vcp->vc_properties) == -1) {
-	goto vnaproperty_set_error;
+    return 0;
+}
+
+/*
+ * emit_frequency: emit the data entry for one frequency
+ *   @ssp: save state
+ *   @calp: calibration
+ *   @matrix_list: error term matrices of calp
+ *   @findex: frequency index
+ */
+static int emit_frequency(save_state_t *ssp, const vnacal_calibration_t *calp,
+	const vnacal_error_term_matrix_t *matrix_list, int findex)
+{
+    vnacal_t *vcp = ssp->ss_vcp;
+
+    if (emit_collection(ssp, YAML_MAPPING_START_EVENT) == -1) {
+	return -1;
     }
-    vprpp_calibrations = vnaproperty_set_subtree(&vprpp_root, "calibrations[]");
-    if (vprpp_calibrations == NULL) {
-	goto vnaproperty_set_error;
+    (void)format_real(ssp->ss_buffer, calp->cal_frequency_vector[findex],
+	    vcp->vc_fprecision + 1, false);
+    if (emit_entry(ssp, "f", ssp->ss_buffer) == -1) {
+	return -1;
     }
-    for (int ci = 0; ci < vcp->vc_calibration_allocation; ++ci) {
-	vnacal_calibration_t *calp = vcp->vc_calibration_vector[ci];
-	vnacal_layout_t vl;
-	vnaproperty_t **vprpp_calibration;
-	vnaproperty_t **vprpp_data;
+    if (calp->cal_z0_type == VNACAL_Z0_MATRIX) {
+	int ports = MAX(calp->cal_rows, calp->cal_columns);
 
-	if (calp == NULL) {
-	    continue;
-	}
-	if (calp->cal_z0_type != VNACAL_Z0_SCALAR && minor_version < 1) {
-	    minor_version = 1;
-	}
-	_vnacal_layout(&vl, calp->cal_type, calp->cal_rows, calp->cal_columns);
-	if (_vnacal_build_error_term_list(calp, &vl, &matrix_list) == -1) {
-	    goto out;
+	if (_vnaproperty_yaml_emit_key(&ssp->ss_vyml, "z0") == -1 ||
+		emit_collection(ssp, YAML_SEQUENCE_START_EVENT) == -1) {
+	    return -1;
 	}
-	if ((vprpp_calibration = vnaproperty_set_subtree(
-		vprpp_calibrations, "[+]{}")) == NULL) {
-	    goto vnaproperty_set_error;
-	}
-	if (vnaproperty_set(vprpp_calibration, "name=%s",
-		    calp->cal_name) == -1) {
-	    goto vnaproperty_set_error;
-	}
-	if (vnaproperty_set(vprpp_calibration, "type=%s",
-		    vnacal_type_to_name(calp->cal_type)) == -1) {
-	    goto vnaproperty_set_error;
-	}
-	if (vnaproperty_set(vprpp_calibration, "rows=%d",
-		    calp->cal_rows) == -1) {
-	    goto vnaproperty_set_error;
+	for (int port = 0; port < ports; ++port) {
+	    if (emit_complex(ssp, calp->cal_z0_matrix[port][findex]) == -1) {
+		return -1;
+	    }
 	}
-	if (vnaproperty_set(vprpp_calibration, "columns=%d",
-		    calp->cal_columns) == -1) {
-	    goto vnaproperty_set_error;
+	if (emit_collection(ssp, YAML_SEQUENCE_END_EVENT) == -1) {
+	    return -1;
 	}
-	if (vnaproperty_set(vprpp_calibration, "frequencies=%d",
-		    calp->cal_frequencies) == -1) {
-	    goto vnaproperty_set_error;
+    }
+    for (const vnacal_error_term_matrix_t *vetmp = matrix_list;
+	    vetmp != NULL; vetmp = vetmp->vetm_next) {
+	vnacal_error_term_matrix_type_t type = vetmp->vetm_type;
+	double complex **matrix = vetmp->vetm_matrix;
+	const int rows = vetmp->vetm_rows;
+	const int columns = vetmp->vetm_columns;
+
+	if (_vnaproperty_yaml_emit_key(&ssp->ss_vyml,
+		    vetmp->vetm_name) == -1 ||
+		emit_collection(ssp, YAML_SEQUENCE_START_EVENT) == -1) {
+	    return -1;
 	}
-	switch (calp->cal_z0_type) {
-	case VNACAL_Z0_SCALAR:
-	    format_complex(calp->cal_z0, dprecision, buf, sizeof(buf));
-	    if (vnaproperty_set(vprpp_calibration, "z0=%s", buf) == -1) {
-		goto vnaproperty_set_error;
+	switch (type) {
+	case VETM_VECTOR:
+	    assert(vetmp->vetm_rows == 1);
+	    for (int i = 0; i < columns; ++i) {
+		if (emit_complex(ssp, matrix[i][findex]) == -1) {
+		    return -1;
+		}
 	    }
 	    break;
 
-	case VNACAL_Z0_VECTOR:
-	    {
-		vnaproperty_t **vprpp;
-		int ports = MAX(calp->cal_rows, calp->cal_columns);
-
-		vprpp = vnaproperty_set_subtree(vprpp_calibration, "z0[]");
-		if (vprpp == NULL) {
-		    goto vnaproperty_set_error;
+	case VETM_MATRIX_ND:
+	case VETM_MATRIX:
+	    for (int row = 0; row < rows; ++row) {
+		if (emit_collection(ssp, YAML_SEQUENCE_START_EVENT) == -1) {
+		    return -1;
 		}
-		for (int port = 0; port < ports; ++port) {
-		    format_complex(calp->cal_z0_vector[port],
-			    dprecision, buf, sizeof(buf));
-		    if (vnaproperty_set(vprpp, "z0[%d]=%s", port, buf) == -1) {
-			goto vnaproperty_set_error;
+		for (int column = 0; column < columns; ++column) {
+		    if (row != column || type != VETM_MATRIX_ND) {
+			if (emit_complex(ssp, (*matrix++)[findex]) == -1) {
+			    return -1;
+			}
+		    } else {
+			if (_vnaproperty_yaml_emit_scalar(&ssp->ss_vyml,
+				    NULL) == -1) {
+			    return -1;
+			}
 		    }
 		}
+		if (emit_collection(ssp, YAML_SEQUENCE_END_EVENT) == -1) {
+		    return -1;
+		}
 	    }
 	    break;
 
-	case VNACAL_Z0_MATRIX:
-	    break;
-
 	default:
 	    abort();
 	}
-	if (add_properties(vprpp_calibration, calp->cal_properties) == -1) {
-	    goto vnaproperty_set_error;
-	}
-	vprpp_data = vnaproperty_set_subtree(vprpp_calibration, "data[]");
-	if (vprpp_data == NULL) {
-	    goto vnaproperty_set_error;
+	if (emit_collection(ssp, YAML_SEQUENCE_END_EVENT) == -1) {
+	    return -1;
 	}
-	for (int findex = 0; findex < calp->cal_frequencies; ++findex) {
-	    double f = calp->cal_frequency_vector[findex];
-	    vnaproperty_t **vprpp_frequency;
+    }
+    return emit_collection(ssp, YAML_MAPPING_END_EVENT);
+}
+
+/*
+ * emit_models: emit the error term models of a compacted calibration
+ *   @ssp: save state
+ *   @calp: calibration
+ *
+ *   Emit a sequence of models, in error term order, each giving its
+ *   fit error, the segment breakpoints and the coefficients of each
+ *   segment, constant term first.
+ */
+static int emit_models(save_state_t *ssp, const vnacal_calibration_t *calp)
+{
+    vnacal_t *vcp = ssp->ss_vcp;
 
-	    if ((vprpp_frequency = vnaproperty_set_subtree(vprpp_data, "[%d]{}",
-			    findex)) == NULL) {
-		goto vnaproperty_set_error;
+    if (_vnaproperty_yaml_emit_key(&ssp->ss_vyml, "models") == -1 ||
+	    emit_collection(ssp, YAML_SEQUENCE_START_EVENT) == -1) {
+	return -1;
+    }
+    for (int term = 0; term < calp->cal_error_terms; ++term) {
+	const vnacal_model_t *vmp = &calp->cal_error_term_model[term];
+
+	if (emit_collection(ssp, YAML_MAPPING_START_EVENT) == -1 ||
+		emit_double_entry(ssp, "fit_error",
+		    vmp->vm_fit_error) == -1 ||
+		_vnaproperty_yaml_emit_key(&ssp->ss_vyml,
+		    "breakpoints") == -1 ||
+		emit_collection(ssp, YAML_SEQUENCE_START_EVENT) == -1) {
+	    return -1;
+	}
+	for (int k = 0; k <= vmp->vm_segments; ++k) {
+	    (void)format_real(ssp->ss_buffer, vmp->vm_breakpoint_vector[k],
+		    vcp->vc_fprecision + 1, false);
+	    if (_vnaproperty_yaml_emit_scalar(&ssp->ss_vyml,
+			ssp->ss_buffer) == -1) {
+		return -1;
 	    }
-	    if (vnaproperty_set(vprpp_frequency, "f=%.*e",
-			vcp->vc_fprecision, f) == -1) {
-		goto vnaproperty_set_error;
+	}
+	if (emit_collection(ssp, YAML_SEQUENCE_END_EVENT) == -1 ||
+		_vnaproperty_yaml_emit_key(&ssp->ss_vyml,
+		    "coefficients") == -1 ||
+		emit_collection(ssp, YAML_SEQUENCE_START_EVENT) == -1) {
+	    return -1;
+	}
+	for (int k = 0; k < vmp->vm_segments; ++k) {
+	    if (emit_collection(ssp, YAML_SEQUENCE_START_EVENT) == -1) {
+		return -1;
 	    }
-	    if (calp->cal_z0_type == VNACAL_Z0_MATRIX) {
-		vnaproperty_t **vprpp;
-		int ports = MAX(calp->cal_rows, calp->cal_columns);
-
-		vprpp = vnaproperty_set_subtree(vprpp_calibration, "z0[]");
-		if (vprpp == NULL) {
-		    goto vnaproperty_set_error;
-		}
-		for (int port = 0; port < ports; ++port) {
-		    format_complex(calp->cal_z0_matrix[port][findex],
-			    dprecision, buf, sizeof(buf));
-		    if (vnaproperty_set(vprpp, "z0[%d]=%s", port, buf) == -1) {
-			goto vnaproperty_set_error;
-		    }
+	    for (int j = 0; j <= VNACAL_MODEL_ORDER; ++j) {
+		if (emit_complex(ssp,
+			    vmp->vm_coefficient_vector[k][j]) == -1) {
+		    return -1;
 		}
 	    }
-	    for (vnacal_error_term_matrix_t *vetmp = matrix_list;
-		    vetmp != NULL; vetmp = vetmp->vetm_next) {
-		vnaproperty_t **vprpp_term;
-		vnacal_error_term_matrix_type_t type = vetmp->vetm_type;
-		double complex **matrix = vetmp->vetm_matrix;
-		const int rows = vetmp->vetm_rows;
-		const int columns = vetmp->vetm_columns;
-
-		if ((vprpp_term = vnaproperty_set_subtree(
-			vprpp_frequency, "%s[]", vetmp->vetm_name)) == NULL) {
-		    goto vnaproperty_set_error;
-		}
-		switch (type) {
-		case VETM_VECTOR:
-		    assert(vetmp->vetm_rows == 1);
-		    for (int i = 0; i < columns; ++i) {
-			format_complex(matrix[i][findex],
-				dprecision, buf, sizeof(buf));
-			if (vnaproperty_set(vprpp_term, "[%d]=%s",
-				    i, buf) == -1) {
-			    goto vnaproperty_set_error;
-			}
-		    }
-		    break;
+	    if (emit_collection(ssp, YAML_SEQUENCE_END_EVENT) == -1) {
+		return -1;
+	    }
+	}
+	if (emit_collection(ssp, YAML_SEQUENCE_END_EVENT) == -1 ||
+		emit_collection(ssp, YAML_MAPPING_END_EVENT) == -1) {
+	    return -1;
+	}
+    }
+    return emit_collection(ssp, YAML_SEQUENCE_END_EVENT);
+}
 
-		case VETM_MATRIX_ND:
-		case VETM_MATRIX:
-		    for (int row = 0; row < rows; ++row) {
-			vnaproperty_t **vprpp_row;
+/*
+ * emit_calibration: emit one calibration
+ *   @ssp: save state
+ *   @calp: calibration to emit
+ *
+ *   The data entries of a compacted calibration hold only the
+ *   frequencies and any per-frequency reference impedances; the
+ *   models stand in for the error terms.
+ */
+static int emit_calibration(save_state_t *ssp, vnacal_calibration_t *calp)
+{
+    vnacal_layout_t vl;
+    vnacal_error_term_matrix_t *matrix_list = NULL;
+    int rc = -1;
 
-			if ((vprpp_row = vnaproperty_set_subtree(
-				vprpp_term, "[%d][]", row)) == NULL) {
-			    goto vnaproperty_set_error;
-			}
-			for (int column = 0; column < columns; ++column) {
-			    if (row != column || type != VETM_MATRIX_ND) {
-				format_complex((*matrix++)[findex],
-					dprecision, buf, sizeof(buf));
-				if (vnaproperty_set(vprpp_row, "[%d]=%s",
-					    column, buf) == -1) {
-				    goto vnaproperty_set_error;
-				}
-			    } else {
-				if (vnaproperty_set(vprpp_row, "[%d]#",
-					    column) == -1) {
-				    goto vnaproperty_set_error;
-				}
-			    }
-			}
-		    }
-		    break;
+    _vnacal_layout(&vl, calp->cal_type, calp->cal_rows, calp->cal_columns);
+    if (calp->cal_error_term_model == NULL &&
+	    _vnacal_build_error_term_list(calp, &vl, &matrix_list) == -1) {
+	goto out;
+    }
+    if (emit_collection(ssp, YAML_MAPPING_START_EVENT) == -1 ||
+	    emit_entry(ssp, "name", calp->cal_name) == -1 ||
+	    emit_entry(ssp, "type",
+		vnacal_type_to_name(calp->cal_type)) == -1 ||
+	    emit_int_entry(ssp, "rows", calp->cal_rows) == -1 ||
+	    emit_int_entry(ssp, "columns", calp->cal_columns) == -1 ||
+	    emit_int_entry(ssp, "frequencies", calp->cal_frequencies) == -1) {
+	goto out;
+    }
+    switch (calp->cal_z0_type) {
+    case VNACAL_Z0_SCALAR:
+	if (emit_entry(ssp, "z0", format_complex(ssp, calp->cal_z0)) == -1) {
+	    goto out;
+	}
+	break;
+
+    case VNACAL_Z0_VECTOR:
+	{
+	    int ports = MAX(calp->cal_rows, calp->cal_columns);
 
-		default:
-		    abort();
+	    if (_vnaproperty_yaml_emit_key(&ssp->ss_vyml, "z0") == -1 ||
+		    emit_collection(ssp, YAML_SEQUENCE_START_EVENT) == -1) {
+		goto out;
+	    }
+	    for (int port = 0; port < ports; ++port) {
+		if (emit_complex(ssp, calp->cal_z0_vector[port]) == -1) {
+		    goto out;
 		}
 	    }
+	    if (emit_collection(ssp, YAML_SEQUENCE_END_EVENT) == -1) {
+		goto out;
+	    }
 	}
-	_vnacal_free_error_term_matrices(&matrix_list);
+	break;
+
+    case VNACAL_Z0_MATRIX:
+	break;
+
+    default:
+	abort();
+    }
+    if (calp->cal_interpolation != VNACAL_INTERP_RATIONAL &&
+	    emit_entry(ssp, "interpolation",
+		vnacal_interpolation_to_name(calp->cal_interpolation)) == -1) {
+	goto out;
+    }
+    if (calp->cal_error_term_model != NULL &&
+	    (emit_double_entry(ssp, "compact_tolerance",
+		calp->cal_compact_tolerance) == -1 ||
+	     emit_models(ssp, calp) == -1)) {
+	goto out;
+    }
+    if (emit_properties(ssp, calp->cal_properties) == -1) {
+	goto out;
     }
+    if (_vnaproperty_yaml_emit_key(&ssp->ss_vyml, "data") == -1 ||
+	    emit_collection(ssp, YAML_SEQUENCE_START_EVENT) == -1) {
+	goto out;
+    }
+    for (int findex = 0; findex < calp->cal_frequencies; ++findex) {
+	if (emit_frequency(ssp, calp, matrix_list, findex) == -1) {
+	    goto out;
+	}
+    }
+    if (emit_collection(ssp, YAML_SEQUENCE_END_EVENT) == -1 ||
+	    emit_collection(ssp, YAML_MAPPING_END_EVENT) == -1) {
+	goto out;
+    }
+    rc = 0;
+
+out:
+    _vnacal_free_error_term_matrices(calp->cal_vcp, &matrix_list);
+    return rc;
+}
+
+/*
+ * is_binary: test if pathname calls for the binary calibration format
+ *   @pathname: calibration file name
+ */
+static bool is_binary(const char *pathname)
+{
+    const char *suffix = strrchr(pathname, '.');
+
+    return suffix != NULL && strcasecmp(suffix, ".vnacalb") == 0;
+}
+
+/*
+ * vnacal_save: create or overwrite a calibration file with new data
+ *   @vcp: pointer returned from vnacal_create or vnacal_load
+ *   @pathname: calibration file name
+ *
+ *   The pathname and basename parameters work as in vnacal_load except
+ *   that the $HOME/{pathname} directory is created if necessary.
+ *   If pathname ends in ".vnacalb", write the binary format.
+ *
+ *   Rather than building a property tree of the entire file and
+ *   exporting it, send events directly to the YAML emitter so that
+ *   memory use doesn't grow with the size of the calibration.  The
+ *   output is the same as the tree export would produce.
+ */
+int vnacal_save(vnacal_t *vcp, const char *pathname)
+{
+    uint64_t start = _VNASTATS_NOW();
+    FILE *fp = NULL;
+    char *temp_pathname = NULL;
+    save_state_t ss;
+    yaml_emitter_t emitter;
+    yaml_tag_directive_t tags[1];
+    yaml_event_t event;
+    bool delete_emitter = false;
+    int precision;
+    int minor_version = 0;
+    int rc = -1;
+
+    (void)memset((void *)&ss, 0, sizeof(ss));
+
+    /*
+     * Load any calibrations deferred by vnacal_load_lazy before we
+     * replace the file.
+     */
+    for (int ci = 0; ci < vcp->vc_calibration_allocation; ++ci) {
+	vnacal_calibration_t *calp = vcp->vc_calibration_vector[ci];
+
+	if (calp != NULL && calp->cal_deferred != NULL &&
+		_vnacal_get_calibration(__func__, vcp, ci) == NULL) {
+	    return -1;
+	}
+    }
+    _vnacal_close_lazy(vcp);
+
+    /*
+     * Write a temporary file and rename it over pathname so that
+     * anyone who has the old file mapped or open keeps its contents.
+     */
+    if ((fp = _vnacommon_replace_open(pathname, &temp_pathname)) == NULL) {
+	_vnacal_error(vcp, VNAERR_SYSTEM, "open: %s: %s",
+		pathname, strerror(errno));
+	return -1;
+    }
+    _vnacal_free(vcp, (void *)vcp->vc_filename);
+    if ((vcp->vc_filename = _vnacal_strdup(vcp, pathname)) == NULL) {
+	_vnacal_error(vcp, VNAERR_SYSTEM, "strdup: %s", strerror(errno));
+	goto out;
+    }
+    if (is_binary(pathname)) {
+	if (_vnacal_save_binary(vcp, fp) == -1) {
+	    goto out;
+	}
+	goto close;
+    }
+    ss.ss_vcp = vcp;
+    ss.ss_vyml.vyml_filename = vcp->vc_filename;
+    ss.ss_vyml.vyml_error_fn = vcp->vc_error_fn;
+    ss.ss_vyml.vyml_error_arg = vcp->vc_error_arg;
+    ss.ss_vyml.vyml_emitter = &emitter;
+
+    /*
+     * Allocate a buffer large enough for a complex value at the data
+     * precision, a frequency at the frequency precision, or a complex
+     * value in hexadecimal floating point.
+     */
+    precision = MAX(vcp->vc_dprecision, vcp->vc_fprecision + 1);
+    ss.ss_size = 2 * (MAX(precision, 32) + 8) + 2;
+    if ((ss.ss_buffer = _vnacal_malloc(vcp, ss.ss_size)) == NULL) {
+	_vnacal_error(vcp, VNAERR_SYSTEM, "malloc: %s", strerror(errno));
+	goto out;
+    }
+
+    /*
+     * Per-port reference impedances need format version 1.1, and
+     * interpolation methods other than rational and compacted
+     * calibrations need version 1.2.
+     */
+    for (int ci = 0; ci < vcp->vc_calibration_allocation; ++ci) {
+	vnacal_calibration_t *calp = vcp->vc_calibration_vector[ci];
+
+	if (calp == NULL) {
+	    continue;
+	}
+	if (calp->cal_interpolation != VNACAL_INTERP_RATIONAL ||
+		calp->cal_error_term_model != NULL) {
+	    minor_version = 2;
+	    break;
+	}
+	if (calp->cal_z0_type != VNACAL_Z0_SCALAR) {
+	    minor_version = 1;
+	}
+    }
+
+    /*
+     * Set up the emitter as vnaproperty_export_yaml_to_file does.
+     */
+    if (!yaml_emitter_initialize(&emitter)) {
+	if (errno == 0) {
+	    errno = EINVAL;
+	}
+	_vnacal_error(vcp, VNAERR_SYSTEM, "yaml_emitter_initialize: %s: %s",
+		vcp->vc_filename, strerror(errno));
+	goto out;
+    }
+    delete_emitter = true;
+    yaml_emitter_set_output_file(&emitter, fp);
+    yaml_emitter_set_encoding(&emitter, YAML_UTF8_ENCODING);
+    yaml_emitter_set_canonical(&emitter, 0);
+    yaml_emitter_set_width(&emitter, 80);
+    yaml_emitter_set_unicode(&emitter, 1);
+    yaml_emitter_set_break(&emitter, YAML_ANY_BREAK);
     (void)fprintf(fp, "#VNACal 1.%d\n", minor_version);
-    if (vnaproperty_export_yaml_to_file(vprpp_root, fp, pathname,
-		vcp->vc_error_fn, vcp->vc_error_arg) == -1) {
+    if (!yaml_emitter_open(&emitter)) {
+	_vnacal_error(vcp, VNAERR_SYSTEM, "yaml_emitter_open: %s: %s",
+		vcp->vc_filename, emitter.problem);
+	goto out;
+    }
+
+    /*
+     * Emit the document.
+     */
+    (void)yaml_document_start_event_initialize(&event, NULL,
+	    &tags[0], &tags[0], 0);
+    if (_vnaproperty_yaml_emit_event(&ss.ss_vyml, &event) == -1 ||
+	    emit_collection(&ss, YAML_MAPPING_START_EVENT) == -1 ||
+	    emit_properties(&ss, vcp->vc_properties) == -1 ||
+	    _vnaproperty_yaml_emit_key(&ss.ss_vyml, "calibrations") == -1 ||
+	    emit_collection(&ss, YAML_SEQUENCE_START_EVENT) == -1) {
+	goto out;
+    }
+    for (int ci = 0; ci < vcp->vc_calibration_allocation; ++ci) {
+	vnacal_calibration_t *calp = vcp->vc_calibration_vector[ci];
+
+	if (calp == NULL) {
+	    continue;
+	}
+	if (emit_calibration(&ss, calp) == -1) {
+	    goto out;
+	}
+    }
+    if (emit_collection(&ss, YAML_SEQUENCE_END_EVENT) == -1 ||
+	    emit_collection(&ss, YAML_MAPPING_END_EVENT) == -1) {
 	goto out;
     }
+    (void)yaml_document_end_event_initialize(&event, 0);
+    if (_vnaproperty_yaml_emit_event(&ss.ss_vyml, &event) == -1) {
+	goto out;
+    }
+    if (!yaml_emitter_close(&emitter)) {
+	_vnacal_error(vcp, VNAERR_SYSTEM, "yaml_emitter_close: %s: %s",
+		vcp->vc_filename, emitter.problem);
+	goto out;
+    }
+    yaml_emitter_delete(&emitter);
+    delete_emitter = false;
+
+close:
     if (fclose(fp) == -1) {
 	_vnacal_error(vcp, VNAERR_SYSTEM, "fclose: %s: %s",
 		vcp->vc_filename, strerror(errno));
@@ -290,28 +656,31 @@ int vnacal_save(vnacal_t *vcp, const char *pathname)
 	goto out;
     }
     fp = NULL;
-    rc = 0;
-    goto out;
+    {
+	int rv = _vnacommon_replace_finish(temp_pathname, pathname);
 
-vnaproperty_set_error:
-    switch (errno) {
-    case EINVAL:
-    default:
-	_vnacal_error(vcp, VNAERR_INTERNAL, "vnacal_save: internal error: %s",
-		strerror(errno));
-	break;
-    case ENOMEM:
-	_vnacal_error(vcp, VNAERR_SYSTEM, "malloc: %s", strerror(errno));
-	break;
+	temp_pathname = NULL;
+	if (rv == -1) {
+	    _vnacal_error(vcp, VNAERR_SYSTEM, "rename: %s: %s",
+		    pathname, strerror(errno));
+	    goto out;
+	}
     }
+    rc = 0;
+
 out:
-    (void)vnaproperty_delete(&vprpp_root, ".");
+    if (delete_emitter) {
+	yaml_emitter_delete(&emitter);
+    }
+    _vnacal_free(vcp, (void *)ss.ss_buffer);
     if (fp != NULL) {
 	(void)fclose(fp);
     }
+    _vnacommon_replace_cancel(temp_pathname);
     if (rc == -1) {
-	free((void *)vcp->vc_filename);
+	_vnacal_free(vcp, (void *)vcp->vc_filename);
 	vcp->vc_filename = NULL;
     }
+    _VNASTATS_TIME(_vnacal_stats, vcs_save_calls, vcs_save_ns, start);
     return rc;
 }
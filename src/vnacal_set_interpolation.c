@@ -0,0 +1,240 @@
+/*
+ * Vector Network Analyzer Library
+ * Copyright © 2020-2024 D Scott Guthridge <scott_guthridge@rompromity.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "archdep.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "vnacal_internal.h"
+
+
+/*
+ * report_spline_error: report failure of _vnacal_spline_alloc_vector
+ *   @vcp: pointer returned from vnacal_create or vnacal_load
+ *   @function: name of user-called function
+ */
+static void report_spline_error(vnacal_t *vcp, const char *function)
+{
+    if (errno == ENOMEM) {
+	_vnacal_error(vcp, VNAERR_SYSTEM, "malloc: %s", strerror(errno));
+    } else {
+	_vnacal_error(vcp, VNAERR_MATH, "%s: frequencies too close "
+		"together for spline interpolation", function);
+    }
+}
+
+/*
+ * _vnacal_calibration_set_interpolation: set method and spline cache
+ *   @function: name of user-called function
+ *   @calp: pointer to calibration structure
+ *   @method: interpolation method
+ *
+ *   For spline interpolation, find the spline coefficients of each
+ *   error term and of any frequency-dependent reference impedances.
+ *   Compacted calibrations evaluate models in place of the error
+ *   terms, so only the reference impedances are interpolated.
+ */
+int _vnacal_calibration_set_interpolation(const char *function,
+	vnacal_calibration_t *calp, vnacal_interpolation_t method)
+{
+    vnacal_t *vcp = calp->cal_vcp;
+    const vnamem_allocator_t *vmap = &vcp->vc_allocator;
+    const int ports = MAX(calp->cal_rows, calp->cal_columns);
+    const int frequencies = calp->cal_frequencies;
+    vnacal_spline_t **error_term_spline = NULL;
+    vnacal_spline_t **z0_spline = NULL;
+
+    if (vnacal_interpolation_to_name(method) == NULL) {
+	_vnacal_error(vcp, VNAERR_USAGE, "%s: invalid interpolation "
+		"method %d", function, (int)method);
+	return -1;
+    }
+    if (method == VNACAL_INTERP_SPLINE && frequencies >= 3) {
+	if (calp->cal_error_term_vector != NULL &&
+		(error_term_spline = _vnacal_spline_alloc_vector(vmap,
+			calp->cal_frequency_vector, frequencies,
+			calp->cal_error_term_vector,
+			calp->cal_error_terms)) == NULL) {
+	    report_spline_error(vcp, function);
+	    return -1;
+	}
+	if (calp->cal_z0_type == VNACAL_Z0_MATRIX &&
+		(z0_spline = _vnacal_spline_alloc_vector(vmap,
+			calp->cal_frequency_vector, frequencies,
+			calp->cal_z0_matrix, ports)) == NULL) {
+	    report_spline_error(vcp, function);
+	    _vnacal_spline_free_vector(vmap, error_term_spline,
+		    calp->cal_error_terms);
+	    return -1;
+	}
+    }
+    _vnacal_spline_free_vector(vmap, calp->cal_error_term_spline,
+	    calp->cal_error_terms);
+    _vnacal_spline_free_vector(vmap, calp->cal_z0_spline, ports);
+    calp->cal_error_term_spline = error_term_spline;
+    calp->cal_z0_spline = z0_spline;
+    calp->cal_interpolation = method;
+    return 0;
+}
+
+/*
+ * _vnacal_data_standard_set_interpolation: set method and spline cache
+ *   @function: name of user-called function
+ *   @stdp: data standard
+ *   @method: interpolation method
+ */
+int _vnacal_data_standard_set_interpolation(const char *function,
+	vnacal_standard_t *stdp, vnacal_interpolation_t method)
+{
+    vnacal_t *vcp = stdp->std_vcp;
+    const vnamem_allocator_t *vmap = &vcp->vc_allocator;
+    const int ports = stdp->std_ports;
+    vnacal_data_standard_t *vdsp = &stdp->std_data_standard;
+    const int frequencies = vdsp->vds_frequencies;
+    vnacal_spline_t **data_spline = NULL;
+    vnacal_spline_t **z0_spline = NULL;
+
+    assert(stdp->std_type == VNACAL_DATA);
+    if (vnacal_interpolation_to_name(method) == NULL) {
+	_vnacal_error(vcp, VNAERR_USAGE, "%s: invalid interpolation "
+		"method %d", function, (int)method);
+	return -1;
+    }
+    if (method == VNACAL_INTERP_SPLINE && frequencies >= 3) {
+	if ((data_spline = _vnacal_spline_alloc_vector(vmap,
+			vdsp->vds_frequency_vector, frequencies,
+			vdsp->vds_data, ports * ports)) == NULL) {
+	    report_spline_error(vcp, function);
+	    return -1;
+	}
+	if (vdsp->vds_has_fz0 &&
+		(z0_spline = _vnacal_spline_alloc_vector(vmap,
+			vdsp->vds_frequency_vector, frequencies,
+			vdsp->u.vds_z0_vector_vector, ports)) == NULL) {
+	    report_spline_error(vcp, function);
+	    _vnacal_spline_free_vector(vmap, data_spline, ports * ports);
+	    return -1;
+	}
+    }
+    _vnacal_spline_free_vector(vmap, vdsp->vds_data_spline, ports * ports);
+    _vnacal_spline_free_vector(vmap, vdsp->vds_z0_spline, ports);
+    vdsp->vds_data_spline = data_spline;
+    vdsp->vds_z0_spline = z0_spline;
+    vdsp->vds_interpolation = method;
+    return 0;
+}
+
+/*
+ * _vnacal_parameter_set_interpolation: set method and spline cache
+ *   @function: name of user-called function
+ *   @vpmrp: vector, unknown or correlated parameter
+ *   @method: interpolation method
+ *
+ *   Unknown and correlated parameters have no values until solved;
+ *   in that case, only the method is recorded here and vnacal_new_solve
+ *   finds the spline coefficients.
+ */
+int _vnacal_parameter_set_interpolation(const char *function,
+	vnacal_parameter_t *vpmrp, vnacal_interpolation_t method)
+{
+    vnacal_t *vcp = vpmrp->vpmr_vcp;
+    const vnamem_allocator_t *vmap = &vcp->vc_allocator;
+    const int frequencies = vpmrp->vpmr_frequencies;
+    vnacal_spline_t **spline = NULL;
+
+    assert(vpmrp->vpmr_type == VNACAL_VECTOR ||
+	   vpmrp->vpmr_type == VNACAL_UNKNOWN ||
+	   vpmrp->vpmr_type == VNACAL_CORRELATED);
+    if (vnacal_interpolation_to_name(method) == NULL) {
+	_vnacal_error(vcp, VNAERR_USAGE, "%s: invalid interpolation "
+		"method %d", function, (int)method);
+	return -1;
+    }
+    if (method == VNACAL_INTERP_SPLINE && frequencies >= 3 &&
+	    vpmrp->vpmr_coefficient_vector != NULL) {
+	if ((spline = _vnacal_spline_alloc_vector(vmap,
+			vpmrp->vpmr_frequency_vector, frequencies,
+			&vpmrp->vpmr_coefficient_vector, 1)) == NULL) {
+	    report_spline_error(vcp, function);
+	    return -1;
+	}
+    }
+    _vnacal_spline_free_vector(vmap, vpmrp->vpmr_spline, 1);
+    vpmrp->vpmr_spline = spline;
+    vpmrp->vpmr_interpolation = method;
+    return 0;
+}
+
+/*
+ * vnacal_set_interpolation: set the interpolation method
+ *   @vcp: pointer returned from vnacal_create or vnacal_load
+ *   @ci: calibration index
+ *   @method: interpolation method
+ */
+int vnacal_set_interpolation(vnacal_t *vcp, int ci,
+	vnacal_interpolation_t method)
+{
+    vnacal_calibration_t *calp;
+
+    if ((calp = _vnacal_get_calibration(__func__, vcp, ci)) == NULL) {
+	return -1;
+    }
+    return _vnacal_calibration_set_interpolation(__func__, calp, method);
+}
+
+/*
+ * vnacal_set_parameter_interpolation: set interpolation for a parameter
+ *   @vcp: pointer returned from vnacal_create or vnacal_load
+ *   @parameter: data, vector, unknown or correlated parameter
+ *   @method: interpolation method
+ */
+int vnacal_set_parameter_interpolation(vnacal_t *vcp, int parameter,
+	vnacal_interpolation_t method)
+{
+    vnacal_parameter_t *vpmrp;
+
+    if (vcp == NULL || vcp->vc_magic != VC_MAGIC) {
+	errno = EINVAL;
+	return -1;
+    }
+    vpmrp = _vnacal_get_parameter(vcp, parameter);
+    if (vpmrp == NULL || vpmrp->vpmr_deleted) {
+	_vnacal_error(vcp, VNAERR_USAGE, "%s: %d: nonexistent parameter",
+		__func__, parameter);
+	return -1;
+    }
+    switch (vpmrp->vpmr_type) {
+    case VNACAL_DATA:
+	return _vnacal_data_standard_set_interpolation(__func__,
+		vpmrp->vpmr_stdp, method);
+
+    case VNACAL_VECTOR:
+    case VNACAL_UNKNOWN:
+    case VNACAL_CORRELATED:
+	return _vnacal_parameter_set_interpolation(__func__, vpmrp, method);
+
+    default:
+	break;
+    }
+    _vnacal_error(vcp, VNAERR_USAGE, "%s: %d: parameter has no "
+	    "frequency points to interpolate", __func__, parameter);
+    return -1;
+}
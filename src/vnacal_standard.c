@@ -287,7 +287,7 @@ vnacal_parameter_matrix_map_t *_vnacal_analyze_parameter_matrix(
     /*
      * Allocate and init the forward port map.
      */
-    if ((vpfmp_vector = calloc(ports,
+    if ((vpfmp_vector = _vnacal_calloc(vcp, ports,
 		    sizeof(vnacal_parameter_forw_map_t))) == NULL) {
 	_vnacal_error(vcp, VNAERR_SYSTEM,
 		"calloc: %s", strerror(errno));
@@ -301,7 +301,7 @@ vnacal_parameter_matrix_map_t *_vnacal_analyze_parameter_matrix(
     /*
      * Allocate and init the parameter matrix port map structure.
      */
-    vpmmp_result = malloc(sizeof(vnacal_parameter_matrix_map_t));
+    vpmmp_result = _vnacal_malloc(vcp, sizeof(vnacal_parameter_matrix_map_t));
     if (vpmmp_result == NULL) {
 	_vnacal_error(vcp, VNAERR_SYSTEM, "malloc: %s", strerror(errno));
 	goto error;
@@ -392,7 +392,8 @@ vnacal_parameter_matrix_map_t *_vnacal_analyze_parameter_matrix(
 		} else {
 		    int std_ports = stdp->std_ports;
 
-		    vsrmp = malloc(sizeof(vnacal_standard_rmap_t));
+		    vsrmp = _vnacal_malloc(vcp,
+			    sizeof(vnacal_standard_rmap_t));
 		    if (vsrmp == NULL) {
 			_vnacal_error(vcp, VNAERR_SYSTEM,
 				"malloc: %s", strerror(errno));
@@ -400,16 +401,18 @@ vnacal_parameter_matrix_map_t *_vnacal_analyze_parameter_matrix(
 		    }
 		    (void)memset((void *)vsrmp, 0, sizeof(*vsrmp));
 		    vsrmp->vsrm_stdp = stdp;
-		    vsrmp->vsrm_rmap_vector = malloc(std_ports * sizeof(int));
+		    vsrmp->vsrm_rmap_vector = _vnacal_malloc(vcp, std_ports *
+			    sizeof(int));
 		    if (vsrmp->vsrm_rmap_vector == NULL) {
-			free((void *)vsrmp);
+			_vnacal_free(vcp, (void *)vsrmp);
 			_vnacal_error(vcp, VNAERR_SYSTEM,
 				"malloc: %s", strerror(errno));
 			goto error;
 		    }
-		    vsrmp->vsrm_cell_vector = malloc(std_ports * sizeof(int));
+		    vsrmp->vsrm_cell_vector = _vnacal_malloc(vcp, std_ports *
+			    sizeof(int));
 		    if (vsrmp->vsrm_cell_vector == NULL) {
-			free((void *)vsrmp);
+			_vnacal_free(vcp, (void *)vsrmp);
 			_vnacal_error(vcp, VNAERR_SYSTEM,
 				"malloc: %s", strerror(errno));
 			goto error;
@@ -535,7 +538,7 @@ vnacal_parameter_matrix_map_t *_vnacal_analyze_parameter_matrix(
 		 * Create a vnacal_parameter_rmap_t entry for this
 		 * parameter.
 		 */
-		vprmp = malloc(sizeof(vnacal_parameter_rmap_t));
+		vprmp = _vnacal_malloc(vcp, sizeof(vnacal_parameter_rmap_t));
 		if (vprmp == NULL) {
 		    _vnacal_error(vcp, VNAERR_SYSTEM,
 			    "malloc: %s", strerror(errno));
@@ -592,7 +595,7 @@ vnacal_parameter_matrix_map_t *_vnacal_analyze_parameter_matrix(
     }
 
 out:
-    free((void *)vpfmp_vector);
+    _vnacal_free(vcp, (void *)vpfmp_vector);
     return vpmmp_result;
 
 error:
@@ -607,23 +610,26 @@ error:
  */
 void _vnacal_free_parameter_matrix_map(vnacal_parameter_matrix_map_t *vpmmp)
 {
+    const vnacal_t *vcp;
     vnacal_standard_rmap_t *vsrmp;
     vnacal_parameter_rmap_t *vprmp;
 
     if (vpmmp == NULL)
 	return;
 
+    vcp = vpmmp->vpmm_vcp;
+
     while ((vsrmp = vpmmp->vpmm_standard_rmap) != NULL) {
 	vpmmp->vpmm_standard_rmap = vsrmp->vsrm_next;
 
-	free((void *)vsrmp->vsrm_cell_vector);
-	free((void *)vsrmp->vsrm_rmap_vector);
-	free((void *)vsrmp);
+	_vnacal_free(vcp, (void *)vsrmp->vsrm_cell_vector);
+	_vnacal_free(vcp, (void *)vsrmp->vsrm_rmap_vector);
+	_vnacal_free(vcp, (void *)vsrmp);
     }
     while ((vprmp = vpmmp->vpmm_parameter_rmap) != NULL) {
 	vpmmp->vpmm_parameter_rmap = vprmp->vprm_next;
 
-	free((void *)vprmp);
+	_vnacal_free(vcp, (void *)vprmp);
     }
-    free((void *)vpmmp);
+    _vnacal_free(vcp, (void *)vpmmp);
 }
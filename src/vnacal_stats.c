@@ -0,0 +1,144 @@
+/*
+ * Vector Network Analyzer Library
+ * Copyright © 2020-2024 D Scott Guthridge <scott_guthridge@rompromity.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "archdep.h"
+
+#include <stdbool.h>
+#include <string.h>
+#include "vnastats_internal.h"
+
+
+/*
+ * Shared counters, the list of per-thread blocks, the calling thread's
+ * block, and the mode
+ */
+vnacal_stats_t _vnacal_stats_global;
+vnastats_block_t *_vnacal_stats_list = NULL;
+_VNASTATS_THREAD_LOCAL vnacal_stats_t *_vnacal_stats_local = NULL;
+bool _vnacal_stats_per_thread = false;
+
+/*
+ * discard: counters for threads that couldn't get a block
+ */
+static vnacal_stats_t discard;
+
+/*
+ * _vnacal_stats_register: return a new block for the calling thread
+ */
+vnacal_stats_t *_vnacal_stats_register(void)
+{
+    vnacal_stats_t *sp;
+
+    if ((sp = _vnastats_register(&_vnacal_stats_list,
+		    sizeof(vnacal_stats_t))) == NULL) {
+	return &discard;
+    }
+    _vnacal_stats_local = sp;
+    return sp;
+}
+
+/*
+ * add_stats: add the counters of one block into a sum
+ *   @sum: accumulated result
+ *   @sp: block to add
+ */
+static void add_stats(vnacal_stats_t *sum, const vnacal_stats_t *sp)
+{
+    sum->vcs_rfi_calls += _VNASTATS_LOAD(sp->vcs_rfi_calls);
+    sum->vcs_eval_parameter_calls +=
+	_VNASTATS_LOAD(sp->vcs_eval_parameter_calls);
+    for (int i = 0; i < VNACAL_STATS_LU_DIMENSIONS; ++i) {
+	sum->vcs_lu_calls[i] += _VNASTATS_LOAD(sp->vcs_lu_calls[i]);
+    }
+    sum->vcs_solve_iterations += _VNASTATS_LOAD(sp->vcs_solve_iterations);
+    sum->vcs_apply_calls += _VNASTATS_LOAD(sp->vcs_apply_calls);
+    sum->vcs_apply_ns += _VNASTATS_LOAD(sp->vcs_apply_ns);
+    sum->vcs_solve_calls += _VNASTATS_LOAD(sp->vcs_solve_calls);
+    sum->vcs_solve_ns += _VNASTATS_LOAD(sp->vcs_solve_ns);
+    sum->vcs_load_calls += _VNASTATS_LOAD(sp->vcs_load_calls);
+    sum->vcs_load_ns += _VNASTATS_LOAD(sp->vcs_load_ns);
+    sum->vcs_save_calls += _VNASTATS_LOAD(sp->vcs_save_calls);
+    sum->vcs_save_ns += _VNASTATS_LOAD(sp->vcs_save_ns);
+}
+
+/*
+ * clear_stats: clear the counters of one block
+ *   @sp: block to clear
+ */
+static void clear_stats(vnacal_stats_t *sp)
+{
+    _VNASTATS_STORE(sp->vcs_rfi_calls, 0);
+    _VNASTATS_STORE(sp->vcs_eval_parameter_calls, 0);
+    for (int i = 0; i < VNACAL_STATS_LU_DIMENSIONS; ++i) {
+	_VNASTATS_STORE(sp->vcs_lu_calls[i], 0);
+    }
+    _VNASTATS_STORE(sp->vcs_solve_iterations, 0);
+    _VNASTATS_STORE(sp->vcs_apply_calls, 0);
+    _VNASTATS_STORE(sp->vcs_apply_ns, 0);
+    _VNASTATS_STORE(sp->vcs_solve_calls, 0);
+    _VNASTATS_STORE(sp->vcs_solve_ns, 0);
+    _VNASTATS_STORE(sp->vcs_load_calls, 0);
+    _VNASTATS_STORE(sp->vcs_load_ns, 0);
+    _VNASTATS_STORE(sp->vcs_save_calls, 0);
+    _VNASTATS_STORE(sp->vcs_save_ns, 0);
+}
+
+/*
+ * vnacal_get_stats: return hot-path counters and times
+ *   @stats: caller-allocated structure to receive the result
+ *
+ *   In per-thread mode, return the sum of all threads' counters.
+ */
+void vnacal_get_stats(vnacal_stats_t *stats)
+{
+    (void)memset((void *)stats, 0, sizeof(*stats));
+    if (_VNASTATS_LOAD(_vnacal_stats_per_thread)) {
+	for (vnastats_block_t *bp = _vnastats_first(&_vnacal_stats_list);
+		bp != NULL; bp = bp->vsb_next) {
+	    add_stats(stats, (const vnacal_stats_t *)bp->vsb_data);
+	}
+    } else {
+	add_stats(stats, &_vnacal_stats_global);
+    }
+}
+
+/*
+ * vnacal_reset_stats: clear hot-path counters and times
+ *
+ *   In per-thread mode, clear all threads' counters.
+ */
+void vnacal_reset_stats(void)
+{
+    if (_VNASTATS_LOAD(_vnacal_stats_per_thread)) {
+	for (vnastats_block_t *bp = _vnastats_first(&_vnacal_stats_list);
+		bp != NULL; bp = bp->vsb_next) {
+	    clear_stats((vnacal_stats_t *)bp->vsb_data);
+	}
+    } else {
+	clear_stats(&_vnacal_stats_global);
+    }
+}
+
+/*
+ * vnacal_set_stats_per_thread: count separately in each thread
+ *   @per_thread: true for per-thread counters; false for shared
+ */
+void vnacal_set_stats_per_thread(bool per_thread)
+{
+    _VNASTATS_STORE(_vnacal_stats_per_thread, per_thread);
+}
@@ -0,0 +1,45 @@
+/*
+ * Vector Network Analyzer Library
+ * Copyright © 2020-2023 D Scott Guthridge <scott_guthridge@rompromity.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "archdep.h"
+
+#include <stdint.h>
+#include <string.h>
+#include "vnacommon_internal.h"
+
+
+/*
+ * _vnacommon_swap_doubles: reverse the byte order of a vector of doubles
+ *   @vector: values to swap in place
+ *   @count: number of values
+ */
+void _vnacommon_swap_doubles(double *vector, size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+	uint8_t bytes[sizeof(double)];
+
+	(void)memcpy((void *)bytes, (void *)&vector[i], sizeof(double));
+	for (int j = 0; j < sizeof(double) / 2; ++j) {
+	    uint8_t temp = bytes[j];
+
+	    bytes[j] = bytes[sizeof(double) - 1 - j];
+	    bytes[sizeof(double) - 1 - j] = temp;
+	}
+	(void)memcpy((void *)&vector[i], (void *)bytes, sizeof(double));
+    }
+}
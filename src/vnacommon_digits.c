@@ -0,0 +1,143 @@
+/*
+ * Vector Network Analyzer Library
+ * Copyright © 2020-2023 D Scott Guthridge <scott_guthridge@rompromity.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "archdep.h"
+
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "vnacommon_internal.h"
+
+
+/*
+ * pow10_table: powers of ten that are exactly representable as double
+ */
+static const double pow10_table[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+    1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+    1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/*
+ * _vnacommon_fast_digits: convert a finite double to decimal digits
+ *   @value: value to convert
+ *   @precision: number of significant digits
+ *   @digits: buffer of at least precision bytes to receive the digits
+ *   @exponentp: address of int to receive the decimal exponent
+ *
+ *   Produce exactly the digits and exponent that sprintf's "%.*e"
+ *   conversion would, rounding half to even.  Scale the value by an
+ *   exact power of ten, and use fma to recover the exact rounding
+ *   error of the scaling.  Together, the scaled value and the sign of
+ *   the error determine the correctly rounded integer.  Values that
+ *   need a power of ten beyond 10^22 are left to sprintf.
+ *
+ * Return:
+ *	true:  digits and *exponentp are valid
+ *	false: caller must fall back to sprintf
+ */
+bool _vnacommon_fast_digits(double value, int precision, char *digits,
+	int *exponentp)
+{
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+    const double upper = pow10_table[precision];
+    const double lower = pow10_table[precision - 1];
+    double a = fabs(value);
+    double scaled, residual, whole, fraction;
+    uint64_t n;
+    int binary_exponent;
+    int exponent;
+
+    assert(precision >= 1 &&
+	    precision <= VNACOMMON_FAST_DIGITS_MAX_PRECISION);
+    if (a == 0.0) {
+	(void)memset((void *)digits, '0', precision);
+	*exponentp = 0;
+	return true;
+    }
+
+    /*
+     * Estimate the decimal exponent from the binary exponent.  The
+     * estimate may be one too low; the loop corrects it.
+     */
+    (void)frexp(a, &binary_exponent);
+    exponent = (int)floor((binary_exponent - 1) * 0.30102999566398120);
+    for (int tries = 0;; ++tries) {
+	const int k = precision - 1 - exponent;
+
+	if (tries == 3 || k < -22 || k > 22) {
+	    return false;
+	}
+
+	/*
+	 * Find scaled = a * 10^k rounded, and the sign of the exact
+	 * error (a * 10^k - scaled) in residual.
+	 */
+	if (k >= 0) {
+	    scaled = a * pow10_table[k];
+	    residual = fma(a, pow10_table[k], -scaled);
+	} else {
+	    scaled = a / pow10_table[-k];
+	    residual = fma(-scaled, pow10_table[-k], a);
+	}
+
+	/*
+	 * Adjust the exponent until the exact scaled value lies in
+	 * [10^(precision-1), 10^precision).
+	 */
+	if (scaled > upper || (scaled == upper && residual >= 0.0)) {
+	    ++exponent;
+	    continue;
+	}
+	if (scaled < lower || (scaled == lower && residual < 0.0)) {
+	    --exponent;
+	    continue;
+	}
+	break;
+    }
+
+    /*
+     * Round to the nearest integer, ties to even.  Because scaled is
+     * below 2^52, fraction is exact and a multiple of the unit in the
+     * last place, as is 0.5; residual is smaller than half of that
+     * unit, so it matters only when fraction is exactly one half.
+     */
+    whole = floor(scaled);
+    fraction = scaled - whole;
+    n = (uint64_t)whole;
+    if (fraction > 0.5 || (fraction == 0.5 &&
+		(residual > 0.0 || (residual == 0.0 && (n & 1) != 0)))) {
+	++n;
+    }
+    if (n == (uint64_t)upper) {		/* e.g. 9.9996 -> 1.000e+01 */
+	n /= 10;
+	++exponent;
+    }
+    for (int i = precision - 1; i >= 0; --i) {
+	digits[i] = '0' + (char)(n % 10);
+	n /= 10;
+    }
+    *exponentp = exponent;
+    return true;
+#else /* excess precision would break the exactness argument */
+    return false;
+#endif
+}
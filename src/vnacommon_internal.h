@@ -20,6 +20,11 @@
 #define VNACOMMON_INTERNAL_H
 
 #include <complex.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "vnamem_internal.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -37,6 +42,83 @@ static inline double _vnacommon_cabs2(double complex x)
     return re*re + im*im;
 }
 
+/*
+ * _vnacommon_is_little_endian: test if the host stores values little-endian
+ */
+static inline bool _vnacommon_is_little_endian(void)
+{
+    const uint16_t one = 1;
+
+    return *(const uint8_t *)&one == 1;
+}
+
+/*
+ * _vnacommon_put_u32: encode a 32-bit little-endian value
+ *   @cp: destination
+ *   @value: value to encode
+ */
+static inline void _vnacommon_put_u32(uint8_t *cp, uint32_t value)
+{
+    for (int i = 0; i < 4; ++i) {
+	cp[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+/*
+ * _vnacommon_put_u64: encode a 64-bit little-endian value
+ *   @cp: destination
+ *   @value: value to encode
+ */
+static inline void _vnacommon_put_u64(uint8_t *cp, uint64_t value)
+{
+    for (int i = 0; i < 8; ++i) {
+	cp[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+/*
+ * _vnacommon_get_u32: decode a 32-bit little-endian value
+ *   @cp: source
+ */
+static inline uint32_t _vnacommon_get_u32(const uint8_t *cp)
+{
+    uint32_t value = 0;
+
+    for (int i = 3; i >= 0; --i) {
+	value = (value << 8) | cp[i];
+    }
+    return value;
+}
+
+/*
+ * _vnacommon_get_u64: decode a 64-bit little-endian value
+ *   @cp: source
+ */
+static inline uint64_t _vnacommon_get_u64(const uint8_t *cp)
+{
+    uint64_t value = 0;
+
+    for (int i = 7; i >= 0; --i) {
+	value = (value << 8) | cp[i];
+    }
+    return value;
+}
+
+/* _vnacommon_swap_doubles: reverse the byte order of a vector of doubles */
+extern void _vnacommon_swap_doubles(double *vector, size_t count);
+
+/*
+ * VNACOMMON_FAST_DIGITS_MAX_PRECISION: largest precision handled by
+ *	_vnacommon_fast_digits
+ *
+ *   Keeps the scaled value below 2^52 so that its fraction is exact.
+ */
+#define VNACOMMON_FAST_DIGITS_MAX_PRECISION	15
+
+/* _vnacommon_fast_digits: convert a double to decimal digits like "%.*e" */
+extern bool _vnacommon_fast_digits(double value, int precision, char *digits,
+	int *exponentp);
+
 /* _vnacommon_lu: find replace A11 with its LU decomposition */
 extern double complex _vnacommon_lu(complex double *a, int *row_index, int n);
 
@@ -81,6 +163,17 @@ extern int _vnacommon_spline_calc(int n, const double *x_vector,
 extern double _vnacommon_spline_eval(int n, const double *x_vector,
 	const double *y_vector, const double (*c_vector)[3], double x);
 
+/* _vnacommon_replace_open: open a temporary file to replace pathname */
+extern FILE *_vnacommon_replace_open(const char *pathname,
+	char **temp_pathname);
+
+/* _vnacommon_replace_finish: rename the temporary file over pathname */
+extern int _vnacommon_replace_finish(char *temp_pathname,
+	const char *pathname);
+
+/* _vnacommon_replace_cancel: remove the temporary file */
+extern void _vnacommon_replace_cancel(char *temp_pathname);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
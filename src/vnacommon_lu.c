@@ -27,6 +27,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include "vnacommon_internal.h"
+#include "vnastats_internal.h"
 
 
 /*
@@ -48,6 +49,9 @@ double complex _vnacommon_lu(complex double *a, int *row_index, int n)
 
 #define A(i, j)		((a)[(i) * n + (j)])
 
+    _VNASTATS_ADD(_vnacal_stats,
+	    vcs_lu_calls[MIN(n, VNACAL_STATS_LU_DIMENSIONS) - 1], 1);
+
     /*
      * Find row_scale.  Initialize row_index.
      */
@@ -0,0 +1,138 @@
+/*
+ * Vector Network Analyzer Library
+ * Copyright © 2020-2023 D Scott Guthridge <scott_guthridge@rompromity.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "archdep.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include "vnacommon_internal.h"
+#include "vnamem_internal.h"
+
+#ifndef O_BINARY
+#define O_BINARY	0
+#endif
+
+/*
+ * REPLACE_TRIES: number of temporary names to try before giving up
+ */
+#define REPLACE_TRIES	100
+
+/*
+ * _vnacommon_replace_open: open a temporary file that will replace pathname
+ *   @pathname: file to be replaced
+ *   @temp_pathname: address of pointer to receive the temporary name
+ *
+ *   The temporary file is created in the same directory as pathname
+ *   so that _vnacommon_replace_finish can rename it over pathname.
+ *   Processes that have the old file open or mapped keep the old file
+ *   until they close it; it's never truncated under them.  If pathname
+ *   already exists, the new file gets its permissions.  On error,
+ *   return NULL with errno set.
+ */
+FILE *_vnacommon_replace_open(const char *pathname, char **temp_pathname)
+{
+    static unsigned int counter = 0;
+    size_t size = strlen(pathname) + 32;
+    char *temp;
+    struct stat st;
+    bool exists;
+    int fd = -1;
+    FILE *fp;
+
+    if ((temp = _vnamem_malloc(size)) == NULL) {
+	return NULL;
+    }
+    exists = stat(pathname, &st) == 0;
+    for (int try = 0; try < REPLACE_TRIES; ++try) {
+	(void)snprintf(temp, size, "%s.tmp%ld.%u", pathname,
+		(long)getpid(), counter++);
+	if ((fd = open(temp, O_WRONLY | O_CREAT | O_EXCL | O_BINARY,
+			0666)) != -1 || errno != EEXIST) {
+	    break;
+	}
+    }
+    if (fd == -1) {
+	_vnamem_free((void *)temp);
+	return NULL;
+    }
+#ifndef _WIN32
+    if (exists) {
+	(void)fchmod(fd, st.st_mode & 07777);
+    }
+#else
+    (void)exists;
+#endif
+    if ((fp = fdopen(fd, "wb")) == NULL) {
+	int saved_errno = errno;
+
+	(void)close(fd);
+	(void)remove(temp);
+	_vnamem_free((void *)temp);
+	errno = saved_errno;
+	return NULL;
+    }
+    *temp_pathname = temp;
+    return fp;
+}
+
+/*
+ * _vnacommon_replace_finish: rename the closed temporary file over pathname
+ *   @temp_pathname: name from _vnacommon_replace_open (freed here)
+ *   @pathname: file to replace
+ *
+ *   On error, remove the temporary file and return -1 with errno set.
+ */
+int _vnacommon_replace_finish(char *temp_pathname, const char *pathname)
+{
+#ifdef _WIN32
+    (void)remove(pathname);
+#endif
+    if (rename(temp_pathname, pathname) == -1) {
+	int saved_errno = errno;
+
+	(void)remove(temp_pathname);
+	_vnamem_free((void *)temp_pathname);
+	errno = saved_errno;
+	return -1;
+    }
+    _vnamem_free((void *)temp_pathname);
+    return 0;
+}
+
+/*
+ * _vnacommon_replace_cancel: remove the closed temporary file
+ *   @temp_pathname: name from _vnacommon_replace_open (freed here; may
+ *	be NULL)
+ */
+void _vnacommon_replace_cancel(char *temp_pathname)
+{
+    if (temp_pathname != NULL) {
+	int saved_errno = errno;
+
+	(void)remove(temp_pathname);
+	_vnamem_free((void *)temp_pathname);
+	errno = saved_errno;
+    }
+}
@@ -77,23 +77,23 @@ int _vnacommon_spline_calc(int n, const double *x_vector,
     /*
      * Allocate temporary vectors.
      */
-    if ((hp = (double *)malloc(n * sizeof(double))) == NULL) {
+    if ((hp = (double *)_vnamem_malloc(n * sizeof(double))) == NULL) {
 	rv = -1;
 	goto out;
     }
-    if ((mp = (double *)malloc(n * sizeof(double))) == NULL) {
+    if ((mp = (double *)_vnamem_malloc(n * sizeof(double))) == NULL) {
 	rv = -1;
 	goto out;
     }
-    if ((up = (double *)malloc(n * sizeof(double))) == NULL) {
+    if ((up = (double *)_vnamem_malloc(n * sizeof(double))) == NULL) {
 	rv = -1;
 	goto out;
     }
-    if ((vp = (double *)malloc(n * sizeof(double))) == NULL) {
+    if ((vp = (double *)_vnamem_malloc(n * sizeof(double))) == NULL) {
 	rv = -1;
 	goto out;
     }
-    if ((sp = (double *)malloc((n + 1) * sizeof(double))) == NULL) {
+    if ((sp = (double *)_vnamem_malloc((n + 1) * sizeof(double))) == NULL) {
 	rv = -1;
 	goto out;
     }
@@ -108,7 +108,8 @@ int _vnacommon_spline_calc(int n, const double *x_vector,
 	if (hp[i] < MIN_DX) {
 	    /* error reported by caller */
 	    errno = EINVAL;
-	    return -1;
+	    rv = -1;
+	    goto out;
 	}
     }
 
@@ -150,15 +151,15 @@ out:
      * Free the temporary vectors.
      */
     if (sp != NULL)
-	free((void *)sp);
+	_vnamem_free((void *)sp);
     if (vp != NULL)
-	free((void *)vp);
+	_vnamem_free((void *)vp);
     if (up != NULL)
-	free((void *)up);
+	_vnamem_free((void *)up);
     if (mp != NULL)
-	free((void *)mp);
+	_vnamem_free((void *)mp);
     if (hp != NULL)
-	free((void *)hp);
+	_vnamem_free((void *)hp);
 
     return rv;
 }
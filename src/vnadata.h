@@ -27,6 +27,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <vnaerr.h>
+#include <vnamem.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -75,14 +76,32 @@ typedef enum vnadata_filetype {
 	VNADATA_FILETYPE_TOUCHSTONE2	= 2,
 	/* network parameter data format */
 	VNADATA_FILETYPE_NPD		= 3,
+	/* binary network parameter data format */
+	VNADATA_FILETYPE_NPDB		= 4,
 } vnadata_filetype_t;
 
+/* vnadata_layout_t: storage layout of the data */
+typedef enum vnadata_layout {
+	/* vector of serialized matrices, one per frequency (default) */
+	VNADATA_LAYOUT_FREQUENCY_MAJOR	= 0,
+	/* matrix of by-frequency vectors, one per cell */
+	VNADATA_LAYOUT_CELL_MAJOR	= 1,
+} vnadata_layout_t;
+
 /*
  * vnadata_t: network parameter data
  *
  * Note: The members of this structure should be treated as opaque
  * by users of the library.  Accessing these directly will expose
  * you to future compatibility breaks.
+ *
+ * In VNADATA_LAYOUT_FREQUENCY_MAJOR layout, vd_data is indexed first
+ * by frequency index then by cell; in VNADATA_LAYOUT_CELL_MAJOR layout,
+ * it's indexed first by cell then by frequency index.
+ *
+ * If vd_view is true, vd_frequency_vector and the vectors referenced
+ * by vd_data belong to another vnadata_t (see vnadata_view) or to a
+ * mapped file (see vnadata_map).
  */
 typedef struct vnadata {
     vnadata_parameter_type_t vd_type;
@@ -91,8 +110,24 @@ typedef struct vnadata {
     int vd_frequencies;
     double *vd_frequency_vector;
     double complex **vd_data;
+    /* added in interface version 1; only append fields after these */
+    vnadata_layout_t vd_layout;
+    bool vd_view;
 } vnadata_t;
 
+/*
+ * vnadata_stats_t: hot-path counters and times (see vnadata_get_stats)
+ */
+typedef struct vnadata_stats {
+    unsigned long vds_load_calls;	/* vnadata_load and vnadata_fload */
+    uint64_t vds_load_bytes;		/* bytes parsed by the loaders */
+    uint64_t vds_load_ns;		/* time in load (ns) */
+    unsigned long vds_save_calls;	/* vnadata_save and vnadata_fsave */
+    uint64_t vds_save_ns;		/* time in save (ns) */
+    unsigned long vds_convert_calls;	/* vnadata_convert and _rconvert */
+    uint64_t vds_convert_ns;		/* time in conversion (ns) */
+} vnadata_stats_t;
+
 /*
  * vnadata_alloc: allocate an empty vnadata_t structure
  *   @error_fn: optional error reporting function (NULL if not used)
@@ -126,6 +161,34 @@ extern int vnadata_init(vnadata_t *vdp, vnadata_parameter_type_t type,
 extern void _vnadata_bounds_error(const char *function, const vnadata_t *vdp,
 	const char *what, int value);
 
+/*
+ * _vnadata_layout_error: internal function to report a layout mismatch
+ *   @function: name of calling function
+ *   @vdp: pointer to vnacal_data_t structure
+ */
+extern void _vnadata_layout_error(const char *function, const vnadata_t *vdp);
+
+/*
+ * _vnadata_materialize_view: give a view its own copy of the data
+ *   @vdp: pointer to vnacal_data_t structure
+ */
+extern int _vnadata_materialize_view(vnadata_t *vdp);
+
+/*
+ * _vnadata_cell_address: internal function to find a cell in either layout
+ *   @vdp:    a pointer to the vnadata_t structure
+ *   @findex: frequency index
+ *   @cell:   serialized matrix index (row * columns + column)
+ */
+static inline double complex *_vnadata_cell_address(const vnadata_t *vdp,
+	int findex, int cell)
+{
+    if (vdp->vd_layout == VNADATA_LAYOUT_CELL_MAJOR) {
+	return &vdp->vd_data[cell][findex];
+    }
+    return &vdp->vd_data[findex][cell];
+}
+
 /*
  * vnadata_alloc_and_init: allocate a vnadata_t structure and initialize to zero
  *   @error_fn: optional error reporting function (NULL if not used)
@@ -178,6 +241,72 @@ static inline vnadata_t *vnadata_alloc_and_init(vnaerr_error_fn_t *error_fn,
 extern int vnadata_resize(vnadata_t *vdp, vnadata_parameter_type_t type,
 	int rows, int columns, int frequencies);
 
+/*
+ * vnadata_get_layout: return the storage layout
+ *   @vdp: a pointer to the vnadata_t structure
+ */
+static inline vnadata_layout_t vnadata_get_layout(const vnadata_t *vdp)
+{
+    return vdp->vd_layout;
+}
+
+/*
+ * vnadata_set_layout: change the storage layout, preserving values
+ *   @vdp: a pointer to the vnadata_t structure
+ *   @layout: new layout
+ *
+ * Notes:
+ *   The layout is retained across vnadata_init and vnadata_resize,
+ *   so the usual place to call this function is between vnadata_alloc
+ *   and vnadata_init, where it's inexpensive.  Called on a populated
+ *   structure, it reorganizes the existing data.
+ *
+ *   Changing the layout invalidates earlier pointers returned from
+ *   vnadata_get_matrix and vnadata_get_vector.
+ */
+extern int vnadata_set_layout(vnadata_t *vdp, vnadata_layout_t layout);
+
+/*
+ * vnadata_set_allocator: set the allocator for the data and frequency storage
+ *   @vdp: a pointer to the vnadata_t structure
+ *   @allocator: allocator to use, or NULL for the global allocator
+ *
+ * Notes:
+ *   Must be called before any storage is allocated, i.e. between
+ *   vnadata_alloc and vnadata_init.  The allocator must remain valid
+ *   until vnadata_free; in particular, don't reset an arena allocator
+ *   before freeing the structures that use it.
+ */
+extern int vnadata_set_allocator(vnadata_t *vdp,
+	const vnamem_allocator_t *allocator);
+
+/*
+ * vnadata_view: make vdp a view of a frequency range and ports of parent
+ *   @vdp:         a pointer to the vnadata_t structure to become the view
+ *   @parent:      vnadata_t structure to view
+ *   @findex:      first frequency index of the range
+ *   @frequencies: number of frequencies in the range
+ *   @port_vector: ports of parent to include (NULL for all)
+ *   @ports:       length of port_vector
+ *
+ *   The view references the parent's frequencies and data without
+ *   copying.  The parent must not be resized, re-initialized, changed
+ *   in layout or freed while the view exists.  The first write to the
+ *   view's data or frequencies gives the view a private copy.  A port
+ *   subset requires a parent in cell-major layout.
+ */
+extern int vnadata_view(vnadata_t *vdp, const vnadata_t *parent,
+	int findex, int frequencies, const int *port_vector, int ports);
+
+/*
+ * vnadata_is_view: return true if vdp is a view of another vnadata_t
+ *   @vdp: a pointer to the vnadata_t structure
+ */
+static inline bool vnadata_is_view(const vnadata_t *vdp)
+{
+    return vdp->vd_view;
+}
+
 /*
  * vnadata_get_frequencies: return the number of frequencies
  *   @vdp: a pointer to the vnadata_t structure
@@ -314,6 +443,9 @@ static inline int vnadata_set_frequency(vnadata_t *vdp, int findex,
 	return -1;
     }
 #endif /* VNADATA_NO_BOUNDS_CHECK */
+    if (vdp->vd_view && _vnadata_materialize_view(vdp) == -1) {
+	return -1;
+    }
     vdp->vd_frequency_vector[findex] = frequency;
     return 0;
 }
@@ -346,6 +478,9 @@ static inline int vnadata_set_frequency_vector(vnadata_t *vdp,
 	errno = EINVAL;
 	return -1;
     }
+    if (vdp->vd_view && _vnadata_materialize_view(vdp) == -1) {
+	return -1;
+    }
     (void)memcpy((void *)vdp->vd_frequency_vector, (void *)frequency_vector,
 	vdp->vd_frequencies * sizeof(double));
     return 0;
@@ -379,7 +514,7 @@ static inline double complex vnadata_get_cell(const vnadata_t *vdp,
 	return HUGE_VAL;
     }
 #endif /* VNADATA_NO_BOUNDS_CHECK */
-    return vdp->vd_data[findex][row * vdp->vd_columns + column];
+    return *_vnadata_cell_address(vdp, findex, row * vdp->vd_columns + column);
 }
 
 /*
@@ -411,7 +546,11 @@ static inline int vnadata_set_cell(vnadata_t *vdp, int findex, int row,
 	return -1;
     }
 #endif /* VNADATA_NO_BOUNDS_CHECK */
-    vdp->vd_data[findex][row * vdp->vd_columns + column] = value;
+    if (vdp->vd_view && _vnadata_materialize_view(vdp) == -1) {
+	return -1;
+    }
+    *_vnadata_cell_address(vdp, findex,
+	    row * vdp->vd_columns + column) = value;
     return 0;
 }
 
@@ -419,6 +558,12 @@ static inline int vnadata_set_cell(vnadata_t *vdp, int findex, int row,
  * vnadata_get_matrix: return the serialized matrix at the given freq. index
  *   @vdp:    a pointer to the vnadata_t structure
  *   @findex: frequency index
+ *
+ * Fails in VNADATA_LAYOUT_CELL_MAJOR layout, where the matrix isn't
+ * contiguous; use vnadata_get_to_matrix instead.  On a view, first
+ * gives the view its own copy of the data so that writes through the
+ * result can't change the parent; vnadata_get_to_matrix reads a view
+ * without copying.
  */
 static inline double complex *vnadata_get_matrix(const vnadata_t *vdp,
 	int findex)
@@ -433,9 +578,49 @@ static inline double complex *vnadata_get_matrix(const vnadata_t *vdp,
 	return NULL;
     }
 #endif /* VNADATA_NO_BOUNDS_CHECK */
+    if (vdp->vd_layout != VNADATA_LAYOUT_FREQUENCY_MAJOR) {
+	_vnadata_layout_error(__func__, vdp);
+	return NULL;
+    }
+    if (vdp->vd_view && _vnadata_materialize_view((vnadata_t *)vdp) == -1) {
+	return NULL;
+    }
     return vdp->vd_data[findex];
 }
 
+/*
+ * vnadata_get_to_matrix: copy the matrix at the given freq. index
+ *   @vdp:    a pointer to the vnadata_t structure
+ *   @findex: frequency index
+ *   @matrix: caller-supplied serialized matrix (concatenation of rows)
+ */
+static inline int vnadata_get_to_matrix(const vnadata_t *vdp, int findex,
+	double complex *matrix)
+{
+    int cells;
+
+#ifndef VNADATA_NO_BOUNDS_CHECK
+    if (vdp == NULL) {
+	errno = EINVAL;
+	return -1;
+    }
+    if (findex < 0 || findex >= vdp->vd_frequencies) {
+	_vnadata_bounds_error(__func__, vdp, "frequency index", findex);
+	return -1;
+    }
+#endif /* VNADATA_NO_BOUNDS_CHECK */
+    cells = vdp->vd_rows * vdp->vd_columns;
+    if (vdp->vd_layout == VNADATA_LAYOUT_CELL_MAJOR) {
+	for (int cell = 0; cell < cells; ++cell) {
+	    matrix[cell] = vdp->vd_data[cell][findex];
+	}
+	return 0;
+    }
+    (void)memcpy((void *)matrix, (void *)vdp->vd_data[findex],
+	cells * sizeof(double complex));
+    return 0;
+}
+
 /*
  * vnadata_set_matrix: set the matrix at the given frequency index
  *   @vdp:    a pointer to the vnadata_t structure
@@ -455,11 +640,59 @@ static inline int vnadata_set_matrix(vnadata_t *vdp, int findex,
 	return -1;
     }
 #endif /* VNADATA_NO_BOUNDS_CHECK */
+    if (vdp->vd_view && _vnadata_materialize_view(vdp) == -1) {
+	return -1;
+    }
+    if (vdp->vd_layout == VNADATA_LAYOUT_CELL_MAJOR) {
+	const int cells = vdp->vd_rows * vdp->vd_columns;
+
+	for (int cell = 0; cell < cells; ++cell) {
+	    vdp->vd_data[cell][findex] = matrix[cell];
+	}
+	return 0;
+    }
     (void)memcpy((void *)vdp->vd_data[findex], (void *)matrix,
 	vdp->vd_rows * vdp->vd_columns * sizeof(double complex));
     return 0;
 }
 
+/*
+ * vnadata_get_vector: return the by-frequency vector of the given cell
+ *   @vdp:    a pointer to the vnadata_t structure
+ *   @row:    matrix row
+ *   @column: matrix column
+ *
+ * Fails in VNADATA_LAYOUT_FREQUENCY_MAJOR layout, where the vector
+ * isn't contiguous; use vnadata_get_to_vector instead.  On a view, first
+ * gives the view its own copy of the data, as vnadata_get_matrix does.
+ */
+static inline double complex *vnadata_get_vector(const vnadata_t *vdp,
+	int row, int column)
+{
+#ifndef VNADATA_NO_BOUNDS_CHECK
+    if (vdp == NULL) {
+	errno = EINVAL;
+	return NULL;
+    }
+    if (row    < 0 || row    >= vdp->vd_rows) {
+	_vnadata_bounds_error(__func__, vdp, "row", row);
+	return NULL;
+    }
+    if (column < 0 || column >= vdp->vd_columns) {
+	_vnadata_bounds_error(__func__, vdp, "column", column);
+	return NULL;
+    }
+#endif /* VNADATA_NO_BOUNDS_CHECK */
+    if (vdp->vd_layout != VNADATA_LAYOUT_CELL_MAJOR) {
+	_vnadata_layout_error(__func__, vdp);
+	return NULL;
+    }
+    if (vdp->vd_view && _vnadata_materialize_view((vnadata_t *)vdp) == -1) {
+	return NULL;
+    }
+    return vdp->vd_data[row * vdp->vd_columns + column];
+}
+
 /*
  * vnadata_get_to_vector: copy a matrix cell into a by-frequency vector
  *   @vdp:    a pointer to the vnadata_t structure
@@ -486,6 +719,12 @@ static inline int vnadata_get_to_vector(const vnadata_t *vdp,
 	return -1;
     }
 #endif /* VNADATA_NO_BOUNDS_CHECK */
+    if (vdp->vd_layout == VNADATA_LAYOUT_CELL_MAJOR) {
+	(void)memcpy((void *)vector,
+		(void *)vdp->vd_data[row * vdp->vd_columns + column],
+		vdp->vd_frequencies * sizeof(double complex));
+	return 0;
+    }
     for (int findex = 0; findex < vdp->vd_frequencies; ++findex) {
 	vector[findex] = vdp->vd_data[findex][row * vdp->vd_columns + column];
     }
@@ -518,6 +757,14 @@ static inline int vnadata_set_from_vector(vnadata_t *vdp, int row, int column,
 	return -1;
     }
 #endif /* VNADATA_NO_BOUNDS_CHECK */
+    if (vdp->vd_view && _vnadata_materialize_view(vdp) == -1) {
+	return -1;
+    }
+    if (vdp->vd_layout == VNADATA_LAYOUT_CELL_MAJOR) {
+	(void)memcpy((void *)vdp->vd_data[row * vdp->vd_columns + column],
+		(void *)vector, vdp->vd_frequencies * sizeof(double complex));
+	return 0;
+    }
     for (int findex = 0; findex < vdp->vd_frequencies; ++findex) {
 	vdp->vd_data[findex][row * vdp->vd_columns + column] = vector[findex];
     }
@@ -631,6 +878,28 @@ extern int vnadata_rconvert(const vnadata_t *vdp_in, vnadata_t *vdp_out,
 	vnadata_parameter_type_t newtype, const double complex *new_z0,
 	int new_z0_length);
 
+/*
+ * vnadata_resample: interpolate onto a new frequency grid
+ *   @vdp_in:  input network parameter data
+ *   @vdp_out: output network parameter data (can be same as vdp_in)
+ *   @frequency_vector: new frequencies in increasing order
+ *   @frequencies: length of frequency_vector
+ */
+extern int vnadata_resample(const vnadata_t *vdp_in, vnadata_t *vdp_out,
+	const double *frequency_vector, int frequencies);
+
+/*
+ * vnadata_find_frequency: find the index of a frequency
+ *   @vdp: a pointer to the vnadata_t structure
+ *   @frequency: frequency to find
+ *   @cursor: optional in/out search hint (may be NULL)
+ *
+ *   Return the index of the largest frequency less than or equal to
+ *   the given frequency, or -1 if out of range.
+ */
+extern int vnadata_find_frequency(const vnadata_t *vdp, double frequency,
+	int *cursor);
+
 /*
  * vnadata_add_frequency: add a new frequency entry
  *   @vdp: a pointer to the vnadata_t structure
@@ -726,6 +995,143 @@ extern int vnadata_load(vnadata_t *vdp, const char *filename);
  */
 extern int vnadata_fload(vnadata_t *vdp, FILE *fp, const char *filename);
 
+/*
+ * vnadata_map: map a binary network parameter data file
+ *   @vdp: a pointer to the vnadata_t structure
+ *   @filename: file to map
+ *
+ *   Make vdp a view of the frequencies and data in the file without
+ *   copying them.  As with vnadata_view, the first write gives vdp a
+ *   private copy.  If the file can't be mapped, it's loaded instead.
+ */
+extern int vnadata_map(vnadata_t *vdp, const char *filename);
+
+/*
+ * vnadata_probe_t: summary of a file returned from vnadata_probe
+ */
+typedef struct vnadata_probe {
+    vnadata_filetype_t vp_filetype;	/* type of file found */
+    vnadata_parameter_type_t vp_type;	/* parameter type in the file */
+    int vp_rows;			/* rows in each matrix */
+    int vp_columns;			/* columns in each matrix */
+    int vp_frequencies;			/* number of frequencies */
+    double vp_fmin;			/* first frequency, or 0 if none */
+    double vp_fmax;			/* last frequency, or 0 if none */
+    bool vp_fz0;			/* z0 varies by frequency */
+} vnadata_probe_t;
+
+/*
+ * vnadata_probe: read the header and frequency range of a file
+ *   @vdp: a pointer to the vnadata_t structure to receive the header
+ *   @filename: file to examine
+ *   @vpp: address of structure to receive the summary
+ *
+ *   Leave the parameter type, dimensions, reference impedances and
+ *   format in vdp with zero frequencies, as vnadata_reader_open does,
+ *   without converting the data.
+ */
+extern int vnadata_probe(vnadata_t *vdp, const char *filename,
+	vnadata_probe_t *vpp);
+
+/*
+ * vnadata_reader_t: opaque state for reading a file one frequency at a time
+ */
+typedef struct vnadata_reader vnadata_reader_t;
+
+/*
+ * vnadata_reader_open: open a Touchstone or NPD file for streaming
+ *   @vdp: a pointer to the vnadata_t structure to receive each record
+ *   @filename: file to read
+ *
+ *   Parse the header and leave the parameter type, dimensions,
+ *   reference impedances and format in vdp with zero frequencies.
+ */
+extern vnadata_reader_t *vnadata_reader_open(vnadata_t *vdp,
+	const char *filename);
+
+/*
+ * vnadata_reader_fopen: stream a Touchstone or NPD file from a file pointer
+ *   @vdp: a pointer to the vnadata_t structure to receive each record
+ *   @fp: file pointer
+ *   @filename: filename used in error messages and to intuit the file type
+ */
+extern vnadata_reader_t *vnadata_reader_fopen(vnadata_t *vdp, FILE *fp,
+	const char *filename);
+
+/*
+ * vnadata_reader_get_frequencies: return the number of frequencies or -1
+ *   @vrp: pointer returned from vnadata_reader_open
+ *
+ *   Return -1 if the header doesn't give the number of frequencies.
+ */
+extern int vnadata_reader_get_frequencies(const vnadata_reader_t *vrp);
+
+/*
+ * vnadata_reader_next: read the next frequency into vdp
+ *   @vrp: pointer returned from vnadata_reader_open
+ *
+ *   On success, vdp has exactly one frequency containing the record.
+ *   Return 1 if a frequency was read, 0 at end of file, -1 on error.
+ */
+extern int vnadata_reader_next(vnadata_reader_t *vrp);
+
+/*
+ * vnadata_reader_close: close a reader and free its resources
+ *   @vrp: pointer returned from vnadata_reader_open
+ */
+extern void vnadata_reader_close(vnadata_reader_t *vrp);
+
+/*
+ * vnadata_writer_t: opaque state for writing a file one frequency at a time
+ */
+typedef struct vnadata_writer vnadata_writer_t;
+
+/*
+ * vnadata_writer_open: create a file and write its header
+ *   @vdp: template giving type, dimensions, z0, format and precisions
+ *   @filename: file to create
+ *
+ *   The template isn't referenced after the call returns.  For binary
+ *   NPD files, the number of frequencies in the template gives the
+ *   most that can be appended.
+ */
+extern vnadata_writer_t *vnadata_writer_open(vnadata_t *vdp,
+	const char *filename);
+
+/*
+ * vnadata_writer_fopen: write a file header to a file pointer
+ *   @vdp: template giving type, dimensions, z0, format and precisions
+ *   @fp: file pointer
+ *   @filename: filename used in error messages and to intuit the file type
+ */
+extern vnadata_writer_t *vnadata_writer_fopen(vnadata_t *vdp, FILE *fp,
+	const char *filename);
+
+/*
+ * vnadata_writer_append: format one frequency into the output
+ *   @vwp: pointer returned from vnadata_writer_open
+ *   @frequency: frequency in Hz
+ *   @matrix: serialized rows x columns matrix in the template's type
+ *   @z0_vector: per-frequency reference impedances, or NULL
+ *
+ *   Give z0_vector if and only if the template has per-frequency
+ *   reference impedances.
+ */
+extern int vnadata_writer_append(vnadata_writer_t *vwp, double frequency,
+	const double complex *matrix, const double complex *z0_vector);
+
+/*
+ * vnadata_writer_flush: write buffered output and update the header
+ *   @vwp: pointer returned from vnadata_writer_open
+ */
+extern int vnadata_writer_flush(vnadata_writer_t *vwp);
+
+/*
+ * vnadata_writer_close: complete the file and free the writer
+ *   @vwp: pointer returned from vnadata_writer_open
+ */
+extern int vnadata_writer_close(vnadata_writer_t *vwp);
+
 /*
  * vnadata_cksave: check that the given parameters and format are valid for save
  *   @vdp: a pointer to the vnadata_t structure
@@ -748,6 +1154,23 @@ extern int vnadata_save(vnadata_t *vdp, const char *filename);
  */
 extern int vnadata_fsave(vnadata_t *vdp, FILE *fp, const char *filename);
 
+/*
+ * vnadata_get_stats: return hot-path counters and times
+ *   @stats: caller-allocated structure to receive the result
+ */
+extern void vnadata_get_stats(vnadata_stats_t *stats);
+
+/*
+ * vnadata_reset_stats: clear hot-path counters and times
+ */
+extern void vnadata_reset_stats(void);
+
+/*
+ * vnadata_set_stats_per_thread: count separately in each thread
+ *   @per_thread: true for per-thread counters; false for shared
+ */
+extern void vnadata_set_stats_per_thread(bool per_thread);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
@@ -51,6 +51,9 @@ int vnadata_add_frequency(vnadata_t *vdp, double frequency)
 		"vnadata_add_frequency: invalid frequency: %f", frequency);
 	return -1;
     }
+    if (vdp->vd_view && _vnadata_materialize_view(vdp) == -1) {
+	return -1;
+    }
 
     /*
      * Extend the frequency allocation as needed.
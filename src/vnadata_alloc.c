@@ -69,6 +69,29 @@ void _vnadata_bounds_error(const char *function, const vnadata_t *vdp,
 	    function, what, value);
 }
 
+/*
+ * _vnadata_layout_error: internal function to report a layout mismatch
+ *   @function: name of calling function
+ *   @vdp: pointer to vnacal_data_t structure
+ */
+void _vnadata_layout_error(const char *function, const vnadata_t *vdp)
+{
+    vnadata_internal_t *vdip;
+
+    if (vdp == NULL) {
+	errno = EINVAL;
+	return;
+    }
+    vdip = VDP_TO_VDIP(vdp);
+    if (vdip->vdi_magic != VDI_MAGIC) {
+	errno = EINVAL;
+	return;
+    }
+    _vnadata_error(vdip, VNAERR_USAGE, "%s: not available in %s layout",
+	    function, vdp->vd_layout == VNADATA_LAYOUT_CELL_MAJOR ?
+	    "cell-major" : "frequency-major");
+}
+
 /* _vnadata_set_name_from_dimensions: provide a default name from dims
  *   @vdip: pointer to vnadata_internal_t structure
  */
@@ -121,7 +144,8 @@ int _vnadata_extend_p(vnadata_internal_t *vdip, int new_p_allocation)
 	    for (int findex = 0; findex < vdip->vdi_f_allocation; ++findex) {
 		double complex *clfp;
 
-		clfp = realloc(vdip->vdi_z0_vector_vector[findex],
+		clfp = _vnadata_realloc(vdip,
+			vdip->vdi_z0_vector_vector[findex],
 			new_p_allocation * sizeof(double complex));
 		if (clfp == NULL) {
 		    _vnadata_error(vdip, VNAERR_SYSTEM,
@@ -136,7 +160,7 @@ int _vnadata_extend_p(vnadata_internal_t *vdip, int new_p_allocation)
 	} else {
 	    double complex *clfp;
 
-	    clfp = realloc(vdip->vdi_z0_vector,
+	    clfp = _vnadata_realloc(vdip, vdip->vdi_z0_vector,
 		    new_p_allocation * sizeof(double complex));
 	    if (clfp == NULL) {
 		_vnadata_error(vdip, VNAERR_SYSTEM,
@@ -163,23 +187,62 @@ int _vnadata_extend_m(vnadata_internal_t *vdip, int new_m_allocation)
     vnadata_t *vdp = &vdip->vdi_vd;
     int old_m_allocation = vdip->vdi_m_allocation;
 
-    if (new_m_allocation > old_m_allocation) {
-	for (int findex = 0; findex < vdip->vdi_f_allocation; ++findex) {
-	    double complex *clfp;
+    if (new_m_allocation <= old_m_allocation) {
+	return 0;
+    }
 
-	    if ((clfp = realloc(vdp->vd_data[findex], new_m_allocation *
-			    sizeof(double complex))) == NULL) {
-		_vnadata_error(vdip, VNAERR_SYSTEM,
-			"realloc: %s", strerror(errno));
-		return -1;
+    /*
+     * In cell-major layout, extend the vector of cells and add new
+     * by-frequency vectors.
+     */
+    if (vdp->vd_layout == VNADATA_LAYOUT_CELL_MAJOR) {
+	double complex **clfpp;
+
+	if ((clfpp = _vnadata_realloc(vdip, vdp->vd_data, new_m_allocation *
+			sizeof(double complex *))) == NULL) {
+	    _vnadata_error(vdip, VNAERR_SYSTEM,
+		    "realloc: %s", strerror(errno));
+	    return -1;
+	}
+	(void)memset((void *)&clfpp[old_m_allocation], 0,
+		(new_m_allocation - old_m_allocation) *
+		sizeof(double complex *));
+	vdp->vd_data = clfpp;
+	if (vdip->vdi_f_allocation != 0) {
+	    for (int cell = old_m_allocation; cell < new_m_allocation;
+		    ++cell) {
+		if ((vdp->vd_data[cell] = _vnadata_calloc(vdip,
+				vdip->vdi_f_allocation,
+				sizeof(double complex))) == NULL) {
+		    _vnadata_error(vdip, VNAERR_SYSTEM,
+			    "calloc: %s", strerror(errno));
+		    return -1;
+		}
+		++vdip->vdi_m_allocation;
 	    }
-	    (void)memset((void *)&clfp[old_m_allocation], 0,
-		    (new_m_allocation - old_m_allocation) *
-		    sizeof(double complex));
-	    vdp->vd_data[findex] = clfp;
 	}
 	vdip->vdi_m_allocation = new_m_allocation;
+	return 0;
     }
+
+    /*
+     * In frequency-major layout, extend each matrix.
+     */
+    for (int findex = 0; findex < vdip->vdi_f_allocation; ++findex) {
+	double complex *clfp;
+
+	if ((clfp = _vnadata_realloc(vdip, vdp->vd_data[findex],
+			new_m_allocation * sizeof(double complex))) == NULL) {
+	    _vnadata_error(vdip, VNAERR_SYSTEM,
+		    "realloc: %s", strerror(errno));
+	    return -1;
+	}
+	(void)memset((void *)&clfp[old_m_allocation], 0,
+		(new_m_allocation - old_m_allocation) *
+		sizeof(double complex));
+	vdp->vd_data[findex] = clfp;
+    }
+    vdip->vdi_m_allocation = new_m_allocation;
     return 0;
 }
 
@@ -200,7 +263,7 @@ int _vnadata_extend_f(vnadata_internal_t *vdip, int new_f_allocation)
 	/*
 	 * Extend the frequency vector.
 	 */
-	lfp = realloc(vdp->vd_frequency_vector,
+	lfp = _vnadata_realloc(vdip, vdp->vd_frequency_vector,
 		new_f_allocation * sizeof(double));
 	if (lfp == NULL) {
 	    _vnadata_error(vdip, VNAERR_SYSTEM,
@@ -215,7 +278,8 @@ int _vnadata_extend_f(vnadata_internal_t *vdip, int new_f_allocation)
 	 * If per-frequency Z0, extend the Z0 vector vector.
 	 */
 	if (vdip->vdi_flags & VF_PER_F_Z0) {
-	    if ((clfpp = realloc(vdip->vdi_z0_vector_vector, new_f_allocation *
+	    if ((clfpp = _vnadata_realloc(vdip, vdip->vdi_z0_vector_vector,
+			    new_f_allocation *
 			    sizeof(double complex *))) == NULL) {
 		_vnadata_error(vdip, VNAERR_SYSTEM,
 			"realloc: %s", strerror(errno));
@@ -225,19 +289,39 @@ int _vnadata_extend_f(vnadata_internal_t *vdip, int new_f_allocation)
 	}
 
 	/*
-	 * Extend vd_data.
+	 * Extend vd_data.  In cell-major layout, lengthen each cell's
+	 * by-frequency vector; in frequency-major layout, extend the
+	 * vector of matrices.
 	 */
-	clfpp = realloc(vdp->vd_data, new_f_allocation *
-		sizeof(double complex *));
-	if (clfpp == NULL) {
-	    _vnadata_error(vdip, VNAERR_SYSTEM,
-		    "realloc: %s", strerror(errno));
-	    return -1;
+	if (vdp->vd_layout == VNADATA_LAYOUT_CELL_MAJOR) {
+	    for (int cell = 0; cell < vdip->vdi_m_allocation; ++cell) {
+		double complex *clfp;
+
+		if ((clfp = _vnadata_realloc(vdip, vdp->vd_data[cell],
+				new_f_allocation *
+				sizeof(double complex))) == NULL) {
+		    _vnadata_error(vdip, VNAERR_SYSTEM,
+			    "realloc: %s", strerror(errno));
+		    return -1;
+		}
+		(void)memset((void *)&clfp[old_f_allocation], 0,
+			(new_f_allocation - old_f_allocation) *
+			sizeof(double complex));
+		vdp->vd_data[cell] = clfp;
+	    }
+	} else {
+	    clfpp = _vnadata_realloc(vdip, vdp->vd_data, new_f_allocation *
+		    sizeof(double complex *));
+	    if (clfpp == NULL) {
+		_vnadata_error(vdip, VNAERR_SYSTEM,
+			"realloc: %s", strerror(errno));
+		return -1;
+	    }
+	    (void)memset((void *)&clfpp[old_f_allocation], 0,
+		    (new_f_allocation - old_f_allocation) *
+		    sizeof(double complex *));
+	    vdp->vd_data = clfpp;
 	}
-	(void)memset((void *)&clfpp[old_f_allocation], 0,
-		(new_f_allocation - old_f_allocation) *
-		sizeof(double complex *));
-	vdp->vd_data = clfpp;
 
 	/*
 	 * Add the new sub-vectors.
@@ -247,7 +331,7 @@ int _vnadata_extend_f(vnadata_internal_t *vdip, int new_f_allocation)
 	    if ((vdip->vdi_flags & VF_PER_F_Z0) &&
 		    vdip->vdi_p_allocation != 0) {
 		if ((vdip->vdi_z0_vector_vector[findex] =
-			    calloc(vdip->vdi_p_allocation,
+			    _vnadata_calloc(vdip, vdip->vdi_p_allocation,
 				sizeof(double complex))) == NULL) {
 		    _vnadata_error(vdip, VNAERR_SYSTEM,
 			    "calloc: %s", strerror(errno));
@@ -257,13 +341,16 @@ int _vnadata_extend_f(vnadata_internal_t *vdip, int new_f_allocation)
 		    vdip->vdi_z0_vector_vector[findex][i] = VNADATA_DEFAULT_Z0;
 		}
 	    }
-	    if (vdip->vdi_m_allocation != 0) {
-		if ((vdp->vd_data[findex] = calloc(vdip->vdi_m_allocation,
+	    if (vdp->vd_layout == VNADATA_LAYOUT_FREQUENCY_MAJOR &&
+		    vdip->vdi_m_allocation != 0) {
+		if ((vdp->vd_data[findex] = _vnadata_calloc(vdip,
+				vdip->vdi_m_allocation,
 				sizeof(double complex))) == NULL) {
 		    _vnadata_error(vdip, VNAERR_SYSTEM,
 			    "calloc: %s", strerror(errno));
 		    if (vdip->vdi_flags & VF_PER_F_Z0) {
-			free((void *)vdip->vdi_z0_vector_vector[findex]);
+			_vnadata_free(vdip,
+				(void *)vdip->vdi_z0_vector_vector[findex]);
 			vdip->vdi_z0_vector_vector[findex] = NULL;
 		    }
 		    return -1;
@@ -281,9 +368,11 @@ int _vnadata_extend_f(vnadata_internal_t *vdip, int new_f_allocation)
  */
 vnadata_t *vnadata_alloc(vnaerr_error_fn_t *error_fn, void *error_arg)
 {
+    vnamem_allocator_t heap;
     vnadata_internal_t *vdip;
 
-    if ((vdip = malloc(sizeof(vnadata_internal_t))) == NULL) {
+    vnamem_get_allocator(&heap);
+    if ((vdip = _vnamem_amalloc(&heap, sizeof(vnadata_internal_t))) == NULL) {
 	if (error_fn != NULL) {
 	    int saved_errno = errno;
 	    char message[80];
@@ -307,6 +396,8 @@ vnadata_t *vnadata_alloc(vnaerr_error_fn_t *error_fn, void *error_arg)
     vdip->vdi_format_string = NULL;
     vdip->vdi_fprecision = 7;
     vdip->vdi_dprecision = 6;
+    vdip->vdi_allocator = heap;
+    vdip->vdi_heap = heap;
     _vnadata_set_name_from_dimensions(vdip);
 
     return &vdip->vdi_vd;
@@ -429,6 +520,9 @@ int vnadata_resize(vnadata_t *vdp, vnadata_parameter_type_t type,
     if (validate_type(__func__, vdip, type, rows, columns) == -1) {
 	return -1;
     }
+    if (vdp->vd_view && _vnadata_materialize_view(vdp) == -1) {
+	return -1;
+    }
     old_ports = MAX(vdp->vd_rows, vdp->vd_columns);
     new_ports = MAX(rows, columns);
     old_cells = vdp->vd_rows * vdp->vd_columns;
@@ -476,9 +570,16 @@ int vnadata_resize(vnadata_t *vdp, vnadata_parameter_type_t type,
      * Zero vacated matrix cells.
      */
     if (new_cells < old_cells) {
-	for (int findex = 0; findex < vdp->vd_frequencies; ++findex) {
-	    (void)memset((void *)&vdp->vd_data[findex][new_cells], 0,
-		(old_cells - new_cells) * sizeof(double complex));
+	if (vdp->vd_layout == VNADATA_LAYOUT_CELL_MAJOR) {
+	    for (int cell = new_cells; cell < old_cells; ++cell) {
+		(void)memset((void *)vdp->vd_data[cell], 0,
+		    vdp->vd_frequencies * sizeof(double complex));
+	    }
+	} else {
+	    for (int findex = 0; findex < vdp->vd_frequencies; ++findex) {
+		(void)memset((void *)&vdp->vd_data[findex][new_cells], 0,
+		    (old_cells - new_cells) * sizeof(double complex));
+	    }
 	}
     }
 
@@ -496,10 +597,18 @@ int vnadata_resize(vnadata_t *vdp, vnadata_parameter_type_t type,
 		}
 	    }
 	}
-	for (int findex = vdp->vd_frequencies - 1; findex >= frequencies;
-		--findex) {
-	    (void)memset((void *)vdp->vd_data[findex], 0,
-		    old_cells * sizeof(double complex));
+	if (vdp->vd_layout == VNADATA_LAYOUT_CELL_MAJOR) {
+	    for (int cell = 0; cell < old_cells; ++cell) {
+		(void)memset((void *)&vdp->vd_data[cell][frequencies], 0,
+			(vdp->vd_frequencies - frequencies) *
+			sizeof(double complex));
+	    }
+	} else {
+	    for (int findex = vdp->vd_frequencies - 1; findex >= frequencies;
+		    --findex) {
+		(void)memset((void *)vdp->vd_data[findex], 0,
+			old_cells * sizeof(double complex));
+	    }
 	}
     }
 
@@ -525,6 +634,16 @@ int vnadata_resize(vnadata_t *vdp, vnadata_parameter_type_t type,
 int vnadata_init(vnadata_t *vdp, vnadata_parameter_type_t type,
 	int rows, int columns, int frequencies)
 {
+    /*
+     * Don't make a view copy its data only to discard it.
+     */
+    if (vdp != NULL && vdp->vd_view) {
+	vnadata_internal_t *vdip = VDP_TO_VDIP(vdp);
+
+	if (vdip->vdi_magic == VDI_MAGIC) {
+	    _vnadata_release_storage(vdip);
+	}
+    }
     (void)vnadata_resize(vdp, VPT_UNDEF, 0, 0, 0);
     (void)vnadata_set_all_z0(vdp, VNADATA_DEFAULT_Z0);
     return vnadata_resize(vdp, type, rows, columns, frequencies);
@@ -556,6 +675,55 @@ int vnadata_set_type(vnadata_t *vdp, vnadata_parameter_type_t type)
     return 0;
 }
 
+/*
+ * _vnadata_release_storage: free the data, frequency and z0 storage
+ *   @vdip: pointer to vnadata_internal_t structure
+ *
+ *   Leave the structure empty with no allocations.  If the structure
+ *   is a view, free only the vector of pointers into the parent or
+ *   file mapping.
+ */
+void _vnadata_release_storage(vnadata_internal_t *vdip)
+{
+    vnadata_t *vdp = &vdip->vdi_vd;
+
+    if (vdip->vdi_flags & VF_PER_F_Z0) {
+	for (int findex = 0; findex < vdip->vdi_f_allocation; ++findex) {
+	    _vnadata_free(vdip, (void *)vdip->vdi_z0_vector_vector[findex]);
+	}
+	_vnadata_free(vdip, (void *)vdip->vdi_z0_vector_vector);
+	vdip->vdi_z0_vector_vector = NULL;
+	vdip->vdi_flags &= ~VF_PER_F_Z0;
+    } else {
+	_vnadata_free(vdip, (void *)vdip->vdi_z0_vector);
+	vdip->vdi_z0_vector = NULL;
+    }
+    if (!vdp->vd_view) {
+	_vnadata_free(vdip, (void *)vdp->vd_frequency_vector);
+    }
+    if (vdp->vd_data != NULL) {
+	if (!vdp->vd_view) {
+	    int vectors = vdp->vd_layout == VNADATA_LAYOUT_CELL_MAJOR ?
+		vdip->vdi_m_allocation : vdip->vdi_f_allocation;
+
+	    for (int i = 0; i < vectors; ++i) {
+		_vnadata_free(vdip, (void *)vdp->vd_data[i]);
+	    }
+	}
+	_vnadata_free(vdip, (void *)vdp->vd_data);
+    }
+    vdp->vd_frequency_vector = NULL;
+    vdp->vd_data = NULL;
+    vdp->vd_view = false;
+    _vnadata_unmap(vdip);
+    vdp->vd_frequencies = 0;
+    vdp->vd_rows = 0;
+    vdp->vd_columns = 0;
+    vdip->vdi_p_allocation = 0;
+    vdip->vdi_f_allocation = 0;
+    vdip->vdi_m_allocation = 0;
+}
+
 /*
  * vnadata_free: free a vnadata_t structure
  *   @vdp: pointer to vnacal_data_t structure to free
@@ -564,26 +732,13 @@ void vnadata_free(vnadata_t *vdp)
 {
     if (vdp != NULL) {
 	vnadata_internal_t *vdip = VDP_TO_VDIP(vdp);
+	vnamem_allocator_t heap = vdip->vdi_heap;
 
 	assert(vdip->vdi_magic == VDI_MAGIC);
 	vdip->vdi_magic = -1;
-	free((void *)vdip->vdi_format_string);
-	free((void *)vdip->vdi_format_vector);
-	if (vdip->vdi_flags & VF_PER_F_Z0) {
-	    for (int findex = 0; findex < vdip->vdi_f_allocation; ++findex) {
-		free((void *)vdip->vdi_z0_vector_vector[findex]);
-	    }
-	    free((void *)vdip->vdi_z0_vector_vector);
-	} else {
-	    free((void *)vdip->vdi_z0_vector);
-	}
-	free((void *)vdp->vd_frequency_vector);
-	if (vdp->vd_data != NULL) {
-	    for (int findex = 0; findex < vdip->vdi_f_allocation; ++findex) {
-		free((void *)vdp->vd_data[findex]);
-	    }
-	    free((void *)vdp->vd_data);
-	}
-	free((void *)vdip);
+	_vnadata_free(vdip, (void *)vdip->vdi_format_string);
+	_vnadata_free(vdip, (void *)vdip->vdi_format_vector);
+	_vnadata_release_storage(vdip);
+	_vnamem_afree(&heap, (void *)vdip);
     }
 }
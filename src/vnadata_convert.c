@@ -30,6 +30,7 @@
 #include <string.h>
 #include "vnaconv.h"
 #include "vnadata_internal.h"
+#include "vnastats_internal.h"
 
 /*
  * conversion_group: a bitwise OR of these values describes a group of
@@ -467,6 +468,54 @@ static double complex *get_fz0_vector(vnadata_internal_t *vdip, int findex)
     return vdip->vdi_z0_vector;
 }
 
+/*
+ * get_input_matrix: return the input matrix at the given frequency
+ *   @vdp:    network parameter data
+ *   @findex: frequency index
+ *   @buffer: scratch matrix used in cell-major layout
+ */
+static const double complex *get_input_matrix(const vnadata_t *vdp,
+	int findex, double complex *buffer)
+{
+    if (vdp->vd_layout == VNADATA_LAYOUT_FREQUENCY_MAJOR) {
+	return vdp->vd_data[findex];
+    }
+    (void)vnadata_get_to_matrix(vdp, findex, buffer);
+    return buffer;
+}
+
+/*
+ * get_output_matrix: return where to place the output matrix
+ *   @vdp:    network parameter data
+ *   @findex: frequency index
+ *   @buffer: scratch matrix used in cell-major layout
+ */
+static double complex *get_output_matrix(vnadata_t *vdp, int findex,
+	double complex *buffer)
+{
+    if (vdp->vd_layout == VNADATA_LAYOUT_FREQUENCY_MAJOR) {
+	return vdp->vd_data[findex];
+    }
+    return buffer;
+}
+
+/*
+ * put_output_matrix: store the output matrix if in cell-major layout
+ *   @vdp:    network parameter data
+ *   @findex: frequency index
+ *   @matrix: matrix returned from get_output_matrix
+ *   @cells:  number of cells to store
+ */
+static void put_output_matrix(vnadata_t *vdp, int findex,
+	const double complex *matrix, int cells)
+{
+    if (vdp->vd_layout == VNADATA_LAYOUT_CELL_MAJOR) {
+	for (int cell = 0; cell < cells; ++cell) {
+	    vdp->vd_data[cell][findex] = matrix[cell];
+	}
+    }
+}
+
 /*
  * vnadata_copy_what_t: what to copy
  */
@@ -504,13 +553,20 @@ static int vnadata_copy(const vnadata_t *vdp_in, vnadata_t *vdp_out,
 	assert(rv == 0);
     }
     if (what & COPY_DATA) {
-	for (int findex = 0; findex < frequencies; ++findex) {
-	    double complex *lfcp;
-
-	    lfcp = vnadata_get_matrix(vdp_in, findex);
-	    assert(lfcp != NULL);
-	    rv = vnadata_set_matrix(vdp_out, findex, lfcp);
-	    assert(rv == 0);
+	if (vdp_in->vd_layout == VNADATA_LAYOUT_CELL_MAJOR) {
+	    for (int row = 0; row < rows; ++row) {
+		for (int column = 0; column < columns; ++column) {
+		    rv = vnadata_set_from_vector(vdp_out, row, column,
+			    vdp_in->vd_data[row * columns + column]);
+		    assert(rv == 0);
+		}
+	    }
+	} else {
+	    for (int findex = 0; findex < frequencies; ++findex) {
+		rv = vnadata_set_matrix(vdp_out, findex,
+			vdp_in->vd_data[findex]);
+		assert(rv == 0);
+	    }
 	}
     }
     if (what & COPY_Z0) {
@@ -601,6 +657,9 @@ static int convert_common(const vnadata_t *vdp_in, vnadata_t *vdp_out,
     z0_update_strategy_t z0_update_strategy = Z0U_NONE;
     int z0_stride = 0;
     double complex *temp_z0_vector = NULL;
+    double complex *matrix_buffer = NULL;
+    double complex *in_buffer = NULL;
+    double complex *out_buffer = NULL;
     conversion_code_t conversion = INVAL;
     int group, index;
     int rv = -1;
@@ -640,7 +699,7 @@ static int convert_common(const vnadata_t *vdp_in, vnadata_t *vdp_out,
 	 * and determine the stride through the z0 matrix by frequency.
 	 */
 	if (ports > 1 && new_z0_length == 1) {
-	    if ((temp_z0_vector = calloc(ports,
+	    if ((temp_z0_vector = _vnamem_calloc(ports,
 			    sizeof(double complex))) == NULL) {
 		_vnadata_error(vdip_in, VNAERR_SYSTEM, "calloc: %s",
 			strerror(errno));
@@ -781,6 +840,35 @@ static int convert_common(const vnadata_t *vdp_in, vnadata_t *vdp_out,
 	}
     }
 
+    /*
+     * If converting a view in place, give it a private copy of the
+     * data so that we don't modify the parent.
+     */
+    if (vdp_out->vd_view && (group & CONV_MASK) != CONV_NONE) {
+	if ((rv = _vnadata_materialize_view(vdp_out)) == -1) {
+	    goto out;
+	}
+    }
+
+    /*
+     * If either input or output is in cell-major layout, allocate
+     * scratch matrices to gather and scatter each frequency.
+     */
+    if (vdp_in->vd_layout == VNADATA_LAYOUT_CELL_MAJOR ||
+	    vdp_out->vd_layout == VNADATA_LAYOUT_CELL_MAJOR) {
+	const int cells = vdp_in->vd_rows * vdp_in->vd_columns;
+
+	if ((matrix_buffer = _vnamem_calloc(2 * MAX(cells, 1),
+			sizeof(double complex))) == NULL) {
+	    _vnadata_error(vdip_in, VNAERR_SYSTEM, "calloc: %s",
+		    strerror(errno));
+	    rv = -1;
+	    goto out;
+	}
+	in_buffer  = &matrix_buffer[0];
+	out_buffer = &matrix_buffer[MAX(cells, 1)];
+    }
+
     /*
      * Do the conversion.
      */
@@ -791,8 +879,14 @@ static int convert_common(const vnadata_t *vdp_in, vnadata_t *vdp_out,
 
 	    fn = group_2x2_z0_xtoy[index];
 	    for (int findex = 0; findex < vdp_in->vd_frequencies; ++findex) {
-		(*fn)((const double complex (*)[2])vdp_in->vd_data[findex],
-			(double complex (*)[2])vdp_out->vd_data[findex]);
+		const double complex *in = get_input_matrix(vdp_in, findex,
+			in_buffer);
+		double complex *out = get_output_matrix(vdp_out, findex,
+			out_buffer);
+
+		(*fn)((const double complex (*)[2])in,
+			(double complex (*)[2])out);
+		put_output_matrix(vdp_out, findex, out, 4);
 	    }
 	}
 	break;
@@ -804,9 +898,15 @@ static int convert_common(const vnadata_t *vdp_in, vnadata_t *vdp_out,
 
 	    fn = group_2x2_z1_xtoy[index];
 	    for (int findex = 0; findex < vdp_in->vd_frequencies; ++findex) {
-		(*fn)((const double complex (*)[2])vdp_in->vd_data[findex],
-			(double complex (*)[2])vdp_out->vd_data[findex],
+		const double complex *in = get_input_matrix(vdp_in, findex,
+			in_buffer);
+		double complex *out = get_output_matrix(vdp_out, findex,
+			out_buffer);
+
+		(*fn)((const double complex (*)[2])in,
+			(double complex (*)[2])out,
 			get_fz0_vector(vdip_in, findex));
+		put_output_matrix(vdp_out, findex, out, 4);
 	    }
 	}
 	break;
@@ -818,9 +918,14 @@ static int convert_common(const vnadata_t *vdp_in, vnadata_t *vdp_out,
 
 	    fn = group_2x2_z1_xtoI[index];
 	    for (int findex = 0; findex < vdp_in->vd_frequencies; ++findex) {
-		(*fn)((const double complex (*)[2])vdp_in->vd_data[findex],
-			     vdp_out->vd_data[findex],
+		const double complex *in = get_input_matrix(vdp_in, findex,
+			in_buffer);
+		double complex *out = get_output_matrix(vdp_out, findex,
+			out_buffer);
+
+		(*fn)((const double complex (*)[2])in, out,
 			     get_fz0_vector(vdip_in, findex));
+		put_output_matrix(vdp_out, findex, out, 2);
 	    }
 	}
 	break;
@@ -832,11 +937,16 @@ static int convert_common(const vnadata_t *vdp_in, vnadata_t *vdp_out,
 	    fn = group_2x2_z2_xtoy[index];
 	    for (int findex = 0; findex < vdp_in->vd_frequencies; ++findex) {
 		const int offset = findex * z0_stride;
+		const double complex *in = get_input_matrix(vdp_in, findex,
+			in_buffer);
+		double complex *out = get_output_matrix(vdp_out, findex,
+			out_buffer);
 
-		(*fn)((const double complex (*)[2])vdp_in->vd_data[findex],
-			(double complex (*)[2])vdp_out->vd_data[findex],
+		(*fn)((const double complex (*)[2])in,
+			(double complex (*)[2])out,
 			get_fz0_vector(vdip_in, findex),
 			&new_z0[offset]);
+		put_output_matrix(vdp_out, findex, out, 4);
 	    }
 	}
 	break;
@@ -844,11 +954,17 @@ static int convert_common(const vnadata_t *vdp_in, vnadata_t *vdp_out,
     case DIM_NxN | Z0_NONE  | CONV_xtoy:
 	{
 	    void (*fn)(const double complex *in, double complex *out, int n);
+	    const int n = vdp_in->vd_rows;
 
 	    fn = group_NxN_z0_xtoy[index];
 	    for (int findex = 0; findex < vdp_in->vd_frequencies; ++findex) {
-		(*fn)(vdp_in->vd_data[findex], vdp_out->vd_data[findex],
-		    vdp_in->vd_rows);
+		const double complex *in = get_input_matrix(vdp_in, findex,
+			in_buffer);
+		double complex *out = get_output_matrix(vdp_out, findex,
+			out_buffer);
+
+		(*fn)(in, out, n);
+		put_output_matrix(vdp_out, findex, out, n * n);
 	    }
 	}
 	break;
@@ -857,11 +973,17 @@ static int convert_common(const vnadata_t *vdp_in, vnadata_t *vdp_out,
 	{
 	    void (*fn)(const double complex *in, double complex *out,
 		    const double complex *z0, int n);
+	    const int n = vdp_in->vd_rows;
 
 	    fn = group_NxN_z1_xtoy[index];
 	    for (int findex = 0; findex < vdp_in->vd_frequencies; ++findex) {
-		(*fn)(vdp_in->vd_data[findex], vdp_out->vd_data[findex],
-		    get_fz0_vector(vdip_in, findex), vdp_in->vd_rows);
+		const double complex *in = get_input_matrix(vdp_in, findex,
+			in_buffer);
+		double complex *out = get_output_matrix(vdp_out, findex,
+			out_buffer);
+
+		(*fn)(in, out, get_fz0_vector(vdip_in, findex), n);
+		put_output_matrix(vdp_out, findex, out, n * n);
 	    }
 	}
 	break;
@@ -870,11 +992,17 @@ static int convert_common(const vnadata_t *vdp_in, vnadata_t *vdp_out,
 	{
 	    void (*fn)(const double complex *in, double complex *out,
 		    const double complex *z0, int n);
+	    const int n = vdp_in->vd_rows;
 
 	    fn = group_NxN_z1_xtoI[index];
 	    for (int findex = 0; findex < vdp_in->vd_frequencies; ++findex) {
-		(*fn)(vdp_in->vd_data[findex], vdp_out->vd_data[findex],
-		    get_fz0_vector(vdip_in, findex), vdp_in->vd_rows);
+		const double complex *in = get_input_matrix(vdp_in, findex,
+			in_buffer);
+		double complex *out = get_output_matrix(vdp_out, findex,
+			out_buffer);
+
+		(*fn)(in, out, get_fz0_vector(vdip_in, findex), n);
+		put_output_matrix(vdp_out, findex, out, n);
 	    }
 	}
 	break;
@@ -884,10 +1012,15 @@ static int convert_common(const vnadata_t *vdp_in, vnadata_t *vdp_out,
 	assert(newtype == VPT_S);
 	for (int findex = 0; findex < vdp_in->vd_frequencies; ++findex) {
 	    const int offset = findex * z0_stride;
-
-	    vnaconv_stosrn(vdp_in->vd_data[findex], vdp_out->vd_data[findex],
-			   get_fz0_vector(vdip_in, findex),
-			   &new_z0[offset], vdp_in->vd_rows);
+	    const int n = vdp_in->vd_rows;
+	    const double complex *in = get_input_matrix(vdp_in, findex,
+		    in_buffer);
+	    double complex *out = get_output_matrix(vdp_out, findex,
+		    out_buffer);
+
+	    vnaconv_stosrn(in, out, get_fz0_vector(vdip_in, findex),
+			   &new_z0[offset], n);
+	    put_output_matrix(vdp_out, findex, out, n * n);
 	}
 	break;
 
@@ -923,7 +1056,8 @@ static int convert_common(const vnadata_t *vdp_in, vnadata_t *vdp_out,
     rv = 0;
 
 out:
-    free((void *)temp_z0_vector);
+    _vnamem_free((void *)matrix_buffer);
+    _vnamem_free((void *)temp_z0_vector);
     return rv;
 }
 
@@ -938,8 +1072,14 @@ out:
 int vnadata_convert(const vnadata_t *vdp_in, vnadata_t *vdp_out,
 	vnadata_parameter_type_t newtype)
 {
-    return convert_common(vdp_in, vdp_out, newtype,
+    uint64_t start = _VNASTATS_NOW();
+    int rv;
+
+    rv = convert_common(vdp_in, vdp_out, newtype,
 	    NULL, 0, "vnadata_convert");
+    _VNASTATS_TIME(_vnadata_stats, vds_convert_calls, vds_convert_ns,
+	    start);
+    return rv;
 }
 
 /*
@@ -958,6 +1098,12 @@ int vnadata_rconvert(const vnadata_t *vdp_in, vnadata_t *vdp_out,
 	vnadata_parameter_type_t newtype, const double complex *new_z0,
 	int new_z0_length)
 {
-    return convert_common(vdp_in, vdp_out, newtype,
+    uint64_t start = _VNASTATS_NOW();
+    int rv;
+
+    rv = convert_common(vdp_in, vdp_out, newtype,
 	    new_z0, new_z0_length, "vnadata_rconvert");
+    _VNASTATS_TIME(_vnadata_stats, vds_convert_calls, vds_convert_ns,
+	    start);
+    return rv;
 }
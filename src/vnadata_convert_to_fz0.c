@@ -37,7 +37,8 @@ int _vnadata_convert_to_fz0(vnadata_internal_t *vdip)
 	double complex **clfpp = NULL;
 
 	if (vdip->vdi_f_allocation > 0) {
-	    clfpp = calloc(vdip->vdi_f_allocation, sizeof(double complex *));
+	    clfpp = _vnadata_calloc(vdip, vdip->vdi_f_allocation,
+		    sizeof(double complex *));
 	    if (clfpp == NULL) {
 		_vnadata_error(vdip, VNAERR_SYSTEM, "calloc: %s",
 			strerror(errno));
@@ -46,14 +47,15 @@ int _vnadata_convert_to_fz0(vnadata_internal_t *vdip)
 	    if (vdip->vdi_p_allocation > 0) {
 		for (int findex = 0; findex < vdip->vdi_f_allocation;
 			++findex) {
-		    if ((clfpp[findex] = calloc(vdip->vdi_p_allocation,
+		    if ((clfpp[findex] = _vnadata_calloc(vdip,
+				    vdip->vdi_p_allocation,
 				    sizeof(double complex))) == NULL) {
 			_vnadata_error(vdip, VNAERR_SYSTEM,
 				"calloc: %s", strerror(errno));
 			while (--findex >= 0) {
-			    free((void *)clfpp[findex]);
+			    _vnadata_free(vdip, (void *)clfpp[findex]);
 			}
-			free((void *)clfpp);
+			_vnadata_free(vdip, (void *)clfpp);
 			return -1;
 		    }
 		    for (int port = 0; port < vdip->vdi_p_allocation; ++port) {
@@ -62,7 +64,7 @@ int _vnadata_convert_to_fz0(vnadata_internal_t *vdip)
 		}
 	    }
 	}
-	free((void *)vdip->vdi_z0_vector);
+	_vnadata_free(vdip, (void *)vdip->vdi_z0_vector);
 	vdip->vdi_z0_vector_vector = clfpp;
 	vdip->vdi_flags |= VF_PER_F_Z0;
     }
@@ -37,7 +37,7 @@ int _vnadata_convert_to_z0(vnadata_internal_t *vdip)
 	double complex *clfp = NULL;
 
 	if (vdip->vdi_p_allocation > 0) {
-	    if ((clfp = calloc(vdip->vdi_p_allocation,
+	    if ((clfp = _vnadata_calloc(vdip, vdip->vdi_p_allocation,
 			    sizeof(double complex))) == NULL) {
 		_vnadata_error(vdip, VNAERR_SYSTEM,
 			"calloc: %s", strerror(errno));
@@ -48,9 +48,9 @@ int _vnadata_convert_to_z0(vnadata_internal_t *vdip)
 	    }
 	}
 	for (int findex = 0; findex < vdip->vdi_f_allocation; ++findex) {
-	    free((void *)vdip->vdi_z0_vector_vector[findex]);
+	    _vnadata_free(vdip, (void *)vdip->vdi_z0_vector_vector[findex]);
 	}
-	free((void *)vdip->vdi_z0_vector_vector);
+	_vnadata_free(vdip, (void *)vdip->vdi_z0_vector_vector);
 	vdip->vdi_z0_vector = clfp;
 	vdip->vdi_flags &= ~VF_PER_F_Z0;
     }
@@ -0,0 +1,149 @@
+/*
+ * Vector Network Analyzer Library
+ * Copyright © 2020-2023 D Scott Guthridge <scott_guthridge@rompromity.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "archdep.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include "vnadata_internal.h"
+
+
+/*
+ * _vnadata_find_segment: find the largest index i where f[i] <= frequency
+ *   @frequency_vector: vector of increasing frequencies
+ *   @frequencies: length of frequency_vector
+ *   @frequency: frequency to find
+ *   @hint: index to try first (out of range values ignored)
+ *
+ *   If frequency is below the first entry, return 0.  If frequencies
+ *   is zero, return -1.  Check the hint and the entry after it first
+ *   so that sweeps in increasing order take constant time per lookup;
+ *   otherwise, use interpolation search, falling back to bisection on
+ *   alternate steps to bound the worst case to O(log n).
+ */
+int _vnadata_find_segment(const double *frequency_vector, int frequencies,
+	double frequency, int hint)
+{
+    const double *fv = frequency_vector;
+    int low, high;
+    bool bisect = false;
+
+    if (frequencies <= 0) {
+	return -1;
+    }
+    if (frequency <= fv[0]) {
+	return 0;
+    }
+    if (frequency >= fv[frequencies - 1]) {
+	return frequencies - 1;
+    }
+
+    /*
+     * Try the hint and its successor.
+     */
+    if (hint >= 0 && hint < frequencies - 1) {
+	if (fv[hint] <= frequency) {
+	    if (frequency < fv[hint + 1]) {
+		return hint;
+	    }
+	    if (hint + 2 < frequencies && frequency < fv[hint + 2]) {
+		return hint + 1;
+	    }
+	    low = hint + 1;
+	    high = frequencies - 1;
+	} else {
+	    low = 0;
+	    high = hint;
+	}
+    } else {
+	low = 0;
+	high = frequencies - 1;
+    }
+
+    /*
+     * Maintain the invariant fv[low] <= frequency < fv[high].
+     */
+    while (high - low > 1) {
+	int middle;
+
+	if (bisect) {
+	    middle = low + (high - low) / 2;
+	} else {
+	    middle = low + (int)((frequency - fv[low]) /
+		    (fv[high] - fv[low]) * (high - low));
+	    if (middle <= low) {
+		middle = low + 1;
+	    } else if (middle >= high) {
+		middle = high - 1;
+	    }
+	}
+	bisect = !bisect;
+	if (fv[middle] <= frequency) {
+	    low = middle;
+	} else {
+	    high = middle;
+	}
+    }
+    return low;
+}
+
+/*
+ * vnadata_find_frequency: find the index of a frequency
+ *   @vdp: a pointer to the vnadata_t structure
+ *   @frequency: frequency to find
+ *   @cursor: optional in/out hint (may be NULL)
+ *
+ *   Return the index of the largest frequency less than or equal to
+ *   frequency.  If cursor is non-NULL, the value it points to is used
+ *   as a starting point and is updated with the result, making lookups
+ *   of nearby or increasing frequencies fast.  Frequencies must be in
+ *   increasing order.  Return -1 if frequency is outside of the range
+ *   of frequencies.
+ */
+int vnadata_find_frequency(const vnadata_t *vdp, double frequency,
+	int *cursor)
+{
+    vnadata_internal_t *vdip;
+    int findex;
+
+    if (vdp == NULL) {
+	errno = EINVAL;
+	return -1;
+    }
+    vdip = VDP_TO_VDIP(vdp);
+    if (vdip->vdi_magic != VDI_MAGIC) {
+	errno = EINVAL;
+	return -1;
+    }
+    if (vdp->vd_frequencies == 0 ||
+	    frequency < vdp->vd_frequency_vector[0] ||
+	    frequency > vdp->vd_frequency_vector[vdp->vd_frequencies - 1]) {
+	_vnadata_error(vdip, VNAERR_USAGE,
+		"vnadata_find_frequency: frequency %e out of range",
+		frequency);
+	return -1;
+    }
+    findex = _vnadata_find_segment(vdp->vd_frequency_vector,
+	    vdp->vd_frequencies, frequency,
+	    cursor != NULL ? *cursor : -1);
+    if (cursor != NULL) {
+	*cursor = findex;
+    }
+    return findex;
+}
@@ -22,6 +22,7 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include "vnaerr_internal.h"
+#include "vnamem_internal.h"
 #include "vnadata.h"
 
 /*
@@ -29,6 +30,11 @@
  */
 #define VDI_MAGIC	0x56444930	/* VDI0 */
 
+/*
+ * VNADATA_F_EXTRAPOLATION: factor by which vnadata_resample may extrapolate
+ */
+#define VNADATA_F_EXTRAPOLATION	0.01
+
 /*
  * vdi_flags values: optional feature flags (see vnadata_init)
  */
@@ -134,6 +140,16 @@ typedef struct vnadata_internal {
     /* numeric precision for data values */
     int vdi_dprecision;
 
+    /* allocator for data, frequency, z0 and format storage */
+    vnamem_allocator_t vdi_allocator;
+
+    /* allocator in effect when the structure was created */
+    vnamem_allocator_t vdi_heap;
+
+    /* address and length of the file mapping from vnadata_map */
+    void *vdi_map_address;
+    size_t vdi_map_length;
+
 } vnadata_internal_t;
 
 /*
@@ -164,6 +180,36 @@ extern void _vnadata_set_name_from_dimensions(vnadata_internal_t *vdip);
 extern void _vnadata_set_name_from_filename(vnadata_internal_t *vdip,
 	const char *filename);
 
+/*
+ * _vnadata_malloc, _vnadata_calloc, _vnadata_realloc, _vnadata_free:
+ *	manage storage owned by the vnadata_t structure using its allocator
+ */
+static inline void *_vnadata_malloc(const vnadata_internal_t *vdip,
+	size_t size)
+{
+    return _vnamem_amalloc(&vdip->vdi_allocator, size);
+}
+
+static inline void *_vnadata_calloc(const vnadata_internal_t *vdip,
+	size_t count, size_t size)
+{
+    return _vnamem_acalloc(&vdip->vdi_allocator, count, size);
+}
+
+static inline void *_vnadata_realloc(const vnadata_internal_t *vdip,
+	void *ptr, size_t size)
+{
+    return _vnamem_arealloc(&vdip->vdi_allocator, ptr, size);
+}
+
+static inline void _vnadata_free(const vnadata_internal_t *vdip, void *ptr)
+{
+    _vnamem_afree(&vdip->vdi_allocator, ptr);
+}
+
+/* _vnadata_release_storage: free the data, frequency and z0 storage */
+extern void _vnadata_release_storage(vnadata_internal_t *vdip);
+
 /* _vnadata_extend_p: extend the port allocation for Z0 */
 extern int _vnadata_extend_p(vnadata_internal_t *vdip, int new_p_allocation);
 
@@ -194,6 +240,39 @@ extern vnadata_filetype_t _vnadata_parse_filename(const char *filename,
 extern int _vnadata_set_simple_format(vnadata_internal_t *vdip,
 	vnadata_parameter_type_t type, vnadata_format_t format);
 
+/* _vnadata_find_segment: find the largest index i where f[i] <= frequency */
+extern int _vnadata_find_segment(const double *frequency_vector,
+	int frequencies, double frequency, int hint);
+
+/* npd_scan_state_t: opaque NPD record scanner state */
+typedef struct npd_scan_state npd_scan_state_t;
+
+/* ts_parser_state_t: opaque touchstone record parser state */
+typedef struct ts_parser_state ts_parser_state_t;
+
+/* _vnadata_store_record: store a parsed record at findex */
+extern int _vnadata_store_record(vnadata_internal_t *vdip, int findex,
+	double frequency, const double complex *matrix,
+	const double complex *z0_vector);
+
+/* _vnadata_npd_open: parse the header of a NPD format file */
+extern npd_scan_state_t *_vnadata_npd_open(vnadata_internal_t *vdip,
+	FILE *fp, const char *filename, int *frequencies, bool *fz0);
+
+/* _vnadata_npd_next: parse the next record of a NPD format file */
+extern int _vnadata_npd_next(npd_scan_state_t *nssp, double *frequency,
+	double complex *matrix, double complex *z0_vector);
+
+/* _vnadata_npd_skip: skip the next record, converting only the frequency */
+extern int _vnadata_npd_skip(npd_scan_state_t *nssp, double *frequency);
+
+/* _vnadata_npd_tail: get the offset and width of the unread records */
+extern bool _vnadata_npd_tail(const npd_scan_state_t *nssp, long *offset,
+	int *values);
+
+/* _vnadata_npd_close: free the NPD scanner state */
+extern void _vnadata_npd_close(npd_scan_state_t *nssp);
+
 /* _vnadata_load_npd: load a NPD format file */
 extern int _vnadata_load_npd(vnadata_internal_t *vdip, FILE *fp,
 	const char *filename);
@@ -202,6 +281,58 @@ extern int _vnadata_load_npd(vnadata_internal_t *vdip, FILE *fp,
 extern int _vnadata_load_touchstone(vnadata_internal_t *vdip, FILE *fp,
 	const char *filename);
 
+/* _vnadata_touchstone_open: parse the header of a touchstone file */
+extern ts_parser_state_t *_vnadata_touchstone_open(vnadata_internal_t *vdip,
+	FILE *fp, const char *filename, int *frequencies);
+
+/* _vnadata_touchstone_next: parse the next record of a touchstone file */
+extern int _vnadata_touchstone_next(ts_parser_state_t *tpsp,
+	double *frequency, double complex *matrix);
+
+/* _vnadata_touchstone_skip: skip the next record, converting the frequency */
+extern int _vnadata_touchstone_skip(ts_parser_state_t *tpsp,
+	double *frequency);
+
+/* _vnadata_touchstone_tail: get the offset and width of the unread records */
+extern bool _vnadata_touchstone_tail(const ts_parser_state_t *tpsp,
+	long *offset, int *values, double *multiplier);
+
+/* _vnadata_touchstone_close: free the touchstone parser state */
+extern void _vnadata_touchstone_close(ts_parser_state_t *tpsp);
+
+/* _vnadata_load_npdb: load a binary network parameter data file */
+extern int _vnadata_load_npdb(vnadata_internal_t *vdip, FILE *fp,
+	const char *filename);
+
+/* _vnadata_save_npdb: save in binary network parameter data format */
+extern int _vnadata_save_npdb(vnadata_internal_t *vdip, FILE *fp,
+	const char *filename);
+
+/* _vnadata_probe_npdb: read the header and frequency range of a binary file */
+extern int _vnadata_probe_npdb(vnadata_internal_t *vdip, FILE *fp,
+	const char *filename, int *frequencies, double *fmin, double *fmax,
+	bool *fz0);
+
+/* npdb_stream_t: opaque binary network parameter data writer state */
+typedef struct npdb_stream npdb_stream_t;
+
+/* _vnadata_npdb_stream_open: write the header of a streamed binary file */
+extern npdb_stream_t *_vnadata_npdb_stream_open(vnadata_internal_t *vdip,
+	FILE *fp, const char *filename, int capacity, bool per_f_z0);
+
+/* _vnadata_npdb_stream_append: append one frequency to a streamed file */
+extern int _vnadata_npdb_stream_append(npdb_stream_t *nsp, double frequency,
+	const double complex *matrix, const double complex *z0_vector);
+
+/* _vnadata_npdb_stream_flush: bring a streamed binary file up to date */
+extern int _vnadata_npdb_stream_flush(npdb_stream_t *nsp);
+
+/* _vnadata_npdb_stream_close: free the stream state */
+extern void _vnadata_npdb_stream_close(npdb_stream_t *nsp);
+
+/* _vnadata_unmap: release the file mapping of a vnadata_t structure */
+extern void _vnadata_unmap(vnadata_internal_t *vdip);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
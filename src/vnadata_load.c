@@ -26,6 +26,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include "vnadata_internal.h"
+#include "vnastats_internal.h"
 
 /*
  * _vnadata_set_name_from_filename: provide a default name from filename
@@ -65,6 +66,43 @@ void _vnadata_set_name_from_filename(vnadata_internal_t *vdip,
     }
 }
 
+/*
+ * _vnadata_store_record: store a parsed record at findex
+ *   @vdip: internal parameter matrix
+ *   @findex: frequency index; if past the end, add a frequency
+ *   @frequency: frequency of the record
+ *   @matrix: serialized matrix of the record
+ *   @z0_vector: per-frequency reference impedances, or NULL
+ */
+int _vnadata_store_record(vnadata_internal_t *vdip, int findex,
+	double frequency, const double complex *matrix,
+	const double complex *z0_vector)
+{
+    vnadata_t *vdp = &vdip->vdi_vd;
+    const int cells = vdp->vd_rows * vdp->vd_columns;
+
+    if (findex >= vdp->vd_frequencies) {
+	if (vnadata_add_frequency(vdp, frequency) == -1) {
+	    _vnadata_error(vdip, VNAERR_SYSTEM,
+		    "realloc: %s", strerror(errno));
+	    return -1;
+	}
+    } else {
+	vdp->vd_frequency_vector[findex] = frequency;
+    }
+    for (int cell = 0; cell < cells; ++cell) {
+	*_vnadata_cell_address(vdp, findex, cell) = matrix[cell];
+    }
+    if (z0_vector != NULL) {
+	if (vnadata_set_fz0_vector(vdp, findex, z0_vector) == -1) {
+	    _vnadata_error(vdip, VNAERR_SYSTEM,
+		    "vnadata_set_fz0_vector: %s", strerror(errno));
+	    return -1;
+	}
+    }
+    return 0;
+}
+
 /*
  * vnadata_load_common: load network parameters from a file
  *   @vdip:   internal parameter matrix
@@ -120,6 +158,15 @@ static int vnadata_load_common(vnadata_internal_t *vdip,
 	}
 	break;
 
+    case VNADATA_FILETYPE_NPDB:
+	/*
+	 * Load binary NPD format.
+	 */
+	if (_vnadata_load_npdb(vdip, fp, filename) == -1) {
+	    return -1;
+	}
+	break;
+
     default:
 	abort();
 	/*NOTREACHED*/
@@ -135,7 +182,9 @@ static int vnadata_load_common(vnadata_internal_t *vdip,
  */
 int vnadata_load(vnadata_t *vdp, const char *filename)
 {
+    uint64_t start = _VNASTATS_NOW();
     vnadata_internal_t *vdip;
+    vnadata_filetype_t filetype;
     FILE *fp;
     int rv;
 
@@ -148,13 +197,19 @@ int vnadata_load(vnadata_t *vdp, const char *filename)
 	errno = EINVAL;
 	return -1;
     }
-    if ((fp = fopen(filename, "r")) == NULL) {
+    if ((filetype = _vnadata_parse_filename(filename,
+		    NULL)) == VNADATA_FILETYPE_AUTO) {
+	filetype = vdip->vdi_filetype;
+    }
+    if ((fp = fopen(filename, filetype == VNADATA_FILETYPE_NPDB ?
+		    "rb" : "r")) == NULL) {
 	_vnadata_error(vdip, VNAERR_SYSTEM,
 		"fopen: %s: %s", filename, strerror(errno));
 	return -1;
     }
     rv = vnadata_load_common(vdip, fp, filename);
     (void)fclose(fp);
+    _VNASTATS_TIME(_vnadata_stats, vds_load_calls, vds_load_ns, start);
     if (rv == -1) {
 	return -1;
     }
@@ -169,7 +224,9 @@ int vnadata_load(vnadata_t *vdp, const char *filename)
  */
 int vnadata_fload(vnadata_t *vdp, FILE *fp, const char *filename)
 {
+    uint64_t start = _VNASTATS_NOW();
     vnadata_internal_t *vdip;
+    int rv;
 
     if (vdp == NULL) {
 	errno = EINVAL;
@@ -180,7 +237,9 @@ int vnadata_fload(vnadata_t *vdp, FILE *fp, const char *filename)
 	errno = EINVAL;
 	return -1;
     }
-    if (vnadata_load_common(vdip, fp, filename) == -1) {
+    rv = vnadata_load_common(vdip, fp, filename);
+    _VNASTATS_TIME(_vnadata_stats, vds_load_calls, vds_load_ns, start);
+    if (rv == -1) {
 	return -1;
     }
     return 0;
@@ -27,6 +27,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include "vnadata_internal.h"
+#include "vnastats_internal.h"
 
 
 /*
@@ -49,13 +50,14 @@ typedef enum npd_record_type {
 /*
  * npd_scan_state_t: scanner state
  */
-typedef struct npd_scan_state {
+struct npd_scan_state {
     vnadata_internal_t	       *nss_vdip;
     FILE		       *nss_fp;
     const char		       *nss_filename;
     bool			nss_start_of_line;
     int				nss_line;
     int				nss_char;
+    uint64_t			nss_bytes;	/* characters read */
     npd_record_type_t		nss_record_type;
     size_t			nss_text_size;
     size_t			nss_text_allocation;
@@ -63,14 +65,30 @@ typedef struct npd_scan_state {
     size_t			nss_field_allocation;
     char		       *nss_text;
     int		               *nss_fields;
-} npd_scan_state_t;
+    int				nss_ports;
+    int				nss_frequencies;
+    bool			nss_fz0;
+    int				nss_n_fields;
+    int				nss_best_field;
+    int				nss_drows;
+    int				nss_dcolumns;
+    vnadata_format_t		nss_format;
+    int				nss_findex;
+    vnamem_allocator_t		nss_allocator;	/* holds the state */
+};
 
 /*
  * GET_CHAR: read the next character
  *   @nssp: scanner state
  */
+#ifdef ENABLE_STATS
+#define GET_CHAR(nssp)	\
+	((nssp)->nss_char = getc((nssp)->nss_fp), \
+	 (void)((nssp)->nss_bytes += (nssp)->nss_char != EOF))
+#else
 #define GET_CHAR(nssp)	\
 	((nssp)->nss_char = getc((nssp)->nss_fp))
+#endif
 
 /*
  * FIELD: get the field at the specified index
@@ -93,7 +111,8 @@ static int add_char(npd_scan_state_t *nssp, char c)
 	size_t new_allocation = MAX(81, 2 * nssp->nss_text_allocation);
 	char *cp;
 
-	if ((cp = realloc(nssp->nss_text, new_allocation)) == NULL) {
+	if ((cp = _vnamem_arealloc(&nssp->nss_allocator, nssp->nss_text,
+			new_allocation)) == NULL) {
 	    _vnadata_error(vdip, VNAERR_SYSTEM,
 		    "realloc: %s", strerror(errno));
 	    return -1;
@@ -117,7 +136,8 @@ static int start_field(npd_scan_state_t *nssp)
 	size_t new_allocation = MAX(9, 2 * nssp->nss_field_allocation);
 	int *ip;
 
-	ip = realloc(nssp->nss_fields, new_allocation * sizeof(int));
+	ip = _vnamem_arealloc(&nssp->nss_allocator, nssp->nss_fields,
+		new_allocation * sizeof(int));
 	if (ip == NULL) {
 	    _vnadata_error(vdip, VNAERR_SYSTEM,
 		    "realloc: %s", strerror(errno));
@@ -396,21 +416,42 @@ static int expect_nnint_arg(npd_scan_state_t *nssp, int *value)
 }
 
 /*
- * _vnadata_load_npd: load matrix data in libvna NPD format
- *   @vdp: a pointer to the vnadata_t structure
+ * _vnadata_npd_close: free the NPD scanner state
+ *   @nssp: scanner state
+ */
+void _vnadata_npd_close(npd_scan_state_t *nssp)
+{
+    if (nssp != NULL) {
+	vnamem_allocator_t allocator = nssp->nss_allocator;
+
+	_VNASTATS_ADD(_vnadata_stats, vds_load_bytes, nssp->nss_bytes);
+	_vnamem_afree(&allocator, (void *)nssp->nss_fields);
+	_vnamem_afree(&allocator, (void *)nssp->nss_text);
+	_vnamem_afree(&allocator, (void *)nssp);
+    }
+}
+
+/*
+ * _vnadata_npd_open: parse the header of a NPD format file
+ *   @vdip: internal parameter matrix
  *   @fp: file pointer
- *   @filename: filename used in error messages and to intuit the file type
- *   @type: convert parameters to this type (any if VPT_UNDEF)
+ *   @filename: filename used in error messages
+ *   @frequencies: address to receive the number of records
+ *   @fz0: address to receive true if records have per-frequency z0
+ *
+ *   Initialize vdip with the best parameter type found in the file,
+ *   its dimensions, the reference impedances and the format.  Return
+ *   a scanner state for reading the records with _vnadata_npd_next,
+ *   or NULL on error.
  */
-int _vnadata_load_npd(vnadata_internal_t *vdip, FILE *fp, const char *filename)
+npd_scan_state_t *_vnadata_npd_open(vnadata_internal_t *vdip, FILE *fp,
+	const char *filename, int *frequencies, bool *fz0)
 {
     vnadata_t *vdp = &vdip->vdi_vd;
-    npd_scan_state_t nss;
+    npd_scan_state_t *nssp;
     int rows = -1;
     int columns = -1;
     int ports = -1;
-    int frequencies = -1;
-    int rv = -1;
     int n_fields = 1;
     int best_quality = 0;
     int best_field = -1;
@@ -418,43 +459,52 @@ int _vnadata_load_npd(vnadata_internal_t *vdip, FILE *fp, const char *filename)
     int best_dcolumns = -1;
     vnadata_parameter_type_t best_type = VPT_UNDEF;
     int parameter_line = -1;
-    bool fz0 = false;
     double complex *z0_vector = NULL;
     const vnadata_format_descriptor_t *best_vfdp = NULL;
+    vnamem_allocator_t allocator;
 
-    (void)memset((void *)&nss, 0, sizeof(nss));
-    nss.nss_vdip		= vdip;
-    nss.nss_fp			= fp;
-    nss.nss_filename		= filename;
-    nss.nss_start_of_line	= true;
-    nss.nss_line		= 0;
-    nss.nss_char		= '\n';
-    nss.nss_text_size		= 0;
-    nss.nss_text_allocation	= 0;
-    nss.nss_field_count		= 0;
-    nss.nss_field_allocation	= 0;
-    nss.nss_text		= NULL;
-    nss.nss_fields		= NULL;
-    if (scan_line(&nss) == -1) {
+    vnamem_get_allocator(&allocator);
+    if ((nssp = _vnamem_acalloc(&allocator, 1,
+		    sizeof(npd_scan_state_t))) == NULL) {
+	_vnadata_error(vdip, VNAERR_SYSTEM,
+		"calloc: %s", strerror(errno));
+	return NULL;
+    }
+    nssp->nss_allocator		= allocator;
+    nssp->nss_vdip		= vdip;
+    nssp->nss_fp		= fp;
+    nssp->nss_filename		= filename;
+    nssp->nss_start_of_line	= true;
+    nssp->nss_line		= 0;
+    nssp->nss_char		= '\n';
+    nssp->nss_text_size		= 0;
+    nssp->nss_text_allocation	= 0;
+    nssp->nss_field_count	= 0;
+    nssp->nss_field_allocation	= 0;
+    nssp->nss_text		= NULL;
+    nssp->nss_fields		= NULL;
+    nssp->nss_frequencies	= -1;
+    nssp->nss_fz0		= false;
+    if (scan_line(nssp) == -1) {
 	goto out;
     }
     for (;;) {
-	switch (nss.nss_record_type) {
+	switch (nssp->nss_record_type) {
 	case T_KVERSION:
-	    if (nss.nss_field_count < 2) {
+	    if (nssp->nss_field_count < 2) {
 		_vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
 			"argument expected after %s",
-			nss.nss_filename, nss.nss_line,
-			FIELD(&nss, 0));
+			nssp->nss_filename, nssp->nss_line,
+			FIELD(nssp, 0));
 		goto out;
 	    }
-	    if (strcmp(FIELD(&nss, 1), "1.0") != 0) {
+	    if (strcmp(FIELD(nssp, 1), "1.0") != 0) {
 		_vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
 			"unsupported version %s",
-			nss.nss_filename, nss.nss_line, FIELD(&nss, 0));
+			nssp->nss_filename, nssp->nss_line, FIELD(nssp, 0));
 		goto out;
 	    }
-	    if (scan_line(&nss) == -1) {
+	    if (scan_line(nssp) == -1) {
 		goto out;
 	    }
 	    continue;
@@ -462,57 +512,58 @@ int _vnadata_load_npd(vnadata_internal_t *vdip, FILE *fp, const char *filename)
 	case T_KPORTS:
 	    if (ports != -1) {
 		_vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
-			"redundant ports line", nss.nss_filename, nss.nss_line);
+			"redundant ports line",
+			nssp->nss_filename, nssp->nss_line);
 		goto out;
 	    }
-	    if (expect_nnint_arg(&nss, &ports) == -1) {
+	    if (expect_nnint_arg(nssp, &ports) == -1) {
 		goto out;
 	    }
-	    if (scan_line(&nss) == -1) {
+	    if (scan_line(nssp) == -1) {
 		goto out;
 	    }
 	    continue;
 
 	case T_KROWS:
-	    if (expect_nnint_arg(&nss, &rows) == -1) {
+	    if (expect_nnint_arg(nssp, &rows) == -1) {
 		goto out;
 	    }
-	    if (scan_line(&nss) == -1) {
+	    if (scan_line(nssp) == -1) {
 		goto out;
 	    }
 	    continue;
 
 	case T_KCOLUMNS:
-	    if (expect_nnint_arg(&nss, &columns) == -1) {
+	    if (expect_nnint_arg(nssp, &columns) == -1) {
 		goto out;
 	    }
-	    if (scan_line(&nss) == -1) {
+	    if (scan_line(nssp) == -1) {
 		goto out;
 	    }
 	    continue;
 
 	case T_KFREQUENCIES:
-	    if (expect_nnint_arg(&nss, &frequencies) == -1) {
+	    if (expect_nnint_arg(nssp, &nssp->nss_frequencies) == -1) {
 		goto out;
 	    }
-	    if (scan_line(&nss) == -1) {
+	    if (scan_line(nssp) == -1) {
 		goto out;
 	    }
 	    continue;
 
 	case T_KPARAMETERS:
-	    if (nss.nss_field_count != 2) {
+	    if (nssp->nss_field_count != 2) {
 		_vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
 			"at least one argument expected after %s",
-			nss.nss_filename, nss.nss_line,
-			FIELD(&nss, 0));
+			nssp->nss_filename, nssp->nss_line,
+			FIELD(nssp, 0));
 		goto out;
 	    }
-	    if (vnadata_set_format(vdp, FIELD(&nss, 1)) == -1) {
+	    if (vnadata_set_format(vdp, FIELD(nssp, 1)) == -1) {
 		goto out;
 	    }
-	    parameter_line = nss.nss_line;
-	    if (scan_line(&nss) == -1) {
+	    parameter_line = nssp->nss_line;
+	    if (scan_line(nssp) == -1) {
 		goto out;
 	    }
 	    continue;
@@ -521,20 +572,20 @@ int _vnadata_load_npd(vnadata_internal_t *vdip, FILE *fp, const char *filename)
 	    {
 		int temp;
 
-		if (expect_nnint_arg(&nss, &temp) == -1) {
+		if (expect_nnint_arg(nssp, &temp) == -1) {
 		    goto out;
 		}
 		if (temp > VNADATA_MAX_PRECISION) {
 		    _vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
 			    "%s may not exceed %d",
-			    nss.nss_filename, nss.nss_line,
-			    FIELD(&nss, 0),
+			    nssp->nss_filename, nssp->nss_line,
+			    FIELD(nssp, 0),
 			    VNADATA_MAX_PRECISION);
 		    goto out;
 		}
 		vdip->vdi_fprecision = temp;
 	    }
-	    if (scan_line(&nss) == -1) {
+	    if (scan_line(nssp) == -1) {
 		goto out;
 	    }
 	    continue;
@@ -543,20 +594,20 @@ int _vnadata_load_npd(vnadata_internal_t *vdip, FILE *fp, const char *filename)
 	    {
 		int temp;
 
-		if (expect_nnint_arg(&nss, &temp) == -1) {
+		if (expect_nnint_arg(nssp, &temp) == -1) {
 		    goto out;
 		}
 		if (temp > VNADATA_MAX_PRECISION) {
 		    _vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
 			    "%s may not exceed %d",
-			    nss.nss_filename, nss.nss_line,
-			    FIELD(&nss, 0),
+			    nssp->nss_filename, nssp->nss_line,
+			    FIELD(nssp, 0),
 			    VNADATA_MAX_PRECISION);
 		    goto out;
 		}
 		vdip->vdi_dprecision = temp;
 	    }
-	    if (scan_line(&nss) == -1) {
+	    if (scan_line(nssp) == -1) {
 		goto out;
 	    }
 	    continue;
@@ -568,7 +619,7 @@ int _vnadata_load_npd(vnadata_internal_t *vdip, FILE *fp, const char *filename)
 		    if (rows != columns) {
 			_vnadata_error(vdip, VNAERR_SYNTAX,
 				"%s (line %d) error: rows and columns must be "
-				"equal", nss.nss_filename, nss.nss_line);
+				"equal", nssp->nss_filename, nssp->nss_line);
 			goto out;
 		    }
 		    ports = columns;
@@ -577,26 +628,26 @@ int _vnadata_load_npd(vnadata_internal_t *vdip, FILE *fp, const char *filename)
 	    if (ports < 0) {
 		_vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
 			"ports must come before #:z0",
-			nss.nss_filename, nss.nss_line);
+			nssp->nss_filename, nssp->nss_line);
 		goto out;
 	    }
-	    if (nss.nss_field_count == 2 &&
-		    strcasecmp(FIELD(&nss, 1), "PER-FREQUENCY") == 0) {
-		fz0 = true;
-		if (scan_line(&nss) == -1) {
+	    if (nssp->nss_field_count == 2 &&
+		    strcasecmp(FIELD(nssp, 1), "PER-FREQUENCY") == 0) {
+		nssp->nss_fz0 = true;
+		if (scan_line(nssp) == -1) {
 		    goto out;
 		}
 		continue;
 	    }
-	    if (nss.nss_field_count != 1 + 2 * ports) {
+	    if (nssp->nss_field_count != 1 + 2 * ports) {
 		_vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
 			"expected %d fields after z0",
-			nss.nss_filename, nss.nss_line,
+			nssp->nss_filename, nssp->nss_line,
 			2 * ports);
 		goto out;
 	    }
 	    if (z0_vector == NULL) {
-		if ((z0_vector = calloc(ports,
+		if ((z0_vector = _vnamem_calloc(ports,
 				sizeof(double complex))) == NULL) {
 		    _vnadata_error(vdip, VNAERR_SYSTEM,
 			    "calloc: %s", strerror(errno));
@@ -607,28 +658,28 @@ int _vnadata_load_npd(vnadata_internal_t *vdip, FILE *fp, const char *filename)
 		double re = 0.0, im = 0.0;
 		char *cp;
 
-		if (!convert_double(FIELD(&nss, 1 + 2 * port), &re)) {
+		if (!convert_double(FIELD(nssp, 1 + 2 * port), &re)) {
 		    _vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
 			    "%s: expected a numeric argument",
-			    nss.nss_filename, nss.nss_line,
-			    FIELD(&nss, 1 + 2 * port));
+			    nssp->nss_filename, nssp->nss_line,
+			    FIELD(nssp, 1 + 2 * port));
 		    goto out;
 		}
-		if ((cp = strrchr(FIELD(&nss, 2 + 2 * port), 'j')) != NULL) {
+		if ((cp = strrchr(FIELD(nssp, 2 + 2 * port), 'j')) != NULL) {
 		    if (cp[1] == '\000') {
 			*cp = '\000';
 		    }
 		}
-		if (!convert_double(FIELD(&nss, 2 + 2 * port), &im)) {
+		if (!convert_double(FIELD(nssp, 2 + 2 * port), &im)) {
 		    _vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
 			    "%s: expected a numeric argument",
-			    nss.nss_filename, nss.nss_line,
-			    FIELD(&nss, 2 + 2 * port));
+			    nssp->nss_filename, nssp->nss_line,
+			    FIELD(nssp, 2 + 2 * port));
 		    goto out;
 		}
 		z0_vector[port] = re + I * im;
 	    }
-	    if (scan_line(&nss) == -1) {
+	    if (scan_line(nssp) == -1) {
 		goto out;
 	    }
 	    continue;
@@ -644,7 +695,7 @@ int _vnadata_load_npd(vnadata_internal_t *vdip, FILE *fp, const char *filename)
 	    if (rows != columns) {
 		_vnadata_error(vdip, VNAERR_SYNTAX,
 			"%s (line %d) error: rows and columns must be "
-			"equal", nss.nss_filename, nss.nss_line);
+			"equal", nssp->nss_filename, nssp->nss_line);
 		goto out;
 	    }
 	    ports = columns;
@@ -653,19 +704,19 @@ int _vnadata_load_npd(vnadata_internal_t *vdip, FILE *fp, const char *filename)
     if (ports < 0) {
 	_vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
 		"required keyword #:ports missing",
-		nss.nss_filename, nss.nss_line);
+		nssp->nss_filename, nssp->nss_line);
 	goto out;
     }
-    if (frequencies < 0) {
+    if (nssp->nss_frequencies < 0) {
 	_vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
 		"required keyword #:frequencies missing",
-		nss.nss_filename, nss.nss_line);
+		nssp->nss_filename, nssp->nss_line);
 	goto out;
     }
     if (parameter_line == -1) {
 	_vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
 		"required keyword #:parameters missing",
-		nss.nss_filename, nss.nss_line);
+		nssp->nss_filename, nssp->nss_line);
 	goto out;
     }
 
@@ -673,7 +724,7 @@ int _vnadata_load_npd(vnadata_internal_t *vdip, FILE *fp, const char *filename)
      * If the reference impedances are frequency-dependent, add in the
      * Z0 fields.
      */
-    if (fz0) {
+    if (nssp->nss_fz0) {
 	n_fields += 2 * ports;
     }
 
@@ -697,7 +748,7 @@ int _vnadata_load_npd(vnadata_internal_t *vdip, FILE *fp, const char *filename)
 	case VPT_UNDEF:
 	    _vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
 		    "%s parameter with no type",
-		    nss.nss_filename, parameter_line,
+		    nssp->nss_filename, parameter_line,
 		    vnadata_get_type_name(vfdp->vfd_parameter));
 	    goto out;
 
@@ -727,7 +778,7 @@ int _vnadata_load_npd(vnadata_internal_t *vdip, FILE *fp, const char *filename)
 	    if (ports != 2) {
 		_vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
 			"%s parameters require a 2x2 matrix",
-			nss.nss_filename, nss.nss_line,
+			nssp->nss_filename, nssp->nss_line,
 			_vnadata_format_to_name(vfdp));
 		goto out;
 	    }
@@ -796,7 +847,7 @@ int _vnadata_load_npd(vnadata_internal_t *vdip, FILE *fp, const char *filename)
     if (best_vfdp == NULL) {
 	_vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
 		"file contains no parameter we can load",
-		nss.nss_filename, nss.nss_line);
+		nssp->nss_filename, nssp->nss_line);
 	goto out;
     }
 
@@ -804,10 +855,8 @@ int _vnadata_load_npd(vnadata_internal_t *vdip, FILE *fp, const char *filename)
      * Set-up the output matrix.
      */
     if (vnadata_init(vdp, best_type, best_drows, best_dcolumns,
-		frequencies) == -1) {
+		nssp->nss_frequencies) == -1) {
 	goto out;
-	_vnadata_error(vdip, VNAERR_SYSTEM,
-		"vnadata_init: %s", strerror(errno));
     }
     if (z0_vector != NULL) {
 	if (vnadata_set_z0_vector(vdp, z0_vector) == -1) {
@@ -815,152 +864,280 @@ int _vnadata_load_npd(vnadata_internal_t *vdip, FILE *fp, const char *filename)
 		    "vnadata_set_z0_vector: %s", strerror(errno));
 	    goto out;
 	}
-    } else if (fz0) {
-	if ((z0_vector = calloc(ports, sizeof(double complex))) == NULL) {
-	    _vnadata_error(vdip, VNAERR_SYSTEM,
-		    "calloc: %s", strerror(errno));
-	    goto out;
-	}
+	_vnamem_free((void *)z0_vector);
     }
+    nssp->nss_ports	= ports;
+    nssp->nss_n_fields	= n_fields;
+    nssp->nss_best_field	= best_field;
+    nssp->nss_drows	= best_drows;
+    nssp->nss_dcolumns	= best_dcolumns;
+    nssp->nss_format	= best_vfdp->vfd_format;
+    *frequencies = nssp->nss_frequencies;
+    *fz0 = nssp->nss_fz0;
+    return nssp;
 
-    /*
-     * For each frequency, process a data line.
-     */
-    for (int findex = 0; findex < frequencies; ++findex) {
-	double f;
+out:
+    _vnamem_free((void *)z0_vector);
+    _vnadata_npd_close(nssp);
+    return NULL;
+}
+
+/*
+ * _vnadata_npd_next: parse the next data line of a NPD format file
+ *   @nssp: scanner state
+ *   @frequency: address to receive the frequency
+ *   @matrix: serialized matrix to receive the data
+ *   @z0_vector: vector to receive the per-frequency z0 values (if fz0)
+ *
+ *   Return 1 if a record was parsed, 0 at the end of the file, or
+ *   -1 on error.
+ */
+int _vnadata_npd_next(npd_scan_state_t *nssp, double *frequency,
+	double complex *matrix, double complex *z0_vector)
+{
+    vnadata_internal_t *vdip = nssp->nss_vdip;
+    const int findex = nssp->nss_findex;
+    const int ports = nssp->nss_ports;
+    const int best_field = nssp->nss_best_field;
+    double f;
 
-	if (nss.nss_record_type != T_DATA) {
-	    if (nss.nss_record_type == T_EOF) {
+    if (findex >= nssp->nss_frequencies) {
+	if (nssp->nss_record_type != T_EOF) {
+	    _vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
+		    "extra lines at end of input",
+		    nssp->nss_filename, nssp->nss_line);
+	    return -1;
+	}
+	return 0;
+    }
+    if (nssp->nss_record_type != T_DATA) {
+	if (nssp->nss_record_type == T_EOF) {
+	    _vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
+		    "expected %d data lines; found only %d",
+		    nssp->nss_filename, nssp->nss_line,
+		    nssp->nss_frequencies, findex + 1);
+	    return -1;
+	}
+	_vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
+		"expected a data line: found %s",
+		nssp->nss_filename, nssp->nss_line,
+		FIELD(nssp, 0));
+	return -1;
+    }
+    if (nssp->nss_field_count != nssp->nss_n_fields) {
+	_vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
+		"expected %d fields; found %d",
+		nssp->nss_filename, nssp->nss_line,
+		nssp->nss_n_fields, (int)nssp->nss_field_count);
+	return -1;
+    }
+    if (!convert_double(FIELD(nssp, 0), &f)) {
+	_vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
+		"%s: number expected",
+		nssp->nss_filename, nssp->nss_line,
+		FIELD(nssp, 0));
+	return -1;
+    }
+    *frequency = f;
+    if (nssp->nss_fz0) {
+	for (int port = 0; port < ports; ++port) {
+	    double re, im;
+
+	    if (!convert_double(FIELD(nssp, 1 + 2 * port), &re)) {
 		_vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
-			"expected %d data lines; found only %d",
-			nss.nss_filename, nss.nss_line,
-			frequencies, findex + 1);
-		goto out;
+			"%s: number expected",
+			nssp->nss_filename, nssp->nss_line,
+			FIELD(nssp, 1 + 2 * port));
+		return -1;
 	    }
-	    _vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
-		    "expected a data line: found %s",
-		    nss.nss_filename, nss.nss_line,
-		    FIELD(&nss, 0));
-	    goto out;
+	    if (!convert_double(FIELD(nssp, 2 + 2 * port), &im)) {
+		_vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
+			"%s: number expected",
+			nssp->nss_filename, nssp->nss_line,
+			FIELD(nssp, 2 + 2 * port));
+		return -1;
+	    }
+	    z0_vector[port] = re + I * im;
 	}
-	if (nss.nss_field_count != n_fields) {
+    }
+    for (int cell = 0; cell < nssp->nss_drows * nssp->nss_dcolumns; ++cell) {
+	double v1, v2;
+	double complex value;
+
+	if (!convert_double(FIELD(nssp, best_field + 2 * cell), &v1)) {
 	    _vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
-		    "expected %d fields; found %d",
-		    nss.nss_filename, nss.nss_line,
-		    n_fields, (int)nss.nss_field_count);
-	    goto out;
+		    "%s: number expected",
+		    nssp->nss_filename, nssp->nss_line,
+		    FIELD(nssp, best_field + cell));
+	    return -1;
 	}
-	if (!convert_double(FIELD(&nss, 0), &f)) {
+	if (!convert_double(FIELD(nssp, best_field + 2 * cell + 1), &v2)) {
 	    _vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
 		    "%s: number expected",
-		    nss.nss_filename, nss.nss_line,
-		    FIELD(&nss, 0));
-	    goto out;
+		    nssp->nss_filename, nssp->nss_line,
+		    FIELD(nssp, best_field + cell + 1));
+	    return -1;
 	}
-	if (vnadata_set_frequency(vdp, findex, f) == -1) {
-	    _vnadata_error(vdip, VNAERR_SYSTEM,
-		    "vnadata_set_frequency: %s", strerror(errno));
-	    goto out;
+	switch (nssp->nss_format) {
+	case VNADATA_FORMAT_DB_ANGLE:
+	    value = pow(10.0, v1 / 20.0) * cexp(I * M_PI / 180.0 * v2);
+	    break;
+
+	case VNADATA_FORMAT_MAG_ANGLE:
+	    value = v1 * cexp(I * M_PI / 180.0 * v2);
+	    break;
+
+	case VNADATA_FORMAT_REAL_IMAG:
+	    value = v1 + I * v2;
+	    break;
+
+	case VNADATA_FORMAT_PRC:
+	    value = 1.0 / (1.0 / v1 + 2.0 * M_PI * I * f * v2);
+	    break;
+
+	case VNADATA_FORMAT_PRL:
+	    value = v1 / (1.0 - I * v1 / (2.0 * M_PI * f * v2));
+	    break;
+
+	case VNADATA_FORMAT_SRC:
+	    value = v1 - I / (2.0 * M_PI * f * v2);
+	    break;
+
+	case VNADATA_FORMAT_SRL:
+	    value = v1 + 2.0 * M_PI * I * f * v2;
+	    break;
+
+	default:
+	    abort();
+	    /*NOTREACHED*/
 	}
-	if (fz0) {
-	    for (int port = 0; port < ports; ++port) {
-		double re, im;
+	matrix[cell] = value;
+    }
+    if (scan_line(nssp) == -1) {
+	return -1;
+    }
+    ++nssp->nss_findex;
+    return 1;
+}
 
-		if (!convert_double(FIELD(&nss, 1 + 2 * port), &re)) {
-		    _vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
-			    "%s: number expected",
-			    nss.nss_filename, nss.nss_line,
-			    FIELD(&nss, 1 + 2 * port));
-		    goto out;
-		}
-		if (!convert_double(FIELD(&nss, 2 + 2 * port), &im)) {
-		    _vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
-			    "%s: number expected",
-			    nss.nss_filename, nss.nss_line,
-			    FIELD(&nss, 2 + 2 * port));
-		    goto out;
-		}
-		z0_vector[port] = re + I * im;
-	    }
-	    if (vnadata_set_fz0_vector(vdp, findex, z0_vector) == -1) {
-		_vnadata_error(vdip, VNAERR_SYSTEM,
-			"vnadata_set_fz0_vector: %s", strerror(errno));
-		goto out;
-	    }
+/*
+ * _vnadata_npd_skip: skip the next data line of a NPD format file
+ *   @nssp: scanner state
+ *   @frequency: address to receive the frequency
+ *
+ *   Like _vnadata_npd_next, but convert only the frequency.  Return 1
+ *   if a record was skipped, 0 at the end of the file, or -1 on error.
+ */
+int _vnadata_npd_skip(npd_scan_state_t *nssp, double *frequency)
+{
+    vnadata_internal_t *vdip = nssp->nss_vdip;
+
+    if (nssp->nss_findex >= nssp->nss_frequencies) {
+	return 0;
+    }
+    if (nssp->nss_record_type != T_DATA) {
+	_vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
+		"expected %d data lines; found only %d",
+		nssp->nss_filename, nssp->nss_line,
+		nssp->nss_frequencies, nssp->nss_findex);
+	return -1;
+    }
+    if (nssp->nss_field_count != nssp->nss_n_fields) {
+	_vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
+		"expected %d fields; found %d",
+		nssp->nss_filename, nssp->nss_line,
+		nssp->nss_n_fields, (int)nssp->nss_field_count);
+	return -1;
+    }
+    if (!convert_double(FIELD(nssp, 0), frequency)) {
+	_vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
+		"%s: number expected",
+		nssp->nss_filename, nssp->nss_line,
+		FIELD(nssp, 0));
+	return -1;
+    }
+    if (scan_line(nssp) == -1) {
+	return -1;
+    }
+    ++nssp->nss_findex;
+    return 1;
+}
+
+/*
+ * _vnadata_npd_tail: describe the unread records for a seek
+ *   @nssp: scanner state
+ *   @offset: address to receive the file offset of the unread input
+ *   @values: address to receive the number of fields per record
+ *
+ *   Return true if the input after *offset is known to hold at least
+ *   one whole data line, so that the caller can find the last
+ *   frequency by reading back from the end of the file.
+ */
+bool _vnadata_npd_tail(const npd_scan_state_t *nssp, long *offset,
+	int *values)
+{
+    long position;
+
+    if (nssp->nss_frequencies - nssp->nss_findex < 2 ||
+	    !nssp->nss_start_of_line) {
+	return false;
+    }
+    if ((position = ftell(nssp->nss_fp)) == -1) {
+	return false;
+    }
+    *offset = position;
+    *values = nssp->nss_n_fields;
+    return true;
+}
+
+/*
+ * _vnadata_load_npd: load matrix data in libvna NPD format
+ *   @vdp: a pointer to the vnadata_t structure
+ *   @fp: file pointer
+ *   @filename: filename used in error messages and to intuit the file type
+ */
+int _vnadata_load_npd(vnadata_internal_t *vdip, FILE *fp, const char *filename)
+{
+    vnadata_t *vdp = &vdip->vdi_vd;
+    npd_scan_state_t *nssp;
+    double complex *matrix = NULL;
+    double complex *z0_vector = NULL;
+    int frequencies;
+    bool fz0;
+    int rv = -1;
+
+    if ((nssp = _vnadata_npd_open(vdip, fp, filename,
+		    &frequencies, &fz0)) == NULL) {
+	return -1;
+    }
+    if ((matrix = _vnamem_calloc(MAX(1, vdp->vd_rows * vdp->vd_columns),
+		    sizeof(double complex))) == NULL ||
+	    (z0_vector = _vnamem_calloc(MAX(1, nssp->nss_ports),
+		    sizeof(double complex))) == NULL) {
+	_vnadata_error(vdip, VNAERR_SYSTEM,
+		"calloc: %s", strerror(errno));
+	goto out;
+    }
+    for (int findex = 0; ; ++findex) {
+	double f;
+	int rc;
+
+	if ((rc = _vnadata_npd_next(nssp, &f, matrix, z0_vector)) == -1) {
+	    goto out;
 	}
-	for (int row = 0; row < best_drows; ++row) {
-	    for (int column = 0; column < best_dcolumns; ++column) {
-		int cell = row * best_dcolumns + column;
-		double v1, v2;
-		double complex value;
-
-		if (!convert_double(FIELD(&nss,
-				best_field + 2 * cell), &v1)) {
-		    _vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
-			    "%s: number expected",
-			    nss.nss_filename, nss.nss_line,
-			    FIELD(&nss, best_field + cell));
-		    goto out;
-		}
-		if (!convert_double(FIELD(&nss,
-				best_field + 2 * cell + 1), &v2)) {
-		    _vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
-			    "%s: number expected",
-			    nss.nss_filename, nss.nss_line,
-			    FIELD(&nss, best_field + cell + 1));
-		    goto out;
-		}
-		switch (best_vfdp->vfd_format) {
-		case VNADATA_FORMAT_DB_ANGLE:
-		    value = pow(10.0, v1 / 20.0) * cexp(I * M_PI / 180.0 * v2);
-		    break;
-
-		case VNADATA_FORMAT_MAG_ANGLE:
-		    value = v1 * cexp(I * M_PI / 180.0 * v2);
-		    break;
-
-		case VNADATA_FORMAT_REAL_IMAG:
-		    value = v1 + I * v2;
-		    break;
-
-		case VNADATA_FORMAT_PRC:
-		    value = 1.0 / (1.0 / v1 + 2.0 * M_PI * I * f * v2);
-		    break;
-
-		case VNADATA_FORMAT_PRL:
-		    value = v1 / (1.0 - I * v1 / (2.0 * M_PI * f * v2));
-		    break;
-
-		case VNADATA_FORMAT_SRC:
-		    value = v1 - I / (2.0 * M_PI * f * v2);
-		    break;
-
-		case VNADATA_FORMAT_SRL:
-		    value = v1 + 2.0 * M_PI * I * f * v2;
-		    break;
-
-		default:
-		    abort();
-		    /*NOTREACHED*/
-		}
-		(void)vnadata_set_cell(vdp, findex, row, column, value);
-	    }
+	if (rc == 0) {
+	    break;
 	}
-	if (scan_line(&nss) == -1) {
+	if (_vnadata_store_record(vdip, findex, f, matrix,
+		    fz0 ? z0_vector : NULL) == -1) {
 	    goto out;
 	}
     }
-    if (nss.nss_record_type != T_EOF) {
-	_vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
-		"extra lines at end of input",
-		nss.nss_filename, nss.nss_line);
-	goto out;
-    }
     rv = 0;
 
 out:
-    free((void *)z0_vector);
-    free((void *)nss.nss_fields);
-    free((void *)nss.nss_text);
+    _vnamem_free((void *)z0_vector);
+    _vnamem_free((void *)matrix);
+    _vnadata_npd_close(nssp);
     return rv;
 }
@@ -23,11 +23,15 @@
 #include <assert.h>
 #include <ctype.h>
 #include <errno.h>
+#include <float.h>
 #include <stdarg.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include "vnadata_internal.h"
+#include "vnastats_internal.h"
 
 
 /*
@@ -37,6 +41,11 @@
 #define LOG10		2.30258509299404568401799145468436420760110148862877
 #define RAD_PER_DEG	(PI / 180.0)
 
+/*
+ * VNADATA_LOAD_BUFFER_SIZE: number of bytes read from the file at a time
+ */
+#define VNADATA_LOAD_BUFFER_SIZE	65536
+
 /*
  * ts_token_t: touchstone tokens
  */
@@ -101,9 +110,12 @@ typedef enum ts_flags {
 /*
  * ts_parser_state_t: touchstone parser state
  */
-typedef struct ts_parser_state {
+struct ts_parser_state {
     vnadata_internal_t *tps_vdip;
     FILE *tps_fp;
+    unsigned char *tps_buffer;			/* input buffer */
+    const unsigned char *tps_next;		/* next character in buffer */
+    const unsigned char *tps_end;		/* end of valid data */
     const char *tps_filename;
     int tps_line;
     int tps_char;
@@ -124,7 +136,21 @@ typedef struct ts_parser_state {
     size_t tps_value_count;
     size_t tps_value_allocation;
     double *tps_value_vector;
-} ts_parser_state_t;
+    int tps_version;				/* 1 or 2 */
+    int tps_two_port_order;			/* T12_21, T21_12 or -1 */
+    char tps_matrix_format;			/* (F)ull, (L)ower, (U)pper */
+    int tps_expected_pairs;			/* value pairs per V2 record */
+    int tps_frequencies;			/* V2 record count or -1 */
+    int tps_noise_frequencies;			/* V2 noise count or -1 */
+    bool tps_v1_data;				/* data lines in V1 layout */
+    bool tps_line_pending;			/* V1 line parsed, not used */
+    bool tps_first_valid;			/* tps_first_line is pending */
+    bool tps_done;				/* all records returned */
+    int tps_findex;				/* records returned so far */
+    double tps_last_frequency;			/* frequency of last record */
+    double tps_first_line[9];			/* V1 look-ahead save area */
+    vnamem_allocator_t tps_allocator;		/* holds the state */
+};
 
 /*
  * get_token_name
@@ -207,6 +233,109 @@ static const char *get_token_name(ts_parser_state_t *tpsp)
     /*NOTREACHED*/
 }
 
+/*
+ * Character classes used by the scanner
+ */
+#define C_SPACE		0x01	/* whitespace other than newline */
+#define C_ALNUM		0x02	/* letter or digit: can start a word */
+#define C_WORD		0x04	/* can occur within a word */
+#define C_LOWER		0x08	/* lower case letter */
+
+/*
+ * ts_char_class: map from character to bitwise OR of C_* classes
+ *
+ *   This is the C locale's isspace and isalnum, plus the punctuation
+ *   characters that may appear within a word.  Characters above 0x7f
+ *   belong to no class.
+ */
+#define S	C_SPACE
+#define A	(C_ALNUM | C_WORD)
+#define L	(C_ALNUM | C_WORD | C_LOWER)
+#define P	C_WORD
+static const unsigned char ts_char_class[256] = {
+    /* 0x00 */ 0, 0, 0, 0, 0, 0, 0, 0, 0, S, 0, S, S, S, 0, 0,
+    /* 0x10 */ 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    /* 0x20 */ S, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, P, P, P, P, 0,
+    /* 0x30 */ A, A, A, A, A, A, A, A, A, A, 0, 0, 0, 0, 0, 0,
+    /* 0x40 */ 0, A, A, A, A, A, A, A, A, A, A, A, A, A, A, A,
+    /* 0x50 */ A, A, A, A, A, A, A, A, A, A, A, 0, 0, 0, 0, P,
+    /* 0x60 */ 0, L, L, L, L, L, L, L, L, L, L, L, L, L, L, L,
+    /* 0x70 */ L, L, L, L, L, L, L, L, L, L, L, 0, 0, 0, 0, 0,
+};
+#undef S
+#undef A
+#undef L
+#undef P
+
+/*
+ * CHAR_CLASS: return the class of a character or EOF
+ */
+#define CHAR_CLASS(c)	((c) == EOF ? 0 : ts_char_class[(unsigned char)(c)])
+
+/*
+ * fill_buffer: read the next block of input into the buffer
+ *   @tpsp: touchstone parser state structure
+ *
+ * Return:
+ *	true:  at least one new character is available
+ *	false: end of file or read error
+ */
+static bool fill_buffer(ts_parser_state_t *tpsp)
+{
+    size_t n;
+
+    n = fread((void *)tpsp->tps_buffer, 1, VNADATA_LOAD_BUFFER_SIZE,
+	    tpsp->tps_fp);
+    tpsp->tps_next = tpsp->tps_buffer;
+    tpsp->tps_end  = tpsp->tps_buffer + n;
+    _VNASTATS_ADD(_vnadata_stats, vds_load_bytes, n);
+    return n != 0;
+}
+
+/*
+ * next_char: read the next character from the input
+ *   @tpsp: touchstone parser state structure
+ *
+ *   Lower case letters are converted to upper case.
+ */
+static inline void next_char(ts_parser_state_t *tpsp)
+{
+    int c;
+
+    if (tpsp->tps_next == tpsp->tps_end && !fill_buffer(tpsp)) {
+	tpsp->tps_char = EOF;
+	return;
+    }
+    c = *tpsp->tps_next++;
+    if (ts_char_class[c] & C_LOWER) {
+	c -= 'a' - 'A';
+    }
+    tpsp->tps_char = c;
+}
+
+/*
+ * skip_comment: advance to the newline or EOF that ends a comment
+ *   @tpsp: touchstone parser state structure
+ */
+static void skip_comment(ts_parser_state_t *tpsp)
+{
+    for (;;) {
+	const unsigned char *cp;
+
+	cp = memchr((const void *)tpsp->tps_next, '\n',
+		tpsp->tps_end - tpsp->tps_next);
+	if (cp != NULL) {
+	    tpsp->tps_next = cp + 1;
+	    tpsp->tps_char = '\n';
+	    return;
+	}
+	if (!fill_buffer(tpsp)) {
+	    tpsp->tps_char = EOF;
+	    return;
+	}
+    }
+}
+
 /*
  * start_text: start accumulating text
  *   @tpsp: touchstone parser state structure
@@ -217,72 +346,100 @@ static void start_text(ts_parser_state_t *tpsp)
 }
 
 /*
- * add_char: add a character to the text buffer
+ * reserve_text: make room for n more characters in the text buffer
  *   @tpsp: touchstone parser state structure
- *   @c: character to add
+ *   @n: number of characters to add
  *
  * Return:
  *	 0: success
  *	-1: out of memory error
  */
-static int add_char(ts_parser_state_t *tpsp, char c)
+static int reserve_text(ts_parser_state_t *tpsp, size_t n)
 {
     assert(tpsp->tps_text_allocation != 0);
-    if (tpsp->tps_text_length + 1 >= tpsp->tps_text_allocation) {
+    if (tpsp->tps_text_length + n >= tpsp->tps_text_allocation) {
 	char *cp;
 	size_t new_allocation = 2 * tpsp->tps_text_allocation;
 
-	if ((cp = realloc(tpsp->tps_text, new_allocation)) == NULL) {
+	while (tpsp->tps_text_length + n >= new_allocation) {
+	    new_allocation *= 2;
+	}
+	if ((cp = _vnamem_arealloc(&tpsp->tps_allocator, tpsp->tps_text,
+			new_allocation)) == NULL) {
 	    return -1;
 	}
 	tpsp->tps_text = cp;
 	tpsp->tps_text_allocation = new_allocation;
     }
-    tpsp->tps_text[tpsp->tps_text_length++] = c;
     return 0;
 }
 
 /*
- * end_text: stop accumulating text
+ * add_char: add a character to the text buffer
  *   @tpsp: touchstone parser state structure
+ *   @c: character to add
+ *
+ * Return:
+ *	 0: success
+ *	-1: out of memory error
  */
-static void end_text(ts_parser_state_t *tpsp)
+static int add_char(ts_parser_state_t *tpsp, char c)
 {
-    tpsp->tps_text[tpsp->tps_text_length] = '\000';
+    if (reserve_text(tpsp, 1) == -1) {
+	return -1;
+    }
+    tpsp->tps_text[tpsp->tps_text_length++] = c;
+    return 0;
 }
 
 /*
- * next_char: read the next character from the input
+ * end_text: stop accumulating text
  *   @tpsp: touchstone parser state structure
  */
-static void next_char(ts_parser_state_t *tpsp)
+static void end_text(ts_parser_state_t *tpsp)
 {
-    tpsp->tps_char = getc(tpsp->tps_fp);
-    if (islower(tpsp->tps_char)) {
-	tpsp->tps_char = toupper(tpsp->tps_char);
-    }
+    tpsp->tps_text[tpsp->tps_text_length] = '\000';
 }
 
 /*
- * is_in_word_char: return true if ch can occur within a word
- *   @ch: character to test
+ * scan_word: add the current character and the rest of the word to text
+ *   @tpsp: touchstone parser state structure
+ *
+ *   Copy the run of word characters already in the buffer in one pass
+ *   instead of a character at a time, refilling the buffer only when
+ *   the word crosses a block boundary.
+ *
+ * Return:
+ *	 0: success
+ *	-1: out of memory error
  */
-static int is_in_word_char(int ch)
+static int scan_word(ts_parser_state_t *tpsp)
 {
-    if (isalnum(ch)) {
-	return 1;
-    }
-    switch (ch) {
-    case '+':
-    case ',':
-    case '-':
-    case '.':
-    case '_':
-	return 1;
+    do {
+	const unsigned char *start = tpsp->tps_next;
+	const unsigned char *cp = start;
+	char *dp;
 
-    default:
-	break;
-    }
+	while (cp < tpsp->tps_end && (ts_char_class[*cp] & C_WORD)) {
+	    ++cp;
+	}
+	if (reserve_text(tpsp, 1 + (cp - start)) == -1) {
+	    return -1;
+	}
+	dp = &tpsp->tps_text[tpsp->tps_text_length];
+	*dp++ = (char)tpsp->tps_char;
+	for (const unsigned char *sp = start; sp < cp; ++sp) {
+	    int c = *sp;
+
+	    if (ts_char_class[c] & C_LOWER) {
+		c -= 'a' - 'A';
+	    }
+	    *dp++ = (char)c;
+	}
+	tpsp->tps_text_length += 1 + (cp - start);
+	tpsp->tps_next = cp;
+	next_char(tpsp);
+    } while (CHAR_CLASS(tpsp->tps_char) & C_WORD);
     return 0;
 }
 
@@ -298,6 +455,114 @@ static bool convert_int(ts_parser_state_t *tpsp)
     return end > tpsp->tps_text && *end == '\000';
 }
 
+/*
+ * pow10_table: powers of ten that are exactly representable as double
+ */
+static const double pow10_table[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+    1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+    1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/*
+ * fast_convert_double: convert a simple decimal number without strtod
+ *   @text: upper-cased text of the number
+ *   @result: address of double to receive the value
+ *
+ *   Handle numbers of the form [+-]digits[.digits][E[+-]digits] having
+ *   a significand of at most 2^53 and a decimal exponent within +/-22.
+ *   Both the significand and the power of ten are then exact doubles,
+ *   so a single IEEE multiply or divide gives the correctly rounded
+ *   result (Clinger's fast path).  Everything else, including hex
+ *   floats, INF and NAN, is left to strtod.
+ *
+ * Return:
+ *	true:  *result contains the converted value
+ *	false: caller must fall back to strtod
+ */
+static bool fast_convert_double(const char *text, double *result)
+{
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+    const char *cp = text;
+    bool negative = false;
+    bool seen_digit = false;
+    uint64_t significand = 0;
+    int digits = 0;
+    int exponent = 0;
+    double value;
+
+    if (*cp == '+' || *cp == '-') {
+	negative = *cp++ == '-';
+    }
+    for (; *cp >= '0' && *cp <= '9'; ++cp) {
+	seen_digit = true;
+	if (significand == 0 && *cp == '0') {
+	    continue;
+	}
+	if (++digits > 19) {
+	    return false;
+	}
+	significand = 10 * significand + (*cp - '0');
+    }
+    if (*cp == '.') {
+	for (++cp; *cp >= '0' && *cp <= '9'; ++cp) {
+	    seen_digit = true;
+	    --exponent;
+	    if (significand == 0 && *cp == '0') {
+		continue;
+	    }
+	    if (++digits > 19) {
+		return false;
+	    }
+	    significand = 10 * significand + (*cp - '0');
+	}
+    }
+    if (!seen_digit) {
+	return false;
+    }
+    if (*cp == 'E') {
+	bool negative_exponent = false;
+	int e = 0;
+
+	++cp;
+	if (*cp == '+' || *cp == '-') {
+	    negative_exponent = *cp++ == '-';
+	}
+	if (!(*cp >= '0' && *cp <= '9')) {
+	    return false;
+	}
+	for (; *cp >= '0' && *cp <= '9'; ++cp) {
+	    if (e > 1000) {
+		return false;
+	    }
+	    e = 10 * e + (*cp - '0');
+	}
+	exponent += negative_exponent ? -e : e;
+    }
+    if (*cp != '\000') {
+	return false;
+    }
+    if (significand > ((uint64_t)1 << 53)) {
+	return false;
+    }
+    value = (double)significand;
+    if (significand != 0) {
+	if (exponent < -22 || exponent > 22) {
+	    return false;
+	}
+	if (exponent < 0) {
+	    value /= pow10_table[-exponent];
+	} else {
+	    value *= pow10_table[exponent];
+	}
+    }
+    *result = negative ? -value : value;
+    return true;
+#else /* excess precision would cause double rounding */
+    return false;
+#endif
+}
+
 /*
  * convert_double: convert a double
  *   @tpsp: touchstone parser state structure
@@ -306,6 +571,9 @@ static bool convert_double(ts_parser_state_t *tpsp)
 {
     char *end;
 
+    if (fast_convert_double(tpsp->tps_text, &tpsp->u.tps_double)) {
+	return true;
+    }
     tpsp->u.tps_double = strtod(tpsp->tps_text, &end);
     return end > tpsp->tps_text && *end == '\000';
 }
@@ -337,9 +605,7 @@ static int next_token(ts_parser_state_t *tpsp, uint32_t flags)
 	    continue;
 
 	case '!':	/* comment */
-	    do {
-		next_char(tpsp);
-	    } while (tpsp->tps_char != '\n' && tpsp->tps_char != EOF);
+	    skip_comment(tpsp);
 	    continue;
 
 	case '+':	/* things that start "words" */
@@ -477,7 +743,7 @@ static int next_token(ts_parser_state_t *tpsp, uint32_t flags)
 	    return 0;
 
 	default:
-	    if (isspace(tpsp->tps_char)) {	/* whitespace (not newline) */
+	    if (CHAR_CLASS(tpsp->tps_char) & C_SPACE) { /* not newline */
 		next_char(tpsp);
 		continue;
 	    }
@@ -487,17 +753,14 @@ static int next_token(ts_parser_state_t *tpsp, uint32_t flags)
 	/*
 	 * Scan words and numbers.
 	 */
-	if (isalnum(tpsp->tps_char)) {
+	if (CHAR_CLASS(tpsp->tps_char) & C_ALNUM) {
 	word:
 	    start_text(tpsp);
-	    do {
-		if (add_char(tpsp, (char)tpsp->tps_char) == -1) {
-		    end_text(tpsp);
-		    tpsp->tps_token = T_ERROR;
-		    return 0;
-		}
-		next_char(tpsp);
-	    } while (is_in_word_char(tpsp->tps_char));
+	    if (scan_word(tpsp) == -1) {
+		end_text(tpsp);
+		tpsp->tps_token = T_ERROR;
+		return 0;
+	    }
 	    end_text(tpsp);
 
 	    /*
@@ -646,7 +909,8 @@ static int parse_data_line(ts_parser_state_t *tpsp)
 	    } else {
 		new_allocation = 2 * tpsp->tps_value_allocation;
 	    }
-	    if ((lfp = realloc(tpsp->tps_value_vector,
+	    if ((lfp = _vnamem_arealloc(&tpsp->tps_allocator,
+			    tpsp->tps_value_vector,
 			    new_allocation * sizeof(double))) == NULL) {
 		_vnadata_error(vdip, VNAERR_SYSTEM,
 			"realloc: %s", strerror(errno));
@@ -703,16 +967,121 @@ static void convert_value_pair(ts_parser_state_t *tpsp,
     }
 }
 
+
+#define VNADATA_LOAD_INITIAL_TEXT_ALLOCATION	64
+
+/*
+ * Two-port order
+ */
+#define T12_21	1
+#define T21_12	2
+
 /*
- * load_touchstone1: load Touchstone version 1
+ * parse_value_pair: parse two values and convert to complex
  *   @tpsp: touchstone parser state structure
+ *   @nexpected: number of value pairs expected (for error messages)
+ *   @result: address to receive complex result
  */
-static int load_touchstone1(ts_parser_state_t *tpsp)
+static int parse_value_pair(ts_parser_state_t *tpsp, int nexpected,
+	double complex *result)
+{
+    vnadata_internal_t *vdip = tpsp->tps_vdip;
+    double v[2];
+
+    for (int i = 0; i < 2; ++i) {
+	if (tpsp->tps_token != T_DOUBLE) {
+	    _vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
+		    "expected %d value pairs",
+		    tpsp->tps_filename, tpsp->tps_line, nexpected);
+	    return -1;
+	}
+	v[i] = tpsp->u.tps_double;
+	if (next_token(tpsp, F_NONE) == -1) {
+	    return -1;
+	}
+    }
+    convert_value_pair(tpsp, v, result);
+    return 0;
+}
+
+/*
+ * unnormalize: convert a record of a version 1 file to ohms or siemens
+ *   @tpsp: touchstone parser state structure
+ *   @matrix: serialized matrix of the record
+ */
+static void unnormalize(const ts_parser_state_t *tpsp, double complex *matrix)
+{
+    const int cells = tpsp->tps_ports * tpsp->tps_ports;
+
+    switch (tpsp->tps_parameter_type) {
+    case VPT_S:
+    default:
+	break;
+
+    case VPT_Z:
+	for (int cell = 0; cell < cells; ++cell) {
+	    matrix[cell] *= tpsp->tps_z0;
+	}
+	break;
+
+    case VPT_Y:
+	for (int cell = 0; cell < cells; ++cell) {
+	    matrix[cell] /= tpsp->tps_z0;
+	}
+	break;
+
+    case VPT_H:
+	matrix[0] *= tpsp->tps_z0;
+	matrix[3] /= tpsp->tps_z0;
+	break;
+
+    case VPT_G:
+	matrix[0] /= tpsp->tps_z0;
+	matrix[3] *= tpsp->tps_z0;
+	break;
+    }
+}
+
+/*
+ * skip_noise_data1: parse and discard Touchstone V1 noise data
+ *   @tpsp: touchstone parser state structure
+ *
+ *   The first noise line has already been parsed.  TODO: extend
+ *   vnadata_t to store it.
+ */
+static int skip_noise_data1(ts_parser_state_t *tpsp)
+{
+    vnadata_internal_t *vdip = tpsp->tps_vdip;
+
+    while (tpsp->tps_token == T_DOUBLE) {
+	if (parse_data_line(tpsp) == -1)
+	    return -1;
+
+	if (tpsp->tps_value_count != 5) {
+	    _vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
+		    "expected 5 noise fields; found %d",
+		tpsp->tps_filename, tpsp->tps_line,
+		(int)tpsp->tps_value_count);
+	    return -1;
+	}
+    }
+    return 0;
+}
+
+/*
+ * start_touchstone1: determine the number of ports of a V1 file
+ *   @tpsp: touchstone parser state structure
+ *
+ *   Version 1 files don't declare the number of ports, so we infer it
+ *   from the number of fields in the first data line.  Nine fields
+ *   could be either a 2x2 matrix or the first line of a 4x4 matrix.
+ *   In that case, save the line and look at the next one: if it has
+ *   8 fields, the matrix is 4x4.  On return, the parsed lines wait
+ *   in tps_first_line and tps_value_vector for next_touchstone1.
+ */
+static int start_touchstone1(ts_parser_state_t *tpsp)
 {
     vnadata_internal_t *vdip = tpsp->tps_vdip;
-    vnadata_t *vdp = &vdip->vdi_vd;
-    int findex, row, column;
-    bool maybe4ports = false;
 
     if (tpsp->tps_token != T_DOUBLE) {
 	_vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
@@ -731,9 +1100,15 @@ static int load_touchstone1(ts_parser_state_t *tpsp)
 	    tpsp->tps_filename, tpsp->tps_line);
 	return -1;
     }
-    if (tpsp->tps_value_count == 5)
-	goto parse_noise_data;
+    tpsp->tps_line_pending = true;
 
+    /*
+     * Noise parameters exist only for 2-ports.
+     */
+    if (tpsp->tps_value_count == 5) {
+	tpsp->tps_ports = 2;
+	return 0;
+    }
     if (tpsp->tps_parameter_type == VPT_H ||
 	    tpsp->tps_parameter_type == VPT_G) {
 	if (tpsp->tps_value_count != 9) {
@@ -743,334 +1118,576 @@ static int load_touchstone1(ts_parser_state_t *tpsp)
 	    return -1;
 	}
 	tpsp->tps_ports = 2;
-
-    } else if (tpsp->tps_value_count == 9) {
-	tpsp->tps_ports = 2;
-	maybe4ports = true;
-
-    } else {
+	return 0;
+    }
+    if (tpsp->tps_value_count != 9) {
 	tpsp->tps_ports = (tpsp->tps_value_count - 1) / 2;
+	return 0;
     }
-    if (vnadata_init(vdp, tpsp->tps_parameter_type,
-		tpsp->tps_ports, tpsp->tps_ports, /*frequencies*/0) == -1) {
-	_vnadata_error(vdip, VNAERR_SYSTEM,
-		"realloc: %s", strerror(errno));
-	return -1;
+    tpsp->tps_ports = 2;
+    if (tpsp->tps_token == T_DOUBLE) {
+	(void)memcpy((void *)tpsp->tps_first_line,
+		(void *)tpsp->tps_value_vector, 9 * sizeof(double));
+	tpsp->tps_first_valid = true;
+	if (parse_data_line(tpsp) == -1)
+	    return -1;
+
+	if (tpsp->tps_value_count == 8) {
+	    tpsp->tps_ports = 4;
+	}
     }
-    (void)vnadata_set_all_z0(vdp, tpsp->tps_z0);
+    return 0;
+}
+
+/*
+ * next_touchstone1: parse the next Touchstone V1 record
+ *   @tpsp: touchstone parser state structure
+ *   @frequency: address to receive the frequency
+ *   @matrix: serialized matrix to receive the data
+ *
+ *   Return 1 if a record was parsed, 0 at end of data, or -1 on error.
+ */
+static int next_touchstone1(ts_parser_state_t *tpsp, double *frequency,
+	double complex *matrix)
+{
+    vnadata_internal_t *vdip = tpsp->tps_vdip;
+    const int ports = tpsp->tps_ports;
+    const double *first;
+    double f;
 
     /*
-     * 2x2
+     * Get the first line of the record.  Normally, it's the next line
+     * of the file, but start_touchstone1 may already have parsed it.
      */
-    if (tpsp->tps_ports == 2) {
-	for (;;) {
-	    /*
-	     * Validate and load the frequency.
-	     */
-	    findex = vdp->vd_frequencies;
-	    if (findex != 0 &&
-		    tpsp->tps_frequency_multiplier *
-		    tpsp->tps_value_vector[0] <= vnadata_get_frequency(vdp,
-			findex - 1)) {
-		_vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
-			"frequencies must be in increasing order",
-			tpsp->tps_filename, tpsp->tps_line);
-		return -1;
-	    }
-	    if (vnadata_add_frequency(vdp, tpsp->tps_frequency_multiplier *
-			tpsp->tps_value_vector[0]) == -1) {
-		_vnadata_error(vdip, VNAERR_SYSTEM,
-			"realloc: %s", strerror(errno));
-		return -1;
-	    }
+    if (tpsp->tps_first_valid) {
+	first = tpsp->tps_first_line;
+	tpsp->tps_first_valid = false;
 
-	    /*
-	     * Convert fields 1..8 and store transposed.
-	     */
-	    assert(tpsp->tps_value_count == 9);
-	    convert_value_pair(tpsp, &tpsp->tps_value_vector[1],
-		    &vdp->vd_data[findex][0]);
-	    convert_value_pair(tpsp, &tpsp->tps_value_vector[3],
-		    &vdp->vd_data[findex][2]);
-	    convert_value_pair(tpsp, &tpsp->tps_value_vector[5],
-		    &vdp->vd_data[findex][1]);
-	    convert_value_pair(tpsp, &tpsp->tps_value_vector[7],
-		    &vdp->vd_data[findex][3]);
+    } else {
+	int expected = (ports == 2) ? 9 : 1 + 2 * ports;
 
-	    /*
-	     * If no more values, break.
-	     */
+	if (tpsp->tps_line_pending) {
+	    tpsp->tps_line_pending = false;
+	} else {
 	    if (tpsp->tps_token != T_DOUBLE)
-		break;
+		return 0;
 
-	    /*
-	     * Read the next line.
-	     */
 	    if (parse_data_line(tpsp) == -1)
 		return -1;
+	}
 
-	    /*
-	     * If the new line has 9 fields, then our guess of a 2x2
-	     * matrix was right.  If it has 8, then our guess was wrong --
-	     * what we parsed so far was only the first line of a
-	     * 4x4 matrix.  If it has 5 fields, then we've finished the
-	     * data block and found noise parameters.  Any other number
-	     * of fields is an error.
-	     */
-	    if (tpsp->tps_value_count != 9) {
-		if (tpsp->tps_value_count == 5)
-		    goto parse_noise_data;
-
-		if (maybe4ports && tpsp->tps_value_count == 8) {
-		    double complex d21, d12;
-
-		    /*
-		     * 4x4: transpose first row back into the correct order
-		     * and resize the vnadata_t structure.
-		     */
-		    d21 = vdp->vd_data[findex][1];
-		    d12 = vdp->vd_data[findex][2];
-		    vdp->vd_data[findex][1] = d12;
-		    vdp->vd_data[findex][2] = d21;
-		    tpsp->tps_ports = 4;
-		    if (vnadata_resize(vdp, tpsp->tps_parameter_type,
-				tpsp->tps_ports, tpsp->tps_ports,
-				findex + 1) == -1) {
-			_vnadata_error(vdip, VNAERR_SYSTEM,
-				"realloc: %s", strerror(errno));
-			return -1;
-		    }
-		    (void)vnadata_set_all_z0(vdp, tpsp->tps_z0);
-		    row = 1;
-		    goto nxn_next_row;
-		}
+	/*
+	 * If the line has 5 fields, then we've finished the data
+	 * block and found noise parameters.
+	 */
+	if (tpsp->tps_value_count == 5) {
+	    return skip_noise_data1(tpsp);
+	}
+	if (tpsp->tps_value_count != expected) {
+	    _vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
+		    "expected %d fields; found %d",
+		tpsp->tps_filename, tpsp->tps_line,
+		expected, (int)tpsp->tps_value_count);
+	    return -1;
+	}
+	first = tpsp->tps_value_vector;
+    }
+
+    /*
+     * Validate the frequency.
+     */
+    f = tpsp->tps_frequency_multiplier * first[0];
+    if (tpsp->tps_findex != 0 && f <= tpsp->tps_last_frequency) {
+	_vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
+		"frequencies must be in increasing order",
+		tpsp->tps_filename, tpsp->tps_line);
+	return -1;
+    }
+    *frequency = f;
+
+    /*
+     * 2x2: convert fields 1..8 and store transposed.
+     */
+    if (ports == 2) {
+	convert_value_pair(tpsp, &first[1], &matrix[0]);
+	convert_value_pair(tpsp, &first[3], &matrix[2]);
+	convert_value_pair(tpsp, &first[5], &matrix[1]);
+	convert_value_pair(tpsp, &first[7], &matrix[3]);
+	return 1;
+    }
+
+    /*
+     * NxN (not 2x2): first row, then the remaining rows.  If the
+     * first row came from tps_first_line, the second row is pending.
+     */
+    for (int column = 0; column < ports; ++column) {
+	convert_value_pair(tpsp, &first[1 + 2 * column], &matrix[column]);
+    }
+    for (int row = 1; row < ports; ++row) {
+	if (tpsp->tps_line_pending) {
+	    tpsp->tps_line_pending = false;
+
+	} else {
+	    if (tpsp->tps_token != T_DOUBLE) {
 		_vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
-			"expected 9 fields; found %d",
-		    tpsp->tps_filename, tpsp->tps_line,
-		    (int)tpsp->tps_value_count);
+			"unexpected token %s",
+			tpsp->tps_filename, tpsp->tps_line,
+			get_token_name(tpsp));
 		return -1;
 	    }
-	    maybe4ports = false;
+	    if (parse_data_line(tpsp) == -1)
+		return -1;
 	}
+	if (tpsp->tps_value_count != 2 * ports) {
+	    _vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
+		    "expected %d fields; found %d",
+		tpsp->tps_filename, tpsp->tps_line,
+		2 * ports, (int)tpsp->tps_value_count);
+	    return -1;
+	}
+	for (int column = 0; column < ports; ++column) {
+	    convert_value_pair(tpsp, &tpsp->tps_value_vector[2 * column],
+		    &matrix[ports * row + column]);
+	}
+    }
+    return 1;
+}
+
+/*
+ * finish_touchstone2: parse the trailing sections of a V2 file
+ *   @tpsp: touchstone parser state structure
+ */
+static int finish_touchstone2(ts_parser_state_t *tpsp)
+{
+    vnadata_internal_t *vdip = tpsp->tps_vdip;
 
     /*
-     * NxN (not 2x2)
+     * Parse and discard noise data.
      */
-    } else {
-	for (;;) {
-	    /* first row */
-	    findex = vdp->vd_frequencies;
-	    if (findex != 0 &&
-		    tpsp->tps_frequency_multiplier *
-		    tpsp->tps_value_vector[0] <= vnadata_get_frequency(vdp,
-			findex - 1)) {
+    if (tpsp->tps_noise_frequencies >= 0) {
+	double f_prev = -1.0;
+
+	if (tpsp->tps_token != T_KW_NOISE_DATA) {
+	    _vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
+		    "expected [Noise Data]",
+		    tpsp->tps_filename, tpsp->tps_line);
+	    return -1;
+	}
+	if (next_token(tpsp, F_NONE) == -1) {
+	    return -1;
+	}
+	for (int i = 0; i < tpsp->tps_noise_frequencies; ++i) {
+	    if (tpsp->tps_token != T_DOUBLE || tpsp->u.tps_double < 0.0) {
 		_vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
-			"frequencies must be in increasing order",
+			"expected non-negative noise frequency",
 			tpsp->tps_filename, tpsp->tps_line);
 		return -1;
 	    }
-	    if (vnadata_add_frequency(vdp, tpsp->tps_frequency_multiplier *
-			tpsp->tps_value_vector[0]) == -1) {
-		_vnadata_error(vdip, VNAERR_SYSTEM,
-			"realloc: %s", strerror(errno));
+	    if (i > 0 && tpsp->u.tps_double < f_prev) {
+		_vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
+			"noise frequencies be increasing",
+			tpsp->tps_filename, tpsp->tps_line);
 		return -1;
 	    }
-	    for (column = 0; column < tpsp->tps_ports; ++column) {
-		int idx = 1 + 2 * column;
-
-		convert_value_pair(tpsp, &tpsp->tps_value_vector[idx],
-			&vdp->vd_data[findex][column]);
+	    f_prev = tpsp->u.tps_double;
+	    if (next_token(tpsp, F_NONE) == -1) {
+		return -1;
 	    }
-
-	    /* remaining rows */
-	    for (row = 1; row < tpsp->tps_ports; ++row) {
+	    for (int j = 0; j < 4; ++j) {
 		if (tpsp->tps_token != T_DOUBLE) {
 		    _vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
-			    "unexpected token %s",
-			    tpsp->tps_filename, tpsp->tps_line,
-			    get_token_name(tpsp));
+			    "expected five noise parameters",
+			    tpsp->tps_filename, tpsp->tps_line);
 		    return -1;
 		}
-		if (parse_data_line(tpsp) == -1)
+		if (next_token(tpsp, F_NONE) == -1) {
 		    return -1;
+		}
+	    }
+	}
+    }
 
-	    nxn_next_row:
-		if (tpsp->tps_value_count != 2 * tpsp->tps_ports) {
-		    _vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
-			    "expected %d fields; found %d",
-			tpsp->tps_filename, tpsp->tps_line,
-			2 * tpsp->tps_ports, (int)tpsp->tps_value_count);
+    /*
+     * Expect [End]
+     */
+    if (tpsp->tps_token == T_KW_END) {
+	if (next_token(tpsp, F_NONE) == -1)
+	    return -1;
+
+    } else {
+	_vnadata_error(vdip, VNAERR_WARNING,
+		"%s (line %d) warning: expected [End] keyword",
+		tpsp->tps_filename, tpsp->tps_line);
+    }
+    return 0;
+}
+
+/*
+ * next_touchstone2: parse the next Touchstone V2 [Network Data] record
+ *   @tpsp: touchstone parser state structure
+ *   @frequency: address to receive the frequency
+ *   @matrix: serialized matrix to receive the data
+ *
+ *   Return 1 if a record was parsed, 0 at end of data, or -1 on error.
+ */
+static int next_touchstone2(ts_parser_state_t *tpsp, double *frequency,
+	double complex *matrix)
+{
+    vnadata_internal_t *vdip = tpsp->tps_vdip;
+    const int ports = tpsp->tps_ports;
+    double f;
+
+    if (tpsp->tps_findex >= tpsp->tps_frequencies) {
+	return finish_touchstone2(tpsp);
+    }
+    if (tpsp->tps_token != T_DOUBLE) {
+	_vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
+		"expected frequency",
+		tpsp->tps_filename, tpsp->tps_line);
+	return -1;
+    }
+    f = tpsp->tps_frequency_multiplier * tpsp->u.tps_double;
+    if (tpsp->tps_findex != 0 && f <= tpsp->tps_last_frequency) {
+	_vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
+		"frequencies must be in increasing order",
+		tpsp->tps_filename, tpsp->tps_line);
+	return -1;
+    }
+    *frequency = f;
+    if (next_token(tpsp, F_NONE) == -1) {
+	return -1;
+    }
+    switch (tpsp->tps_matrix_format) {
+    case 'F':	/* Full */
+	for (int row = 0; row < ports; ++row) {
+	    for (int column = 0; column < ports; ++column) {
+		double complex x;
+
+		if (parse_value_pair(tpsp, tpsp->tps_expected_pairs,
+			    &x) == -1) {
 		    return -1;
 		}
-		for (column = 0; column < tpsp->tps_ports; ++column) {
-		    int idx = 2 * column;
-
-		    convert_value_pair(tpsp, &tpsp->tps_value_vector[idx],
-			    &vdp->vd_data[findex][tpsp->tps_ports * row +
-			    column]);
+		if (tpsp->tps_two_port_order == T21_12) {
+		    matrix[column * ports + row] = x;
+		} else {
+		    matrix[row * ports + column] = x;
 		}
 	    }
-	    if (tpsp->tps_token != T_DOUBLE)
-		break;
+	}
+	break;
 
-	    if (parse_data_line(tpsp) == -1)
-		return -1;
+    case 'U':	/* Upper */
+	for (int row = 0; row < ports; ++row) {
+	    for (int column = row; column < ports; ++column) {
+		double complex x;
+
+		if (parse_value_pair(tpsp, tpsp->tps_expected_pairs,
+			    &x) == -1) {
+		    return -1;
+		}
+		matrix[row * ports + column] = x;
+		matrix[column * ports + row] = x;
+	    }
+	}
+	break;
 
-	    if (tpsp->tps_value_count != 1 + 2 * tpsp->tps_ports) {
-		if (tpsp->tps_value_count == 5)
-		    goto parse_noise_data;
+    case 'L':	/* Lower */
+	for (int row = 0; row < ports; ++row) {
+	    for (int column = 0; column <= row; ++column) {
+		double complex x;
 
-		_vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
-			"expected %d fields; found %d",
-		    tpsp->tps_filename, tpsp->tps_line,
-		    1 + 2 * tpsp->tps_ports, (int)tpsp->tps_value_count);
-		return -1;
+		if (parse_value_pair(tpsp, tpsp->tps_expected_pairs,
+			    &x) == -1) {
+		    return -1;
+		}
+		matrix[row * ports + column] = x;
+		matrix[column * ports + row] = x;
 	    }
 	}
+	break;
+
+    default:
+	abort();
     }
-    return 0;
+    return 1;
+}
 
-    /*
-     * Parse and discard noise data.  TODO: extend vnadata_t to store it.
-     */
-parse_noise_data:
-    while (tpsp->tps_token == T_DOUBLE) {
-	if (parse_data_line(tpsp) == -1)
-	    return -1;
+/*
+ * skip_data_line: count the fields of a line, converting only the first
+ *   @tpsp: touchstone parser state structure
+ *   @first: address to receive the first field
+ *   @count: address to receive the number of fields
+ */
+static int skip_data_line(ts_parser_state_t *tpsp, double *first,
+	int *count)
+{
+    vnadata_internal_t *vdip = tpsp->tps_vdip;
 
-	if (tpsp->tps_value_count != 5) {
-	    _vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
-		    "expected 5 noise fields; found %d",
-		tpsp->tps_filename, tpsp->tps_line,
-		(int)tpsp->tps_value_count);
+    assert(tpsp->tps_token == T_DOUBLE);
+    *first = tpsp->u.tps_double;
+    *count = 1;
+    for (;;) {
+	if (next_token(tpsp, F_EOL | F_NOCONV) == -1) {
 	    return -1;
 	}
+	if (tpsp->tps_token != T_WORD) {
+	    break;
+	}
+	++*count;
     }
-    return 0;
+    if (tpsp->tps_token == T_EOL) {
+	return next_token(tpsp, F_NONE);
+    }
+    if (tpsp->tps_token == T_EOF) {
+	return 0;
+    }
+    _vnadata_error(vdip, VNAERR_SYNTAX,
+	    "%s (line %d) error: unexpected token %s",
+	    tpsp->tps_filename, tpsp->tps_line, get_token_name(tpsp));
+    return -1;
 }
 
-#define VNADATA_LOAD_INITIAL_TEXT_ALLOCATION	64
-
 /*
- * Two-port order
+ * skip_touchstone1: skip the next Touchstone V1 record
+ *   @tpsp: touchstone parser state structure
+ *   @frequency: address to receive the frequency
+ *
+ *   Like next_touchstone1, but only the frequency is converted.
  */
-#define T12_21	1
-#define T21_12	2
+static int skip_touchstone1(ts_parser_state_t *tpsp, double *frequency)
+{
+    vnadata_internal_t *vdip = tpsp->tps_vdip;
+    const int ports = tpsp->tps_ports;
+    double first;
+    int count;
+
+    if (tpsp->tps_first_valid) {
+	first = tpsp->tps_first_line[0];
+	tpsp->tps_first_valid = false;
+
+    } else {
+	int expected = (ports == 2) ? 9 : 1 + 2 * ports;
+
+	if (tpsp->tps_line_pending) {
+	    tpsp->tps_line_pending = false;
+	    first = tpsp->tps_value_vector[0];
+	    count = (int)tpsp->tps_value_count;
+	} else {
+	    if (tpsp->tps_token != T_DOUBLE)
+		return 0;
+
+	    if (skip_data_line(tpsp, &first, &count) == -1)
+		return -1;
+	}
+	if (count == 5) {
+	    return skip_noise_data1(tpsp);
+	}
+	if (count != expected) {
+	    _vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
+		    "expected %d fields; found %d",
+		    tpsp->tps_filename, tpsp->tps_line, expected, count);
+	    return -1;
+	}
+    }
+    *frequency = tpsp->tps_frequency_multiplier * first;
+    if (tpsp->tps_findex != 0 && *frequency <= tpsp->tps_last_frequency) {
+	_vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
+		"frequencies must be in increasing order",
+		tpsp->tps_filename, tpsp->tps_line);
+	return -1;
+    }
+    if (ports == 2) {
+	return 1;
+    }
+    for (int row = 1; row < ports; ++row) {
+	if (tpsp->tps_line_pending) {
+	    tpsp->tps_line_pending = false;
+	    count = (int)tpsp->tps_value_count;
+
+	} else {
+	    if (tpsp->tps_token != T_DOUBLE) {
+		_vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
+			"unexpected token %s",
+			tpsp->tps_filename, tpsp->tps_line,
+			get_token_name(tpsp));
+		return -1;
+	    }
+	    if (skip_data_line(tpsp, &first, &count) == -1)
+		return -1;
+	}
+	if (count != 2 * ports) {
+	    _vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
+		    "expected %d fields; found %d",
+		    tpsp->tps_filename, tpsp->tps_line, 2 * ports, count);
+	    return -1;
+	}
+    }
+    return 1;
+}
 
 /*
- * parse_value_pair: parse two values and convert to complex
+ * skip_touchstone2: skip the next Touchstone V2 [Network Data] record
  *   @tpsp: touchstone parser state structure
- *   @nexpected: number of value pairs expected (for error messages)
- *   @result: address to receive complex result
+ *   @frequency: address to receive the frequency
+ *
+ *   Like next_touchstone2, but only the frequency is converted.
  */
-static int parse_value_pair(ts_parser_state_t *tpsp, int nexpected,
-	double complex *result)
+static int skip_touchstone2(ts_parser_state_t *tpsp, double *frequency)
 {
     vnadata_internal_t *vdip = tpsp->tps_vdip;
-    double v[2];
+    const int values = 2 * tpsp->tps_expected_pairs;
 
-    for (int i = 0; i < 2; ++i) {
-	if (tpsp->tps_token != T_DOUBLE) {
-	    _vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
-		    "expected %d value pairs",
-		    tpsp->tps_filename, tpsp->tps_line, nexpected);
+    if (tpsp->tps_token != T_DOUBLE) {
+	_vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
+		"expected frequency",
+		tpsp->tps_filename, tpsp->tps_line);
+	return -1;
+    }
+    *frequency = tpsp->tps_frequency_multiplier * tpsp->u.tps_double;
+    if (tpsp->tps_findex != 0 && *frequency <= tpsp->tps_last_frequency) {
+	_vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
+		"frequencies must be in increasing order",
+		tpsp->tps_filename, tpsp->tps_line);
+	return -1;
+    }
+    for (int i = 0; i < values; ++i) {
+	if (next_token(tpsp, F_NOCONV) == -1) {
 	    return -1;
 	}
-	v[i] = tpsp->u.tps_double;
-	if (next_token(tpsp, F_NONE) == -1) {
+	if (tpsp->tps_token != T_WORD) {
+	    _vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
+		    "expected %d value pairs",
+		    tpsp->tps_filename, tpsp->tps_line,
+		    tpsp->tps_expected_pairs);
 	    return -1;
 	}
     }
-    convert_value_pair(tpsp, v, result);
-    return 0;
+    return next_token(tpsp, F_NONE) == -1 ? -1 : 1;
 }
 
 /*
- * _vnadata_load_touchstone
- *   @vdp: a pointer to the vnadata_t structure
+ * _vnadata_touchstone_close: free the touchstone parser state
+ *   @tpsp: touchstone parser state structure
+ */
+void _vnadata_touchstone_close(ts_parser_state_t *tpsp)
+{
+    if (tpsp != NULL) {
+	vnamem_allocator_t allocator = tpsp->tps_allocator;
+
+	_vnamem_afree(&allocator, (void *)tpsp->tps_text);
+	_vnamem_afree(&allocator, (void *)tpsp->tps_buffer);
+	_vnamem_afree(&allocator, (void *)tpsp->tps_value_vector);
+	_vnamem_afree(&allocator, (void *)tpsp);
+    }
+}
+
+/*
+ * _vnadata_touchstone_open: parse the header of a touchstone file
+ *   @vdip: internal parameter matrix
  *   @fp: file pointer
- *   @filename: filename used in error messages and to intuit the file type
+ *   @filename: filename used in error messages
+ *   @frequencies: address to receive the number of records or -1
+ *
+ *   Initialize vdip with the parameter type, dimensions, reference
+ *   impedances and format from the header, and with the number of
+ *   frequencies if known.  Return a parser state for reading the
+ *   records with _vnadata_touchstone_next, or NULL on error.
  */
-int _vnadata_load_touchstone(vnadata_internal_t *vdip, FILE *fp,
-	const char *filename)
+ts_parser_state_t *_vnadata_touchstone_open(vnadata_internal_t *vdip,
+	FILE *fp, const char *filename, int *frequencies)
 {
     vnadata_t *vdp = &vdip->vdi_vd;
-    ts_parser_state_t tps;
-    int version = 1;
-    int two_port_order  = -1;
+    ts_parser_state_t *tpsp;
     int two_port_order_line = -1;
-    int number_of_frequencies = -1;
-    int number_of_noise_frequencies = -1;
-    int expected_pairs = 0;
-    char matrix_format = 'F';	/* (F)ull, (L)ower, (U)pper */
     double complex *reference = NULL;
-    int rc = -1;
+    vnamem_allocator_t allocator;
 
     /*
      * Initialize the parser
      */
-    (void)memset((void *)&tps, 0, sizeof(tps));
-    tps.tps_vdip			= vdip;
-    tps.tps_fp				= fp;
-    tps.tps_filename			= filename;
-    tps.tps_line			= 1;
-    tps.tps_char			= '\000';
-    tps.tps_in_option_line		= false;
-    tps.tps_token			= T_EOL;
-    tps.tps_text_length			= 0;
-    tps.tps_text_allocation		= 0;
-    tps.tps_text			= NULL;
-    tps.tps_frequency_multiplier	= 1.0e+9;
-    tps.tps_parameter_type		= VPT_S;
-    tps.tps_data_format			= 'M';
-    tps.tps_z0				= 50.0;	/* Touchstone default */
-    tps.tps_ports			= -1;
-    if ((tps.tps_text = malloc(VNADATA_LOAD_INITIAL_TEXT_ALLOCATION)) == NULL) {
+    vnamem_get_allocator(&allocator);
+    if ((tpsp = _vnamem_acalloc(&allocator, 1,
+		    sizeof(ts_parser_state_t))) == NULL) {
+	_vnadata_error(vdip, VNAERR_SYSTEM,
+		"calloc: %s", strerror(errno));
+	return NULL;
+    }
+    tpsp->tps_allocator			= allocator;
+    tpsp->tps_vdip			= vdip;
+    tpsp->tps_fp			= fp;
+    tpsp->tps_filename			= filename;
+    tpsp->tps_line			= 1;
+    tpsp->tps_char			= '\000';
+    tpsp->tps_in_option_line		= false;
+    tpsp->tps_token			= T_EOL;
+    tpsp->tps_text_length		= 0;
+    tpsp->tps_text_allocation		= 0;
+    tpsp->tps_text			= NULL;
+    tpsp->tps_frequency_multiplier	= 1.0e+9;
+    tpsp->tps_parameter_type		= VPT_S;
+    tpsp->tps_data_format		= 'M';
+    tpsp->tps_z0			= 50.0;	/* Touchstone default */
+    tpsp->tps_ports			= -1;
+    tpsp->tps_version			= 1;
+    tpsp->tps_two_port_order		= -1;
+    tpsp->tps_matrix_format		= 'F';
+    tpsp->tps_frequencies		= -1;
+    tpsp->tps_noise_frequencies		= -1;
+    tpsp->tps_text = _vnamem_amalloc(&allocator,
+	    VNADATA_LOAD_INITIAL_TEXT_ALLOCATION);
+    if (tpsp->tps_text == NULL) {
 	_vnadata_error(vdip, VNAERR_SYSTEM,
 		"malloc: %s", strerror(errno));
 	goto out;
     }
-    tps.tps_text_allocation = VNADATA_LOAD_INITIAL_TEXT_ALLOCATION;
-    next_char(&tps);
-    if (next_token(&tps, F_NONE) == -1)
+    tpsp->tps_text_allocation = VNADATA_LOAD_INITIAL_TEXT_ALLOCATION;
+    tpsp->tps_buffer = _vnamem_amalloc(&allocator, VNADATA_LOAD_BUFFER_SIZE);
+    if (tpsp->tps_buffer == NULL) {
+	_vnadata_error(vdip, VNAERR_SYSTEM,
+		"malloc: %s", strerror(errno));
+	goto out;
+    }
+    tpsp->tps_next = tpsp->tps_buffer;
+    tpsp->tps_end  = tpsp->tps_buffer;
+    next_char(tpsp);
+    if (next_token(tpsp, F_NONE) == -1)
 	goto out;
-
     /*
      * Parse the [Version] line if present.
      */
-    if (tps.tps_token == T_KW_VERSION) {
+    if (tpsp->tps_token == T_KW_VERSION) {
 	double value;
 	char *endptr;
 
-	if (next_token(&tps, F_NOCONV) == -1) {
+	if (next_token(tpsp, F_NOCONV) == -1) {
 	    goto out;
 	}
-	if (tps.tps_token != T_WORD) {
+	if (tpsp->tps_token != T_WORD) {
 	    _vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
-		    "expected version number; found %s",
-		tps.tps_filename, tps.tps_line, get_token_name(&tps));
+		    "expected tpsp->tps_version number; found %s",
+		tpsp->tps_filename, tpsp->tps_line, get_token_name(tpsp));
 	    goto out;
 	}
-	value = strtod(tps.tps_text, &endptr);
-	if (endptr != tps.tps_text && *endptr != '\000') {
+	value = strtod(tpsp->tps_text, &endptr);
+	if (endptr != tpsp->tps_text && *endptr != '\000') {
 	    value = 0.0;	/* invalid if, e.g. "2.0a" */
 	}
 	if (value == 2.0) {
-	    version = 2;
+	    tpsp->tps_version = 2;
 
 	} else if (value >= 1.0 && value < 2.0) {
 	    _vnadata_error(vdip, VNAERR_WARNING, "%s (line %d) warning: "
 		    "Touchstone file contains dubious [Version] 1.x line",
-		    tps.tps_filename, tps.tps_line);
-	    version = 1;
+		    tpsp->tps_filename, tpsp->tps_line);
+	    tpsp->tps_version = 1;
 
 	} else {
 	    _vnadata_error(vdip, VNAERR_VERSION, "%s (line %d) error: "
-		    "unsupported Touchstone version %s",
-		    tps.tps_filename, tps.tps_line, tps.tps_text);
+		    "unsupported Touchstone tpsp->tps_version %s",
+		    tpsp->tps_filename, tpsp->tps_line, tpsp->tps_text);
 	    goto out;
 	}
-	if (next_token(&tps, F_NONE) == -1) {
+	if (next_token(tpsp, F_NONE) == -1) {
 	    goto out;
 	}
     }
@@ -1078,120 +1695,120 @@ int _vnadata_load_touchstone(vnadata_internal_t *vdip, FILE *fp,
     /*
      * Parse the option line.
      */
-    if (tps.tps_token != T_OPTION) {
+    if (tpsp->tps_token != T_OPTION) {
 	_vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
 		"expected # option line; found %s",
-	    tps.tps_filename, tps.tps_line, get_token_name(&tps));
+	    tpsp->tps_filename, tpsp->tps_line, get_token_name(tpsp));
 	goto out;
     }
-    if (next_token(&tps, F_NONE) == -1) {
+    if (next_token(tpsp, F_NONE) == -1) {
 	goto out;
     }
-    while (tps.tps_token != T_EOL) {
-	switch (tps.tps_token) {
+    while (tpsp->tps_token != T_EOL) {
+	switch (tpsp->tps_token) {
 	case T_OP_HZ:
-	    tps.tps_frequency_multiplier = 1.0;
-	    if (next_token(&tps, F_NONE) == -1) {
+	    tpsp->tps_frequency_multiplier = 1.0;
+	    if (next_token(tpsp, F_NONE) == -1) {
 		goto out;
 	    }
 	    continue;
 
 	case T_OP_KHZ:
-	    tps.tps_frequency_multiplier = 1.0e+3;
-	    if (next_token(&tps, F_NONE) == -1) {
+	    tpsp->tps_frequency_multiplier = 1.0e+3;
+	    if (next_token(tpsp, F_NONE) == -1) {
 		goto out;
 	    }
 	    continue;
 
 	case T_OP_MHZ:
-	    tps.tps_frequency_multiplier = 1.0e+6;
-	    if (next_token(&tps, F_NONE) == -1) {
+	    tpsp->tps_frequency_multiplier = 1.0e+6;
+	    if (next_token(tpsp, F_NONE) == -1) {
 		goto out;
 	    }
 	    continue;
 
 	case T_OP_GHZ:
-	    tps.tps_frequency_multiplier = 1.0e+9;
-	    if (next_token(&tps, F_NONE) == -1) {
+	    tpsp->tps_frequency_multiplier = 1.0e+9;
+	    if (next_token(tpsp, F_NONE) == -1) {
 		goto out;
 	    }
 	    continue;
 
 	case T_OP_THZ:	/* non-standard */
-	    tps.tps_frequency_multiplier = 1.0e+12;
-	    if (next_token(&tps, F_NONE) == -1) {
+	    tpsp->tps_frequency_multiplier = 1.0e+12;
+	    if (next_token(tpsp, F_NONE) == -1) {
 		goto out;
 	    }
 	    continue;
 
 	case T_OP_S:
-	    tps.tps_parameter_type = VPT_S;
-	    if (next_token(&tps, F_NONE) == -1) {
+	    tpsp->tps_parameter_type = VPT_S;
+	    if (next_token(tpsp, F_NONE) == -1) {
 		goto out;
 	    }
 	    continue;
 
 	case T_OP_Y:
-	    tps.tps_parameter_type = VPT_Y;
-	    if (next_token(&tps, F_NONE) == -1) {
+	    tpsp->tps_parameter_type = VPT_Y;
+	    if (next_token(tpsp, F_NONE) == -1) {
 		goto out;
 	    }
 	    continue;
 
 	case T_OP_Z:
-	    tps.tps_parameter_type = VPT_Z;
-	    if (next_token(&tps, F_NONE) == -1) {
+	    tpsp->tps_parameter_type = VPT_Z;
+	    if (next_token(tpsp, F_NONE) == -1) {
 		goto out;
 	    }
 	    continue;
 
 	case T_OP_H:
-	    tps.tps_parameter_type = VPT_H;
-	    if (next_token(&tps, F_NONE) == -1) {
+	    tpsp->tps_parameter_type = VPT_H;
+	    if (next_token(tpsp, F_NONE) == -1) {
 		goto out;
 	    }
 	    continue;
 
 	case T_OP_G:
-	    tps.tps_parameter_type = VPT_G;
-	    if (next_token(&tps, F_NONE) == -1) {
+	    tpsp->tps_parameter_type = VPT_G;
+	    if (next_token(tpsp, F_NONE) == -1) {
 		goto out;
 	    }
 	    continue;
 
 	case T_OP_DB:
-	    tps.tps_data_format = 'D';
-	    if (next_token(&tps, F_NONE) == -1) {
+	    tpsp->tps_data_format = 'D';
+	    if (next_token(tpsp, F_NONE) == -1) {
 		goto out;
 	    }
 	    continue;
 
 	case T_OP_MA:
-	    tps.tps_data_format = 'M';
-	    if (next_token(&tps, F_NONE) == -1) {
+	    tpsp->tps_data_format = 'M';
+	    if (next_token(tpsp, F_NONE) == -1) {
 		goto out;
 	    }
 	    continue;
 
 	case T_OP_RI:
-	    tps.tps_data_format = 'R';
-	    if (next_token(&tps, F_NONE) == -1) {
+	    tpsp->tps_data_format = 'R';
+	    if (next_token(tpsp, F_NONE) == -1) {
 		goto out;
 	    }
 	    continue;
 
 	case T_OP_R:
-	    if (next_token(&tps, F_NONE) == -1) {
+	    if (next_token(tpsp, F_NONE) == -1) {
 		goto out;
 	    }
-	    if (tps.tps_token != T_DOUBLE) {
+	    if (tpsp->tps_token != T_DOUBLE) {
 		_vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
 			"expected an impedance value after R",
-		    tps.tps_filename, tps.tps_line);
+		    tpsp->tps_filename, tpsp->tps_line);
 		goto out;
 	    }
-	    tps.tps_z0 = tps.u.tps_double;
-	    if (next_token(&tps, F_NONE) == -1) {
+	    tpsp->tps_z0 = tpsp->u.tps_double;
+	    if (next_token(tpsp, F_NONE) == -1) {
 		goto out;
 	    }
 	    continue;
@@ -1202,12 +1819,12 @@ int _vnadata_load_touchstone(vnadata_internal_t *vdip, FILE *fp,
 	default:
 	    _vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
 		    "unexpected token \"%s\" in option line",
-		tps.tps_filename, tps.tps_line, get_token_name(&tps));
+		tpsp->tps_filename, tpsp->tps_line, get_token_name(tpsp));
 	    goto out;
 	}
     }
-    if (tps.tps_token == T_EOL) {
-	if (next_token(&tps, F_NONE) == -1) {
+    if (tpsp->tps_token == T_EOL) {
+	if (next_token(tpsp, F_NONE) == -1) {
 	    goto out;
 	}
     }
@@ -1216,140 +1833,140 @@ int _vnadata_load_touchstone(vnadata_internal_t *vdip, FILE *fp,
      * Parse additional V2 keywords.
      */
     for (;;) {
-	switch (tps.tps_token) {
+	switch (tpsp->tps_token) {
 	case T_KW_NUMBER_OF_PORTS:
-	    if (next_token(&tps, F_INT) == -1) {
+	    if (next_token(tpsp, F_INT) == -1) {
 		goto out;
 	    }
-	    if (tps.tps_token != T_INT || tps.u.tps_int < 0) {
+	    if (tpsp->tps_token != T_INT || tpsp->u.tps_int < 0) {
 		_vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
 			"expected a positive integer after [Number of Ports]",
-		    tps.tps_filename, tps.tps_line);
+		    tpsp->tps_filename, tpsp->tps_line);
 		goto out;
 	    }
-	    tps.tps_ports = tps.u.tps_int;
-	    if (tps.tps_ports != 2 &&
-		    (tps.tps_parameter_type == VPT_G ||
-		     tps.tps_parameter_type == VPT_H)) {
+	    tpsp->tps_ports = tpsp->u.tps_int;
+	    if (tpsp->tps_ports != 2 &&
+		    (tpsp->tps_parameter_type == VPT_G ||
+		     tpsp->tps_parameter_type == VPT_H)) {
 		_vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
 			"parameter type %s is incompatible with "
 			"[Number of Ports] %d",
-			tps.tps_filename, tps.tps_line,
-			vnadata_get_type_name(tps.tps_parameter_type),
-			tps.tps_ports);
+			tpsp->tps_filename, tpsp->tps_line,
+			vnadata_get_type_name(tpsp->tps_parameter_type),
+			tpsp->tps_ports);
 		goto out;
 	    }
-	    if (next_token(&tps, F_NONE) == -1) {
+	    if (next_token(tpsp, F_NONE) == -1) {
 		goto out;
 	    }
 	    continue;
 
 	case T_KW_TWO_PORT_ORDER:
-	    two_port_order_line = tps.tps_line;
-	    if (next_token(&tps, F_NOCONV) == -1) {
+	    two_port_order_line = tpsp->tps_line;
+	    if (next_token(tpsp, F_NOCONV) == -1) {
 		goto out;
 	    }
-	    if (tps.tps_token == T_WORD &&
-		    strcmp(tps.tps_text, "12_21") == 0) {
-		two_port_order = T12_21;
-	    } else if (tps.tps_token == T_WORD &&
-		    strcmp(tps.tps_text, "21_12") == 0) {
-		two_port_order = T21_12;
+	    if (tpsp->tps_token == T_WORD &&
+		    strcmp(tpsp->tps_text, "12_21") == 0) {
+		tpsp->tps_two_port_order = T12_21;
+	    } else if (tpsp->tps_token == T_WORD &&
+		    strcmp(tpsp->tps_text, "21_12") == 0) {
+		tpsp->tps_two_port_order = T21_12;
 	    } else {
 		_vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
 			"expected 12_21 or 21_12 after [Two-Port Order]",
-		    tps.tps_filename, tps.tps_line);
+		    tpsp->tps_filename, tpsp->tps_line);
 		goto out;
 	    }
-	    if (next_token(&tps, F_NONE) == -1) {
+	    if (next_token(tpsp, F_NONE) == -1) {
 		goto out;
 	    }
 	    continue;
 
 	case T_KW_NUMBER_OF_FREQUENCIES:
-	    if (next_token(&tps, F_INT) == -1) {
+	    if (next_token(tpsp, F_INT) == -1) {
 		goto out;
 	    }
-	    if (tps.tps_token != T_INT) {
+	    if (tpsp->tps_token != T_INT) {
 		_vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
 			"expected a positive integer after "
 			"[Number of Frequencies]",
-		    tps.tps_filename, tps.tps_line);
+		    tpsp->tps_filename, tpsp->tps_line);
 		goto out;
 	    }
-	    number_of_frequencies = tps.u.tps_int;
-	    if (next_token(&tps, F_NONE) == -1) {
+	    tpsp->tps_frequencies = tpsp->u.tps_int;
+	    if (next_token(tpsp, F_NONE) == -1) {
 		goto out;
 	    }
 	    continue;
 
 	case T_KW_NUMBER_OF_NOISE_FREQUENCIES:
-	    if (next_token(&tps, F_INT) == -1) {
+	    if (next_token(tpsp, F_INT) == -1) {
 		goto out;
 	    }
-	    if (tps.tps_token != T_INT || tps.u.tps_int < 0) {
+	    if (tpsp->tps_token != T_INT || tpsp->u.tps_int < 0) {
 		_vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
 			"expected a positive integer after "
 			"[Number of Noise Frequencies]",
-		    tps.tps_filename, tps.tps_line);
+		    tpsp->tps_filename, tpsp->tps_line);
 		goto out;
 	    }
-	    number_of_noise_frequencies = tps.u.tps_int;
-	    if (next_token(&tps, F_NONE) == -1) {
+	    tpsp->tps_noise_frequencies = tpsp->u.tps_int;
+	    if (next_token(tpsp, F_NONE) == -1) {
 		goto out;
 	    }
 	    continue;
 
 	case T_KW_REFERENCE:
-	    if (tps.tps_ports < 0) {
+	    if (tpsp->tps_ports < 0) {
 		_vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
 			"[Number of Ports] must appear before [Reference]",
-		    tps.tps_filename, tps.tps_line);
+		    tpsp->tps_filename, tpsp->tps_line);
 		goto out;
 	    }
-	    if ((reference = calloc(tps.tps_ports,
+	    if ((reference = _vnamem_calloc(tpsp->tps_ports,
 			    sizeof(double complex))) == NULL) {
 		_vnadata_error(vdip, VNAERR_SYSTEM,
 			"calloc: %s", strerror(errno));
 		goto out;
 	    }
-	    if (next_token(&tps, F_NONE) == -1) {
+	    if (next_token(tpsp, F_NONE) == -1) {
 		goto out;
 	    }
-	    for (int i = 0; i < tps.tps_ports; ++i) {
-		if (tps.tps_token != T_DOUBLE) {
+	    for (int i = 0; i < tpsp->tps_ports; ++i) {
+		if (tpsp->tps_token != T_DOUBLE) {
 		    _vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
 			    "expected %d values(s) after [Reference]",
-			tps.tps_filename, tps.tps_line, tps.tps_ports);
+			tpsp->tps_filename, tpsp->tps_line, tpsp->tps_ports);
 		    goto out;
 		}
-		reference[i] = tps.u.tps_double;
-		if (next_token(&tps, F_NONE) == -1) {
+		reference[i] = tpsp->u.tps_double;
+		if (next_token(tpsp, F_NONE) == -1) {
 		    goto out;
 		}
 	    }
 	    continue;
 
 	case T_KW_MATRIX_FORMAT:
-	    if (next_token(&tps, F_NOCONV) == -1) {
+	    if (next_token(tpsp, F_NOCONV) == -1) {
 		goto out;
 	    }
-	    if (tps.tps_token == T_WORD &&
-		    strcmp(tps.tps_text, "FULL") == 0) {
-		matrix_format = 'F';
-	    } else if (tps.tps_token == T_WORD &&
-		    strcmp(tps.tps_text, "UPPER") == 0) {
-		matrix_format = 'U';
-	    } else if (tps.tps_token == T_WORD &&
-		    strcmp(tps.tps_text, "LOWER") == 0) {
-		matrix_format = 'L';
+	    if (tpsp->tps_token == T_WORD &&
+		    strcmp(tpsp->tps_text, "FULL") == 0) {
+		tpsp->tps_matrix_format = 'F';
+	    } else if (tpsp->tps_token == T_WORD &&
+		    strcmp(tpsp->tps_text, "UPPER") == 0) {
+		tpsp->tps_matrix_format = 'U';
+	    } else if (tpsp->tps_token == T_WORD &&
+		    strcmp(tpsp->tps_text, "LOWER") == 0) {
+		tpsp->tps_matrix_format = 'L';
 	    } else {
 		_vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
 			"expected Full, Upper or Lower after [Matrix Format]",
-		    tps.tps_filename, tps.tps_line);
+		    tpsp->tps_filename, tpsp->tps_line);
 		goto out;
 	    }
-	    if (next_token(&tps, F_NONE) == -1) {
+	    if (next_token(tpsp, F_NONE) == -1) {
 		goto out;
 	    }
 	    continue;
@@ -1357,15 +1974,15 @@ int _vnadata_load_touchstone(vnadata_internal_t *vdip, FILE *fp,
 	case T_KW_MIXED_MODE_ORDER:
 	    _vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
 		    "[Mixed-Mode Order] not yet supported",
-		tps.tps_filename, tps.tps_line);
+		tpsp->tps_filename, tpsp->tps_line);
 	    goto out;
 
 	case T_KW_BEGIN_INFORMATION:
-	    if (next_token(&tps, F_NONE) == -1) {
+	    if (next_token(tpsp, F_NONE) == -1) {
 		goto out;
 	    }
-	    if (tps.tps_token == T_KW_END_INFORMATION) {	/* optional */
-		if (next_token(&tps, F_NONE) == -1) {
+	    if (tpsp->tps_token == T_KW_END_INFORMATION) {	/* optional */
+		if (next_token(tpsp, F_NONE) == -1) {
 		    goto out;
 		}
 	    }
@@ -1384,11 +2001,11 @@ int _vnadata_load_touchstone(vnadata_internal_t *vdip, FILE *fp,
 	vnadata_format_t format_type;
 
 	/* set the file type */
-	vdip->vdi_filetype = (version == 2) ?
+	vdip->vdi_filetype = (tpsp->tps_version == 2) ?
 	    VNADATA_FILETYPE_TOUCHSTONE2 : VNADATA_FILETYPE_TOUCHSTONE1;
 
 	/* set the format string */
-	switch (tps.tps_data_format) {
+	switch (tpsp->tps_data_format) {
 	case 'D':
 	    format_type = VNADATA_FORMAT_DB_ANGLE;
 	    break;
@@ -1401,7 +2018,7 @@ int _vnadata_load_touchstone(vnadata_internal_t *vdip, FILE *fp,
 	default:
 	    abort();
 	}
-	if (_vnadata_set_simple_format(vdip, tps.tps_parameter_type,
+	if (_vnadata_set_simple_format(vdip, tpsp->tps_parameter_type,
 		    format_type) == -1) {
 	    _vnadata_error(vdip, VNAERR_SYSTEM,
 		    "malloc: %s", strerror(errno));
@@ -1410,65 +2027,76 @@ int _vnadata_load_touchstone(vnadata_internal_t *vdip, FILE *fp,
     }
 
     /*
-     * If version 1, call the V1 parser.  We've seen examples of files
+     * If version 1, use the V1 parser.  We've seen examples of files
      * that begin with an illegal [Version] 1.0 keyword followed by
      * other V2 keywords.  We'll tolerate those and parse V1 using the
      * V2 parser if all the required V2 keywords are present.  The most
      * significant difference between this hybrid format from V2 is that
-     * we unnormalize the data at the end.
+     * we unnormalize the data.
      */
-    if (version == 1 && tps.tps_ports == -1 && number_of_frequencies == -1
-	    && two_port_order == -1) {
-	rc = load_touchstone1(&tps);
-	goto expect_eof;
+    if (tpsp->tps_version == 1 && tpsp->tps_ports == -1 &&
+	    tpsp->tps_frequencies == -1 && tpsp->tps_two_port_order == -1) {
+	tpsp->tps_v1_data = true;
+	if (start_touchstone1(tpsp) == -1) {
+	    goto out;
+	}
+	if (vnadata_init(vdp, tpsp->tps_parameter_type, tpsp->tps_ports,
+		    tpsp->tps_ports, /*frequencies*/0) == -1) {
+	    _vnadata_error(vdip, VNAERR_SYSTEM,
+		    "realloc: %s", strerror(errno));
+	    goto out;
+	}
+	(void)vnadata_set_all_z0(vdp, tpsp->tps_z0);
+	*frequencies = -1;
+	return tpsp;
     }
 
     /*
      * Expect [Network Data].
      */
-    if (tps.tps_token != T_KW_NETWORK_DATA) {
+    if (tpsp->tps_token != T_KW_NETWORK_DATA) {
 	_vnadata_error(vdip, VNAERR_SYNTAX,
 		"%s (line %d) error: unexpected token %s",
-	    tps.tps_filename, tps.tps_line, get_token_name(&tps));
+	    tpsp->tps_filename, tpsp->tps_line, get_token_name(tpsp));
 	goto out;
     }
-    if (next_token(&tps, F_NONE) == -1) {
+    if (next_token(tpsp, F_NONE) == -1) {
 	goto out;
     }
 
     /*
      * Make sure all required parameters were given.
      */
-    if (tps.tps_ports < 0) {
+    if (tpsp->tps_ports < 0) {
 	_vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
 		"[Number of Ports] must appear before [Network Data]",
-		tps.tps_filename, tps.tps_line);
+		tpsp->tps_filename, tpsp->tps_line);
 	goto out;
     }
-    if (number_of_frequencies < 0) {
+    if (tpsp->tps_frequencies < 0) {
 	_vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
 		"[Number of Frequencies] must appear before [Network Data]",
-		tps.tps_filename, tps.tps_line);
+		tpsp->tps_filename, tpsp->tps_line);
 	goto out;
     }
-    if (tps.tps_ports == 2 && two_port_order == -1) {
+    if (tpsp->tps_ports == 2 && tpsp->tps_two_port_order == -1) {
 	_vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
 		"[Two-Port Order] must appear before [Network Data]",
-		tps.tps_filename, tps.tps_line);
+		tpsp->tps_filename, tpsp->tps_line);
 	goto out;
 
-    } else if (tps.tps_ports != 2 && two_port_order != -1) {
+    } else if (tpsp->tps_ports != 2 && tpsp->tps_two_port_order != -1) {
 	_vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
 		"[Two-Port Order] may not be used with [Number of Ports] %d",
-		tps.tps_filename, two_port_order_line, tps.tps_ports);
+		tpsp->tps_filename, two_port_order_line, tpsp->tps_ports);
 	goto out;
     }
 
     /*
      * Set up the output matrix.
      */
-    if (vnadata_init(vdp, tps.tps_parameter_type, tps.tps_ports,
-		tps.tps_ports, number_of_frequencies) == -1) {
+    if (vnadata_init(vdp, tpsp->tps_parameter_type, tpsp->tps_ports,
+		tpsp->tps_ports, tpsp->tps_frequencies) == -1) {
 	_vnadata_error(vdip, VNAERR_SYSTEM,
 		"realloc: %s", strerror(errno));
 	goto out;
@@ -1479,205 +2107,187 @@ int _vnadata_load_touchstone(vnadata_internal_t *vdip, FILE *fp,
      */
     if (reference != NULL) {
 	(void)vnadata_set_z0_vector(vdp, reference);
+	_vnamem_free((void *)reference);
     } else {
-	(void)vnadata_set_all_z0(vdp, tps.tps_z0);
+	(void)vnadata_set_all_z0(vdp, tpsp->tps_z0);
     }
-
-    /*
-     * Parse [Network Data]
-     */
-    if (matrix_format == 'F') {
-	expected_pairs = tps.tps_ports * tps.tps_ports;
+    if (tpsp->tps_matrix_format == 'F') {
+	tpsp->tps_expected_pairs = tpsp->tps_ports * tpsp->tps_ports;
     } else {
-	expected_pairs = tps.tps_ports * (tps.tps_ports + 1) / 2;
+	tpsp->tps_expected_pairs =
+	    tpsp->tps_ports * (tpsp->tps_ports + 1) / 2;
     }
-    for (int findex = 0; findex < number_of_frequencies; ++findex) {
-	if (tps.tps_token != T_DOUBLE) {
-	    _vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
-		    "expected frequency",
-		    tps.tps_filename, tps.tps_line);
-	    goto out;
-	}
-	if (findex != 0 &&
-		tps.u.tps_double <= vnadata_get_frequency(vdp, findex - 1)) {
-	    _vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
-		    "frequencies must be in increasing order",
-		    tps.tps_filename, tps.tps_line);
-	    goto out;
-	}
-	(void)vnadata_set_frequency(vdp, findex,
-		tps.tps_frequency_multiplier * tps.u.tps_double);
-	if (next_token(&tps, F_NONE) == -1) {
-	    goto out;
-	}
-	switch (matrix_format) {
-	case 'F':	/* Full */
-	    for (int row = 0; row < tps.tps_ports; ++row) {
-		for (int column = 0; column < tps.tps_ports; ++column) {
-		    double complex x;
-
-		    if (parse_value_pair(&tps, expected_pairs, &x) == -1) {
-			goto out;
-		    }
-		    if (two_port_order == T21_12) {
-			(void)vnadata_set_cell(vdp, findex, column, row, x);
-		    } else {
-			(void)vnadata_set_cell(vdp, findex, row, column, x);
-		    }
-		}
-	    }
-	    break;
+    *frequencies = tpsp->tps_frequencies;
+    return tpsp;
 
-	case 'U':	/* Upper */
-	    for (int row = 0; row < tps.tps_ports; ++row) {
-		for (int column = row; column < tps.tps_ports; ++column) {
-		    double complex x;
-
-		    if (parse_value_pair(&tps, expected_pairs, &x) == -1) {
-			goto out;
-		    }
-		    (void)vnadata_set_cell(vdp, findex, row, column, x);
-		    (void)vnadata_set_cell(vdp, findex, column, row, x);
-		}
-	    }
-	    break;
-
-	case 'L':	/* Lower */
-	    for (int row = 0; row < tps.tps_ports; ++row) {
-		for (int column = 0; column <= row; ++column) {
-		    double complex x;
+out:
+    _vnamem_free((void *)reference);
+    _vnadata_touchstone_close(tpsp);
+    return NULL;
+}
 
-		    if (parse_value_pair(&tps, expected_pairs, &x) == -1) {
-			goto out;
-		    }
-		    (void)vnadata_set_cell(vdp, findex, row, column, x);
-		    (void)vnadata_set_cell(vdp, findex, column, row, x);
-		}
-	    }
-	    break;
+/*
+ * _vnadata_touchstone_next: parse the next record of a touchstone file
+ *   @tpsp: touchstone parser state structure
+ *   @frequency: address to receive the frequency
+ *   @matrix: serialized ports x ports matrix to receive the data
+ *
+ *   Return 1 if a record was parsed, 0 at the end of the file, or
+ *   -1 on error.
+ */
+int _vnadata_touchstone_next(ts_parser_state_t *tpsp, double *frequency,
+	double complex *matrix)
+{
+    vnadata_internal_t *vdip = tpsp->tps_vdip;
+    int rv;
 
-	default:
-	    abort();
-	}
+    if (tpsp->tps_done) {
+	return 0;
     }
-
-    /*
-     * Parse and discard noise data.
-     */
-    if (number_of_noise_frequencies >= 0) {
-	double f_prev = -1.0;
-
-	if (tps.tps_token != T_KW_NOISE_DATA) {
-	    _vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
-		    "expected [Noise Data]",
-		    tps.tps_filename, tps.tps_line);
-	    goto out;
-	}
-	if (next_token(&tps, F_NONE) == -1) {
-	    goto out;
-	}
-	for (int i = 0; i < number_of_noise_frequencies; ++i) {
-	    if (tps.tps_token != T_DOUBLE || tps.u.tps_double < 0.0) {
-		_vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
-			"expected non-negative noise frequency",
-			tps.tps_filename, tps.tps_line);
-		goto out;
-	    }
-	    if (i > 0 && tps.u.tps_double < f_prev) {
-		_vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
-			"noise frequencies be increasing",
-			tps.tps_filename, tps.tps_line);
-		goto out;
-	    }
-	    f_prev = tps.u.tps_double;
-	    if (next_token(&tps, F_NONE) == -1) {
-		goto out;
-	    }
-	    for (int j = 0; j < 4; ++j) {
-		if (tps.tps_token != T_DOUBLE) {
-		    _vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
-			    "expected five noise parameters",
-			    tps.tps_filename, tps.tps_line);
-		    goto out;
-		}
-		if (next_token(&tps, F_NONE) == -1) {
-		    goto out;
-		}
-	    }
+    if (tpsp->tps_v1_data) {
+	rv = next_touchstone1(tpsp, frequency, matrix);
+    } else {
+	rv = next_touchstone2(tpsp, frequency, matrix);
+    }
+    if (rv == 1) {
+	if (tpsp->tps_version == 1) {
+	    unnormalize(tpsp, matrix);
 	}
+	tpsp->tps_last_frequency = *frequency;
+	++tpsp->tps_findex;
+	return 1;
     }
-
-    /*
-     * Expect [End]
-     */
-    if (tps.tps_token == T_KW_END) {
-	if (next_token(&tps, F_NONE) == -1)
-	    goto out;
-
-    } else {
-	_vnadata_error(vdip, VNAERR_WARNING,
-		"%s (line %d) warning: expected [End] keyword",
-		tps.tps_filename, tps.tps_line);
+    if (rv == -1) {
+	return -1;
     }
 
     /*
      * Expect <EOF>
      */
-expect_eof:
-    if (tps.tps_token != T_EOF) {
+    if (tpsp->tps_token != T_EOF) {
 	_vnadata_error(vdip, VNAERR_SYNTAX, "%s (line %d) error: "
 		"extra token(s) at end of file: %s",
-		tps.tps_filename, tps.tps_line, get_token_name(&tps));
-	goto out;
+		tpsp->tps_filename, tpsp->tps_line, get_token_name(tpsp));
+	return -1;
     }
+    tpsp->tps_done = true;
+    return 0;
+}
 
-    /*
-     * If V1, unnormalize the data.
-     */
-    if (version == 1) {
-	switch (tps.tps_parameter_type) {
-	case VPT_S:
-	default:
-	    break;
+/*
+ * _vnadata_touchstone_skip: skip the next record of a touchstone file
+ *   @tpsp: touchstone parser state structure
+ *   @frequency: address to receive the frequency
+ *
+ *   Like _vnadata_touchstone_next, but scan the data values without
+ *   converting them.  Return 1 if a record was skipped, 0 at the end
+ *   of the network data, or -1 on error.  Trailing sections aren't
+ *   checked.
+ */
+int _vnadata_touchstone_skip(ts_parser_state_t *tpsp, double *frequency)
+{
+    int rv;
 
-	case VPT_Z:
-	    for (int findex = 0; findex < vdp->vd_frequencies; ++findex) {
-		for (int cell = 0; cell < tps.tps_ports * tps.tps_ports;
-			++cell) {
-		    vdp->vd_data[findex][cell] *= tps.tps_z0;
-		}
-	    }
-	    break;
+    if (tpsp->tps_done) {
+	return 0;
+    }
+    if (tpsp->tps_v1_data) {
+	rv = skip_touchstone1(tpsp, frequency);
+    } else if (tpsp->tps_findex >= tpsp->tps_frequencies) {
+	rv = 0;
+    } else {
+	rv = skip_touchstone2(tpsp, frequency);
+    }
+    if (rv == 1) {
+	tpsp->tps_last_frequency = *frequency;
+	++tpsp->tps_findex;
+	return 1;
+    }
+    if (rv == 0) {
+	tpsp->tps_done = true;
+    }
+    return rv;
+}
 
-	case VPT_Y:
-	    for (int findex = 0; findex < vdp->vd_frequencies; ++findex) {
-		for (int cell = 0; cell < tps.tps_ports * tps.tps_ports;
-			++cell) {
-		    vdp->vd_data[findex][cell] /= tps.tps_z0;
-		}
-	    }
-	    break;
+/*
+ * _vnadata_touchstone_tail: describe the unread records for a seek
+ *   @tpsp: touchstone parser state structure
+ *   @offset: address to receive the file offset of the unread input
+ *   @values: address to receive the number of values per record
+ *   @multiplier: address to receive the frequency multiplier
+ *
+ *   Return true if the input after *offset is known to hold the
+ *   values of the pending record and at least one more whole record,
+ *   followed by nothing but [End] and comments, so that the caller
+ *   can find the last frequency by reading back from the end of the
+ *   file.
+ */
+bool _vnadata_touchstone_tail(const ts_parser_state_t *tpsp, long *offset,
+	int *values, double *multiplier)
+{
+    long position;
 
-	case VPT_H:
-	    for (int findex = 0; findex < vdp->vd_frequencies; ++findex) {
-		vdp->vd_data[findex][0] *= tps.tps_z0;
-		vdp->vd_data[findex][3] /= tps.tps_z0;
-	    }
-	    break;
+    if (tpsp->tps_v1_data || tpsp->tps_done ||
+	    tpsp->tps_noise_frequencies >= 0 ||
+	    tpsp->tps_frequencies - tpsp->tps_findex < 2 ||
+	    tpsp->tps_token != T_DOUBLE) {
+	return false;
+    }
+    if (tpsp->tps_char != '\n' && !(CHAR_CLASS(tpsp->tps_char) & C_SPACE)) {
+	return false;
+    }
+    if ((position = ftell(tpsp->tps_fp)) == -1) {
+	return false;
+    }
+    *offset = position - (long)(tpsp->tps_end - tpsp->tps_next);
+    *values = 1 + 2 * tpsp->tps_expected_pairs;
+    *multiplier = tpsp->tps_frequency_multiplier;
+    return true;
+}
 
-	case VPT_G:
-	    for (int findex = 0; findex < vdp->vd_frequencies; ++findex) {
-		vdp->vd_data[findex][0] /= tps.tps_z0;
-		vdp->vd_data[findex][3] *= tps.tps_z0;
-	    }
+/*
+ * _vnadata_load_touchstone
+ *   @vdp: a pointer to the vnadata_t structure
+ *   @fp: file pointer
+ *   @filename: filename used in error messages and to intuit the file type
+ */
+int _vnadata_load_touchstone(vnadata_internal_t *vdip, FILE *fp,
+	const char *filename)
+{
+    vnadata_t *vdp = &vdip->vdi_vd;
+    ts_parser_state_t *tpsp;
+    double complex *matrix = NULL;
+    int frequencies;
+    int rc = -1;
+
+    if ((tpsp = _vnadata_touchstone_open(vdip, fp, filename,
+		    &frequencies)) == NULL) {
+	return -1;
+    }
+    if ((matrix = _vnamem_calloc(MAX(1, vdp->vd_rows * vdp->vd_columns),
+		    sizeof(double complex))) == NULL) {
+	_vnadata_error(vdip, VNAERR_SYSTEM,
+		"calloc: %s", strerror(errno));
+	goto out;
+    }
+    for (int findex = 0; ; ++findex) {
+	double f;
+	int rv;
+
+	if ((rv = _vnadata_touchstone_next(tpsp, &f, matrix)) == -1) {
+	    goto out;
+	}
+	if (rv == 0) {
 	    break;
 	}
+	if (_vnadata_store_record(vdip, findex, f, matrix, NULL) == -1) {
+	    goto out;
+	}
     }
     rc = 0;
 
 out:
-    free((void *)reference);
-    free((void *)tps.tps_text);
-    free((void *)tps.tps_value_vector);
+    _vnamem_free((void *)matrix);
+    _vnadata_touchstone_close(tpsp);
     return rc;
 }
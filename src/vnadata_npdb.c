@@ -0,0 +1,1316 @@
+/*
+ * Vector Network Analyzer Library
+ * Copyright © 2020-2023 D Scott Guthridge <scott_guthridge@rompromity.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "archdep.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(HAVE_MMAP) && defined(HAVE_SYS_MMAN_H)
+#define NPDB_CAN_MAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "vnacommon_internal.h"
+#include "vnadata_internal.h"
+#include "vnastats_internal.h"
+
+/*
+ * Binary network parameter data (.npdb) file layout
+ *
+ *   All values are little-endian.  Floating point values are IEEE 754
+ *   doubles; complex values are stored as the real part followed by
+ *   the imaginary part.  The file begins with a fixed-size header:
+ *
+ *	offset	size	field
+ *	     0	   8	magic number: 0x89 'N' 'P' 'D' 'B' '\r' '\n' 0x1a
+ *	     8	   4	format version (NPDB_VERSION)
+ *	    12	   4	size of the header, i.e. offset of the name
+ *	    16	   4	parameter type (vnadata_parameter_type_t)
+ *	    20	   4	rows
+ *	    24	   4	columns
+ *	    28	   4	frequencies
+ *	    32	   4	layout of the data block (vnadata_layout_t)
+ *	    36	   4	flags (NPDB_F_*)
+ *	    40	   4	frequency precision (signed)
+ *	    44	   4	data precision (signed)
+ *	    48	   4	length of the name, not including the NUL
+ *	    52	   4	length of the format string, not including the NUL
+ *	    56	   8	offset of the frequency vector
+ *	    64	   8	offset of the reference impedances
+ *	    72	   8	offset of the data
+ *	    80	   8	total size of the file
+ *	    88	  40	reserved, zero
+ *
+ *   The NUL-terminated name and format strings follow the header.
+ *   The frequency vector, reference impedances and data each start
+ *   at an offset that's a multiple of NPDB_ALIGNMENT.  The reference
+ *   impedances are a single vector of ports values or, if
+ *   NPDB_F_PER_F_Z0 is set, one such vector per frequency.  The data
+ *   are stored as the vectors of vd_data, one after the other, so
+ *   that a mapping of the file can be referenced directly.  Only a
+ *   user-assigned name is saved.  The format string is informational:
+ *   the data are always stored in the parameter type given above.
+ */
+#define NPDB_MAGIC		"\x89NPDB\r\n\x1a"
+#define NPDB_MAGIC_LENGTH	8
+#define NPDB_VERSION		1
+#define NPDB_HEADER_SIZE	128
+#define NPDB_ALIGNMENT		64
+#define NPDB_MAX_FORMAT		65535
+#define NPDB_F_PER_F_Z0		0x0001
+
+/*
+ * NPDB_ALIGN: round offset up to a multiple of NPDB_ALIGNMENT
+ */
+#define NPDB_ALIGN(offset) \
+	(((offset) + NPDB_ALIGNMENT - 1) & ~(uint64_t)(NPDB_ALIGNMENT - 1))
+
+/*
+ * npdb_header_t: decoded file header
+ */
+typedef struct npdb_header {
+    uint32_t nh_version;
+    uint32_t nh_header_size;
+    uint32_t nh_type;
+    uint32_t nh_rows;
+    uint32_t nh_columns;
+    uint32_t nh_frequencies;
+    uint32_t nh_layout;
+    uint32_t nh_flags;
+    int32_t  nh_fprecision;
+    int32_t  nh_dprecision;
+    uint32_t nh_name_length;
+    uint32_t nh_format_length;
+    uint64_t nh_frequency_offset;
+    uint64_t nh_z0_offset;
+    uint64_t nh_data_offset;
+    uint64_t nh_file_size;
+} npdb_header_t;
+
+/*
+ * npdb_io_t: position tracking for sequential reads and writes
+ */
+typedef struct npdb_io {
+    FILE *nio_fp;
+    const char *nio_filename;
+    uint64_t nio_position;
+} npdb_io_t;
+
+/*
+ * encode_header: serialize a header
+ *   @nhp: header to encode
+ *   @buffer: NPDB_HEADER_SIZE byte buffer to receive the result
+ */
+static void encode_header(const npdb_header_t *nhp, uint8_t *buffer)
+{
+    (void)memset((void *)buffer, 0, NPDB_HEADER_SIZE);
+    (void)memcpy((void *)buffer, NPDB_MAGIC, NPDB_MAGIC_LENGTH);
+    _vnacommon_put_u32(&buffer[ 8], nhp->nh_version);
+    _vnacommon_put_u32(&buffer[12], nhp->nh_header_size);
+    _vnacommon_put_u32(&buffer[16], nhp->nh_type);
+    _vnacommon_put_u32(&buffer[20], nhp->nh_rows);
+    _vnacommon_put_u32(&buffer[24], nhp->nh_columns);
+    _vnacommon_put_u32(&buffer[28], nhp->nh_frequencies);
+    _vnacommon_put_u32(&buffer[32], nhp->nh_layout);
+    _vnacommon_put_u32(&buffer[36], nhp->nh_flags);
+    _vnacommon_put_u32(&buffer[40], (uint32_t)nhp->nh_fprecision);
+    _vnacommon_put_u32(&buffer[44], (uint32_t)nhp->nh_dprecision);
+    _vnacommon_put_u32(&buffer[48], nhp->nh_name_length);
+    _vnacommon_put_u32(&buffer[52], nhp->nh_format_length);
+    _vnacommon_put_u64(&buffer[56], nhp->nh_frequency_offset);
+    _vnacommon_put_u64(&buffer[64], nhp->nh_z0_offset);
+    _vnacommon_put_u64(&buffer[72], nhp->nh_data_offset);
+    _vnacommon_put_u64(&buffer[80], nhp->nh_file_size);
+}
+
+/*
+ * decode_header: parse and validate a header
+ *   @vdip: internal parameter matrix (for error reporting)
+ *   @filename: filename used in error messages
+ *   @buffer: NPDB_HEADER_SIZE bytes read from the start of the file
+ *   @nhp: header to fill in
+ */
+static int decode_header(vnadata_internal_t *vdip, const char *filename,
+	const uint8_t *buffer, npdb_header_t *nhp)
+{
+    uint64_t ports, cells, z0_vectors, end;
+
+    if (memcmp((void *)buffer, NPDB_MAGIC, NPDB_MAGIC_LENGTH) != 0) {
+	_vnadata_error(vdip, VNAERR_SYNTAX, "%s: error: "
+		"not a binary network parameter data file", filename);
+	return -1;
+    }
+    nhp->nh_version	     = _vnacommon_get_u32(&buffer[ 8]);
+    nhp->nh_header_size	     = _vnacommon_get_u32(&buffer[12]);
+    nhp->nh_type	     = _vnacommon_get_u32(&buffer[16]);
+    nhp->nh_rows	     = _vnacommon_get_u32(&buffer[20]);
+    nhp->nh_columns	     = _vnacommon_get_u32(&buffer[24]);
+    nhp->nh_frequencies	     = _vnacommon_get_u32(&buffer[28]);
+    nhp->nh_layout	     = _vnacommon_get_u32(&buffer[32]);
+    nhp->nh_flags	     = _vnacommon_get_u32(&buffer[36]);
+    nhp->nh_fprecision	     = (int32_t)_vnacommon_get_u32(&buffer[40]);
+    nhp->nh_dprecision	     = (int32_t)_vnacommon_get_u32(&buffer[44]);
+    nhp->nh_name_length	     = _vnacommon_get_u32(&buffer[48]);
+    nhp->nh_format_length    = _vnacommon_get_u32(&buffer[52]);
+    nhp->nh_frequency_offset = _vnacommon_get_u64(&buffer[56]);
+    nhp->nh_z0_offset	     = _vnacommon_get_u64(&buffer[64]);
+    nhp->nh_data_offset	     = _vnacommon_get_u64(&buffer[72]);
+    nhp->nh_file_size	     = _vnacommon_get_u64(&buffer[80]);
+    if (nhp->nh_version != NPDB_VERSION) {
+	_vnadata_error(vdip, VNAERR_VERSION, "%s: error: "
+		"unsupported binary network parameter data version %u",
+		filename, (unsigned int)nhp->nh_version);
+	return -1;
+    }
+
+    /*
+     * Check the parameter type and dimensions.  The library checks
+     * type-specific constraints on the dimensions when we set them.
+     */
+    if (nhp->nh_type == VPT_UNDEF || nhp->nh_type >= VPT_NTYPES ||
+	    nhp->nh_rows < 1 || nhp->nh_columns < 1 ||
+	    nhp->nh_rows > INT_MAX || nhp->nh_columns > INT_MAX ||
+	    nhp->nh_frequencies > INT_MAX ||
+	    (uint64_t)nhp->nh_rows * nhp->nh_columns > INT_MAX) {
+	_vnadata_error(vdip, VNAERR_SYNTAX, "%s: error: "
+		"invalid parameter type or dimensions", filename);
+	return -1;
+    }
+    if (nhp->nh_layout != VNADATA_LAYOUT_FREQUENCY_MAJOR &&
+	    nhp->nh_layout != VNADATA_LAYOUT_CELL_MAJOR) {
+	_vnadata_error(vdip, VNAERR_SYNTAX, "%s: error: "
+		"invalid layout %u", filename, (unsigned int)nhp->nh_layout);
+	return -1;
+    }
+    if (nhp->nh_name_length > VNADATA_MAX_NAME ||
+	    nhp->nh_format_length > NPDB_MAX_FORMAT) {
+	_vnadata_error(vdip, VNAERR_SYNTAX, "%s: error: "
+		"invalid name or format length", filename);
+	return -1;
+    }
+
+    /*
+     * Check that the blocks are aligned, appear in order without
+     * overlapping, and fit in the file.  All sizes are bounded by the
+     * checks above, so none of the arithmetic below can overflow.
+     */
+    ports = MAX(nhp->nh_rows, nhp->nh_columns);
+    cells = (uint64_t)nhp->nh_rows * nhp->nh_columns;
+    z0_vectors = (nhp->nh_flags & NPDB_F_PER_F_Z0) ?
+	nhp->nh_frequencies : 1;
+    end = (uint64_t)nhp->nh_header_size + nhp->nh_name_length + 1 +
+	nhp->nh_format_length + 1;
+    if (nhp->nh_header_size < NPDB_HEADER_SIZE ||
+	    nhp->nh_frequency_offset % sizeof(double complex) != 0 ||
+	    nhp->nh_z0_offset % sizeof(double complex) != 0 ||
+	    nhp->nh_data_offset % sizeof(double complex) != 0 ||
+	    nhp->nh_frequency_offset < end ||
+	    nhp->nh_z0_offset < nhp->nh_frequency_offset +
+		(uint64_t)nhp->nh_frequencies * sizeof(double) ||
+	    nhp->nh_data_offset < nhp->nh_z0_offset +
+		z0_vectors * ports * sizeof(double complex) ||
+	    nhp->nh_data_offset > nhp->nh_file_size ||
+	    (nhp->nh_file_size - nhp->nh_data_offset) /
+		sizeof(double complex) / cells < nhp->nh_frequencies) {
+	_vnadata_error(vdip, VNAERR_SYNTAX, "%s: error: "
+		"inconsistent block offsets in header", filename);
+	return -1;
+    }
+    return 0;
+}
+
+/*
+ * read_bytes: read exactly length bytes
+ *   @vdip: internal parameter matrix
+ *   @niop: input state
+ *   @buffer: destination
+ *   @length: number of bytes to read
+ */
+static int read_bytes(vnadata_internal_t *vdip, npdb_io_t *niop,
+	void *buffer, size_t length)
+{
+    if (length != 0 && fread(buffer, 1, length, niop->nio_fp) != length) {
+	if (ferror(niop->nio_fp)) {
+	    _vnadata_error(vdip, VNAERR_SYSTEM, "fread: %s: %s",
+		    niop->nio_filename, strerror(errno));
+	} else {
+	    _vnadata_error(vdip, VNAERR_SYNTAX,
+		    "%s: error: unexpected end of file",
+		    niop->nio_filename);
+	}
+	return -1;
+    }
+    niop->nio_position += length;
+    _VNASTATS_ADD(_vnadata_stats, vds_load_bytes, length);
+    return 0;
+}
+
+/*
+ * skip_to: discard input up to the given offset
+ *   @vdip: internal parameter matrix
+ *   @niop: input state
+ *   @offset: file offset of the next block
+ */
+static int skip_to(vnadata_internal_t *vdip, npdb_io_t *niop,
+	uint64_t offset)
+{
+    uint8_t scratch[NPDB_ALIGNMENT];
+
+    while (niop->nio_position < offset) {
+	uint64_t length = offset - niop->nio_position;
+
+	if (length > sizeof(scratch)) {
+	    length = sizeof(scratch);
+	}
+	if (read_bytes(vdip, niop, (void *)scratch, length) == -1) {
+	    return -1;
+	}
+    }
+    return 0;
+}
+
+/*
+ * seek_to: position the input at the given offset
+ *   @vdip: internal parameter matrix
+ *   @niop: input state
+ *   @offset: file offset of the next block
+ *
+ *   Fall back to reading forward if the input isn't seekable.
+ */
+static int seek_to(vnadata_internal_t *vdip, npdb_io_t *niop,
+	uint64_t offset)
+{
+    if (offset <= LONG_MAX &&
+	    fseek(niop->nio_fp, (long)offset, SEEK_SET) == 0) {
+	niop->nio_position = offset;
+	return 0;
+    }
+    if (offset < niop->nio_position) {
+	_vnadata_error(vdip, VNAERR_SYSTEM, "fseek: %s: %s",
+		niop->nio_filename, strerror(errno));
+	return -1;
+    }
+    return skip_to(vdip, niop, offset);
+}
+
+/*
+ * read_doubles: read a vector of little-endian doubles
+ *   @vdip: internal parameter matrix
+ *   @niop: input state
+ *   @vector: destination
+ *   @count: number of doubles
+ */
+static int read_doubles(vnadata_internal_t *vdip, npdb_io_t *niop,
+	double *vector, size_t count)
+{
+    if (read_bytes(vdip, niop, (void *)vector,
+		count * sizeof(double)) == -1) {
+	return -1;
+    }
+    if (!_vnacommon_is_little_endian()) {
+	_vnacommon_swap_doubles(vector, count);
+    }
+    return 0;
+}
+
+/*
+ * _vnadata_load_npdb: load a binary network parameter data file
+ *   @vdip: internal parameter matrix
+ *   @fp: file pointer
+ *   @filename: filename used in error messages
+ */
+int _vnadata_load_npdb(vnadata_internal_t *vdip, FILE *fp,
+	const char *filename)
+{
+    vnadata_t *vdp = &vdip->vdi_vd;
+    npdb_io_t nio;
+    npdb_header_t header;
+    uint8_t buffer[NPDB_HEADER_SIZE];
+    char name[VNADATA_MAX_NAME + 1];
+    char *format = NULL;
+    double complex *vector = NULL;
+    int ports, cells, frequencies;
+    int file_outer, file_inner;
+    int rc = -1;
+
+    /*
+     * Read and check the header, name and format string.
+     */
+    (void)memset((void *)&nio, 0, sizeof(nio));
+    nio.nio_fp = fp;
+    nio.nio_filename = filename;
+    if (read_bytes(vdip, &nio, (void *)buffer, sizeof(buffer)) == -1) {
+	goto out;
+    }
+    if (decode_header(vdip, filename, buffer, &header) == -1) {
+	goto out;
+    }
+    if ((format = _vnamem_malloc(header.nh_format_length + 1)) == NULL) {
+	_vnadata_error(vdip, VNAERR_SYSTEM, "malloc: %s", strerror(errno));
+	goto out;
+    }
+    if (skip_to(vdip, &nio, header.nh_header_size) == -1 ||
+	    read_bytes(vdip, &nio, (void *)name,
+		header.nh_name_length + 1) == -1 ||
+	    read_bytes(vdip, &nio, (void *)format,
+		header.nh_format_length + 1) == -1) {
+	goto out;
+    }
+    if (name[header.nh_name_length] != '\000' ||
+	    format[header.nh_format_length] != '\000') {
+	_vnadata_error(vdip, VNAERR_SYNTAX, "%s: error: "
+		"unterminated name or format string", filename);
+	goto out;
+    }
+
+    /*
+     * Size the vnadata_t structure, keeping its current layout.
+     */
+    if (vnadata_init(vdp, (vnadata_parameter_type_t)header.nh_type,
+		header.nh_rows, header.nh_columns,
+		header.nh_frequencies) == -1) {
+	goto out;
+    }
+    ports = MAX(vdp->vd_rows, vdp->vd_columns);
+    cells = vdp->vd_rows * vdp->vd_columns;
+    frequencies = vdp->vd_frequencies;
+    if (header.nh_layout == VNADATA_LAYOUT_CELL_MAJOR) {
+	file_outer = cells;
+	file_inner = frequencies;
+    } else {
+	file_outer = frequencies;
+	file_inner = cells;
+    }
+    if ((vector = _vnamem_calloc(MAX(MAX(ports, file_inner), 1),
+		    sizeof(double complex))) == NULL) {
+	_vnadata_error(vdip, VNAERR_SYSTEM, "calloc: %s", strerror(errno));
+	goto out;
+    }
+
+    /*
+     * Read the frequency vector.
+     */
+    if (skip_to(vdip, &nio, header.nh_frequency_offset) == -1 ||
+	    read_doubles(vdip, &nio, vdp->vd_frequency_vector,
+		frequencies) == -1) {
+	goto out;
+    }
+
+    /*
+     * Read the reference impedances.
+     */
+    if (skip_to(vdip, &nio, header.nh_z0_offset) == -1) {
+	goto out;
+    }
+    if (header.nh_flags & NPDB_F_PER_F_Z0) {
+	for (int findex = 0; findex < frequencies; ++findex) {
+	    if (read_doubles(vdip, &nio, (double *)vector,
+			2 * ports) == -1) {
+		goto out;
+	    }
+	    if (vnadata_set_fz0_vector(vdp, findex, vector) == -1) {
+		goto out;
+	    }
+	}
+    } else {
+	if (read_doubles(vdip, &nio, (double *)vector, 2 * ports) == -1) {
+	    goto out;
+	}
+	if (vnadata_set_z0_vector(vdp, vector) == -1) {
+	    goto out;
+	}
+    }
+
+    /*
+     * Read the data.  If the file has the same layout as vdp, read
+     * directly into place; otherwise, read a vector at a time and
+     * scatter.
+     */
+    if (skip_to(vdip, &nio, header.nh_data_offset) == -1) {
+	goto out;
+    }
+    for (int i = 0; i < file_outer; ++i) {
+	if (header.nh_layout == vdp->vd_layout) {
+	    if (read_doubles(vdip, &nio, (double *)vdp->vd_data[i],
+			2 * file_inner) == -1) {
+		goto out;
+	    }
+	    continue;
+	}
+	if (read_doubles(vdip, &nio, (double *)vector,
+		    2 * file_inner) == -1) {
+	    goto out;
+	}
+	for (int j = 0; j < file_inner; ++j) {
+	    if (header.nh_layout == VNADATA_LAYOUT_CELL_MAJOR) {
+		*_vnadata_cell_address(vdp, j, i) = vector[j];
+	    } else {
+		*_vnadata_cell_address(vdp, i, j) = vector[j];
+	    }
+	}
+    }
+
+    /*
+     * Restore the name, format and precisions.
+     */
+    if (header.nh_name_length != 0 && vnadata_set_name(vdp, name) == -1) {
+	goto out;
+    }
+    if (vnadata_set_format(vdp, header.nh_format_length != 0 ?
+		format : NULL) == -1 ||
+	    vnadata_set_fprecision(vdp, header.nh_fprecision) == -1 ||
+	    vnadata_set_dprecision(vdp, header.nh_dprecision) == -1) {
+	goto out;
+    }
+    rc = 0;
+
+out:
+    _vnamem_free((void *)vector);
+    _vnamem_free((void *)format);
+    return rc;
+}
+
+/*
+ * _vnadata_probe_npdb: read the header of a binary network parameter file
+ *   @vdip: internal parameter matrix
+ *   @fp: file pointer
+ *   @filename: filename used in error messages
+ *   @frequencies: address to receive the number of frequencies
+ *   @fmin: address to receive the first frequency
+ *   @fmax: address to receive the last frequency
+ *   @fz0: address to receive true if the file has per-frequency z0
+ *
+ *   Initialize vdip from the header with zero frequencies, and read
+ *   only the end points of the frequency vector.
+ */
+int _vnadata_probe_npdb(vnadata_internal_t *vdip, FILE *fp,
+	const char *filename, int *frequencies, double *fmin, double *fmax,
+	bool *fz0)
+{
+    vnadata_t *vdp = &vdip->vdi_vd;
+    npdb_io_t nio;
+    npdb_header_t header;
+    uint8_t buffer[NPDB_HEADER_SIZE];
+    char name[VNADATA_MAX_NAME + 1];
+    char *format = NULL;
+    double complex *z0_vector = NULL;
+    int rc = -1;
+
+    (void)memset((void *)&nio, 0, sizeof(nio));
+    nio.nio_fp = fp;
+    nio.nio_filename = filename;
+    if (read_bytes(vdip, &nio, (void *)buffer, sizeof(buffer)) == -1) {
+	goto out;
+    }
+    if (decode_header(vdip, filename, buffer, &header) == -1) {
+	goto out;
+    }
+    if ((format = _vnamem_malloc(header.nh_format_length + 1)) == NULL) {
+	_vnadata_error(vdip, VNAERR_SYSTEM, "malloc: %s", strerror(errno));
+	goto out;
+    }
+    if (skip_to(vdip, &nio, header.nh_header_size) == -1 ||
+	    read_bytes(vdip, &nio, (void *)name,
+		header.nh_name_length + 1) == -1 ||
+	    read_bytes(vdip, &nio, (void *)format,
+		header.nh_format_length + 1) == -1) {
+	goto out;
+    }
+    if (name[header.nh_name_length] != '\000' ||
+	    format[header.nh_format_length] != '\000') {
+	_vnadata_error(vdip, VNAERR_SYNTAX, "%s: error: "
+		"unterminated name or format string", filename);
+	goto out;
+    }
+    if (vnadata_init(vdp, (vnadata_parameter_type_t)header.nh_type,
+		header.nh_rows, header.nh_columns, 0) == -1) {
+	goto out;
+    }
+
+    /*
+     * Read the first and last frequencies.
+     */
+    *frequencies = header.nh_frequencies;
+    *fmin = 0.0;
+    *fmax = 0.0;
+    if (header.nh_frequencies != 0) {
+	if (seek_to(vdip, &nio, header.nh_frequency_offset) == -1 ||
+		read_doubles(vdip, &nio, fmin, 1) == -1 ||
+		seek_to(vdip, &nio, header.nh_frequency_offset +
+		    (uint64_t)(header.nh_frequencies - 1) *
+		    sizeof(double)) == -1 ||
+		read_doubles(vdip, &nio, fmax, 1) == -1) {
+	    goto out;
+	}
+    }
+
+    /*
+     * Read the reference impedances unless they vary by frequency.
+     */
+    *fz0 = (header.nh_flags & NPDB_F_PER_F_Z0) != 0;
+    if (!*fz0) {
+	int ports = MAX(vdp->vd_rows, vdp->vd_columns);
+
+	if ((z0_vector = _vnamem_calloc(ports,
+			sizeof(double complex))) == NULL) {
+	    _vnadata_error(vdip, VNAERR_SYSTEM, "calloc: %s",
+		    strerror(errno));
+	    goto out;
+	}
+	if (seek_to(vdip, &nio, header.nh_z0_offset) == -1 ||
+		read_doubles(vdip, &nio, (double *)z0_vector,
+		    2 * ports) == -1) {
+	    goto out;
+	}
+	if (vnadata_set_z0_vector(vdp, z0_vector) == -1) {
+	    goto out;
+	}
+    }
+    if (header.nh_name_length != 0 && vnadata_set_name(vdp, name) == -1) {
+	goto out;
+    }
+    if (vnadata_set_format(vdp, header.nh_format_length != 0 ?
+		format : NULL) == -1 ||
+	    vnadata_set_fprecision(vdp, header.nh_fprecision) == -1 ||
+	    vnadata_set_dprecision(vdp, header.nh_dprecision) == -1) {
+	goto out;
+    }
+    rc = 0;
+
+out:
+    _vnamem_free((void *)z0_vector);
+    _vnamem_free((void *)format);
+    return rc;
+}
+
+/*
+ * write_bytes: write bytes, tracking the position
+ *   @niop: output state
+ *   @buffer: data to write
+ *   @length: number of bytes
+ */
+static int write_bytes(npdb_io_t *niop, const void *buffer, size_t length)
+{
+    if (length != 0 && fwrite(buffer, 1, length, niop->nio_fp) != length) {
+	return -1;
+    }
+    niop->nio_position += length;
+    return 0;
+}
+
+/*
+ * write_padding: write zero bytes up to the given offset
+ *   @niop: output state
+ *   @offset: file offset of the next block
+ */
+static int write_padding(npdb_io_t *niop, uint64_t offset)
+{
+    static const uint8_t zeros[NPDB_ALIGNMENT];
+
+    while (niop->nio_position < offset) {
+	size_t length = MIN(offset - niop->nio_position, sizeof(zeros));
+
+	if (write_bytes(niop, (const void *)zeros, length) == -1) {
+	    return -1;
+	}
+    }
+    return 0;
+}
+
+/*
+ * write_doubles: write a vector of doubles little-endian
+ *   @niop: output state
+ *   @vector: values to write
+ *   @count: number of doubles
+ */
+static int write_doubles(npdb_io_t *niop, const double *vector, size_t count)
+{
+    double chunk[256];
+
+    if (_vnacommon_is_little_endian()) {
+	return write_bytes(niop, (const void *)vector,
+		count * sizeof(double));
+    }
+    while (count != 0) {
+	size_t n = MIN(count, sizeof(chunk) / sizeof(double));
+
+	(void)memcpy((void *)chunk, (void *)vector, n * sizeof(double));
+	_vnacommon_swap_doubles(chunk, n);
+	if (write_bytes(niop, (const void *)chunk,
+		    n * sizeof(double)) == -1) {
+	    return -1;
+	}
+	vector += n;
+	count -= n;
+    }
+    return 0;
+}
+
+/*
+ * _vnadata_save_npdb: save in binary network parameter data format
+ *   @vdip: internal parameter matrix
+ *   @fp: file pointer
+ *   @filename: filename used in error messages
+ */
+int _vnadata_save_npdb(vnadata_internal_t *vdip, FILE *fp,
+	const char *filename)
+{
+    const vnadata_t *vdp = &vdip->vdi_vd;
+    const char *name = (vdip->vdi_flags & VF_NAME_SET) ?
+	vdip->vdi_name : "";
+    const char *format = vdip->vdi_format_string != NULL ?
+	vdip->vdi_format_string : "";
+    const bool per_f_z0 = (vdip->vdi_flags & VF_PER_F_Z0) != 0;
+    const int ports = MAX(vdp->vd_rows, vdp->vd_columns);
+    const int cells = vdp->vd_rows * vdp->vd_columns;
+    const int frequencies = vdp->vd_frequencies;
+    int outer, inner;
+    npdb_header_t header;
+    npdb_io_t nio;
+    uint8_t buffer[NPDB_HEADER_SIZE];
+
+    if (strlen(format) > NPDB_MAX_FORMAT) {
+	_vnadata_error(vdip, VNAERR_USAGE,
+		"%s: error: format string too long", filename);
+	return -1;
+    }
+    if (vdp->vd_layout == VNADATA_LAYOUT_CELL_MAJOR) {
+	outer = cells;
+	inner = frequencies;
+    } else {
+	outer = frequencies;
+	inner = cells;
+    }
+
+    /*
+     * Lay out the file.
+     */
+    (void)memset((void *)&header, 0, sizeof(header));
+    header.nh_version		= NPDB_VERSION;
+    header.nh_header_size	= NPDB_HEADER_SIZE;
+    header.nh_type		= vdp->vd_type;
+    header.nh_rows		= vdp->vd_rows;
+    header.nh_columns		= vdp->vd_columns;
+    header.nh_frequencies	= frequencies;
+    header.nh_layout		= vdp->vd_layout;
+    header.nh_flags		= per_f_z0 ? NPDB_F_PER_F_Z0 : 0;
+    header.nh_fprecision	= vdip->vdi_fprecision;
+    header.nh_dprecision	= vdip->vdi_dprecision;
+    header.nh_name_length	= strlen(name);
+    header.nh_format_length	= strlen(format);
+    header.nh_frequency_offset	= NPDB_ALIGN((uint64_t)NPDB_HEADER_SIZE +
+	    header.nh_name_length + 1 + header.nh_format_length + 1);
+    header.nh_z0_offset		= NPDB_ALIGN(header.nh_frequency_offset +
+	    (uint64_t)frequencies * sizeof(double));
+    header.nh_data_offset	= NPDB_ALIGN(header.nh_z0_offset +
+	    (uint64_t)(per_f_z0 ? frequencies : 1) * ports *
+	    sizeof(double complex));
+    header.nh_file_size		= header.nh_data_offset +
+	(uint64_t)outer * inner * sizeof(double complex);
+    encode_header(&header, buffer);
+
+    /*
+     * Write the header and blocks.
+     */
+    (void)memset((void *)&nio, 0, sizeof(nio));
+    nio.nio_fp = fp;
+    nio.nio_filename = filename;
+    if (write_bytes(&nio, (const void *)buffer, sizeof(buffer)) == -1 ||
+	    write_bytes(&nio, (const void *)name,
+		header.nh_name_length + 1) == -1 ||
+	    write_bytes(&nio, (const void *)format,
+		header.nh_format_length + 1) == -1 ||
+	    write_padding(&nio, header.nh_frequency_offset) == -1 ||
+	    write_doubles(&nio, vdp->vd_frequency_vector,
+		frequencies) == -1 ||
+	    write_padding(&nio, header.nh_z0_offset) == -1) {
+	goto error;
+    }
+    if (per_f_z0) {
+	for (int findex = 0; findex < frequencies; ++findex) {
+	    if (write_doubles(&nio, (const double *)
+			vdip->vdi_z0_vector_vector[findex], 2 * ports) == -1) {
+		goto error;
+	    }
+	}
+    } else {
+	if (write_doubles(&nio, (const double *)vdip->vdi_z0_vector,
+		    2 * ports) == -1) {
+	    goto error;
+	}
+    }
+    if (write_padding(&nio, header.nh_data_offset) == -1) {
+	goto error;
+    }
+    for (int i = 0; i < outer; ++i) {
+	if (write_doubles(&nio, (const double *)vdp->vd_data[i],
+		    2 * inner) == -1) {
+	    goto error;
+	}
+    }
+    assert(nio.nio_position == header.nh_file_size);
+    if (fflush(fp) == EOF) {
+	goto error;
+    }
+    return 0;
+
+error:
+    _vnadata_error(vdip, VNAERR_SYSTEM, "fwrite: %s: %s",
+	    filename, strerror(errno));
+    return -1;
+}
+
+/*
+ * npdb_stream_t: state for writing a binary file one frequency at a time
+ *
+ *   The frequency vector and reference impedance blocks are sized
+ *   for ns_capacity frequencies; the data block follows and grows as
+ *   frequencies are appended.  The frequencies and per-frequency
+ *   reference impedances are kept in memory and written into their
+ *   reserved places, along with an updated header, on each flush.
+ */
+struct npdb_stream {
+    vnadata_internal_t *ns_vdip;
+    npdb_io_t ns_io;			/* position of the end of the data */
+    long ns_base;			/* offset of the header in the file */
+    npdb_header_t ns_header;
+    bool ns_per_f_z0;
+    int ns_ports;
+    int ns_cells;
+    int ns_capacity;
+    int ns_flushed;			/* frequencies in the file header */
+    double *ns_frequency_vector;
+    double complex *ns_z0_vector;	/* capacity x ports if per_f_z0 */
+};
+
+/*
+ * stream_write_at: write doubles at an offset from the start of the file
+ *   @nsp: stream state
+ *   @offset: offset relative to the header
+ *   @vector: values to write
+ *   @count: number of doubles
+ */
+static int stream_write_at(npdb_stream_t *nsp, uint64_t offset,
+	const double *vector, size_t count)
+{
+    npdb_io_t nio = nsp->ns_io;
+
+    if (fseek(nio.nio_fp, nsp->ns_base + (long)offset, SEEK_SET) == -1) {
+	return -1;
+    }
+    return write_doubles(&nio, vector, count);
+}
+
+/*
+ * _vnadata_npdb_stream_open: write the header of a streamed binary file
+ *   @vdip: internal parameter matrix giving type, dimensions and z0
+ *   @fp: seekable file pointer
+ *   @filename: filename used in error messages
+ *   @capacity: maximum number of frequencies
+ *   @per_f_z0: true if each frequency has its own reference impedances
+ */
+npdb_stream_t *_vnadata_npdb_stream_open(vnadata_internal_t *vdip, FILE *fp,
+	const char *filename, int capacity, bool per_f_z0)
+{
+    const vnadata_t *vdp = &vdip->vdi_vd;
+    const char *name = (vdip->vdi_flags & VF_NAME_SET) ?
+	vdip->vdi_name : "";
+    const char *format = vdip->vdi_format_string != NULL ?
+	vdip->vdi_format_string : "";
+    npdb_stream_t *nsp;
+    npdb_header_t *nhp;
+    uint8_t buffer[NPDB_HEADER_SIZE];
+
+    if (strlen(format) > NPDB_MAX_FORMAT) {
+	_vnadata_error(vdip, VNAERR_USAGE,
+		"%s: error: format string too long", filename);
+	return NULL;
+    }
+    if ((nsp = _vnadata_calloc(vdip, 1, sizeof(npdb_stream_t))) == NULL) {
+	_vnadata_error(vdip, VNAERR_SYSTEM, "calloc: %s", strerror(errno));
+	return NULL;
+    }
+    nsp->ns_vdip	= vdip;
+    nsp->ns_io.nio_fp	= fp;
+    nsp->ns_io.nio_filename = filename;
+    nsp->ns_per_f_z0	= per_f_z0;
+    nsp->ns_ports	= MAX(vdp->vd_rows, vdp->vd_columns);
+    nsp->ns_cells	= vdp->vd_rows * vdp->vd_columns;
+    nsp->ns_capacity	= capacity;
+    if ((nsp->ns_base = ftell(fp)) == -1) {
+	_vnadata_error(vdip, VNAERR_SYSTEM, "ftell: %s: %s",
+		filename, strerror(errno));
+	goto error;
+    }
+    if ((nsp->ns_frequency_vector = _vnadata_calloc(vdip, MAX(capacity, 1),
+		    sizeof(double))) == NULL ||
+	    (per_f_z0 && (nsp->ns_z0_vector = _vnadata_calloc(vdip,
+		    MAX(capacity, 1) * nsp->ns_ports,
+		    sizeof(double complex))) == NULL)) {
+	_vnadata_error(vdip, VNAERR_SYSTEM, "calloc: %s", strerror(errno));
+	goto error;
+    }
+
+    /*
+     * Lay out the file as _vnadata_save_npdb would for capacity
+     * frequencies, but with none yet present.
+     */
+    nhp = &nsp->ns_header;
+    nhp->nh_version		= NPDB_VERSION;
+    nhp->nh_header_size		= NPDB_HEADER_SIZE;
+    nhp->nh_type		= vdp->vd_type;
+    nhp->nh_rows		= vdp->vd_rows;
+    nhp->nh_columns		= vdp->vd_columns;
+    nhp->nh_frequencies		= 0;
+    nhp->nh_layout		= VNADATA_LAYOUT_FREQUENCY_MAJOR;
+    nhp->nh_flags		= per_f_z0 ? NPDB_F_PER_F_Z0 : 0;
+    nhp->nh_fprecision		= vdip->vdi_fprecision;
+    nhp->nh_dprecision		= vdip->vdi_dprecision;
+    nhp->nh_name_length		= strlen(name);
+    nhp->nh_format_length	= strlen(format);
+    nhp->nh_frequency_offset	= NPDB_ALIGN((uint64_t)NPDB_HEADER_SIZE +
+	    nhp->nh_name_length + 1 + nhp->nh_format_length + 1);
+    nhp->nh_z0_offset		= NPDB_ALIGN(nhp->nh_frequency_offset +
+	    (uint64_t)capacity * sizeof(double));
+    nhp->nh_data_offset		= NPDB_ALIGN(nhp->nh_z0_offset +
+	    (uint64_t)(per_f_z0 ? capacity : 1) * nsp->ns_ports *
+	    sizeof(double complex));
+    nhp->nh_file_size		= nhp->nh_data_offset;
+    encode_header(nhp, buffer);
+
+    /*
+     * Write the header, the frequency-independent reference
+     * impedances if any, and zeros up to the start of the data.
+     */
+    if (write_bytes(&nsp->ns_io, (const void *)buffer,
+		sizeof(buffer)) == -1 ||
+	    write_bytes(&nsp->ns_io, (const void *)name,
+		nhp->nh_name_length + 1) == -1 ||
+	    write_bytes(&nsp->ns_io, (const void *)format,
+		nhp->nh_format_length + 1) == -1 ||
+	    write_padding(&nsp->ns_io, nhp->nh_z0_offset) == -1) {
+	goto write_error;
+    }
+    if (!per_f_z0 && write_doubles(&nsp->ns_io,
+		(const double *)vdip->vdi_z0_vector,
+		2 * nsp->ns_ports) == -1) {
+	goto write_error;
+    }
+    if (write_padding(&nsp->ns_io, nhp->nh_data_offset) == -1) {
+	goto write_error;
+    }
+    return nsp;
+
+write_error:
+    _vnadata_error(vdip, VNAERR_SYSTEM, "fwrite: %s: %s",
+	    filename, strerror(errno));
+error:
+    _vnadata_free(vdip, (void *)nsp->ns_z0_vector);
+    _vnadata_free(vdip, (void *)nsp->ns_frequency_vector);
+    _vnadata_free(vdip, (void *)nsp);
+    return NULL;
+}
+
+/*
+ * _vnadata_npdb_stream_append: append one frequency to a streamed file
+ *   @nsp: stream state
+ *   @frequency: frequency of the record
+ *   @matrix: serialized matrix of the record
+ *   @z0_vector: reference impedances if per-frequency, else NULL
+ *
+ *   The caller must not append more than the capacity given at open.
+ */
+int _vnadata_npdb_stream_append(npdb_stream_t *nsp, double frequency,
+	const double complex *matrix, const double complex *z0_vector)
+{
+    vnadata_internal_t *vdip = nsp->ns_vdip;
+    const int findex = nsp->ns_header.nh_frequencies;
+
+    assert(findex < nsp->ns_capacity);
+    if (write_doubles(&nsp->ns_io, (const double *)matrix,
+		2 * nsp->ns_cells) == -1) {
+	_vnadata_error(vdip, VNAERR_SYSTEM, "fwrite: %s: %s",
+		nsp->ns_io.nio_filename, strerror(errno));
+	return -1;
+    }
+    nsp->ns_frequency_vector[findex] = frequency;
+    if (nsp->ns_per_f_z0) {
+	(void)memcpy((void *)&nsp->ns_z0_vector[findex * nsp->ns_ports],
+		(const void *)z0_vector,
+		nsp->ns_ports * sizeof(double complex));
+    }
+    ++nsp->ns_header.nh_frequencies;
+    nsp->ns_header.nh_file_size = nsp->ns_io.nio_position;
+    return 0;
+}
+
+/*
+ * _vnadata_npdb_stream_flush: bring the file up to date
+ *   @nsp: stream state
+ *
+ *   Write the new frequencies and reference impedances into their
+ *   reserved places and update the header so that the file is complete.
+ */
+int _vnadata_npdb_stream_flush(npdb_stream_t *nsp)
+{
+    const npdb_header_t *nhp = &nsp->ns_header;
+    const int first = nsp->ns_flushed;
+    const int count = nhp->nh_frequencies - first;
+    uint8_t buffer[NPDB_HEADER_SIZE];
+
+    encode_header(nhp, buffer);
+    if (count != 0) {
+	if (stream_write_at(nsp, nhp->nh_frequency_offset +
+		    (uint64_t)first * sizeof(double),
+		    &nsp->ns_frequency_vector[first], count) == -1) {
+	    goto error;
+	}
+	if (nsp->ns_per_f_z0 && stream_write_at(nsp, nhp->nh_z0_offset +
+		    (uint64_t)first * nsp->ns_ports * sizeof(double complex),
+		    (const double *)&nsp->ns_z0_vector[first * nsp->ns_ports],
+		    2 * count * nsp->ns_ports) == -1) {
+	    goto error;
+	}
+    }
+    if (fseek(nsp->ns_io.nio_fp, nsp->ns_base, SEEK_SET) == -1 ||
+	    fwrite((const void *)buffer, 1, sizeof(buffer),
+		nsp->ns_io.nio_fp) != sizeof(buffer) ||
+	    fseek(nsp->ns_io.nio_fp, nsp->ns_base +
+		(long)nsp->ns_io.nio_position, SEEK_SET) == -1 ||
+	    fflush(nsp->ns_io.nio_fp) == EOF) {
+	goto error;
+    }
+    nsp->ns_flushed = nhp->nh_frequencies;
+    return 0;
+
+error:
+    _vnadata_error(nsp->ns_vdip, VNAERR_SYSTEM, "fwrite: %s: %s",
+	    nsp->ns_io.nio_filename, strerror(errno));
+    return -1;
+}
+
+/*
+ * _vnadata_npdb_stream_close: free the stream state
+ *   @nsp: stream state (may be NULL)
+ */
+void _vnadata_npdb_stream_close(npdb_stream_t *nsp)
+{
+    if (nsp != NULL) {
+	vnadata_internal_t *vdip = nsp->ns_vdip;
+
+	_vnadata_free(vdip, (void *)nsp->ns_z0_vector);
+	_vnadata_free(vdip, (void *)nsp->ns_frequency_vector);
+	_vnadata_free(vdip, (void *)nsp);
+    }
+}
+
+/*
+ * _vnadata_unmap: release the file mapping of a vnadata_t structure
+ *   @vdip: internal parameter matrix
+ *
+ *   Called once nothing refers into the mapping any longer.
+ */
+void _vnadata_unmap(vnadata_internal_t *vdip)
+{
+    if (vdip->vdi_map_address != NULL) {
+#ifdef NPDB_CAN_MAP
+	(void)munmap(vdip->vdi_map_address, vdip->vdi_map_length);
+#endif
+	vdip->vdi_map_address = NULL;
+	vdip->vdi_map_length = 0;
+    }
+}
+
+/*
+ * load_copy: load a binary network parameter data file into memory
+ *   @vdip: internal parameter matrix
+ *   @filename: file to load
+ *
+ *   Used where the file can't be mapped.
+ */
+static int load_copy(vnadata_internal_t *vdip, const char *filename)
+{
+    FILE *fp;
+    int rv;
+
+    if ((fp = fopen(filename, "rb")) == NULL) {
+	_vnadata_error(vdip, VNAERR_SYSTEM,
+		"fopen: %s: %s", filename, strerror(errno));
+	return -1;
+    }
+    rv = _vnadata_load_npdb(vdip, fp, filename);
+    (void)fclose(fp);
+    return rv;
+}
+
+#ifdef NPDB_CAN_MAP
+/*
+ * map_file: make vdp a read-only view of a mapped file
+ *   @vdip: internal parameter matrix
+ *   @filename: file to map
+ */
+static int map_file(vnadata_internal_t *vdip, const char *filename)
+{
+    vnadata_t *vdp = &vdip->vdi_vd;
+    int fd;
+    struct stat st;
+    uint8_t *base = MAP_FAILED;
+    size_t length = 0;
+    npdb_header_t header;
+    const char *name, *format;
+    bool per_f_z0;
+    int ports, cells, frequencies;
+    int outer, inner;
+    double complex **new_data = NULL;
+    double complex *z0_vector = NULL;
+    double complex **z0_vector_vector = NULL;
+
+    /*
+     * Map the file.  The mapping is private and writable so that
+     * direct stores through vd_data never reach the file.
+     */
+    if ((fd = open(filename, O_RDONLY)) == -1) {
+	_vnadata_error(vdip, VNAERR_SYSTEM,
+		"open: %s: %s", filename, strerror(errno));
+	return -1;
+    }
+    if (fstat(fd, &st) == -1) {
+	_vnadata_error(vdip, VNAERR_SYSTEM,
+		"fstat: %s: %s", filename, strerror(errno));
+	(void)close(fd);
+	return -1;
+    }
+    if (st.st_size < NPDB_HEADER_SIZE || (uint64_t)st.st_size > SIZE_MAX) {
+	_vnadata_error(vdip, VNAERR_SYNTAX, "%s: error: "
+		"not a binary network parameter data file", filename);
+	(void)close(fd);
+	return -1;
+    }
+    length = (size_t)st.st_size;
+    base = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    (void)close(fd);
+    if (base == MAP_FAILED) {
+	_vnadata_error(vdip, VNAERR_SYSTEM,
+		"mmap: %s: %s", filename, strerror(errno));
+	return -1;
+    }
+
+    /*
+     * Validate the header against the actual size of the file.
+     */
+    if (decode_header(vdip, filename, base, &header) == -1) {
+	goto error;
+    }
+    if (header.nh_file_size > length) {
+	_vnadata_error(vdip, VNAERR_SYNTAX,
+		"%s: error: unexpected end of file", filename);
+	goto error;
+    }
+    name = (const char *)&base[header.nh_header_size];
+    format = name + header.nh_name_length + 1;
+    if (name[header.nh_name_length] != '\000' ||
+	    format[header.nh_format_length] != '\000') {
+	_vnadata_error(vdip, VNAERR_SYNTAX, "%s: error: "
+		"unterminated name or format string", filename);
+	goto error;
+    }
+    per_f_z0 = (header.nh_flags & NPDB_F_PER_F_Z0) != 0;
+    ports = MAX(header.nh_rows, header.nh_columns);
+    cells = header.nh_rows * header.nh_columns;
+    frequencies = header.nh_frequencies;
+    if (header.nh_layout == VNADATA_LAYOUT_CELL_MAJOR) {
+	outer = cells;
+	inner = frequencies;
+    } else {
+	outer = frequencies;
+	inner = cells;
+    }
+
+    /*
+     * Discard the current contents of vdp.  Let vnadata_init check
+     * the type-specific constraints on the dimensions.
+     */
+    _vnadata_release_storage(vdip);
+    if (vnadata_init(vdp, (vnadata_parameter_type_t)header.nh_type,
+		header.nh_rows, header.nh_columns, 0) == -1) {
+	goto error;
+    }
+    _vnadata_release_storage(vdip);
+
+    /*
+     * Build the vector of references into the mapping and copy the
+     * reference impedances.  As in vnadata_view, leave the data
+     * vectors NULL if the inner dimension is zero.
+     */
+    if (outer != 0) {
+	const uint8_t *data = &base[header.nh_data_offset];
+
+	if ((new_data = _vnadata_calloc(vdip, outer,
+			sizeof(double complex *))) == NULL) {
+	    _vnadata_error(vdip, VNAERR_SYSTEM, "calloc: %s",
+		    strerror(errno));
+	    goto error;
+	}
+	for (int i = 0; i < outer && inner != 0; ++i) {
+	    new_data[i] = (double complex *)(data +
+		    (size_t)i * inner * sizeof(double complex));
+	}
+    }
+    if (per_f_z0) {
+	const double complex *source = (const double complex *)
+	    &base[header.nh_z0_offset];
+
+	if (frequencies != 0) {
+	    if ((z0_vector_vector = _vnadata_calloc(vdip, frequencies,
+			    sizeof(double complex *))) == NULL) {
+		_vnadata_error(vdip, VNAERR_SYSTEM, "calloc: %s",
+			strerror(errno));
+		goto error;
+	    }
+	}
+	for (int findex = 0; findex < frequencies; ++findex) {
+	    if ((z0_vector_vector[findex] = _vnadata_malloc(vdip,
+			    ports * sizeof(double complex))) == NULL) {
+		_vnadata_error(vdip, VNAERR_SYSTEM, "malloc: %s",
+			strerror(errno));
+		goto error;
+	    }
+	    (void)memcpy((void *)z0_vector_vector[findex],
+		    (void *)&source[findex * ports],
+		    ports * sizeof(double complex));
+	}
+    } else {
+	if ((z0_vector = _vnadata_malloc(vdip,
+			ports * sizeof(double complex))) == NULL) {
+	    _vnadata_error(vdip, VNAERR_SYSTEM, "malloc: %s",
+		    strerror(errno));
+	    goto error;
+	}
+	(void)memcpy((void *)z0_vector, (void *)&base[header.nh_z0_offset],
+		ports * sizeof(double complex));
+    }
+
+    /*
+     * Make vdp a view of the mapping.
+     */
+    vdp->vd_type	     = (vnadata_parameter_type_t)header.nh_type;
+    vdp->vd_rows	     = header.nh_rows;
+    vdp->vd_columns	     = header.nh_columns;
+    vdp->vd_frequencies	     = frequencies;
+    vdp->vd_layout	     = (vnadata_layout_t)header.nh_layout;
+    vdp->vd_view	     = true;
+    vdp->vd_frequency_vector = frequencies != 0 ?
+	(double *)&base[header.nh_frequency_offset] : NULL;
+    vdp->vd_data	     = new_data;
+    if (per_f_z0) {
+	vdip->vdi_z0_vector_vector = z0_vector_vector;
+	vdip->vdi_flags |= VF_PER_F_Z0;
+    } else {
+	vdip->vdi_z0_vector = z0_vector;
+    }
+    vdip->vdi_p_allocation = ports;
+    vdip->vdi_f_allocation = frequencies;
+    vdip->vdi_m_allocation = cells;
+    vdip->vdi_map_address  = (void *)base;
+    vdip->vdi_map_length   = length;
+    _vnadata_set_name_from_dimensions(vdip);
+
+    /*
+     * Restore the name, format and precisions.  On failure, the
+     * mapping is released with the rest of the storage.
+     */
+    if (header.nh_name_length != 0) {
+	if (vnadata_set_name(vdp, name) == -1) {
+	    return -1;
+	}
+    } else {
+	_vnadata_set_name_from_filename(vdip, filename);
+    }
+    if (vnadata_set_format(vdp, header.nh_format_length != 0 ?
+		format : NULL) == -1 ||
+	    vnadata_set_fprecision(vdp, header.nh_fprecision) == -1 ||
+	    vnadata_set_dprecision(vdp, header.nh_dprecision) == -1) {
+	return -1;
+    }
+    return 0;
+
+error:
+    _vnadata_free(vdip, (void *)new_data);
+    _vnadata_free(vdip, (void *)z0_vector);
+    if (z0_vector_vector != NULL) {
+	for (int findex = 0; findex < frequencies; ++findex) {
+	    _vnadata_free(vdip, (void *)z0_vector_vector[findex]);
+	}
+	_vnadata_free(vdip, (void *)z0_vector_vector);
+    }
+    (void)munmap((void *)base, length);
+    return -1;
+}
+#endif /* NPDB_CAN_MAP */
+
+/*
+ * vnadata_map: map a binary network parameter data file
+ *   @vdp: a pointer to the vnadata_t structure
+ *   @filename: file to map
+ */
+int vnadata_map(vnadata_t *vdp, const char *filename)
+{
+    vnadata_internal_t *vdip;
+
+    if (vdp == NULL) {
+	errno = EINVAL;
+	return -1;
+    }
+    vdip = VDP_TO_VDIP(vdp);
+    if (vdip->vdi_magic != VDI_MAGIC) {
+	errno = EINVAL;
+	return -1;
+    }
+    if (filename == NULL) {
+	_vnadata_error(vdip, VNAERR_USAGE,
+		"vnadata_map: error: NULL filename");
+	return -1;
+    }
+
+    /*
+     * The data can be referenced in place only if the host has the
+     * file's byte order.  Otherwise, fall back to an ordinary load.
+     */
+#ifdef NPDB_CAN_MAP
+    if (_vnacommon_is_little_endian()) {
+	if (map_file(vdip, filename) == -1) {
+	    return -1;
+	}
+	vdip->vdi_filetype = VNADATA_FILETYPE_NPDB;
+	return 0;
+    }
+#endif
+    if (load_copy(vdip, filename) == -1) {
+	return -1;
+    }
+    vdip->vdi_filetype = VNADATA_FILETYPE_NPDB;
+    _vnadata_set_name_from_filename(vdip, filename);
+    return 0;
+}
@@ -86,6 +86,13 @@ vnadata_filetype_t _vnadata_parse_filename(const char *filename, int *ports)
 	return VNADATA_FILETYPE_NPD;
     }
 
+    /*
+     * If the file ends in .npdb, return binary NPD type.
+     */
+    if (strcasecmp(suffix, "npdb") == 0) {
+	return VNADATA_FILETYPE_NPDB;
+    }
+
     /*
      * None of the above.  Return VNADATA_FILETYPE_AUTO to indicate
      * unknown.
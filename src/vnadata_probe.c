@@ -0,0 +1,383 @@
+/*
+ * Vector Network Analyzer Library
+ * Copyright © 2020-2023 D Scott Guthridge <scott_guthridge@rompromity.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "archdep.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "vnadata_internal.h"
+
+
+/*
+ * VNADATA_PROBE_TAIL_SIZE: bytes read from the end of the file at first
+ */
+#define VNADATA_PROBE_TAIL_SIZE	4096
+
+/*
+ * find_last_record: get the first value of the last record of a file
+ *   @vdip: internal parameter matrix
+ *   @fp: file pointer
+ *   @limit: offset of the first byte that may be examined
+ *   @comment: character that introduces a comment
+ *   @brackets: true if a '[' ends the data (Touchstone [End])
+ *   @values: number of values in each record
+ *   @result: address to receive the value
+ *
+ *   Read back from the end of the file, doubling the amount read each
+ *   time, until we've seen at least one full record.  Return 1 if the
+ *   value was found, 0 if the caller should scan forward instead, or
+ *   -1 on error.
+ */
+static int find_last_record(vnadata_internal_t *vdip, FILE *fp,
+	long limit, int comment, bool brackets, int values, double *result)
+{
+    const char **ring = NULL;
+    char *buffer = NULL;
+    long size = VNADATA_PROBE_TAIL_SIZE;
+    long end;
+    int rc = 0;
+
+    if (fseek(fp, 0L, SEEK_END) == -1 || (end = ftell(fp)) == -1) {
+	return 0;
+    }
+    if ((ring = _vnamem_calloc(values, sizeof(char *))) == NULL) {
+	_vnadata_error(vdip, VNAERR_SYSTEM, "calloc: %s", strerror(errno));
+	return -1;
+    }
+    for (;;) {
+	long start = end - size > limit ? end - size : limit;
+	size_t length = end - start;
+	char *cp, *cp_end;
+	char *new_buffer;
+	int count = 0;
+
+	if ((new_buffer = _vnamem_realloc(buffer, length + 1)) == NULL) {
+	    _vnadata_error(vdip, VNAERR_SYSTEM, "realloc: %s",
+		    strerror(errno));
+	    rc = -1;
+	    goto out;
+	}
+	buffer = new_buffer;
+	if (fseek(fp, start, SEEK_SET) == -1 ||
+		fread((void *)buffer, 1, length, fp) != length) {
+	    goto out;
+	}
+	buffer[length] = '\000';
+	cp = buffer;
+	cp_end = buffer + length;
+
+	/*
+	 * Unless we're at the limit, we may have started in the middle
+	 * of a line.  Skip to the next.
+	 */
+	if (start > limit) {
+	    if ((cp = memchr((void *)buffer, '\n', length)) == NULL) {
+		size *= 2;
+		continue;
+	    }
+	    ++cp;
+	}
+
+	/*
+	 * Collect the last "values" words.
+	 */
+	while (cp < cp_end) {
+	    int c = (unsigned char)*cp;
+
+	    if (c == comment) {
+		if ((cp = memchr((void *)cp, '\n', cp_end - cp)) == NULL) {
+		    break;
+		}
+		continue;
+	    }
+	    if (brackets && c == '[') {
+		break;
+	    }
+	    if (isascii(c) && isspace(c)) {
+		++cp;
+		continue;
+	    }
+	    ring[count++ % values] = cp;
+	    while (cp < cp_end && *cp != comment &&
+		    !(isascii((unsigned char)*cp) &&
+		      isspace((unsigned char)*cp))) {
+		++cp;
+	    }
+	    if (cp < cp_end && *cp == comment) {
+		*cp = '\000';
+		if ((cp = memchr((void *)(cp + 1), '\n',
+				cp_end - cp - 1)) == NULL) {
+		    break;
+		}
+		continue;
+	    }
+	    *cp++ = '\000';
+	}
+	if (count >= values) {
+	    const char *text = ring[(count - values) % values];
+	    char *text_end;
+
+	    *result = strtod(text, &text_end);
+	    if (text_end != text && *text_end == '\000') {
+		rc = 1;
+	    }
+	    goto out;
+	}
+	if (start == limit) {
+	    goto out;
+	}
+	size *= 2;
+    }
+
+out:
+    _vnamem_free((void *)buffer);
+    _vnamem_free((void *)ring);
+    return rc;
+}
+
+/*
+ * probe_touchstone: find the frequency count and range of a touchstone file
+ *   @vdip: internal parameter matrix
+ *   @fp: file pointer
+ *   @filename: filename used in error messages
+ *   @vpp: summary to fill in
+ */
+static int probe_touchstone(vnadata_internal_t *vdip, FILE *fp,
+	const char *filename, vnadata_probe_t *vpp)
+{
+    ts_parser_state_t *tpsp;
+    double frequency;
+    double multiplier;
+    long offset, resume;
+    int frequencies;
+    int values;
+    int rv;
+    int rc = -1;
+
+    if ((tpsp = _vnadata_touchstone_open(vdip, fp, filename,
+		    &frequencies)) == NULL) {
+	return -1;
+    }
+    if ((rv = _vnadata_touchstone_skip(tpsp, &frequency)) == -1) {
+	goto out;
+    }
+    if (rv == 0) {
+	rc = 0;
+	goto out;
+    }
+    vpp->vp_frequencies = 1;
+    vpp->vp_fmin = frequency;
+    vpp->vp_fmax = frequency;
+
+    /*
+     * If the header gave the number of frequencies, try to get the
+     * last frequency from the end of the file.
+     */
+    if (_vnadata_touchstone_tail(tpsp, &offset, &values, &multiplier) &&
+	    (resume = ftell(fp)) != -1) {
+	if ((rv = find_last_record(vdip, fp, offset, '!', true, values,
+			&frequency)) == -1) {
+	    goto out;
+	}
+	if (rv == 1) {
+	    vpp->vp_frequencies = frequencies;
+	    vpp->vp_fmax = multiplier * frequency;
+	    rc = 0;
+	    goto out;
+	}
+	if (fseek(fp, resume, SEEK_SET) == -1) {
+	    _vnadata_error(vdip, VNAERR_SYSTEM, "fseek: %s: %s",
+		    filename, strerror(errno));
+	    goto out;
+	}
+    }
+
+    /*
+     * Otherwise, scan the rest of the records.
+     */
+    while ((rv = _vnadata_touchstone_skip(tpsp, &frequency)) == 1) {
+	++vpp->vp_frequencies;
+	vpp->vp_fmax = frequency;
+    }
+    if (rv == 0) {
+	rc = 0;
+    }
+
+out:
+    _vnadata_touchstone_close(tpsp);
+    return rc;
+}
+
+/*
+ * probe_npd: find the frequency count and range of a NPD file
+ *   @vdip: internal parameter matrix
+ *   @fp: file pointer
+ *   @filename: filename used in error messages
+ *   @vpp: summary to fill in
+ */
+static int probe_npd(vnadata_internal_t *vdip, FILE *fp,
+	const char *filename, vnadata_probe_t *vpp)
+{
+    npd_scan_state_t *nssp;
+    double frequency;
+    long offset, resume;
+    int values;
+    int rv;
+    int rc = -1;
+
+    if ((nssp = _vnadata_npd_open(vdip, fp, filename,
+		    &vpp->vp_frequencies, &vpp->vp_fz0)) == NULL) {
+	return -1;
+    }
+    if ((rv = _vnadata_npd_skip(nssp, &frequency)) == -1) {
+	goto out;
+    }
+    if (rv == 0) {
+	rc = 0;
+	goto out;
+    }
+    vpp->vp_fmin = frequency;
+    vpp->vp_fmax = frequency;
+
+    /*
+     * The header always gives the number of frequencies.  Try to get
+     * the last frequency from the end of the file.
+     */
+    if (_vnadata_npd_tail(nssp, &offset, &values) &&
+	    (resume = ftell(fp)) != -1) {
+	if ((rv = find_last_record(vdip, fp, offset, '#', false, values,
+			&frequency)) == -1) {
+	    goto out;
+	}
+	if (rv == 1) {
+	    vpp->vp_fmax = frequency;
+	    rc = 0;
+	    goto out;
+	}
+	if (fseek(fp, resume, SEEK_SET) == -1) {
+	    _vnadata_error(vdip, VNAERR_SYSTEM, "fseek: %s: %s",
+		    filename, strerror(errno));
+	    goto out;
+	}
+    }
+    while ((rv = _vnadata_npd_skip(nssp, &frequency)) == 1) {
+	vpp->vp_fmax = frequency;
+    }
+    if (rv == 0) {
+	rc = 0;
+    }
+
+out:
+    _vnadata_npd_close(nssp);
+    return rc;
+}
+
+/*
+ * vnadata_probe: read the header and frequency range of a file
+ *   @vdp: a pointer to the vnadata_t structure to receive the header
+ *   @filename: file to examine
+ *   @vpp: address of structure to receive the summary
+ */
+int vnadata_probe(vnadata_t *vdp, const char *filename,
+	vnadata_probe_t *vpp)
+{
+    vnadata_internal_t *vdip;
+    vnadata_filetype_t filetype;
+    int filename_ports = -1;
+    FILE *fp;
+    int rv = -1;
+
+    if (vdp == NULL || vpp == NULL) {
+	errno = EINVAL;
+	return -1;
+    }
+    vdip = VDP_TO_VDIP(vdp);
+    if (vdip->vdi_magic != VDI_MAGIC) {
+	errno = EINVAL;
+	return -1;
+    }
+    (void)memset((void *)vpp, 0, sizeof(*vpp));
+
+    /*
+     * Determine the filetype as in vnadata_load.
+     */
+    filetype = _vnadata_parse_filename(filename, &filename_ports);
+    if (filetype != VNADATA_FILETYPE_AUTO) {
+	vdip->vdi_filetype = filetype;
+    } else if (vdip->vdi_filetype == VNADATA_FILETYPE_AUTO) {
+	vdip->vdi_filetype = VNADATA_FILETYPE_NPD;
+    }
+    if ((fp = fopen(filename, vdip->vdi_filetype == VNADATA_FILETYPE_NPDB ?
+		    "rb" : "r")) == NULL) {
+	_vnadata_error(vdip, VNAERR_SYSTEM,
+		"fopen: %s: %s", filename, strerror(errno));
+	return -1;
+    }
+    switch (vdip->vdi_filetype) {
+    case VNADATA_FILETYPE_TOUCHSTONE1:
+    case VNADATA_FILETYPE_TOUCHSTONE2:
+	if (probe_touchstone(vdip, fp, filename, vpp) == -1) {
+	    goto out;
+	}
+	if (filename_ports != -1 && filename_ports != vdp->vd_columns) {
+	    _vnadata_error(vdip, VNAERR_WARNING,
+		    "%s: warning: filename suggests %d port(s) but found %d",
+		    filename, filename_ports, vdp->vd_columns);
+	}
+	break;
+
+    case VNADATA_FILETYPE_NPD:
+	if (probe_npd(vdip, fp, filename, vpp) == -1) {
+	    goto out;
+	}
+	break;
+
+    case VNADATA_FILETYPE_NPDB:
+	if (_vnadata_probe_npdb(vdip, fp, filename, &vpp->vp_frequencies,
+		    &vpp->vp_fmin, &vpp->vp_fmax, &vpp->vp_fz0) == -1) {
+	    goto out;
+	}
+	break;
+
+    default:
+	abort();
+	/*NOTREACHED*/
+    }
+    _vnadata_set_name_from_filename(vdip, filename);
+
+    /*
+     * Leave the header information in vdp with zero frequencies.
+     */
+    if (vnadata_resize(vdp, vdp->vd_type, vdp->vd_rows, vdp->vd_columns,
+		0) == -1) {
+	goto out;
+    }
+    vpp->vp_filetype = vdip->vdi_filetype;
+    vpp->vp_type     = vdp->vd_type;
+    vpp->vp_rows     = vdp->vd_rows;
+    vpp->vp_columns  = vdp->vd_columns;
+    rv = 0;
+
+out:
+    (void)fclose(fp);
+    return rv;
+}
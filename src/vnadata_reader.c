@@ -0,0 +1,297 @@
+/*
+ * Vector Network Analyzer Library
+ * Copyright © 2020-2023 D Scott Guthridge <scott_guthridge@rompromity.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "archdep.h"
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "vnadata_internal.h"
+
+
+/*
+ * vnadata_reader_t: state for reading a file one frequency at a time
+ */
+struct vnadata_reader {
+    vnadata_internal_t	       *vr_vdip;
+    FILE		       *vr_fp;
+    bool			vr_close_fp;
+    char		       *vr_filename;
+    vnadata_filetype_t		vr_filetype;
+    ts_parser_state_t	       *vr_tpsp;
+    npd_scan_state_t	       *vr_nssp;
+    int				vr_status;	/* 1, 0 at EOF, -1 */
+    int				vr_frequencies;
+    bool			vr_fz0;
+    vnadata_parameter_type_t	vr_type;
+    int				vr_rows;
+    int				vr_columns;
+    double complex	       *vr_matrix;
+    double complex	       *vr_z0_vector;
+    vnamem_allocator_t		vr_allocator;	/* holds the reader */
+};
+
+/*
+ * vnadata_reader_close: close a reader and free its resources
+ *   @vrp: pointer returned from vnadata_reader_open
+ */
+void vnadata_reader_close(vnadata_reader_t *vrp)
+{
+    vnamem_allocator_t allocator;
+
+    if (vrp == NULL) {
+	return;
+    }
+    allocator = vrp->vr_allocator;
+    _vnadata_touchstone_close(vrp->vr_tpsp);
+    _vnadata_npd_close(vrp->vr_nssp);
+    if (vrp->vr_close_fp) {
+	(void)fclose(vrp->vr_fp);
+    }
+    _vnamem_afree(&allocator, (void *)vrp->vr_z0_vector);
+    _vnamem_afree(&allocator, (void *)vrp->vr_matrix);
+    _vnamem_afree(&allocator, (void *)vrp->vr_filename);
+    _vnamem_afree(&allocator, (void *)vrp);
+}
+
+/*
+ * reader_open_common: parse the header and set up the reader
+ *   @vdip: internal parameter matrix
+ *   @fp: file pointer
+ *   @close_fp: true if the reader owns fp
+ *   @filename: filename used in error messages and to intuit the file type
+ */
+static vnadata_reader_t *reader_open_common(vnadata_internal_t *vdip,
+	FILE *fp, bool close_fp, const char *filename)
+{
+    vnadata_t *vdp = &vdip->vdi_vd;
+    vnamem_allocator_t allocator;
+    vnadata_reader_t *vrp;
+    int filename_ports = -1;
+    int ports;
+
+    vnamem_get_allocator(&allocator);
+    if ((vrp = _vnamem_acalloc(&allocator, 1,
+		    sizeof(vnadata_reader_t))) == NULL) {
+	_vnadata_error(vdip, VNAERR_SYSTEM,
+		"calloc: %s", strerror(errno));
+	if (close_fp) {
+	    (void)fclose(fp);
+	}
+	return NULL;
+    }
+    vrp->vr_allocator	= allocator;
+    vrp->vr_vdip	= vdip;
+    vrp->vr_fp		= fp;
+    vrp->vr_close_fp	= close_fp;
+    vrp->vr_status	= 1;
+    if ((vrp->vr_filename = _vnamem_astrdup(&allocator, filename)) == NULL) {
+	_vnadata_error(vdip, VNAERR_SYSTEM,
+		"strdup: %s", strerror(errno));
+	goto error;
+    }
+
+    /*
+     * Determine the filetype as in vnadata_load.
+     */
+    {
+	vnadata_filetype_t filetype;
+
+	filetype = _vnadata_parse_filename(filename, &filename_ports);
+	if (filetype != VNADATA_FILETYPE_AUTO) {
+	    vdip->vdi_filetype = filetype;
+	} else if (vdip->vdi_filetype == VNADATA_FILETYPE_AUTO) {
+	    vdip->vdi_filetype = VNADATA_FILETYPE_NPD;
+	}
+    }
+    vrp->vr_filetype = vdip->vdi_filetype;
+    switch (vrp->vr_filetype) {
+    case VNADATA_FILETYPE_TOUCHSTONE1:
+    case VNADATA_FILETYPE_TOUCHSTONE2:
+	if ((vrp->vr_tpsp = _vnadata_touchstone_open(vdip, fp,
+			vrp->vr_filename, &vrp->vr_frequencies)) == NULL) {
+	    goto error;
+	}
+	if (filename_ports != -1 && filename_ports != vdp->vd_columns) {
+	    _vnadata_error(vdip, VNAERR_WARNING,
+		    "%s: warning: filename suggests %d port(s) but found %d",
+		    filename, filename_ports, vdp->vd_columns);
+	}
+	break;
+
+    case VNADATA_FILETYPE_NPD:
+	if ((vrp->vr_nssp = _vnadata_npd_open(vdip, fp, vrp->vr_filename,
+			&vrp->vr_frequencies, &vrp->vr_fz0)) == NULL) {
+	    goto error;
+	}
+	break;
+
+    case VNADATA_FILETYPE_NPDB:
+	_vnadata_error(vdip, VNAERR_USAGE, "vnadata_reader_open: %s: "
+		"binary NPD files cannot be streamed; use vnadata_map",
+		filename);
+	goto error;
+
+    default:
+	abort();
+	/*NOTREACHED*/
+    }
+    _vnadata_set_name_from_filename(vdip, filename);
+
+    /*
+     * Leave the header information in vdp with zero frequencies.
+     */
+    vrp->vr_type    = vdp->vd_type;
+    vrp->vr_rows    = vdp->vd_rows;
+    vrp->vr_columns = vdp->vd_columns;
+    if (vnadata_resize(vdp, vrp->vr_type, vrp->vr_rows,
+		vrp->vr_columns, 0) == -1) {
+	goto error;
+    }
+    ports = MAX(vrp->vr_rows, vrp->vr_columns);
+    if ((vrp->vr_matrix = _vnamem_acalloc(&allocator, MAX(1, vrp->vr_rows *
+			vrp->vr_columns), sizeof(double complex))) == NULL ||
+	    (vrp->vr_z0_vector = _vnamem_acalloc(&allocator, MAX(1, ports),
+			sizeof(double complex))) == NULL) {
+	_vnadata_error(vdip, VNAERR_SYSTEM,
+		"calloc: %s", strerror(errno));
+	goto error;
+    }
+    return vrp;
+
+error:
+    vnadata_reader_close(vrp);
+    return NULL;
+}
+
+/*
+ * vnadata_reader_open: open a Touchstone or NPD file for streaming
+ *   @vdp: a pointer to the vnadata_t structure to receive each record
+ *   @filename: file to read
+ */
+vnadata_reader_t *vnadata_reader_open(vnadata_t *vdp, const char *filename)
+{
+    vnadata_internal_t *vdip;
+    FILE *fp;
+
+    if (vdp == NULL) {
+	errno = EINVAL;
+	return NULL;
+    }
+    vdip = VDP_TO_VDIP(vdp);
+    if (vdip->vdi_magic != VDI_MAGIC) {
+	errno = EINVAL;
+	return NULL;
+    }
+    if ((fp = fopen(filename, "r")) == NULL) {
+	_vnadata_error(vdip, VNAERR_SYSTEM,
+		"fopen: %s: %s", filename, strerror(errno));
+	return NULL;
+    }
+    return reader_open_common(vdip, fp, /*close_fp*/true, filename);
+}
+
+/*
+ * vnadata_reader_fopen: stream a Touchstone or NPD file from a file pointer
+ *   @vdp: a pointer to the vnadata_t structure to receive each record
+ *   @fp: file pointer
+ *   @filename: filename used in error messages and to intuit the file type
+ */
+vnadata_reader_t *vnadata_reader_fopen(vnadata_t *vdp, FILE *fp,
+	const char *filename)
+{
+    vnadata_internal_t *vdip;
+
+    if (vdp == NULL) {
+	errno = EINVAL;
+	return NULL;
+    }
+    vdip = VDP_TO_VDIP(vdp);
+    if (vdip->vdi_magic != VDI_MAGIC) {
+	errno = EINVAL;
+	return NULL;
+    }
+    return reader_open_common(vdip, fp, /*close_fp*/false, filename);
+}
+
+/*
+ * vnadata_reader_get_frequencies: return the number of frequencies or -1
+ *   @vrp: pointer returned from vnadata_reader_open
+ */
+int vnadata_reader_get_frequencies(const vnadata_reader_t *vrp)
+{
+    if (vrp == NULL) {
+	errno = EINVAL;
+	return -1;
+    }
+    return vrp->vr_frequencies;
+}
+
+/*
+ * vnadata_reader_next: read the next frequency into vdp
+ *   @vrp: pointer returned from vnadata_reader_open
+ */
+int vnadata_reader_next(vnadata_reader_t *vrp)
+{
+    vnadata_internal_t *vdip;
+    vnadata_t *vdp;
+    double frequency;
+    int rv;
+
+    if (vrp == NULL) {
+	errno = EINVAL;
+	return -1;
+    }
+    if (vrp->vr_status != 1) {
+	return vrp->vr_status;
+    }
+    vdip = vrp->vr_vdip;
+    vdp = &vdip->vdi_vd;
+    if (vrp->vr_tpsp != NULL) {
+	rv = _vnadata_touchstone_next(vrp->vr_tpsp, &frequency,
+		vrp->vr_matrix);
+    } else {
+	rv = _vnadata_npd_next(vrp->vr_nssp, &frequency,
+		vrp->vr_matrix, vrp->vr_z0_vector);
+    }
+    if (rv != 1) {
+	vrp->vr_status = rv;
+	return rv;
+    }
+
+    /*
+     * Put the record into vdp as its only frequency, restoring the
+     * shape if the caller changed it since the last record.
+     */
+    if (vdp->vd_type != vrp->vr_type || vdp->vd_rows != vrp->vr_rows ||
+	    vdp->vd_columns != vrp->vr_columns || vdp->vd_frequencies != 1) {
+	if (vnadata_resize(vdp, vrp->vr_type, vrp->vr_rows,
+		    vrp->vr_columns, 1) == -1) {
+	    vrp->vr_status = -1;
+	    return -1;
+	}
+    }
+    if (_vnadata_store_record(vdip, 0, frequency, vrp->vr_matrix,
+		vrp->vr_fz0 ? vrp->vr_z0_vector : NULL) == -1) {
+	vrp->vr_status = -1;
+	return -1;
+    }
+    return 1;
+}
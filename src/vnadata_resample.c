@@ -0,0 +1,249 @@
+/*
+ * Vector Network Analyzer Library
+ * Copyright © 2020-2023 D Scott Guthridge <scott_guthridge@rompromity.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "archdep.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include "vnacal_internal.h"
+#include "vnadata_internal.h"
+
+
+/*
+ * vnadata_resample: interpolate onto a new frequency grid
+ *   @vdp_in:  input network parameter data
+ *   @vdp_out: output network parameter data (can be same as vdp_in)
+ *   @frequency_vector: new frequencies in increasing order (may be the
+ *                      frequency vector of vdp_in or vdp_out)
+ *   @frequencies: length of frequency_vector
+ *
+ *   Use rational function interpolation to find the values of all cells
+ *   and of any frequency-dependent reference impedances at the new
+ *   frequencies.  The new frequencies must lie within the range of the
+ *   input frequencies, extended by VNADATA_F_EXTRAPOLATION on each end.
+ *
+ *   The interpolation window for each new frequency is found once and
+ *   shared across all cells.  The output keeps its existing layout.
+ */
+int vnadata_resample(const vnadata_t *vdp_in, vnadata_t *vdp_out,
+	const double *frequency_vector, int frequencies)
+{
+    vnadata_internal_t *vdip_in, *vdip_out;
+    vnadata_parameter_type_t type;
+    int rows, columns, ports, cells, n;
+    bool per_f_z0;
+    double fmin, fmax;
+    vnacal_interp_plan_t *planp = NULL;
+    double *frequency_copy = NULL;
+    double complex *data_copy = NULL;
+    double complex *z0_copy = NULL;
+    const double complex **cell_vector = NULL;
+    int rv = -1;
+
+    /*
+     * Validate parameters.
+     */
+    if (vdp_in == NULL || vdp_out == NULL) {
+	errno = EINVAL;
+	return -1;
+    }
+    vdip_in  = VDP_TO_VDIP(vdp_in);
+    vdip_out = VDP_TO_VDIP(vdp_out);
+    if (vdip_in->vdi_magic != VDI_MAGIC || vdip_out->vdi_magic != VDI_MAGIC) {
+	errno = EINVAL;
+	return -1;
+    }
+    n = vdp_in->vd_frequencies;
+    if (n < 1) {
+	_vnadata_error(vdip_out, VNAERR_USAGE,
+		"vnadata_resample: input has no frequencies");
+	return -1;
+    }
+    if (frequencies < 0) {
+	_vnadata_error(vdip_out, VNAERR_USAGE,
+		"vnadata_resample: invalid frequency count: %d", frequencies);
+	return -1;
+    }
+    if (frequency_vector == NULL && frequencies != 0) {
+	_vnadata_error(vdip_out, VNAERR_USAGE,
+		"vnadata_resample: invalid NULL frequency_vector");
+	return -1;
+    }
+    for (int i = 0; i < frequencies - 1; ++i) {
+	if (frequency_vector[i] >= frequency_vector[i + 1]) {
+	    _vnadata_error(vdip_out, VNAERR_USAGE,
+		    "vnadata_resample: non-increasing frequencies");
+	    return -1;
+	}
+    }
+    fmin = (1.0 - VNADATA_F_EXTRAPOLATION) * vdp_in->vd_frequency_vector[0];
+    fmax = (1.0 + VNADATA_F_EXTRAPOLATION) *
+	vdp_in->vd_frequency_vector[n - 1];
+    if (frequencies != 0 && (frequency_vector[0] < fmin ||
+		frequency_vector[frequencies - 1] > fmax)) {
+	_vnadata_error(vdip_out, VNAERR_USAGE,
+		"vnadata_resample: frequency out of bounds");
+	return -1;
+    }
+    type     = vdp_in->vd_type;
+    rows     = vdp_in->vd_rows;
+    columns  = vdp_in->vd_columns;
+    ports    = MAX(rows, columns);
+    cells    = rows * columns;
+    per_f_z0 = (vdip_in->vdi_flags & VF_PER_F_Z0) != 0;
+
+    /*
+     * Find the interpolation window for each new frequency.
+     */
+    if ((planp = _vnacal_interp_plan_alloc(VNACAL_INTERP_RATIONAL,
+		    vdp_in->vd_frequency_vector, n,
+		    frequency_vector, frequencies)) == NULL) {
+	_vnadata_error(vdip_out, VNAERR_SYSTEM, "malloc: %s",
+		strerror(errno));
+	goto out;
+    }
+
+    /*
+     * Copy the old z0 values, which may be overwritten below if
+     * vdp_out is the same as vdp_in.  Store frequency-dependent z0
+     * values by port.  The plan above no longer needs the old
+     * frequency vector.
+     */
+    if ((z0_copy = _vnamem_calloc(MAX(per_f_z0 ? ports * n : ports, 1),
+		    sizeof(double complex))) == NULL) {
+	_vnadata_error(vdip_out, VNAERR_SYSTEM, "calloc: %s",
+		strerror(errno));
+	goto out;
+    }
+    if (per_f_z0) {
+	for (int findex = 0; findex < n; ++findex) {
+	    for (int port = 0; port < ports; ++port) {
+		z0_copy[port * n + findex] =
+		    vdip_in->vdi_z0_vector_vector[findex][port];
+	    }
+	}
+    } else {
+	(void)memcpy((void *)z0_copy, (void *)vdip_in->vdi_z0_vector,
+		ports * sizeof(double complex));
+    }
+
+    /*
+     * Find a contiguous vector of input values for each cell.  If the
+     * input is in cell-major layout and won't be overwritten, use it
+     * directly; otherwise, gather the values into a copy.
+     */
+    if ((cell_vector = _vnamem_calloc(MAX(cells, 1),
+		    sizeof(double complex *))) == NULL) {
+	_vnadata_error(vdip_out, VNAERR_SYSTEM, "calloc: %s",
+		strerror(errno));
+	goto out;
+    }
+    if (vdp_in->vd_layout == VNADATA_LAYOUT_CELL_MAJOR && vdp_in != vdp_out) {
+	for (int cell = 0; cell < cells; ++cell) {
+	    cell_vector[cell] = vdp_in->vd_data[cell];
+	}
+    } else if (cells != 0) {
+	if ((data_copy = _vnamem_malloc(cells * n *
+			sizeof(double complex))) == NULL) {
+	    _vnadata_error(vdip_out, VNAERR_SYSTEM, "malloc: %s",
+		    strerror(errno));
+	    goto out;
+	}
+	for (int cell = 0; cell < cells; ++cell) {
+	    cell_vector[cell] = &data_copy[cell * n];
+	}
+	for (int findex = 0; findex < n; ++findex) {
+	    for (int cell = 0; cell < cells; ++cell) {
+		data_copy[cell * n + findex] =
+		    *_vnadata_cell_address(vdp_in, findex, cell);
+	    }
+	}
+    }
+
+    /*
+     * Copy the new frequencies, which vnadata_init may free or clear
+     * below if the caller passed the frequency vector of vdp_out.
+     */
+    if ((frequency_copy = _vnamem_malloc(MAX(frequencies, 1) *
+		    sizeof(double))) == NULL) {
+	_vnadata_error(vdip_out, VNAERR_SYSTEM, "malloc: %s",
+		strerror(errno));
+	goto out;
+    }
+    if (frequencies != 0) {
+	(void)memcpy((void *)frequency_copy, (void *)frequency_vector,
+		frequencies * sizeof(double));
+    }
+
+    /*
+     * Set up the output structure.
+     */
+    if (vnadata_init(vdp_out, type, rows, columns, frequencies) == -1) {
+	goto out;
+    }
+    if (frequencies != 0) {
+	(void)memcpy((void *)vdp_out->vd_frequency_vector,
+		(void *)frequency_copy, frequencies * sizeof(double));
+    }
+
+    /*
+     * Interpolate each cell, reusing the windows found above.
+     */
+    for (int cell = 0; cell < cells; ++cell) {
+	const double complex *yp = cell_vector[cell];
+
+	for (int findex = 0; findex < frequencies; ++findex) {
+	    *_vnadata_cell_address(vdp_out, findex, cell) =
+		_vnacal_interp_eval_point(&planp->vipl_point_vector[findex],
+			yp, NULL);
+	}
+    }
+
+    /*
+     * Interpolate or copy the reference impedances.
+     */
+    if (per_f_z0) {
+	for (int findex = 0; findex < frequencies; ++findex) {
+	    double complex z0_vector[MAX(ports, 1)];
+
+	    for (int port = 0; port < ports; ++port) {
+		z0_vector[port] = _vnacal_interp_eval_point(
+			&planp->vipl_point_vector[findex],
+			&z0_copy[port * n], NULL);
+	    }
+	    if (vnadata_set_fz0_vector(vdp_out, findex, z0_vector) == -1) {
+		goto out;
+	    }
+	}
+    } else {
+	if (vnadata_set_z0_vector(vdp_out, z0_copy) == -1) {
+	    goto out;
+	}
+    }
+    rv = 0;
+
+out:
+    _vnamem_free((void *)cell_vector);
+    _vnamem_free((void *)data_copy);
+    _vnamem_free((void *)z0_copy);
+    _vnamem_free((void *)frequency_copy);
+    _vnacal_interp_plan_free(planp);
+    return rv;
+}
@@ -21,33 +21,147 @@
 #include <assert.h>
 #include <ctype.h>
 #include <errno.h>
+#include <float.h>
+#include <math.h>
 #include <stdarg.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "vnacommon_internal.h"
 #include "vnadata_internal.h"
+#include "vnastats_internal.h"
 
 
+/*
+ * VNADATA_SAVE_BUFFER_SIZE: size of the output buffer
+ */
+#define VNADATA_SAVE_BUFFER_SIZE	65536
+
+/*
+ * save_buffer_t: output buffer
+ *
+ *   Output is formatted directly into sb_data and written to the file
+ *   in large chunks, avoiding a stdio call per field.
+ */
+typedef struct save_buffer {
+    FILE *sb_fp;			/* output stream */
+    size_t sb_length;			/* bytes of sb_data in use */
+    long sb_written;			/* bytes already written to sb_fp */
+    int sb_errno;			/* errno from first failed write */
+    char sb_data[VNADATA_SAVE_BUFFER_SIZE];
+} save_buffer_t;
+
+/*
+ * sb_flush: write the buffered output to the file
+ *   @sbp: output buffer
+ */
+static void sb_flush(save_buffer_t *sbp)
+{
+    if (sbp->sb_length != 0) {
+	if (fwrite((void *)sbp->sb_data, 1, sbp->sb_length,
+		    sbp->sb_fp) != sbp->sb_length && sbp->sb_errno == 0) {
+	    sbp->sb_errno = errno != 0 ? errno : EIO;
+	}
+	sbp->sb_written += sbp->sb_length;
+	sbp->sb_length = 0;
+    }
+}
+
+/*
+ * sb_reserve: make room for n more bytes and return the write position
+ *   @sbp: output buffer
+ *   @n: number of bytes needed (at most VNADATA_SAVE_BUFFER_SIZE)
+ */
+static inline char *sb_reserve(save_buffer_t *sbp, size_t n)
+{
+    assert(n <= VNADATA_SAVE_BUFFER_SIZE);
+    if (VNADATA_SAVE_BUFFER_SIZE - sbp->sb_length < n) {
+	sb_flush(sbp);
+    }
+    return &sbp->sb_data[sbp->sb_length];
+}
+
+/*
+ * sb_putc: add a character to the output buffer
+ *   @sbp: output buffer
+ *   @c: character to add
+ */
+static inline void sb_putc(save_buffer_t *sbp, char c)
+{
+    *sb_reserve(sbp, 1) = c;
+    ++sbp->sb_length;
+}
+
+/*
+ * sb_printf: format into the output buffer
+ *   @sbp: output buffer
+ *   @format: printf format string
+ *   @...: arguments
+ */
+#ifdef __GNUC__
+static void sb_printf(save_buffer_t *sbp, const char *format, ...)
+    __attribute__((__format__(__printf__, 2, 3)));
+#endif
+static void sb_printf(save_buffer_t *sbp, const char *format, ...)
+{
+    va_list ap;
+    size_t available = VNADATA_SAVE_BUFFER_SIZE - sbp->sb_length;
+    int length;
+
+    va_start(ap, format);
+    length = vsnprintf(&sbp->sb_data[sbp->sb_length], available, format, ap);
+    va_end(ap);
+    if (length < 0) {
+	return;
+    }
+    if ((size_t)length < available) {
+	sbp->sb_length += length;
+	return;
+    }
+
+    /*
+     * It didn't fit.  Flush and try again, or if the text is larger
+     * than the whole buffer, write it directly.
+     */
+    sb_flush(sbp);
+    va_start(ap, format);
+    if ((size_t)length < VNADATA_SAVE_BUFFER_SIZE) {
+	sbp->sb_length = vsnprintf(sbp->sb_data, VNADATA_SAVE_BUFFER_SIZE,
+		format, ap);
+    } else if (vfprintf(sbp->sb_fp, format, ap) < 0) {
+	if (sbp->sb_errno == 0) {
+	    sbp->sb_errno = errno != 0 ? errno : EIO;
+	}
+    } else {
+	sbp->sb_written += length;
+    }
+    va_end(ap);
+}
+
+/*
+ * VNADATA_COUNT_WIDTH: width of a frequency count that vnadata_writer
+ *	updates in place
+ */
+#define VNADATA_COUNT_WIDTH	10
+
 /*
  * print_value: print a double in engineering form
- *   @fp:        output stream
+ *   @sbp:       output buffer
  *   @precision: digits of precision to print
  *   @plus:	 include the plus sign
  *   @pad:       pad to consistent width
  *   @value:     value to print
- *
- * Return:
- *   The number of characters printed or -1 on error.
  */
-static void print_value(FILE *fp, int precision, bool plus, bool pad,
-	double value)
+static void print_value(save_buffer_t *sbp, int precision, bool plus,
+	bool pad, double value)
 {
-    char *cur;
-    char *mantissa;
+    char *start, *cur;
+    const char *mantissa;
     int width, exponent, before, temp;
     char sign = '+';
     char buf1[MAX(precision, 1) + 8];
-    char buf2[MAX(precision, 1) + 8];
 
     /*
      * Bound the minimum precision to 1 digit.  If precision is
@@ -57,47 +171,52 @@ static void print_value(FILE *fp, int precision, bool plus, bool pad,
 	precision = 1;
 
     } else if (precision == VNADATA_MAX_PRECISION) {
-	fprintf(fp, "%a", value);
+	sb_printf(sbp, "%a", value);
 	return;
     }
     width = precision + 5; /* .e-EE */
     if (plus) {
 	++width;
     }
+    start = cur = sb_reserve(sbp, MAX(width, precision + 8));
 
     /*
-     * Format the number and extract mantissa and exponent.  If the value
-     * is nan or inf, use the value as-is.  Upon successfully reaching
-     * the end of block, mantissa points to a string of all the digits,
-     * decimal point removed, and the exponent is decoded in exponent.
+     * Get a string of all the digits of the mantissa and the decimal
+     * exponent.  If the value is nan or inf, use the sprintf output
+     * as-is.
      */
-    (void)sprintf(buf1, "%.*e", precision - 1, value);
-    cur = buf1;
-    if (cur[0] == '-') {
+    if (signbit(value)) {
 	sign = '-';
-	++cur;
     }
-    if (!isdigit(*cur)) {
-	(void)strcpy(buf2, buf1);
-	goto finished;
-    }
-    mantissa = cur;
-    if (cur[1] == '.') {
-	cur[1] = cur[0];
-	mantissa = &cur[1];
-    }
-    cur = strchr(mantissa, 'e');
-    if (cur == NULL) {
-	(void)strcpy(buf2, buf1);
-	goto finished;
+    if (isfinite(value) && precision <= VNACOMMON_FAST_DIGITS_MAX_PRECISION &&
+	    _vnacommon_fast_digits(value, precision, buf1,
+		&exponent)) {
+	mantissa = buf1;
+
+    } else {
+	char *cp;
+
+	(void)sprintf(buf1, "%.*e", precision - 1, value);
+	cp = buf1;
+	if (cp[0] == '-') {
+	    ++cp;
+	}
+	if (!isdigit(*cp) || (cp = strchr(cp, 'e')) == NULL) {
+	    cur += sprintf(cur, "%s", buf1);
+	    goto finished;
+	}
+	exponent = atoi(cp + 1);
+	cp = buf1 + (sign == '-');
+	if (cp[1] == '.') {
+	    cp[1] = cp[0];
+	    ++cp;
+	}
+	mantissa = cp;
     }
-    *cur++ = '\000';
-    exponent = atoi(cur);
 
     /*
      * Add the sign, if needed.
      */
-    cur = buf2;
     if (plus || sign == '-') {
 	*cur++ = sign;
     }
@@ -125,7 +244,7 @@ static void print_value(FILE *fp, int precision, bool plus, bool pad,
     exponent -= (before - 1);
 
     /*
-     * Format the value and exponent and print.
+     * Format the value and exponent.
      */
     (void)memcpy((void *)cur, (void *)mantissa, before);
     cur += before;
@@ -136,60 +255,82 @@ static void print_value(FILE *fp, int precision, bool plus, bool pad,
 	cur += precision - before;
     }
     if (exponent != 0) {
-	(void)sprintf(cur, "e%0+3d", exponent);
-	cur += strlen(cur);
+	int e = exponent;
+
+	*cur++ = 'e';
+	if (e < 0) {
+	    *cur++ = '-';
+	    e = -e;
+	} else {
+	    *cur++ = '+';
+	}
+	if (e >= 100) {
+	    *cur++ = '0' + e / 100;
+	}
+	*cur++ = '0' + e / 10 % 10;
+	*cur++ = '0' + e % 10;
     } else if (pad) {
-	(void)strcpy(cur, "    ");
+	(void)memcpy((void *)cur, (void *)"    ", 4);
 	cur += 4;
     }
-    *cur = '\000';
 
 finished:
     if (pad) {
-	fprintf(fp, "%-*s", width, buf2);
-	return;
+	while (cur - start < width) {
+	    *cur++ = ' ';
+	}
     }
-    fprintf(fp, "%s", buf2);
+    sbp->sb_length += cur - start;
 }
 
 /*
  * convert_input: convert the input matrix to the given type
- *   @function: function name (for error messages)
  *   @vdip:   internal parameter matrix
  *   @conversions: cached conversions
  *   @type: desired type
+ *
+ *   Reuse the conversion structure if one exists from a previous call.
  */
-static int convert_input(const char *function, vnadata_internal_t *vdip,
+static int convert_input(vnadata_internal_t *vdip,
 	vnadata_t **conversions, vnadata_parameter_type_t type)
 {
     vnadata_t *vdp = &vdip->vdi_vd;
-    vnadata_t *target = NULL;
 
-    if (conversions[type] != NULL) {
-	return 0;
-    }
-    if (type == vnadata_get_type(vdp)) {
-	return 0;
-    }
-    if ((target = vnadata_alloc(vdip->vdi_error_fn,
-		    vdip->vdi_error_arg)) == NULL) {
-	return -1;
+    if (conversions[type] == NULL) {
+	if ((conversions[type] = vnadata_alloc(vdip->vdi_error_fn,
+			vdip->vdi_error_arg)) == NULL) {
+	    return -1;
+	}
     }
-    if (vnadata_convert(vdp, target, type) == -1) {
-	vnadata_free(target);
-	return -1;
+    return vnadata_convert(vdp, conversions[type], type);
+}
+
+/*
+ * print_count: print the number of frequencies
+ *   @sbp: output buffer
+ *   @frequencies: number of frequencies
+ *   @count_offset: if not NULL, pad the field so that it can be
+ *	rewritten in place, and return its offset in the output
+ */
+static void print_count(save_buffer_t *sbp, int frequencies,
+	long *count_offset)
+{
+    if (count_offset == NULL) {
+	sb_printf(sbp, "%d\n", frequencies);
+	return;
     }
-    conversions[type] = target;
-    return 0;
+    *count_offset = sbp->sb_written + (long)sbp->sb_length;
+    sb_printf(sbp, "%-*d\n", VNADATA_COUNT_WIDTH, frequencies);
 }
 
 /*
  * print_npd_header: print header for NPD format
  *   @vdip:   internal parameter matrix
- *   @fp: file pointer
- *   @vdp: input data
+ *   @sbp: output buffer
+ *   @count_offset: if not NULL, leave room to update the frequency count
  */
-static void print_npd_header(vnadata_internal_t *vdip, FILE *fp)
+static void print_npd_header(vnadata_internal_t *vdip, save_buffer_t *sbp,
+	long *count_offset)
 {
     vnadata_t *vdp = &vdip->vdi_vd;
     int rows, ports;
@@ -294,44 +435,45 @@ static void print_npd_header(vnadata_internal_t *vdip, FILE *fp)
     /*
      * Print the preamble.
      */
-    (void)fprintf(fp, "#NPD\n");
-    (void)fprintf(fp, "#:version 1.0\n");
-    (void)fprintf(fp, "#:ports %d\n", ports);
-    (void)fprintf(fp, "#:frequencies %d\n", vnadata_get_frequencies(vdp));
-    (void)fprintf(fp, "#:parameters %s\n", vdip->vdi_format_string);
-    (void)fprintf(fp, "#:z0");
+    sb_printf(sbp, "#NPD\n");
+    sb_printf(sbp, "#:version 1.0\n");
+    sb_printf(sbp, "#:ports %d\n", ports);
+    sb_printf(sbp, "#:frequencies ");
+    print_count(sbp, vnadata_get_frequencies(vdp), count_offset);
+    sb_printf(sbp, "#:parameters %s\n", vdip->vdi_format_string);
+    sb_printf(sbp, "#:z0");
     if (z0_vector == NULL) {
-	(void)fprintf(fp, " PER-FREQUENCY\n");
+	sb_printf(sbp, " PER-FREQUENCY\n");
     } else {
 	for (int port = 0; port < ports; ++port) {
 	    double complex z0 = z0_vector[port];
 
-	    (void)fputc(' ', fp);
-	    print_value(fp, vdip->vdi_dprecision, /*plus=*/false, /*pad=*/false,
-		    creal(z0));
-	    (void)fputc(' ', fp);
-	    print_value(fp, vdip->vdi_dprecision, /*plus=*/true, /*pad=*/false,
-		    cimag(z0));
-	    (void)fputc('j', fp);
+	    sb_putc(sbp, ' ');
+	    print_value(sbp, vdip->vdi_dprecision,
+		    /*plus=*/false, /*pad=*/false, creal(z0));
+	    sb_putc(sbp, ' ');
+	    print_value(sbp, vdip->vdi_dprecision,
+		    /*plus=*/true, /*pad=*/false, cimag(z0));
+	    sb_putc(sbp, 'j');
 	}
-	(void)fputc('\n', fp);
+	sb_putc(sbp, '\n');
     }
-    (void)fprintf(fp, "#:fprecision %d\n", vdip->vdi_fprecision);
-    (void)fprintf(fp, "#:dprecision %d\n", vdip->vdi_dprecision);
-    (void)fprintf(fp, "#\n");
+    sb_printf(sbp, "#:fprecision %d\n", vdip->vdi_fprecision);
+    sb_printf(sbp, "#:dprecision %d\n", vdip->vdi_dprecision);
+    sb_printf(sbp, "#\n");
 
     /*
      * Print a key for each field.
      */
-    (void)fprintf(fp, "# field %*d: %-*s (Hz)\n",
+    sb_printf(sbp, "# field %*d: %-*s (Hz)\n",
 	    field_width, ++current_field, 10 + parameter_width, "frequency");
     if (z0_vector == NULL) {
 	for (int port = 0; port < ports; ++port) {
 	    (void)sprintf(parameter_buf, "Z%d", port + 1);
-	    (void)fprintf(fp, "# field %*d: %-*s real      (ohms)\n",
+	    sb_printf(sbp, "# field %*d: %-*s real      (ohms)\n",
 		    field_width, ++current_field, parameter_width,
 		    parameter_buf);
-	    (void)fprintf(fp, "# field %*d: %-*s imaginary (ohms)\n",
+	    sb_printf(sbp, "# field %*d: %-*s imaginary (ohms)\n",
 		    field_width, ++current_field, parameter_width,
 		    parameter_buf);
 	}
@@ -369,29 +511,29 @@ static void print_npd_header(vnadata_internal_t *vdip, FILE *fp)
 	    if (vfdp->vfd_parameter == VPT_ZIN) {
 		for (int port = 0; port < ports; ++port) {
 		    (void)sprintf(parameter_buf, "Zin%d", port + 1);
-		    (void)fprintf(fp, "# field %*d: %-*s",
+		    sb_printf(sbp, "# field %*d: %-*s",
 			field_width, ++current_field,
 			parameter_width, parameter_buf);
 		    switch (vfdp->vfd_format) {
 		    case VNADATA_FORMAT_REAL_IMAG:
-			(void)fprintf(fp, " real      (ohms)\n");
+			sb_printf(sbp, " real      (ohms)\n");
 			break;
 		    case VNADATA_FORMAT_MAG_ANGLE:
-			(void)fprintf(fp, " magnitude (ohms)\n");
+			sb_printf(sbp, " magnitude (ohms)\n");
 			break;
 		    default:
 			abort();
 			/*NOTREACHED*/
 		    }
-		    (void)fprintf(fp, "# field %*d: %-*s",
+		    sb_printf(sbp, "# field %*d: %-*s",
 			field_width, ++current_field,
 			parameter_width, parameter_buf);
 		    switch (vfdp->vfd_format) {
 		    case VNADATA_FORMAT_REAL_IMAG:
-			(void)fprintf(fp, " imaginary (ohms)\n");
+			sb_printf(sbp, " imaginary (ohms)\n");
 			break;
 		    case VNADATA_FORMAT_MAG_ANGLE:
-			(void)fprintf(fp, " angle     (degrees)\n");
+			sb_printf(sbp, " angle     (degrees)\n");
 			break;
 		    default:
 			abort();
@@ -465,33 +607,33 @@ static void print_npd_header(vnadata_internal_t *vdip, FILE *fp)
 			(void)sprintf(parameter_buf, "%s%d,%d",
 				name, row + 1, column + 1);
 		    }
-		    (void)fprintf(fp, "# field %*d: %-*s",
+		    sb_printf(sbp, "# field %*d: %-*s",
 			field_width, ++current_field,
 			parameter_width, parameter_buf);
 		    switch (vfdp->vfd_format) {
 		    case VNADATA_FORMAT_REAL_IMAG:
-			(void)fprintf(fp, " real      (%s)\n", type);
+			sb_printf(sbp, " real      (%s)\n", type);
 			break;
 		    case VNADATA_FORMAT_MAG_ANGLE:
-			(void)fprintf(fp, " magnitude (%s)\n", type);
+			sb_printf(sbp, " magnitude (%s)\n", type);
 			break;
 		    case VNADATA_FORMAT_DB_ANGLE:
-			(void)fprintf(fp, " magnitude (dB)\n");
+			sb_printf(sbp, " magnitude (dB)\n");
 			break;
 		    default:
 			abort();
 			/*NOTREACHED*/
 		    }
-		    (void)fprintf(fp, "# field %*d: %-*s",
+		    sb_printf(sbp, "# field %*d: %-*s",
 			field_width, ++current_field,
 			parameter_width, parameter_buf);
 		    switch (vfdp->vfd_format) {
 		    case VNADATA_FORMAT_REAL_IMAG:
-			(void)fprintf(fp, " imaginary (%s)\n", type);
+			sb_printf(sbp, " imaginary (%s)\n", type);
 			break;
 		    case VNADATA_FORMAT_MAG_ANGLE:
 		    case VNADATA_FORMAT_DB_ANGLE:
-			(void)fprintf(fp, " angle     (degrees)\n");
+			sb_printf(sbp, " angle     (degrees)\n");
 			break;
 		    default:
 			abort();
@@ -505,10 +647,10 @@ static void print_npd_header(vnadata_internal_t *vdip, FILE *fp)
 	    assert(vfdp->vfd_parameter == VPT_ZIN);
 	    for (int port = 0; port < ports; ++port) {
 		(void)sprintf(parameter_buf, "PRC%d", port + 1);
-		(void)fprintf(fp, "# field %*d: %-*s R         (ohms)\n",
+		sb_printf(sbp, "# field %*d: %-*s R         (ohms)\n",
 		    field_width, ++current_field, parameter_width,
 		    parameter_buf);
-		(void)fprintf(fp, "# field %*d: %-*s C         (farads)\n",
+		sb_printf(sbp, "# field %*d: %-*s C         (farads)\n",
 		    field_width, ++current_field, parameter_width,
 		    parameter_buf);
 	    }
@@ -518,10 +660,10 @@ static void print_npd_header(vnadata_internal_t *vdip, FILE *fp)
 	    assert(vfdp->vfd_parameter == VPT_ZIN);
 	    for (int port = 0; port < ports; ++port) {
 		(void)sprintf(parameter_buf, "PRL%d", port + 1);
-		(void)fprintf(fp, "# field %*d: %-*s R         (ohms)\n",
+		sb_printf(sbp, "# field %*d: %-*s R         (ohms)\n",
 		    field_width, ++current_field, parameter_width,
 		    parameter_buf);
-		(void)fprintf(fp, "# field %*d: %-*s L         (henries)\n",
+		sb_printf(sbp, "# field %*d: %-*s L         (henries)\n",
 		    field_width, ++current_field, parameter_width,
 		    parameter_buf);
 	    }
@@ -531,10 +673,10 @@ static void print_npd_header(vnadata_internal_t *vdip, FILE *fp)
 	    assert(vfdp->vfd_parameter == VPT_ZIN);
 	    for (int port = 0; port < ports; ++port) {
 		(void)sprintf(parameter_buf, "SRC%d", port + 1);
-		(void)fprintf(fp, "# field %*d: %-*s R         (ohms)\n",
+		sb_printf(sbp, "# field %*d: %-*s R         (ohms)\n",
 		    field_width, ++current_field, parameter_width,
 		    parameter_buf);
-		(void)fprintf(fp, "# field %*d: %-*s C         (farads)\n",
+		sb_printf(sbp, "# field %*d: %-*s C         (farads)\n",
 		    field_width, ++current_field, parameter_width,
 		    parameter_buf);
 	    }
@@ -544,10 +686,10 @@ static void print_npd_header(vnadata_internal_t *vdip, FILE *fp)
 	    assert(vfdp->vfd_parameter == VPT_ZIN);
 	    for (int port = 0; port < ports; ++port) {
 		(void)sprintf(parameter_buf, "SRL%d", port + 1);
-		(void)fprintf(fp, "# field %*d: %-*s R         (ohms)\n",
+		sb_printf(sbp, "# field %*d: %-*s R         (ohms)\n",
 		    field_width, ++current_field, parameter_width,
 		    parameter_buf);
-		(void)fprintf(fp, "# field %*d: %-*s L         (henries)\n",
+		sb_printf(sbp, "# field %*d: %-*s L         (henries)\n",
 		    field_width, ++current_field, parameter_width,
 		    parameter_buf);
 	    }
@@ -567,7 +709,7 @@ static void print_npd_header(vnadata_internal_t *vdip, FILE *fp)
 			(void)sprintf(parameter_buf, "IL%d,%d",
 				row + 1, column + 1);
 		    }
-		    (void)fprintf(fp, "# field %*d: %-*s magnitude (dB)\n",
+		    sb_printf(sbp, "# field %*d: %-*s magnitude (dB)\n",
 			field_width, ++current_field,
 			parameter_width, parameter_buf);
 		}
@@ -578,7 +720,7 @@ static void print_npd_header(vnadata_internal_t *vdip, FILE *fp)
 	    assert(vfdp->vfd_parameter == VPT_S);
 	    for (int port = 0; port < ports; ++port) {
 		(void)sprintf(parameter_buf, "RL%d", port + 1);
-		(void)fprintf(fp, "# field %*d: %-*s magnitude (dB)\n",
+		sb_printf(sbp, "# field %*d: %-*s magnitude (dB)\n",
 		    field_width, ++current_field, parameter_width,
 		    parameter_buf);
 	    }
@@ -588,7 +730,7 @@ static void print_npd_header(vnadata_internal_t *vdip, FILE *fp)
 	    assert(vfdp->vfd_parameter == VPT_S);
 	    for (int port = 0; port < ports; ++port) {
 		(void)sprintf(parameter_buf, "VSWR%d", port + 1);
-		(void)fprintf(fp, "# field %*d: %-*s\n",
+		sb_printf(sbp, "# field %*d: %-*s\n",
 		    field_width, ++current_field, parameter_width,
 		    parameter_buf);
 	    }
@@ -599,18 +741,18 @@ static void print_npd_header(vnadata_internal_t *vdip, FILE *fp)
 	    /*NOTREACHED*/
 	}
     }
-    (void)fprintf(fp, "#\n");
+    sb_printf(sbp, "#\n");
 }
 
 /*
  * print_touchstone_header: print header for touchstone formats
  *   @vdip:   internal parameter matrix
- *   @fp: file pointer
- *   @vdp: input data
+ *   @sbp: output buffer
  *   @z0_touchstone: the first reference impedance (before normalization)
+ *   @count_offset: if not NULL, leave room to update the frequency count
  */
-static void print_touchstone_header(vnadata_internal_t *vdip, FILE *fp,
-	double z0_touchstone)
+static void print_touchstone_header(vnadata_internal_t *vdip,
+	save_buffer_t *sbp, double z0_touchstone, long *count_offset)
 {
     vnadata_t *vdp = &vdip->vdi_vd;
     vnadata_format_descriptor_t *vfdp = &vdip->vdi_format_vector[0];
@@ -625,7 +767,7 @@ static void print_touchstone_header(vnadata_internal_t *vdip, FILE *fp,
     assert(!(vdip->vdi_flags & VF_PER_F_Z0));
     z0_vector = vdip->vdi_z0_vector;
     if (vdip->vdi_filetype == VNADATA_FILETYPE_TOUCHSTONE2) {
-	(void)fprintf(fp, "[Version] 2.0\n");
+	sb_printf(sbp, "[Version] 2.0\n");
     }
     switch (vfdp->vfd_parameter) {
     case VPT_S:
@@ -661,19 +803,19 @@ static void print_touchstone_header(vnadata_internal_t *vdip, FILE *fp,
 	abort();
 	/*NOTREACHED*/
     }
-    (void)fprintf(fp, "# Hz %c %s R ", parameter_name, format);
-    (void)print_value(fp, vdip->vdi_dprecision, /*plus=*/false, /*pad=*/false,
+    sb_printf(sbp, "# Hz %c %s R ", parameter_name, format);
+    print_value(sbp, vdip->vdi_dprecision, /*plus=*/false, /*pad=*/false,
 	    z0_touchstone);
-    (void)fputc('\n', fp);
+    sb_putc(sbp, '\n');
     if (vdip->vdi_filetype == VNADATA_FILETYPE_TOUCHSTONE2) {
 	bool mixed_z0 = false;
 
-	(void)fprintf(fp, "[Number of Ports] %d\n", ports);
+	sb_printf(sbp, "[Number of Ports] %d\n", ports);
 	if (ports == 2) {
-	    (void)fprintf(fp, "[Two-Port Order] 12_21\n");
+	    sb_printf(sbp, "[Two-Port Order] 12_21\n");
 	}
-	(void)fprintf(fp, "[Number of Frequencies] %d\n",
-		vnadata_get_frequencies(vdp));
+	sb_printf(sbp, "[Number of Frequencies] ");
+	print_count(sbp, vnadata_get_frequencies(vdp), count_offset);
 	for (int i = 1; i < ports; ++i) {
 	    if (z0_vector[i] != z0_vector[0]) {
 		mixed_z0 = true;
@@ -681,15 +823,15 @@ static void print_touchstone_header(vnadata_internal_t *vdip, FILE *fp,
 	    }
 	}
 	if (mixed_z0) {
-	    (void)fprintf(fp, "[Reference]");
+	    sb_printf(sbp, "[Reference]");
 	    for (int i = 0; i < ports; ++i) {
-		(void)fprintf(fp, " ");
-		(void)print_value(fp, vdip->vdi_dprecision, /*plus=*/false,
+		sb_printf(sbp, " ");
+		print_value(sbp, vdip->vdi_dprecision, /*plus=*/false,
 			/*pad=*/false, creal(z0_vector[i]));
 	    }
-	    (void)fputc('\n', fp);
+	    sb_putc(sbp, '\n');
 	}
-	(void)fprintf(fp, "[Network Data]\n");
+	sb_printf(sbp, "[Network Data]\n");
     }
 }
 
@@ -701,58 +843,36 @@ static const char vnadata_fsave_name[] = "vnadata_fsave";
 static const char vnadata_save_name[] = "vnadata_save";
 
 /*
- * vnadata_save_common: common save routine
- *   @vdp: a pointer to the vnadata_t structure
- *   @fp: file pointer
- *   @filename: filename used in error messages and to intuit the file type
- *   @function: function name (for error messages)
+ * touchstone1_type: return the type to which touchstone 1 normalizes
+ *   @type: parameter type of the data
  */
-static int vnadata_save_common(vnadata_t *vdp, FILE *fp, const char *filename,
-	const char *function)
+static vnadata_parameter_type_t touchstone1_type(
+	vnadata_parameter_type_t type)
 {
-    vnadata_internal_t *vdip;
-    vnadata_parameter_type_t type;
-    int rows, ports, frequencies;
-    int aprecision;
-    int rc = -1;
-    const double *frequency_vector;
-    const double complex *z0_vector = NULL;
-    double z0_touchstone = 50.0;
-    vnadata_t *conversions[VPT_NTYPES];
+    switch (type) {
+    case VPT_T:
+    case VPT_U:
+	return type;
 
-    /*
-     * Validate pointer.
-     */
-    if (vdp == NULL) {
-	errno = EINVAL;
-	return -1;
-    }
-    vdip = VDP_TO_VDIP(vdp);
-    if (vdip->vdi_magic != VDI_MAGIC) {
-	errno = EINVAL;
-	return -1;
+    default:
+	return VPT_S;
     }
-    aprecision = MAX(vdip->vdi_dprecision, 3);
-
-    /*
-     * Init conversions to NULL.
-     */
-    (void)memset((void *)conversions, 0, sizeof(conversions));
+}
 
-    /*
-     * Validate parameters.  These errors are for the application
-     * developer, not the end user, so show the function name.
-     */
-    if (function == vnadata_fsave_name && fp == NULL) {
-	_vnadata_error(vdip, VNAERR_USAGE,
-		"%s: error: NULL file pointer", function);
-	goto out;
-    }
-    if (filename == NULL) {
-	_vnadata_error(vdip, VNAERR_USAGE,
-		"%s: error: NULL filename", function);
-	goto out;
-    }
+/*
+ * check_save: check the data, filetype and format for save
+ *   @vdip: internal parameter matrix
+ *   @filename: filename used to intuit the file type
+ *   @function: function name (for error messages)
+ *   @need_frequencies: fail if there are no frequencies
+ */
+static int check_save(vnadata_internal_t *vdip, const char *filename,
+	const char *function, bool need_frequencies)
+{
+    vnadata_t *vdp = &vdip->vdi_vd;
+    vnadata_parameter_type_t type;
+    int rows, ports;
+    const double complex *z0_vector = NULL;
 
     /*
      * Get the characteristics of network parameter data and make sure
@@ -765,12 +885,10 @@ static int vnadata_save_common(vnadata_t *vdp, FILE *fp, const char *filename,
 	_vnadata_error(vdip, VNAERR_USAGE,
 		"%s: cannot save with unknown network parameter data type",
 		function);
-	goto out;
+	return -1;
     }
-    rows             = vdp->vd_rows;
-    ports            = vdp->vd_columns;
-    frequencies      = vdp->vd_frequencies;
-    frequency_vector = vdp->vd_frequency_vector;
+    rows  = vdp->vd_rows;
+    ports = vdp->vd_columns;
 
     /*
      * If we don't have at least one port, fail.
@@ -779,13 +897,13 @@ static int vnadata_save_common(vnadata_t *vdp, FILE *fp, const char *filename,
 	_vnadata_error(vdip, VNAERR_USAGE,
 		"%s: invalid data dimensions: %d x %d",
 		function, rows, ports);
-	goto out;
+	return -1;
     }
-    if (frequencies == 0) {
+    if (need_frequencies && vdp->vd_frequencies == 0) {
 	_vnadata_error(vdip, VNAERR_USAGE,
 		"%s: at least one frequency is required for save",
 		function);
-	goto out;
+	return -1;
     }
 
     /*
@@ -793,7 +911,6 @@ static int vnadata_save_common(vnadata_t *vdp, FILE *fp, const char *filename,
      */
     if (!(vdip->vdi_flags & VF_PER_F_Z0)) {
 	z0_vector = vdip->vdi_z0_vector;
-	z0_touchstone = creal(z0_vector[0]);
     }
 
     /*
@@ -814,13 +931,21 @@ static int vnadata_save_common(vnadata_t *vdp, FILE *fp, const char *filename,
 	/* else, keep the existing type */
     }
 
+    /*
+     * The binary format stores the data as they are without
+     * conversion, so none of the format checks below apply.
+     */
+    if (vdip->vdi_filetype == VNADATA_FILETYPE_NPDB) {
+	return 0;
+    }
+
     /*
      * If no formats have been given, default to "ri".
      */
     if (vdip->vdi_format_count == 0) {
 	if (_vnadata_set_simple_format(vdip, type,
 		    VNADATA_FORMAT_REAL_IMAG) == -1) {
-	    goto out;
+	    return -1;
 	}
     }
 
@@ -837,7 +962,7 @@ static int vnadata_save_common(vnadata_t *vdp, FILE *fp, const char *filename,
 	    _vnadata_error(vdip, VNAERR_USAGE, "%s: "
 		    "only a single format may be specified in "
 		    "Touchstone file type", function);
-	    goto out;
+	    return -1;
 	}
 
 	/*
@@ -879,7 +1004,7 @@ static int vnadata_save_common(vnadata_t *vdp, FILE *fp, const char *filename,
 		_vnadata_error(vdip, VNAERR_USAGE, "%s: %s format "
 			"cannot be saved in Touchstone file type",
 			function, _vnadata_format_to_name(vfdp));
-		goto out;
+		return -1;
 	    }
 	}
 
@@ -891,7 +1016,7 @@ static int vnadata_save_common(vnadata_t *vdp, FILE *fp, const char *filename,
 	    _vnadata_error(vdip, VNAERR_USAGE, "%s: "
 		    "cannot save frequency-dependent reference impedances "
 		    "in Touchstone file type", function);
-	    goto out;
+	    return -1;
 	}
 
 	/*
@@ -902,7 +1027,7 @@ static int vnadata_save_common(vnadata_t *vdp, FILE *fp, const char *filename,
 		_vnadata_error(vdip, VNAERR_USAGE, "%s: "
 			"references must be be real and positive in "
 			"Touchstone file type", function);
-		goto out;
+		return -1;
 	    }
 	}
 
@@ -921,7 +1046,7 @@ static int vnadata_save_common(vnadata_t *vdp, FILE *fp, const char *filename,
 	    _vnadata_error(vdip, VNAERR_USAGE, "%s: "
 		    "cannot save a system with more than four ports in "
 		    "Touchstone 1 file type", function);
-	    goto out;
+	    return -1;
 	}
 
 	/*
@@ -933,7 +1058,7 @@ static int vnadata_save_common(vnadata_t *vdp, FILE *fp, const char *filename,
 		_vnadata_error(vdip, VNAERR_USAGE, "%s: "
 			"cannot save ports with different reference "
 			"impedances in touchstone 1 format", function);
-		goto out;
+		return -1;
 	    }
 	}
 	break;
@@ -960,7 +1085,7 @@ static int vnadata_save_common(vnadata_t *vdp, FILE *fp, const char *filename,
 			"%s: in NPD format, only power or root-power "
 			"parameters can be displayed in dB",
 			function, _vnadata_format_to_name(vfdp));
-		goto out;
+		return -1;
 	    }
 
 	    /*
@@ -971,12 +1096,13 @@ static int vnadata_save_common(vnadata_t *vdp, FILE *fp, const char *filename,
 		_vnadata_error(vdip, VNAERR_USAGE, "%s: "
 			"return loss requires at least one "
 			"off-diagonal element", function);
-		goto out;
+		return -1;
 	    }
 	}
 	break;
 
     case VNADATA_FILETYPE_AUTO:
+    case VNADATA_FILETYPE_NPDB:
 	abort();
 	/*NOTREACHED*/
     }
@@ -997,53 +1123,41 @@ static int vnadata_save_common(vnadata_t *vdp, FILE *fp, const char *filename,
 		    "%s parameters for format %s",
 		    function, vnadata_get_type_name(type),
 		    _vnadata_format_to_name(vfdp));
-	    goto out;
+	    return -1;
 	}
     }
+    return 0;
+}
 
-    /*
-     * If vnadata_cksave, we're done.
-     */
-    if (function == vnadata_check_name) {
-	rc = 0;
-	goto out;
-    }
+/*
+ * prepare_data: normalize and convert the data as needed to print them
+ *   @vdpp: address of the data to print, replaced if normalized
+ *   @conversions: cached conversions
+ */
+static int prepare_data(vnadata_t **vdpp, vnadata_t **conversions)
+{
+    vnadata_t *vdp = *vdpp;
+    vnadata_internal_t *vdip = VDP_TO_VDIP(vdp);
+    bool converted[VPT_NTYPES];
 
     /*
      * If touchstone 1, scale all component impedances from z0 to 1.
      */
     if (vdip->vdi_filetype == VNADATA_FILETYPE_TOUCHSTONE1 &&
-	    z0_vector[0] != 1.0) {
-	vnadata_t *vdp_copy;
+	    vdip->vdi_z0_vector[0] != 1.0) {
 	vnadata_parameter_type_t target_type;
+	vnadata_t *vdp_copy;
 
 	/*
 	 * Make a writable copy of the data.  If the input type is S, T,
 	 * or U, just copy the existing parameters; otherwise, convert
 	 * to S using the existing z0.
 	 */
-	if ((vdp_copy = vnadata_alloc(vdip->vdi_error_fn,
-			vdip->vdi_error_arg)) == NULL) {
-	    goto out;
-	}
-	switch (vnadata_get_type(vdp)) {
-	case VPT_S:
-	default:
-	    target_type = VPT_S;
-	    break;
-
-	case VPT_T:
-	    target_type = VPT_T;
-	    break;
-
-	case VPT_U:
-	    target_type = VPT_U;
-	    break;
-	}
-	if (vnadata_convert(vdp, vdp_copy, target_type) == -1) {
-	    vnadata_free(vdp_copy);
-	    goto out;
+	target_type = touchstone1_type(vdp->vd_type);
+	if (convert_input(vdip, conversions, target_type) == -1) {
+	    return -1;
 	}
+	vdp_copy = conversions[target_type];
 
 	/*
 	 * Set all z0's to 1.
@@ -1051,453 +1165,616 @@ static int vnadata_save_common(vnadata_t *vdp, FILE *fp, const char *filename,
 	if (vnadata_set_all_z0(vdp_copy, 1.0) == -1) {
 	    _vnadata_error(vdip, VNAERR_SYSTEM,
 		    "vnadata_set_all_z0: %s", strerror(errno));
-	    vnadata_free(vdp_copy);
-	    goto out;
+	    return -1;
 	}
 
 	/*
-	 * Save the copy in the conversions array so that it gets freed
-	 * at out.  Replace vdp and z0_vector.	Even if we need the
-	 * original type, we have to convert it from our new matrix in
-	 * order to scale component impedances.
+	 * Leave the copy in the conversions array so that the caller
+	 * frees it.  Replace vdp.  Even if we need the original type,
+	 * we have to convert it from our new matrix in order to scale
+	 * component impedances.
 	 */
-	conversions[target_type] = vdp_copy;
 	vdp = vdp_copy;
-	type = vdp->vd_type;
 	vdip = VDP_TO_VDIP(vdp);
-	if (!(vdip->vdi_flags & VF_PER_F_Z0)) {
-	    z0_vector = vdip->vdi_z0_vector;
-	} else {
-	    assert(z0_vector == NULL);
-	}
     }
 
     /*
      * Perform all the needed conversions.
      */
+    (void)memset((void *)converted, 0, sizeof(converted));
     for (int i = 0; i < vdip->vdi_format_count; ++i) {
-	vnadata_format_descriptor_t *vfdp = &vdip->vdi_format_vector[i];
+	vnadata_parameter_type_t type =
+	    vdip->vdi_format_vector[i].vfd_parameter;
 
-	if (vfdp->vfd_parameter != VPT_UNDEF) {
-	    if (convert_input(function, vdip, conversions,
-			vfdp->vfd_parameter) == -1) {
-		goto out;
+	if (type != VPT_UNDEF && type != vdp->vd_type && !converted[type]) {
+	    if (convert_input(vdip, conversions, type) == -1) {
+		return -1;
 	    }
+	    converted[type] = true;
 	}
     }
+    *vdpp = vdp;
+    return 0;
+}
 
-    /*
-     * Go through the format vector and fix up any instances of "ri",
-     * "ma" and "db" without parameter types, taking the parameter type
-     * from the vnadata_t structure.
-     */
-    {
-	bool changed = false;
+/*
+ * fix_formats: fill in missing parameter types in the format vector
+ *   @vdip: internal parameter matrix
+ *   @type: parameter type to use
+ *
+ *   Go through the format vector and fix up any instances of "ri",
+ *   "ma" and "db" without parameter types, taking the parameter type
+ *   from the data.
+ */
+static int fix_formats(vnadata_internal_t *vdip, vnadata_parameter_type_t type)
+{
+    bool changed = false;
 
-	for (int i = 0; i < vdip->vdi_format_count; ++i) {
-	    vnadata_format_descriptor_t *vfdp = &vdip->vdi_format_vector[i];
+    for (int i = 0; i < vdip->vdi_format_count; ++i) {
+	vnadata_format_descriptor_t *vfdp = &vdip->vdi_format_vector[i];
 
-	    if (vfdp->vfd_parameter == VPT_UNDEF) {
-		vfdp->vfd_parameter = type;
-		changed = true;
-	    }
-	}
-	if (changed) {
-	    if (_vnadata_update_format_string(vdip) == -1) {
-		goto out;
-	    }
+	if (vfdp->vfd_parameter == VPT_UNDEF) {
+	    vfdp->vfd_parameter = type;
+	    changed = true;
 	}
     }
-
-    /*
-     * If vnadata_save, open the output file.
-     */
-    if (function == vnadata_save_name) {
-	if ((fp = fopen(filename, "w")) == NULL) {
-	    _vnadata_error(vdip, VNAERR_SYSTEM, "fopen: %s: %s",
-		    filename, strerror(errno));
-	    goto out;
+    if (changed) {
+	if (_vnadata_update_format_string(vdip) == -1) {
+	    return -1;
 	}
     }
+    return 0;
+}
 
-    /*
-     * Print the file header.
-     */
+/*
+ * print_header: print the file header
+ *   @vdip: internal parameter matrix
+ *   @sbp: output buffer
+ *   @z0_touchstone: the first reference impedance (before normalization)
+ *   @count_offset: if not NULL, leave room to update the frequency count
+ */
+static void print_header(vnadata_internal_t *vdip, save_buffer_t *sbp,
+	double z0_touchstone, long *count_offset)
+{
     switch (vdip->vdi_filetype) {
     case VNADATA_FILETYPE_TOUCHSTONE1:
     case VNADATA_FILETYPE_TOUCHSTONE2:
-	print_touchstone_header(vdip, fp, z0_touchstone);
+	print_touchstone_header(vdip, sbp, z0_touchstone, count_offset);
 	break;
 
     case VNADATA_FILETYPE_NPD:
-	print_npd_header(vdip, fp);
+	print_npd_header(vdip, sbp, count_offset);
 	break;
 
     default:
 	abort();
 	/*NOTREACHED*/
     }
+}
+
+/*
+ * print_record: print the line(s) for one frequency
+ *   @vdp: data to print, after prepare_data
+ *   @conversions: conversions from prepare_data
+ *   @sbp: output buffer
+ *   @findex: frequency index
+ */
+static void print_record(const vnadata_t *vdp, vnadata_t *const *conversions,
+	save_buffer_t *sbp, int findex)
+{
+    vnadata_internal_t *vdip = VDP_TO_VDIP(vdp);
+    const vnadata_parameter_type_t type = vdp->vd_type;
+    const int rows = vdp->vd_rows;
+    const int ports = vdp->vd_columns;
+    const int aprecision = MAX(vdip->vdi_dprecision, 3);
+    const double *frequency_vector = vdp->vd_frequency_vector;
+    const double complex *z0_vector = NULL;
+
+    if (!(vdip->vdi_flags & VF_PER_F_Z0)) {
+	z0_vector = vdip->vdi_z0_vector;
+    }
 
     /*
-     * For each frequency...
+     * Print the frequency.
      */
-    for (int findex = 0; findex < frequencies; ++findex) {
-	/*
-	 * Print the frequency.
-	 */
-	print_value(fp, vdip->vdi_fprecision, /*plus=*/false, /*pad=*/true,
-		vnadata_get_frequency(vdp, findex));
+    print_value(sbp, vdip->vdi_fprecision, /*plus=*/false, /*pad=*/true,
+	    vnadata_get_frequency(vdp, findex));
+
+    /*
+     * Add frequency-dependent reference impedances.
+     */
+    if (z0_vector == NULL) {
+	const double complex *fz0_vector;
+
+	fz0_vector = vnadata_get_fz0_vector(vdp, findex);
+	for (int port = 0; port < ports; ++port) {
+	    double complex z0 = fz0_vector[port];
+
+	    sb_putc(sbp, ' ');
+	    print_value(sbp, vdip->vdi_dprecision, /*plus=*/true,
+		    /*pad=*/true, creal(z0));
+	    sb_putc(sbp, ' ');
+	    print_value(sbp, vdip->vdi_dprecision, /*plus=*/true,
+		    /*pad=*/true, cimag(z0));
+	}
+    }
+
+    /*
+     * For each parameter...
+     */
+    for (int format = 0; format < vdip->vdi_format_count; ++format) {
+	const vnadata_format_descriptor_t *vfdp =
+	    &vdip->vdi_format_vector[format];
+	const vnadata_t *matrix = NULL;
+	bool last_arg;
+	bool done = false;
 
 	/*
-	 * Add frequency-dependent reference impedances.
+	 * Get the required matrix.
 	 */
-	if (z0_vector == NULL) {
-	    const double complex *fz0_vector;
-
-	    fz0_vector = vnadata_get_fz0_vector(vdp, findex);
-	    for (int port = 0; port < ports; ++port) {
-		double complex z0 = fz0_vector[port];
-
-		(void)fputc(' ', fp);
-		print_value(fp, vdip->vdi_dprecision, /*plus=*/true,
-			/*pad=*/true, creal(z0));
-		(void)fputc(' ', fp);
-		print_value(fp, vdip->vdi_dprecision, /*plus=*/true,
-			/*pad=*/true, cimag(z0));
-	    }
+	assert(vfdp->vfd_parameter != VPT_UNDEF);
+	if (vfdp->vfd_parameter == type) {
+	    matrix = vdp;
+	} else {
+	    matrix = conversions[vfdp->vfd_parameter];
 	}
+	assert(matrix != NULL);
 
 	/*
-	 * For each parameter...
+	 * Print
 	 */
-	for (int format = 0; format < vdip->vdi_format_count; ++format) {
-	    const vnadata_format_descriptor_t *vfdp =
-		&vdip->vdi_format_vector[format];
-	    const vnadata_t *matrix = NULL;
-	    const double complex *data = NULL;
-	    bool last_arg;
-	    bool done = false;
+	switch (vfdp->vfd_parameter) {
+	case VPT_S:
+	    switch (vfdp->vfd_format) {
+	    case VNADATA_FORMAT_IL:
+		for (int row = 0; row < rows; ++row) {
+		    for (int column = 0; column < ports; ++column) {
+			double complex value;
 
-	    /*
-	     * Get the required matrix.
-	     */
-	    assert(vfdp->vfd_parameter != VPT_UNDEF);
-	    if (vfdp->vfd_parameter == type) {
-		matrix = vdp;
-	    } else {
-		matrix = conversions[vfdp->vfd_parameter];
-	    }
-	    assert(matrix != NULL);
-
-	    /*
-	     * Print
-	     */
-	    switch (vfdp->vfd_parameter) {
-	    case VPT_S:
-		switch (vfdp->vfd_format) {
-		case VNADATA_FORMAT_IL:
-		    for (int row = 0; row < rows; ++row) {
-			for (int column = 0; column < ports; ++column) {
-			    double complex value;
-
-			    if (row == column) {
-				continue;
-			    }
-			    value = vnadata_get_cell(matrix, findex, row,
-				    column);
-			    (void)fputc(' ', fp);
-			    last_arg = format == vdip->vdi_format_count - 1 &&
-				row == rows - 1 && column == ports - 1;
-			    print_value(fp, vdip->vdi_dprecision,
-				    /*plus=*/true, /*pad=*/!last_arg,
-				    -20.0 * log10(cabs(value)));
+			if (row == column) {
+			    continue;
 			}
-		    }
-		    done = true;
-		    break;
-
-		case VNADATA_FORMAT_RL:
-		    for (int port = 0; port < ports; ++port) {
-			double complex value;
-
-			value = vnadata_get_cell(matrix, findex, port, port);
-			(void)fputc(' ', fp);
+			value = vnadata_get_cell(matrix, findex, row,
+				column);
+			sb_putc(sbp, ' ');
 			last_arg = format == vdip->vdi_format_count - 1 &&
-			    port == ports - 1;
-			print_value(fp, vdip->vdi_dprecision,
+			    row == rows - 1 && column == ports - 1;
+			print_value(sbp, vdip->vdi_dprecision,
 				/*plus=*/true, /*pad=*/!last_arg,
 				-20.0 * log10(cabs(value)));
 		    }
-		    done = true;
-		    break;
-
-		case VNADATA_FORMAT_VSWR:
-		    for (int port = 0; port < ports; ++port) {
-			double complex sxx;
-			double a;
-			double vswr;
-
-			sxx = vnadata_get_cell(matrix, findex, port, port);
-			a = cabs(sxx);
-			vswr = (1.0 + a) / fabs(1.0 - a);
-			(void)fputc(' ', fp);
-			last_arg = format == vdip->vdi_format_count - 1 &&
-			    port == ports - 1;
-			print_value(fp, vdip->vdi_dprecision,
-				/*plus=*/false, /*pad=*/!last_arg, vswr);
-		    }
-		    done = true;
-		    break;
-
-		default:
-		    break;
 		}
-		if (done) {
-		    break;
-		}
-		/*FALLTHROUGH*/
+		done = true;
+		break;
 
-	    case VPT_T:
-	    case VPT_U:
-	    case VPT_Z:
-	    case VPT_Y:
-	    case VPT_H:
-	    case VPT_G:
-	    case VPT_A:
-	    case VPT_B:
-		for (int row = 0; row < rows; ++row) {
-		    for (int column = 0; column < ports; ++column) {
-			double complex value;
-			vnadata_filetype_t filetype = vdip->vdi_filetype;
-
-			/*
-			 * In Touchstone formats, break the line after
-			 * every four columns, and, except for two-port,
-			 * after every row.
-			 */
-			if ((filetype == VNADATA_FILETYPE_TOUCHSTONE1 ||
-			     filetype == VNADATA_FILETYPE_TOUCHSTONE2) &&
-			     ((column  != 0 && column % 4 == 0) ||
-			      (ports != 2 && row != 0 && column == 0))) {
-			    (void)fputc('\n', fp);
-			    for (int i = 0; i < vdip->vdi_fprecision + 5; ++i)
-				(void)fputc(' ', fp);
-			}
+	    case VNADATA_FORMAT_RL:
+		for (int port = 0; port < ports; ++port) {
+		    double complex value;
 
-			/*
-			 * Format based on vfd_format.
-			 *
-			 * Special case the 2x2 matrix in Touchstone 1
-			 * which prints in column major order.
-			 */
-			if (filetype == VNADATA_FILETYPE_TOUCHSTONE1 &&
-				ports == 2) {
-			    assert(rows == ports);
-			    value = vnadata_get_cell(matrix, findex,
-				    column, row);
-			} else {
-			    value = vnadata_get_cell(matrix, findex,
-				    row, column);
-			}
-			switch (vfdp->vfd_format) {
-			case VNADATA_FORMAT_DB_ANGLE:
-			    (void)fputc(' ', fp);
-			    print_value(fp, vdip->vdi_dprecision, /*plus=*/true,
-				    /*pad=*/true, 20.0 * log10(cabs(value)));
-			    if (aprecision == VNADATA_MAX_PRECISION) {
-				(void)fprintf(fp, " %+a",
-					180.0 / M_PI * carg(value));
-			    } else {
-				(void)fprintf(fp, " %+*.*f",
-					aprecision + 4,
-					aprecision - 1,
-					180.0 / M_PI * carg(value));
-			    }
-			    break;
-
-			case VNADATA_FORMAT_MAG_ANGLE:
-			    (void)fprintf(fp, "  ");
-			    print_value(fp, vdip->vdi_dprecision,
-				    /*plus=*/false,
-				    /*pad=*/true, cabs(value));
-			    if (aprecision == VNADATA_MAX_PRECISION) {
-				(void)fprintf(fp, " %+a",
-					180.0 / M_PI * carg(value));
-			    } else {
-				(void)fprintf(fp, " %+*.*f",
-					aprecision + 4,
-					aprecision - 1,
-					180.0 / M_PI * carg(value));
-			    }
-			    break;
-
-			case VNADATA_FORMAT_REAL_IMAG:
-			    last_arg = format == vdip->vdi_format_count - 1 &&
-				row == rows - 1 && column == ports - 1;
-			    (void)fputc(' ', fp);
-			    print_value(fp, vdip->vdi_dprecision, /*plus=*/true,
-				    /*pad=*/true, creal(value));
-			    (void)fputc(' ', fp);
-			    print_value(fp, vdip->vdi_dprecision, /*plus=*/true,
-				    /*pad=*/!last_arg, cimag(value));
-			    break;
-
-			default:
-			    abort();
-			    /*NOTREACHED*/
-			}
-		    }
+		    value = vnadata_get_cell(matrix, findex, port, port);
+		    sb_putc(sbp, ' ');
+		    last_arg = format == vdip->vdi_format_count - 1 &&
+			port == ports - 1;
+		    print_value(sbp, vdip->vdi_dprecision,
+			    /*plus=*/true, /*pad=*/!last_arg,
+			    -20.0 * log10(cabs(value)));
 		}
+		done = true;
 		break;
 
-	    case VPT_ZIN:
-		data = vnadata_get_matrix(matrix, findex);
+	    case VNADATA_FORMAT_VSWR:
 		for (int port = 0; port < ports; ++port) {
+		    double complex sxx;
+		    double a;
+		    double vswr;
+
+		    sxx = vnadata_get_cell(matrix, findex, port, port);
+		    a = cabs(sxx);
+		    vswr = (1.0 + a) / fabs(1.0 - a);
+		    sb_putc(sbp, ' ');
+		    last_arg = format == vdip->vdi_format_count - 1 &&
+			port == ports - 1;
+		    print_value(sbp, vdip->vdi_dprecision,
+			    /*plus=*/false, /*pad=*/!last_arg, vswr);
+		}
+		done = true;
+		break;
+
+	    default:
+		break;
+	    }
+	    if (done) {
+		break;
+	    }
+	    /*FALLTHROUGH*/
+
+	case VPT_T:
+	case VPT_U:
+	case VPT_Z:
+	case VPT_Y:
+	case VPT_H:
+	case VPT_G:
+	case VPT_A:
+	case VPT_B:
+	    for (int row = 0; row < rows; ++row) {
+		for (int column = 0; column < ports; ++column) {
 		    double complex value;
+		    vnadata_filetype_t filetype = vdip->vdi_filetype;
+
+		    /*
+		     * In Touchstone formats, break the line after
+		     * every four columns, and, except for two-port,
+		     * after every row.
+		     */
+		    if ((filetype == VNADATA_FILETYPE_TOUCHSTONE1 ||
+			 filetype == VNADATA_FILETYPE_TOUCHSTONE2) &&
+			 ((column  != 0 && column % 4 == 0) ||
+			  (ports != 2 && row != 0 && column == 0))) {
+			sb_putc(sbp, '\n');
+			for (int i = 0; i < vdip->vdi_fprecision + 5; ++i)
+			    sb_putc(sbp, ' ');
+		    }
 
-		    value = data[port];
+		    /*
+		     * Format based on vfd_format.
+		     *
+		     * Special case the 2x2 matrix in Touchstone 1
+		     * which prints in column major order.
+		     */
+		    if (filetype == VNADATA_FILETYPE_TOUCHSTONE1 &&
+			    ports == 2) {
+			assert(rows == ports);
+			value = vnadata_get_cell(matrix, findex,
+				column, row);
+		    } else {
+			value = vnadata_get_cell(matrix, findex,
+				row, column);
+		    }
 		    switch (vfdp->vfd_format) {
+		    case VNADATA_FORMAT_DB_ANGLE:
+			sb_putc(sbp, ' ');
+			print_value(sbp, vdip->vdi_dprecision,
+				/*plus=*/true,
+				/*pad=*/true, 20.0 * log10(cabs(value)));
+			if (aprecision == VNADATA_MAX_PRECISION) {
+			    sb_printf(sbp, " %+a",
+				    180.0 / M_PI * carg(value));
+			} else {
+			    sb_printf(sbp, " %+*.*f",
+				    aprecision + 4,
+				    aprecision - 1,
+				    180.0 / M_PI * carg(value));
+			}
+			break;
+
 		    case VNADATA_FORMAT_MAG_ANGLE:
-			(void)fprintf(fp, "  ");
-			print_value(fp, vdip->vdi_dprecision, /*plus=*/false,
+			sb_printf(sbp, "  ");
+			print_value(sbp, vdip->vdi_dprecision,
+				/*plus=*/false,
 				/*pad=*/true, cabs(value));
 			if (aprecision == VNADATA_MAX_PRECISION) {
-			    (void)fprintf(fp, " %+a",
+			    sb_printf(sbp, " %+a",
 				    180.0 / M_PI * carg(value));
 			} else {
-			    (void)fprintf(fp, "  %+*.*f",
-				    aprecision + 2,
-				    aprecision - 3,
+			    sb_printf(sbp, " %+*.*f",
+				    aprecision + 4,
+				    aprecision - 1,
 				    180.0 / M_PI * carg(value));
 			}
 			break;
 
 		    case VNADATA_FORMAT_REAL_IMAG:
 			last_arg = format == vdip->vdi_format_count - 1 &&
-			    port == ports - 1;
-			(void)fputc(' ', fp);
-			print_value(fp, vdip->vdi_dprecision, /*plus=*/true,
-				/*pad=*/true, creal(value));
-			(void)fputc(' ', fp);
-			print_value(fp, vdip->vdi_dprecision, /*plus=*/true,
+			    row == rows - 1 && column == ports - 1;
+			sb_putc(sbp, ' ');
+			print_value(sbp, vdip->vdi_dprecision,
+				/*plus=*/true, /*pad=*/true, creal(value));
+			sb_putc(sbp, ' ');
+			print_value(sbp, vdip->vdi_dprecision,
+				/*plus=*/true,
 				/*pad=*/!last_arg, cimag(value));
 			break;
 
-		    case VNADATA_FORMAT_PRC:
-			{
-			    double complex z;
-			    double zr, zi;
-			    double r, x, c;
-
-			    z = data[port];
-			    zr = creal(z);
-			    zi = cimag(z);
-			    r = (zr*zr + zi*zi) / zr;
-			    x = (zr*zr + zi*zi) / zi;
-			    c = -1.0 /
-				(2.0 * M_PI * frequency_vector[findex] * x);
-			    (void)fputc(' ', fp);
-			    print_value(fp, vdip->vdi_dprecision, /*plus=*/true,
-				    /*pad=*/true, r);
-			    (void)fputc(' ', fp);
-			    last_arg = format == vdip->vdi_format_count - 1 &&
-				port == ports - 1;
-			    print_value(fp, vdip->vdi_dprecision, /*plus=*/true,
-				    /*pad=*/!last_arg, c);
-			}
-			break;
+		    default:
+			abort();
+			/*NOTREACHED*/
+		    }
+		}
+	    }
+	    break;
 
-		    case VNADATA_FORMAT_PRL:
-			{
-			    double complex z;
-			    double zr, zi;
-			    double r, x, l;
-
-			    z = data[port];
-			    zr = creal(z);
-			    zi = cimag(z);
-			    r = (zr*zr + zi*zi) / zr;
-			    x = (zr*zr + zi*zi) / zi;
-			    l = x / (2.0 * M_PI * frequency_vector[findex]);
-			    (void)fputc(' ', fp);
-			    print_value(fp, vdip->vdi_dprecision, /*plus=*/true,
-				    /*pad=*/true, r);
-			    (void)fputc(' ', fp);
-			    last_arg = format == vdip->vdi_format_count - 1 &&
-				port == ports - 1;
-			    print_value(fp, vdip->vdi_dprecision, /*plus=*/true,
-				    /*pad=*/!last_arg, l);
-			}
-			break;
+	case VPT_ZIN:
+	    for (int port = 0; port < ports; ++port) {
+		double complex value;
 
-		    case VNADATA_FORMAT_SRC:
-			{
-			    double complex z;
-			    double zr, zi;
-			    double c;
-
-			    z = data[port];
-			    zr = creal(z);
-			    zi = cimag(z);
-			    c = -1.0 /
-				(2.0 * M_PI * frequency_vector[findex] * zi);
-			    (void)fputc(' ', fp);
-			    print_value(fp, vdip->vdi_dprecision, /*plus=*/true,
-				    /*pad=*/true, zr);
-			    (void)fputc(' ', fp);
-			    last_arg = format == vdip->vdi_format_count - 1 &&
-				port == ports - 1;
-			    print_value(fp, vdip->vdi_dprecision, /*plus=*/true,
-				    /*pad=*/!last_arg, c);
-			}
-			break;
+		value = vnadata_get_cell(matrix, findex, 0, port);
+		switch (vfdp->vfd_format) {
+		case VNADATA_FORMAT_MAG_ANGLE:
+		    sb_printf(sbp, "  ");
+		    print_value(sbp, vdip->vdi_dprecision, /*plus=*/false,
+			    /*pad=*/true, cabs(value));
+		    if (aprecision == VNADATA_MAX_PRECISION) {
+			sb_printf(sbp, " %+a",
+				180.0 / M_PI * carg(value));
+		    } else {
+			sb_printf(sbp, "  %+*.*f",
+				aprecision + 2,
+				aprecision - 3,
+				180.0 / M_PI * carg(value));
+		    }
+		    break;
 
-		    case VNADATA_FORMAT_SRL:
-			{
-			    double complex z;
-			    double zr, zi;
-			    double l;
-
-			    z = data[port];
-			    zr = creal(z);
-			    zi = cimag(z);
-			    l = zi / (2.0 * M_PI * frequency_vector[findex]);
-			    (void)fputc(' ', fp);
-			    print_value(fp, vdip->vdi_dprecision, /*plus=*/true,
-				    /*pad=*/true, zr);
-			    (void)fputc(' ', fp);
-			    last_arg = format == vdip->vdi_format_count - 1 &&
-				port == ports - 1;
-			    print_value(fp, vdip->vdi_dprecision, /*plus=*/true,
-				    /*pad=*/!last_arg, l);
-			}
-			break;
+		case VNADATA_FORMAT_REAL_IMAG:
+		    last_arg = format == vdip->vdi_format_count - 1 &&
+			port == ports - 1;
+		    sb_putc(sbp, ' ');
+		    print_value(sbp, vdip->vdi_dprecision, /*plus=*/true,
+			    /*pad=*/true, creal(value));
+		    sb_putc(sbp, ' ');
+		    print_value(sbp, vdip->vdi_dprecision, /*plus=*/true,
+			    /*pad=*/!last_arg, cimag(value));
+		    break;
 
-		    default:
-			abort();
-			/*NOTREACHED*/
+		case VNADATA_FORMAT_PRC:
+		    {
+			double complex z;
+			double zr, zi;
+			double r, x, c;
+
+			z = value;
+			zr = creal(z);
+			zi = cimag(z);
+			r = (zr*zr + zi*zi) / zr;
+			x = (zr*zr + zi*zi) / zi;
+			c = -1.0 /
+			    (2.0 * M_PI * frequency_vector[findex] * x);
+			sb_putc(sbp, ' ');
+			print_value(sbp, vdip->vdi_dprecision,
+				/*plus=*/true, /*pad=*/true, r);
+			sb_putc(sbp, ' ');
+			last_arg = format == vdip->vdi_format_count - 1 &&
+			    port == ports - 1;
+			print_value(sbp, vdip->vdi_dprecision,
+				/*plus=*/true, /*pad=*/!last_arg, c);
 		    }
+		    break;
+
+		case VNADATA_FORMAT_PRL:
+		    {
+			double complex z;
+			double zr, zi;
+			double r, x, l;
+
+			z = value;
+			zr = creal(z);
+			zi = cimag(z);
+			r = (zr*zr + zi*zi) / zr;
+			x = (zr*zr + zi*zi) / zi;
+			l = x / (2.0 * M_PI * frequency_vector[findex]);
+			sb_putc(sbp, ' ');
+			print_value(sbp, vdip->vdi_dprecision,
+				/*plus=*/true, /*pad=*/true, r);
+			sb_putc(sbp, ' ');
+			last_arg = format == vdip->vdi_format_count - 1 &&
+			    port == ports - 1;
+			print_value(sbp, vdip->vdi_dprecision,
+				/*plus=*/true, /*pad=*/!last_arg, l);
+		    }
+		    break;
+
+		case VNADATA_FORMAT_SRC:
+		    {
+			double complex z;
+			double zr, zi;
+			double c;
+
+			z = value;
+			zr = creal(z);
+			zi = cimag(z);
+			c = -1.0 /
+			    (2.0 * M_PI * frequency_vector[findex] * zi);
+			sb_putc(sbp, ' ');
+			print_value(sbp, vdip->vdi_dprecision,
+				/*plus=*/true, /*pad=*/true, zr);
+			sb_putc(sbp, ' ');
+			last_arg = format == vdip->vdi_format_count - 1 &&
+			    port == ports - 1;
+			print_value(sbp, vdip->vdi_dprecision,
+				/*plus=*/true, /*pad=*/!last_arg, c);
+		    }
+		    break;
+
+		case VNADATA_FORMAT_SRL:
+		    {
+			double complex z;
+			double zr, zi;
+			double l;
+
+			z = value;
+			zr = creal(z);
+			zi = cimag(z);
+			l = zi / (2.0 * M_PI * frequency_vector[findex]);
+			sb_putc(sbp, ' ');
+			print_value(sbp, vdip->vdi_dprecision,
+				/*plus=*/true, /*pad=*/true, zr);
+			sb_putc(sbp, ' ');
+			last_arg = format == vdip->vdi_format_count - 1 &&
+			    port == ports - 1;
+			print_value(sbp, vdip->vdi_dprecision,
+				/*plus=*/true, /*pad=*/!last_arg, l);
+		    }
+		    break;
+
+		default:
+		    abort();
+		    /*NOTREACHED*/
 		}
-		break;
+	    }
+	    break;
 
-	    default:
-		abort();
-		/*NOTREACHED*/
+	default:
+	    abort();
+	    /*NOTREACHED*/
+	}
+    }
+    sb_putc(sbp, '\n');
+}
+
+/*
+ * vnadata_save_common: common save routine
+ *   @vdp: a pointer to the vnadata_t structure
+ *   @fp: file pointer
+ *   @filename: filename used in error messages and to intuit the file type
+ *   @function: function name (for error messages)
+ */
+static int vnadata_save_common(vnadata_t *vdp, FILE *fp, const char *filename,
+	const char *function)
+{
+    vnadata_internal_t *vdip;
+    int frequencies;
+    int rc = -1;
+    double z0_touchstone = 50.0;
+    vnadata_t *conversions[VPT_NTYPES];
+    save_buffer_t *sbp = NULL;
+    char *temp_filename = NULL;
+
+    /*
+     * Validate pointer.
+     */
+    if (vdp == NULL) {
+	errno = EINVAL;
+	return -1;
+    }
+    vdip = VDP_TO_VDIP(vdp);
+    if (vdip->vdi_magic != VDI_MAGIC) {
+	errno = EINVAL;
+	return -1;
+    }
+
+    /*
+     * Init conversions to NULL.
+     */
+    (void)memset((void *)conversions, 0, sizeof(conversions));
+
+    /*
+     * Validate parameters.  These errors are for the application
+     * developer, not the end user, so show the function name.
+     */
+    if (function == vnadata_fsave_name && fp == NULL) {
+	_vnadata_error(vdip, VNAERR_USAGE,
+		"%s: error: NULL file pointer", function);
+	goto out;
+    }
+    if (filename == NULL) {
+	_vnadata_error(vdip, VNAERR_USAGE,
+		"%s: error: NULL filename", function);
+	goto out;
+    }
+
+    /*
+     * Check the data, filetype and format.
+     */
+    if (check_save(vdip, filename, function,
+		/*need_frequencies=*/true) == -1) {
+	goto out;
+    }
+    frequencies = vdp->vd_frequencies;
+    if (!(vdip->vdi_flags & VF_PER_F_Z0)) {
+	z0_touchstone = creal(vdip->vdi_z0_vector[0]);
+    }
+
+    /*
+     * The binary format stores the data as they are without conversion.
+     */
+    if (vdip->vdi_filetype == VNADATA_FILETYPE_NPDB) {
+	if (function == vnadata_check_name) {
+	    rc = 0;
+	    goto out;
+	}
+	/*
+	 * Write a temporary file and rename it over the target so that
+	 * anyone who has the old file mapped, including vdp itself,
+	 * keeps the old contents.
+	 */
+	if (function == vnadata_save_name) {
+	    if ((fp = _vnacommon_replace_open(filename,
+			    &temp_filename)) == NULL) {
+		_vnadata_error(vdip, VNAERR_SYSTEM, "open: %s: %s",
+			filename, strerror(errno));
+		goto out;
 	    }
 	}
-	(void)fputc('\n', fp);
+	if (_vnadata_save_npdb(vdip, fp, filename) == -1) {
+	    goto out;
+	}
+	goto close;
+    }
+
+    /*
+     * If vnadata_cksave, we're done.
+     */
+    if (function == vnadata_check_name) {
+	rc = 0;
+	goto out;
+    }
+
+    /*
+     * Normalize and convert the data, then fill in missing parameter
+     * types in the format vector from the type of the (possibly
+     * normalized) data.
+     */
+    if (prepare_data(&vdp, conversions) == -1) {
+	goto out;
+    }
+    vdip = VDP_TO_VDIP(vdp);
+    if (fix_formats(vdip, vdp->vd_type) == -1) {
+	goto out;
+    }
+
+    /*
+     * If vnadata_save, open the output file.
+     */
+    if (function == vnadata_save_name) {
+	if ((fp = fopen(filename, "w")) == NULL) {
+	    _vnadata_error(vdip, VNAERR_SYSTEM, "fopen: %s: %s",
+		    filename, strerror(errno));
+	    goto out;
+	}
+    }
+    if ((sbp = _vnamem_malloc(sizeof(save_buffer_t))) == NULL) {
+	_vnadata_error(vdip, VNAERR_SYSTEM, "malloc: %s", strerror(errno));
+	goto out;
+    }
+    sbp->sb_fp = fp;
+    sbp->sb_length = 0;
+    sbp->sb_written = 0;
+    sbp->sb_errno = 0;
+
+    /*
+     * Print the file header and each frequency.
+     */
+    print_header(vdip, sbp, z0_touchstone, NULL);
+    for (int findex = 0; findex < frequencies; ++findex) {
+	print_record(vdp, conversions, sbp, findex);
     }
 
     /*
      * If Touchstone 2, add the End keyword.
      */
     if (vdip->vdi_filetype == VNADATA_FILETYPE_TOUCHSTONE2) {
-	(void)fprintf(fp, "[End]\n");
+	sb_printf(sbp, "[End]\n");
+    }
+    sb_flush(sbp);
+    if (sbp->sb_errno != 0) {
+	_vnadata_error(vdip, VNAERR_SYSTEM, "fwrite: %s: %s",
+		filename, strerror(sbp->sb_errno));
+	goto out;
     }
 
     /*
      * If vnadata_save, close the output file.
      */
+close:
     if (function == vnadata_save_name) {
 	if (fclose(fp) == -1) {
 	    _vnadata_error(vdip, VNAERR_SYSTEM, "fclose: %s: %s",
@@ -1506,6 +1783,16 @@ static int vnadata_save_common(vnadata_t *vdp, FILE *fp, const char *filename,
 	    goto out;
 	}
 	fp = NULL;
+	if (temp_filename != NULL) {
+	    int rv = _vnacommon_replace_finish(temp_filename, filename);
+
+	    temp_filename = NULL;
+	    if (rv == -1) {
+		_vnadata_error(vdip, VNAERR_SYSTEM, "rename: %s: %s",
+			filename, strerror(errno));
+		goto out;
+	    }
+	}
     }
     _vnadata_set_name_from_filename(vdip, filename);
     rc = 0;
@@ -1515,6 +1802,8 @@ out:
 	(void)fclose(fp);
 	fp = NULL;
     }
+    _vnacommon_replace_cancel(temp_filename);
+    _vnamem_free((void *)sbp);
     for (int i = 0; i < VPT_NTYPES; ++i) {
 	vnadata_free(conversions[i]);
 	conversions[i] = NULL;
@@ -1540,7 +1829,12 @@ int vnadata_cksave(vnadata_t *vdp, const char *filename)
  */
 int vnadata_fsave(vnadata_t *vdp, FILE *fp, const char *filename)
 {
-    return vnadata_save_common(vdp, fp, filename, vnadata_fsave_name);
+    uint64_t start = _VNASTATS_NOW();
+    int rv;
+
+    rv = vnadata_save_common(vdp, fp, filename, vnadata_fsave_name);
+    _VNASTATS_TIME(_vnadata_stats, vds_save_calls, vds_save_ns, start);
+    return rv;
 }
 
 /*
@@ -1550,5 +1844,455 @@ int vnadata_fsave(vnadata_t *vdp, FILE *fp, const char *filename)
  */
 int vnadata_save(vnadata_t *vdp, const char *filename)
 {
-    return vnadata_save_common(vdp, NULL, filename, vnadata_save_name);
+    uint64_t start = _VNASTATS_NOW();
+    int rv;
+
+    rv = vnadata_save_common(vdp, NULL, filename, vnadata_save_name);
+    _VNASTATS_TIME(_vnadata_stats, vds_save_calls, vds_save_ns, start);
+    return rv;
+}
+
+/*
+ * vnadata_writer_t: state for writing a file one frequency at a time
+ */
+struct vnadata_writer {
+    vnadata_t		       *vw_vdp;		/* current record */
+    FILE		       *vw_fp;
+    bool			vw_close_fp;
+    char		       *vw_filename;
+    long			vw_base;	/* offset of the header */
+    long			vw_count_offset;/* offset of count or -1 */
+    int				vw_capacity;	/* maximum frequencies or -1 */
+    double			vw_z0_touchstone;
+    int				vw_frequencies;	/* frequencies appended */
+    bool			vw_failed;	/* output is incomplete */
+    save_buffer_t	       *vw_sbp;
+    npdb_stream_t	       *vw_nsp;
+    vnadata_t		       *vw_conversions[VPT_NTYPES];
+    vnamem_allocator_t		vw_allocator;	/* holds writer and buffers */
+};
+
+/*
+ * Function Names
+ */
+static const char vnadata_writer_open_name[] = "vnadata_writer_open";
+static const char vnadata_writer_fopen_name[] = "vnadata_writer_fopen";
+
+/*
+ * writer_free: free a writer without completing the file
+ *   @vwp: writer
+ */
+static void writer_free(vnadata_writer_t *vwp)
+{
+    vnamem_allocator_t allocator = vwp->vw_allocator;
+
+    if (vwp->vw_close_fp && vwp->vw_fp != NULL) {
+	(void)fclose(vwp->vw_fp);
+    }
+    _vnadata_npdb_stream_close(vwp->vw_nsp);
+    _vnamem_afree(&allocator, (void *)vwp->vw_sbp);
+    for (int i = 0; i < VPT_NTYPES; ++i) {
+	vnadata_free(vwp->vw_conversions[i]);
+    }
+    vnadata_free(vwp->vw_vdp);
+    _vnamem_afree(&allocator, (void *)vwp->vw_filename);
+    _vnamem_afree(&allocator, (void *)vwp);
+}
+
+/*
+ * writer_open_common: set up the writer and write the file header
+ *   @vdip_template: internal parameter matrix used as the template
+ *   @fp: file pointer, or NULL to open filename
+ *   @filename: filename used in error messages and to intuit the file type
+ *   @function: function name (for error messages)
+ */
+static vnadata_writer_t *writer_open_common(vnadata_internal_t *vdip_template,
+	FILE *fp, const char *filename, const char *function)
+{
+    const vnadata_t *vdp_template = &vdip_template->vdi_vd;
+    const bool per_f_z0 = (vdip_template->vdi_flags & VF_PER_F_Z0) != 0;
+    vnamem_allocator_t allocator;
+    vnadata_writer_t *vwp;
+    vnadata_internal_t *vdip;
+    vnadata_t *vdp;
+    vnadata_parameter_type_t type;
+
+    if (filename == NULL) {
+	_vnadata_error(vdip_template, VNAERR_USAGE,
+		"%s: error: NULL filename", function);
+	return NULL;
+    }
+    if (function == vnadata_writer_fopen_name && fp == NULL) {
+	_vnadata_error(vdip_template, VNAERR_USAGE,
+		"%s: error: NULL file pointer", function);
+	return NULL;
+    }
+    vnamem_get_allocator(&allocator);
+    if ((vwp = _vnamem_acalloc(&allocator, 1,
+		    sizeof(vnadata_writer_t))) == NULL) {
+	_vnadata_error(vdip_template, VNAERR_SYSTEM,
+		"calloc: %s", strerror(errno));
+	return NULL;
+    }
+    vwp->vw_allocator = allocator;
+    vwp->vw_count_offset = -1;
+    vwp->vw_capacity = -1;
+    if ((vwp->vw_filename = _vnamem_astrdup(&allocator,
+		    filename)) == NULL) {
+	_vnadata_error(vdip_template, VNAERR_SYSTEM,
+		"strdup: %s", strerror(errno));
+	goto error;
+    }
+
+    /*
+     * Make a private copy of the template with no frequencies.  Take
+     * the type, dimensions, reference impedances, filetype, format,
+     * precisions and name.
+     */
+    if ((vdp = vnadata_alloc(vdip_template->vdi_error_fn,
+		    vdip_template->vdi_error_arg)) == NULL) {
+	goto error;
+    }
+    vwp->vw_vdp = vdp;
+    vdip = VDP_TO_VDIP(vdp);
+    type = vdp_template->vd_type;
+    if (vnadata_init(vdp, type, vdp_template->vd_rows,
+		vdp_template->vd_columns, 0) == -1) {
+	goto error;
+    }
+    if (per_f_z0) {
+	if (_vnadata_convert_to_fz0(vdip) == -1) {
+	    goto error;
+	}
+    } else if (vnadata_set_z0_vector(vdp,
+		vdip_template->vdi_z0_vector) == -1) {
+	goto error;
+    }
+    vdip->vdi_filetype = vdip_template->vdi_filetype;
+    if (vnadata_set_format(vdp, vdip_template->vdi_format_string) == -1 ||
+	    vnadata_set_fprecision(vdp, vdip_template->vdi_fprecision) == -1 ||
+	    vnadata_set_dprecision(vdp, vdip_template->vdi_dprecision) == -1) {
+	goto error;
+    }
+    if ((vdip_template->vdi_flags & VF_NAME_SET) &&
+	    vnadata_set_name(vdp, vdip_template->vdi_name) == -1) {
+	goto error;
+    }
+
+    /*
+     * Check the data, filetype and format as vnadata_save would.
+     */
+    if (check_save(vdip, filename, function,
+		/*need_frequencies=*/false) == -1) {
+	goto error;
+    }
+
+    /*
+     * Open the file if needed.  Except for Touchstone 1, which doesn't
+     * record the number of frequencies, the stream must be seekable.
+     */
+    if (fp == NULL) {
+	const char *mode = vdip->vdi_filetype == VNADATA_FILETYPE_NPDB ?
+	    "wb" : "w";
+
+	if ((fp = fopen(filename, mode)) == NULL) {
+	    _vnadata_error(vdip, VNAERR_SYSTEM, "fopen: %s: %s",
+		    filename, strerror(errno));
+	    goto error;
+	}
+	vwp->vw_close_fp = true;
+    }
+    vwp->vw_fp = fp;
+    if (vdip->vdi_filetype != VNADATA_FILETYPE_TOUCHSTONE1 &&
+	    (vwp->vw_base = ftell(fp)) == -1) {
+	_vnadata_error(vdip, VNAERR_USAGE, "%s: %s: stream must be "
+		"seekable to update the number of frequencies",
+		function, filename);
+	goto error;
+    }
+
+    /*
+     * The binary format reserves space for the number of frequencies
+     * in the template.
+     */
+    if (vdip->vdi_filetype == VNADATA_FILETYPE_NPDB) {
+	if (vdp_template->vd_frequencies == 0) {
+	    _vnadata_error(vdip, VNAERR_USAGE, "%s: %s: the template "
+		    "must have as many frequencies as the file will hold",
+		    function, filename);
+	    goto error;
+	}
+	vwp->vw_capacity = vdp_template->vd_frequencies;
+	if ((vwp->vw_nsp = _vnadata_npdb_stream_open(vdip, fp,
+			vwp->vw_filename, vwp->vw_capacity,
+			per_f_z0)) == NULL) {
+	    goto error;
+	}
+
+    } else {
+	/*
+	 * Fill in missing parameter types in the format as vnadata_save
+	 * does, using the type of the normalized data if Touchstone 1
+	 * normalizes the reference impedances, and print the header.
+	 */
+	if (!per_f_z0) {
+	    vwp->vw_z0_touchstone = creal(vdip->vdi_z0_vector[0]);
+	}
+	if (vdip->vdi_filetype == VNADATA_FILETYPE_TOUCHSTONE1 &&
+		vdip->vdi_z0_vector[0] != 1.0) {
+	    type = touchstone1_type(type);
+	}
+	if (fix_formats(vdip, type) == -1) {
+	    goto error;
+	}
+	if ((vwp->vw_sbp = _vnamem_amalloc(&allocator,
+			sizeof(save_buffer_t))) == NULL) {
+	    _vnadata_error(vdip, VNAERR_SYSTEM,
+		    "malloc: %s", strerror(errno));
+	    goto error;
+	}
+	vwp->vw_sbp->sb_fp = fp;
+	vwp->vw_sbp->sb_length = 0;
+	vwp->vw_sbp->sb_written = 0;
+	vwp->vw_sbp->sb_errno = 0;
+	print_header(vdip, vwp->vw_sbp, vwp->vw_z0_touchstone,
+		vdip->vdi_filetype != VNADATA_FILETYPE_TOUCHSTONE1 ?
+		&vwp->vw_count_offset : NULL);
+    }
+
+    /*
+     * Hold each record as the only frequency of vdp.
+     */
+    if (vnadata_resize(vdp, vdp->vd_type, vdp->vd_rows,
+		vdp->vd_columns, 1) == -1) {
+	goto error;
+    }
+    return vwp;
+
+error:
+    writer_free(vwp);
+    return NULL;
+}
+
+/*
+ * vnadata_writer_open: create a file and write its header
+ *   @vdp: template giving type, dimensions, z0, format and precisions
+ *   @filename: file to create
+ */
+vnadata_writer_t *vnadata_writer_open(vnadata_t *vdp, const char *filename)
+{
+    vnadata_internal_t *vdip;
+
+    if (vdp == NULL) {
+	errno = EINVAL;
+	return NULL;
+    }
+    vdip = VDP_TO_VDIP(vdp);
+    if (vdip->vdi_magic != VDI_MAGIC) {
+	errno = EINVAL;
+	return NULL;
+    }
+    return writer_open_common(vdip, NULL, filename,
+	    vnadata_writer_open_name);
+}
+
+/*
+ * vnadata_writer_fopen: write a file header to a file pointer
+ *   @vdp: template giving type, dimensions, z0, format and precisions
+ *   @fp: file pointer
+ *   @filename: filename used in error messages and to intuit the file type
+ */
+vnadata_writer_t *vnadata_writer_fopen(vnadata_t *vdp, FILE *fp,
+	const char *filename)
+{
+    vnadata_internal_t *vdip;
+
+    if (vdp == NULL) {
+	errno = EINVAL;
+	return NULL;
+    }
+    vdip = VDP_TO_VDIP(vdp);
+    if (vdip->vdi_magic != VDI_MAGIC) {
+	errno = EINVAL;
+	return NULL;
+    }
+    return writer_open_common(vdip, fp, filename,
+	    vnadata_writer_fopen_name);
+}
+
+/*
+ * vnadata_writer_append: format one frequency into the output
+ *   @vwp: pointer returned from vnadata_writer_open
+ *   @frequency: frequency in Hz
+ *   @matrix: serialized rows x columns matrix in the template's type
+ *   @z0_vector: per-frequency reference impedances, or NULL
+ */
+int vnadata_writer_append(vnadata_writer_t *vwp, double frequency,
+	const double complex *matrix, const double complex *z0_vector)
+{
+    vnadata_t *vdp;
+    vnadata_internal_t *vdip;
+    bool per_f_z0;
+
+    if (vwp == NULL) {
+	errno = EINVAL;
+	return -1;
+    }
+    vdp = vwp->vw_vdp;
+    vdip = VDP_TO_VDIP(vdp);
+    per_f_z0 = (vdip->vdi_flags & VF_PER_F_Z0) != 0;
+    if (vwp->vw_failed) {
+	_vnadata_error(vdip, VNAERR_USAGE, "vnadata_writer_append: %s: "
+		"error: writer has failed", vwp->vw_filename);
+	return -1;
+    }
+    if (matrix == NULL) {
+	_vnadata_error(vdip, VNAERR_USAGE,
+		"vnadata_writer_append: error: NULL matrix");
+	return -1;
+    }
+    if (per_f_z0 != (z0_vector != NULL)) {
+	_vnadata_error(vdip, VNAERR_USAGE, "vnadata_writer_append: error: "
+		"z0_vector must be given if and only if the template has "
+		"per-frequency reference impedances");
+	return -1;
+    }
+    if (vwp->vw_frequencies != 0 &&
+	    !(frequency > vnadata_get_frequency(vdp, 0))) {
+	_vnadata_error(vdip, VNAERR_USAGE, "vnadata_writer_append: %s: "
+		"error: frequencies must be in increasing order",
+		vwp->vw_filename);
+	return -1;
+    }
+    if (vwp->vw_capacity != -1 && vwp->vw_frequencies >= vwp->vw_capacity) {
+	_vnadata_error(vdip, VNAERR_USAGE, "vnadata_writer_append: %s: "
+		"error: more than the %d reserved frequencies",
+		vwp->vw_filename, vwp->vw_capacity);
+	return -1;
+    }
+    if (_vnadata_store_record(vdip, 0, frequency, matrix, z0_vector) == -1) {
+	return -1;
+    }
+
+    /*
+     * The binary format stores the record as it is; otherwise,
+     * normalize and convert it, and format it as vnadata_fsave would.
+     */
+    if (vwp->vw_nsp != NULL) {
+	if (_vnadata_npdb_stream_append(vwp->vw_nsp, frequency, matrix,
+		    z0_vector) == -1) {
+	    vwp->vw_failed = true;
+	    return -1;
+	}
+    } else {
+	if (prepare_data(&vdp, vwp->vw_conversions) == -1) {
+	    return -1;
+	}
+	print_record(vdp, vwp->vw_conversions, vwp->vw_sbp, 0);
+	if (vwp->vw_sbp->sb_errno != 0) {
+	    _vnadata_error(vdip, VNAERR_SYSTEM, "fwrite: %s: %s",
+		    vwp->vw_filename, strerror(vwp->vw_sbp->sb_errno));
+	    vwp->vw_failed = true;
+	    return -1;
+	}
+    }
+    ++vwp->vw_frequencies;
+    return 0;
+}
+
+/*
+ * vnadata_writer_flush: write buffered output and update the header
+ *   @vwp: pointer returned from vnadata_writer_open
+ */
+int vnadata_writer_flush(vnadata_writer_t *vwp)
+{
+    vnadata_internal_t *vdip;
+    save_buffer_t *sbp;
+
+    if (vwp == NULL) {
+	errno = EINVAL;
+	return -1;
+    }
+    vdip = VDP_TO_VDIP(vwp->vw_vdp);
+    if (vwp->vw_failed) {
+	_vnadata_error(vdip, VNAERR_USAGE, "vnadata_writer_flush: %s: "
+		"error: writer has failed", vwp->vw_filename);
+	return -1;
+    }
+    if (vwp->vw_nsp != NULL) {
+	if (_vnadata_npdb_stream_flush(vwp->vw_nsp) == -1) {
+	    vwp->vw_failed = true;
+	    return -1;
+	}
+	return 0;
+    }
+
+    /*
+     * Write the buffer, then rewrite the padded frequency count in
+     * place and return to the end of the output.
+     */
+    sbp = vwp->vw_sbp;
+    sb_flush(sbp);
+    if (sbp->sb_errno != 0) {
+	_vnadata_error(vdip, VNAERR_SYSTEM, "fwrite: %s: %s",
+		vwp->vw_filename, strerror(sbp->sb_errno));
+	vwp->vw_failed = true;
+	return -1;
+    }
+    if (vwp->vw_count_offset != -1) {
+	if (fseek(vwp->vw_fp, vwp->vw_base + vwp->vw_count_offset,
+		    SEEK_SET) == -1 ||
+		fprintf(vwp->vw_fp, "%-*d", VNADATA_COUNT_WIDTH,
+		    vwp->vw_frequencies) < 0 ||
+		fseek(vwp->vw_fp, vwp->vw_base + sbp->sb_written,
+		    SEEK_SET) == -1) {
+	    _vnadata_error(vdip, VNAERR_SYSTEM, "fwrite: %s: %s",
+		    vwp->vw_filename, strerror(errno));
+	    vwp->vw_failed = true;
+	    return -1;
+	}
+    }
+    if (fflush(vwp->vw_fp) == EOF) {
+	_vnadata_error(vdip, VNAERR_SYSTEM, "fflush: %s: %s",
+		vwp->vw_filename, strerror(errno));
+	vwp->vw_failed = true;
+	return -1;
+    }
+    return 0;
+}
+
+/*
+ * vnadata_writer_close: complete the file and free the writer
+ *   @vwp: pointer returned from vnadata_writer_open
+ */
+int vnadata_writer_close(vnadata_writer_t *vwp)
+{
+    vnadata_internal_t *vdip;
+    int rc = 0;
+
+    if (vwp == NULL) {
+	errno = EINVAL;
+	return -1;
+    }
+    vdip = VDP_TO_VDIP(vwp->vw_vdp);
+    if (vwp->vw_failed) {
+	rc = -1;
+    } else {
+	if (vdip->vdi_filetype == VNADATA_FILETYPE_TOUCHSTONE2) {
+	    sb_printf(vwp->vw_sbp, "[End]\n");
+	}
+	if (vnadata_writer_flush(vwp) == -1) {
+	    rc = -1;
+	}
+    }
+    if (vwp->vw_close_fp) {
+	vwp->vw_close_fp = false;
+	if (fclose(vwp->vw_fp) == -1 && rc == 0) {
+	    _vnadata_error(vdip, VNAERR_SYSTEM, "fclose: %s: %s",
+		    vwp->vw_filename, strerror(errno));
+	    rc = -1;
+	}
+    }
+    writer_free(vwp);
+    return rc;
 }
@@ -0,0 +1,64 @@
+/*
+ * Vector Network Analyzer Library
+ * Copyright © 2020-2023 D Scott Guthridge <scott_guthridge@rompromity.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "archdep.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include "vnadata_internal.h"
+
+
+/*
+ * vnadata_set_allocator: set the allocator for the data and frequency storage
+ *   @vdp: a pointer to the vnadata_t structure
+ *   @allocator: allocator to use, or NULL for the global allocator
+ */
+int vnadata_set_allocator(vnadata_t *vdp,
+	const vnamem_allocator_t *allocator)
+{
+    vnadata_internal_t *vdip;
+
+    if (vdp == NULL) {
+	errno = EINVAL;
+	return -1;
+    }
+    vdip = VDP_TO_VDIP(vdp);
+    if (vdip->vdi_magic != VDI_MAGIC) {
+	errno = EINVAL;
+	return -1;
+    }
+    if (vdip->vdi_p_allocation != 0 || vdip->vdi_f_allocation != 0 ||
+	    vdip->vdi_m_allocation != 0 || vdp->vd_data != NULL ||
+	    vdp->vd_view || vdip->vdi_format_vector != NULL) {
+	_vnadata_error(vdip, VNAERR_USAGE, "vnadata_set_allocator: "
+		"must be called before storage is allocated");
+	return -1;
+    }
+    if (allocator == NULL) {
+	vnamem_get_allocator(&vdip->vdi_allocator);
+	return 0;
+    }
+    if (allocator->vma_alloc == NULL || allocator->vma_realloc == NULL ||
+	    allocator->vma_free == NULL) {
+	_vnadata_error(vdip, VNAERR_USAGE,
+		"vnadata_set_allocator: invalid allocator");
+	return -1;
+    }
+    vdip->vdi_allocator = *allocator;
+    return 0;
+}
@@ -52,6 +52,7 @@ int vnadata_set_filetype(vnadata_t *vdp, vnadata_filetype_t filetype)
     case VNADATA_FILETYPE_TOUCHSTONE1:
     case VNADATA_FILETYPE_TOUCHSTONE2:
     case VNADATA_FILETYPE_NPD:
+    case VNADATA_FILETYPE_NPDB:
 	break;
 
     default:
@@ -245,7 +245,7 @@ int vnadata_set_format(vnadata_t *vdp, const char *format)
      * upper-case converted to lower.  Count comma-separated
      * fields and convert all commas to NUL's.
      */
-    if ((format_copy = malloc(length + 1)) == NULL) {
+    if ((format_copy = _vnamem_malloc(length + 1)) == NULL) {
 	_vnadata_error(vdip, VNAERR_SYSTEM,
 		"malloc: %s", strerror(errno));
 	return -1;
@@ -273,7 +273,7 @@ int vnadata_set_format(vnadata_t *vdp, const char *format)
     /*
      * Allocate a new format vector.
      */
-    if ((vfdp_new = calloc(nfields,
+    if ((vfdp_new = _vnadata_calloc(vdip, nfields,
 		    sizeof(vnadata_format_descriptor_t))) == NULL) {
 	_vnadata_error(vdip, VNAERR_SYSTEM,
 		"malloc: %s", strerror(errno));
@@ -300,7 +300,7 @@ int vnadata_set_format(vnadata_t *vdp, const char *format)
      * Replace the current format vector.
      */
 update:
-    free((void *)vdip->vdi_format_vector);
+    _vnadata_free(vdip, (void *)vdip->vdi_format_vector);
     vdip->vdi_format_vector = vfdp_new;
     vfdp_new = NULL;
     vdip->vdi_format_count = nfields;
@@ -314,7 +314,7 @@ update:
     rc = 0;
 
 out:
-    free((void *)vfdp_new);
-    free((void *)format_copy);
+    _vnadata_free(vdip, (void *)vfdp_new);
+    _vnamem_free((void *)format_copy);
     return rc;
 }
@@ -0,0 +1,126 @@
+/*
+ * Vector Network Analyzer Library
+ * Copyright © 2020-2023 D Scott Guthridge <scott_guthridge@rompromity.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "archdep.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include "vnadata_internal.h"
+
+
+/*
+ * free_vectors: free a vector of vectors
+ *   @vdip: pointer to vnadata_internal_t structure owning the vectors
+ *   @vector_vector: vector to free
+ *   @length: number of sub-vectors
+ */
+static void free_vectors(vnadata_internal_t *vdip,
+	double complex **vector_vector, int length)
+{
+    if (vector_vector != NULL) {
+	for (int i = 0; i < length; ++i) {
+	    _vnadata_free(vdip, (void *)vector_vector[i]);
+	}
+	_vnadata_free(vdip, (void *)vector_vector);
+    }
+}
+
+/*
+ * vnadata_set_layout: change the storage layout, preserving values
+ *   @vdp: a pointer to the vnadata_t structure
+ *   @layout: new layout
+ *
+ *   Allocations of the new layout are the same as those of the
+ *   old, so vacated frequencies and cells remain zero-filled.
+ */
+int vnadata_set_layout(vnadata_t *vdp, vnadata_layout_t layout)
+{
+    vnadata_internal_t *vdip;
+    int outer, inner;
+    double complex **new_data = NULL;
+
+    if (vdp == NULL) {
+	errno = EINVAL;
+	return -1;
+    }
+    vdip = VDP_TO_VDIP(vdp);
+    if (vdip->vdi_magic != VDI_MAGIC) {
+	errno = EINVAL;
+	return -1;
+    }
+    if (layout != VNADATA_LAYOUT_FREQUENCY_MAJOR &&
+	    layout != VNADATA_LAYOUT_CELL_MAJOR) {
+	_vnadata_error(vdip, VNAERR_USAGE,
+		"vnadata_set_layout: invalid layout: %d", (int)layout);
+	return -1;
+    }
+    if (layout == vdp->vd_layout) {
+	return 0;
+    }
+    if (vdp->vd_view && _vnadata_materialize_view(vdp) == -1) {
+	return -1;
+    }
+
+    /*
+     * Determine the dimensions of the new vector of vectors.
+     */
+    if (layout == VNADATA_LAYOUT_CELL_MAJOR) {
+	outer = vdip->vdi_m_allocation;
+	inner = vdip->vdi_f_allocation;
+    } else {
+	outer = vdip->vdi_f_allocation;
+	inner = vdip->vdi_m_allocation;
+    }
+
+    /*
+     * Allocate the new vectors and transpose the data into them.
+     * As in _vnadata_extend_f, leave the sub-vectors NULL if the
+     * inner dimension is zero.
+     */
+    if (outer != 0) {
+	if ((new_data = _vnadata_calloc(vdip, outer,
+			sizeof(double complex *))) == NULL) {
+	    _vnadata_error(vdip, VNAERR_SYSTEM,
+		    "calloc: %s", strerror(errno));
+	    return -1;
+	}
+	if (inner != 0) {
+	    for (int i = 0; i < outer; ++i) {
+		if ((new_data[i] = _vnadata_calloc(vdip, inner,
+				sizeof(double complex))) == NULL) {
+		    _vnadata_error(vdip, VNAERR_SYSTEM,
+			    "calloc: %s", strerror(errno));
+		    free_vectors(vdip, new_data, outer);
+		    return -1;
+		}
+		for (int j = 0; j < inner; ++j) {
+		    new_data[i][j] = vdp->vd_data[j][i];
+		}
+	    }
+	}
+    }
+
+    /*
+     * Replace the old data.
+     */
+    free_vectors(vdip, vdp->vd_data, inner);
+    vdp->vd_data = new_data;
+    vdp->vd_layout = layout;
+    return 0;
+}
@@ -41,7 +41,8 @@ int _vnadata_set_simple_format(vnadata_internal_t *vdip,
     /*
      * Allocate the new format vector, length 1.
      */
-    if ((vfdp_new = malloc(sizeof(vnadata_format_descriptor_t))) == NULL) {
+    if ((vfdp_new = _vnadata_malloc(vdip,
+		    sizeof(vnadata_format_descriptor_t))) == NULL) {
 	_vnadata_error(vdip, VNAERR_SYSTEM,
 		"malloc: %s", strerror(errno));
 	goto out;
@@ -53,7 +54,7 @@ int _vnadata_set_simple_format(vnadata_internal_t *vdip,
     /*
      * Install the new vector.
      */
-    free((void *)vdip->vdi_format_vector);
+    _vnadata_free(vdip, (void *)vdip->vdi_format_vector);
     vdip->vdi_format_vector = vfdp_new;
     vdip->vdi_format_count = 1;
 
@@ -0,0 +1,129 @@
+/*
+ * Vector Network Analyzer Library
+ * Copyright © 2020-2024 D Scott Guthridge <scott_guthridge@rompromity.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "archdep.h"
+
+#include <stdbool.h>
+#include <string.h>
+#include "vnastats_internal.h"
+
+
+/*
+ * Shared counters, the list of per-thread blocks, the calling thread's
+ * block, and the mode
+ */
+vnadata_stats_t _vnadata_stats_global;
+vnastats_block_t *_vnadata_stats_list = NULL;
+_VNASTATS_THREAD_LOCAL vnadata_stats_t *_vnadata_stats_local = NULL;
+bool _vnadata_stats_per_thread = false;
+
+/*
+ * discard: counters for threads that couldn't get a block
+ */
+static vnadata_stats_t discard;
+
+/*
+ * _vnadata_stats_register: return a new block for the calling thread
+ */
+vnadata_stats_t *_vnadata_stats_register(void)
+{
+    vnadata_stats_t *sp;
+
+    if ((sp = _vnastats_register(&_vnadata_stats_list,
+		    sizeof(vnadata_stats_t))) == NULL) {
+	return &discard;
+    }
+    _vnadata_stats_local = sp;
+    return sp;
+}
+
+/*
+ * add_stats: add the counters of one block into a sum
+ *   @sum: accumulated result
+ *   @sp: block to add
+ */
+static void add_stats(vnadata_stats_t *sum, const vnadata_stats_t *sp)
+{
+    sum->vds_load_calls += _VNASTATS_LOAD(sp->vds_load_calls);
+    sum->vds_load_bytes += _VNASTATS_LOAD(sp->vds_load_bytes);
+    sum->vds_load_ns += _VNASTATS_LOAD(sp->vds_load_ns);
+    sum->vds_save_calls += _VNASTATS_LOAD(sp->vds_save_calls);
+    sum->vds_save_ns += _VNASTATS_LOAD(sp->vds_save_ns);
+    sum->vds_convert_calls += _VNASTATS_LOAD(sp->vds_convert_calls);
+    sum->vds_convert_ns += _VNASTATS_LOAD(sp->vds_convert_ns);
+}
+
+/*
+ * clear_stats: clear the counters of one block
+ *   @sp: block to clear
+ */
+static void clear_stats(vnadata_stats_t *sp)
+{
+    _VNASTATS_STORE(sp->vds_load_calls, 0);
+    _VNASTATS_STORE(sp->vds_load_bytes, 0);
+    _VNASTATS_STORE(sp->vds_load_ns, 0);
+    _VNASTATS_STORE(sp->vds_save_calls, 0);
+    _VNASTATS_STORE(sp->vds_save_ns, 0);
+    _VNASTATS_STORE(sp->vds_convert_calls, 0);
+    _VNASTATS_STORE(sp->vds_convert_ns, 0);
+}
+
+/*
+ * vnadata_get_stats: return hot-path counters and times
+ *   @stats: caller-allocated structure to receive the result
+ *
+ *   In per-thread mode, return the sum of all threads' counters.
+ */
+void vnadata_get_stats(vnadata_stats_t *stats)
+{
+    (void)memset((void *)stats, 0, sizeof(*stats));
+    if (_VNASTATS_LOAD(_vnadata_stats_per_thread)) {
+	for (vnastats_block_t *bp = _vnastats_first(&_vnadata_stats_list);
+		bp != NULL; bp = bp->vsb_next) {
+	    add_stats(stats, (const vnadata_stats_t *)bp->vsb_data);
+	}
+    } else {
+	add_stats(stats, &_vnadata_stats_global);
+    }
+}
+
+/*
+ * vnadata_reset_stats: clear hot-path counters and times
+ *
+ *   In per-thread mode, clear all threads' counters.
+ */
+void vnadata_reset_stats(void)
+{
+    if (_VNASTATS_LOAD(_vnadata_stats_per_thread)) {
+	for (vnastats_block_t *bp = _vnastats_first(&_vnadata_stats_list);
+		bp != NULL; bp = bp->vsb_next) {
+	    clear_stats((vnadata_stats_t *)bp->vsb_data);
+	}
+    } else {
+	clear_stats(&_vnadata_stats_global);
+    }
+}
+
+/*
+ * vnadata_set_stats_per_thread: count separately in each thread
+ *   @per_thread: true for per-thread counters; false for shared
+ */
+void vnadata_set_stats_per_thread(bool per_thread)
+{
+    _VNASTATS_STORE(_vnadata_stats_per_thread, per_thread);
+}
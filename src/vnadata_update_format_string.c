@@ -40,10 +40,10 @@ int _vnadata_update_format_string(vnadata_internal_t *vdip)
     char *new_string = NULL;
     char *cur;
 
-    free((void *)vdip->vdi_format_string);
+    _vnadata_free(vdip, (void *)vdip->vdi_format_string);
     vdip->vdi_format_string = NULL;
     if (vdip->vdi_format_count != 0) {
-	if ((new_string = malloc(vdip->vdi_format_count *
+	if ((new_string = _vnadata_malloc(vdip, vdip->vdi_format_count *
 			(MAX_FORMAT + 1))) == NULL) {
 	    _vnadata_error(vdip, VNAERR_SYSTEM,
 		    "malloc: %s", strerror(errno));
@@ -0,0 +1,443 @@
+/*
+ * Vector Network Analyzer Library
+ * Copyright © 2020-2023 D Scott Guthridge <scott_guthridge@rompromity.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "archdep.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include "vnadata_internal.h"
+
+
+/*
+ * free_vectors: free a vector of vectors
+ *   @vdip: pointer to vnadata_internal_t structure owning the vectors
+ *   @vector_vector: vector to free
+ *   @length: number of sub-vectors
+ */
+static void free_vectors(vnadata_internal_t *vdip,
+	double complex **vector_vector, int length)
+{
+    if (vector_vector != NULL) {
+	for (int i = 0; i < length; ++i) {
+	    _vnadata_free(vdip, (void *)vector_vector[i]);
+	}
+	_vnadata_free(vdip, (void *)vector_vector);
+    }
+}
+
+/*
+ * _vnadata_materialize_view: give a view its own copy of the data
+ *   @vdp: pointer to vnacal_data_t structure
+ *
+ *   Copy the frequencies and data referenced by the view into newly
+ *   allocated storage in the same layout, and detach from the parent
+ *   or file mapping.
+ *   The view already owns its z0 values.
+ */
+int _vnadata_materialize_view(vnadata_t *vdp)
+{
+    vnadata_internal_t *vdip;
+    int frequencies, cells;
+    int outer, inner;
+    double *new_frequency_vector = NULL;
+    double complex **new_data = NULL;
+
+    if (vdp == NULL) {
+	errno = EINVAL;
+	return -1;
+    }
+    vdip = VDP_TO_VDIP(vdp);
+    if (vdip->vdi_magic != VDI_MAGIC) {
+	errno = EINVAL;
+	return -1;
+    }
+    if (!vdp->vd_view) {
+	return 0;
+    }
+    frequencies = vdp->vd_frequencies;
+    cells = vdp->vd_rows * vdp->vd_columns;
+    assert(vdip->vdi_f_allocation == frequencies);
+    assert(vdip->vdi_m_allocation == cells);
+
+    /*
+     * Copy the frequency vector.
+     */
+    if (frequencies != 0) {
+	if ((new_frequency_vector = _vnadata_malloc(vdip, frequencies *
+			sizeof(double))) == NULL) {
+	    _vnadata_error(vdip, VNAERR_SYSTEM, "malloc: %s",
+		    strerror(errno));
+	    return -1;
+	}
+	(void)memcpy((void *)new_frequency_vector,
+		(void *)vdp->vd_frequency_vector,
+		frequencies * sizeof(double));
+    }
+
+    /*
+     * Copy the data.  As in _vnadata_extend_f and _vnadata_extend_m,
+     * leave the sub-vectors NULL if the inner dimension is zero.
+     */
+    if (vdp->vd_layout == VNADATA_LAYOUT_CELL_MAJOR) {
+	outer = cells;
+	inner = frequencies;
+    } else {
+	outer = frequencies;
+	inner = cells;
+    }
+    if (outer != 0) {
+	if ((new_data = _vnadata_calloc(vdip, outer,
+			sizeof(double complex *))) == NULL) {
+	    _vnadata_error(vdip, VNAERR_SYSTEM, "calloc: %s",
+		    strerror(errno));
+	    _vnadata_free(vdip, (void *)new_frequency_vector);
+	    return -1;
+	}
+	if (inner != 0) {
+	    for (int i = 0; i < outer; ++i) {
+		if ((new_data[i] = _vnadata_malloc(vdip, inner *
+				sizeof(double complex))) == NULL) {
+		    _vnadata_error(vdip, VNAERR_SYSTEM, "malloc: %s",
+			    strerror(errno));
+		    free_vectors(vdip, new_data, outer);
+		    _vnadata_free(vdip, (void *)new_frequency_vector);
+		    return -1;
+		}
+		(void)memcpy((void *)new_data[i], (void *)vdp->vd_data[i],
+			inner * sizeof(double complex));
+	    }
+	}
+    }
+
+    /*
+     * Replace the references to the parent.
+     */
+    _vnadata_free(vdip, (void *)vdp->vd_data);
+    vdp->vd_frequency_vector = new_frequency_vector;
+    vdp->vd_data = new_data;
+    vdp->vd_view = false;
+    _vnadata_unmap(vdip);
+    return 0;
+}
+
+/*
+ * vnadata_view: make vdp a view of a frequency range and ports of parent
+ *   @vdp:         a pointer to the vnadata_t structure to become the view
+ *   @parent:      vnadata_t structure to view
+ *   @findex:      first frequency index of the range
+ *   @frequencies: number of frequencies in the range
+ *   @port_vector: ports of parent to include (NULL for all)
+ *   @ports:       length of port_vector
+ *
+ *   A frequency range of a parent in either layout, or a port subset
+ *   of a parent in cell-major layout, is represented without copying
+ *   the data.  A port subset of a parent in frequency-major layout
+ *   can't be, so its frequencies and data are copied, and vdp is not
+ *   a view.  Reference impedances are always copied.
+ */
+int vnadata_view(vnadata_t *vdp, const vnadata_t *parent,
+	int findex, int frequencies, const int *port_vector, int ports)
+{
+    vnadata_internal_t *vdip, *vdip_parent;
+    const vnadata_parameter_type_t type = parent != NULL ?
+	parent->vd_type : VPT_UNDEF;
+    int parent_ports;
+    int rows, columns, cells;
+    bool identity = true;
+    bool per_f_z0;
+    bool copy;
+    double *new_frequency_vector = NULL;
+    double complex **new_data = NULL;
+    double complex *z0_vector = NULL;
+    double complex **z0_vector_vector = NULL;
+
+    /*
+     * Validate parameters.
+     */
+    if (vdp == NULL || parent == NULL) {
+	errno = EINVAL;
+	return -1;
+    }
+    vdip = VDP_TO_VDIP(vdp);
+    vdip_parent = VDP_TO_VDIP(parent);
+    if (vdip->vdi_magic != VDI_MAGIC ||
+	    vdip_parent->vdi_magic != VDI_MAGIC) {
+	errno = EINVAL;
+	return -1;
+    }
+    if (vdp == parent) {
+	_vnadata_error(vdip, VNAERR_USAGE,
+		"vnadata_view: vdp and parent must be different");
+	return -1;
+    }
+    if (findex < 0 || frequencies < 0 ||
+	    findex + frequencies > parent->vd_frequencies) {
+	_vnadata_error(vdip, VNAERR_USAGE,
+		"vnadata_view: invalid frequency range: %d, %d",
+		findex, frequencies);
+	return -1;
+    }
+    parent_ports = MAX(parent->vd_rows, parent->vd_columns);
+    if (port_vector == NULL) {
+	ports = parent_ports;
+    } else {
+	if (ports < 0 || ports > parent_ports) {
+	    _vnadata_error(vdip, VNAERR_USAGE,
+		    "vnadata_view: invalid port count: %d", ports);
+	    return -1;
+	}
+	for (int i = 0; i < ports; ++i) {
+	    if (port_vector[i] < 0 || port_vector[i] >= parent_ports) {
+		_vnadata_error(vdip, VNAERR_USAGE,
+			"vnadata_view: invalid port: %d", port_vector[i]);
+		return -1;
+	    }
+	    for (int j = 0; j < i; ++j) {
+		if (port_vector[j] == port_vector[i]) {
+		    _vnadata_error(vdip, VNAERR_USAGE,
+			    "vnadata_view: duplicate port: %d",
+			    port_vector[i]);
+		    return -1;
+		}
+	    }
+	    if (port_vector[i] != i) {
+		identity = false;
+	    }
+	}
+	if (ports != parent_ports) {
+	    identity = false;
+	}
+    }
+
+    /*
+     * Find the dimensions.  A port subset makes sense only for square
+     * matrices of types that can be defined for any number of ports,
+     * and for input impedances.
+     */
+    if (identity) {
+	rows    = parent->vd_rows;
+	columns = parent->vd_columns;
+    } else if (type == VPT_ZIN) {
+	rows    = 1;
+	columns = ports;
+    } else if (parent->vd_rows == parent->vd_columns && (type == VPT_UNDEF ||
+		type == VPT_S || type == VPT_Z || type == VPT_Y)) {
+	rows    = ports;
+	columns = ports;
+    } else {
+	_vnadata_error(vdip, VNAERR_USAGE,
+		"vnadata_view: cannot select ports from %d x %d %s matrix",
+		parent->vd_rows, parent->vd_columns,
+		vnadata_get_type_name(type));
+	return -1;
+    }
+
+    /*
+     * In frequency-major layout, the cells of each frequency are
+     * contiguous, so the data can be referenced only if we take all
+     * ports.  Otherwise, copy them.
+     */
+    copy = parent->vd_layout == VNADATA_LAYOUT_FREQUENCY_MAJOR && !identity;
+    cells = rows * columns;
+    per_f_z0 = (vdip_parent->vdi_flags & VF_PER_F_Z0) != 0;
+
+    {
+	int row_map[MAX(rows, 1)];
+	int column_map[MAX(columns, 1)];
+
+	/*
+	 * Map the rows and columns of the view to those of the parent.
+	 */
+	for (int row = 0; row < rows; ++row) {
+	    row_map[row] = identity || type == VPT_ZIN ? row : port_vector[row];
+	}
+	for (int column = 0; column < columns; ++column) {
+	    column_map[column] = identity ? column : port_vector[column];
+	}
+
+	/*
+	 * Discard the current contents of vdp and give it the
+	 * parent's layout.
+	 */
+	_vnadata_release_storage(vdip);
+	vdp->vd_layout = parent->vd_layout;
+
+	/*
+	 * Build the vector of references into the parent.
+	 */
+	if (parent->vd_layout == VNADATA_LAYOUT_CELL_MAJOR) {
+	    if (cells != 0) {
+		if ((new_data = _vnadata_calloc(vdip, cells,
+				sizeof(double complex *))) == NULL) {
+		    _vnadata_error(vdip, VNAERR_SYSTEM, "calloc: %s",
+			    strerror(errno));
+		    goto error;
+		}
+		for (int row = 0; row < rows; ++row) {
+		    for (int column = 0; column < columns; ++column) {
+			const int cell = row_map[row] * parent->vd_columns +
+			    column_map[column];
+
+			new_data[row * columns + column] =
+			    frequencies != 0 ?
+			    &parent->vd_data[cell][findex] : NULL;
+		    }
+		}
+	    }
+	} else if (!copy) {
+	    if (frequencies != 0) {
+		if ((new_data = _vnadata_calloc(vdip, frequencies,
+				sizeof(double complex *))) == NULL) {
+		    _vnadata_error(vdip, VNAERR_SYSTEM, "calloc: %s",
+			    strerror(errno));
+		    goto error;
+		}
+		for (int i = 0; i < frequencies; ++i) {
+		    new_data[i] = parent->vd_data[findex + i];
+		}
+	    }
+
+	/*
+	 * Copy the frequencies and the selected cells.  As in
+	 * _vnadata_materialize_view, leave the matrices NULL if there
+	 * are no cells.
+	 */
+	} else if (frequencies != 0) {
+	    if ((new_frequency_vector = _vnadata_malloc(vdip, frequencies *
+			    sizeof(double))) == NULL) {
+		_vnadata_error(vdip, VNAERR_SYSTEM, "malloc: %s",
+			strerror(errno));
+		goto error;
+	    }
+	    (void)memcpy((void *)new_frequency_vector,
+		    (void *)&parent->vd_frequency_vector[findex],
+		    frequencies * sizeof(double));
+	    if ((new_data = _vnadata_calloc(vdip, frequencies,
+			    sizeof(double complex *))) == NULL) {
+		_vnadata_error(vdip, VNAERR_SYSTEM, "calloc: %s",
+			strerror(errno));
+		goto error;
+	    }
+	    for (int i = 0; i < frequencies && cells != 0; ++i) {
+		const double complex *parent_matrix =
+		    parent->vd_data[findex + i];
+
+		if ((new_data[i] = _vnadata_malloc(vdip, cells *
+				sizeof(double complex))) == NULL) {
+		    _vnadata_error(vdip, VNAERR_SYSTEM, "malloc: %s",
+			    strerror(errno));
+		    goto error;
+		}
+		for (int row = 0; row < rows; ++row) {
+		    for (int column = 0; column < columns; ++column) {
+			new_data[i][row * columns + column] =
+			    parent_matrix[row_map[row] * parent->vd_columns +
+			    column_map[column]];
+		    }
+		}
+	    }
+	}
+
+	/*
+	 * Copy the reference impedances of the selected ports.
+	 */
+	if (per_f_z0) {
+	    if (frequencies != 0) {
+		if ((z0_vector_vector = _vnadata_calloc(vdip, frequencies,
+				sizeof(double complex *))) == NULL) {
+		    _vnadata_error(vdip, VNAERR_SYSTEM, "calloc: %s",
+			    strerror(errno));
+		    goto error;
+		}
+	    }
+	    for (int i = 0; i < frequencies && ports != 0; ++i) {
+		const double complex *parent_z0_vector =
+		    vdip_parent->vdi_z0_vector_vector[findex + i];
+
+		if ((z0_vector_vector[i] = _vnadata_calloc(vdip, ports,
+				sizeof(double complex))) == NULL) {
+		    _vnadata_error(vdip, VNAERR_SYSTEM, "calloc: %s",
+			    strerror(errno));
+		    goto error;
+		}
+		for (int port = 0; port < ports; ++port) {
+		    z0_vector_vector[i][port] = parent_z0_vector[identity ?
+			port : port_vector[port]];
+		}
+	    }
+	} else if (ports != 0) {
+	    if ((z0_vector = _vnadata_calloc(vdip, ports,
+			    sizeof(double complex))) == NULL) {
+		_vnadata_error(vdip, VNAERR_SYSTEM, "calloc: %s",
+			strerror(errno));
+		goto error;
+	    }
+	    for (int port = 0; port < ports; ++port) {
+		z0_vector[port] = vdip_parent->vdi_z0_vector[identity ?
+		    port : port_vector[port]];
+	    }
+	}
+    }
+
+    /*
+     * Make vdp the view.
+     */
+    vdp->vd_type	     = type;
+    vdp->vd_rows	     = rows;
+    vdp->vd_columns	     = columns;
+    vdp->vd_frequencies	     = frequencies;
+    vdp->vd_view	     = !copy;
+    if (copy) {
+	vdp->vd_frequency_vector = new_frequency_vector;
+    } else {
+	vdp->vd_frequency_vector = frequencies != 0 ?
+	    &parent->vd_frequency_vector[findex] : NULL;
+    }
+    vdp->vd_data	     = new_data;
+    if (per_f_z0) {
+	vdip->vdi_z0_vector_vector = z0_vector_vector;
+	vdip->vdi_flags |= VF_PER_F_Z0;
+    } else {
+	vdip->vdi_z0_vector = z0_vector;
+    }
+    vdip->vdi_p_allocation = ports;
+    vdip->vdi_f_allocation = frequencies;
+    vdip->vdi_m_allocation = cells;
+    _vnadata_set_name_from_dimensions(vdip);
+
+    if (vnadata_set_filetype(vdp, vdip_parent->vdi_filetype) == -1 ||
+	    vnadata_set_format(vdp, vdip_parent->vdi_format_string) == -1 ||
+	    vnadata_set_fprecision(vdp, vdip_parent->vdi_fprecision) == -1 ||
+	    vnadata_set_dprecision(vdp, vdip_parent->vdi_dprecision) == -1) {
+	return -1;
+    }
+    return 0;
+
+error:
+    if (copy) {
+	free_vectors(vdip, new_data, frequencies);
+    } else {
+	_vnadata_free(vdip, (void *)new_data);
+    }
+    _vnadata_free(vdip, (void *)new_frequency_vector);
+    _vnadata_free(vdip, (void *)z0_vector);
+    free_vectors(vdip, z0_vector_vector, frequencies);
+    return -1;
+}
@@ -24,6 +24,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include "vnaerr_internal.h"
+#include "vnamem_internal.h"
 
 
 /*
@@ -80,7 +81,7 @@ void _vnaerr_verror(vnaerr_error_fn_t *error_fn, void *error_arg,
      * vasprintf fails, still try to report the original error.
      */
     if (error_fn != NULL) {
-	if (vasprintf(&message, format, ap) == -1) {
+	if (_vnamem_vasprintf(&message, format, ap) == -1) {
 	    errno = new_errno;
 	    (*error_fn)(strerror(new_errno), error_arg, category);
 	    goto out;
@@ -90,6 +91,6 @@ void _vnaerr_verror(vnaerr_error_fn_t *error_fn, void *error_arg,
     }
 
 out:
-    free((void *)message);
+    _vnamem_free((void *)message);
     errno = new_errno;
 }
@@ -0,0 +1,359 @@
+/*
+ * Vector Network Analyzer Library
+ * Copyright © 2020-2023 D Scott Guthridge <scott_guthridge@rompromity.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "archdep.h"
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "vnamem_internal.h"
+
+/*
+ * STATS_ADD: add to a statistics counter
+ *   Use relaxed atomics where available so that counting from several
+ *   threads doesn't lose updates.
+ */
+#ifdef __GNUC__
+#define STATS_ADD(field, n) \
+	((void)__atomic_fetch_add(&stats.field, (n), __ATOMIC_RELAXED))
+#else
+#define STATS_ADD(field, n) \
+	((void)(stats.field += (n)))
+#endif
+
+/*
+ * default_alloc: allocate memory using malloc
+ *   @context: unused
+ *   @size: number of bytes to allocate
+ */
+static void *default_alloc(void *context, size_t size)
+{
+    return malloc(size);
+}
+
+/*
+ * default_realloc: resize memory using realloc
+ *   @context: unused
+ *   @ptr: memory to resize (can be NULL)
+ *   @size: new size in bytes
+ */
+static void *default_realloc(void *context, void *ptr, size_t size)
+{
+    return realloc(ptr, size);
+}
+
+/*
+ * default_free: free memory using free
+ *   @context: unused
+ *   @ptr: memory to free (can be NULL)
+ */
+static void default_free(void *context, void *ptr)
+{
+    free(ptr);
+}
+
+/*
+ * default_allocator: malloc, realloc and free
+ */
+static const vnamem_allocator_t default_allocator = {
+    .vma_alloc   = default_alloc,
+    .vma_realloc = default_realloc,
+    .vma_free    = default_free,
+    .vma_context = NULL
+};
+
+/*
+ * allocator_record_t: copy of an allocator passed to vnamem_set_allocator
+ *
+ *   Records are never freed, so that objects created under an earlier
+ *   global allocator can point to it rather than carry their own copy.
+ *   There's one record for each distinct allocator ever installed.
+ */
+typedef struct allocator_record {
+    vnamem_allocator_t ar_allocator;
+    struct allocator_record *ar_next;
+} allocator_record_t;
+
+/*
+ * allocator_records: list of allocators installed
+ */
+static allocator_record_t *allocator_records = NULL;
+
+/*
+ * allocator: the global allocator
+ */
+static const vnamem_allocator_t *allocator = &default_allocator;
+
+/*
+ * stats: allocation statistics
+ */
+static vnamem_stats_t stats;
+
+/*
+ * vnamem_set_allocator: install the global allocator
+ *   @new_allocator: allocator to install, or NULL for malloc/realloc/free
+ *
+ *   Memory must be freed using the allocator that allocated it.  Library
+ *   objects remember the allocator in effect when they were created and
+ *   free through it, so the global allocator may change while they exist;
+ *   scratch memory within a call comes from the current global allocator.
+ */
+int vnamem_set_allocator(const vnamem_allocator_t *new_allocator)
+{
+    allocator_record_t *arp;
+
+    if (new_allocator == NULL) {
+	allocator = &default_allocator;
+	return 0;
+    }
+    if (new_allocator->vma_alloc == NULL ||
+	    new_allocator->vma_realloc == NULL ||
+	    new_allocator->vma_free == NULL) {
+	errno = EINVAL;
+	return -1;
+    }
+    if (memcmp((const void *)new_allocator, (const void *)&default_allocator,
+		sizeof(vnamem_allocator_t)) == 0) {
+	allocator = &default_allocator;
+	return 0;
+    }
+    for (arp = allocator_records; arp != NULL; arp = arp->ar_next) {
+	if (memcmp((const void *)new_allocator,
+		    (const void *)&arp->ar_allocator,
+		    sizeof(vnamem_allocator_t)) == 0) {
+	    allocator = &arp->ar_allocator;
+	    return 0;
+	}
+    }
+
+    /*
+     * The record comes from malloc rather than the new allocator,
+     * which could be an arena that's later reset.
+     */
+    if ((arp = malloc(sizeof(allocator_record_t))) == NULL) {
+	errno = ENOMEM;
+	return -1;
+    }
+    (void)memset((void *)arp, 0, sizeof(*arp));
+    arp->ar_allocator = *new_allocator;
+    arp->ar_next = allocator_records;
+    allocator_records = arp;
+    allocator = &arp->ar_allocator;
+    return 0;
+}
+
+/*
+ * vnamem_get_allocator: return the current global allocator
+ *   @result: address of structure to receive the allocator
+ */
+void vnamem_get_allocator(vnamem_allocator_t *result)
+{
+    *result = *allocator;
+}
+
+/*
+ * _vnamem_get_global_allocator: return the current global allocator
+ *
+ *   The result remains valid after the global allocator changes.
+ */
+const vnamem_allocator_t *_vnamem_get_global_allocator(void)
+{
+    return allocator;
+}
+
+/*
+ * vnamem_get_stats: return allocation statistics
+ *   @result: address of structure to receive the statistics
+ */
+void vnamem_get_stats(vnamem_stats_t *result)
+{
+    *result = stats;
+}
+
+/*
+ * vnamem_reset_stats: clear allocation statistics
+ */
+void vnamem_reset_stats(void)
+{
+    (void)memset((void *)&stats, 0, sizeof(stats));
+}
+
+/*
+ * _vnamem_amalloc: allocate memory from the given allocator
+ *   @vmap: allocator
+ *   @size: number of bytes to allocate
+ */
+void *_vnamem_amalloc(const vnamem_allocator_t *vmap, size_t size)
+{
+    void *ptr;
+
+    STATS_ADD(vms_allocs, 1);
+    STATS_ADD(vms_bytes, size);
+    if ((ptr = (*vmap->vma_alloc)(vmap->vma_context, size)) == NULL) {
+	STATS_ADD(vms_failures, 1);
+	errno = ENOMEM;
+    }
+    return ptr;
+}
+
+/*
+ * _vnamem_acalloc: allocate zeroed memory from the given allocator
+ *   @vmap: allocator
+ *   @count: number of elements
+ *   @size: size of each element
+ */
+void *_vnamem_acalloc(const vnamem_allocator_t *vmap, size_t count,
+	size_t size)
+{
+    void *ptr;
+
+    if (size != 0 && count > SIZE_MAX / size) {
+	errno = ENOMEM;
+	return NULL;
+    }
+    if ((ptr = _vnamem_amalloc(vmap, count * size)) != NULL) {
+	(void)memset(ptr, 0, count * size);
+    }
+    return ptr;
+}
+
+/*
+ * _vnamem_arealloc: resize memory from the given allocator
+ *   @vmap: allocator
+ *   @ptr: memory to resize (can be NULL)
+ *   @size: new size in bytes
+ */
+void *_vnamem_arealloc(const vnamem_allocator_t *vmap, void *ptr,
+	size_t size)
+{
+    void *new_ptr;
+
+    STATS_ADD(vms_reallocs, 1);
+    STATS_ADD(vms_bytes, size);
+    if ((new_ptr = (*vmap->vma_realloc)(vmap->vma_context,
+		    ptr, size)) == NULL) {
+	STATS_ADD(vms_failures, 1);
+	errno = ENOMEM;
+    }
+    return new_ptr;
+}
+
+/*
+ * _vnamem_afree: return memory to the given allocator
+ *   @vmap: allocator
+ *   @ptr: memory to free (can be NULL)
+ */
+void _vnamem_afree(const vnamem_allocator_t *vmap, void *ptr)
+{
+    if (ptr != NULL) {
+	STATS_ADD(vms_frees, 1);
+	(*vmap->vma_free)(vmap->vma_context, ptr);
+    }
+}
+
+/*
+ * _vnamem_astrdup: duplicate a string using the given allocator
+ *   @vmap: allocator
+ *   @s: string to copy
+ */
+char *_vnamem_astrdup(const vnamem_allocator_t *vmap, const char *s)
+{
+    size_t size = strlen(s) + 1;
+    char *copy;
+
+    if ((copy = _vnamem_amalloc(vmap, size)) != NULL) {
+	(void)memcpy((void *)copy, (void *)s, size);
+    }
+    return copy;
+}
+
+/*
+ * _vnamem_malloc: allocate memory from the global allocator
+ *   @size: number of bytes to allocate
+ */
+void *_vnamem_malloc(size_t size)
+{
+    return _vnamem_amalloc(allocator, size);
+}
+
+/*
+ * _vnamem_calloc: allocate zeroed memory from the global allocator
+ *   @count: number of elements
+ *   @size: size of each element
+ */
+void *_vnamem_calloc(size_t count, size_t size)
+{
+    return _vnamem_acalloc(allocator, count, size);
+}
+
+/*
+ * _vnamem_realloc: resize memory from the global allocator
+ *   @ptr: memory to resize (can be NULL)
+ *   @size: new size in bytes
+ */
+void *_vnamem_realloc(void *ptr, size_t size)
+{
+    return _vnamem_arealloc(allocator, ptr, size);
+}
+
+/*
+ * _vnamem_free: return memory to the global allocator
+ *   @ptr: memory to free (can be NULL)
+ */
+void _vnamem_free(void *ptr)
+{
+    _vnamem_afree(allocator, ptr);
+}
+
+/*
+ * _vnamem_strdup: duplicate a string using the global allocator
+ *   @s: string to copy
+ */
+char *_vnamem_strdup(const char *s)
+{
+    return _vnamem_astrdup(allocator, s);
+}
+
+/*
+ * _vnamem_vasprintf: print to a string allocated from the global allocator
+ *   @strp: address of pointer to receive the string
+ *   @format: printf format string
+ *   @ap: argument list
+ */
+int _vnamem_vasprintf(char **strp, const char *format, va_list ap)
+{
+    va_list ap_copy;
+    char *buf;
+    int length;
+
+    va_copy(ap_copy, ap);
+    length = vsnprintf(NULL, 0, format, ap_copy);
+    va_end(ap_copy);
+    if (length < 0) {
+	return -1;
+    }
+    if ((buf = _vnamem_malloc((size_t)length + 1)) == NULL) {
+	return -1;
+    }
+    (void)vsnprintf(buf, (size_t)length + 1, format, ap);
+    *strp = buf;
+    return length;
+}
@@ -0,0 +1,91 @@
+/*
+ * Vector Network Analyzer Library
+ * Copyright © 2020-2023 D Scott Guthridge <scott_guthridge@rompromity.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _VNAMEM_H
+#define _VNAMEM_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * vnamem_allocator_t: memory allocator used by the library
+ *   @vma_alloc:   allocate size bytes; return NULL on failure
+ *   @vma_realloc: resize ptr (possibly NULL) to size bytes, preserving
+ *                 contents; return NULL on failure
+ *   @vma_free:    release ptr (possibly NULL)
+ *   @vma_context: user-supplied argument passed to the above functions
+ */
+typedef struct vnamem_allocator {
+    void *(*vma_alloc)(void *context, size_t size);
+    void *(*vma_realloc)(void *context, void *ptr, size_t size);
+    void  (*vma_free)(void *context, void *ptr);
+    void   *vma_context;
+} vnamem_allocator_t;
+
+/*
+ * vnamem_stats_t: allocation statistics
+ */
+typedef struct vnamem_stats {
+    unsigned long vms_allocs;	/* number of allocations */
+    unsigned long vms_reallocs;	/* number of reallocations */
+    unsigned long vms_frees;	/* number of non-NULL frees */
+    unsigned long vms_failures;	/* number of failed (re)allocations */
+    size_t vms_bytes;		/* total bytes requested */
+} vnamem_stats_t;
+
+/*
+ * vnamem_arena_t: opaque arena allocator
+ */
+typedef struct vnamem_arena vnamem_arena_t;
+
+/* vnamem_set_allocator: install the global allocator (NULL for default) */
+extern int vnamem_set_allocator(const vnamem_allocator_t *allocator);
+
+/* vnamem_get_allocator: return the current global allocator */
+extern void vnamem_get_allocator(vnamem_allocator_t *allocator);
+
+/* vnamem_get_stats: return allocation statistics */
+extern void vnamem_get_stats(vnamem_stats_t *stats);
+
+/* vnamem_reset_stats: clear allocation statistics */
+extern void vnamem_reset_stats(void);
+
+/* vnamem_arena_alloc: create an arena allocator */
+extern vnamem_arena_t *vnamem_arena_alloc(size_t block_size);
+
+/* vnamem_arena_get_allocator: return an allocator that uses the arena */
+extern void vnamem_arena_get_allocator(vnamem_arena_t *arena,
+	vnamem_allocator_t *allocator);
+
+/* vnamem_arena_get_used: return the number of bytes in use in the arena */
+extern size_t vnamem_arena_get_used(const vnamem_arena_t *arena);
+
+/* vnamem_arena_reset: release all memory allocated from the arena */
+extern void vnamem_arena_reset(vnamem_arena_t *arena);
+
+/* vnamem_arena_free: free the arena */
+extern void vnamem_arena_free(vnamem_arena_t *arena);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* _VNAMEM_H */
@@ -0,0 +1,279 @@
+/*
+ * Vector Network Analyzer Library
+ * Copyright © 2020-2023 D Scott Guthridge <scott_guthridge@rompromity.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "archdep.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "vnamem_internal.h"
+
+/*
+ * ARENA_ALIGN: alignment of each allocation (power of two)
+ */
+#define ARENA_ALIGN		16
+
+/*
+ * ARENA_ROUND: round n up to a multiple of ARENA_ALIGN
+ */
+#define ARENA_ROUND(n)	(((n) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+/*
+ * ARENA_DEFAULT_BLOCK_SIZE: block size if zero is given
+ */
+#define ARENA_DEFAULT_BLOCK_SIZE	65536
+
+/*
+ * arena_block_t: block of memory from which allocations are carved
+ *
+ *   The header is followed by ab_size bytes of data.  Each allocation
+ *   is preceded by an ARENA_ALIGN-sized header holding its size so that
+ *   realloc knows how much to copy.
+ */
+typedef struct arena_block {
+    struct arena_block *ab_next;	/* next block in the chain */
+    size_t ab_size;			/* bytes of data in the block */
+    size_t ab_used;			/* bytes of data in use */
+} arena_block_t;
+
+/*
+ * ARENA_BLOCK_HEADER: size of arena_block_t rounded to the alignment
+ */
+#define ARENA_BLOCK_HEADER	ARENA_ROUND(sizeof(arena_block_t))
+
+/*
+ * ARENA_BLOCK_DATA: return the address of the data in a block
+ */
+#define ARENA_BLOCK_DATA(abp)	((char *)(abp) + ARENA_BLOCK_HEADER)
+
+/*
+ * vnamem_arena_t: arena allocator
+ */
+struct vnamem_arena {
+    arena_block_t *a_first;	/* first block */
+    arena_block_t *a_current;	/* block currently allocated from */
+    size_t a_block_size;	/* default size of new blocks */
+    void *a_last;		/* most recent allocation or NULL */
+    size_t a_used;		/* bytes handed out since last reset */
+};
+
+/*
+ * new_block: allocate a new arena block
+ *   @size: bytes of data
+ *
+ *   Blocks come directly from malloc so that the arena can itself be
+ *   installed as the global allocator.
+ */
+static arena_block_t *new_block(size_t size)
+{
+    arena_block_t *abp;
+
+    if ((abp = malloc(ARENA_BLOCK_HEADER + size)) == NULL) {
+	return NULL;
+    }
+    abp->ab_next = NULL;
+    abp->ab_size = size;
+    abp->ab_used = 0;
+    return abp;
+}
+
+/*
+ * arena_alloc: allocate memory from the arena
+ *   @context: pointer to vnamem_arena_t
+ *   @size: number of bytes to allocate
+ */
+static void *arena_alloc(void *context, size_t size)
+{
+    vnamem_arena_t *arena = context;
+    arena_block_t *abp = arena->a_current;
+    size_t needed;
+    char *cp;
+
+    if (size > SIZE_MAX - 2 * ARENA_ALIGN) {
+	errno = ENOMEM;
+	return NULL;
+    }
+    needed = ARENA_ALIGN + ARENA_ROUND(size);
+
+    /*
+     * If the current block is full, move to the next block, reusing
+     * blocks left from before the last reset when they're big enough.
+     */
+    if (abp->ab_size - abp->ab_used < needed) {
+	arena_block_t *next = abp->ab_next;
+
+	if (next == NULL || next->ab_size < needed) {
+	    if ((next = new_block(MAX(arena->a_block_size, needed))) == NULL) {
+		return NULL;
+	    }
+	    next->ab_next = abp->ab_next;
+	    abp->ab_next = next;
+	}
+	next->ab_used = 0;
+	arena->a_current = abp = next;
+    }
+    cp = ARENA_BLOCK_DATA(abp) + abp->ab_used;
+    *(size_t *)cp = size;
+    abp->ab_used += needed;
+    arena->a_used += needed;
+    arena->a_last = cp + ARENA_ALIGN;
+    return arena->a_last;
+}
+
+/*
+ * arena_realloc: resize memory allocated from the arena
+ *   @context: pointer to vnamem_arena_t
+ *   @ptr: memory to resize (can be NULL)
+ *   @size: new size in bytes
+ *
+ *   The most recent allocation grows in place if there is room;
+ *   otherwise, the contents are copied to a new allocation.
+ */
+static void *arena_realloc(void *context, void *ptr, size_t size)
+{
+    vnamem_arena_t *arena = context;
+    size_t *old_sizep;
+    void *new_ptr;
+
+    if (ptr == NULL) {
+	return arena_alloc(context, size);
+    }
+    old_sizep = (size_t *)((char *)ptr - ARENA_ALIGN);
+    if (ptr == arena->a_last && size <= SIZE_MAX - 2 * ARENA_ALIGN) {
+	arena_block_t *abp = arena->a_current;
+	size_t old_rounded = ARENA_ROUND(*old_sizep);
+	size_t new_rounded = ARENA_ROUND(size);
+	size_t base = abp->ab_used - old_rounded;
+
+	if (new_rounded <= abp->ab_size - base) {
+	    abp->ab_used = base + new_rounded;
+	    arena->a_used = arena->a_used - old_rounded + new_rounded;
+	    *old_sizep = size;
+	    return ptr;
+	}
+    }
+    if ((new_ptr = arena_alloc(context, size)) == NULL) {
+	return NULL;
+    }
+    (void)memcpy(new_ptr, ptr, MIN(*old_sizep, size));
+    return new_ptr;
+}
+
+/*
+ * arena_free: free memory allocated from the arena
+ *   @context: pointer to vnamem_arena_t
+ *   @ptr: memory to free (can be NULL)
+ *
+ *   Only the most recent allocation is actually reclaimed; other memory
+ *   is reclaimed when the arena is reset.
+ */
+static void arena_free(void *context, void *ptr)
+{
+    vnamem_arena_t *arena = context;
+
+    if (ptr != NULL && ptr == arena->a_last) {
+	size_t rounded = ARENA_ALIGN + ARENA_ROUND(*(size_t *)((char *)ptr -
+		    ARENA_ALIGN));
+
+	arena->a_current->ab_used -= rounded;
+	arena->a_used -= rounded;
+	arena->a_last = NULL;
+    }
+}
+
+/*
+ * vnamem_arena_alloc: create an arena allocator
+ *   @block_size: size of each block of memory to reserve (0 for default)
+ */
+vnamem_arena_t *vnamem_arena_alloc(size_t block_size)
+{
+    vnamem_arena_t *arena;
+
+    if (block_size == 0) {
+	block_size = ARENA_DEFAULT_BLOCK_SIZE;
+    }
+    block_size = ARENA_ROUND(block_size);
+    if ((arena = malloc(sizeof(vnamem_arena_t))) == NULL) {
+	return NULL;
+    }
+    (void)memset((void *)arena, 0, sizeof(vnamem_arena_t));
+    if ((arena->a_first = new_block(block_size)) == NULL) {
+	free((void *)arena);
+	return NULL;
+    }
+    arena->a_current = arena->a_first;
+    arena->a_block_size = block_size;
+    return arena;
+}
+
+/*
+ * vnamem_arena_get_allocator: return an allocator that uses the arena
+ *   @arena: arena
+ *   @allocator: address of structure to receive the allocator
+ */
+void vnamem_arena_get_allocator(vnamem_arena_t *arena,
+	vnamem_allocator_t *allocator)
+{
+    allocator->vma_alloc   = arena_alloc;
+    allocator->vma_realloc = arena_realloc;
+    allocator->vma_free    = arena_free;
+    allocator->vma_context = arena;
+}
+
+/*
+ * vnamem_arena_get_used: return the number of bytes in use in the arena
+ *   @arena: arena
+ */
+size_t vnamem_arena_get_used(const vnamem_arena_t *arena)
+{
+    return arena->a_used;
+}
+
+/*
+ * vnamem_arena_reset: release all memory allocated from the arena
+ *   @arena: arena
+ *
+ *   Blocks are kept for reuse, so this takes constant time regardless
+ *   of the number of allocations.
+ */
+void vnamem_arena_reset(vnamem_arena_t *arena)
+{
+    arena->a_current = arena->a_first;
+    arena->a_first->ab_used = 0;
+    arena->a_last = NULL;
+    arena->a_used = 0;
+}
+
+/*
+ * vnamem_arena_free: free the arena
+ *   @arena: arena (can be NULL)
+ */
+void vnamem_arena_free(vnamem_arena_t *arena)
+{
+    arena_block_t *abp, *next;
+
+    if (arena == NULL) {
+	return;
+    }
+    for (abp = arena->a_first; abp != NULL; abp = next) {
+	next = abp->ab_next;
+	free((void *)abp);
+    }
+    free((void *)arena);
+}
@@ -0,0 +1,78 @@
+/*
+ * Vector Network Analyzer Library
+ * Copyright © 2020-2023 D Scott Guthridge <scott_guthridge@rompromity.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef VNAMEM_INTERNAL_H
+#define VNAMEM_INTERNAL_H
+
+#include <stdarg.h>
+#include <stddef.h>
+#include "vnamem.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* _vnamem_amalloc: allocate memory from the given allocator */
+extern void *_vnamem_amalloc(const vnamem_allocator_t *vmap, size_t size);
+
+/* _vnamem_acalloc: allocate zeroed memory from the given allocator */
+extern void *_vnamem_acalloc(const vnamem_allocator_t *vmap,
+	size_t count, size_t size);
+
+/* _vnamem_arealloc: resize memory from the given allocator */
+extern void *_vnamem_arealloc(const vnamem_allocator_t *vmap,
+	void *ptr, size_t size);
+
+/* _vnamem_afree: return memory to the given allocator */
+extern void _vnamem_afree(const vnamem_allocator_t *vmap, void *ptr);
+
+/* _vnamem_astrdup: duplicate a string using the given allocator */
+extern char *_vnamem_astrdup(const vnamem_allocator_t *vmap, const char *s);
+
+/* _vnamem_get_global_allocator: return a stable pointer to the global one */
+extern const vnamem_allocator_t *_vnamem_get_global_allocator(void);
+
+/*
+ * The following use the global allocator installed by
+ * vnamem_set_allocator.  Like their C library counterparts, they
+ * return NULL or -1 on failure with errno set.
+ */
+
+/* _vnamem_malloc: allocate memory */
+extern void *_vnamem_malloc(size_t size);
+
+/* _vnamem_calloc: allocate zeroed memory for a vector */
+extern void *_vnamem_calloc(size_t count, size_t size);
+
+/* _vnamem_realloc: resize allocated memory */
+extern void *_vnamem_realloc(void *ptr, size_t size);
+
+/* _vnamem_free: free allocated memory */
+extern void _vnamem_free(void *ptr);
+
+/* _vnamem_strdup: duplicate a string */
+extern char *_vnamem_strdup(const char *s);
+
+/* _vnamem_vasprintf: print to an allocated string */
+extern int _vnamem_vasprintf(char **strp, const char *format, va_list ap);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* VNAMEM_INTERNAL_H */
@@ -21,6 +21,8 @@
 #include <assert.h>
 #include <ctype.h>
 #include <errno.h>
+#include <inttypes.h>
+#include <math.h>
 #include <stdarg.h>
 #include <stdbool.h>
 #include <stddef.h>
@@ -28,6 +30,9 @@
 #include <stdlib.h>
 #include <string.h>
 #include <yaml.h>
+#ifdef HAVE_SSE42_CRC32
+#include <nmmintrin.h>
+#endif /* HAVE_SSE42_CRC32 */
 #include "vnaerr_internal.h"
 #include "vnaproperty_internal.h"
 
@@ -35,2073 +40,3608 @@ static void vnaproperty_free(vnaproperty_t *root);	/* forward */
 
 
 /***********************************************************************
- * Scalars
+ * Arenas
  **********************************************************************/
 
 /*
- * scalar_alloc: allocate a new scalar element
- *   @value: value of the scalar (string)
+ * arena_key_t: entry in the interned key table
  */
-static vnaproperty_t *scalar_alloc(const char *value)
-{
-    char *copy;
-    vnaproperty_scalar_t *vpsp;
+typedef struct arena_key {
+    const char *ak_key;		/* key text in the arena or NULL */
+    uint32_t ak_hashval;	/* full 32 bit hash value */
+} arena_key_t;
 
-    if ((copy = strdup(value)) == NULL) {
-	return NULL;
-    }
-    if ((vpsp = malloc(sizeof(vnaproperty_scalar_t))) == NULL) {
-	free((void *)copy);
-	return NULL;
-    }
-    (void)memset((void *)vpsp, 0, sizeof(*vpsp));
-    vpsp->vps_base.vpr_type = VNAPROPERTY_SCALAR;
-    vpsp->vps_value = copy;
+/*
+ * vnaproperty_arena: arena holding an arena-backed property tree
+ *
+ *   Nodes in the arena are never freed individually; the memory is
+ *   released all at once by vnaproperty_arena_free.  Map keys are
+ *   interned in vpa_key_table, an open-addressing hash table whose
+ *   size is a power of two, so that each distinct key is stored once.
+ *   Because the caller's subtree pointers must identify the arena even
+ *   when they point to null values, null subtrees handed out by
+ *   descend point to vpa_null instead of NULL.
+ */
+struct vnaproperty_arena {
+    vnamem_allocator_t	vpa_heap;	/* allocator for arena and keys */
+    vnamem_arena_t     *vpa_memory;	/* bump allocator */
+    vnamem_allocator_t	vpa_allocator;	/* allocator using vpa_memory */
+    vnaproperty_t	vpa_null;	/* null placeholder */
+    vnaproperty_t      *vpa_root;	/* root of the tree */
+    arena_key_t	       *vpa_key_table;	/* interned keys */
+    size_t		vpa_key_table_size;
+    size_t		vpa_key_count;
+};
 
-    return ((vnaproperty_t *)vpsp);
-}
+/*
+ * REAL_NODE: return NULL for the null placeholder, else node
+ */
+#define REAL_NODE(node) \
+	((node) != NULL && (node)->vpr_type == VNAPROPERTY_NULL ? \
+	 NULL : (node))
 
 /*
- * scalar_get: return the value of a scalar
- *   @scalar: pointer to scalar element
+ * null_node: return the representation of null in the given arena
+ *   @arena: arena or NULL
  */
-static const char *scalar_get(const vnaproperty_t *scalar)
+static vnaproperty_t *null_node(vnaproperty_arena_t *arena)
 {
-    vnaproperty_scalar_t *vpsp;
-
-    if (scalar->vpr_type != VNAPROPERTY_SCALAR) {
-	errno = EINVAL;
-	return NULL;
-    }
-    vpsp = (vnaproperty_scalar_t *)scalar;
-    return vpsp->vps_value;
+    return arena != NULL ? &arena->vpa_null : NULL;
 }
 
-
-/***********************************************************************
- * Maps
- **********************************************************************/
-
 /*
- * Castagnoli CRC-32 Table
- */
-static uint32_t crc32c_table[] = {
-	0x00000000, 0x1edc6f41, 0x3db8de82, 0x2364b1c3,
-	0x7b71bd04, 0x65add245, 0x46c96386, 0x58150cc7,
-	0xf6e37a08, 0xe83f1549, 0xcb5ba48a, 0xd587cbcb,
-	0x8d92c70c, 0x934ea84d, 0xb02a198e, 0xaef676cf,
-	0xf31a9b51, 0xedc6f410, 0xcea245d3, 0xd07e2a92,
-	0x886b2655, 0x96b74914, 0xb5d3f8d7, 0xab0f9796,
-	0x05f9e159, 0x1b258e18, 0x38413fdb, 0x269d509a,
-	0x7e885c5d, 0x6054331c, 0x433082df, 0x5deced9e,
-	0xf8e959e3, 0xe63536a2, 0xc5518761, 0xdb8de820,
-	0x8398e4e7, 0x9d448ba6, 0xbe203a65, 0xa0fc5524,
-	0x0e0a23eb, 0x10d64caa, 0x33b2fd69, 0x2d6e9228,
-	0x757b9eef, 0x6ba7f1ae, 0x48c3406d, 0x561f2f2c,
-	0x0bf3c2b2, 0x152fadf3, 0x364b1c30, 0x28977371,
-	0x70827fb6, 0x6e5e10f7, 0x4d3aa134, 0x53e6ce75,
-	0xfd10b8ba, 0xe3ccd7fb, 0xc0a86638, 0xde740979,
-	0x866105be, 0x98bd6aff, 0xbbd9db3c, 0xa505b47d,
-	0xef0edc87, 0xf1d2b3c6, 0xd2b60205, 0xcc6a6d44,
-	0x947f6183, 0x8aa30ec2, 0xa9c7bf01, 0xb71bd040,
-	0x19eda68f, 0x0731c9ce, 0x2455780d, 0x3a89174c,
-	0x629c1b8b, 0x7c4074ca, 0x5f24c509, 0x41f8aa48,
-	0x1c1447d6, 0x02c82897, 0x21ac9954, 0x3f70f615,
-	0x6765fad2, 0x79b99593, 0x5add2450, 0x44014b11,
-	0xeaf73dde, 0xf42b529f, 0xd74fe35c, 0xc9938c1d,
-	0x918680da, 0x8f5aef9b, 0xac3e5e58, 0xb2e23119,
-	0x17e78564, 0x093bea25, 0x2a5f5be6, 0x348334a7,
-	0x6c963860, 0x724a5721, 0x512ee6e2, 0x4ff289a3,
-	0xe104ff6c, 0xffd8902d, 0xdcbc21ee, 0xc2604eaf,
-	0x9a754268, 0x84a92d29, 0xa7cd9cea, 0xb911f3ab,
-	0xe4fd1e35, 0xfa217174, 0xd945c0b7, 0xc799aff6,
-	0x9f8ca331, 0x8150cc70, 0xa2347db3, 0xbce812f2,
-	0x121e643d, 0x0cc20b7c, 0x2fa6babf, 0x317ad5fe,
-	0x696fd939, 0x77b3b678, 0x54d707bb, 0x4a0b68fa,
-	0xc0c1d64f, 0xde1db90e, 0xfd7908cd, 0xe3a5678c,
-	0xbbb06b4b, 0xa56c040a, 0x8608b5c9, 0x98d4da88,
-	0x3622ac47, 0x28fec306, 0x0b9a72c5, 0x15461d84,
-	0x4d531143, 0x538f7e02, 0x70ebcfc1, 0x6e37a080,
-	0x33db4d1e, 0x2d07225f, 0x0e63939c, 0x10bffcdd,
-	0x48aaf01a, 0x56769f5b, 0x75122e98, 0x6bce41d9,
-	0xc5383716, 0xdbe45857, 0xf880e994, 0xe65c86d5,
-	0xbe498a12, 0xa095e553, 0x83f15490, 0x9d2d3bd1,
-	0x38288fac, 0x26f4e0ed, 0x0590512e, 0x1b4c3e6f,
-	0x435932a8, 0x5d855de9, 0x7ee1ec2a, 0x603d836b,
-	0xcecbf5a4, 0xd0179ae5, 0xf3732b26, 0xedaf4467,
-	0xb5ba48a0, 0xab6627e1, 0x88029622, 0x96def963,
-	0xcb3214fd, 0xd5ee7bbc, 0xf68aca7f, 0xe856a53e,
-	0xb043a9f9, 0xae9fc6b8, 0x8dfb777b, 0x9327183a,
-	0x3dd16ef5, 0x230d01b4, 0x0069b077, 0x1eb5df36,
-	0x46a0d3f1, 0x587cbcb0, 0x7b180d73, 0x65c46232,
-	0x2fcf0ac8, 0x31136589, 0x1277d44a, 0x0cabbb0b,
-	0x54beb7cc, 0x4a62d88d, 0x6906694e, 0x77da060f,
-	0xd92c70c0, 0xc7f01f81, 0xe494ae42, 0xfa48c103,
-	0xa25dcdc4, 0xbc81a285, 0x9fe51346, 0x81397c07,
-	0xdcd59199, 0xc209fed8, 0xe16d4f1b, 0xffb1205a,
-	0xa7a42c9d, 0xb97843dc, 0x9a1cf21f, 0x84c09d5e,
-	0x2a36eb91, 0x34ea84d0, 0x178e3513, 0x09525a52,
-	0x51475695, 0x4f9b39d4, 0x6cff8817, 0x7223e756,
-	0xd726532b, 0xc9fa3c6a, 0xea9e8da9, 0xf442e2e8,
-	0xac57ee2f, 0xb28b816e, 0x91ef30ad, 0x8f335fec,
-	0x21c52923, 0x3f194662, 0x1c7df7a1, 0x02a198e0,
-	0x5ab49427, 0x4468fb66, 0x670c4aa5, 0x79d025e4,
-	0x243cc87a, 0x3ae0a73b, 0x198416f8, 0x075879b9,
-	0x5f4d757e, 0x41911a3f, 0x62f5abfc, 0x7c29c4bd,
-	0xd2dfb272, 0xcc03dd33, 0xef676cf0, 0xf1bb03b1,
-	0xa9ae0f76, 0xb7726037, 0x9416d1f4, 0x8acabeb5
-};
+ * tree_t: where new nodes of a tree are allocated
+ *
+ *   Each node points to the allocator that holds it so that it can be
+ *   grown and freed through that allocator even after the global
+ *   allocator has changed.  Nodes added to an existing tree use the
+ *   allocator of the tree.  The allocator belongs to the arena, the
+ *   structure that owns the tree, or the list of global allocators
+ *   kept by vnamem; nodes only point to it.
+ */
+typedef struct tree {
+    vnaproperty_arena_t *tr_arena;	/* arena holding the tree or NULL */
+    const vnamem_allocator_t *tr_allocator; /* allocator for new nodes */
+} tree_t;
 
 /*
- * crc32c: compute Castagnoli CRC-32 on data
- *   @value: initial value (typically -1)
- *   @data: data on which to compute the CRC
- *   @length: length of data in bytes
+ * tree_init: set up a tree_t for adding nodes next to node
+ *   @treep: tree_t structure to fill
+ *   @node: existing node of the tree, or NULL for a new tree
+ *   @vmap: allocator for a new tree, or NULL for the global allocator
  */
-static uint32_t crc32c(uint32_t value, const void *data, size_t length)
+static void tree_init(tree_t *treep, const vnaproperty_t *node,
+	const vnamem_allocator_t *vmap)
 {
-	const uint8_t *bp;
-
-	for (bp = data; bp < &((uint8_t *)data)[length]; ++bp) {
-		value = (value << 8) ^ crc32c_table[(value >> 24) ^ *bp];
-	}
-	return value;
+    if (node != NULL) {
+	treep->tr_arena = node->vpr_arena;
+	treep->tr_allocator = node->vpr_allocator;
+    } else {
+	treep->tr_arena = NULL;
+	treep->tr_allocator = vmap != NULL ? vmap :
+	    _vnamem_get_global_allocator();
+    }
 }
 
 /*
- * map_compare_keys: compare key and hashval to the given element
- *   @key: key string
- *   @hashval: full 32-bit hashval
- *   @vmep: element with which to compare
- *
- * compares by hashval first, then by string compare
+ * node_init: initialize the base of a new node
+ *   @treep: tree holding the node
+ *   @node: node
+ *   @type: node type
  */
-static int map_compare_keys(const char *key, uint32_t hashval,
-	vnaproperty_map_element_t *vmep)
+static void node_init(const tree_t *treep, vnaproperty_t *node,
+	vnaproperty_type_t type)
 {
-    if (hashval < vmep->vme_hashval)
-	return -1;
-
-    if (hashval > vmep->vme_hashval)
-	return +1;
-
-    return strcmp(key, vmep->vme_pair.vmpr_key);
+    node->vpr_type = type;
+    node->vpr_arena = treep->tr_arena;
+    node->vpr_allocator = treep->tr_allocator;
 }
 
 /*
- * map_find_anchor: find insertion point
- *   @vplp:    pointer to property map structure
- *   @anchor:  address of address of the insertion point
- *   @key:     search key
- *   @hashval: full 32 bit hash value
- *
- * If the key is found return true, else return false.  In either case,
- * *anchor is set to the insertion point, i.e. if the element is found,
- * **anchor is the found element; if not found, *anchor is the address
- * of the pointer where the element should be inserted.
+ * arena_expand_keys: double the size of the interned key table
+ *   @arena: arena
  */
-static bool map_find_anchor(vnaproperty_map_t *vpmp,
-	vnaproperty_map_element_t ***anchor,
-	const char *key, uint32_t hashval)
+static int arena_expand_keys(vnaproperty_arena_t *arena)
 {
-    vnaproperty_map_element_t *vmep, **vmepp;
-    int bucket;
-    int cmp = 1;
+    size_t old_size = arena->vpa_key_table_size;
+    size_t new_size = old_size != 0 ? 2 * old_size : 64;
+    arena_key_t *old_table = arena->vpa_key_table;
+    arena_key_t *new_table;
 
-    assert(vpmp->vpm_hash_size != 0);
-    bucket = hashval % vpmp->vpm_hash_size;
-    vmepp = &vpmp->vpm_hash_table[bucket];
-    for (; (vmep = *vmepp) != NULL; vmepp = &vmep->vme_hash_next) {
-	if ((cmp = map_compare_keys(key, hashval, vmep)) <= 0)
-	    break;
+    if ((new_table = _vnamem_acalloc(&arena->vpa_heap, new_size,
+		    sizeof(arena_key_t))) == NULL) {
+	return -1;
+    }
+    for (size_t i = 0; i < old_size; ++i) {
+	const arena_key_t *akp = &old_table[i];
+	size_t slot;
+
+	if (akp->ak_key == NULL) {
+	    continue;
+	}
+	slot = akp->ak_hashval & (new_size - 1);
+	while (new_table[slot].ak_key != NULL) {
+	    slot = (slot + 1) & (new_size - 1);
+	}
+	new_table[slot] = *akp;
     }
-    *anchor = vmepp;
-    return cmp == 0;
+    _vnamem_afree(&arena->vpa_heap, (void *)old_table);
+    arena->vpa_key_table = new_table;
+    arena->vpa_key_table_size = new_size;
+    return 0;
 }
 
 /*
- * map_expand: increase the size of the hash table and rehash all elements
- *   @vpmp: map structure
+ * arena_intern_key: return the arena's copy of key, adding it if needed
+ *   @arena: arena
+ *   @key: map key
+ *   @hashval: hash of key from hash_key
  */
-static int map_expand(vnaproperty_map_t *vpmp)
+static const char *arena_intern_key(vnaproperty_arena_t *arena,
+	const char *key, uint32_t hashval)
 {
-    size_t old_allocation = vpmp->vpm_hash_size;
-    size_t new_allocation = vpmp->vpm_count + 1;
-    vnaproperty_map_element_t **new_table;
+    size_t mask, slot;
+    size_t length;
+    char *copy;
 
-    /*
-     * Calculate the new allocation and alloc/resize the table.
-     */
-    new_allocation += (new_allocation + 1) / 2;
-    if (new_allocation < 11) {
-	new_allocation = 11;
+    if (2 * (arena->vpa_key_count + 1) > arena->vpa_key_table_size) {
+	if (arena_expand_keys(arena) == -1) {
+	    return NULL;
+	}
     }
-    new_table = (vnaproperty_map_element_t **)realloc(
-	    (void *)vpmp->vpm_hash_table,
-	    new_allocation * sizeof(vnaproperty_map_element_t *));
-    if (new_table == NULL) {
-	return -1;
+    mask = arena->vpa_key_table_size - 1;
+    for (slot = hashval & mask; arena->vpa_key_table[slot].ak_key != NULL;
+	    slot = (slot + 1) & mask) {
+	const arena_key_t *akp = &arena->vpa_key_table[slot];
+
+	if (akp->ak_hashval == hashval && strcmp(akp->ak_key, key) == 0) {
+	    return akp->ak_key;
+	}
     }
-    (void)memset((void *)&new_table[old_allocation], 0,
-	    (new_allocation - old_allocation) *
-	    sizeof(vnaproperty_map_element_t *));
-    vpmp->vpm_hash_table = new_table;
+    length = strlen(key) + 1;
+    if ((copy = _vnamem_amalloc(&arena->vpa_allocator, length)) == NULL) {
+	return NULL;
+    }
+    (void)memcpy((void *)copy, (void *)key, length);
+    arena->vpa_key_table[slot].ak_key = copy;
+    arena->vpa_key_table[slot].ak_hashval = hashval;
+    ++arena->vpa_key_count;
+    return copy;
+}
 
-    /*
-     * Walk the old chains and rehash all elements.
-     */
-    for (size_t s = 0; s < old_allocation; ++s) {
-	vnaproperty_map_element_t *head, *cur;
 
-	/*
-	 * Move the elements from the current hash chain to a local list
-	 * at head.
-	 */
-	head = new_table[s];
-	new_table[s] = NULL;
+/***********************************************************************
+ * Scalars
+ **********************************************************************/
 
-	/*
-	 * For each element on the local list...
-	 */
-	while ((cur = head) != NULL) {
-	    vnaproperty_map_element_t *next, **anchor;
+/*
+ * scalar_alloc: allocate a new scalar element
+ *   @treep: tree holding the new node
+ *   @value: value of the scalar (string)
+ *
+ *   In an arena, the value is stored immediately after the structure.
+ */
+static vnaproperty_t *scalar_alloc(const tree_t *treep, const char *value)
+{
+    const vnamem_allocator_t *vmap = treep->tr_allocator;
+    char *copy;
+    vnaproperty_scalar_t *vpsp;
 
-	    /*
-	     * Remove the first element as "cur".
-	     */
-	    head = cur->vme_hash_next;
-	    cur->vme_hash_next = NULL;
+    if (treep->tr_arena != NULL) {
+	size_t length = strlen(value) + 1;
 
-	    /*
-	     * Re-insert "cur" into its new hash chain.  As we go through
-	     * the buckets, we will re-process elements we've already moved.
-	     * But since a reprocessed element is always already in the
-	     * correct location, it has to be reprocessed at most once.
-	     */
-	    anchor = &new_table[cur->vme_hashval % new_allocation];
-	    for (; (next = *anchor) != NULL; anchor = &next->vme_hash_next) {
-		if (map_compare_keys(cur->vme_pair.vmpr_key,
-			    cur->vme_hashval, next) <= 0)
-		    break;
-	    }
-	    cur->vme_hash_next = next;
-	    *anchor = cur;
+	if ((vpsp = _vnamem_amalloc(vmap, sizeof(vnaproperty_scalar_t) +
+			length)) == NULL) {
+	    return NULL;
+	}
+	copy = (char *)&vpsp[1];
+	(void)memcpy((void *)copy, (void *)value, length);
+    } else {
+	if ((copy = _vnamem_astrdup(vmap, value)) == NULL) {
+	    return NULL;
+	}
+	if ((vpsp = _vnamem_amalloc(vmap,
+			sizeof(vnaproperty_scalar_t))) == NULL) {
+	    _vnamem_afree(vmap, (void *)copy);
+	    return NULL;
 	}
     }
-    vpmp->vpm_hash_size = new_allocation;
-    return 0;
+    (void)memset((void *)vpsp, 0, sizeof(*vpsp));
+    node_init(treep, &vpsp->vps_base, VNAPROPERTY_SCALAR);
+    vpsp->vps_value = copy;
+
+    return ((vnaproperty_t *)vpsp);
 }
 
 /*
- * map_append_order_element: append to order list
- *   @vplp: pointer to property map structure
- *   @vmep: element to append
+ * format_double: format a double with the fewest digits that read back
+ *   @cp: buffer of at least 32 bytes
+ *   @value: value to format
+ *   @plus: if true, always include the sign
+ *
+ *   Return a pointer to the terminating nul.
  */
-static void map_append_order_element(vnaproperty_map_t *vpmp,
-	vnaproperty_map_element_t *vmep)
+static char *format_double(char *cp, double value, bool plus)
 {
-    assert(vmep->vme_order_next == NULL);
-    assert(vmep->vme_order_prev == NULL);
-    if (vpmp->vpm_order_head == NULL) {
-	assert(vpmp->vpm_order_tail == NULL);
-	assert(vpmp->vpm_count == 0);
-	vpmp->vpm_order_head = vmep;
-    } else {
-	assert(vpmp->vpm_order_tail != NULL);
-	assert(vpmp->vpm_count > 0);
-	vmep->vme_order_prev = vpmp->vpm_order_tail;
-	vpmp->vpm_order_tail->vme_order_next = vmep;
+    int length = 0;
+
+    for (int precision = 15; precision <= 17; ++precision) {
+	length = sprintf(cp, plus ? "%+.*g" : "%.*g", precision, value);
+	if (isnan(value) || strtod(cp, NULL) == value) {
+	    break;
+	}
     }
-    vpmp->vpm_order_tail = vmep;
+    return cp + length;
 }
 
 /*
- * map_delete_order_element: delete from order list
- *   @vplp: pointer to property map structure
- *   @vmep: element to delete
+ * format_number: make the text of a number
+ *   @buffer: buffer of at least 80 bytes
+ *   @type: type of the number
+ *   @number: value to format
  */
-static void map_delete_order_element(vnaproperty_map_t *vpmp,
-	vnaproperty_map_element_t *vmep)
+static void format_number(char *buffer, vnaproperty_number_type_t type,
+	const vnaproperty_number_t *number)
 {
-    vnaproperty_map_element_t *prev = vmep->vme_order_prev;
-    vnaproperty_map_element_t *next = vmep->vme_order_next;
+    char *cp = buffer;
 
-    if (prev != NULL) {
-	prev->vme_order_next = next;
-    } else {
-	vpmp->vpm_order_head = next;
-    }
-    if (next != NULL) {
-	next->vme_order_prev = prev;
-    } else {
-	vpmp->vpm_order_tail = prev;
+    switch (type) {
+    case VNAPROPERTY_NUMBER_INT64:
+	(void)sprintf(cp, "%" PRId64, number->vpn_int64);
+	break;
+
+    case VNAPROPERTY_NUMBER_DOUBLE:
+	(void)format_double(cp, number->vpn_double, false);
+	break;
+
+    case VNAPROPERTY_NUMBER_COMPLEX:
+	cp = format_double(cp, creal(number->vpn_complex), false);
+	cp = format_double(cp, cimag(number->vpn_complex), true);
+	*cp++ = 'j';
+	*cp = '\000';
+	break;
+
+    default:
+	abort();
     }
 }
 
 /*
- * map_alloc: allocate a new map element
+ * number_alloc: allocate a new scalar with a numeric value
+ *   @treep: tree holding the new node
+ *   @type: type of the number
+ *   @number: value of the scalar
+ *
+ *   The text is made here rather than when first read so that reading
+ *   never modifies the node.
  */
-static vnaproperty_t *map_alloc()
+static vnaproperty_t *number_alloc(const tree_t *treep,
+	vnaproperty_number_type_t type, const vnaproperty_number_t *number)
 {
-    vnaproperty_map_t *vpmp;
+    char buffer[80];
+    vnaproperty_scalar_t *vpsp;
 
-    if ((vpmp = malloc(sizeof(vnaproperty_map_t))) == NULL) {
+    format_number(buffer, type, number);
+    if ((vpsp = (vnaproperty_scalar_t *)scalar_alloc(treep,
+		    buffer)) == NULL) {
 	return NULL;
     }
-    (void)memset((void *)vpmp, 0, sizeof(*vpmp));
-    vpmp->vpm_base.vpr_type = VNAPROPERTY_MAP;
-    return ((vnaproperty_t *)vpmp);
+    vpsp->vps_typed = true;
+    vpsp->vps_number_type = type;
+    vpsp->vps_number = *number;
+
+    return ((vnaproperty_t *)vpsp);
 }
 
 /*
- * map_count: return the number of items in the map
- *   @list: pointer to map element
+ * scalar_get: return the value of a scalar
+ *   @scalar: pointer to scalar element
  */
-static int map_count(const vnaproperty_t *map)
+static const char *scalar_get(const vnaproperty_t *scalar)
 {
-    vnaproperty_map_t *vpmp;
-
-    if (map->vpr_type != VNAPROPERTY_MAP) {
+    if (scalar->vpr_type != VNAPROPERTY_SCALAR) {
 	errno = EINVAL;
-	return -1;
+	return NULL;
     }
-    vpmp = (vnaproperty_map_t *)map;
-    return vpmp->vpm_count;
+    return ((const vnaproperty_scalar_t *)scalar)->vps_value;
 }
 
 /*
- * map_subtree: return the address of the subtree of key
- *   @list: pointer to map element
- *   @add:  insert key if not found
- *   @key:  search key
+ * _vnaproperty_parse_complex: parse a complex number from a string
+ *   @cur: text to parse
+ *
+ *   Accept a real number, a real and an imaginary part as in "1 -2j",
+ *   or forms such as "j" or "3+j".  Return HUGE_VAL if the text isn't
+ *   a valid complex number.
  */
-static vnaproperty_t **map_subtree(vnaproperty_t *map, bool add,
-	const char *key)
+double complex _vnaproperty_parse_complex(const char *cur)
 {
-    vnaproperty_map_t *vpmp;
-    vnaproperty_map_element_t **anchor, *vmep;
-    uint32_t hashval;
-
-    if (map->vpr_type != VNAPROPERTY_MAP) {
-	errno = EINVAL;
-	return NULL;
-    }
-    vpmp = (vnaproperty_map_t *)map;
-    if (vpmp->vpm_count + 1 >= 2 * vpmp->vpm_hash_size) {
-	if (map_expand(vpmp) == -1) {
-	    return NULL;
+    char *end;
+    double value1 = 0.0, value2 = 0.0;
+    int code = 0;
+
+    value1 = strtod(cur, &end);
+    if (end != cur) {
+	++code;
+	cur = end;
+	value2 = strtod(cur, &end);
+	if (end != cur) {
+	    ++code;
+	    cur = end;
 	}
     }
-    hashval = crc32c(-1, (void *)key, strlen(key));
-    if (map_find_anchor(vpmp, &anchor, key, hashval)) {
-	vmep = *anchor;
-	return &vmep->vme_pair.vmpr_value;
-    }
-    if ((vmep = malloc(sizeof(vnaproperty_map_element_t))) == NULL) {
-	return NULL;
+    while (*cur == ' ' || *cur == '\t' || *cur == '\n') {
+	++cur;
     }
-    if (!add) {
-	errno = ENOENT;
-	return NULL;
+    if (*cur == '+') {
+	code |= 8;
+	++cur;
+    } else if (*cur == '-') {
+	code |= 16;
+	++cur;
     }
-    (void)memset((void *)vmep, 0, sizeof(*vmep));
-    if ((vmep->vme_pair.vmpr_key = strdup(key)) == NULL) {
-	free((void *)vmep);
-	return NULL;
+    while (*cur == ' ' || *cur == '\t' || *cur == '\n') {
+	++cur;
     }
-    vmep->vme_magic = VNAPROPERTY_MAP_PAIR_ELEMENT_MAGIC;
-    vmep->vme_hashval = hashval;
-    vmep->vme_hash_next = *anchor;
-    *anchor = vmep;
-    map_append_order_element(vpmp, vmep);
-    ++vpmp->vpm_count;
-    return &vmep->vme_pair.vmpr_value;
-}
-
-/*
- * map_delete: delete the element with given key
- *   @list: pointer to map element
- *   @key: search key
- */
-static int map_delete(vnaproperty_t *map, const char *key)
-{
-    vnaproperty_map_t *vpmp;
-    vnaproperty_map_element_t **anchor, *vmep;
-    uint32_t hashval;
+    switch (*cur) {
+    case 'I':
+    case 'J':
+    case 'i':
+    case 'j':
+	code |= 4;
+	++cur;
+	break;
 
-    if (map->vpr_type != VNAPROPERTY_MAP) {
-	errno = EINVAL;
-	return -1;
+    default:
+	break;
     }
-    vpmp = (vnaproperty_map_t *)map;
-    if (vpmp->vpm_count == 0) {
-	errno = ENOENT;
-	return -1;
+    while (*cur == ' ' || *cur == '\t' || *cur == '\n') {
+	++cur;
     }
-    hashval = crc32c(-1, (void *)key, strlen(key));
-    if (!map_find_anchor(vpmp, &anchor, key, hashval)) {
-	errno = ENOENT;
-	return -1;
+    if (*cur != '\000') {
+	return HUGE_VAL;
     }
-    vmep = *anchor;
-    assert(vpmp->vpm_count > 0);
-    map_delete_order_element(vpmp, vmep);
-    *anchor = vmep->vme_hash_next;
-    free((void *)vmep->vme_pair.vmpr_key);
-    vnaproperty_free((vnaproperty_t *)vmep->vme_pair.vmpr_value);
-    memset((void *)vmep, 'X', sizeof(*vmep));
-    free((void *)vmep);
-    --vpmp->vpm_count;
-    if (vpmp->vpm_count == 0) {
-	assert(vpmp->vpm_order_head == NULL);
-	assert(vpmp->vpm_order_tail == NULL);
-    } else {
-	assert(vpmp->vpm_order_head != NULL);
-	assert(vpmp->vpm_order_tail != NULL);
+    switch (code) {
+    case 1:	/* number */
+	return value1;
+    case 4:	/* j */
+	return I;
+    case 5:	/* number j */
+	return value1 * I;
+    case 6:	/* number number j */
+	return value1 + value2 * I;
+    case 12:	/* +j */
+	return I;
+    case 13:	/* number + j */
+	return value1 + I;
+    case 20:	/* -j */
+	return -I;
+    case 21:	/* number - j */
+	return value1 - I;
+    default:
+	break;
     }
-    return 0;
+    return HUGE_VAL;
 }
 
-
-/***********************************************************************
- * Lists
- **********************************************************************/
-
 /*
- * list_check_allocation: extend allocation to >= size
- *   @vplp: pointer to property list structure
- *   @size: needed size
+ * parse_number: convert text to a number of the given type
+ *   @text: text to convert
+ *   @type: type of the result
+ *   @result: address of the result
  */
-static int list_check_allocation(vnaproperty_list_t *vplp, size_t size)
+static int parse_number(const char *text, vnaproperty_number_type_t type,
+	vnaproperty_number_t *result)
 {
-    size_t new_allocation;
-    vnaproperty_t **new_vector = NULL;
+    char *end;
 
-    /* If there's already enough, return. */
-    if (size <= vplp->vpl_allocation)
-	return 0;
-
-    /*
-     * Find the next power of 2 allocation higher than size.
-     */
-    new_allocation = MAX(8, vplp->vpl_allocation);
-    while (new_allocation <= size) {
-	new_allocation <<= 1;
-	if (new_allocation == 0) {
-	    errno = EINVAL;
+    switch (type) {
+    case VNAPROPERTY_NUMBER_INT64:
+	errno = 0;
+	result->vpn_int64 = strtoll(text, &end, 0);
+	if (*text == '\000' || *end != '\000') {
+	    break;
+	}
+	if (errno == ERANGE) {
 	    return -1;
 	}
-    }
+	return 0;
 
-    /* Realloc */
-    if ((new_vector = realloc(vplp->vpl_vector, new_allocation *
-		    sizeof(vnaproperty_t *))) == NULL) {
-	return -1;
+    case VNAPROPERTY_NUMBER_DOUBLE:
+	result->vpn_double = strtod(text, &end);
+	if (*text == '\000' || *end != '\000') {
+	    break;
+	}
+	return 0;
+
+    case VNAPROPERTY_NUMBER_COMPLEX:
+	result->vpn_complex = _vnaproperty_parse_complex(text);
+	if (result->vpn_complex == HUGE_VAL) {
+	    break;
+	}
+	return 0;
+
+    default:
+	abort();
     }
-    (void)memset((void *)&new_vector[vplp->vpl_allocation], 0,
-		 (new_allocation - vplp->vpl_allocation) *
-		 sizeof(vnaproperty_t *));
-    vplp->vpl_vector = new_vector;
-    vplp->vpl_allocation = new_allocation;
-    return 0;
+    errno = EINVAL;
+    return -1;
 }
 
 /*
- * list_alloc: allocate a new list element
+ * convert_number: convert a number from one type to another
+ *   @from_type: type of the number
+ *   @from: number to convert
+ *   @to_type: type of the result
+ *   @result: address of the result
+ *
+ *   Conversions that would lose the imaginary part or the fraction
+ *   fail with EINVAL.
  */
-static vnaproperty_t *list_alloc()
+static int convert_number(vnaproperty_number_type_t from_type,
+	const vnaproperty_number_t *from, vnaproperty_number_type_t to_type,
+	vnaproperty_number_t *result)
 {
-    vnaproperty_list_t *vplp;
+    double complex value;
 
-    if ((vplp = malloc(sizeof(vnaproperty_list_t))) == NULL) {
-	return NULL;
+    switch (from_type) {
+    case VNAPROPERTY_NUMBER_INT64:
+	value = (double)from->vpn_int64;
+	break;
+
+    case VNAPROPERTY_NUMBER_DOUBLE:
+	value = from->vpn_double;
+	break;
+
+    case VNAPROPERTY_NUMBER_COMPLEX:
+	value = from->vpn_complex;
+	break;
+
+    default:
+	abort();
     }
-    (void)memset((void *)vplp, 0, sizeof(*vplp));
-    vplp->vpl_base.vpr_type = VNAPROPERTY_LIST;
+    switch (to_type) {
+    case VNAPROPERTY_NUMBER_INT64:
+	if (from_type == VNAPROPERTY_NUMBER_INT64) {
+	    result->vpn_int64 = from->vpn_int64;
+	    return 0;
+	}
+	if (cimag(value) != 0.0 || creal(value) != floor(creal(value)) ||
+		creal(value) < -0x1p63 || creal(value) >= 0x1p63) {
+	    break;
+	}
+	result->vpn_int64 = (int64_t)creal(value);
+	return 0;
 
-    return ((vnaproperty_t *)vplp);
-}
+    case VNAPROPERTY_NUMBER_DOUBLE:
+	if (cimag(value) != 0.0) {
+	    break;
+	}
+	result->vpn_double = creal(value);
+	return 0;
 
-/*
- * list_count: return the number of items in the list
- *   @list: pointer to list element
- */
-static int list_count(const vnaproperty_t *list)
-{
-    vnaproperty_list_t *vplp;
+    case VNAPROPERTY_NUMBER_COMPLEX:
+	result->vpn_complex = value;
+	return 0;
 
-    if (list->vpr_type != VNAPROPERTY_LIST) {
-	errno = EINVAL;
-	return -1;
+    default:
+	abort();
     }
-    vplp = (vnaproperty_list_t *)list;
-    return vplp->vpl_length;
+    errno = EINVAL;
+    return -1;
 }
 
 /*
- * list_subtree: return address of subtree at given index
- *   @list:  pointer to list element
- *   @add:   add elements to list if needed
- *   @index: index into list
+ * scalar_number: return the value of a scalar as a number
+ *   @scalar: pointer to scalar element
+ *   @type: type of the result
+ *   @result: address of the result
+ *
+ *   A scalar set from a number is converted from its number; one set
+ *   from text is parsed.  Reading doesn't modify the node, so threads
+ *   may read a tree concurrently.
  */
-static vnaproperty_t **list_subtree(vnaproperty_t *list,
-	bool add, int index)
+static int scalar_number(const vnaproperty_t *scalar,
+	vnaproperty_number_type_t type, vnaproperty_number_t *result)
 {
-    vnaproperty_list_t *vplp;
+    const vnaproperty_scalar_t *vpsp;
 
-    if (list->vpr_type != VNAPROPERTY_LIST || index < 0) {
+    if (scalar->vpr_type != VNAPROPERTY_SCALAR) {
 	errno = EINVAL;
-	return NULL;
+	return -1;
     }
-    vplp = (vnaproperty_list_t *)list;
-    if (index >= vplp->vpl_length) {	/* extend case */
-	if (!add) {
-	    errno = ENOENT;
-	    return NULL;
-	}
-	if (list_check_allocation(vplp, index + 1) == -1) {
-	    return NULL;
+    vpsp = (const vnaproperty_scalar_t *)scalar;
+    if (vpsp->vps_typed) {
+	if (vpsp->vps_number_type == type) {
+	    *result = vpsp->vps_number;
+	    return 0;
 	}
-	vplp->vpl_length = index + 1;
+	return convert_number(vpsp->vps_number_type, &vpsp->vps_number,
+		type, result);
     }
-    return &vplp->vpl_vector[index];
+    return parse_number(vpsp->vps_value, type, result);
 }
 
 /*
- * list_insert: insert null element at index and return address
- *   @list: pointer to list element
- *   @index: index where element should be inserted
- *
- * Index must be in 0..N where N is the number of elements in the list.
+ * scalar_copy: allocate a copy of a scalar
+ *   @treep: tree holding the copy
+ *   @scalar: scalar to copy
  */
-static vnaproperty_t **list_insert(vnaproperty_t *list, int index)
+static vnaproperty_t *scalar_copy(const tree_t *treep,
+	const vnaproperty_t *scalar)
 {
-    vnaproperty_list_t *vplp;
+    const vnaproperty_scalar_t *vpsp = (const vnaproperty_scalar_t *)scalar;
+    vnaproperty_scalar_t *copy;
 
-    if (list->vpr_type != VNAPROPERTY_LIST || index < 0) {
-	errno = EINVAL;
-	return NULL;
-    }
-    vplp = (vnaproperty_list_t *)list;
-    if (index >= vplp->vpl_length) {
-	return list_subtree(list, /*add*/true, index);
-    }
-    if (list_check_allocation(vplp, vplp->vpl_length + 1) == -1) {
+    if ((copy = (vnaproperty_scalar_t *)scalar_alloc(treep,
+		    vpsp->vps_value)) == NULL) {
 	return NULL;
     }
-    (void)memmove((void *)&vplp->vpl_vector[index + 1],
-		  (void *)&vplp->vpl_vector[index],
-		  (vplp->vpl_length - index) * sizeof(vnaproperty_t *));
-    vplp->vpl_vector[index] = NULL;
-    ++vplp->vpl_length;
-
-    return &vplp->vpl_vector[index];
+    copy->vps_typed = vpsp->vps_typed;
+    copy->vps_number_type = vpsp->vps_number_type;
+    copy->vps_number = vpsp->vps_number;
+    return (vnaproperty_t *)copy;
 }
 
+
+/***********************************************************************
+ * Maps
+ **********************************************************************/
+
 /*
- * list_append: append null element and return address
- *   @list: pointer to list element
+ * MAP_MIN_HASH_SIZE: initial number of slots in a map's hash table
  */
-static vnaproperty_t **list_append(vnaproperty_t *list)
-{
-    vnaproperty_list_t *vplp;
-    vnaproperty_t **result;
+#define MAP_MIN_HASH_SIZE	8
 
-    if (list->vpr_type != VNAPROPERTY_LIST) {
-	errno = EINVAL;
-	return NULL;
+/*
+ * hash_portable: hash a key a word at a time
+ *   @key: key text
+ *   @length: length of key in bytes
+ */
+static uint32_t hash_portable(const char *key, size_t length)
+{
+    uint64_t value = 0x9E3779B97F4A7C15ULL ^ length;
+    uint64_t word;
+
+    while (length >= sizeof(word)) {
+	(void)memcpy((void *)&word, (void *)key, sizeof(word));
+	value = (value ^ word) * 0xFF51AFD7ED558CCDULL;
+	value ^= value >> 32;
+	key += sizeof(word);
+	length -= sizeof(word);
     }
-    vplp = (vnaproperty_list_t *)list;
-    if (list_check_allocation(vplp, vplp->vpl_length + 1) == -1) {
-	return NULL;
+    if (length != 0) {
+	word = 0;
+	(void)memcpy((void *)&word, (void *)key, length);
+	value = (value ^ word) * 0xFF51AFD7ED558CCDULL;
     }
-    *(result = &vplp->vpl_vector[vplp->vpl_length++]) = NULL;
-
-    return result;
+    value ^= value >> 33;
+    value *= 0xC4CEB9FE1A85EC53ULL;
+    value ^= value >> 33;
+    return (uint32_t)value;
 }
 
+#ifdef HAVE_SSE42_CRC32
 /*
- * list_delete: delete the element at the given index
- *   @list: pointer to list element
- *   @index: index of element to delete
+ * hash_sse42: hash a key using the SSE4.2 crc32 instruction
+ *   @key: key text
+ *   @length: length of key in bytes
+ *
+ *   Keys can't contain NUL, so padding the tail with zeros doesn't
+ *   make distinct keys collide.
  */
-static int list_delete(vnaproperty_t *list, int index)
+__attribute__((target("sse4.2")))
+static uint32_t hash_sse42(const char *key, size_t length)
 {
-    vnaproperty_list_t *vplp;
-
-    if (list->vpr_type != VNAPROPERTY_LIST || index < 0) {
-	errno = EINVAL;
-	return -1;
+    uint64_t value = 0xFFFFFFFF;
+    uint64_t word;
+
+    while (length >= sizeof(word)) {
+	(void)memcpy((void *)&word, (void *)key, sizeof(word));
+	value = _mm_crc32_u64(value, word);
+	key += sizeof(word);
+	length -= sizeof(word);
     }
-    vplp = (vnaproperty_list_t *)list;
-    if (index >= vplp->vpl_length) {
-	errno = ENOENT;
-	return -1;
+    if (length != 0) {
+	word = 0;
+	(void)memcpy((void *)&word, (void *)key, length);
+	value = _mm_crc32_u64(value, word);
     }
-    (void)memmove((void *)&vplp->vpl_vector[index],
-		  (void *)&vplp->vpl_vector[index + 1],
-		  (vplp->vpl_length - index) * sizeof(vnaproperty_t *));
-    vplp->vpl_vector[--vplp->vpl_length] = NULL;
-    return 0;
+    return (uint32_t)~value;
 }
-
-
-/***********************************************************************
- * Property Scanner & Parser
- **********************************************************************/
+#endif /* HAVE_SSE42_CRC32 */
 
 /*
- * vnaproperty_token_t: tokens returned by the scanner
+ * hash_key: hash a map key
+ *   @key: key text
+ *   @length: length of key in bytes
+ *
+ *   The choice of hash function is made at run time, but it's the same
+ *   for the life of the process, so hash values stored in maps and in
+ *   arena key tables remain valid.
  */
-typedef enum vnaproperty_token {
-    T_ERROR	= -1,
-    T_EOF,
-    T_HASH,
-    T_PLUS,
-    T_DOT,
-    T_ASSIGN,
-    T_LBRACKET,
-    T_RBRACKET,
-    T_LCURLY,
-    T_RCURLY,
-    T_ID,
-    T_INT
-} vnaproperty_token_t;
+static uint32_t hash_key(const char *key, size_t length)
+{
+#ifdef HAVE_SSE42_CRC32
+    if (__builtin_cpu_supports("sse4.2")) {
+	return hash_sse42(key, length);
+    }
+#endif /* HAVE_SSE42_CRC32 */
+    return hash_portable(key, length);
+}
 
 /*
- * scanner_t: scanner state
+ * map_find_slot: find the slot of key or the empty slot where it belongs
+ *   @vpmp:    pointer to property map structure
+ *   @key:     search key
+ *   @hashval: full 32 bit hash value
+ *
+ * The table uses linear probing and always has at least one empty
+ * slot, so the search terminates.  Return true if the key was found.
+ * In either case, *slotp is set to the index of the slot.
  */
-typedef struct scanner {
-    char               *scn_input;
-    char               *scn_position;
-    char                scn_cur;
-    char               *scn_text;
-    union {
-	int		scn_int;
-    } u;
-    vnaproperty_token_t scn_token;
-} scanner_t;
+static bool map_find_slot(const vnaproperty_map_t *vpmp, size_t *slotp,
+	const char *key, uint32_t hashval)
+{
+    const size_t mask = vpmp->vpm_hash_size - 1;
+    size_t slot;
 
-/*
- * VNAPROPERTY_GETCHAR: advance to the next input character
- */
-#define VNAPROPERTY_GETCHAR(scnp) \
-	((scnp)->scn_cur = *++(scnp)->scn_position)
+    assert(vpmp->vpm_hash_size != 0);
+    for (slot = hashval & mask; ; slot = (slot + 1) & mask) {
+	const vnaproperty_map_slot_t *vmsp = &vpmp->vpm_hash_table[slot];
 
-/*
- * ISIDCHAR1: return true if c can start an identifier
- */
-#define ISIDCHAR1(c) \
-	(isalpha(c) || !isascii(c) || (c) == '_' || (c) == '\\')
+	if (vmsp->vms_element == NULL) {
+	    *slotp = slot;
+	    return false;
+	}
+	if (vmsp->vms_hashval == hashval &&
+		strcmp(key, vmsp->vms_element->vme_pair.vmpr_key) == 0) {
+	    *slotp = slot;
+	    return true;
+	}
+    }
+}
 
 /*
- * ISIDCHAR: return true if c can continue an identifier
+ * map_expand: double the size of the hash table and rehash all elements
+ *   @vpmp: map structure
+ *
+ *   Elements are reinserted from the order list, so the old table is
+ *   simply discarded.
  */
-#define ISIDCHAR(c) \
-	(isalpha(c) || isdigit(c) || !isascii(c) || (c) == ' ' || \
-	 (c) == '_' || (c) == '-' || (c) == '\\')
+static int map_expand(vnaproperty_map_t *vpmp)
+{
+    size_t new_size;
+    vnaproperty_map_slot_t *new_table;
+    vnaproperty_map_element_t *vmep;
+
+    new_size = vpmp->vpm_hash_size != 0 ?
+	2 * vpmp->vpm_hash_size : MAP_MIN_HASH_SIZE;
+    new_table = (vnaproperty_map_slot_t *)_vnamem_amalloc(
+	    vpmp->vpm_base.vpr_allocator,
+	    new_size * sizeof(vnaproperty_map_slot_t));
+    if (new_table == NULL) {
+	return -1;
+    }
+    (void)memset((void *)new_table, 0,
+	    new_size * sizeof(vnaproperty_map_slot_t));
+    if (vpmp->vpm_base.vpr_arena == NULL) {
+	_vnamem_afree(vpmp->vpm_base.vpr_allocator,
+		(void *)vpmp->vpm_hash_table);
+    }
+    vpmp->vpm_hash_table = new_table;
+    vpmp->vpm_hash_size = new_size;
+    for (vmep = vpmp->vpm_order_head; vmep != NULL;
+	    vmep = vmep->vme_order_next) {
+	size_t slot = vmep->vme_hashval & (new_size - 1);
+
+	while (new_table[slot].vms_element != NULL) {
+	    slot = (slot + 1) & (new_size - 1);
+	}
+	new_table[slot].vms_hashval = vmep->vme_hashval;
+	new_table[slot].vms_element = vmep;
+    }
+    return 0;
+}
 
 /*
- * scan: return the next input token
- *   @scnp: scanner state
+ * map_delete_slot: remove an element from the hash table
+ *   @vpmp: map structure
+ *   @slot: index of the slot to empty
+ *
+ *   Rather than leave a tombstone, shift back later members of the
+ *   probe sequence that would no longer be reachable.
  */
-static void scan(scanner_t *scnp)
+static void map_delete_slot(vnaproperty_map_t *vpmp, size_t slot)
 {
+    const size_t mask = vpmp->vpm_hash_size - 1;
+    vnaproperty_map_slot_t *table = vpmp->vpm_hash_table;
+    size_t next = slot;
+
     for (;;) {
-	switch (scnp->scn_cur) {
-	case '\000':
-	    scnp->scn_token = T_EOF;
-	    return;
+	size_t home;
 
-	/*
-	 * Ignore whitespace.
-	 */
-	case '\f':
-	case '\n':
-	case '\r':
-	case '\t':
-	case '\v':
-	case ' ':
-	    VNAPROPERTY_GETCHAR(scnp);
-	    continue;
-
-	/*
-	 * Handle simple tokens.
-	 */
-	case '#':
-	    VNAPROPERTY_GETCHAR(scnp);
-	    scnp->scn_token = T_HASH;
-	    return;
-
-	case '+':
-	    VNAPROPERTY_GETCHAR(scnp);
-	    scnp->scn_token = T_PLUS;
-	    return;
-
-	case '.':
-	    VNAPROPERTY_GETCHAR(scnp);
-	    scnp->scn_token = T_DOT;
-	    return;
-
-	case '=':
-	    VNAPROPERTY_GETCHAR(scnp);
-	    scnp->scn_token = T_ASSIGN;
-	    return;
-
-	case '[':
-	    VNAPROPERTY_GETCHAR(scnp);
-	    scnp->scn_token = T_LBRACKET;
-	    return;
-
-	case ']':
-	    VNAPROPERTY_GETCHAR(scnp);
-	    scnp->scn_token = T_RBRACKET;
-	    return;
-
-	case '{':
-	    VNAPROPERTY_GETCHAR(scnp);
-	    scnp->scn_token = T_LCURLY;
-	    return;
-
-	case '}':
-	    VNAPROPERTY_GETCHAR(scnp);
-	    scnp->scn_token = T_RCURLY;
-	    return;
-
-	default:
+	next = (next + 1) & mask;
+	if (table[next].vms_element == NULL) {
 	    break;
 	}
-
-	/*
-	 * Integers
-	 */
-	if (isdigit(scnp->scn_cur)) {
-	    scnp->scn_text = scnp->scn_position;
-	    do {
-		VNAPROPERTY_GETCHAR(scnp);
-	    } while (isdigit(scnp->scn_cur));
-	    *scnp->scn_position = '\000';
-	    scnp->u.scn_int = strtol(scnp->scn_text, NULL, 10);
-	    scnp->scn_token = T_INT;
-	    return;
-	}
-
-	/*
-	 * Identifiers
-	 */
-	if (ISIDCHAR1(scnp->scn_cur)) {
-	    char *protected = scnp->scn_position;
-	    char *destination = scnp->scn_position;
-
-	    scnp->scn_text = scnp->scn_position;
-	    do {
-		if (scnp->scn_cur == '\\') {
-		    VNAPROPERTY_GETCHAR(scnp);
-		    if (scnp->scn_cur == '\000') {
-			scnp->scn_token = T_ERROR;
-			return;
-		    }
-		    protected = scnp->scn_position;
-		}
-		*destination++ = scnp->scn_cur;
-		VNAPROPERTY_GETCHAR(scnp);
-	    } while (ISIDCHAR(scnp->scn_cur));
-
-	    /*
-	     * Trim trailing spaces.
-	     */
-	    while (&destination[-1] > protected &&
-		    destination[-1] == ' ') {
-		--destination;
-	    }
-	    *destination = '\000';
-	    scnp->scn_token = T_ID;
-	    return;
+	home = table[next].vms_hashval & mask;
+	if (((next - home) & mask) < ((next - slot) & mask)) {
+	    continue;		/* home lies between slot and next */
 	}
+	table[slot] = table[next];
+	slot = next;
+    }
+    table[slot].vms_hashval = 0;
+    table[slot].vms_element = NULL;
+}
 
-	/*
-	 * All other characters are reserved.
-	 */
-	scnp->scn_token = T_ERROR;
-	return;
+/*
+ * map_append_order_element: append to order list
+ *   @vplp: pointer to property map structure
+ *   @vmep: element to append
+ */
+static void map_append_order_element(vnaproperty_map_t *vpmp,
+	vnaproperty_map_element_t *vmep)
+{
+    assert(vmep->vme_order_next == NULL);
+    assert(vmep->vme_order_prev == NULL);
+    if (vpmp->vpm_order_head == NULL) {
+	assert(vpmp->vpm_order_tail == NULL);
+	assert(vpmp->vpm_count == 0);
+	vpmp->vpm_order_head = vmep;
+    } else {
+	assert(vpmp->vpm_order_tail != NULL);
+	assert(vpmp->vpm_count > 0);
+	vmep->vme_order_prev = vpmp->vpm_order_tail;
+	vpmp->vpm_order_tail->vme_order_next = vmep;
     }
+    vpmp->vpm_order_tail = vmep;
 }
 
 /*
- * expr_type_t: expression node type
+ * map_delete_order_element: delete from order list
+ *   @vplp: pointer to property map structure
+ *   @vmep: element to delete
  */
-typedef enum expr_type {
-    E_MAP,				/* {}   */
-    E_MAP_ELEMENT,			/* foo  */
-    E_LIST,				/* []   */
-    E_LIST_ELEMENT,			/* [5]  */
-    E_LIST_INSERT,			/* [5+] */
-    E_LIST_APPEND,			/* [+] */
-    E_DOT				/* .    */
-} expr_type_t;
+static void map_delete_order_element(vnaproperty_map_t *vpmp,
+	vnaproperty_map_element_t *vmep)
+{
+    vnaproperty_map_element_t *prev = vmep->vme_order_prev;
+    vnaproperty_map_element_t *next = vmep->vme_order_next;
+
+    if (prev != NULL) {
+	prev->vme_order_next = next;
+    } else {
+	vpmp->vpm_order_head = next;
+    }
+    if (next != NULL) {
+	next->vme_order_prev = prev;
+    } else {
+	vpmp->vpm_order_tail = prev;
+    }
+}
 
 /*
- * expr_t: expression node
+ * map_alloc: allocate a new map element
+ *   @treep: tree holding the new node
  */
-typedef struct expr {
-    expr_type_t ex_type;		/* expression node type */
-    struct expr *ex_next;		/* next expression node */
-    union {
-	char   *ex_name;		/* key for map element */
-	int     ex_index;		/* index for list element */
-    } u;
-} expr_t;
+static vnaproperty_t *map_alloc(const tree_t *treep)
+{
+    vnaproperty_map_t *vpmp;
+
+    if ((vpmp = _vnamem_amalloc(treep->tr_allocator,
+		    sizeof(vnaproperty_map_t))) == NULL) {
+	return NULL;
+    }
+    (void)memset((void *)vpmp, 0, sizeof(*vpmp));
+    node_init(treep, &vpmp->vpm_base, VNAPROPERTY_MAP);
+    return ((vnaproperty_t *)vpmp);
+}
 
 /*
- * parser_t: parser state
+ * map_count: return the number of items in the map
+ *   @list: pointer to map element
  */
-typedef struct parser {
-    scanner_t		prs_scn;	/* scanner state */
-    expr_t	       *prs_head;	/* expression list head */
-    expr_t	       *prs_tail;	/* expression list tail */
-    vnaproperty_t      *prs_collection;	/* if last elem is map/list */
-} parser_t;
+static int map_count(const vnaproperty_t *map)
+{
+    vnaproperty_map_t *vpmp;
+
+    if (map->vpr_type != VNAPROPERTY_MAP) {
+	errno = EINVAL;
+	return -1;
+    }
+    vpmp = (vnaproperty_map_t *)map;
+    return vpmp->vpm_count;
+}
 
 /*
- * expr_free: free scanner and parser resources
- *   @parser: pointer to parser state structure
+ * map_subtree: return the address of the subtree of key
+ *   @list: pointer to map element
+ *   @add:  insert key if not found
+ *   @key:  search key
  */
-static void parser_free(parser_t *parser)
+static vnaproperty_t **map_subtree(vnaproperty_t *map, bool add,
+	const char *key)
 {
-    while (parser->prs_head != NULL) {
-	expr_t *exp = parser->prs_head;
+    vnaproperty_map_t *vpmp;
+    vnaproperty_map_element_t *vmep;
+    uint32_t hashval;
+    size_t slot;
 
-	parser->prs_head = exp->ex_next;
-	free((void *)exp);
+    if (map->vpr_type != VNAPROPERTY_MAP) {
+	errno = EINVAL;
+	return NULL;
     }
-    free((void *)parser->prs_scn.scn_input);
-    parser->prs_scn.scn_input = NULL;
+    vpmp = (vnaproperty_map_t *)map;
+    if (add && 4 * (vpmp->vpm_count + 1) > 3 * vpmp->vpm_hash_size) {
+	if (map_expand(vpmp) == -1) {
+	    return NULL;
+	}
+    }
+    if (vpmp->vpm_count == 0 && !add) {
+	errno = ENOENT;
+	return NULL;
+    }
+    hashval = hash_key(key, strlen(key));
+    if (map_find_slot(vpmp, &slot, key, hashval)) {
+	vmep = vpmp->vpm_hash_table[slot].vms_element;
+	return &vmep->vme_pair.vmpr_value;
+    }
+    if (!add) {
+	errno = ENOENT;
+	return NULL;
+    }
+    if ((vmep = _vnamem_amalloc(map->vpr_allocator,
+		    sizeof(vnaproperty_map_element_t))) == NULL) {
+	return NULL;
+    }
+    (void)memset((void *)vmep, 0, sizeof(*vmep));
+    if (map->vpr_arena != NULL) {
+	vmep->vme_pair.vmpr_key = arena_intern_key(map->vpr_arena,
+		key, hashval);
+    } else {
+	vmep->vme_pair.vmpr_key = _vnamem_astrdup(map->vpr_allocator, key);
+    }
+    if (vmep->vme_pair.vmpr_key == NULL) {
+	if (map->vpr_arena == NULL) {
+	    _vnamem_afree(map->vpr_allocator, (void *)vmep);
+	}
+	return NULL;
+    }
+    vmep->vme_magic = VNAPROPERTY_MAP_PAIR_ELEMENT_MAGIC;
+    vmep->vme_hashval = hashval;
+    vpmp->vpm_hash_table[slot].vms_hashval = hashval;
+    vpmp->vpm_hash_table[slot].vms_element = vmep;
+    map_append_order_element(vpmp, vmep);
+    ++vpmp->vpm_count;
+    return &vmep->vme_pair.vmpr_value;
 }
 
 /*
- * parse: parse a property expression and return expression list
- *   @parser: address of caller-allocated parser state structure
- *   @result: address of vnaproperty_t pointer to receive result
- *   @format: sprintf format
- *   @ap:     variable argument pointer
- *
- *   On success, *exp_anchor is a linked list of expression nodes
- *   representing the given expression in left-to-right order.
+ * map_delete: delete the element with given key
+ *   @list: pointer to map element
+ *   @key: search key
  */
-static int parse(parser_t *parser,
-	const char *format, va_list ap)
+static int map_delete(vnaproperty_t *map, const char *key)
 {
-    scanner_t *scanner = &parser->prs_scn;
-    expr_t *exp, **expp;
-    int state;
+    vnaproperty_map_t *vpmp;
+    vnaproperty_map_element_t *vmep;
+    uint32_t hashval;
+    size_t slot;
 
-    /*
-     * Init the parser and format the user's arguments.
-     */
-    (void)memset((void *)parser, 0, sizeof(*parser));
-    if (vasprintf(&scanner->scn_input, format, ap) == -1) {
+    if (map->vpr_type != VNAPROPERTY_MAP) {
+	errno = EINVAL;
 	return -1;
     }
-    scanner->scn_position = scanner->scn_input;
+    vpmp = (vnaproperty_map_t *)map;
+    if (vpmp->vpm_count == 0) {
+	errno = ENOENT;
+	return -1;
+    }
+    hashval = hash_key(key, strlen(key));
+    if (!map_find_slot(vpmp, &slot, key, hashval)) {
+	errno = ENOENT;
+	return -1;
+    }
+    vmep = vpmp->vpm_hash_table[slot].vms_element;
+    assert(vpmp->vpm_count > 0);
+    map_delete_order_element(vpmp, vmep);
+    map_delete_slot(vpmp, slot);
+    vnaproperty_free((vnaproperty_t *)vmep->vme_pair.vmpr_value);
+    if (map->vpr_arena == NULL) {
+	_vnamem_afree(map->vpr_allocator, (void *)vmep->vme_pair.vmpr_key);
+	memset((void *)vmep, 'X', sizeof(*vmep));
+	_vnamem_afree(map->vpr_allocator, (void *)vmep);
+    }
+    --vpmp->vpm_count;
+    if (vpmp->vpm_count == 0) {
+	assert(vpmp->vpm_order_head == NULL);
+	assert(vpmp->vpm_order_tail == NULL);
+    } else {
+	assert(vpmp->vpm_order_head != NULL);
+	assert(vpmp->vpm_order_tail != NULL);
+    }
+    return 0;
+}
+
+
+/***********************************************************************
+ * Lists
+ **********************************************************************/
+
+/*
+ * list_check_allocation: extend allocation to >= size
+ *   @vplp: pointer to property list structure
+ *   @size: needed size
+ */
+static int list_check_allocation(vnaproperty_list_t *vplp, size_t size)
+{
+    size_t new_allocation;
+    vnaproperty_t **new_vector = NULL;
+
+    /* If there's already enough, return. */
+    if (size <= vplp->vpl_allocation)
+	return 0;
+
+    /*
+     * Find the next power of 2 allocation higher than size.
+     */
+    new_allocation = MAX(8, vplp->vpl_allocation);
+    while (new_allocation <= size) {
+	new_allocation <<= 1;
+	if (new_allocation == 0) {
+	    errno = EINVAL;
+	    return -1;
+	}
+    }
+
+    /* Realloc */
+    if ((new_vector = _vnamem_arealloc(vplp->vpl_base.vpr_allocator,
+		    vplp->vpl_vector, new_allocation *
+		    sizeof(vnaproperty_t *))) == NULL) {
+	return -1;
+    }
+    (void)memset((void *)&new_vector[vplp->vpl_allocation], 0,
+		 (new_allocation - vplp->vpl_allocation) *
+		 sizeof(vnaproperty_t *));
+    vplp->vpl_vector = new_vector;
+    vplp->vpl_allocation = new_allocation;
+    return 0;
+}
+
+/*
+ * list_alloc: allocate a new list element
+ *   @treep: tree holding the new node
+ */
+static vnaproperty_t *list_alloc(const tree_t *treep)
+{
+    vnaproperty_list_t *vplp;
+
+    if ((vplp = _vnamem_amalloc(treep->tr_allocator,
+		    sizeof(vnaproperty_list_t))) == NULL) {
+	return NULL;
+    }
+    (void)memset((void *)vplp, 0, sizeof(*vplp));
+    node_init(treep, &vplp->vpl_base, VNAPROPERTY_LIST);
+
+    return ((vnaproperty_t *)vplp);
+}
+
+/*
+ * list_count: return the number of items in the list
+ *   @list: pointer to list element
+ */
+static int list_count(const vnaproperty_t *list)
+{
+    vnaproperty_list_t *vplp;
+
+    if (list->vpr_type != VNAPROPERTY_LIST) {
+	errno = EINVAL;
+	return -1;
+    }
+    vplp = (vnaproperty_list_t *)list;
+    return vplp->vpl_length;
+}
+
+/*
+ * list_subtree: return address of subtree at given index
+ *   @list:  pointer to list element
+ *   @add:   add elements to list if needed
+ *   @index: index into list
+ */
+static vnaproperty_t **list_subtree(vnaproperty_t *list,
+	bool add, int index)
+{
+    vnaproperty_list_t *vplp;
+
+    if (list->vpr_type != VNAPROPERTY_LIST || index < 0) {
+	errno = EINVAL;
+	return NULL;
+    }
+    vplp = (vnaproperty_list_t *)list;
+    if (index >= vplp->vpl_length) {	/* extend case */
+	if (!add) {
+	    errno = ENOENT;
+	    return NULL;
+	}
+	if (list_check_allocation(vplp, index + 1) == -1) {
+	    return NULL;
+	}
+	vplp->vpl_length = index + 1;
+    }
+    return &vplp->vpl_vector[index];
+}
+
+/*
+ * list_insert: insert null element at index and return address
+ *   @list: pointer to list element
+ *   @index: index where element should be inserted
+ *
+ * Index must be in 0..N where N is the number of elements in the list.
+ */
+static vnaproperty_t **list_insert(vnaproperty_t *list, int index)
+{
+    vnaproperty_list_t *vplp;
+
+    if (list->vpr_type != VNAPROPERTY_LIST || index < 0) {
+	errno = EINVAL;
+	return NULL;
+    }
+    vplp = (vnaproperty_list_t *)list;
+    if (index >= vplp->vpl_length) {
+	return list_subtree(list, /*add*/true, index);
+    }
+    if (list_check_allocation(vplp, vplp->vpl_length + 1) == -1) {
+	return NULL;
+    }
+    (void)memmove((void *)&vplp->vpl_vector[index + 1],
+		  (void *)&vplp->vpl_vector[index],
+		  (vplp->vpl_length - index) * sizeof(vnaproperty_t *));
+    vplp->vpl_vector[index] = NULL;
+    ++vplp->vpl_length;
+
+    return &vplp->vpl_vector[index];
+}
+
+/*
+ * list_append: append null element and return address
+ *   @list: pointer to list element
+ */
+static vnaproperty_t **list_append(vnaproperty_t *list)
+{
+    vnaproperty_list_t *vplp;
+    vnaproperty_t **result;
+
+    if (list->vpr_type != VNAPROPERTY_LIST) {
+	errno = EINVAL;
+	return NULL;
+    }
+    vplp = (vnaproperty_list_t *)list;
+    if (list_check_allocation(vplp, vplp->vpl_length + 1) == -1) {
+	return NULL;
+    }
+    *(result = &vplp->vpl_vector[vplp->vpl_length++]) = NULL;
+
+    return result;
+}
+
+/*
+ * list_delete: delete the element at the given index
+ *   @list: pointer to list element
+ *   @index: index of element to delete
+ */
+static int list_delete(vnaproperty_t *list, int index)
+{
+    vnaproperty_list_t *vplp;
+
+    if (list->vpr_type != VNAPROPERTY_LIST || index < 0) {
+	errno = EINVAL;
+	return -1;
+    }
+    vplp = (vnaproperty_list_t *)list;
+    if (index >= vplp->vpl_length) {
+	errno = ENOENT;
+	return -1;
+    }
+    (void)memmove((void *)&vplp->vpl_vector[index],
+		  (void *)&vplp->vpl_vector[index + 1],
+		  (vplp->vpl_length - index) * sizeof(vnaproperty_t *));
+    vplp->vpl_vector[--vplp->vpl_length] = NULL;
+    return 0;
+}
+
+
+/***********************************************************************
+ * Property Scanner & Parser
+ **********************************************************************/
+
+/*
+ * vnaproperty_token_t: tokens returned by the scanner
+ */
+typedef enum vnaproperty_token {
+    T_ERROR	= -1,
+    T_EOF,
+    T_HASH,
+    T_PLUS,
+    T_DOT,
+    T_ASSIGN,
+    T_LBRACKET,
+    T_RBRACKET,
+    T_LCURLY,
+    T_RCURLY,
+    T_ID,
+    T_INT,
+    T_ARG_INT,		/* %d in a compiled path */
+    T_ARG_KEY		/* %s in a compiled path */
+} vnaproperty_token_t;
+
+/*
+ * scanner_t: scanner state
+ */
+typedef struct scanner {
+    char               *scn_input;
+    char               *scn_position;
+    char                scn_cur;
+    char               *scn_text;
+    union {
+	int		scn_int;
+    } u;
+    vnaproperty_token_t scn_token;
+    bool		scn_pattern;	/* accept %d and %s placeholders */
+} scanner_t;
+
+/*
+ * VNAPROPERTY_GETCHAR: advance to the next input character
+ */
+#define VNAPROPERTY_GETCHAR(scnp) \
+	((scnp)->scn_cur = *++(scnp)->scn_position)
+
+/*
+ * ISIDCHAR1: return true if c can start an identifier
+ */
+#define ISIDCHAR1(c) \
+	(isalpha(c) || !isascii(c) || (c) == '_' || (c) == '\\')
+
+/*
+ * ISIDCHAR: return true if c can continue an identifier
+ */
+#define ISIDCHAR(c) \
+	(isalpha(c) || isdigit(c) || !isascii(c) || (c) == ' ' || \
+	 (c) == '_' || (c) == '-' || (c) == '\\')
+
+/*
+ * scan: return the next input token
+ *   @scnp: scanner state
+ */
+static void scan(scanner_t *scnp)
+{
+    for (;;) {
+	switch (scnp->scn_cur) {
+	case '\000':
+	    scnp->scn_token = T_EOF;
+	    return;
+
+	/*
+	 * Ignore whitespace.
+	 */
+	case '\f':
+	case '\n':
+	case '\r':
+	case '\t':
+	case '\v':
+	case ' ':
+	    VNAPROPERTY_GETCHAR(scnp);
+	    continue;
+
+	/*
+	 * Handle simple tokens.
+	 */
+	case '#':
+	    VNAPROPERTY_GETCHAR(scnp);
+	    scnp->scn_token = T_HASH;
+	    return;
+
+	case '+':
+	    VNAPROPERTY_GETCHAR(scnp);
+	    scnp->scn_token = T_PLUS;
+	    return;
+
+	case '.':
+	    VNAPROPERTY_GETCHAR(scnp);
+	    scnp->scn_token = T_DOT;
+	    return;
+
+	case '=':
+	    VNAPROPERTY_GETCHAR(scnp);
+	    scnp->scn_token = T_ASSIGN;
+	    return;
+
+	case '[':
+	    VNAPROPERTY_GETCHAR(scnp);
+	    scnp->scn_token = T_LBRACKET;
+	    return;
+
+	case ']':
+	    VNAPROPERTY_GETCHAR(scnp);
+	    scnp->scn_token = T_RBRACKET;
+	    return;
+
+	case '{':
+	    VNAPROPERTY_GETCHAR(scnp);
+	    scnp->scn_token = T_LCURLY;
+	    return;
+
+	case '}':
+	    VNAPROPERTY_GETCHAR(scnp);
+	    scnp->scn_token = T_RCURLY;
+	    return;
+
+	/*
+	 * Placeholders in compiled paths.
+	 */
+	case '%':
+	    if (!scnp->scn_pattern) {
+		scnp->scn_token = T_ERROR;
+		return;
+	    }
+	    VNAPROPERTY_GETCHAR(scnp);
+	    switch (scnp->scn_cur) {
+	    case 'd':
+		scnp->scn_token = T_ARG_INT;
+		break;
+
+	    case 's':
+		scnp->scn_token = T_ARG_KEY;
+		break;
+
+	    default:
+		scnp->scn_token = T_ERROR;
+		return;
+	    }
+	    VNAPROPERTY_GETCHAR(scnp);
+	    return;
+
+	default:
+	    break;
+	}
+
+	/*
+	 * Integers
+	 */
+	if (isdigit(scnp->scn_cur)) {
+	    scnp->scn_text = scnp->scn_position;
+	    do {
+		VNAPROPERTY_GETCHAR(scnp);
+	    } while (isdigit(scnp->scn_cur));
+	    *scnp->scn_position = '\000';
+	    scnp->u.scn_int = strtol(scnp->scn_text, NULL, 10);
+	    scnp->scn_token = T_INT;
+	    return;
+	}
+
+	/*
+	 * Identifiers
+	 */
+	if (ISIDCHAR1(scnp->scn_cur)) {
+	    char *protected = scnp->scn_position;
+	    char *destination = scnp->scn_position;
+
+	    scnp->scn_text = scnp->scn_position;
+	    do {
+		if (scnp->scn_cur == '\\') {
+		    VNAPROPERTY_GETCHAR(scnp);
+		    if (scnp->scn_cur == '\000') {
+			scnp->scn_token = T_ERROR;
+			return;
+		    }
+		    protected = scnp->scn_position;
+		}
+		*destination++ = scnp->scn_cur;
+		VNAPROPERTY_GETCHAR(scnp);
+	    } while (ISIDCHAR(scnp->scn_cur));
+
+	    /*
+	     * Trim trailing spaces.
+	     */
+	    while (&destination[-1] > protected &&
+		    destination[-1] == ' ') {
+		--destination;
+	    }
+	    *destination = '\000';
+	    scnp->scn_token = T_ID;
+	    return;
+	}
+
+	/*
+	 * All other characters are reserved.
+	 */
+	scnp->scn_token = T_ERROR;
+	return;
+    }
+}
+
+/*
+ * expr_type_t: expression node type
+ */
+typedef enum expr_type {
+    E_MAP,				/* {}   */
+    E_MAP_ELEMENT,			/* foo  */
+    E_LIST,				/* []   */
+    E_LIST_ELEMENT,			/* [5]  */
+    E_LIST_INSERT,			/* [5+] */
+    E_LIST_APPEND,			/* [+] */
+    E_DOT				/* .    */
+} expr_type_t;
+
+/*
+ * expr_t: expression node
+ */
+typedef struct expr {
+    expr_type_t ex_type;		/* expression node type */
+    bool ex_arg;			/* name or index is an argument */
+    struct expr *ex_next;		/* next expression node */
+    union {
+	char   *ex_name;		/* key for map element */
+	int     ex_index;		/* index for list element */
+    } u;
+} expr_t;
+
+/*
+ * descent_t: where descend stopped
+ */
+typedef struct descent {
+    vnaproperty_t      *dsc_collection;	/* if last elem is map/list */
+    const char	       *dsc_name;	/* key of last map element */
+    int			dsc_index;	/* index of last list element */
+    tree_t		dsc_tree;	/* tree for new nodes */
+} descent_t;
+
+/*
+ * parser_t: parser state
+ */
+typedef struct parser {
+    scanner_t		prs_scn;	/* scanner state */
+    expr_t	       *prs_head;	/* expression list head */
+    expr_t	       *prs_tail;	/* expression list tail */
+    descent_t		prs_descent;	/* where descend stopped */
+} parser_t;
+
+/*
+ * expr_free: free scanner and parser resources
+ *   @parser: pointer to parser state structure
+ */
+static void parser_free(parser_t *parser)
+{
+    while (parser->prs_head != NULL) {
+	expr_t *exp = parser->prs_head;
+
+	parser->prs_head = exp->ex_next;
+	_vnamem_free((void *)exp);
+    }
+    _vnamem_free((void *)parser->prs_scn.scn_input);
+    parser->prs_scn.scn_input = NULL;
+}
+
+/*
+ * parse_input: parse the text in scn_input and build the expression list
+ *   @parser: parser state with scn_input and scn_pattern set
+ *
+ *   On success, prs_head is a linked list of expression nodes
+ *   representing the given expression in left-to-right order.
+ */
+static int parse_input(parser_t *parser)
+{
+    scanner_t *scanner = &parser->prs_scn;
+    expr_t *exp, **expp;
+    int state;
+
+    scanner->scn_position = scanner->scn_input;
     scanner->scn_cur = scanner->scn_input[0];
     expp = &parser->prs_head;
     exp = NULL;
     scan(scanner);
 
     /*
-     * LL(1) Grammar
-     *
-     * expr is the starting state
-     * [token] means the token is left on the input
-     *
-     * expr		: T_DOT dot			// .
-     *			| [T_ID] map_element		// abc
-     *			| T_LBRACKET subscript		// [5], [5+], [+], []
-     *			| [T_LCURLY] abstract_map	// {}
-     *			;
-     *
-     * dot		: [T_ID] map_element		// .abc
-     *			| T_LBRACKET subscript		// .[5], .[5+], etc
-     *			| [T_LCURLY] abstract_map	// .{}
-     *			| final_dot			// accepting
-     *			;
-     *
-     * chain		: T_DOT dot			// foo.
-     *			| T_LBRACKET subscript		// foo.bar[5]
-     *			| [T_LCURLY] abstract_map	// foo.bar{}
-     *			| λ				// accepting
-     *			;
-     *
-     * subscript	: T_INT list_element		// 5], 5+]
-     *			| T_PLUS list_append		// +]
-     *			| [T_RBRACKET] abstract_list	// ]
-     *			;
-     *
-     * map_element	: T_ID chain			// foo
-     *			;
-     *
-     * list_element	: T_PLUS list_insert		// 5+]
-     *			| T_RBRACKET chain		// 5]
-     *			;
-     *
-     * list_insert	: T_RBRACKET chain		// 5+]
-     *			;
-     *
-     * list_append	: T_RBRACKET chain		// +]
-     *			;
-     *
-     * final_dot	: λ
-     *			;
-     *
-     * abstract_map	: T_LCURLY T_RCURLY
-     *			;
-     *
-     * abstract_list	: T_RBRACKET
-     *			;
-     *
-     * The language is regular, so we parse it simply using Duff's device.
+     * LL(1) Grammar
+     *
+     * expr is the starting state
+     * [token] means the token is left on the input
+     *
+     * expr		: T_DOT dot			// .
+     *			| [T_ID] map_element		// abc
+     *			| T_LBRACKET subscript		// [5], [5+], [+], []
+     *			| [T_LCURLY] abstract_map	// {}
+     *			;
+     *
+     * dot		: [T_ID] map_element		// .abc
+     *			| T_LBRACKET subscript		// .[5], .[5+], etc
+     *			| [T_LCURLY] abstract_map	// .{}
+     *			| final_dot			// accepting
+     *			;
+     *
+     * chain		: T_DOT dot			// foo.
+     *			| T_LBRACKET subscript		// foo.bar[5]
+     *			| [T_LCURLY] abstract_map	// foo.bar{}
+     *			| λ				// accepting
+     *			;
+     *
+     * subscript	: T_INT list_element		// 5], 5+]
+     *			| T_PLUS list_append		// +]
+     *			| [T_RBRACKET] abstract_list	// ]
+     *			;
+     *
+     * map_element	: T_ID chain			// foo
+     *			;
+     *
+     * list_element	: T_PLUS list_insert		// 5+]
+     *			| T_RBRACKET chain		// 5]
+     *			;
+     *
+     * list_insert	: T_RBRACKET chain		// 5+]
+     *			;
+     *
+     * list_append	: T_RBRACKET chain		// +]
+     *			;
+     *
+     * final_dot	: λ
+     *			;
+     *
+     * abstract_map	: T_LCURLY T_RCURLY
+     *			;
+     *
+     * abstract_list	: T_RBRACKET
+     *			;
+     *
+     * In a compiled path, T_ARG_KEY (%s) may appear wherever T_ID may,
+     * and T_ARG_INT (%d) wherever T_INT may.
+     *
+     * The language is regular, so we parse it simply using Duff's device.
+     */
+    state = 0;
+    for (;;) {
+	switch (state) {
+	case 0:
+	    /*
+	     * expr	: T_DOT dot
+	     *		| [T_ID] map_element
+	     *		| T_LBRACKET subscript
+	     *		| [T_LCURLY] abstract_map
+	     *		;
+	     */
+	    switch (scanner->scn_token) {
+	    case T_DOT:
+		scan(scanner);
+		state = 1;
+		continue;
+
+	    case T_ID:
+	    case T_ARG_KEY:
+		goto map_element;
+
+	    case T_LBRACKET:
+		scan(scanner);
+		state = 3;
+		continue;
+
+	    case T_LCURLY:
+		goto abstract_map;
+
+	    default:
+		goto error;				/* NOT accepting */
+	    }
+	    break;
+
+	case 1:
+	    /*
+	     * dot	: [T_ID] map_element
+	     *		| T_LBRACKET subscript
+	     *		| [T_LCURLY] abstract_map
+	     *		| [default]  final_dot
+	     *		;
+	     */
+	    switch (scanner->scn_token) {
+	    case T_ID:
+	    case T_ARG_KEY:
+		goto map_element;
+
+	    case T_LBRACKET:
+		scan(scanner);
+		state = 3;
+		continue;
+
+	    case T_LCURLY:
+		goto abstract_map;
+
+	    default:
+		goto final_dot;				/* accepting state */
+	    }
+	    break;
+
+	case 2:
+	    /*
+	     * chain	: T_DOT dot
+	     *		| T_LBRACKET subscript
+	     *		| [T_LCURLY] abstract_map
+	     *		| λ
+	     *		;
+	     */
+	    switch (scanner->scn_token) {
+	    case T_DOT:
+		scan(scanner);
+		state = 1;
+		continue;
+
+	    case T_LBRACKET:
+		scan(scanner);
+		state = 3;
+		continue;
+
+	    case T_LCURLY:
+		goto abstract_map;
+
+	    default:
+		break;					/* accepting state */
+	    }
+	    break;
+
+	case 3:
+	    /*
+	     * subscript	: T_INT list_element
+	     *			| T_PLUS list_append
+	     *			| [T_RBRACKET] abstract_list
+	     *			;
+	     */
+	    switch (scanner->scn_token) {
+	    case T_INT:
+	    case T_ARG_INT:
+		goto list_element;
+
+	    case T_PLUS:
+		goto list_append;
+
+	    case T_RBRACKET:
+		goto abstract_list;
+
+	    default:
+		goto error;				/* NOT accepting */
+	    }
+	    break;
+
+	map_element:
+	    /*
+	     * map_element	: T_ID chain ;
+	     */
+	    assert(scanner->scn_token == T_ID ||
+		   scanner->scn_token == T_ARG_KEY);
+	    if ((exp = _vnamem_malloc(sizeof(expr_t))) == NULL) {
+		goto error;
+	    }
+	    (void)memset((void *)exp, 0, sizeof(expr_t));
+	    exp->ex_type = E_MAP_ELEMENT;
+	    if (scanner->scn_token == T_ARG_KEY) {
+		exp->ex_arg = true;
+	    } else {
+		exp->u.ex_name = scanner->scn_text;
+	    }
+	    exp->ex_next = NULL;
+	    *expp = exp;
+	    expp = &exp->ex_next;
+	    scan(scanner);
+	    state = 2;
+	    continue;
+
+	list_element:	/* and list_insert */
+	    /*
+	     * list_element	: T_PLUS list_insert
+	     *			| T_RBRACKET chain
+	     *			;
+	     *
+	     * list_insert	: T_RBRACKET chain
+	     *			;
+	     */
+	    assert(scanner->scn_token == T_INT ||
+		   scanner->scn_token == T_ARG_INT);
+	    if ((exp = _vnamem_malloc(sizeof(expr_t))) == NULL) {
+		goto error;
+	    }
+	    (void)memset((void *)exp, 0, sizeof(expr_t));
+	    exp->ex_type = E_LIST_ELEMENT;
+	    if (scanner->scn_token == T_ARG_INT) {
+		exp->ex_arg = true;
+	    } else {
+		exp->u.ex_index = scanner->u.scn_int;
+	    }
+	    scan(scanner);
+	    if (scanner->scn_token == T_PLUS) {
+		exp->ex_type = E_LIST_INSERT;
+		scan(scanner);
+	    }
+	    *expp = exp;
+	    expp = &exp->ex_next;
+	    if (scanner->scn_token != T_RBRACKET) {
+		errno = EINVAL;
+		goto error;
+	    }
+	    scan(scanner);
+	    state = 2;
+	    continue;
+
+	list_append:
+	    /*
+	     * list_append	: T_RBRACKET chain
+	     */
+	    assert(scanner->scn_token == T_PLUS);
+	    if ((exp = _vnamem_malloc(sizeof(expr_t))) == NULL) {
+		goto error;
+	    }
+	    (void)memset((void *)exp, 0, sizeof(expr_t));
+	    exp->ex_type = E_LIST_APPEND;
+	    *expp = exp;
+	    expp = &exp->ex_next;
+	    scan(scanner);
+	    if (scanner->scn_token != T_RBRACKET) {
+		errno = EINVAL;
+		goto error;
+	    }
+	    scan(scanner);
+	    state = 2;
+	    continue;
+
+	final_dot:
+	    /*
+	     * final_dot	: λ ;
+	     */
+	    if ((exp = _vnamem_malloc(sizeof(expr_t))) == NULL) {
+		goto error;
+	    }
+	    (void)memset((void *)exp, 0, sizeof(expr_t));
+	    exp->ex_type = E_DOT;
+	    exp->ex_next = NULL;
+	    *expp = exp;
+	    expp = &exp->ex_next;
+	    break;
+
+	abstract_map:
+	    /*
+	     * abstract_map	: T_LCURLY T_RCURLY ;
+	     */
+	    assert(scanner->scn_token == T_LCURLY);
+	    scan(scanner);
+	    if (scanner->scn_token != T_RCURLY) {
+		goto error;
+	    }
+	    scan(scanner);
+	    if ((exp = _vnamem_malloc(sizeof(expr_t))) == NULL) {
+		goto error;
+	    }
+	    (void)memset((void *)exp, 0, sizeof(expr_t));
+	    exp->ex_type = E_MAP;
+	    exp->ex_next = NULL;
+	    *expp = exp;
+	    expp = &exp->ex_next;
+	    break;
+
+	abstract_list:
+	    /*
+	     * abstract_list	: T_RBRACKET ;
+	     */
+	    assert(scanner->scn_token == T_RBRACKET);
+	    scan(scanner);
+	    if ((exp = _vnamem_malloc(sizeof(expr_t))) == NULL) {
+		goto error;
+	    }
+	    (void)memset((void *)exp, 0, sizeof(expr_t));
+	    exp->ex_type = E_LIST;
+	    exp->ex_next = NULL;
+	    *expp = exp;
+	    expp = &exp->ex_next;
+	    break;
+	}
+	break;
+    }
+    parser->prs_tail = exp;
+    return 0;
+
+error:
+    parser_free(parser);
+    errno = EINVAL;
+    return -1;
+}
+
+/*
+ * parse: parse a property expression and return expression list
+ *   @parser: address of caller-allocated parser state structure
+ *   @format: sprintf format
+ *   @ap:     variable argument pointer
+ */
+static int parse(parser_t *parser,
+	const char *format, va_list ap)
+{
+    /*
+     * Init the parser and format the user's arguments.
+     */
+    (void)memset((void *)parser, 0, sizeof(*parser));
+    if (_vnamem_vasprintf(&parser->prs_scn.scn_input, format, ap) == -1) {
+	return -1;
+    }
+    return parse_input(parser);
+}
+
+
+/***********************************************************************
+ * Internal Tree Operations
+ **********************************************************************/
+
+/*
+ * descend: follow an expression list down the tree
+ *   @rootptr: address of property data root
+ *   @vmap:    allocator if we start a new tree, or NULL for global
+ *   @head:    expression list
+ *   @set:     force the tree to conform to the indicated expression
+ *   @app:     address of arguments for placeholders, or NULL
+ *   @dscp:    address of structure to receive where we stopped
+ */
+static vnaproperty_t **descend(vnaproperty_t **rootptr,
+	const vnamem_allocator_t *vmap, const expr_t *head, bool set,
+	va_list *app, descent_t *dscp)
+{
+    vnaproperty_t **anchor = rootptr;
+    vnaproperty_t *node = *anchor;
+    tree_t tree;
+    vnaproperty_t *collection = NULL;
+    const char *name = NULL;
+    int index = 0;
+
+    tree_init(&tree, node, vmap);
+    node = REAL_NODE(node);
+    for (const expr_t *exp = head; exp != NULL; exp = exp->ex_next) {
+	collection = NULL;
+	if (exp->ex_type == E_MAP_ELEMENT) {
+	    name = exp->ex_arg ? va_arg(*app, const char *) : exp->u.ex_name;
+	    if (name == NULL) {
+		errno = EINVAL;
+		return NULL;
+	    }
+	} else if (exp->ex_type == E_LIST_ELEMENT ||
+		exp->ex_type == E_LIST_INSERT) {
+	    index = exp->ex_arg ? va_arg(*app, int) : exp->u.ex_index;
+	}
+	if (exp->ex_type == E_DOT) {
+	    assert(exp->ex_next == NULL);
+	    break;
+	}
+	switch (exp->ex_type) {
+	case E_MAP:
+	case E_MAP_ELEMENT:
+	    if (node == NULL) {
+		if (!set) {
+		    errno = ENOENT;
+		    goto error;
+		}
+		if ((node = map_alloc(&tree)) == NULL) {
+		    goto error;
+		}
+		*anchor = node;
+
+	    } else if (node->vpr_type != VNAPROPERTY_MAP) {
+		if (!set) {
+		    node = NULL;
+		    errno = EINVAL;
+		    goto error;
+		}
+		vnaproperty_free(node);
+		*anchor = node = NULL;
+		if ((node = map_alloc(&tree)) == NULL) {
+		    goto error;
+		}
+		*anchor = node;
+	    }
+	    if (exp->ex_type == E_MAP) {
+		assert(exp->ex_next == NULL);
+		break;
+	    }
+	    collection = node;
+	    if ((anchor = map_subtree(node, set, name)) == NULL) {
+		goto error;
+	    }
+	    node = REAL_NODE(*anchor);
+	    continue;
+
+	case E_LIST:
+	case E_LIST_ELEMENT:
+	case E_LIST_INSERT:
+	case E_LIST_APPEND:
+	    if (node == NULL) {
+		if (!set) {
+		    errno = ENOENT;
+		    goto error;
+		}
+		if ((node = list_alloc(&tree)) == NULL) {
+		    goto error;
+		}
+		*anchor = node;
+
+	    } else if (node->vpr_type != VNAPROPERTY_LIST) {
+		if (!set) {
+		    node = NULL;
+		    errno = EINVAL;
+		    goto error;
+		}
+		vnaproperty_free(node);
+		*anchor = node = NULL;
+		if ((node = list_alloc(&tree)) == NULL) {
+		    goto error;
+		}
+		*anchor = node;
+	    }
+	    switch (exp->ex_type) {
+	    case E_LIST:
+		assert(exp->ex_next == NULL);
+		break;
+
+	    case E_LIST_ELEMENT:
+		collection = node;
+		if ((anchor = list_subtree(node, set, index)) == NULL) {
+		    goto error;
+		}
+		node = REAL_NODE(*anchor);
+		continue;
+
+	    case E_LIST_INSERT:
+		if (!set) {
+		    errno = EINVAL;
+		    goto error;
+		}
+		collection = node;
+		if ((anchor = list_insert(node, index)) == NULL) {
+		    goto error;
+		}
+		node = REAL_NODE(*anchor);
+		continue;
+
+	    case E_LIST_APPEND:
+		if (!set) {
+		    errno = EINVAL;
+		    goto error;
+		}
+		collection = node;
+		if ((anchor = list_append(node)) == NULL) {
+		    goto error;
+		}
+		node = REAL_NODE(*anchor);
+		continue;
+
+	    default:
+		abort();
+	    }
+	    break;
+
+	default:
+	    abort();
+	}
+    }
+    if (set && *anchor == NULL) {
+	*anchor = null_node(tree.tr_arena);
+    }
+    dscp->dsc_collection = collection;
+    dscp->dsc_name = name;
+    dscp->dsc_index = index;
+    dscp->dsc_tree = tree;
+    return anchor;
+
+error:
+    return NULL;
+}
+
+/*
+ * parse_and_descend: parse the expression and descend down the tree
+ *   @parser:  address of caller-allocated parser state structure
+ *   @rootptr: address of property data root
+ *   @vmap:    allocator if we start a new tree, or NULL for global
+ *   @set:     force the tree to conform to the indicated expression
+ *   @format:  printf-like format string forming the property expression
+ *   @ap       variable argument pointer
+ */
+static vnaproperty_t **parse_and_descend(parser_t *parser,
+	vnaproperty_t **rootptr, const vnamem_allocator_t *vmap, bool set,
+	const char *format, va_list ap)
+{
+    vnaproperty_t **anchor;
+
+    if (parse(parser, format, ap) == -1) {
+	return NULL;
+    }
+    if ((anchor = descend(rootptr, vmap, parser->prs_head, set, NULL,
+		    &parser->prs_descent)) == NULL) {
+	parser_free(parser);
+	return NULL;
+    }
+    return anchor;
+}
+
+/*
+ * get_node: parse the expression and return the indicated node
+ *   @root:   property data root (can be NULL)
+ *   @format: printf-like format string forming the property expression
+ *   @ap:     variable argument pointer
+ */
+static const vnaproperty_t *get_node(const vnaproperty_t *root,
+	const char *format, va_list ap)
+{
+    parser_t parser;
+    scanner_t *scanner = &parser.prs_scn;
+    vnaproperty_t **anchor;
+
+    /*
+     * Parse the expression and descend to the requested node.
+     */
+    if ((anchor = parse_and_descend(&parser, (vnaproperty_t **)&root, NULL,
+		    /*set*/false, format, ap)) == NULL) {
+	return NULL;
+    }
+
+    /*
+     * Make sure there are no unexpected tokens at the end of line.
+     */
+    if (scanner->scn_token != T_EOF) {
+	errno = EINVAL;
+	parser_free(&parser);
+	return NULL;
+    }
+
+    parser_free(&parser);
+    return REAL_NODE(*anchor);
+}
+
+/*
+ * vnaproperty_free: free the given tree
+ *   @root: pointer to tree to free
+ */
+static void vnaproperty_free(vnaproperty_t *root)
+{
+    const vnamem_allocator_t *allocator;
+
+    /*
+     * Nodes in arenas are released all at once with the arena.
+     */
+    if (root == NULL || root->vpr_arena != NULL)
+	return;
+
+    allocator = root->vpr_allocator;
+
+    assert(root->vpr_type == VNAPROPERTY_SCALAR ||
+	   root->vpr_type == VNAPROPERTY_LIST   ||
+	   root->vpr_type == VNAPROPERTY_MAP);
+    switch (root->vpr_type) {
+    case VNAPROPERTY_SCALAR:
+	{
+	    vnaproperty_scalar_t *vpsp = (vnaproperty_scalar_t *)root;
+	    _vnamem_afree(allocator, (void *)vpsp->vps_value);
+	    (void)memset((void *)vpsp, 'X', sizeof(*vpsp));
+	}
+	break;
+
+    case VNAPROPERTY_LIST:
+	{
+	    vnaproperty_list_t *vplp  = (vnaproperty_list_t *)root;
+	    for (size_t s = 0; s < vplp->vpl_length; ++s) {
+		vnaproperty_free((vnaproperty_t *)vplp->vpl_vector[s]);
+	    }
+	    _vnamem_afree(allocator, (void *)vplp->vpl_vector);
+	    (void)memset((void *)vplp, 'X', sizeof(*vplp));
+	}
+	break;
+
+    case VNAPROPERTY_MAP:
+	{
+	    vnaproperty_map_t *vpmp = (vnaproperty_map_t *)root;
+	    vnaproperty_map_element_t *vmep, *next;
+
+	    for (vmep = vpmp->vpm_order_head; vmep != NULL; vmep = next) {
+		next = vmep->vme_order_next;
+		_vnamem_afree(allocator, (void *)vmep->vme_pair.vmpr_key);
+		vnaproperty_free((vnaproperty_t *)vmep->vme_pair.
+			vmpr_value);
+		memset((void *)vmep, 'X', sizeof(*vmep));
+		_vnamem_afree(allocator, (void *)vmep);
+		vmep = NULL;
+	    }
+	    _vnamem_afree(allocator, (void *)vpmp->vpm_hash_table);
+	    (void)memset((void *)vpmp, 'X', sizeof(*vpmp));
+	}
+	break;
+    }
+    _vnamem_afree(allocator, (void *)root);
+}
+
+/*
+ * node_type: return the type code of a node
+ *   @node: node or NULL
+ */
+static int node_type(const vnaproperty_t *node)
+{
+    if (node == NULL) {
+	return VNAPROPERTY_ERROR;
+    }
+    switch (node->vpr_type) {
+    case VNAPROPERTY_SCALAR:
+	return 's';
+
+    case VNAPROPERTY_MAP:
+	return 'm';
+
+    case VNAPROPERTY_LIST:
+	return 'l';
+
+    default:
+	return -1;
+    }
+}
+
+/*
+ * node_count: return the count of elements in a collection node
+ *   @node: node or NULL
+ */
+static int node_count(const vnaproperty_t *node)
+{
+    if (node == NULL) {
+	return -1;
+    }
+    switch (node->vpr_type) {
+    case VNAPROPERTY_MAP:
+	return map_count(node);
+
+    case VNAPROPERTY_LIST:
+	return list_count(node);
+
+    default:
+	break;
+    }
+    errno = EINVAL;
+    return -1;
+}
+
+/*
+ * node_keys: return a vector of keys of a map node
+ *   @node: node or NULL
+ */
+static const char **node_keys(const vnaproperty_t *node)
+{
+    const vnaproperty_map_t *map;
+    const vnaproperty_map_element_t *vmep;
+    const char **vector, **cpp;
+
+    if (node == NULL) {
+	return NULL;
+    }
+    if (node->vpr_type != VNAPROPERTY_MAP) {
+	errno = EINVAL;
+	return NULL;
+    }
+    map = (vnaproperty_map_t *)node;
+    if ((vector = calloc(map->vpm_count + 1, sizeof(char *))) == NULL) {
+	return NULL;
+    }
+    cpp = vector;
+    for (vmep = map->vpm_order_head; vmep != NULL;
+	    vmep = vmep->vme_order_next) {
+	*cpp++ = vmep->vme_pair.vmpr_key;
+    }
+    *cpp = NULL;
+    return vector;
+}
+
+/*
+ * node_value: return the value of a scalar node
+ *   @node: node or NULL
+ */
+static const char *node_value(const vnaproperty_t *node)
+{
+    if (node == NULL) {
+	return NULL;
+    }
+    if (node->vpr_type != VNAPROPERTY_SCALAR) {
+	errno = EINVAL;
+	return NULL;
+    }
+    return scalar_get(node);
+}
+
+/*
+ * assignable: test if the expression allows a scalar or null value
+ *   @tail: last expression node
+ */
+static bool assignable(const expr_t *tail)
+{
+    switch (tail->ex_type) {
+    case E_MAP_ELEMENT:
+    case E_LIST_ELEMENT:
+    case E_LIST_INSERT:
+    case E_LIST_APPEND:
+    case E_DOT:
+	return true;
+
+    case E_MAP:
+    case E_LIST:
+    default:
+	break;
+    }
+    return false;
+}
+
+/*
+ * assign: set the node at anchor to a scalar or null
+ *   @anchor: address of the node
+ *   @tail: last expression node
+ *   @value: text of the scalar, or NULL for null
+ *   @dscp: where descend stopped
+ */
+static int assign(vnaproperty_t **anchor, const expr_t *tail,
+	const char *value, const descent_t *dscp)
+{
+    vnaproperty_t *node = NULL;
+
+    /*
+     * Make sure we're not trying to assign to a map or list.
+     */
+    if (!assignable(tail)) {
+	errno = EINVAL;
+	return -1;
+    }
+    if (value != NULL &&
+	    (node = scalar_alloc(&dscp->dsc_tree, value)) == NULL) {
+	return -1;
+    }
+
+    /*
+     * Free any old value and install the new value.
+     */
+    vnaproperty_free(*anchor);
+    *anchor = node != NULL ? node : null_node(dscp->dsc_tree.tr_arena);
+    return 0;
+}
+
+/*
+ * assign_number: set the node at anchor to a numeric scalar
+ *   @anchor: address of the node
+ *   @tail: last expression node
+ *   @type: type of the number
+ *   @number: value to assign
+ *   @dscp: where descend stopped
+ */
+static int assign_number(vnaproperty_t **anchor, const expr_t *tail,
+	vnaproperty_number_type_t type, const vnaproperty_number_t *number,
+	const descent_t *dscp)
+{
+    vnaproperty_t *node;
+
+    if (!assignable(tail)) {
+	errno = EINVAL;
+	return -1;
+    }
+    if ((node = number_alloc(&dscp->dsc_tree, type, number)) == NULL) {
+	return -1;
+    }
+    vnaproperty_free(*anchor);
+    *anchor = node;
+    return 0;
+}
+
+/*
+ * node_number: return the value of a scalar node as a number
+ *   @node: node or NULL
+ *   @type: type of the result
+ *   @result: address of the result
+ *
+ *   The caller clears errno before looking up the node so that we can
+ *   tell a null value, which isn't a number, from a failed lookup.
+ */
+static int node_number(const vnaproperty_t *node,
+	vnaproperty_number_type_t type, vnaproperty_number_t *result)
+{
+    if (node == NULL) {
+	if (errno == 0) {
+	    errno = EINVAL;
+	}
+	return -1;
+    }
+    return scalar_number(node, type, result);
+}
+
+/*
+ * get_number: return the value of the scalar named by format as a number
+ *   @root:   property data root (can be NULL)
+ *   @type:   type of the result
+ *   @result: address of the result
+ *   @format: printf-like format string forming the property expression
+ *   @ap:     variable argument pointer
+ */
+static int get_number(const vnaproperty_t *root,
+	vnaproperty_number_type_t type, vnaproperty_number_t *result,
+	const char *format, va_list ap)
+{
+    errno = 0;
+    return node_number(get_node(root, format, ap), type, result);
+}
+
+/*
+ * set_number: set the scalar named by format to a number
+ *   @rootptr: address of root property pointer
+ *   @type:    type of the number
+ *   @number:  value to set
+ *   @format:  printf-like format string forming the property expression
+ *   @ap:      variable argument pointer
+ */
+static int set_number(vnaproperty_t **rootptr,
+	vnaproperty_number_type_t type, const vnaproperty_number_t *number,
+	const char *format, va_list ap)
+{
+    parser_t parser;
+    scanner_t *scanner = &parser.prs_scn;
+    vnaproperty_t **anchor;
+    int rv = -1;
+
+    if ((anchor = parse_and_descend(&parser, rootptr, NULL, /*set*/true,
+		    format, ap)) == NULL) {
+	return -1;
+    }
+    if (scanner->scn_token != T_EOF) {
+	errno = EINVAL;
+    } else {
+	rv = assign_number(anchor, parser.prs_tail, type, number,
+		&parser.prs_descent);
+    }
+    parser_free(&parser);
+    return rv;
+}
+
+/*
+ * delete: delete the node where descend stopped
+ *   @anchor: address of the node
+ *   @tail: last expression node
+ *   @dscp: where descend stopped
+ */
+static int delete(vnaproperty_t **anchor, const expr_t *tail,
+	const descent_t *dscp)
+{
+    switch (tail->ex_type) {
+    case E_MAP_ELEMENT:
+	assert(dscp->dsc_collection != NULL);
+	return map_delete(dscp->dsc_collection, dscp->dsc_name);
+
+    case E_LIST_ELEMENT:
+	assert(dscp->dsc_collection != NULL);
+	return list_delete(dscp->dsc_collection, dscp->dsc_index);
+
+    default:
+	vnaproperty_free(*anchor);
+	*anchor = null_node(dscp->dsc_tree.tr_arena);
+    }
+    return 0;
+}
+
+
+/***********************************************************************
+ * External API
+ **********************************************************************/
+
+/*
+ * vnaproperty_vtype: get the type of the given property expression
+ *   @root:   property data root (can be NULL)
+ *   @format: printf-like format string forming the property expression
+ *   @ap:     variable argument pointer
+ *
+ * Return:
+ *   'm' map
+ *   'l' list
+ *   's' scalar
+ *   -1  error
+ */
+int vnaproperty_vtype(const vnaproperty_t *root, const char *format, va_list ap)
+{
+    return node_type(get_node(root, format, ap));
+}
+
+/*
+ * vnaproperty_vcount: return count of elements in given collection
+ *   @root:   property data root (can be NULL)
+ *   @format: printf-like format string forming the property expression
+ *   @ap:     variable argument pointer
+ */
+int vnaproperty_vcount(const vnaproperty_t *root,
+	const char *format, va_list ap)
+{
+    return node_count(get_node(root, format, ap));
+}
+
+/*
+ * vnaproperty_vkeys: return a vector of keys for the given map expr
+ *   @root:   property data root (can be NULL)
+ *   @format: printf-like format string forming the property expression
+ *   @ap:     variable argument pointer
+ */
+const char **vnaproperty_vkeys(const vnaproperty_t *root,
+	const char *format, va_list ap)
+{
+    return node_keys(get_node(root, format, ap));
+}
+
+/*
+ * vnaproperty_vget: get a property value from a property expression
+ *   @root:   property data root (can be NULL)
+ *   @format: printf-like format string forming the property expression
+ *   @ap:     variable argument pointer
+ */
+const char *vnaproperty_vget(const vnaproperty_t *root,
+	const char *format, va_list ap)
+{
+    return node_value(get_node(root, format, ap));
+}
+
+/*
+ * _vnaproperty_vset: set a property value, starting a new tree with vmap
+ *   @vmap:    allocator if *rootptr is NULL, or NULL for global
+ *   @rootptr: address of root property pointer
+ *   @format:  printf-like format string forming the property expression
+ *   @ap:      variable argument pointer
+ */
+int _vnaproperty_vset(const vnamem_allocator_t *vmap,
+	vnaproperty_t **rootptr, const char *format, va_list ap)
+{
+    parser_t parser;
+    scanner_t *scanner = &parser.prs_scn;
+    vnaproperty_t **anchor;
+    int rv = -1;
+
+    if ((anchor = parse_and_descend(&parser, rootptr, vmap, /*set*/true,
+		    format, ap)) == NULL) {
+	return -1;
+    }
+
+    /*
+     * Get the value to assign.
+     *   foo=text	set foo to a scalar with given text
+     *   foo#		set foo to null
      */
-    state = 0;
-    for (;;) {
-	switch (state) {
-	case 0:
-	    /*
-	     * expr	: T_DOT dot
-	     *		| [T_ID] map_element
-	     *		| T_LBRACKET subscript
-	     *		| [T_LCURLY] abstract_map
-	     *		;
-	     */
-	    switch (scanner->scn_token) {
-	    case T_DOT:
-		scan(scanner);
-		state = 1;
-		continue;
+    switch (scanner->scn_token) {
+    case T_ASSIGN:
+	rv = assign(anchor, parser.prs_tail, scanner->scn_position,
+		&parser.prs_descent);
+	break;
+
+    case T_HASH:
+	rv = assign(anchor, parser.prs_tail, NULL, &parser.prs_descent);
+	break;
+
+    default:
+	errno = EINVAL;
+	break;
+    }
+    parser_free(&parser);
+    return rv;
+}
+
+/*
+ * vnaproperty_vset: set a property value from a property expression
+ *   @rootptr: address of root property pointer
+ *   @format:  printf-like format string forming the property expression
+ *   @ap:      variable argument pointer
+ */
+int vnaproperty_vset(vnaproperty_t **rootptr, const char *format, va_list ap)
+{
+    return _vnaproperty_vset(NULL, rootptr, format, ap);
+}
+
+/*
+ * vnaproperty_vdelete: delete the value described by format
+ *   @rootptr:   address of root property pointer
+ *   @format: printf-like format string forming the property expression
+ *   @...:    optional variable arguments
+ */
+int vnaproperty_vdelete(vnaproperty_t **rootptr, const char *format,
+	va_list ap)
+{
+    parser_t parser;
+    scanner_t *scanner = &parser.prs_scn;
+    vnaproperty_t **anchor;
+    int rv = -1;
+
+    /*
+     * Parse the expression and descend to the requested node.
+     */
+    if ((anchor = parse_and_descend(&parser, rootptr, NULL, /*set*/false,
+		    format, ap)) == NULL) {
+	return -1;
+    }
+
+    /*
+     * Make sure there are no unexpected trailing tokens.
+     */
+    if (scanner->scn_token != T_EOF) {
+	errno = EINVAL;
+	goto out;
+    }
+
+    /*
+     * Delete the indicated key.
+     */
+    rv = delete(anchor, parser.prs_tail, &parser.prs_descent);
+
+out:
+    parser_free(&parser);
+    return rv;
+}
+
+/*
+ * vnaproperty_get_subtree: get subtree described by format
+ *   @root:   address of root property pointer
+ *   @format: printf-like format string forming the property expression
+ *   @ap:     variable arguments
+ */
+vnaproperty_t *vnaproperty_vget_subtree(const vnaproperty_t *root,
+	const char *format, va_list ap)
+{
+    parser_t parser;
+    scanner_t *scanner = &parser.prs_scn;
+    vnaproperty_t **anchor;
+
+    if ((anchor = parse_and_descend(&parser, (vnaproperty_t **)&root, NULL,
+		    /*set*/false, format, ap)) == NULL) {
+	return NULL;
+    }
+
+    /*
+     * Make sure there are no unexpected trailing tokens.
+     */
+    if (scanner->scn_token != T_EOF) {
+	errno = EINVAL;
+	anchor = NULL;
+	goto out;
+    }
+
+out:
+    parser_free(&parser);
+    return anchor != NULL ? REAL_NODE(*anchor) : NULL;
+}
+
+/*
+ * _vnaproperty_vset_subtree: vnaproperty_vset_subtree with an allocator
+ *   @vmap:    allocator if *rootptr is NULL, or NULL for global
+ *   @rootptr: address of root property pointer
+ *   @format:  printf-like format string forming the property expression
+ *   @ap:      variable arguments
+ */
+vnaproperty_t **_vnaproperty_vset_subtree(const vnamem_allocator_t *vmap,
+	vnaproperty_t **rootptr, const char *format, va_list ap)
+{
+    parser_t parser;
+    scanner_t *scanner = &parser.prs_scn;
+    vnaproperty_t **anchor;
 
-	    case T_ID:
-		goto map_element;
+    if ((anchor = parse_and_descend(&parser, rootptr, vmap,
+		    /*set*/true, format, ap)) == NULL) {
+	return NULL;
+    }
 
-	    case T_LBRACKET:
-		scan(scanner);
-		state = 3;
-		continue;
+    /*
+     * Make sure there are no unexpected trailing tokens.
+     */
+    if (scanner->scn_token != T_EOF) {
+	errno = EINVAL;
+	anchor = NULL;
+	goto out;
+    }
 
-	    case T_LCURLY:
-		goto abstract_map;
+out:
+    parser_free(&parser);
+    return anchor;
+}
 
-	    default:
-		goto error;				/* NOT accepting */
-	    }
-	    break;
+/*
+ * vnaproperty_set_subtree: make the tree conform and return address of subtree
+ *   @rootptr: address of root property pointer
+ *   @format:  printf-like format string forming the property expression
+ *   @ap:      variable arguments
+ */
+vnaproperty_t **vnaproperty_vset_subtree(vnaproperty_t **rootptr,
+	const char *format, va_list ap)
+{
+    return _vnaproperty_vset_subtree(NULL, rootptr, format, ap);
+}
 
-	case 1:
-	    /*
-	     * dot	: [T_ID] map_element
-	     *		| T_LBRACKET subscript
-	     *		| [T_LCURLY] abstract_map
-	     *		| [default]  final_dot
-	     *		;
-	     */
-	    switch (scanner->scn_token) {
-	    case T_ID:
-		goto map_element;
+/*
+ * vnaproperty_vget_int64: get a property value as an int64
+ *   @root:   property data root (can be NULL)
+ *   @value:  address of the result
+ *   @format: printf-like format string forming the property expression
+ *   @ap:     variable argument pointer
+ */
+int vnaproperty_vget_int64(const vnaproperty_t *root, int64_t *value,
+	const char *format, va_list ap)
+{
+    vnaproperty_number_t number;
 
-	    case T_LBRACKET:
-		scan(scanner);
-		state = 3;
-		continue;
+    if (get_number(root, VNAPROPERTY_NUMBER_INT64, &number,
+		format, ap) == -1) {
+	return -1;
+    }
+    *value = number.vpn_int64;
+    return 0;
+}
 
-	    case T_LCURLY:
-		goto abstract_map;
+/*
+ * vnaproperty_vset_int64: set a property value to an int64
+ *   @rootptr: address of root property pointer
+ *   @value:   value to set
+ *   @format:  printf-like format string forming the property expression
+ *   @ap:      variable argument pointer
+ */
+int vnaproperty_vset_int64(vnaproperty_t **rootptr, int64_t value,
+	const char *format, va_list ap)
+{
+    vnaproperty_number_t number;
 
-	    default:
-		goto final_dot;				/* accepting state */
-	    }
-	    break;
+    number.vpn_int64 = value;
+    return set_number(rootptr, VNAPROPERTY_NUMBER_INT64, &number,
+	    format, ap);
+}
 
-	case 2:
-	    /*
-	     * chain	: T_DOT dot
-	     *		| T_LBRACKET subscript
-	     *		| [T_LCURLY] abstract_map
-	     *		| λ
-	     *		;
-	     */
-	    switch (scanner->scn_token) {
-	    case T_DOT:
-		scan(scanner);
-		state = 1;
-		continue;
+/*
+ * vnaproperty_vget_double: get a property value as a double
+ *   @root:   property data root (can be NULL)
+ *   @value:  address of the result
+ *   @format: printf-like format string forming the property expression
+ *   @ap:     variable argument pointer
+ */
+int vnaproperty_vget_double(const vnaproperty_t *root, double *value,
+	const char *format, va_list ap)
+{
+    vnaproperty_number_t number;
 
-	    case T_LBRACKET:
-		scan(scanner);
-		state = 3;
-		continue;
+    if (get_number(root, VNAPROPERTY_NUMBER_DOUBLE, &number,
+		format, ap) == -1) {
+	return -1;
+    }
+    *value = number.vpn_double;
+    return 0;
+}
 
-	    case T_LCURLY:
-		goto abstract_map;
+/*
+ * vnaproperty_vset_double: set a property value to a double
+ *   @rootptr: address of root property pointer
+ *   @value:   value to set
+ *   @format:  printf-like format string forming the property expression
+ *   @ap:      variable argument pointer
+ */
+int vnaproperty_vset_double(vnaproperty_t **rootptr, double value,
+	const char *format, va_list ap)
+{
+    vnaproperty_number_t number;
 
-	    default:
-		break;					/* accepting state */
-	    }
-	    break;
+    number.vpn_double = value;
+    return set_number(rootptr, VNAPROPERTY_NUMBER_DOUBLE, &number,
+	    format, ap);
+}
 
-	case 3:
-	    /*
-	     * subscript	: T_INT list_element
-	     *			| T_PLUS list_append
-	     *			| [T_RBRACKET] abstract_list
-	     *			;
-	     */
-	    switch (scanner->scn_token) {
-	    case T_INT:
-		goto list_element;
+/*
+ * vnaproperty_vget_complex: get a property value as a complex
+ *   @root:   property data root (can be NULL)
+ *   @value:  address of the result
+ *   @format: printf-like format string forming the property expression
+ *   @ap:     variable argument pointer
+ */
+int vnaproperty_vget_complex(const vnaproperty_t *root,
+	double complex *value, const char *format, va_list ap)
+{
+    vnaproperty_number_t number;
 
-	    case T_PLUS:
-		goto list_append;
+    if (get_number(root, VNAPROPERTY_NUMBER_COMPLEX, &number,
+		format, ap) == -1) {
+	return -1;
+    }
+    *value = number.vpn_complex;
+    return 0;
+}
 
-	    case T_RBRACKET:
-		goto abstract_list;
+/*
+ * vnaproperty_vset_complex: set a property value to a complex
+ *   @rootptr: address of root property pointer
+ *   @value:   value to set
+ *   @format:  printf-like format string forming the property expression
+ *   @ap:      variable argument pointer
+ */
+int vnaproperty_vset_complex(vnaproperty_t **rootptr,
+	double complex value, const char *format, va_list ap)
+{
+    vnaproperty_number_t number;
 
-	    default:
-		goto error;				/* NOT accepting */
-	    }
-	    break;
+    number.vpn_complex = value;
+    return set_number(rootptr, VNAPROPERTY_NUMBER_COMPLEX, &number,
+	    format, ap);
+}
 
-	map_element:
-	    /*
-	     * map_element	: T_ID chain ;
-	     */
-	    assert(scanner->scn_token == T_ID);
-	    if ((exp = malloc(sizeof(expr_t))) == NULL) {
-		goto error;
-	    }
-	    (void)memset((void *)exp, 0, sizeof(expr_t));
-	    exp->ex_type = E_MAP_ELEMENT;
-	    exp->u.ex_name = scanner->scn_text;
-	    exp->ex_next = NULL;
-	    *expp = exp;
-	    expp = &exp->ex_next;
-	    scan(scanner);
-	    state = 2;
-	    continue;
+/*
+ * vnaproperty_type: get the type of the given property expression
+ *   @root:   property data root (can be NULL)
+ *   @format: printf-like format string forming the expression
+ *   @...:    optional variable arguments
+ */
+int vnaproperty_type(const vnaproperty_t *root, const char *format, ...)
+{
+    va_list ap;
+    int type;
 
-	list_element:	/* and list_insert */
-	    /*
-	     * list_element	: T_PLUS list_insert
-	     *			| T_RBRACKET chain
-	     *			;
-	     *
-	     * list_insert	: T_RBRACKET chain
-	     *			;
-	     */
-	    assert(scanner->scn_token == T_INT);
-	    if ((exp = malloc(sizeof(expr_t))) == NULL) {
-		goto error;
-	    }
-	    (void)memset((void *)exp, 0, sizeof(expr_t));
-	    exp->ex_type = E_LIST_ELEMENT;
-	    exp->u.ex_index = scanner->u.scn_int;
-	    scan(scanner);
-	    if (scanner->scn_token == T_PLUS) {
-		exp->ex_type = E_LIST_INSERT;
-		scan(scanner);
-	    }
-	    *expp = exp;
-	    expp = &exp->ex_next;
-	    if (scanner->scn_token != T_RBRACKET) {
-		errno = EINVAL;
-		goto error;
-	    }
-	    scan(scanner);
-	    state = 2;
-	    continue;
+    va_start(ap, format);
+    type = vnaproperty_vtype(root, format, ap);
+    va_end(ap);
+
+    return type;
+}
+
+/*
+ * vnaproperty_count: return count of elements in given collection
+ *   @root:   property data root (can be NULL)
+ *   @format: printf-like format string forming the property expression
+ *   @...:    optional variable arguments
+ */
+int vnaproperty_count(const vnaproperty_t *root,
+	const char *format, ...)
+{
+    va_list ap;
+    int count;
+
+    va_start(ap, format);
+    count = vnaproperty_vcount(root, format, ap);
+    va_end(ap);
+
+    return count;
+}
+
+/*
+ * vnaproperty_keys: return a vector of keys for the given map expr
+ *   @root:   property data root (can be NULL)
+ *   @format: printf-like format string forming the property expression
+ *   @...:    optional variable arguments
+ *
+ * Caller can free the vector by a call to free.
+ */
+const char **vnaproperty_keys(const vnaproperty_t *root,
+	const char *format, ...)
+{
+    va_list ap;
+    const char **keys;
+
+    va_start(ap, format);
+    keys = vnaproperty_vkeys(root, format, ap);
+    va_end(ap);
+
+    return keys;
+}
+
+/*
+ * vnaproperty_get: get a property value from a property expression
+ *   @root:   property data root (can be NULL)
+ *   @format: printf-like format string forming the property expression
+ *   @...:    optional variable arguments
+ */
+const char *vnaproperty_get(const vnaproperty_t *root,
+	const char *format, ...)
+{
+    va_list ap;
+    const char *value;
 
-	list_append:
-	    /*
-	     * list_append	: T_RBRACKET chain
-	     */
-	    assert(scanner->scn_token == T_PLUS);
-	    if ((exp = malloc(sizeof(expr_t))) == NULL) {
-		goto error;
-	    }
-	    (void)memset((void *)exp, 0, sizeof(expr_t));
-	    exp->ex_type = E_LIST_APPEND;
-	    *expp = exp;
-	    expp = &exp->ex_next;
-	    scan(scanner);
-	    if (scanner->scn_token != T_RBRACKET) {
-		errno = EINVAL;
-		goto error;
-	    }
-	    scan(scanner);
-	    state = 2;
-	    continue;
+    va_start(ap, format);
+    value = vnaproperty_vget(root, format, ap);
+    va_end(ap);
 
-	final_dot:
-	    /*
-	     * final_dot	: λ ;
-	     */
-	    if ((exp = malloc(sizeof(expr_t))) == NULL) {
-		goto error;
-	    }
-	    (void)memset((void *)exp, 0, sizeof(expr_t));
-	    exp->ex_type = E_DOT;
-	    exp->ex_next = NULL;
-	    *expp = exp;
-	    expp = &exp->ex_next;
-	    break;
+    return value;
+}
 
-	abstract_map:
-	    /*
-	     * abstract_map	: T_LCURLY T_RCURLY ;
-	     */
-	    assert(scanner->scn_token == T_LCURLY);
-	    scan(scanner);
-	    if (scanner->scn_token != T_RCURLY) {
-		goto error;
-	    }
-	    scan(scanner);
-	    if ((exp = malloc(sizeof(expr_t))) == NULL) {
-		goto error;
-	    }
-	    (void)memset((void *)exp, 0, sizeof(expr_t));
-	    exp->ex_type = E_MAP;
-	    exp->ex_next = NULL;
-	    *expp = exp;
-	    expp = &exp->ex_next;
-	    break;
+/*
+ * vnaproperty_set: set a property value from a property expression
+ *   @rootptr: address of root property pointer
+ *   @format:  printf-like format string forming the property expression
+ *   @...:     optional variable arguments
+ */
+int vnaproperty_set(vnaproperty_t **rootptr, const char *format, ...)
+{
+    va_list ap;
+    int rv;
 
-	abstract_list:
-	    /*
-	     * abstract_list	: T_RBRACKET ;
-	     */
-	    assert(scanner->scn_token == T_RBRACKET);
-	    scan(scanner);
-	    if ((exp = malloc(sizeof(expr_t))) == NULL) {
-		goto error;
-	    }
-	    (void)memset((void *)exp, 0, sizeof(expr_t));
-	    exp->ex_type = E_LIST;
-	    exp->ex_next = NULL;
-	    *expp = exp;
-	    expp = &exp->ex_next;
-	    break;
-	}
-	break;
-    }
-    parser->prs_tail = exp;
-    return 0;
+    va_start(ap, format);
+    rv = vnaproperty_vset(rootptr, format, ap);
+    va_end(ap);
 
-error:
-    parser_free(parser);
-    errno = EINVAL;
-    return -1;
+    return rv;
 }
 
+/*
+ * vnaproperty_delete: delete the value described by format
+ *   @rootptr: address of root property pointer
+ *   @format:  printf-like format string forming the property expression
+ *   @...:     optional variable arguments
+ */
+int vnaproperty_delete(vnaproperty_t **rootptr, const char *format, ...)
+{
+    va_list ap;
+    int rv;
 
-/***********************************************************************
- * Internal Tree Operations
- **********************************************************************/
+    va_start(ap, format);
+    rv = vnaproperty_vdelete(rootptr, format, ap);
+    va_end(ap);
+
+    return rv;
+}
 
 /*
- * parse_and_descend: parse the expression and descend down the tree
- *   @parser:  address of caller-allocated parser state structure
- *   @rootptr: address of property data root
- *   @set:     force the tree to conform to the indicated expression
+ * vnaproperty_get_subtree: get subtree described by format
+ *   @root:    address of root property pointer
  *   @format:  printf-like format string forming the property expression
- *   @ap       variable argument pointer
+ *   @...:     optional variable arguments
  */
-static vnaproperty_t **parse_and_descend(parser_t *parser,
-	vnaproperty_t **rootptr, bool set, const char *format, va_list ap)
+vnaproperty_t *vnaproperty_get_subtree(const vnaproperty_t *root,
+	const char *format, ...)
 {
-    vnaproperty_t **anchor = rootptr;
-    vnaproperty_t *node = *anchor;
-    vnaproperty_t *collection = NULL;
+    va_list ap;
+    vnaproperty_t *subtree;
 
-    /*
-     * Parse the expression.
-     */
-    if (parse(parser, format, ap) == -1) {
-	return NULL;
-    }
+    va_start(ap, format);
+    subtree = vnaproperty_vget_subtree(root, format, ap);
+    va_end(ap);
 
-    /*
-     * Following the expression list, walk down the tree.
-     */
-    for (expr_t *exp = parser->prs_head; exp != NULL; exp = exp->ex_next) {
-	collection = NULL;
-	if (exp->ex_type == E_DOT) {
-	    assert(exp->ex_next == NULL);
-	    break;
-	}
-	switch (exp->ex_type) {
-	case E_MAP:
-	case E_MAP_ELEMENT:
-	    if (node == NULL) {
-		if (!set) {
-		    errno = ENOENT;
-		    goto error;
-		}
-		if ((node = map_alloc()) == NULL) {
-		    goto error;
-		}
-		*anchor = node;
+    return subtree;
+}
 
-	    } else if (node->vpr_type != VNAPROPERTY_MAP) {
-		if (!set) {
-		    node = NULL;
-		    errno = EINVAL;
-		    goto error;
-		}
-		vnaproperty_free(node);
-		*anchor = node = NULL;
-		if ((node = map_alloc()) == NULL) {
-		    goto error;
-		}
-		*anchor = node;
-	    }
-	    if (exp->ex_type == E_MAP) {
-		assert(exp->ex_next == NULL);
-		break;
-	    }
-	    collection = node;
-	    if ((anchor = map_subtree(node, set,
-			    exp->u.ex_name)) == NULL) {
-		goto error;
-	    }
-	    node = *anchor;
-	    continue;
+/*
+ * vnaproperty_set_subtree: make the tree conform and return address of subtree
+ *   @rootptr: address of root property pointer
+ *   @format:  printf-like format string forming the property expression
+ *   @...:     optional variable arguments
+ */
+vnaproperty_t **vnaproperty_set_subtree(vnaproperty_t **rootptr,
+	const char *format, ...)
+{
+    va_list ap;
+    vnaproperty_t **subtree;
 
-	case E_LIST:
-	case E_LIST_ELEMENT:
-	case E_LIST_INSERT:
-	case E_LIST_APPEND:
-	    if (node == NULL) {
-		if (!set) {
-		    errno = ENOENT;
-		    goto error;
-		}
-		if ((node = list_alloc()) == NULL) {
-		    goto error;
-		}
-		*anchor = node;
+    va_start(ap, format);
+    subtree = vnaproperty_vset_subtree(rootptr, format, ap);
+    va_end(ap);
 
-	    } else if (node->vpr_type != VNAPROPERTY_LIST) {
-		if (!set) {
-		    node = NULL;
-		    errno = EINVAL;
-		    goto error;
-		}
-		vnaproperty_free(node);
-		*anchor = node = NULL;
-		if ((node = list_alloc()) == NULL) {
-		    goto error;
-		}
-		*anchor = node;
-	    }
-	    switch (exp->ex_type) {
-	    case E_LIST:
-		assert(exp->ex_next == NULL);
-		break;
+    return subtree;
+}
 
-	    case E_LIST_ELEMENT:
-		collection = node;
-		if ((anchor = list_subtree(node, set,
-				exp->u.ex_index)) == NULL) {
-		    goto error;
-		}
-		node = *anchor;
-		continue;
+/*
+ * vnaproperty_get_int64: get a property value as an int64
+ *   @root:   property data root (can be NULL)
+ *   @value:  address of the result
+ *   @format: printf-like format string forming the property expression
+ *   @...:    optional variable arguments
+ */
+int vnaproperty_get_int64(const vnaproperty_t *root, int64_t *value,
+	const char *format, ...)
+{
+    va_list ap;
+    int rv;
+
+    va_start(ap, format);
+    rv = vnaproperty_vget_int64(root, value, format, ap);
+    va_end(ap);
+
+    return rv;
+}
+
+/*
+ * vnaproperty_set_int64: set a property value to an int64
+ *   @rootptr: address of root property pointer
+ *   @value:   value to set
+ *   @format:  printf-like format string forming the property expression
+ *   @...:     optional variable arguments
+ */
+int vnaproperty_set_int64(vnaproperty_t **rootptr, int64_t value,
+	const char *format, ...)
+{
+    va_list ap;
+    int rv;
 
-	    case E_LIST_INSERT:
-		if (!set) {
-		    errno = EINVAL;
-		    goto error;
-		}
-		collection = node;
-		if ((anchor = list_insert(node, exp->u.ex_index)) == NULL) {
-		    goto error;
-		}
-		node = *anchor;
-		continue;
+    va_start(ap, format);
+    rv = vnaproperty_vset_int64(rootptr, value, format, ap);
+    va_end(ap);
 
-	    case E_LIST_APPEND:
-		if (!set) {
-		    errno = EINVAL;
-		    goto error;
-		}
-		collection = node;
-		if ((anchor = list_append(node)) == NULL) {
-		    goto error;
-		}
-		node = *anchor;
-		continue;
+    return rv;
+}
 
-	    default:
-		abort();
-	    }
-	    break;
+/*
+ * vnaproperty_get_double: get a property value as a double
+ *   @root:   property data root (can be NULL)
+ *   @value:  address of the result
+ *   @format: printf-like format string forming the property expression
+ *   @...:    optional variable arguments
+ */
+int vnaproperty_get_double(const vnaproperty_t *root, double *value,
+	const char *format, ...)
+{
+    va_list ap;
+    int rv;
 
-	    if (exp->ex_type == E_LIST) {
-		assert(exp->ex_next == NULL);
-		break;
-	    }
-	    collection = node;
-	    if ((anchor = list_subtree(node, set,
-			    exp->u.ex_index)) == NULL) {
-		goto error;
-	    }
-	    node = *anchor;
-	    continue;
+    va_start(ap, format);
+    rv = vnaproperty_vget_double(root, value, format, ap);
+    va_end(ap);
 
-	default:
-	    abort();
-	}
-    }
-    parser->prs_collection = collection;
-    return anchor;
+    return rv;
+}
 
-error:
-    parser_free(parser);
-    return NULL;
+/*
+ * vnaproperty_set_double: set a property value to a double
+ *   @rootptr: address of root property pointer
+ *   @value:   value to set
+ *   @format:  printf-like format string forming the property expression
+ *   @...:     optional variable arguments
+ */
+int vnaproperty_set_double(vnaproperty_t **rootptr, double value,
+	const char *format, ...)
+{
+    va_list ap;
+    int rv;
+
+    va_start(ap, format);
+    rv = vnaproperty_vset_double(rootptr, value, format, ap);
+    va_end(ap);
+
+    return rv;
 }
 
 /*
- * get_node: parse the expression and return the indicated node
+ * vnaproperty_get_complex: get a property value as a complex
  *   @root:   property data root (can be NULL)
+ *   @value:  address of the result
  *   @format: printf-like format string forming the property expression
- *   @ap:     variable argument pointer
+ *   @...:    optional variable arguments
  */
-static const vnaproperty_t *get_node(const vnaproperty_t *root,
-	const char *format, va_list ap)
+int vnaproperty_get_complex(const vnaproperty_t *root,
+	double complex *value, const char *format, ...)
 {
-    parser_t parser;
-    scanner_t *scanner = &parser.prs_scn;
-    vnaproperty_t **anchor;
+    va_list ap;
+    int rv;
+
+    va_start(ap, format);
+    rv = vnaproperty_vget_complex(root, value, format, ap);
+    va_end(ap);
+
+    return rv;
+}
+
+/*
+ * vnaproperty_set_complex: set a property value to a complex
+ *   @rootptr: address of root property pointer
+ *   @value:   value to set
+ *   @format:  printf-like format string forming the property expression
+ *   @...:     optional variable arguments
+ */
+int vnaproperty_set_complex(vnaproperty_t **rootptr,
+	double complex value, const char *format, ...)
+{
+    va_list ap;
+    int rv;
+
+    va_start(ap, format);
+    rv = vnaproperty_vset_complex(rootptr, value, format, ap);
+    va_end(ap);
+
+    return rv;
+}
+
+
+/*
+ * vnaproperty_quote_key: quote a map ID that contains reserved chars
+ *   @key: map key to quote
+ *
+ * Caller must free the returned memory by a call to free().
+ */
+char *vnaproperty_quote_key(const char *key)
+{
+    int length;
+    bool *map = NULL;
+    int n_special = 0;
+    char *result = NULL;
+    char *cur;
 
     /*
-     * Parse the expression and descend to the requested node.
+     * Handle NULL.
      */
-    if ((anchor = parse_and_descend(&parser, (vnaproperty_t **)&root,
-		    /*set*/false, format, ap)) == NULL) {
+    if (key == NULL) {
 	return NULL;
     }
 
     /*
-     * Make sure there are no unexpected tokens at the end of line.
+     * Handle empty string.
      */
-    if (scanner->scn_token != T_EOF) {
-	errno = EINVAL;
-	parser_free(&parser);
-	return NULL;
+    if (key[0] == '\000') {
+	result = strdup("");
+	goto out;
     }
 
-    parser_free(&parser);
-    return *anchor;
-}
+    /*
+     * Allocate a vector of bool to record positions of special characters.
+     */
+    length = strlen(key);
+    if ((map = _vnamem_calloc(length, sizeof(bool))) == NULL) {
+	goto out;
+    }
 
-/*
- * vnaproperty_free: free the given tree
- *   @root: pointer to tree to free
- */
-static void vnaproperty_free(vnaproperty_t *root)
-{
-    if (root == NULL)
-	return;
+    /*
+     * Find the positions that require quotes.
+     */
+    if (!ISIDCHAR1(key[0]) || key[0] == '\\') {
+	map[0] = true;
+	++n_special;
+    }
+    {
+	int i;
 
-    assert(root->vpr_type == VNAPROPERTY_SCALAR ||
-	   root->vpr_type == VNAPROPERTY_LIST   ||
-	   root->vpr_type == VNAPROPERTY_MAP);
-    switch (root->vpr_type) {
-    case VNAPROPERTY_SCALAR:
-	{
-	    vnaproperty_scalar_t *vpsp = (vnaproperty_scalar_t *)root;
-	    free((void *)vpsp->vps_value);
-	    (void)memset((void *)vpsp, 'X', sizeof(*vpsp));
+	for (i = 1; i < length; ++i) {
+	    if (!ISIDCHAR(key[i]) || key[i] == '\\') {
+		map[i] = true;
+		++n_special;
+	    }
 	}
-	break;
 
-    case VNAPROPERTY_LIST:
-	{
-	    vnaproperty_list_t *vplp  = (vnaproperty_list_t *)root;
-	    for (size_t s = 0; s < vplp->vpl_length; ++s) {
-		vnaproperty_free((vnaproperty_t *)vplp->vpl_vector[s]);
-	    }
-	    free((void *)vplp->vpl_vector);
-	    (void)memset((void *)vplp, 'X', sizeof(*vplp));
+	/*
+	 * Trailing spaces are special.
+	 */
+	while (i > 1 && key[i - 1] == ' ') {
+	    map[--i] = true;
+	    ++n_special;
 	}
-	break;
+    }
 
-    case VNAPROPERTY_MAP:
-	{
-	    vnaproperty_map_t *vpmp = (vnaproperty_map_t *)root;
-	    vnaproperty_map_element_t *vmep, *next;
+    /*
+     * If no quotes required, return a copy of the original string.
+     */
+    if (n_special == 0) {
+	result = strdup(key);
+	goto out;
+    }
 
-	    for (vmep = vpmp->vpm_order_head; vmep != NULL; vmep = next) {
-		next = vmep->vme_order_next;
-		free((void *)vmep->vme_pair.vmpr_key);
-		vnaproperty_free((vnaproperty_t *)vmep->vme_pair.
-			vmpr_value);
-		memset((void *)vmep, 'X', sizeof(*vmep));
-		free((void *)vmep);
-		vmep = NULL;
-	    }
-	    free((void *)vpmp->vpm_hash_table);
-	    (void)memset((void *)vpmp, 'X', sizeof(*vpmp));
+    /*
+     * Form the new string.
+     */
+    if ((result = malloc(length + n_special + 1)) == NULL) {
+	goto out;
+    }
+    cur = result;
+    for (int i = 0; i < length; ++i) {
+	if (map[i]) {
+	    *cur++ = '\\';
 	}
-	break;
+	*cur++ = key[i];
     }
-    free((void *)root);
-}
-
+    *cur = '\000';
 
-/***********************************************************************
- * External API
- **********************************************************************/
+out:
+    _vnamem_free((void *)map);
+    return result;
+}
 
 /*
- * vnaproperty_vtype: get the type of the given property expression
- *   @root:   property data root (can be NULL)
- *   @format: printf-like format string forming the property expression
- *   @ap:     variable argument pointer
+ * dfs_copy: recursely copy properties
+ *   @treep: tree holding the copy
+ *   @destination: address of the null destination node
+ *   @source: root of the source tree
  *
- * Return:
- *   'm' map
- *   'l' list
- *   's' scalar
- *   -1  error
+ *   Each new node is linked into the destination before its children
+ *   are copied so that on failure, the caller can free the partial copy.
  */
-int vnaproperty_vtype(const vnaproperty_t *root, const char *format, va_list ap)
+static int dfs_copy(const tree_t *treep, vnaproperty_t **destination,
+	const vnaproperty_t *source)
 {
-    const vnaproperty_t *node;
+    vnaproperty_t *node;
 
-    if ((node = get_node(root, format, ap)) == NULL) {
-	return VNAPROPERTY_ERROR;
+    if ((source = REAL_NODE(source)) == NULL) {
+	return 0;
     }
-
-    /*
-     * Convert to character.
-     */
-    switch (node->vpr_type) {
+    switch (source->vpr_type) {
     case VNAPROPERTY_SCALAR:
-	return 's';
+	if ((node = scalar_copy(treep, source)) == NULL) {
+	    return -1;
+	}
+	*destination = node;
+	break;
 
     case VNAPROPERTY_MAP:
-	return 'm';
+	{
+	    const vnaproperty_map_t *vpmp = (const vnaproperty_map_t *)source;
+	    const vnaproperty_map_element_t *vmep;
+
+	    if ((node = map_alloc(treep)) == NULL) {
+		return -1;
+	    }
+	    *destination = node;
+	    for (vmep = vpmp->vpm_order_head; vmep != NULL;
+		    vmep = vmep->vme_order_next) {
+		vnaproperty_t **anchor;
+
+		if ((anchor = map_subtree(node, /*add*/true,
+				vmep->vme_pair.vmpr_key)) == NULL) {
+		    return -1;
+		}
+		if (dfs_copy(treep, anchor, vmep->vme_pair.vmpr_value) == -1) {
+		    return -1;
+		}
+	    }
+	}
+	break;
 
     case VNAPROPERTY_LIST:
-	return 'l';
+	{
+	    const vnaproperty_list_t *source_vplp =
+		(const vnaproperty_list_t *)source;
+	    vnaproperty_list_t *vplp;
+
+	    if ((node = list_alloc(treep)) == NULL) {
+		return -1;
+	    }
+	    *destination = node;
+	    vplp = (vnaproperty_list_t *)node;
+	    if (list_check_allocation(vplp, source_vplp->vpl_length) == -1) {
+		return -1;
+	    }
+	    for (size_t i = 0; i < source_vplp->vpl_length; ++i) {
+		++vplp->vpl_length;
+		if (dfs_copy(treep, &vplp->vpl_vector[i],
+			    source_vplp->vpl_vector[i]) == -1) {
+		    return -1;
+		}
+	    }
+	}
+	break;
 
     default:
-	return -1;
+	abort();
     }
+    node->vpr_line = source->vpr_line;
+    return 0;
 }
 
 /*
- * vnaproperty_vcount: return count of elements in given collection
- *   @root:   property data root (can be NULL)
- *   @format: printf-like format string forming the property expression
- *   @ap:     variable argument pointer
+ * copy_subtree: replace the node at destination with a copy of source
+ *   @treep: tree holding destination
+ *   @destination: address of node where copy is placed
+ *   @source: subtree to copy
  */
-int vnaproperty_vcount(const vnaproperty_t *root,
-	const char *format, va_list ap)
+static int copy_subtree(const tree_t *treep,
+	vnaproperty_t **destination, const vnaproperty_t *source)
 {
-    const vnaproperty_t *node;
+    vnaproperty_free(*destination);
+    *destination = null_node(treep->tr_arena);
+    return dfs_copy(treep, destination, source);
+}
 
-    if ((node = get_node(root, format, ap)) == NULL) {
-	return -1;
-    }
-    switch (node->vpr_type) {
-    case VNAPROPERTY_MAP:
-	return map_count(node);
+/*
+ * vnaproperty_copy: copy a subtree
+ *   @destination: address of node where copy is placed
+ *   @source: subtree to copy
+ *
+ *   If the destination is in an arena, the copy is made in the same arena.
+ *   Otherwise, it's made with the destination's allocator, or with the
+ *   global allocator if the destination is NULL.
+ */
+int vnaproperty_copy(vnaproperty_t **destination, const vnaproperty_t *source)
+{
+    return _vnaproperty_copy(NULL, destination, source);
+}
 
-    case VNAPROPERTY_LIST:
-	return list_count(node);
+/*
+ * _vnaproperty_copy: copy a subtree, starting a new tree with vmap
+ *   @vmap: allocator if *destination is NULL, or NULL for global
+ *   @destination: address of node where copy is placed
+ *   @source: subtree to copy
+ */
+int _vnaproperty_copy(const vnamem_allocator_t *vmap,
+	vnaproperty_t **destination, const vnaproperty_t *source)
+{
+    tree_t tree;
 
-    default:
-	break;
-    }
-    errno = EINVAL;
-    return -1;
+    tree_init(&tree, *destination, vmap);
+    return copy_subtree(&tree, destination, source);
 }
 
+
+/***********************************************************************
+ * Arena-Backed Trees
+ **********************************************************************/
+
 /*
- * vnaproperty_vkeys: return a vector of keys for the given map expr
- *   @root:   property data root (can be NULL)
- *   @format: printf-like format string forming the property expression
- *   @ap:     variable argument pointer
+ * vnaproperty_arena_alloc: create an arena for a property tree
+ *   @block_size: size of each block of memory to reserve (0 for default)
  */
-const char **vnaproperty_vkeys(const vnaproperty_t *root,
-	const char *format, va_list ap)
+vnaproperty_arena_t *vnaproperty_arena_alloc(size_t block_size)
 {
-    const vnaproperty_t *node;
-    const vnaproperty_map_t *map;
-    const vnaproperty_map_element_t *vmep;
-    const char **vector, **cpp;
+    vnamem_allocator_t heap;
+    vnaproperty_arena_t *arena;
 
-    if ((node = get_node(root, format, ap)) == NULL) {
+    vnamem_get_allocator(&heap);
+    if ((arena = _vnamem_acalloc(&heap, 1,
+		    sizeof(vnaproperty_arena_t))) == NULL) {
 	return NULL;
     }
-    if (node->vpr_type != VNAPROPERTY_MAP) {
-	errno = EINVAL;
-	return NULL;
-    }
-    map = (vnaproperty_map_t *)node;
-    if ((vector = calloc(map->vpm_count + 1, sizeof(char *))) == NULL) {
+    arena->vpa_heap = heap;
+    if ((arena->vpa_memory = vnamem_arena_alloc(block_size)) == NULL) {
+	_vnamem_afree(&heap, (void *)arena);
 	return NULL;
     }
-    cpp = vector;
-    for (vmep = map->vpm_order_head; vmep != NULL;
-	    vmep = vmep->vme_order_next) {
-	*cpp++ = vmep->vme_pair.vmpr_key;
-    }
-    *cpp = NULL;
-    return vector;
+    vnamem_arena_get_allocator(arena->vpa_memory, &arena->vpa_allocator);
+    arena->vpa_null.vpr_type = VNAPROPERTY_NULL;
+    arena->vpa_null.vpr_arena = arena;
+    arena->vpa_null.vpr_allocator = &arena->vpa_allocator;
+    arena->vpa_root = &arena->vpa_null;
+    return arena;
 }
 
 /*
- * vnaproperty_vget: get a property value from a property expression
- *   @root:   property data root (can be NULL)
- *   @format: printf-like format string forming the property expression
- *   @ap:     variable argument pointer
+ * vnaproperty_arena_get_root: return the address of the arena's root
+ *   @arena: arena
  */
-const char *vnaproperty_vget(const vnaproperty_t *root,
-	const char *format, va_list ap)
+vnaproperty_t **vnaproperty_arena_get_root(vnaproperty_arena_t *arena)
 {
-    const vnaproperty_t *node;
+    return &arena->vpa_root;
+}
 
-    if ((node = get_node(root, format, ap)) == NULL) {
-	return NULL;
-    }
-    if (node->vpr_type != VNAPROPERTY_SCALAR) {
-	errno = EINVAL;
-	return NULL;
-    }
-    return scalar_get(node);
+/*
+ * vnaproperty_arena_get_used: return the number of bytes used by the tree
+ *   @arena: arena
+ */
+size_t vnaproperty_arena_get_used(const vnaproperty_arena_t *arena)
+{
+    return vnamem_arena_get_used(arena->vpa_memory) +
+	arena->vpa_key_table_size * sizeof(arena_key_t);
 }
 
 /*
- * vnaproperty_vset: set a property value from a property expression
- *   @rootptr: address of root property pointer
- *   @format:  printf-like format string forming the property expression
- *   @ap:      variable argument pointer
+ * vnaproperty_arena_free: free the arena and the tree it holds
+ *   @arena: arena (may be NULL)
  */
-int vnaproperty_vset(vnaproperty_t **rootptr, const char *format, va_list ap)
+void vnaproperty_arena_free(vnaproperty_arena_t *arena)
 {
-    parser_t parser;
-    scanner_t *scanner = &parser.prs_scn;
-    vnaproperty_t **anchor;
-    vnaproperty_t *value = NULL;
-    int rv = -1;
+    vnamem_allocator_t heap;
 
-    if ((anchor = parse_and_descend(&parser, rootptr, /*set*/true,
-		    format, ap)) == NULL) {
-	return -1;
+    if (arena == NULL) {
+	return;
     }
+    heap = arena->vpa_heap;
+    vnamem_arena_free(arena->vpa_memory);
+    _vnamem_afree(&heap, (void *)arena->vpa_key_table);
+    _vnamem_afree(&heap, (void *)arena);
+}
 
-    /*
-     * Make sure we're not trying to assign to a map or list.
-     */
-    switch (parser.prs_tail->ex_type) {
-    case E_MAP_ELEMENT:
-    case E_LIST_ELEMENT:
-    case E_LIST_INSERT:
-    case E_LIST_APPEND:
-    case E_DOT:
-	break;
-
-    case E_MAP:
-    case E_LIST:
-    default:
-	errno = EINVAL;
-	goto out;
-    }
 
-    /*
-     * Get the value to assign.
-     *   foo=text	set foo to a scalar with given text
-     *   foo#		set foo to null
-     */
-    switch (scanner->scn_token) {
-    case T_ASSIGN:
-	value = scalar_alloc(scanner->scn_position);
-	if (value == NULL) {
-	    goto out;
-	}
-	break;
+/***********************************************************************
+ * Compiled Property Expressions
+ **********************************************************************/
 
-    case T_HASH:
-	break;
+/*
+ * vnaproperty_path: a compiled property expression
+ */
+struct vnaproperty_path {
+    expr_t	       *vpp_head;	/* expression list head */
+    expr_t	       *vpp_tail;	/* expression list tail */
+    char	       *vpp_text;	/* storage for the map keys */
+    const vnamem_allocator_t *vpp_allocator; /* allocator holding the above */
+};
 
-    default:
+/*
+ * path_descend: descend down the tree along a compiled expression
+ *   @rootptr: address of property data root
+ *   @path:    compiled property expression
+ *   @set:     force the tree to conform to the indicated expression
+ *   @app:     address of arguments for the placeholders
+ *   @dscp:    address of structure to receive where we stopped
+ */
+static vnaproperty_t **path_descend(vnaproperty_t **rootptr,
+	const vnaproperty_path_t *path, bool set, va_list *app,
+	descent_t *dscp)
+{
+    if (path == NULL) {
 	errno = EINVAL;
-	goto out;
+	return NULL;
     }
-
-    /*
-     * Free any old value and install the new value.
-     */
-    vnaproperty_free(*anchor);
-    *anchor = value;
-    rv = 0;
-
-out:
-    parser_free(&parser);
-    return rv;
+    return descend(rootptr, NULL, path->vpp_head, set, app, dscp);
 }
 
 /*
- * vnaproperty_vdelete: delete the value described by format
- *   @rootptr:   address of root property pointer
- *   @format: printf-like format string forming the property expression
- *   @...:    optional variable arguments
+ * path_node: return the node described by a compiled expression
+ *   @root: property data root (can be NULL)
+ *   @path: compiled property expression
+ *   @app:  address of arguments for the placeholders
  */
-int vnaproperty_vdelete(vnaproperty_t **rootptr, const char *format,
-	va_list ap)
+static vnaproperty_t *path_node(const vnaproperty_t *root,
+	const vnaproperty_path_t *path, va_list *app)
 {
-    parser_t parser;
-    scanner_t *scanner = &parser.prs_scn;
-    expr_t *tail;
-    vnaproperty_t **anchor, *collection;
-    int rv = -1;
-
-    /*
-     * Parse the expression and descend to the requested node.
-     */
-    if ((anchor = parse_and_descend(&parser, rootptr, /*set*/false,
-		    format, ap)) == NULL) {
-	return -1;
-    }
-
-    /*
-     * Make sure there are no unexpected trailing tokens.
-     */
-    if (scanner->scn_token != T_EOF) {
-	errno = EINVAL;
-	goto out;
-    }
-
-    /*
-     * Delete the indicated key.
-     */
-    tail = parser.prs_tail;
-    collection = parser.prs_collection;
-    switch (tail->ex_type) {
-    case E_MAP_ELEMENT:
-	assert(collection != NULL);
-	rv = map_delete(collection, tail->u.ex_name);
-	goto out;
-
-    case E_LIST_ELEMENT:
-	assert(collection != NULL);
-	rv = list_delete(collection, tail->u.ex_index);
-	goto out;
+    vnaproperty_t **anchor;
+    descent_t dsc;
 
-    default:
-	vnaproperty_free(*anchor);
-	*anchor = NULL;
+    if ((anchor = path_descend((vnaproperty_t **)&root, path, false, app,
+		    &dsc)) == NULL) {
+	return NULL;
     }
-    rv = 0;
-
-out:
-    parser_free(&parser);
-    return rv;
+    return REAL_NODE(*anchor);
 }
 
 /*
- * vnaproperty_get_subtree: get subtree described by format
- *   @root:   address of root property pointer
- *   @format: printf-like format string forming the property expression
- *   @ap:     variable arguments
+ * vnaproperty_path_compile: compile a property expression for reuse
+ *   @pattern: property expression with %d and %s placeholders
  */
-vnaproperty_t *vnaproperty_vget_subtree(const vnaproperty_t *root,
-	const char *format, va_list ap)
+vnaproperty_path_t *vnaproperty_path_compile(const char *pattern)
 {
     parser_t parser;
-    scanner_t *scanner = &parser.prs_scn;
-    vnaproperty_t **anchor;
+    vnaproperty_path_t *path;
 
-    if ((anchor = parse_and_descend(&parser, (vnaproperty_t **)&root,
-		    /*set*/false, format, ap)) == NULL) {
+    (void)memset((void *)&parser, 0, sizeof(parser));
+    parser.prs_scn.scn_pattern = true;
+    if ((parser.prs_scn.scn_input = _vnamem_strdup(pattern)) == NULL) {
 	return NULL;
     }
-
-    /*
-     * Make sure there are no unexpected trailing tokens.
-     */
-    if (scanner->scn_token != T_EOF) {
+    if (parse_input(&parser) == -1) {
+	return NULL;
+    }
+    if (parser.prs_scn.scn_token != T_EOF) {
+	parser_free(&parser);
 	errno = EINVAL;
-	anchor = NULL;
-	goto out;
+	return NULL;
     }
-
-out:
-    parser_free(&parser);
-    return *anchor;
+    if ((path = _vnamem_malloc(sizeof(vnaproperty_path_t))) == NULL) {
+	parser_free(&parser);
+	return NULL;
+    }
+    path->vpp_head = parser.prs_head;
+    path->vpp_tail = parser.prs_tail;
+    path->vpp_text = parser.prs_scn.scn_input;
+    path->vpp_allocator = _vnamem_get_global_allocator();
+    return path;
 }
 
 /*
- * vnaproperty_set_subtree: make the tree conform and return address of subtree
- *   @rootptr: address of root property pointer
- *   @format:  printf-like format string forming the property expression
- *   @ap:      variable arguments
+ * vnaproperty_path_free: free a compiled property expression
+ *   @path: compiled expression (may be NULL)
  */
-vnaproperty_t **vnaproperty_vset_subtree(vnaproperty_t **rootptr,
-	const char *format, va_list ap)
+void vnaproperty_path_free(vnaproperty_path_t *path)
 {
-    parser_t parser;
-    scanner_t *scanner = &parser.prs_scn;
-    vnaproperty_t **anchor;
+    if (path != NULL) {
+	const vnamem_allocator_t *allocator = path->vpp_allocator;
 
-    if ((anchor = parse_and_descend(&parser, rootptr,
-		    /*set*/true, format, ap)) == NULL) {
-	return NULL;
-    }
+	while (path->vpp_head != NULL) {
+	    expr_t *exp = path->vpp_head;
 
-    /*
-     * Make sure there are no unexpected trailing tokens.
-     */
-    if (scanner->scn_token != T_EOF) {
-	errno = EINVAL;
-	anchor = NULL;
-	goto out;
+	    path->vpp_head = exp->ex_next;
+	    _vnamem_afree(allocator, (void *)exp);
+	}
+	_vnamem_afree(allocator, (void *)path->vpp_text);
+	_vnamem_afree(allocator, (void *)path);
     }
-
-out:
-    parser_free(&parser);
-    return anchor;
 }
 
 /*
- * vnaproperty_type: get the type of the given property expression
- *   @root:   property data root (can be NULL)
- *   @format: printf-like format string forming the expression
- *   @...:    optional variable arguments
+ * vnaproperty_path_type: get the type of a compiled property expression
+ *   @root: property data root (can be NULL)
+ *   @path: compiled property expression
+ *   @...:  arguments for the placeholders
  */
-int vnaproperty_type(const vnaproperty_t *root, const char *format, ...)
+int vnaproperty_path_type(const vnaproperty_t *root,
+	const vnaproperty_path_t *path, ...)
 {
     va_list ap;
     int type;
 
-    va_start(ap, format);
-    type = vnaproperty_vtype(root, format, ap);
+    va_start(ap, path);
+    type = node_type(path_node(root, path, &ap));
     va_end(ap);
 
     return type;
 }
 
 /*
- * vnaproperty_count: return count of elements in given collection
- *   @root:   property data root (can be NULL)
- *   @format: printf-like format string forming the property expression
- *   @...:    optional variable arguments
+ * vnaproperty_path_count: return count of elements in given collection
+ *   @root: property data root (can be NULL)
+ *   @path: compiled property expression
+ *   @...:  arguments for the placeholders
  */
-int vnaproperty_count(const vnaproperty_t *root,
-	const char *format, ...)
+int vnaproperty_path_count(const vnaproperty_t *root,
+	const vnaproperty_path_t *path, ...)
 {
     va_list ap;
     int count;
 
-    va_start(ap, format);
-    count = vnaproperty_vcount(root, format, ap);
+    va_start(ap, path);
+    count = node_count(path_node(root, path, &ap));
     va_end(ap);
 
     return count;
 }
 
 /*
- * vnaproperty_keys: return a vector of keys for the given map expr
- *   @root:   property data root (can be NULL)
- *   @format: printf-like format string forming the property expression
- *   @...:    optional variable arguments
- *
- * Caller can free the vector by a call to free.
+ * vnaproperty_path_keys: return a vector of keys for the given map expr
+ *   @root: property data root (can be NULL)
+ *   @path: compiled property expression
+ *   @...:  arguments for the placeholders
  */
-const char **vnaproperty_keys(const vnaproperty_t *root,
-	const char *format, ...)
+const char **vnaproperty_path_keys(const vnaproperty_t *root,
+	const vnaproperty_path_t *path, ...)
 {
     va_list ap;
     const char **keys;
 
-    va_start(ap, format);
-    keys = vnaproperty_vkeys(root, format, ap);
+    va_start(ap, path);
+    keys = node_keys(path_node(root, path, &ap));
     va_end(ap);
 
     return keys;
 }
 
 /*
- * vnaproperty_get: get a property value from a property expression
- *   @root:   property data root (can be NULL)
- *   @format: printf-like format string forming the property expression
- *   @...:    optional variable arguments
+ * vnaproperty_path_get: get a property value from a compiled expression
+ *   @root: property data root (can be NULL)
+ *   @path: compiled property expression
+ *   @...:  arguments for the placeholders
  */
-const char *vnaproperty_get(const vnaproperty_t *root,
-	const char *format, ...)
+const char *vnaproperty_path_get(const vnaproperty_t *root,
+	const vnaproperty_path_t *path, ...)
 {
     va_list ap;
     const char *value;
 
-    va_start(ap, format);
-    value = vnaproperty_vget(root, format, ap);
+    va_start(ap, path);
+    value = node_value(path_node(root, path, &ap));
     va_end(ap);
 
     return value;
 }
 
 /*
- * vnaproperty_set: set a property value from a property expression
+ * vnaproperty_path_set: set a property value from a compiled expression
  *   @rootptr: address of root property pointer
- *   @format:  printf-like format string forming the property expression
- *   @...:     optional variable arguments
+ *   @path:    compiled property expression
+ *   @value:   value to set, or NULL to set null
+ *   @...:     arguments for the placeholders
  */
-int vnaproperty_set(vnaproperty_t **rootptr, const char *format, ...)
+int vnaproperty_path_set(vnaproperty_t **rootptr,
+	const vnaproperty_path_t *path, const char *value, ...)
 {
     va_list ap;
-    int rv;
+    vnaproperty_t **anchor;
+    descent_t dsc;
+    int rv = -1;
 
-    va_start(ap, format);
-    rv = vnaproperty_vset(rootptr, format, ap);
+    va_start(ap, value);
+    if ((anchor = path_descend(rootptr, path, /*set*/true, &ap,
+		    &dsc)) != NULL) {
+	rv = assign(anchor, path->vpp_tail, value, &dsc);
+    }
     va_end(ap);
 
     return rv;
 }
 
 /*
- * vnaproperty_delete: delete the value described by format
+ * vnaproperty_path_delete: delete the value described by a compiled expr
  *   @rootptr: address of root property pointer
- *   @format:  printf-like format string forming the property expression
- *   @...:     optional variable arguments
+ *   @path:    compiled property expression
+ *   @...:     arguments for the placeholders
  */
-int vnaproperty_delete(vnaproperty_t **rootptr, const char *format, ...)
+int vnaproperty_path_delete(vnaproperty_t **rootptr,
+	const vnaproperty_path_t *path, ...)
 {
     va_list ap;
-    int rv;
+    vnaproperty_t **anchor;
+    descent_t dsc;
+    int rv = -1;
 
-    va_start(ap, format);
-    rv = vnaproperty_vdelete(rootptr, format, ap);
+    va_start(ap, path);
+    if ((anchor = path_descend(rootptr, path, /*set*/false, &ap,
+		    &dsc)) != NULL) {
+	rv = delete(anchor, path->vpp_tail, &dsc);
+    }
     va_end(ap);
 
     return rv;
 }
 
 /*
- * vnaproperty_get_subtree: get subtree described by format
- *   @root:    address of root property pointer
- *   @format:  printf-like format string forming the property expression
- *   @...:     optional variable arguments
+ * vnaproperty_path_get_subtree: get the subtree described by a compiled expr
+ *   @root: property data root (can be NULL)
+ *   @path: compiled property expression
+ *   @...:  arguments for the placeholders
  */
-vnaproperty_t *vnaproperty_get_subtree(const vnaproperty_t *root,
-	const char *format, ...)
+vnaproperty_t *vnaproperty_path_get_subtree(const vnaproperty_t *root,
+	const vnaproperty_path_t *path, ...)
 {
     va_list ap;
     vnaproperty_t *subtree;
 
-    va_start(ap, format);
-    subtree = vnaproperty_vget_subtree(root, format, ap);
+    va_start(ap, path);
+    subtree = path_node(root, path, &ap);
     va_end(ap);
 
     return subtree;
 }
 
 /*
- * vnaproperty_set_subtree: make the tree conform and return address of subtree
+ * vnaproperty_path_set_subtree: make the tree conform and return subtree
  *   @rootptr: address of root property pointer
- *   @format:  printf-like format string forming the property expression
- *   @...:     optional variable arguments
+ *   @path:    compiled property expression
+ *   @...:     arguments for the placeholders
  */
-vnaproperty_t **vnaproperty_set_subtree(vnaproperty_t **rootptr,
-	const char *format, ...)
+vnaproperty_t **vnaproperty_path_set_subtree(vnaproperty_t **rootptr,
+	const vnaproperty_path_t *path, ...)
 {
     va_list ap;
-    vnaproperty_t **subtree;
+    vnaproperty_t **anchor;
+    descent_t dsc;
 
-    va_start(ap, format);
-    subtree = vnaproperty_vset_subtree(rootptr, format, ap);
+    va_start(ap, path);
+    anchor = path_descend(rootptr, path, /*set*/true, &ap, &dsc);
     va_end(ap);
 
-    return subtree;
+    return anchor;
 }
 
 /*
- * vnaproperty_quote_key: quote a map ID that contains reserved chars
- *   @key: map key to quote
- *
- * Caller must free the returned memory by a call to free().
+ * vnaproperty_path_get_int64: get a value as an int64 from a compiled expr
+ *   @root:  property data root (can be NULL)
+ *   @path:  compiled property expression
+ *   @value: address of the result
+ *   @...:   arguments for the placeholders
  */
-char *vnaproperty_quote_key(const char *key)
+int vnaproperty_path_get_int64(const vnaproperty_t *root,
+	const vnaproperty_path_t *path, int64_t *value, ...)
 {
-    int length;
-    bool *map = NULL;
-    int n_special = 0;
-    char *result = NULL;
-    char *cur;
-
-    /*
-     * Handle NULL.
-     */
-    if (key == NULL) {
-	return NULL;
-    }
+    va_list ap;
+    vnaproperty_number_t number;
+    int rv;
 
-    /*
-     * Handle empty string.
-     */
-    if (key[0] == '\000') {
-	result = strdup("");
-	goto out;
+    va_start(ap, value);
+    errno = 0;
+    rv = node_number(path_node(root, path, &ap), VNAPROPERTY_NUMBER_INT64,
+	    &number);
+    va_end(ap);
+    if (rv == 0) {
+	*value = number.vpn_int64;
     }
+    return rv;
+}
 
-    /*
-     * Allocate a vector of bool to record positions of special characters.
-     */
-    length = strlen(key);
-    if ((map = calloc(length, sizeof(bool))) == NULL) {
-	goto out;
-    }
+/*
+ * vnaproperty_path_set_int64: set a value to an int64 from a compiled expr
+ *   @rootptr: address of root property pointer
+ *   @path:    compiled property expression
+ *   @value:   value to set
+ *   @...:     arguments for the placeholders
+ */
+int vnaproperty_path_set_int64(vnaproperty_t **rootptr,
+	const vnaproperty_path_t *path, int64_t value, ...)
+{
+    va_list ap;
+    vnaproperty_t **anchor;
+    vnaproperty_number_t number;
+    descent_t dsc;
+    int rv = -1;
 
-    /*
-     * Find the positions that require quotes.
-     */
-    if (!ISIDCHAR1(key[0]) || key[0] == '\\') {
-	map[0] = true;
-	++n_special;
+    number.vpn_int64 = value;
+    va_start(ap, value);
+    if ((anchor = path_descend(rootptr, path, /*set*/true, &ap,
+		    &dsc)) != NULL) {
+	rv = assign_number(anchor, path->vpp_tail, VNAPROPERTY_NUMBER_INT64,
+		&number, &dsc);
     }
-    {
-	int i;
-
-	for (i = 1; i < length; ++i) {
-	    if (!ISIDCHAR(key[i]) || key[i] == '\\') {
-		map[i] = true;
-		++n_special;
-	    }
-	}
+    va_end(ap);
 
-	/*
-	 * Trailing spaces are special.
-	 */
-	while (i > 1 && key[i - 1] == ' ') {
-	    map[--i] = true;
-	    ++n_special;
-	}
-    }
+    return rv;
+}
 
-    /*
-     * If no quotes required, return a copy of the original string.
-     */
-    if (n_special == 0) {
-	result = strdup(key);
-	goto out;
-    }
+/*
+ * vnaproperty_path_get_double: get a value as a double from a compiled expr
+ *   @root:  property data root (can be NULL)
+ *   @path:  compiled property expression
+ *   @value: address of the result
+ *   @...:   arguments for the placeholders
+ */
+int vnaproperty_path_get_double(const vnaproperty_t *root,
+	const vnaproperty_path_t *path, double *value, ...)
+{
+    va_list ap;
+    vnaproperty_number_t number;
+    int rv;
 
-    /*
-     * Form the new string.
-     */
-    if ((result = malloc(length + n_special + 1)) == NULL) {
-	goto out;
-    }
-    cur = result;
-    for (int i = 0; i < length; ++i) {
-	if (map[i]) {
-	    *cur++ = '\\';
-	}
-	*cur++ = key[i];
+    va_start(ap, value);
+    errno = 0;
+    rv = node_number(path_node(root, path, &ap), VNAPROPERTY_NUMBER_DOUBLE,
+	    &number);
+    va_end(ap);
+    if (rv == 0) {
+	*value = number.vpn_double;
     }
-    *cur = '\000';
-
-out:
-    free((void *)map);
-    return result;
+    return rv;
 }
 
 /*
- * dfs_copy: recursely copy properties
- *   @destination: address of root of the destination tree
- *   @source: root of the source tree
+ * vnaproperty_path_set_double: set a value to a double from a compiled expr
+ *   @rootptr: address of root property pointer
+ *   @path:    compiled property expression
+ *   @value:   value to set
+ *   @...:     arguments for the placeholders
  */
-static int dfs_copy(vnaproperty_t **destination, const vnaproperty_t *source)
+int vnaproperty_path_set_double(vnaproperty_t **rootptr,
+	const vnaproperty_path_t *path, double value, ...)
 {
-    const char **keys = NULL;
-    const char *cp = NULL;
-    int count;
+    va_list ap;
+    vnaproperty_t **anchor;
+    vnaproperty_number_t number;
+    descent_t dsc;
+    int rv = -1;
 
-    if (source == NULL) {
-	return 0;
+    number.vpn_double = value;
+    va_start(ap, value);
+    if ((anchor = path_descend(rootptr, path, /*set*/true, &ap,
+		    &dsc)) != NULL) {
+	rv = assign_number(anchor, path->vpp_tail, VNAPROPERTY_NUMBER_DOUBLE,
+		&number, &dsc);
     }
-    switch (source->vpr_type) {
-    case VNAPROPERTY_SCALAR:
-	if ((cp = scalar_get(source)) != NULL) {
-	    if (vnaproperty_set(destination, ".=%s", cp) == -1) {
-		return -1;
-	    }
-	} else {
-	    if (vnaproperty_set(destination, ".#") == -1) {
-		return -1;
-	    }
-	}
-	break;
-
-    case VNAPROPERTY_MAP:
-	if ((keys = vnaproperty_keys(source, ".")) == NULL) {
-	    return -1;
-	}
-	for (const char **cpp = keys; *cpp != NULL; ++cpp) {
-	    char *key = NULL;
-	    vnaproperty_t **new_destination, *new_source;
-
-	    if ((key = vnaproperty_quote_key(*cpp)) == NULL) {
-		free((void *)keys);
-		return -1;
-	    }
-	    new_destination = vnaproperty_set_subtree(destination, ".%s", key);
-	    if (new_destination == NULL) {
-		free((void *)keys);
-		free((void *)key);
-		return -1;
-	    }
-	    new_source = vnaproperty_get_subtree(source, "%s", key);
-	    if (dfs_copy(new_destination, new_source) == -1) {
-		free((void *)keys);
-		free((void *)key);
-		return -1;
-	    }
-	    free((void *)key);
-	}
-	free((void *)keys);
-	break;
+    va_end(ap);
 
-    case VNAPROPERTY_LIST:
-	count = vnaproperty_count(source, ".");
-	for (int i = 0; i < count; ++i) {
-	    vnaproperty_t **new_destination, *new_source;
+    return rv;
+}
 
-	    new_destination = vnaproperty_set_subtree(destination, "[%d]", i);
-	    if (new_destination == NULL) {
-		return -1;
-	    }
-	    new_source = vnaproperty_get_subtree(source, "[%d]", i);
-	    if (dfs_copy(new_destination, new_source) == -1) {
-		return -1;
-	    }
-	}
-	break;
+/*
+ * vnaproperty_path_get_complex: get a value as a complex from a compiled expr
+ *   @root:  property data root (can be NULL)
+ *   @path:  compiled property expression
+ *   @value: address of the result
+ *   @...:   arguments for the placeholders
+ */
+int vnaproperty_path_get_complex(const vnaproperty_t *root,
+	const vnaproperty_path_t *path, double complex *value, ...)
+{
+    va_list ap;
+    vnaproperty_number_t number;
+    int rv;
 
-    default:
-	abort();
+    va_start(ap, value);
+    errno = 0;
+    rv = node_number(path_node(root, path, &ap), VNAPROPERTY_NUMBER_COMPLEX,
+	    &number);
+    va_end(ap);
+    if (rv == 0) {
+	*value = number.vpn_complex;
     }
-    return 0;
+    return rv;
 }
 
 /*
- * vnaproperty_copy: copy a subtree
- *   @destination: address of node where copy is placed
- *   @source: subtree to copy
+ * vnaproperty_path_set_complex: set a value to a complex from a compiled expr
+ *   @rootptr: address of root property pointer
+ *   @path:    compiled property expression
+ *   @value:   value to set
+ *   @...:     arguments for the placeholders
  */
-int vnaproperty_copy(vnaproperty_t **destination, const vnaproperty_t *source)
+int vnaproperty_path_set_complex(vnaproperty_t **rootptr,
+	const vnaproperty_path_t *path, double complex value, ...)
 {
-    (void)vnaproperty_delete(destination, ".");
-    return dfs_copy(destination, source);
+    va_list ap;
+    vnaproperty_t **anchor;
+    vnaproperty_number_t number;
+    descent_t dsc;
+    int rv = -1;
+
+    number.vpn_complex = value;
+    va_start(ap, value);
+    if ((anchor = path_descend(rootptr, path, /*set*/true, &ap,
+		    &dsc)) != NULL) {
+	rv = assign_number(anchor, path->vpp_tail, VNAPROPERTY_NUMBER_COMPLEX,
+		&number, &dsc);
+    }
+    va_end(ap);
+
+    return rv;
 }
 
 
@@ -2137,6 +3677,21 @@ static bool is_yaml_null_value(const char *s)
 	strcmp(s, "NULL") == 0;
 }
 
+/*
+ * scalar_style: choose the YAML style for a scalar property value
+ *   @value: scalar value
+ */
+static yaml_scalar_style_t scalar_style(const char *value)
+{
+    if (strchr(value, '\n') != NULL) {
+	return YAML_LITERAL_SCALAR_STYLE;
+    }
+    if (is_yaml_null_value(value)) {
+	return YAML_DOUBLE_QUOTED_SCALAR_STYLE;
+    }
+    return YAML_ANY_SCALAR_STYLE;
+}
+
 /*
  * add_mapping_entry: add a simple scalar tag to value mapping entry
  *   @vymlp:    common argument structure
@@ -2167,11 +3722,64 @@ static int add_mapping_entry(vnaproperty_yaml_t *vymlp, int t_map,
 	if (errno == 0) {
 	    errno = EINVAL;
 	}
-	_vnaproperty_yaml_error(vymlp, VNAERR_SYSTEM,
-		"yaml_document_add_mapping_pair: %s: %s",
-		vymlp->vyml_filename, strerror(errno));
+	_vnaproperty_yaml_error(vymlp, VNAERR_SYSTEM,
+		"yaml_document_add_mapping_pair: %s: %s",
+		vymlp->vyml_filename, strerror(errno));
+	return -1;
+    }
+    return 0;
+}
+
+/*
+ * import_collection: make the node at anchor a map or list
+ *   @treep: tree holding the node
+ *   @anchor: address of the node
+ *   @type: VNAPROPERTY_MAP or VNAPROPERTY_LIST
+ *   @line: line number of the YAML node
+ *
+ *   As in vnaproperty_set_subtree, an existing collection of the same
+ *   type is kept so that the imported elements merge into it.
+ */
+static vnaproperty_t *import_collection(const tree_t *treep,
+	vnaproperty_t **anchor, vnaproperty_type_t type, int line)
+{
+    vnaproperty_t *node = REAL_NODE(*anchor);
+
+    if (node == NULL || node->vpr_type != type) {
+	vnaproperty_free(node);
+	*anchor = null_node(treep->tr_arena);
+	if (type == VNAPROPERTY_MAP) {
+	    node = map_alloc(treep);
+	} else {
+	    node = list_alloc(treep);
+	}
+	if (node == NULL) {
+	    return NULL;
+	}
+	*anchor = node;
+    }
+    node->vpr_line = line;
+    return node;
+}
+
+/*
+ * import_scalar: replace the node at anchor with a scalar
+ *   @treep: tree holding the node
+ *   @anchor: address of the node
+ *   @value: value of the scalar
+ *   @line: line number of the YAML node
+ */
+static int import_scalar(const tree_t *treep,
+	vnaproperty_t **anchor, const char *value, int line)
+{
+    vnaproperty_t *node;
+
+    if ((node = scalar_alloc(treep, value)) == NULL) {
 	return -1;
     }
+    vnaproperty_free(*anchor);
+    *anchor = node;
+    node->vpr_line = line;
     return 0;
 }
 
@@ -2202,16 +3810,17 @@ int _vnaproperty_get_line(const vnaproperty_t *vprp)
 }
 
 /*
- * _vnaproperty_yaml_import: import properties from the given YAML document
+ * import_node: import properties from a node of a YAML document
  *   @vymlp:    common argument structure
- *   @rootptr:  address of property tree root
- *   @vp_node:  yaml node cast to void pointer
+ *   @treep:    tree holding the node
+ *   @anchor:   address of the property node to replace
+ *   @node:     yaml node
  */
-int _vnaproperty_yaml_import(vnaproperty_yaml_t *vymlp,
-	vnaproperty_t **rootptr, void *vp_node)
+static int import_node(vnaproperty_yaml_t *vymlp, const tree_t *treep,
+	vnaproperty_t **anchor, yaml_node_t *node)
 {
     yaml_document_t *document = vymlp->vyml_document;
-    yaml_node_t *node = vp_node;
+    vnaproperty_t *collection;
 
     switch (node->type) {
     case YAML_SCALAR_NODE:
@@ -2230,27 +3839,26 @@ int _vnaproperty_yaml_import(vnaproperty_yaml_t *vymlp,
 	/*
 	 * Handle scalars.
 	 */
-	if (vnaproperty_set(rootptr, ".=%s",
-		    (const char *)node->data.scalar.value) == -1) {
+	if (import_scalar(treep, anchor, (const char *)node->data.scalar.value,
+		    node->start_mark.line) == -1) {
 	    _vnaproperty_yaml_error(vymlp, VNAERR_SYSTEM,
-		    "_vnaproperty_set: %s: %s",
+		    "malloc: %s: %s",
 		    vymlp->vyml_filename, strerror(errno));
 	    goto out;
 	}
-	(*rootptr)->vpr_line = node->start_mark.line;
 	return 0;
 
     case YAML_MAPPING_NODE:
 	{
 	    yaml_node_pair_t *pair;
 
-	    if (vnaproperty_set_subtree(rootptr, "{}") == NULL) {
+	    if ((collection = import_collection(treep, anchor,
+			    VNAPROPERTY_MAP, node->start_mark.line)) == NULL) {
 		_vnaproperty_yaml_error(vymlp, VNAERR_SYSTEM,
-			"_vnaproperty_set_subtree: %s: %s",
+			"malloc: %s: %s",
 			vymlp->vyml_filename, strerror(errno));
 		goto out;
 	    }
-	    (*rootptr)->vpr_line = node->start_mark.line;
 	    for (pair = node->data.mapping.pairs.start;
 		    pair < node->data.mapping.pairs.top; ++pair) {
 		yaml_node_t *key, *value;
@@ -2265,14 +3873,14 @@ int _vnaproperty_yaml_import(vnaproperty_yaml_t *vymlp,
 		    continue;
 		}
 		value = yaml_document_get_node(document, pair->value);
-		if ((subtree = vnaproperty_set_subtree(rootptr, "%s",
+		if ((subtree = map_subtree(collection, /*add*/true,
 			    (const char *)key->data.scalar.value)) == NULL) {
 		    _vnaproperty_yaml_error(vymlp, VNAERR_SYSTEM,
-			    "_vnaproperty_set_subtree: %s: %s",
+			    "malloc: %s: %s",
 			    vymlp->vyml_filename, strerror(errno));
 		    goto out;
 		}
-		if (_vnaproperty_yaml_import(vymlp, subtree, value) == -1) {
+		if (import_node(vymlp, treep, subtree, value) == -1) {
 		    goto out;
 		}
 	    }
@@ -2283,13 +3891,14 @@ int _vnaproperty_yaml_import(vnaproperty_yaml_t *vymlp,
 	{
 	    yaml_node_item_t *item;
 
-	    if (vnaproperty_set_subtree(rootptr, "[]") == NULL) {
+	    collection = import_collection(treep, anchor, VNAPROPERTY_LIST,
+		    node->start_mark.line);
+	    if (collection == NULL) {
 		_vnaproperty_yaml_error(vymlp, VNAERR_SYSTEM,
-			"_vnaproperty_set_subtree: %s: %s",
+			"malloc: %s: %s",
 			vymlp->vyml_filename, strerror(errno));
 		goto out;
 	    }
-	    (*rootptr)->vpr_line = node->start_mark.line;
 	    for (item = node->data.sequence.items.start;
 		    item < node->data.sequence.items.top; ++item) {
 		int index = item - node->data.sequence.items.start;
@@ -2297,14 +3906,14 @@ int _vnaproperty_yaml_import(vnaproperty_yaml_t *vymlp,
 		vnaproperty_t **subtree;
 
 		value = yaml_document_get_node(document, *item);
-		if ((subtree = vnaproperty_set_subtree(rootptr, "[%d]",
+		if ((subtree = list_subtree(collection, /*add*/true,
 				index)) == NULL) {
 		    _vnaproperty_yaml_error(vymlp, VNAERR_SYSTEM,
-			    "_vnaproperty_set_subtree: %s: %s",
+			    "malloc: %s: %s",
 			    vymlp->vyml_filename, strerror(errno));
 		    goto out;
 		}
-		if (_vnaproperty_yaml_import(vymlp, subtree, value) == -1) {
+		if (import_node(vymlp, treep, subtree, value) == -1) {
 		    goto out;
 		}
 	    }
@@ -2319,6 +3928,303 @@ out:
     return -1;
 }
 
+/*
+ * _vnaproperty_yaml_import: import properties from the given YAML document
+ *   @vymlp:    common argument structure
+ *   @rootptr:  address of property tree root
+ *   @vp_node:  yaml node cast to void pointer
+ *
+ *   If the root is in an arena, the properties are imported into the
+ *   same arena.  If the root is NULL, the new tree uses the allocator
+ *   in vymlp, if any.
+ */
+int _vnaproperty_yaml_import(vnaproperty_yaml_t *vymlp,
+	vnaproperty_t **rootptr, void *vp_node)
+{
+    tree_t tree;
+
+    tree_init(&tree, *rootptr, vymlp->vyml_allocator);
+    return import_node(vymlp, &tree, rootptr, (yaml_node_t *)vp_node);
+}
+
+/*
+ * yaml_anchor_t: anchored property subtree remembered for aliases
+ */
+typedef struct yaml_anchor {
+    struct yaml_anchor *ya_next;
+    char *ya_name;
+    vnaproperty_t *ya_value;
+} yaml_anchor_t;
+
+/*
+ * parse_event: get the next event from the parser
+ *   @vymlp:    common argument structure
+ *   @parser:   yaml parser
+ *   @event:    event structure to fill
+ */
+static int parse_event(vnaproperty_yaml_t *vymlp, yaml_parser_t *parser,
+	yaml_event_t *event)
+{
+    if (!yaml_parser_parse(parser, event)) {
+	_vnaproperty_yaml_error(vymlp, VNAERR_SYNTAX,
+		"%s (line %ld) error: %s", vymlp->vyml_filename,
+		(long)parser->problem_mark.line + 1 + vymlp->vyml_line_offset,
+		parser->problem);
+	return -1;
+    }
+    return 0;
+}
+
+/*
+ * add_anchor: remember an anchored subtree so that aliases can copy it
+ *   @vymlp:    common argument structure
+ *   @name:     anchor name
+ *   @value:    subtree to remember
+ */
+static int add_anchor(vnaproperty_yaml_t *vymlp, const char *name,
+	const vnaproperty_t *value)
+{
+    yaml_anchor_t *yap;
+
+    if ((yap = _vnamem_calloc(1, sizeof(yaml_anchor_t))) == NULL) {
+	_vnaproperty_yaml_error(vymlp, VNAERR_SYSTEM, "calloc: %s",
+		strerror(errno));
+	return -1;
+    }
+    if ((yap->ya_name = _vnamem_strdup(name)) == NULL) {
+	_vnaproperty_yaml_error(vymlp, VNAERR_SYSTEM, "strdup: %s",
+		strerror(errno));
+	_vnamem_free((void *)yap);
+	return -1;
+    }
+    if (vnaproperty_copy(&yap->ya_value, value) == -1) {
+	_vnaproperty_yaml_error(vymlp, VNAERR_SYSTEM, "vnaproperty_copy: %s",
+		strerror(errno));
+	_vnamem_free((void *)yap->ya_name);
+	_vnamem_free((void *)yap);
+	return -1;
+    }
+    yap->ya_next = vymlp->vyml_anchors;
+    vymlp->vyml_anchors = yap;
+    return 0;
+}
+
+/*
+ * _vnaproperty_yaml_free_anchors: free anchors saved during parsing
+ *   @vymlp:    common argument structure
+ */
+void _vnaproperty_yaml_free_anchors(vnaproperty_yaml_t *vymlp)
+{
+    yaml_anchor_t *yap;
+
+    while ((yap = vymlp->vyml_anchors) != NULL) {
+	vymlp->vyml_anchors = yap->ya_next;
+	(void)vnaproperty_delete(&yap->ya_value, ".");
+	_vnamem_free((void *)yap->ya_name);
+	_vnamem_free((void *)yap);
+    }
+}
+
+/*
+ * parse_node: build a property subtree from parser events
+ *   @vymlp:     common argument structure
+ *   @treep:     tree holding the node
+ *   @rootptr:   address of the property node to replace
+ *   @parser:    yaml parser
+ *   @event:     first event of the node
+ */
+static int parse_node(vnaproperty_yaml_t *vymlp, const tree_t *treep,
+	vnaproperty_t **rootptr, yaml_parser_t *parser, yaml_event_t *event)
+{
+    const yaml_char_t *anchor = NULL;
+    vnaproperty_t *collection;
+
+    switch (event->type) {
+    case YAML_ALIAS_EVENT:
+	{
+	    const char *name = (const char *)event->data.alias.anchor;
+	    yaml_anchor_t *yap;
+
+	    for (yap = vymlp->vyml_anchors; yap != NULL; yap = yap->ya_next) {
+		if (strcmp(yap->ya_name, name) == 0) {
+		    break;
+		}
+	    }
+	    if (yap == NULL) {
+		_vnaproperty_yaml_error(vymlp, VNAERR_SYNTAX,
+			"%s (line %ld) error: undefined alias: %s",
+			vymlp->vyml_filename, (long)event->start_mark.line +
+			1 + vymlp->vyml_line_offset, name);
+		return -1;
+	    }
+	    if (copy_subtree(treep, rootptr, yap->ya_value) == -1) {
+		_vnaproperty_yaml_error(vymlp, VNAERR_SYSTEM,
+			"vnaproperty_copy: %s: %s",
+			vymlp->vyml_filename, strerror(errno));
+		return -1;
+	    }
+	    return 0;
+	}
+
+    case YAML_SCALAR_EVENT:
+	/*
+	 * Handle NULL as in _vnaproperty_yaml_import.
+	 */
+	anchor = event->data.scalar.anchor;
+	if (is_yaml_null_value((const char *)event->data.scalar.value) &&
+		event->data.scalar.style == YAML_PLAIN_SCALAR_STYLE) {
+	    break;	/* root is already NULL */
+	}
+	if (import_scalar(treep, rootptr,
+		    (const char *)event->data.scalar.value,
+		    event->start_mark.line) == -1) {
+	    _vnaproperty_yaml_error(vymlp, VNAERR_SYSTEM,
+		    "malloc: %s: %s",
+		    vymlp->vyml_filename, strerror(errno));
+	    return -1;
+	}
+	break;
+
+    case YAML_MAPPING_START_EVENT:
+	anchor = event->data.mapping_start.anchor;
+	if ((collection = import_collection(treep, rootptr, VNAPROPERTY_MAP,
+			event->start_mark.line)) == NULL) {
+	    _vnaproperty_yaml_error(vymlp, VNAERR_SYSTEM,
+		    "malloc: %s: %s",
+		    vymlp->vyml_filename, strerror(errno));
+	    return -1;
+	}
+	for (;;) {
+	    yaml_event_t key, value;
+	    vnaproperty_t *ignored = NULL;
+	    tree_t ignored_tree;
+	    vnaproperty_t **subtree;
+	    int rv;
+
+	    if (parse_event(vymlp, parser, &key) == -1) {
+		return -1;
+	    }
+	    if (key.type == YAML_MAPPING_END_EVENT) {
+		yaml_event_delete(&key);
+		break;
+	    }
+	    if (key.type != YAML_SCALAR_EVENT) {
+		_vnaproperty_yaml_error(vymlp, VNAERR_WARNING,
+			"%s (line %ld) warning: "
+			"non-scalar property key ignored\n",
+			vymlp->vyml_filename, (long)key.start_mark.line +
+			1 + vymlp->vyml_line_offset);
+		subtree = &ignored;
+		tree_init(&ignored_tree, NULL, NULL);
+		rv = parse_node(vymlp, &ignored_tree, subtree, parser, &key);
+		(void)vnaproperty_delete(subtree, ".");
+		if (rv == -1) {
+		    yaml_event_delete(&key);
+		    return -1;
+		}
+	    } else if ((subtree = map_subtree(collection, /*add*/true,
+			    (const char *)key.data.scalar.value)) == NULL) {
+		_vnaproperty_yaml_error(vymlp, VNAERR_SYSTEM,
+			"malloc: %s: %s",
+			vymlp->vyml_filename, strerror(errno));
+		yaml_event_delete(&key);
+		return -1;
+	    }
+	    yaml_event_delete(&key);
+	    if (parse_event(vymlp, parser, &value) == -1) {
+		(void)vnaproperty_delete(&ignored, ".");
+		return -1;
+	    }
+	    if (subtree == &ignored) {
+		tree_init(&ignored_tree, NULL, NULL);
+	    }
+	    rv = parse_node(vymlp, subtree == &ignored ? &ignored_tree : treep,
+		    subtree, parser, &value);
+	    yaml_event_delete(&value);
+	    (void)vnaproperty_delete(&ignored, ".");
+	    if (rv == -1) {
+		return -1;
+	    }
+	}
+	break;
+
+    case YAML_SEQUENCE_START_EVENT:
+	anchor = event->data.sequence_start.anchor;
+	if ((collection = import_collection(treep, rootptr, VNAPROPERTY_LIST,
+			event->start_mark.line)) == NULL) {
+	    _vnaproperty_yaml_error(vymlp, VNAERR_SYSTEM,
+		    "malloc: %s: %s",
+		    vymlp->vyml_filename, strerror(errno));
+	    return -1;
+	}
+	for (int index = 0; ; ++index) {
+	    yaml_event_t value;
+	    vnaproperty_t **subtree;
+	    int rv;
+
+	    if (parse_event(vymlp, parser, &value) == -1) {
+		return -1;
+	    }
+	    if (value.type == YAML_SEQUENCE_END_EVENT) {
+		yaml_event_delete(&value);
+		break;
+	    }
+	    if ((subtree = list_subtree(collection, /*add*/true,
+			    index)) == NULL) {
+		_vnaproperty_yaml_error(vymlp, VNAERR_SYSTEM,
+			"malloc: %s: %s",
+			vymlp->vyml_filename, strerror(errno));
+		yaml_event_delete(&value);
+		return -1;
+	    }
+	    rv = parse_node(vymlp, treep, subtree, parser, &value);
+	    yaml_event_delete(&value);
+	    if (rv == -1) {
+		return -1;
+	    }
+	}
+	break;
+
+    default:
+	_vnaproperty_yaml_error(vymlp, VNAERR_INTERNAL,
+		"%s (line %ld) error: unexpected YAML event %d",
+		vymlp->vyml_filename, (long)event->start_mark.line +
+		1 + vymlp->vyml_line_offset, (int)event->type);
+	return -1;
+    }
+    if (anchor != NULL && add_anchor(vymlp, (const char *)anchor,
+		*rootptr) == -1) {
+	return -1;
+    }
+    return 0;
+}
+
+/*
+ * _vnaproperty_yaml_parse: build a property subtree from parser events
+ *   @vymlp:     common argument structure
+ *   @rootptr:   address of property tree root
+ *   @vp_parser: yaml_parser_t cast to void pointer
+ *   @vp_event:  first event of the node cast to void pointer
+ *
+ *   This is the event-driven counterpart of _vnaproperty_yaml_import,
+ *   used by loaders that process most of the file themselves and want
+ *   property trees only for selected nodes.  The caller owns the first
+ *   event; we consume and delete the remaining events of the node.
+ *   Anchors are remembered in vymlp until the caller frees them with
+ *   _vnaproperty_yaml_free_anchors.  If the root is in an arena, the
+ *   properties are built in the same arena.  If the root is NULL, the
+ *   new tree uses the allocator in vymlp, if any.
+ */
+int _vnaproperty_yaml_parse(vnaproperty_yaml_t *vymlp,
+	vnaproperty_t **rootptr, void *vp_parser, void *vp_event)
+{
+    tree_t tree;
+
+    tree_init(&tree, *rootptr, vymlp->vyml_allocator);
+    return parse_node(vymlp, &tree, rootptr, (yaml_parser_t *)vp_parser,
+	    (yaml_event_t *)vp_event);
+}
+
 /*
  * _vnaproperty_yaml_export: add a property list to the YAML document
  *   @vymlp:    common argument structure
@@ -2333,7 +4239,7 @@ int _vnaproperty_yaml_export(vnaproperty_yaml_t *vymlp,
     /*
      * Handle NULL
      */
-    if (root == NULL) {
+    if ((root = REAL_NODE(root)) == NULL) {
 	int scalar;
 	static const char *value = "~";
 
@@ -2360,7 +4266,6 @@ int _vnaproperty_yaml_export(vnaproperty_yaml_t *vymlp,
 	{
 	    int scalar;
 	    const char *value;
-	    yaml_scalar_style_t style = YAML_ANY_SCALAR_STYLE;
 
 	    if ((value = vnaproperty_get(root, ".")) == NULL) {
 		_vnaproperty_yaml_error(vymlp, VNAERR_INTERNAL,
@@ -2368,14 +4273,10 @@ int _vnaproperty_yaml_export(vnaproperty_yaml_t *vymlp,
 			__func__, vymlp->vyml_filename, strerror(errno));
 		return -1;
 	    }
-	    if (strchr(value, '\n') != NULL) {
-		style = YAML_LITERAL_SCALAR_STYLE;
-	    } else if (is_yaml_null_value(value)) {
-		style = YAML_DOUBLE_QUOTED_SCALAR_STYLE;
-	    }
 	    errno = 0;
 	    if ((scalar = yaml_document_add_scalar(document, NULL,
-			    (yaml_char_t *)value, strlen(value), style)) == 0) {
+			    (yaml_char_t *)value, strlen(value),
+			    scalar_style(value))) == 0) {
 		if (errno == 0) {
 		    errno = EINVAL;
 		}
@@ -2477,3 +4378,168 @@ int _vnaproperty_yaml_export(vnaproperty_yaml_t *vymlp,
     }
     abort();
 }
+
+/*
+ * _vnaproperty_yaml_emit_event: send an event to the YAML emitter
+ *   @vymlp: common argument structure
+ *   @event: initialized yaml_event_t, consumed by this function
+ */
+int _vnaproperty_yaml_emit_event(vnaproperty_yaml_t *vymlp, void *event)
+{
+    yaml_emitter_t *emitter = vymlp->vyml_emitter;
+
+    errno = 0;
+    if (!yaml_emitter_emit(emitter, (yaml_event_t *)event)) {
+	if (errno == 0) {
+	    errno = EINVAL;
+	}
+	_vnaproperty_yaml_error(vymlp, VNAERR_SYSTEM,
+		"yaml_emitter_emit: %s: %s", vymlp->vyml_filename,
+		emitter->problem != NULL ? emitter->problem : strerror(errno));
+	return -1;
+    }
+    return 0;
+}
+
+/*
+ * emit_scalar: send a scalar event with the given style
+ *   @vymlp: common argument structure
+ *   @value: scalar text
+ *   @style: YAML scalar style
+ */
+static int emit_scalar(vnaproperty_yaml_t *vymlp, const char *value,
+	yaml_scalar_style_t style)
+{
+    yaml_event_t event;
+
+    errno = 0;
+    if (!yaml_scalar_event_initialize(&event, NULL, NULL,
+		(yaml_char_t *)value, strlen(value), 1, 1, style)) {
+	if (errno == 0) {
+	    errno = ENOMEM;
+	}
+	_vnaproperty_yaml_error(vymlp, VNAERR_SYSTEM,
+		"yaml_scalar_event_initialize: %s: %s",
+		vymlp->vyml_filename, strerror(errno));
+	return -1;
+    }
+    return _vnaproperty_yaml_emit_event(vymlp, &event);
+}
+
+/*
+ * _vnaproperty_yaml_emit_key: emit a map key as the tree export would
+ *   @vymlp: common argument structure
+ *   @key: map key
+ */
+int _vnaproperty_yaml_emit_key(vnaproperty_yaml_t *vymlp, const char *key)
+{
+    return emit_scalar(vymlp, key, YAML_ANY_SCALAR_STYLE);
+}
+
+/*
+ * _vnaproperty_yaml_emit_scalar: emit a value as the tree export would
+ *   @vymlp: common argument structure
+ *   @value: scalar value, or NULL for a YAML null
+ */
+int _vnaproperty_yaml_emit_scalar(vnaproperty_yaml_t *vymlp,
+	const char *value)
+{
+    if (value == NULL) {
+	return emit_scalar(vymlp, "~", YAML_PLAIN_SCALAR_STYLE);
+    }
+    return emit_scalar(vymlp, value, scalar_style(value));
+}
+
+/*
+ * _vnaproperty_yaml_emit: send a property list to the YAML emitter
+ *   @vymlp: common argument structure
+ *   @root:  property list root
+ *
+ *   Produces the same events that dumping the document built by
+ *   _vnaproperty_yaml_export would, without building the document.
+ */
+int _vnaproperty_yaml_emit(vnaproperty_yaml_t *vymlp,
+	const vnaproperty_t *root)
+{
+    yaml_event_t event;
+
+    if ((root = REAL_NODE(root)) == NULL) {
+	return _vnaproperty_yaml_emit_scalar(vymlp, NULL);
+    }
+    switch (root->vpr_type) {
+    case VNAPROPERTY_SCALAR:
+	{
+	    const char *value;
+
+	    if ((value = vnaproperty_get(root, ".")) == NULL) {
+		_vnaproperty_yaml_error(vymlp, VNAERR_INTERNAL,
+			"%s: _vnaproperty_get: %s: %s",
+			__func__, vymlp->vyml_filename, strerror(errno));
+		return -1;
+	    }
+	    return _vnaproperty_yaml_emit_scalar(vymlp, value);
+	}
+
+    case VNAPROPERTY_MAP:
+	{
+	    const char **keys = NULL;
+
+	    if ((keys = vnaproperty_keys(root, "{}")) == NULL) {
+		_vnaproperty_yaml_error(vymlp, VNAERR_SYSTEM,
+			"vnaproperty_keys: %s", strerror(errno));
+		return -1;
+	    }
+	    (void)yaml_mapping_start_event_initialize(&event, NULL, NULL, 1,
+		    YAML_ANY_MAPPING_STYLE);
+	    if (_vnaproperty_yaml_emit_event(vymlp, &event) == -1) {
+		free((void *)keys);
+		return -1;
+	    }
+	    for (const char **cpp = keys; *cpp != NULL; ++cpp) {
+		char *key = NULL;
+		vnaproperty_t *subtree;
+
+		if ((key = vnaproperty_quote_key(*cpp)) == NULL) {
+		    free((void *)keys);
+		    return -1;
+		}
+		subtree = vnaproperty_get_subtree(root, "%s", key);
+		if (_vnaproperty_yaml_emit_key(vymlp, key) == -1 ||
+			_vnaproperty_yaml_emit(vymlp, subtree) == -1) {
+		    free((void *)keys);
+		    free((void *)key);
+		    return -1;
+		}
+		free((void *)key);
+	    }
+	    free((void *)keys);
+	    (void)yaml_mapping_end_event_initialize(&event);
+	    return _vnaproperty_yaml_emit_event(vymlp, &event);
+	}
+
+    case VNAPROPERTY_LIST:
+	{
+	    int count = vnaproperty_count(root, "[]");
+
+	    (void)yaml_sequence_start_event_initialize(&event, NULL, NULL, 1,
+		    YAML_ANY_SEQUENCE_STYLE);
+	    if (_vnaproperty_yaml_emit_event(vymlp, &event) == -1) {
+		return -1;
+	    }
+	    for (int i = 0; i < count; ++i) {
+		vnaproperty_t *subtree;
+
+		subtree = vnaproperty_get_subtree(root, "[%d]", i);
+		if (_vnaproperty_yaml_emit(vymlp, subtree) == -1) {
+		    return -1;
+		}
+	    }
+	    (void)yaml_sequence_end_event_initialize(&event);
+	    return _vnaproperty_yaml_emit_event(vymlp, &event);
+	}
+
+    default:
+	break;
+    }
+    abort();
+}
@@ -19,7 +19,9 @@
 #ifndef _VNAPROPERTY_H
 #define _VNAPROPERTY_H
 
+#include <complex.h>
 #include <stdarg.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <vnaerr.h>
@@ -145,6 +147,90 @@ extern vnaproperty_t **vnaproperty_vset_subtree(vnaproperty_t **rootptr,
 #endif
 ;
 
+/*
+ * vnaproperty_vget_int64: get a property value as an int64
+ *   @root:   property data root (can be NULL)
+ *   @value:  address of the result
+ *   @format: printf-like format string forming the property expression
+ *   @ap:     variable arguments
+ */
+extern int vnaproperty_vget_int64(const vnaproperty_t *root, int64_t *value,
+	const char *format, va_list ap)
+#ifdef __GNUC__
+    __attribute__((__format__(__printf__, 3, 0)))
+#endif
+;
+
+/*
+ * vnaproperty_vset_int64: set a property value to an int64
+ *   @rootptr: address of root property pointer
+ *   @value:   value to set
+ *   @format:  printf-like format string forming the property expression
+ *   @ap:      variable arguments
+ */
+extern int vnaproperty_vset_int64(vnaproperty_t **rootptr, int64_t value,
+	const char *format, va_list ap)
+#ifdef __GNUC__
+    __attribute__((__format__(__printf__, 3, 0)))
+#endif
+;
+
+/*
+ * vnaproperty_vget_double: get a property value as a double
+ *   @root:   property data root (can be NULL)
+ *   @value:  address of the result
+ *   @format: printf-like format string forming the property expression
+ *   @ap:     variable arguments
+ */
+extern int vnaproperty_vget_double(const vnaproperty_t *root, double *value,
+	const char *format, va_list ap)
+#ifdef __GNUC__
+    __attribute__((__format__(__printf__, 3, 0)))
+#endif
+;
+
+/*
+ * vnaproperty_vset_double: set a property value to a double
+ *   @rootptr: address of root property pointer
+ *   @value:   value to set
+ *   @format:  printf-like format string forming the property expression
+ *   @ap:      variable arguments
+ */
+extern int vnaproperty_vset_double(vnaproperty_t **rootptr, double value,
+	const char *format, va_list ap)
+#ifdef __GNUC__
+    __attribute__((__format__(__printf__, 3, 0)))
+#endif
+;
+
+/*
+ * vnaproperty_vget_complex: get a property value as a complex
+ *   @root:   property data root (can be NULL)
+ *   @value:  address of the result
+ *   @format: printf-like format string forming the property expression
+ *   @ap:     variable arguments
+ */
+extern int vnaproperty_vget_complex(const vnaproperty_t *root,
+	double complex *value, const char *format, va_list ap)
+#ifdef __GNUC__
+    __attribute__((__format__(__printf__, 3, 0)))
+#endif
+;
+
+/*
+ * vnaproperty_vset_complex: set a property value to a complex
+ *   @rootptr: address of root property pointer
+ *   @value:   value to set
+ *   @format:  printf-like format string forming the property expression
+ *   @ap:      variable arguments
+ */
+extern int vnaproperty_vset_complex(vnaproperty_t **rootptr,
+	double complex value, const char *format, va_list ap)
+#ifdef __GNUC__
+    __attribute__((__format__(__printf__, 3, 0)))
+#endif
+;
+
 /*
  * vnaproperty_type: get the type of the given property expression
  *   @root:   property data root (can be NULL)
@@ -257,6 +343,248 @@ extern vnaproperty_t **vnaproperty_set_subtree(vnaproperty_t **rootptr,
 #endif
 ;
 
+/*
+ * vnaproperty_get_int64: get a property value as an int64
+ *   @root:   property data root (can be NULL)
+ *   @value:  address of the result
+ *   @format: printf-like format string forming the property expression
+ *   @...:    optional variable arguments
+ */
+extern int vnaproperty_get_int64(const vnaproperty_t *root, int64_t *value,
+	const char *format, ...)
+#ifdef __GNUC__
+    __attribute__((__format__(__printf__, 3, 4)))
+#endif
+;
+
+/*
+ * vnaproperty_set_int64: set a property value to an int64
+ *   @rootptr: address of root property pointer
+ *   @value:   value to set
+ *   @format:  printf-like format string forming the property expression
+ *   @...:     optional variable arguments
+ */
+extern int vnaproperty_set_int64(vnaproperty_t **rootptr, int64_t value,
+	const char *format, ...)
+#ifdef __GNUC__
+    __attribute__((__format__(__printf__, 3, 4)))
+#endif
+;
+
+/*
+ * vnaproperty_get_double: get a property value as a double
+ *   @root:   property data root (can be NULL)
+ *   @value:  address of the result
+ *   @format: printf-like format string forming the property expression
+ *   @...:    optional variable arguments
+ */
+extern int vnaproperty_get_double(const vnaproperty_t *root, double *value,
+	const char *format, ...)
+#ifdef __GNUC__
+    __attribute__((__format__(__printf__, 3, 4)))
+#endif
+;
+
+/*
+ * vnaproperty_set_double: set a property value to a double
+ *   @rootptr: address of root property pointer
+ *   @value:   value to set
+ *   @format:  printf-like format string forming the property expression
+ *   @...:     optional variable arguments
+ */
+extern int vnaproperty_set_double(vnaproperty_t **rootptr, double value,
+	const char *format, ...)
+#ifdef __GNUC__
+    __attribute__((__format__(__printf__, 3, 4)))
+#endif
+;
+
+/*
+ * vnaproperty_get_complex: get a property value as a complex
+ *   @root:   property data root (can be NULL)
+ *   @value:  address of the result
+ *   @format: printf-like format string forming the property expression
+ *   @...:    optional variable arguments
+ */
+extern int vnaproperty_get_complex(const vnaproperty_t *root,
+	double complex *value, const char *format, ...)
+#ifdef __GNUC__
+    __attribute__((__format__(__printf__, 3, 4)))
+#endif
+;
+
+/*
+ * vnaproperty_set_complex: set a property value to a complex
+ *   @rootptr: address of root property pointer
+ *   @value:   value to set
+ *   @format:  printf-like format string forming the property expression
+ *   @...:     optional variable arguments
+ */
+extern int vnaproperty_set_complex(vnaproperty_t **rootptr,
+	double complex value, const char *format, ...)
+#ifdef __GNUC__
+    __attribute__((__format__(__printf__, 3, 4)))
+#endif
+;
+
+/*
+ * vnaproperty_path_t: property expression compiled by vnaproperty_path_compile
+ */
+typedef struct vnaproperty_path vnaproperty_path_t;
+
+/*
+ * vnaproperty_path_compile: compile a property expression for reuse
+ *   @pattern: property expression with %d and %s placeholders
+ *
+ *   A %d placeholder stands for a list index and takes an int argument;
+ *   %s stands for a map key and takes a const char * argument, used as
+ *   is without quoting.  The other characters are as in the expressions
+ *   of the functions above.  Expressions passed to vnaproperty_path_set
+ *   don't include the "=value" or "#" part.
+ */
+extern vnaproperty_path_t *vnaproperty_path_compile(const char *pattern);
+
+/*
+ * vnaproperty_path_free: free a compiled property expression
+ *   @path: compiled expression (may be NULL)
+ */
+extern void vnaproperty_path_free(vnaproperty_path_t *path);
+
+/*
+ * vnaproperty_path_type: get the type of a compiled property expression
+ *   @root: property data root (can be NULL)
+ *   @path: compiled property expression
+ *   @...:  arguments for the placeholders
+ */
+extern int vnaproperty_path_type(const vnaproperty_t *root,
+	const vnaproperty_path_t *path, ...);
+
+/*
+ * vnaproperty_path_count: return count of elements in given collection
+ *   @root: property data root (can be NULL)
+ *   @path: compiled property expression
+ *   @...:  arguments for the placeholders
+ */
+extern int vnaproperty_path_count(const vnaproperty_t *root,
+	const vnaproperty_path_t *path, ...);
+
+/*
+ * vnaproperty_path_keys: return a vector of keys for the given map expr
+ *   @root: property data root (can be NULL)
+ *   @path: compiled property expression
+ *   @...:  arguments for the placeholders
+ *
+ * Caller can free the vector by a call to free.
+ */
+extern const char **vnaproperty_path_keys(const vnaproperty_t *root,
+	const vnaproperty_path_t *path, ...);
+
+/*
+ * vnaproperty_path_get: get a property value from a compiled expression
+ *   @root: property data root (can be NULL)
+ *   @path: compiled property expression
+ *   @...:  arguments for the placeholders
+ */
+extern const char *vnaproperty_path_get(const vnaproperty_t *root,
+	const vnaproperty_path_t *path, ...);
+
+/*
+ * vnaproperty_path_set: set a property value from a compiled expression
+ *   @rootptr: address of root property pointer
+ *   @path:    compiled property expression
+ *   @value:   value to set, or NULL to set null
+ *   @...:     arguments for the placeholders
+ */
+extern int vnaproperty_path_set(vnaproperty_t **rootptr,
+	const vnaproperty_path_t *path, const char *value, ...);
+
+/*
+ * vnaproperty_path_delete: delete the value described by a compiled expr
+ *   @rootptr: address of root property pointer
+ *   @path:    compiled property expression
+ *   @...:     arguments for the placeholders
+ */
+extern int vnaproperty_path_delete(vnaproperty_t **rootptr,
+	const vnaproperty_path_t *path, ...);
+
+/*
+ * vnaproperty_path_get_subtree: get the subtree described by a compiled expr
+ *   @root: property data root (can be NULL)
+ *   @path: compiled property expression
+ *   @...:  arguments for the placeholders
+ */
+extern vnaproperty_t *vnaproperty_path_get_subtree(const vnaproperty_t *root,
+	const vnaproperty_path_t *path, ...);
+
+/*
+ * vnaproperty_path_set_subtree: make the tree conform and return subtree
+ *   @rootptr: address of root property pointer
+ *   @path:    compiled property expression
+ *   @...:     arguments for the placeholders
+ */
+extern vnaproperty_t **vnaproperty_path_set_subtree(vnaproperty_t **rootptr,
+	const vnaproperty_path_t *path, ...);
+
+/*
+ * vnaproperty_path_get_int64: get a value as an int64 from a compiled expr
+ *   @root:  property data root (can be NULL)
+ *   @path:  compiled property expression
+ *   @value: address of the result
+ *   @...:   arguments for the placeholders
+ */
+extern int vnaproperty_path_get_int64(const vnaproperty_t *root,
+	const vnaproperty_path_t *path, int64_t *value, ...);
+
+/*
+ * vnaproperty_path_set_int64: set a value to an int64 from a compiled expr
+ *   @rootptr: address of root property pointer
+ *   @path:    compiled property expression
+ *   @value:   value to set
+ *   @...:     arguments for the placeholders
+ */
+extern int vnaproperty_path_set_int64(vnaproperty_t **rootptr,
+	const vnaproperty_path_t *path, int64_t value, ...);
+
+/*
+ * vnaproperty_path_get_double: get a value as a double from a compiled expr
+ *   @root:  property data root (can be NULL)
+ *   @path:  compiled property expression
+ *   @value: address of the result
+ *   @...:   arguments for the placeholders
+ */
+extern int vnaproperty_path_get_double(const vnaproperty_t *root,
+	const vnaproperty_path_t *path, double *value, ...);
+
+/*
+ * vnaproperty_path_set_double: set a value to a double from a compiled expr
+ *   @rootptr: address of root property pointer
+ *   @path:    compiled property expression
+ *   @value:   value to set
+ *   @...:     arguments for the placeholders
+ */
+extern int vnaproperty_path_set_double(vnaproperty_t **rootptr,
+	const vnaproperty_path_t *path, double value, ...);
+
+/*
+ * vnaproperty_path_get_complex: get a value as a complex from a compiled expr
+ *   @root:  property data root (can be NULL)
+ *   @path:  compiled property expression
+ *   @value: address of the result
+ *   @...:   arguments for the placeholders
+ */
+extern int vnaproperty_path_get_complex(const vnaproperty_t *root,
+	const vnaproperty_path_t *path, double complex *value, ...);
+
+/*
+ * vnaproperty_path_set_complex: set a value to a complex from a compiled expr
+ *   @rootptr: address of root property pointer
+ *   @path:    compiled property expression
+ *   @value:   value to set
+ *   @...:     arguments for the placeholders
+ */
+extern int vnaproperty_path_set_complex(vnaproperty_t **rootptr,
+	const vnaproperty_path_t *path, double complex value, ...);
+
 /*
  * vnaproperty_copy: copy a subtree
  *   @destination: subtree to be replaced by copy
@@ -265,6 +593,42 @@ extern vnaproperty_t **vnaproperty_set_subtree(vnaproperty_t **rootptr,
 extern int vnaproperty_copy(vnaproperty_t **destination,
 	const vnaproperty_t *source);
 
+/*
+ * vnaproperty_arena_t: arena holding an arena-backed property tree
+ */
+typedef struct vnaproperty_arena vnaproperty_arena_t;
+
+/*
+ * vnaproperty_arena_alloc: create an arena for a property tree
+ *   @block_size: size of each block of memory to reserve (0 for default)
+ */
+extern vnaproperty_arena_t *vnaproperty_arena_alloc(size_t block_size);
+
+/*
+ * vnaproperty_arena_get_root: return the address of the arena's root
+ *   @arena: arena
+ *
+ * Nodes added below this root, including by vnaproperty_copy and the
+ * YAML import functions, are carved from the arena, and map keys are
+ * stored once per arena.  Deleted or replaced nodes are reclaimed only
+ * when the arena is freed.  In an arena-backed tree, null values in
+ * subtrees returned from vnaproperty_set_subtree are represented by a
+ * placeholder rather than NULL; use vnaproperty_type to test them.
+ */
+extern vnaproperty_t **vnaproperty_arena_get_root(vnaproperty_arena_t *arena);
+
+/*
+ * vnaproperty_arena_get_used: return the number of bytes used by the tree
+ *   @arena: arena
+ */
+extern size_t vnaproperty_arena_get_used(const vnaproperty_arena_t *arena);
+
+/*
+ * vnaproperty_arena_free: free the arena and the tree it holds
+ *   @arena: arena (may be NULL)
+ */
+extern void vnaproperty_arena_free(vnaproperty_arena_t *arena);
+
 /*
  * vnaproperty_quote_key: quote a map ID that contains spaces or reserved chars
  *   @key: map key to quote
@@ -32,14 +32,16 @@
 #include "vnaproperty_internal.h"
 
 /*
- * vnaproperty_import_yaml_from_string: import YAML from a string
+ * _vnaproperty_import_yaml_from_string: import YAML with an allocator
+ *   @vmap:      allocator if *rootptr is NULL, or NULL for global
  *   @rootptr:   address of vnaproperty root
  *   @input:     string to parse
  *   @error_fn:  optional error reporting function
  *   @error_arg: optional argument to error reporting function
  */
-int vnaproperty_import_yaml_from_string(vnaproperty_t **rootptr,
-	const char *input, vnaerr_error_fn_t *error_fn, void *error_arg)
+int _vnaproperty_import_yaml_from_string(const vnamem_allocator_t *vmap,
+	vnaproperty_t **rootptr, const char *input,
+	vnaerr_error_fn_t *error_fn, void *error_arg)
 {
     vnaproperty_yaml_t vyml;
     yaml_parser_t parser;
@@ -51,6 +53,7 @@ int vnaproperty_import_yaml_from_string(vnaproperty_t **rootptr,
     vyml.vyml_filename = "-";
     vyml.vyml_error_fn = error_fn;
     vyml.vyml_error_arg = error_arg;
+    vyml.vyml_allocator = vmap;
 
     yaml_parser_initialize(&parser);
     yaml_parser_set_input_string(&parser,
@@ -72,11 +75,27 @@ int vnaproperty_import_yaml_from_string(vnaproperty_t **rootptr,
 	goto error;
     }
     yaml_document_delete(&document);
+    yaml_parser_delete(&parser);
     return 0;
 
 error:
     if (delete_document) {
 	yaml_document_delete(&document);
     }
+    yaml_parser_delete(&parser);
     return -1;
 }
+
+/*
+ * vnaproperty_import_yaml_from_string: import YAML from a string
+ *   @rootptr:   address of vnaproperty root
+ *   @input:     string to parse
+ *   @error_fn:  optional error reporting function
+ *   @error_arg: optional argument to error reporting function
+ */
+int vnaproperty_import_yaml_from_string(vnaproperty_t **rootptr,
+	const char *input, vnaerr_error_fn_t *error_fn, void *error_arg)
+{
+    return _vnaproperty_import_yaml_from_string(NULL, rootptr, input,
+	    error_fn, error_arg);
+}
@@ -19,7 +19,10 @@
 #ifndef _VNAPROPERTY_INTERNAL_H
 #define _VNAPROPERTY_INTERNAL_H
 
+#include <complex.h>
+#include <stdbool.h>
 #include <stdint.h>
+#include "vnamem_internal.h"
 #include "vnaproperty.h"
 
 #ifdef __cplusplus
@@ -30,7 +33,8 @@ typedef enum {
     VNAPROPERTY_ERROR	= -1,
     VNAPROPERTY_SCALAR	= 0x56505253,	/* "VPRS" */
     VNAPROPERTY_MAP	= 0x5650524D,	/* "VPRM" */
-    VNAPROPERTY_LIST	= 0x5650524C	/* "VPRL" */
+    VNAPROPERTY_LIST	= 0x5650524C,	/* "VPRL" */
+    VNAPROPERTY_NULL	= 0x5650524E	/* "VPRN" arena null placeholder */
 } vnaproperty_type_t;
 
 #define VNAPROPERTY_MAP_PAIR_ELEMENT_MAGIC	0x564D5045	/* "VMPE" */
@@ -44,14 +48,42 @@ struct vnaproperty_map;
 struct vnaproperty {
     uint32_t vpr_type;
     int vpr_line;	/* line number if imported from file */
+    vnaproperty_arena_t *vpr_arena; /* arena holding the node or NULL */
+    const vnamem_allocator_t *vpr_allocator; /* allocator holding the node */
 };
 
 /*
- * vnaproperty_scalar_t: scalar (string) structure
+ * vnaproperty_number_type_t: type of the numeric value of a scalar
+ */
+typedef enum vnaproperty_number_type {
+    VNAPROPERTY_NUMBER_NONE = 0,	/* no numeric value */
+    VNAPROPERTY_NUMBER_INT64,
+    VNAPROPERTY_NUMBER_DOUBLE,
+    VNAPROPERTY_NUMBER_COMPLEX
+} vnaproperty_number_type_t;
+
+/*
+ * vnaproperty_number_t: numeric value of a scalar
+ */
+typedef union vnaproperty_number {
+    int64_t vpn_int64;
+    double vpn_double;
+    double complex vpn_complex;
+} vnaproperty_number_t;
+
+/*
+ * vnaproperty_scalar_t: scalar structure
+ *
+ *   A scalar set from a number (vps_typed) keeps the number as its
+ *   value, along with text made when it was set.  A scalar set from
+ *   text has only the text.  Nodes are never modified by reads.
  */
 typedef struct vnaproperty_scalar {
     vnaproperty_t vps_base;
-    char *vps_value;
+    char *vps_value;			/* text */
+    bool vps_typed;			/* vps_number is the value */
+    vnaproperty_number_type_t vps_number_type; /* type of vps_number */
+    vnaproperty_number_t vps_number;	/* value if vps_typed */
 } vnaproperty_scalar_t;
 
 /*
@@ -79,14 +111,25 @@ typedef struct vnaproperty_map_element {
     vnaproperty_map_pair_t vme_pair;
     uint32_t vme_magic;
     uint32_t vme_hashval;
-    struct vnaproperty_map_element *vme_hash_next;
     struct vnaproperty_map_element *vme_order_next;
     struct vnaproperty_map_element *vme_order_prev;
 } vnaproperty_map_element_t;
 
+/*
+ * vnaproperty_map_slot_t: slot in the open-addressing hash table of a map
+ */
+typedef struct vnaproperty_map_slot {
+    uint32_t vms_hashval;			/* copy of vme_hashval */
+    vnaproperty_map_element_t *vms_element;	/* NULL if empty */
+} vnaproperty_map_slot_t;
+
 /*
  * vnaproperty_map_t: property map structure
  *
+ *   The hash table uses linear probing; its size is zero or a power of
+ *   two.  Elements are allocated individually so that the addresses of
+ *   their values remain stable as the table grows.
+ *
  * Note:
  *   For cosmetic reasons, we remember the insertion order, and the
  *   iterator returns elements in this order so that related fields
@@ -97,7 +140,7 @@ typedef struct vnaproperty_map {
     vnaproperty_t vpm_base;
     size_t vpm_count;
     size_t vpm_hash_size;
-    vnaproperty_map_element_t **vpm_hash_table;
+    vnaproperty_map_slot_t *vpm_hash_table;
     vnaproperty_map_element_t *vpm_order_head;
     vnaproperty_map_element_t *vpm_order_tail;
 } vnaproperty_map_t;
@@ -110,16 +153,64 @@ typedef struct vnaproperty_yaml {
     const char         *vyml_filename;	/* filename for error messages */
     vnaerr_error_fn_t  *vyml_error_fn;	/* error reporting function */
     void	       *vyml_error_arg;	/* argument to error function */
+    int			vyml_line_offset; /* lines before the YAML text */
+    void	       *vyml_anchors;	/* anchors seen in event parsing */
+    void	       *vyml_emitter;	/* yaml_emitter_t for event output */
+    const vnamem_allocator_t *vyml_allocator; /* for a new tree or NULL */
 } vnaproperty_yaml_t;
 
+/* _vnaproperty_vset: vnaproperty_vset, starting a new tree with vmap */
+extern int _vnaproperty_vset(const vnamem_allocator_t *vmap,
+	vnaproperty_t **rootptr, const char *format, va_list ap);
+
+/* _vnaproperty_vset_subtree: vnaproperty_vset_subtree with an allocator */
+extern vnaproperty_t **_vnaproperty_vset_subtree(
+	const vnamem_allocator_t *vmap, vnaproperty_t **rootptr,
+	const char *format, va_list ap);
+
+/* _vnaproperty_copy: vnaproperty_copy, starting a new tree with vmap */
+extern int _vnaproperty_copy(const vnamem_allocator_t *vmap,
+	vnaproperty_t **destination, const vnaproperty_t *source);
+
+/* _vnaproperty_import_yaml_from_string: import YAML with an allocator */
+extern int _vnaproperty_import_yaml_from_string(
+	const vnamem_allocator_t *vmap, vnaproperty_t **rootptr,
+	const char *input, vnaerr_error_fn_t *error_fn, void *error_arg);
+
+/* _vnaproperty_parse_complex: parse complex text; HUGE_VAL if invalid */
+extern double complex _vnaproperty_parse_complex(const char *text);
+
 /* _vnaproperty_yaml_import: import properties from a YAML document */
 extern int _vnaproperty_yaml_import(vnaproperty_yaml_t *vymlp,
 	vnaproperty_t **rootptr, void *yaml_node);
 
+/* _vnaproperty_yaml_parse: build properties from YAML parser events */
+extern int _vnaproperty_yaml_parse(vnaproperty_yaml_t *vymlp,
+	vnaproperty_t **rootptr, void *yaml_parser, void *yaml_event);
+
+/* _vnaproperty_yaml_free_anchors: free anchors saved during event parsing */
+extern void _vnaproperty_yaml_free_anchors(vnaproperty_yaml_t *vymlp);
+
 /* _vnaproperty_yaml_export: export properties to a YAML document */
 extern int _vnaproperty_yaml_export(vnaproperty_yaml_t *vymlp,
 	const vnaproperty_t *root);
 
+/* _vnaproperty_yaml_emit_event: send an event to the YAML emitter */
+extern int _vnaproperty_yaml_emit_event(vnaproperty_yaml_t *vymlp,
+	void *yaml_event);
+
+/* _vnaproperty_yaml_emit_key: emit a map key */
+extern int _vnaproperty_yaml_emit_key(vnaproperty_yaml_t *vymlp,
+	const char *key);
+
+/* _vnaproperty_yaml_emit_scalar: emit a scalar value or NULL */
+extern int _vnaproperty_yaml_emit_scalar(vnaproperty_yaml_t *vymlp,
+	const char *value);
+
+/* _vnaproperty_yaml_emit: emit properties as YAML events */
+extern int _vnaproperty_yaml_emit(vnaproperty_yaml_t *vymlp,
+	const vnaproperty_t *root);
+
 /* _vnaproperty_yaml_error: report an error */
 extern void _vnaproperty_yaml_error(const vnaproperty_yaml_t *vymlp,
 	vnaerr_category_t category, const char *format, ...)
@@ -0,0 +1,65 @@
+/*
+ * Vector Network Analyzer Library
+ * Copyright © 2020-2024 D Scott Guthridge <scott_guthridge@rompromity.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "archdep.h"
+
+#include <stdlib.h>
+#include "vnastats_internal.h"
+
+
+/*
+ * _vnastats_register: allocate and list a per-thread statistics block
+ *   @headp: address of the module's list head
+ *   @size: size of the module's statistics structure
+ *
+ *   Return a pointer to the zeroed statistics structure, or NULL if
+ *   out of memory.  Blocks are allocated with calloc rather than
+ *   through vnamem so that they don't show up in the allocation
+ *   counters and don't depend on an allocator the caller may replace.
+ */
+void *_vnastats_register(vnastats_block_t **headp, size_t size)
+{
+    vnastats_block_t *bp;
+
+    if ((bp = calloc(1, sizeof(vnastats_block_t) + size)) == NULL) {
+	return NULL;
+    }
+#ifdef __GNUC__
+    bp->vsb_next = __atomic_load_n(headp, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(headp, &bp->vsb_next, bp, true,
+		__ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+	continue;
+    }
+#else
+    bp->vsb_next = *headp;
+    *headp = bp;
+#endif
+    return (void *)bp->vsb_data;
+}
+
+/*
+ * _vnastats_first: return the first block of a module list
+ *   @headp: address of the module's list head
+ */
+vnastats_block_t *_vnastats_first(vnastats_block_t *const *headp)
+{
+#ifdef __GNUC__
+    return __atomic_load_n(headp, __ATOMIC_ACQUIRE);
+#else
+    return *headp;
+#endif
+}
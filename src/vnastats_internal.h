@@ -0,0 +1,161 @@
+/*
+ * Vector Network Analyzer Library
+ * Copyright © 2020-2024 D Scott Guthridge <scott_guthridge@rompromity.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef VNASTATS_INTERNAL_H
+#define VNASTATS_INTERNAL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include "vnacal.h"
+#include "vnadata.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Each statistics module (e.g. _vnacal_stats) provides a shared
+ * structure NAME_global, a flag NAME_per_thread selecting per-thread
+ * mode, a list NAME_list of per-thread blocks, a thread-local pointer
+ * NAME_local to the calling thread's block, and a function
+ * NAME_register that allocates and lists the block on the thread's
+ * first count.  In per-thread mode, each thread counts into its own
+ * block without contention and NAME_get_stats sums the blocks;
+ * otherwise, counters are updated with relaxed atomics where the
+ * compiler supports them.  Unless configured with --enable-stats,
+ * all counting is compiled out of the hot paths.
+ */
+#ifdef __GNUC__
+#define _VNASTATS_THREAD_LOCAL	__thread
+#define _VNASTATS_ATOMIC_ADD(lvalue, n) \
+	((void)__atomic_fetch_add(&(lvalue), (n), __ATOMIC_RELAXED))
+#define _VNASTATS_LOAD(lvalue) \
+	__atomic_load_n(&(lvalue), __ATOMIC_RELAXED)
+#define _VNASTATS_STORE(lvalue, value) \
+	__atomic_store_n(&(lvalue), (value), __ATOMIC_RELAXED)
+#else
+#define _VNASTATS_THREAD_LOCAL	_Thread_local
+#define _VNASTATS_ATOMIC_ADD(lvalue, n) \
+	((void)((lvalue) += (n)))
+#define _VNASTATS_LOAD(lvalue) \
+	(lvalue)
+#define _VNASTATS_STORE(lvalue, value) \
+	((void)((lvalue) = (value)))
+#endif
+
+/*
+ * vnastats_block_t: per-thread statistics block
+ *
+ *   Blocks are never freed: counts made by threads that have exited
+ *   stay in the sums.
+ */
+typedef struct vnastats_block {
+    struct vnastats_block *vsb_next;	/* next block in the module list */
+    uint64_t vsb_data[];		/* module's statistics structure */
+} vnastats_block_t;
+
+/* _vnastats_register: allocate and list a per-thread statistics block */
+extern void *_vnastats_register(vnastats_block_t **headp, size_t size);
+
+/* _vnastats_first: return the first block of a module list */
+extern vnastats_block_t *_vnastats_first(vnastats_block_t *const *headp);
+
+/* _vnacal_stats: vnacal counters (see vnacal_get_stats) */
+extern vnacal_stats_t _vnacal_stats_global;
+extern vnastats_block_t *_vnacal_stats_list;
+extern _VNASTATS_THREAD_LOCAL vnacal_stats_t *_vnacal_stats_local;
+extern bool _vnacal_stats_per_thread;
+extern vnacal_stats_t *_vnacal_stats_register(void);
+
+/* _vnadata_stats: vnadata counters (see vnadata_get_stats) */
+extern vnadata_stats_t _vnadata_stats_global;
+extern vnastats_block_t *_vnadata_stats_list;
+extern _VNASTATS_THREAD_LOCAL vnadata_stats_t *_vnadata_stats_local;
+extern bool _vnadata_stats_per_thread;
+extern vnadata_stats_t *_vnadata_stats_register(void);
+
+#ifdef ENABLE_STATS
+
+/*
+ * _VNASTATS_ADD: add n to a statistics counter
+ *   @name: statistics module name
+ *   @field: field expression within the module's structure
+ *   @n: amount to add
+ */
+#define _VNASTATS_ADD(name, field, n) \
+	(_VNASTATS_LOAD(name##_per_thread) ? \
+	 _VNASTATS_LOCAL_ADD(_VNASTATS_BLOCK(name)->field, (n)) : \
+	 _VNASTATS_ATOMIC_ADD(name##_global.field, (n)))
+
+/*
+ * _VNASTATS_BLOCK: return the calling thread's block, registering it
+ *	on first use
+ *   @name: statistics module name
+ */
+#define _VNASTATS_BLOCK(name) \
+	(name##_local != NULL ? name##_local : name##_register())
+
+/*
+ * _VNASTATS_LOCAL_ADD: add n to a counter only this thread updates
+ *   @lvalue: counter
+ *   @n: amount to add
+ *
+ *   Other threads may be reading the counter to sum it, so use
+ *   relaxed loads and stores, but no locked instruction is needed.
+ */
+#define _VNASTATS_LOCAL_ADD(lvalue, n) \
+	_VNASTATS_STORE(lvalue, _VNASTATS_LOAD(lvalue) + (n))
+
+/*
+ * _VNASTATS_TIME: count a call and the time since start
+ *   @name: statistics module name
+ *   @calls_field: field counting calls
+ *   @ns_field: field accumulating nanoseconds
+ *   @start: value of _VNASTATS_NOW() on entry
+ */
+#define _VNASTATS_TIME(name, calls_field, ns_field, start) \
+	(_VNASTATS_ADD(name, calls_field, 1), \
+	 _VNASTATS_ADD(name, ns_field, _VNASTATS_NOW() - (start)))
+
+/*
+ * _VNASTATS_NOW: return a monotonic timestamp in nanoseconds
+ */
+static inline uint64_t _VNASTATS_NOW(void)
+{
+    struct timespec ts;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+#else /* ENABLE_STATS */
+
+#define _VNASTATS_ADD(name, field, n)	((void)0)
+#define _VNASTATS_TIME(name, calls_field, ns_field, start) \
+	((void)(start))
+#define _VNASTATS_NOW()			((uint64_t)0)
+
+#endif /* ENABLE_STATS */
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* VNASTATS_INTERNAL_H */